@@ -25,14 +25,73 @@ For a copy of the GNU General Public License see file COPYING.
 #include "oalsfxpp.h"
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <limits>
 #include <new>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OALSFXPP_SSE2
+#include <emmintrin.h>
+#endif // SSE2
+
+// Wider instruction sets are not enabled at compile time; their kernels are
+// built for the respective target and selected at run time.
+#ifdef OALSFXPP_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OALSFXPP_AVX
+#define OALSFXPP_WIDE_LANES
+#define OALSFXPP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define OALSFXPP_TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define OALSFXPP_AVX
+#define OALSFXPP_TARGET_AVX2
+#define OALSFXPP_TARGET_AVX512
+#endif
+#endif // OALSFXPP_SSE2
+
+#if defined(__GNUC__)
+#define OALSFXPP_FORCE_INLINE __attribute__((always_inline)) inline
+#elif defined(_MSC_VER)
+#define OALSFXPP_FORCE_INLINE __forceinline
+#else
+#define OALSFXPP_FORCE_INLINE inline
+#endif
+
+#ifdef OALSFXPP_AVX
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+#endif // OALSFXPP_AVX
+
+// Memory mapping of the impulse responses, and zeroed pages of the big delay
+// lines.
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
 namespace oalsfxpp
 {
 
@@ -53,6 +112,9 @@ constexpr auto max_sampling_rate = 8'000'000;
 
 constexpr auto max_mix_gain = 16.0F; // +24dB
 
+// The longest crossfade of an effect swap, in seconds.
+constexpr auto max_effect_swap_time = 10.0F;
+
 constexpr auto silence_threshold_gain = 0.000'01F; // -100dB
 
 // The maximum number of Ambisonics coefficients. For a given order (o), the
@@ -185,6 +247,13 @@ struct Math
         return val1 + ((val2 - val1) * mu);
     }
 
+    // Rounds to the nearest integer, halfway cases away from zero.
+    static int round_to_int(
+        const float value)
+    {
+        return static_cast<int>(value + ((value < 0.0F) ? -0.5F : 0.5F));
+    }
+
     // Find the next power-of-2 for non-power-of-2 numbers.
     static int next_power_of_2(
         const int value)
@@ -208,6 +277,24 @@ struct Math
     {
         return std::numeric_limits<float>::epsilon();
     }
+
+    // Zeroth-order modified Bessel function of the first kind.
+    static double bessel_i0(
+        const double x)
+    {
+        auto sum = 1.0;
+        auto term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            const auto half_x_k = x / (2.0 * k);
+
+            term *= half_x_k * half_x_k;
+            sum += term;
+        }
+
+        return sum;
+    }
 }; // Math
 
 struct Mat4F
@@ -240,3408 +327,12705 @@ constexpr Mat4F mat4f_identity = {{
 }};
 
 
-template<typename T>
-constexpr int get_array_extents(
-    const T&)
+// Four-lane float vector.
+//
+// Maps onto an SSE register when available, or onto a plain array otherwise,
+// so the kernels built on top of it have a single source.
+struct Float4
 {
-    static_assert(std::rank<T>::value == 1, "Expected an one-dimensional array.");
-    return static_cast<int>(std::extent<T>::value);
-}
+    static constexpr auto lane_count = 4;
 
 
-struct AmbiConfig
-{
-    using Coeffs = std::array<ChannelConfig, max_channels>;
+#ifdef OALSFXPP_SSE2
+    __m128 v_;
+#else
+    float v_[4];
+#endif // OALSFXPP_SSE2
 
 
-    // Ambisonic coefficients for mixing to the dry buffer.
-    Coeffs coeffs_;
+    static Float4 zero()
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_setzero_ps()};
+#else
+        return {{0.0F, 0.0F, 0.0F, 0.0F,}};
+#endif // OALSFXPP_SSE2
+    }
 
-    void reset()
+    static Float4 set1(
+        const float value)
     {
-        for (auto& coeff : coeffs_)
-        {
-            coeff.fill(0.0F);
-        }
+#ifdef OALSFXPP_SSE2
+        return {_mm_set1_ps(value)};
+#else
+        return {{value, value, value, value,}};
+#endif // OALSFXPP_SSE2
     }
-}; // AmbiConfig
 
-struct AmbiOutput
-{
-    AmbiConfig ambi_;
+    static Float4 set(
+        const float value0,
+        const float value1,
+        const float value2,
+        const float value3)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_setr_ps(value0, value1, value2, value3)};
+#else
+        return {{value0, value1, value2, value3,}};
+#endif // OALSFXPP_SSE2
+    }
 
-    // Number of coefficients in each Ambi.Coeffs to mix together (4 for
-    // first-order, 9 for second-order, etc). If the count is 0, Ambi.Map
-    // is used instead to map each output to a coefficient index.
-    //
-    // Will only be 4 or 0 (first-order ambisonics output).
-    int coeff_count_;
-}; // AmbiOutput
+    static Float4 load(
+        const float* src)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_loadu_ps(src)};
+#else
+        return {{src[0], src[1], src[2], src[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-struct ChannelPanning
-{
-    ChannelId name_;
-    ChannelConfig config_;
-}; // ChannelPanning
+    void store(
+        float* dst) const
+    {
+#ifdef OALSFXPP_SSE2
+        _mm_storeu_ps(dst, v_);
+#else
+        dst[0] = v_[0];
+        dst[1] = v_[1];
+        dst[2] = v_[2];
+        dst[3] = v_[3];
+#endif // OALSFXPP_SSE2
+    }
 
-struct Panning
-{
-    static constexpr ChannelPanning mono_panning[1] =
+    friend Float4 operator+(
+        const Float4& a,
+        const Float4& b)
     {
-        {
-            ChannelId::front_center,
-            {1.0F},
-        },
-    };
+#ifdef OALSFXPP_SSE2
+        return {_mm_add_ps(a.v_, b.v_)};
+#else
+        return {{a.v_[0] + b.v_[0], a.v_[1] + b.v_[1], a.v_[2] + b.v_[2], a.v_[3] + b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-    static constexpr ChannelPanning stereo_panning[2] =
+    friend Float4 operator-(
+        const Float4& a,
+        const Float4& b)
     {
-        {
-            ChannelId::front_left,
-            {5.00000000E-1F, 2.88675135E-1F, 0.0F, 1.19573156E-1F,}
-        },
+#ifdef OALSFXPP_SSE2
+        return {_mm_sub_ps(a.v_, b.v_)};
+#else
+        return {{a.v_[0] - b.v_[0], a.v_[1] - b.v_[1], a.v_[2] - b.v_[2], a.v_[3] - b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_right,
-            {5.00000000E-1F, -2.88675135E-1F, 0.0F, 1.19573156E-1F,},
-        },
-    };
+    friend Float4 operator*(
+        const Float4& a,
+        const Float4& b)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_mul_ps(a.v_, b.v_)};
+#else
+        return {{a.v_[0] * b.v_[0], a.v_[1] * b.v_[1], a.v_[2] * b.v_[2], a.v_[3] * b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-    static constexpr ChannelPanning quad_panning[4] =
+    static Float4 abs(
+        const Float4& a)
     {
-        {
-            ChannelId::back_left,
-            {3.53553391E-1F, 2.04124145E-1F, 0.0F, -2.04124145E-1F,},
-        },
+#ifdef OALSFXPP_SSE2
+        return {_mm_andnot_ps(_mm_set1_ps(-0.0F), a.v_)};
+#else
+        return {{std::abs(a.v_[0]), std::abs(a.v_[1]), std::abs(a.v_[2]), std::abs(a.v_[3]),}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_left,
-            {3.53553391E-1F, 2.04124145E-1F, 0.0F, 2.04124145E-1F,},
-        },
+    static Float4 min(
+        const Float4& a,
+        const Float4& b)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_min_ps(a.v_, b.v_)};
+#else
+        return {{std::min(a.v_[0], b.v_[0]), std::min(a.v_[1], b.v_[1]), std::min(a.v_[2], b.v_[2]), std::min(a.v_[3], b.v_[3]),}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_right,
-            {3.53553391E-1F, -2.04124145E-1F, 0.0F, 2.04124145E-1F,},
-        },
+    static Float4 max(
+        const Float4& a,
+        const Float4& b)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_max_ps(a.v_, b.v_)};
+#else
+        return {{std::max(a.v_[0], b.v_[0]), std::max(a.v_[1], b.v_[1]), std::max(a.v_[2], b.v_[2]), std::max(a.v_[3], b.v_[3]),}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::back_right,
-            {3.53553391E-1F, -2.04124145E-1F, 0.0F, -2.04124145E-1F,},
-        },
-    };
+    // The maximum of the lanes.
+    static float get_max(
+        const Float4& a)
+    {
+#ifdef OALSFXPP_SSE2
+        const auto pairs = _mm_max_ps(a.v_, _mm_movehl_ps(a.v_, a.v_));
 
-    static constexpr ChannelPanning x5_1_side_panning[5] =
+        return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+#else
+        return std::max(std::max(a.v_[0], a.v_[1]), std::max(a.v_[2], a.v_[3]));
+#endif // OALSFXPP_SSE2
+    }
+
+    // The sum of the lanes.
+    static float get_sum(
+        const Float4& a)
     {
-        {
-            ChannelId::side_left,
-            {3.33001372E-1F, 1.89085671E-1F, 0.0F, -2.00041334E-1F, -2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
-        },
+#ifdef OALSFXPP_SSE2
+        const auto pairs = _mm_add_ps(a.v_, _mm_movehl_ps(a.v_, a.v_));
 
-        {
-            ChannelId::front_left,
-            {1.47751298E-1F, 1.28994110E-1F, 0.0F, 1.15190495E-1F, 7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
-        },
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+#else
+        return (a.v_[0] + a.v_[1]) + (a.v_[2] + a.v_[3]);
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_center,
-            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
-        },
+    // Reciprocal, refined to nearly full precision with a Newton-Raphson step.
+    static Float4 rcp(
+        const Float4& a)
+    {
+#ifdef OALSFXPP_SSE2
+        const auto estimate = _mm_rcp_ps(a.v_);
+        const auto error = _mm_sub_ps(_mm_set1_ps(2.0F), _mm_mul_ps(a.v_, estimate));
 
-        {
-            ChannelId::front_right,
-            {1.47751298E-1F, -1.28994110E-1F, 0.0F, 1.15190495E-1F, -7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
-        },
+        return {_mm_mul_ps(estimate, error)};
+#else
+        return {{1.0F / a.v_[0], 1.0F / a.v_[1], 1.0F / a.v_[2], 1.0F / a.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::side_right,
-            {3.33001372E-1F, -1.89085671E-1F, 0.0F, -2.00041334E-1F, 2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
-        },
-    };
+    // Rearranges the lanes: (a[I0], a[I1], a[I2], a[I3]).
+    template<int I0, int I1, int I2, int I3>
+    static Float4 shuffle(
+        const Float4& a)
+    {
+#ifdef OALSFXPP_SSE2
+        return {_mm_shuffle_ps(a.v_, a.v_, _MM_SHUFFLE(I3, I2, I1, I0))};
+#else
+        return {{a.v_[I0], a.v_[I1], a.v_[I2], a.v_[I3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-    static constexpr ChannelPanning x5_1_rear_panning[5] =
+    // Transposes a 4x4 matrix held in four row vectors.
+    static void transpose(
+        Float4& row0,
+        Float4& row1,
+        Float4& row2,
+        Float4& row3)
     {
-        {
-            ChannelId::back_left,
-            {3.33001372E-1F, 1.89085671E-1F, 0.0F, -2.00041334E-1F, -2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
-        },
+#ifdef OALSFXPP_SSE2
+        _MM_TRANSPOSE4_PS(row0.v_, row1.v_, row2.v_, row3.v_);
+#else
+        Float4* rows[4] = {&row0, &row1, &row2, &row3,};
 
+        for (int i = 0; i < 4; ++i)
         {
-            ChannelId::front_left,
-            {1.47751298E-1F, 1.28994110E-1F, 0.0F, 1.15190495E-1F, 7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
-        },
+            for (int j = i + 1; j < 4; ++j)
+            {
+                std::swap(rows[i]->v_[j], rows[j]->v_[i]);
+            }
+        }
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_center,
-            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
-        },
+    // Interleaves the lanes of two vectors: (a0, b0, a1, b1) and (a2, b2, a3, b3).
+    static void interleave(
+        const Float4& a,
+        const Float4& b,
+        Float4& lo,
+        Float4& hi)
+    {
+#ifdef OALSFXPP_SSE2
+        lo.v_ = _mm_unpacklo_ps(a.v_, b.v_);
+        hi.v_ = _mm_unpackhi_ps(a.v_, b.v_);
+#else
+        lo = {{a.v_[0], b.v_[0], a.v_[1], b.v_[1],}};
+        hi = {{a.v_[2], b.v_[2], a.v_[3], b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::front_right,
-            {1.47751298E-1F, -1.28994110E-1F, 0.0F, 1.15190495E-1F, -7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
-        },
+    // Interleaves the lane pairs of two vectors: (a0, a1, b0, b1) and (a2, a3, b2, b3).
+    static void interleave_pairs(
+        const Float4& a,
+        const Float4& b,
+        Float4& lo,
+        Float4& hi)
+    {
+#ifdef OALSFXPP_SSE2
+        lo.v_ = _mm_movelh_ps(a.v_, b.v_);
+        hi.v_ = _mm_movehl_ps(b.v_, a.v_);
+#else
+        lo = {{a.v_[0], a.v_[1], b.v_[0], b.v_[1],}};
+        hi = {{a.v_[2], a.v_[3], b.v_[2], b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
 
-        {
-            ChannelId::back_right,
-            {3.33001372E-1F, -1.89085671E-1F, 0.0F, -2.00041334E-1F, 2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
-        },
-    };
+    // Splits the lanes of two vectors by parity: (a0, a2, b0, b2) and (a1, a3, b1, b3).
+    static void deinterleave(
+        const Float4& a,
+        const Float4& b,
+        Float4& even,
+        Float4& odd)
+    {
+#ifdef OALSFXPP_SSE2
+        even.v_ = _mm_shuffle_ps(a.v_, b.v_, _MM_SHUFFLE(2, 0, 2, 0));
+        odd.v_ = _mm_shuffle_ps(a.v_, b.v_, _MM_SHUFFLE(3, 1, 3, 1));
+#else
+        even = {{a.v_[0], a.v_[2], b.v_[0], b.v_[2],}};
+        odd = {{a.v_[1], a.v_[3], b.v_[1], b.v_[3],}};
+#endif // OALSFXPP_SSE2
+    }
+}; // Float4
 
-    static constexpr ChannelPanning x6_1_panning[6] =
+#ifdef OALSFXPP_AVX
+struct Avx
+{
+    // Transposes an 8x8 matrix held in eight row vectors.
+    OALSFXPP_TARGET_AVX2
+    static void transpose(
+        __m256 rows[8])
     {
-        {
-            ChannelId::side_left,
-            {2.04462744E-1F, 2.17178497E-1F, 0.0F, -4.39990188E-2F, -2.60787329E-2F, 0.0F, 0.0F, 0.0F, -6.87238843E-2F,},
-        },
+        __m256 t[8];
 
+        for (int i = 0; i < 8; i += 2)
         {
-            ChannelId::front_left,
-            {1.18130342E-1F, 9.34633906E-2F, 0.0F, 1.08553749E-1F, 6.80658795E-2F, 0.0F, 0.0F, 0.0F, 1.08999485E-2F,},
-        },
+            t[i + 0] = _mm256_unpacklo_ps(rows[i], rows[i + 1]);
+            t[i + 1] = _mm256_unpackhi_ps(rows[i], rows[i + 1]);
+        }
 
-        {
-            ChannelId::front_center,
-            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
-        },
+        __m256 u[8];
 
+        for (int i = 0; i < 8; i += 4)
         {
-            ChannelId::front_right,
-            {1.18130342E-1F, -9.34633906E-2F, 0.0F, 1.08553749E-1F, -6.80658795E-2F, 0.0F, 0.0F, 0.0F, 1.08999485E-2F,},
-        },
+            u[i + 0] = _mm256_shuffle_ps(t[i + 0], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            u[i + 1] = _mm256_shuffle_ps(t[i + 0], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
 
+        for (int i = 0; i < 4; ++i)
         {
-            ChannelId::side_right,
-            {2.04462744E-1F, -2.17178497E-1F, 0.0F, -4.39990188E-2F, 2.60787329E-2F, 0.0F, 0.0F, 0.0F, -6.87238843E-2F,},
-        },
+            rows[i + 0] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+            rows[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+        }
+    }
+}; // Avx
+#endif // OALSFXPP_AVX
 
-        {
-            ChannelId::back_center,
-            {2.50001688E-1F, 0.0F, 0.0F, -2.50000094E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 6.05133395E-2F,},
-        },
-    };
+#ifdef OALSFXPP_WIDE_LANES
+// The vectors of the GCC extension for FloatN, of floats and of indices.
+//
+// They are aligned as a float only, as the lanes live in the effect states
+// too. The size has to be a constant, as GCC drops the attribute with one
+// depending on a template parameter.
+template<int TLaneCount>
+struct FloatNValue;
+
+template<>
+struct FloatNValue<8>
+{
+    typedef float Type __attribute__((vector_size(32), aligned(4)));
+    typedef int IntType __attribute__((vector_size(32), aligned(4)));
+}; // FloatNValue
 
-    static constexpr ChannelPanning x7_1_panning[6] =
-    {
-        {
-            ChannelId::back_left,
-            {
-                2.04124145E-1F, 1.08880247E-1F, 0.0F, -1.88586120E-1F, -1.29099444E-1F, 0.0F, 0.0F, 0.0F,
-                7.45355993E-2F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
+template<>
+struct FloatNValue<16>
+{
+    typedef float Type __attribute__((vector_size(64), aligned(4)));
+    typedef int IntType __attribute__((vector_size(64), aligned(4)));
+}; // FloatNValue
 
-        {
-            ChannelId::side_left,
-            {
-                2.04124145E-1F, 2.17760495E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-                -1.49071198E-1F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
+// Float vector of eight or sixteen lanes.
+//
+// The operators of the vector extension act on all the lanes. The operations
+// are inlined into the kernels, and the kernels into the functions of
+// LanesTarget, so they become the vector instructions of the target the
+// wider vectors are for.
+template<int TLaneCount>
+struct FloatN
+{
+    static constexpr auto lane_count = TLaneCount;
 
-        {
-            ChannelId::front_left,
-            {
-                2.04124145E-1F, 1.08880247E-1F, 0.0F, 1.88586120E-1F, 1.29099444E-1F, 0.0F, 0.0F, 0.0F,
-                7.45355993E-2F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
 
-        {
-            ChannelId::front_right,
-            {
-                2.04124145E-1F, -1.08880247E-1F, 0.0F, 1.88586120E-1F, -1.29099444E-1F, 0.0F, 0.0F, 0.0F,
-                7.45355993E-2F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
+    using Value = typename FloatNValue<TLaneCount>::Type;
+    using IntValue = typename FloatNValue<TLaneCount>::IntType;
 
-        {
-            ChannelId::side_right,
-            {
-                2.04124145E-1F, -2.17760495E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-                -1.49071198E-1F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
 
-        {
-            ChannelId::back_right,
-            {
-                2.04124145E-1F, -1.08880247E-1F, 0.0F, -1.88586120E-1F, 1.29099444E-1F, 0.0F, 0.0F, 0.0F,
-                7.45355993E-2F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
-            },
-        },
-    };
+    Value v_;
 
 
-    // Calculates ambisonic coefficients based on a direction vector. The vector
-    // must be normalized (unit length), and the spread is the angular width of the
-    // sound (0...tau).
-    static void calc_direction_coeffs(
-        const float dir[3],
-        const float spread,
-        AmbiCoeffs& coeffs)
+    OALSFXPP_FORCE_INLINE static FloatN zero()
     {
-        // Convert from OpenAL coords to Ambisonics.
-        const auto x = -dir[2];
-        const auto y = -dir[0];
-        const auto z = dir[1];
+        return set1(0.0F);
+    }
 
-        // Zeroth-order
-        coeffs[0] = 1.0F; // ACN 0 = 1
+    OALSFXPP_FORCE_INLINE static FloatN set1(
+        const float value)
+    {
+        return {Value{} + value};
+    }
 
-        // First-order
-        coeffs[1] = 1.732050808F * y; // ACN 1 = sqrt(3) * Y
-        coeffs[2] = 1.732050808F * z; // ACN 2 = sqrt(3) * Z
-        coeffs[3] = 1.732050808F * x; // ACN 3 = sqrt(3) * X
+    // Makes the vector of the values of the lanes, "get_lane(lane)".
+    template<typename TGetLane>
+    OALSFXPP_FORCE_INLINE static FloatN make(
+        const TGetLane& get_lane)
+    {
+        return make(get_lane, std::make_integer_sequence<int, TLaneCount>{});
+    }
 
-        // Second-order
-        coeffs[4] = 3.872983346F * x * y; // ACN 4 = sqrt(15) * X * Y
-        coeffs[5] = 3.872983346F * y * z; // ACN 5 = sqrt(15) * Y * Z
-        coeffs[6] = 1.118033989F * ((3.0F * z * z) - 1.0F); // ACN 6 = sqrt(5)/2 * (3*Z*Z - 1)
-        coeffs[7] = 3.872983346F * x * z; // ACN 7 = sqrt(15) * X * Z
-        coeffs[8] = 1.936491673F * ((x * x) - (y * y)); // ACN 8 = sqrt(15)/2 * (X*X - Y*Y)
+    template<typename TGetLane, int... TLanes>
+    OALSFXPP_FORCE_INLINE static FloatN make(
+        const TGetLane& get_lane,
+        std::integer_sequence<int, TLanes...>)
+    {
+        return {Value{get_lane(TLanes)...}};
+    }
 
-        // Third-order
-        coeffs[9] = 2.091650066F * y * ((3.0F * x * x) - (y * y)); // ACN  9 = sqrt(35/8) * Y * (3*X*X - Y*Y)
-        coeffs[10] = 10.246950766F * z * x * y; // ACN 10 = sqrt(105) * Z * X * Y
-        coeffs[11] = 1.620185175F * y * ((5.0F * z * z) - 1.0F); // ACN 11 = sqrt(21/8) * Y * (5*Z*Z - 1)
-        coeffs[12] = 1.322875656F * z * ((5.0F * z * z) - 3.0F); // ACN 12 = sqrt(7)/2 * Z * (5*Z*Z - 3)
-        coeffs[13] = 1.620185175F * x * ((5.0F * z * z) - 1.0F); // ACN 13 = sqrt(21/8) * X * (5*Z*Z - 1)
-        coeffs[14] = 5.123475383F * z * ((x * x) - (y * y)); // ACN 14 = sqrt(105)/2 * Z * (X*X - Y*Y)
-        coeffs[15] = 2.091650066F * x * ((x * x) - (3.0F * y * y)); // ACN 15 = sqrt(35/8) * X * (X*X - 3*Y*Y)
+    // Makes the indices of the lanes, "get_lane(lane)".
+    template<typename TGetLane>
+    OALSFXPP_FORCE_INLINE static void make_indices(
+        const TGetLane& get_lane,
+        IntValue& indices)
+    {
+        make_indices(get_lane, indices, std::make_integer_sequence<int, TLaneCount>{});
+    }
 
-        if (spread > 0.0F)
-        {
-            // Implement the spread by using a spherical source that subtends the
-            // angle spread. See:
-            // http://www.ppsloan.org/publications/StupidSH36.pdf - Appendix A3
-            //
-            // When adjusted for N3D normalization instead of SN3D, these
-            // calculations are:
-            //
-            // ZH0 = -sqrt(pi) * (-1+ca);
-            // ZH1 =  0.5*sqrt(pi) * sa*sa;
-            // ZH2 = -0.5*sqrt(pi) * ca*(-1+ca)*(ca+1);
-            // ZH3 = -0.125*sqrt(pi) * (-1+ca)*(ca+1)*(5*ca*ca - 1);
-            // ZH4 = -0.125*sqrt(pi) * ca*(-1+ca)*(ca+1)*(7*ca*ca - 3);
-            // ZH5 = -0.0625*sqrt(pi) * (-1+ca)*(ca+1)*(21*ca*ca*ca*ca - 14*ca*ca + 1);
-            //
-            // The gain of the source is compensated for size, so that the
-            // loundness doesn't depend on the spread. Thus:
-            //
-            // ZH0 = 1.0f;
-            // ZH1 = 0.5f * (ca+1.0f);
-            // ZH2 = 0.5f * (ca+1.0f)*ca;
-            // ZH3 = 0.125f * (ca+1.0f)*(5.0f*ca*ca - 1.0f);
-            // ZH4 = 0.125f * (ca+1.0f)*(7.0f*ca*ca - 3.0f)*ca;
-            // ZH5 = 0.0625f * (ca+1.0f)*(21.0f*ca*ca*ca*ca - 14.0f*ca*ca + 1.0f);
+    template<typename TGetLane, int... TLanes>
+    OALSFXPP_FORCE_INLINE static void make_indices(
+        const TGetLane& get_lane,
+        IntValue& indices,
+        std::integer_sequence<int, TLanes...>)
+    {
+        indices = IntValue{get_lane(TLanes)...};
+    }
 
-            const auto ca = std::cos(spread * 0.5F);
+    OALSFXPP_FORCE_INLINE static FloatN load(
+        const float* src)
+    {
+        FloatN result;
 
-            // Increase the source volume by up to +3dB for a full spread.
-            const auto scale = std::sqrt(1.0F + (spread / Math::tau));
+        std::memcpy(&result.v_, src, sizeof(Value));
 
-            const auto zh0_norm = scale;
-            const auto zh1_norm = 0.5F * (ca + 1.0F) * scale;
-            const auto zh2_norm = 0.5F * (ca + 1.0F) * ca * scale;
-            const auto zh3_norm = 0.125F * (ca + 1.0F) * ((5.0F * ca * ca) - 1.0F) * scale;
+        return result;
+    }
 
-            // Zeroth-order
-            coeffs[0] *= zh0_norm;
+    OALSFXPP_FORCE_INLINE void store(
+        float* dst) const
+    {
+        std::memcpy(dst, &v_, sizeof(Value));
+    }
 
-            // First-order
-            coeffs[1] *= zh1_norm;
-            coeffs[2] *= zh1_norm;
-            coeffs[3] *= zh1_norm;
+    OALSFXPP_FORCE_INLINE friend FloatN operator+(
+        const FloatN& a,
+        const FloatN& b)
+    {
+        return {a.v_ + b.v_};
+    }
 
-            // Second-order
-            coeffs[4] *= zh2_norm;
-            coeffs[5] *= zh2_norm;
-            coeffs[6] *= zh2_norm;
-            coeffs[7] *= zh2_norm;
-            coeffs[8] *= zh2_norm;
+    OALSFXPP_FORCE_INLINE friend FloatN operator-(
+        const FloatN& a,
+        const FloatN& b)
+    {
+        return {a.v_ - b.v_};
+    }
 
-            // Third-order
-            coeffs[9] *= zh3_norm;
-            coeffs[10] *= zh3_norm;
-            coeffs[11] *= zh3_norm;
-            coeffs[12] *= zh3_norm;
-            coeffs[13] *= zh3_norm;
-            coeffs[14] *= zh3_norm;
-            coeffs[15] *= zh3_norm;
-        }
+    OALSFXPP_FORCE_INLINE friend FloatN operator*(
+        const FloatN& a,
+        const FloatN& b)
+    {
+        return {a.v_ * b.v_};
     }
 
+    OALSFXPP_FORCE_INLINE static FloatN abs(
+        const FloatN& a)
+    {
+        return {a.v_ < 0.0F ? -a.v_ : a.v_};
+    }
 
-    // Calculates ambisonic coefficients based on azimuth and elevation. The
-    // azimuth and elevation parameters are in radians, going right and up
-    // respectively.
-    static void calc_angle_coeffs(
-        const float azimuth,
-        const float elevation,
-        const float spread,
-        AmbiCoeffs& coeffs)
+    OALSFXPP_FORCE_INLINE static FloatN min(
+        const FloatN& a,
+        const FloatN& b)
     {
-        const float dir[3] =
-        {
-            std::sin(azimuth) * std::cos(elevation),
-            std::sin(elevation),
-            -std::cos(azimuth) * std::cos(elevation),
-        };
+        return {b.v_ < a.v_ ? b.v_ : a.v_};
+    }
 
-        calc_direction_coeffs(dir, spread, coeffs);
+    OALSFXPP_FORCE_INLINE static FloatN max(
+        const FloatN& a,
+        const FloatN& b)
+    {
+        return {a.v_ < b.v_ ? b.v_ : a.v_};
     }
 
-    // Computes channel gains for ambient, omni-directional sounds.
-    static void compute_ambient_gains(
-        const int channel_count,
-        const AmbiOutput& amb_output,
-        const float in_gain,
-        Gains& out_gains)
+    OALSFXPP_FORCE_INLINE static FloatN rcp(
+        const FloatN& a)
     {
-        if (amb_output.coeff_count_ > 0)
-        {
-            compute_ambient_gains_mc(amb_output.ambi_.coeffs_.data(), channel_count, in_gain, out_gains);
-        }
-        else
-        {
-            compute_ambient_gains_bf(channel_count, in_gain, out_gains);
-        }
+        return {1.0F / a.v_};
     }
+}; // FloatN
+#endif // OALSFXPP_WIDE_LANES
 
-    static void compute_ambient_gains_mc(
-        const ChannelConfig* channel_coeffs,
-        const int channel_count,
-        const float src_gain,
-        Gains& dst_gains)
+// Runs a kernel built on the vectors of type TVector.
+//
+// The kernel's "run" member is inlined into the function below, which is
+// compiled for the target of the vectors: AVX2 for eight lanes and AVX-512
+// for sixteen. The caller selects the vectors by the kernels in use (see
+// Kernels), so the wider instructions run only on a CPU with them.
+template<typename TVector>
+struct LanesTarget
+{
+    template<typename TKernel, typename... TArgs>
+    static void run(
+        TKernel& kernel,
+        TArgs... args)
     {
-        for (int i = 0; i < max_channels; ++i)
-        {
-            dst_gains[i] = (i < channel_count ? channel_coeffs[i][0] * 1.414213562F * src_gain : 0.0F);
-        }
+        kernel.run(args...);
     }
+}; // LanesTarget
 
-    static void compute_ambient_gains_bf(
-        const int channel_count,
-        const float src_gain,
-        Gains& dst_gains)
+#ifdef OALSFXPP_WIDE_LANES
+template<>
+struct LanesTarget<FloatN<8>>
+{
+    template<typename TKernel, typename... TArgs>
+    OALSFXPP_TARGET_AVX2
+    static void run(
+        TKernel& kernel,
+        TArgs... args)
     {
-        static_cast<void>(channel_count);
+        kernel.run(args...);
+    }
+}; // LanesTarget
 
-        for (int i = 0; i < max_channels; ++i)
-        {
-            dst_gains[i] = (i == 0 ? 1.414213562F * src_gain : 0.0F);
-        }
+template<>
+struct LanesTarget<FloatN<16>>
+{
+    template<typename TKernel, typename... TArgs>
+    OALSFXPP_TARGET_AVX512
+    static void run(
+        TKernel& kernel,
+        TArgs... args)
+    {
+        kernel.run(args...);
     }
+}; // LanesTarget
+#endif // OALSFXPP_WIDE_LANES
 
-    // Computes panning gains using the given channel decoder coefficients and the
-    // pre-calculated direction or angle coefficients.
-    static void compute_panning_gains(
-        const int channel_count,
-        const AmbiOutput& amb_output,
-        const AmbiCoeffs& coeffs,
-        const float in_gain,
-        Gains& out_gains)
+
+template<typename T>
+constexpr int get_array_extents(
+    const T&)
+{
+    static_assert(std::rank<T>::value == 1, "Expected an one-dimensional array.");
+    return static_cast<int>(std::extent<T>::value);
+}
+
+
+// Writes the runtime state of the DSP objects into a byte stream.
+//
+// The values are stored in the native byte order and layout, so a state is
+// restored on a machine of the same kind. The sample buffers are stored as
+// runs of silence and sound, and a run of silence takes just its length.
+class StateWriter
+{
+public:
+    explicit StateWriter(
+        std::vector<unsigned char>& bytes)
+        :
+        bytes_(bytes)
     {
-        if (amb_output.coeff_count_ > 0)
-        {
-            compute_panning_gains_mc(
-                amb_output.ambi_.coeffs_.data(),
-                channel_count,
-                amb_output.coeff_count_,
-                coeffs,
-                in_gain,
-                out_gains);
-        }
-        else
-        {
-            compute_panning_gains_bf(
-                channel_count,
-                coeffs,
-                in_gain,
-                out_gains);
-        }
     }
 
-    static void compute_panning_gains_mc(
-        const ChannelConfig* channel_coeffs,
-        const int channel_count,
-        const int coeff_count,
-        const AmbiCoeffs& coeffs,
-        const float src_gain,
-        Gains& dst_gains)
+    StateWriter(
+        const StateWriter& that) = delete;
+
+    StateWriter& operator=(
+        const StateWriter& that) = delete;
+
+
+    template<typename T>
+    void write(
+        const T& value)
     {
-        for (int i = 0; i < max_channels; ++i)
+        static_assert(std::is_trivially_copyable<T>::value, "Expected a trivially copyable type.");
+
+        write_bytes(&value, static_cast<int>(sizeof(T)));
+    }
+
+    void write_samples(
+        const float* samples,
+        const int sample_count)
+    {
+        write(sample_count);
+
+        for (int i = 0; i < sample_count; )
         {
-            if (i < channel_count)
-            {
-                auto gain = 0.0F;
+            const auto sound_index = find_sound(samples, i, sample_count);
+            const auto silence_index = find_silence(samples, sound_index, sample_count);
 
-                for (int j = 0; j < coeff_count; ++j)
-                {
-                    gain += channel_coeffs[i][j] * coeffs[j];
-                }
+            write(sound_index - i);
+            write(silence_index - sound_index);
+            write_bytes(&samples[sound_index], (silence_index - sound_index) * static_cast<int>(sizeof(float)));
 
-                dst_gains[i] = Math::clamp(gain, 0.0F, 1.0F) * src_gain;
-            }
-            else
-            {
-                dst_gains[i] = 0.0F;
-            }
+            i = silence_index;
         }
     }
 
-    static void compute_panning_gains_bf(
-        const int channel_count,
-        const AmbiCoeffs& coeffs,
-        const float src_gain,
-        Gains& dst_gains)
+
+private:
+    // The shortest silence stored as a run. A shorter one costs less as sound
+    // than the lengths of the runs around it.
+    static constexpr auto min_silence_count = 4;
+
+
+    std::vector<unsigned char>& bytes_;
+
+
+    void write_bytes(
+        const void* src_bytes,
+        const int byte_count)
     {
-        for (int i = 0; i < max_channels; ++i)
+        const auto offset = bytes_.size();
+
+        bytes_.resize(offset + byte_count);
+
+        if (byte_count > 0)
         {
-            dst_gains[i] = (i < channel_count ? coeffs[i] * src_gain : 0.0F);
+            std::memcpy(&bytes_[offset], src_bytes, byte_count);
         }
     }
 
-    // Sets channel gains for a first-order ambisonics input channel. The matrix is
-    // a 1x4 'slice' of a transform matrix for the input channel, used to scale and
-    // orient the sound samples.
-    static void compute_first_order_gains(
-        const int channel_count,
-        const AmbiOutput& amb_output,
-        const float* const matrix,
-        const float in_gain,
-        Gains& out_gains)
+    // Only the positive zero is silence, so the restored samples keep the
+    // signs of their zeros.
+    static bool is_silent(
+        const float sample)
     {
-        if (amb_output.coeff_count_ > 0)
-        {
-            compute_first_order_gains_mc(amb_output.ambi_.coeffs_.data(), channel_count, matrix, in_gain, out_gains);
-        }
-        else
-        {
-            compute_first_order_gains_bf(channel_count, matrix, in_gain, out_gains);
-        }
+        std::uint32_t bits;
+        std::memcpy(&bits, &sample, sizeof(bits));
+
+        return bits == 0;
     }
 
-    static void compute_first_order_gains_mc(
-        const ChannelConfig* channel_coeffs,
-        int channel_count,
-        const float matrix[4],
-        float src_gain,
-        Gains& dst_gains)
+    static int find_sound(
+        const float* samples,
+        int index,
+        const int sample_count)
     {
-        for (int i = 0; i < max_channels; ++i)
+        while (index < sample_count && is_silent(samples[index]))
         {
-            if (i < channel_count)
-            {
-                auto gain = 0.0F;
+            index += 1;
+        }
 
-                for (int j = 0; j < 4; ++j)
-                {
-                    gain += channel_coeffs[i][j] * matrix[j];
-                }
+        return index;
+    }
 
-                dst_gains[i] = Math::clamp(gain, 0.0F, 1.0F) * src_gain;
-            }
-            else
+    // Finds the start of the next silence worth a run, or the end.
+    static int find_silence(
+        const float* samples,
+        int index,
+        const int sample_count)
+    {
+        while (index < sample_count)
+        {
+            const auto sound_index = find_sound(samples, index, sample_count);
+
+            if (sound_index == sample_count || (sound_index - index) >= min_silence_count)
             {
-                dst_gains[i] = 0.0F;
+                return index;
             }
+
+            index = sound_index + 1;
         }
+
+        return index;
     }
+}; // StateWriter
 
-    static void compute_first_order_gains_bf(
-        const int channel_count,
-        const float matrix[4],
-        const float src_gain,
-        Gains& dst_gains)
+// Reads the runtime state written by StateWriter.
+//
+// Any value out of place fails the reader, and a failed reader leaves the
+// values it is asked for as they are. A validating reader checks the values
+// the same way, but leaves all of them as they are.
+class StateReader
+{
+public:
+    StateReader(
+        const unsigned char* bytes,
+        const int byte_count,
+        const bool is_validating = false)
+        :
+        bytes_{bytes},
+        byte_count_{byte_count},
+        offset_{},
+        is_validating_{is_validating},
+        is_failed_{}
     {
-        for (int i = 0; i < max_channels; ++i)
-        {
-            dst_gains[i] = (i < channel_count ? matrix[i] * src_gain : 0.0F);
-        }
     }
 
-    static void set_channel_map(
-        const ChannelId* device_channels,
-        ChannelConfig* ambi_coeffs,
-        const ChannelPanning* channel_panning,
-        const int count,
-        int* out_count)
-    {
-        int i;
+    StateReader(
+        const StateReader& that) = delete;
 
-        for (i = 0; i < max_channels && device_channels[i] != ChannelId::none; ++i)
-        {
-            if (device_channels[i] == ChannelId::lfe)
-            {
-                for (int j = 0; j < max_ambi_coeffs; ++j)
-                {
-                    ambi_coeffs[i][j] = 0.0F;
-                }
+    StateReader& operator=(
+        const StateReader& that) = delete;
 
-                continue;
-            }
 
-            for (int j = 0; j < count; ++j)
-            {
-                if (device_channels[i] != channel_panning[j].name_)
-                {
-                    continue;
-                }
+    bool is_validating() const
+    {
+        return is_validating_;
+    }
 
-                for (int k = 0; k < max_ambi_coeffs; ++k)
-                {
-                    ambi_coeffs[i][k] = channel_panning[j].config_[k];
-                }
+    bool is_failed() const
+    {
+        return is_failed_;
+    }
 
-                break;
-            }
-        }
+    bool is_end() const
+    {
+        return offset_ == byte_count_;
+    }
 
-        *out_count = i;
+    void fail()
+    {
+        is_failed_ = true;
     }
-}; // Panning
 
-// Filters implementation is based on the "Cookbook formulae for audio
-// EQ biquad filter coefficients" by Robert Bristow-Johnson
-// http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt
-//
-// Implementation note: For the shelf filters, the specified gain is for the
-// reference frequency, which is the centerpoint of the transition band. This
-// better matches EFX filter design. To set the gain for the shelf itself, use
-// the square root of the desired linear gain (or halve the dB gain).
-struct FilterState
-{
-    float x_[2]; // History of two last input samples
-    float y_[2]; // History of two last output samples
+    template<typename T>
+    void read(
+        T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Expected a trivially copyable type.");
 
-    // Transfer function coefficients "b"
-    float b0_;
-    float b1_;
-    float b2_;
+        read_bytes(is_validating_ ? nullptr : &value, static_cast<int>(sizeof(T)));
+    }
 
-    // Transfer function coefficients "a" (a0 is pre-applied)
-    float a1_;
-    float a2_;
+    // Reads a value, and fails if it differs from the expected one.
+    template<typename T>
+    void expect(
+        const T& value)
+    {
+        auto stored_value = T{};
 
+        read_bytes(&stored_value, static_cast<int>(sizeof(T)));
 
-    void reset()
+        if (stored_value != value)
+        {
+            fail();
+        }
+    }
+
+    // Reads an index into (count) items, where an empty range takes zero.
+    //
+    // Returns the index even if validating, or zero on failure.
+    int read_index(
+        const int count)
     {
-        x_[0] = 0.0F;
-        x_[1] = 0.0F;
+        auto index = 0;
 
-        y_[0] = 0.0F;
-        y_[1] = 0.0F;
+        read_bytes(&index, static_cast<int>(sizeof(int)));
 
-        b0_ = 0.0F;
-        b1_ = 0.0F;
-        b2_ = 0.0F;
+        if (index < 0 || index > std::max(count - 1, 0))
+        {
+            fail();
+        }
 
-        a1_ = 0.0F;
-        a2_ = 0.0F;
+        return is_failed_ ? 0 : index;
     }
 
-    void clear()
+    void read_index(
+        int& value,
+        const int count)
     {
-        x_[0] = 0.0F;
-        x_[1] = 0.0F;
-        y_[0] = 0.0F;
-        y_[1] = 0.0F;
+        const auto index = read_index(count);
+
+        if (!is_failed_ && !is_validating_)
+        {
+            value = index;
+        }
     }
 
-    void set_params(
-        const FilterType type,
-        const float gain,
-        const float freq_mult,
-        const float rcp_q)
+    void read_samples(
+        float* samples,
+        const int sample_count)
     {
-        // Limit gain to -100dB
-        assert(gain > 0.00001F);
+        expect(sample_count);
 
+        for (int i = 0; i < sample_count && !is_failed_; )
+        {
+            auto silence_count = 0;
+            auto sound_count = 0;
 
-        const auto w0 = Math::tau * freq_mult;
-        const auto sin_w0 = std::sin(w0);
-        const auto cos_w0 = std::cos(w0);
-        const auto alpha = sin_w0 / 2.0F * rcp_q;
+            read_bytes(&silence_count, static_cast<int>(sizeof(int)));
+            read_bytes(&sound_count, static_cast<int>(sizeof(int)));
 
-        auto sqrt_gain_alpha_2 = 0.0F;
+            if (silence_count < 0 || sound_count < 0 || (silence_count + sound_count) == 0 ||
+                silence_count > (sample_count - i) || sound_count > (sample_count - i - silence_count))
+            {
+                fail();
+                break;
+            }
 
-        float a[3];
-        float b[3];
+            if (!is_validating_)
+            {
+                std::fill_n(&samples[i], silence_count, 0.0F);
+            }
 
+            i += silence_count;
 
-        // Calculate filter coefficients depending on filter type
-        switch (type)
+            read_bytes(is_validating_ ? nullptr : &samples[i], sound_count * static_cast<int>(sizeof(float)));
+            i += sound_count;
+        }
+    }
+
+
+private:
+    const unsigned char* bytes_;
+    int byte_count_;
+    int offset_;
+    bool is_validating_;
+    bool is_failed_;
+
+
+    // Skips the bytes if (dst_bytes) is null.
+    void read_bytes(
+        void* dst_bytes,
+        const int byte_count)
+    {
+        if (is_failed_ || byte_count > (byte_count_ - offset_))
         {
-        case FilterType::high_shelf:
-            sqrt_gain_alpha_2 = 2.0F * std::sqrt(gain) * alpha;
+            is_failed_ = true;
+            return;
+        }
 
-            b[0] = gain * ((gain + 1.0F) + ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2);
-            b[1] = -2.0F * gain * ((gain - 1.0F) + ((gain + 1.0F) * cos_w0));
-            b[2] = gain * ((gain + 1.0F) + ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2);
+        if (dst_bytes && byte_count > 0)
+        {
+            std::memcpy(dst_bytes, &bytes_[offset_], byte_count);
+        }
 
-            a[0] = (gain + 1.0F) - ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2;
-            a[1] = 2.0F * ((gain - 1.0F) - ((gain + 1.0F) * cos_w0));
-            a[2] = (gain + 1.0F) - ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2;
+        offset_ += byte_count;
+    }
+}; // StateReader
 
-            break;
 
-        case FilterType::low_shelf:
-            sqrt_gain_alpha_2 = 2.0F * std::sqrt(gain) * alpha;
+struct FilterState;
 
-            b[0] = gain * ((gain + 1.0F) - ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2);
-            b[1] = 2.0F * gain * ((gain - 1.0F) - ((gain + 1.0F) * cos_w0));
-            b[2] = gain * ((gain + 1.0F) - ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2);
+// The kernels of the hot DSP loops, with a variant per instruction set.
+//
+// The variants are selected by the instruction sets the CPU supports at run
+// time, once per process on the first initialization. The selection is never
+// changed afterwards, so the instances mixing on other threads read the same
+// kernels all along.
+//
+// The reverb's all-pass and scatter steps are not dispatched. They work on one
+// frame of the four lines, a single Float4, and each frame depends on the one
+// before, so a call per frame would cost more than a wider vector saves. The
+// wider vectors serve the late lines through EffectBatch instead, one instance
+// per lane.
+struct Kernels
+{
+    using FilterBlockFunc = void (*)(
+        FilterState& filter,
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples);
 
-            a[0] = (gain + 1.0F) + ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2;
-            a[1] = -2.0F * ((gain - 1.0F) + ((gain + 1.0F) * cos_w0));
-            a[2] = (gain + 1.0F) + ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2;
+    using MixFunc = void (*)(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const int sample_count);
 
-            break;
+    using MixRampFunc = void (*)(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float step,
+        const int sample_count);
 
-        case FilterType::peaking:
-        {
-            const auto sqrt_gain = std::sqrt(gain);
+    using GatherFunc = void (*)(
+        const float* src_samples,
+        const int* indices,
+        float* dst_samples,
+        const float gain,
+        const int sample_count);
 
-            b[0] = 1.0F + (alpha * sqrt_gain);
-            b[1] = -2.0F * cos_w0;
-            b[2] = 1.0F - (alpha * sqrt_gain);
+    using WaveshapeFunc = void (*)(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float knee,
+        const int sample_count);
 
-            a[0] = 1.0F + (alpha / sqrt_gain);
-            a[1] = -2.0F * cos_w0;
-            a[2] = 1.0F - (alpha / sqrt_gain);
+    using WriteInterleavedFunc = void (*)(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count);
 
-            break;
-        }
 
-        case FilterType::low_pass:
-            b[0] = (1.0F - cos_w0) / 2.0F;
-            b[1] = 1.0F - cos_w0;
-            b[2] = (1.0F - cos_w0) / 2.0F;
+    SimdLevel simd_level_;
 
-            a[0] = 1.0F + alpha;
-            a[1] = -2.0F * cos_w0;
-            a[2] = 1.0F - alpha;
+    // Block-parallel filter evaluation; null to evaluate serially.
+    FilterBlockFunc filter_block_;
 
-            break;
+    MixFunc mix_;
+    MixRampFunc mix_ramp_;
+    GatherFunc gather_;
+    WaveshapeFunc waveshape_;
+    WriteInterleavedFunc write_interleaved_;
 
-        case FilterType::high_pass:
-            b[0] = (1.0F + cos_w0) / 2.0F;
-            b[1] = -(1.0F + cos_w0);
-            b[2] = (1.0F + cos_w0) / 2.0F;
 
-            a[0] = 1.0F + alpha;
-            a[1] = -2.0F * cos_w0;
-            a[2] = 1.0F - alpha;
+    static Kernels current;
+    static std::atomic<SimdLevel> max_simd_level;
 
-            break;
+    // Set once the selection has read the maximum level.
+    static std::atomic<bool> is_selected;
 
-        case FilterType::band_pass:
-            b[0] = alpha;
-            b[1] = 0;
-            b[2] = -alpha;
 
-            a[0] = 1.0F + alpha;
-            a[1] = -2.0F * cos_w0;
-            a[2] = 1.0F - alpha;
+    static SimdLevel get_cpu_simd_level();
 
-            break;
+    // Selects the kernels, unless they are selected already.
+    static void select();
 
-        default:
-            b[0] = 1.0F;
-            b[1] = 0.0F;
-            b[2] = 0.0F;
 
-            a[0] = 1.0F;
-            a[1] = 0.0F;
-            a[2] = 0.0F;
+private:
+    static void select_once();
+}; // Kernels
 
-            break;
-        }
 
-        a1_ = a[1] / a[0];
-        a2_ = a[2] / a[0];
-        b0_ = b[0] / a[0];
-        b1_ = b[1] / a[0];
-        b2_ = b[2] / a[0];
-    }
+struct AmbiConfig
+{
+    using Coeffs = std::array<ChannelConfig, max_channels>;
 
-    void process(
-        const int sample_count,
-        const float* src_samples,
-        float* dst_samples)
+
+    // Ambisonic coefficients for mixing to the dry buffer.
+    Coeffs coeffs_;
+
+    void reset()
     {
-        if (sample_count > 1)
+        for (auto& coeff : coeffs_)
         {
-            dst_samples[0] =
-                (b0_ * src_samples[0]) +
-                (b1_ * x_[0]) +
-                (b2_ * x_[1]) -
-                (a1_ * y_[0]) -
-                (a2_ * y_[1]);
+            coeff.fill(0.0F);
+        }
+    }
+}; // AmbiConfig
 
-            dst_samples[1] =
-                (b0_ * src_samples[1]) +
-                (b1_ * src_samples[0]) +
-                (b2_ * x_[0]) -
-                (a1_ * dst_samples[0]) -
-                (a2_ * y_[0]);
+struct AmbiOutput
+{
+    AmbiConfig ambi_;
 
-            auto i = 0;
+    // Number of coefficients in each Ambi.Coeffs to mix together (4 for
+    // first-order, 9 for second-order, etc). If the count is 0, Ambi.Map
+    // is used instead to map each output to a coefficient index.
+    //
+    // Will only be 4 or 0 (first-order ambisonics output).
+    int coeff_count_;
+}; // AmbiOutput
 
-            for (i = 2; i < sample_count; ++i)
-            {
-                dst_samples[i] =
-                    (b0_ * src_samples[i]) +
-                    (b1_ * src_samples[i - 1]) +
-                    (b2_ * src_samples[i - 2]) -
-                    (a1_ * dst_samples[i - 1]) -
-                    (a2_ * dst_samples[i - 2]);
-            }
+struct ChannelPanning
+{
+    ChannelId name_;
+    ChannelConfig config_;
+}; // ChannelPanning
 
-            x_[0] = src_samples[i - 1];
-            x_[1] = src_samples[i - 2];
-            y_[0] = dst_samples[i - 1];
-            y_[1] = dst_samples[i - 2];
-        }
-        else if (sample_count == 1)
+struct Panning
+{
+    static constexpr ChannelPanning mono_panning[1] =
+    {
         {
-            dst_samples[0] =
-                (b0_ * src_samples[0]) +
-                (b1_ * x_[0]) +
-                (b2_ * x_[1]) -
-                (a1_ * y_[0]) -
-                (a2_ * y_[1]);
-
-            x_[1] = x_[0];
-            x_[0] = src_samples[0];
-            y_[1] = y_[0];
-            y_[0] = dst_samples[0];
-        }
-    }
+            ChannelId::front_center,
+            {1.0F},
+        },
+    };
 
-    void process_pass_through(
-        const int sample_count,
-        const float* src_samples)
+    static constexpr ChannelPanning stereo_panning[2] =
     {
-        if (sample_count >= 2)
         {
-            x_[1] = src_samples[sample_count - 2];
-            x_[0] = src_samples[sample_count - 1];
-            y_[1] = src_samples[sample_count - 2];
-            y_[0] = src_samples[sample_count - 1];
-        }
-        else if (sample_count == 1)
-        {
-            x_[1] = x_[0];
-            x_[0] = src_samples[0];
-            y_[1] = y_[0];
-            y_[0] = src_samples[0];
-        }
-    }
-
+            ChannelId::front_left,
+            {5.00000000E-1F, 2.88675135E-1F, 0.0F, 1.19573156E-1F,}
+        },
 
-    static void copy_params(
-        const FilterState& src_state,
-        FilterState& dst_state)
-    {
-        dst_state.b0_ = src_state.b0_;
-        dst_state.b1_ = src_state.b1_;
-        dst_state.b2_ = src_state.b2_;
-        dst_state.a1_ = src_state.a1_;
-        dst_state.a2_ = src_state.a2_;
-    }
+        {
+            ChannelId::front_right,
+            {5.00000000E-1F, -2.88675135E-1F, 0.0F, 1.19573156E-1F,},
+        },
+    };
 
-    // Calculates the rcpQ (i.e. 1/Q) coefficient for shelving filters, using the
-    // reference gain and shelf slope parameter.
-    // 0 < gain
-    // 0 < slope <= 1
-    static float calc_rcp_q_from_slope(
-        const float gain,
-        const float slope)
+    static constexpr ChannelPanning quad_panning[4] =
     {
-        return std::sqrt((gain + (1.0F / gain)) * ((1.0F / slope) - 1.0F) + 2.0F);
-    }
+        {
+            ChannelId::back_left,
+            {3.53553391E-1F, 2.04124145E-1F, 0.0F, -2.04124145E-1F,},
+        },
 
-    // Calculates the rcpQ (i.e. 1/Q) coefficient for filters, using the frequency
-    // multiple (i.e. ref_freq / sampling_freq) and bandwidth.
-    // 0 < freq_mult < 0.5.
-    static float calc_rcp_q_from_bandwidth(
-        const float freq_mult,
-        const float bandwidth)
-    {
-        const auto w0 = Math::tau * freq_mult;
-        return 2.0F * std::sinh(std::log(2.0F) / 2.0F * bandwidth * w0 / std::sin(w0));
-    }
-}; // FilterState
+        {
+            ChannelId::front_left,
+            {3.53553391E-1F, 2.04124145E-1F, 0.0F, 2.04124145E-1F,},
+        },
 
-struct Source
-{
-    struct Send
-    {
-        struct Channel
         {
-            FilterState low_pass_;
-            FilterState high_pass_;
-            Gains current_gains_;
-            Gains target_gains_;
+            ChannelId::front_right,
+            {3.53553391E-1F, -2.04124145E-1F, 0.0F, 2.04124145E-1F,},
+        },
 
+        {
+            ChannelId::back_right,
+            {3.53553391E-1F, -2.04124145E-1F, 0.0F, -2.04124145E-1F,},
+        },
+    };
 
-            void reset()
-            {
-                low_pass_.reset();
-                high_pass_.reset();
+    static constexpr ChannelPanning x5_1_side_panning[5] =
+    {
+        {
+            ChannelId::side_left,
+            {3.33001372E-1F, 1.89085671E-1F, 0.0F, -2.00041334E-1F, -2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
+        },
 
-                current_gains_.fill(0.0F);
-                target_gains_.fill(0.0F);
-            }
-        }; // Channel
+        {
+            ChannelId::front_left,
+            {1.47751298E-1F, 1.28994110E-1F, 0.0F, 1.15190495E-1F, 7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
+        },
 
-        using Channels = std::array<Channel, max_channels>;
+        {
+            ChannelId::front_center,
+            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
+        },
 
+        {
+            ChannelId::front_right,
+            {1.47751298E-1F, -1.28994110E-1F, 0.0F, 1.15190495E-1F, -7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
+        },
 
-        SendProps props_;
-        SendProps deferred_props_;
+        {
+            ChannelId::side_right,
+            {3.33001372E-1F, -1.89085671E-1F, 0.0F, -2.00041334E-1F, 2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
+        },
+    };
 
-        ActiveFilters filter_type_;
-        Channels channels_;
-        SampleBuffers* buffers_;
-        int channel_count_;
-    }; // Send
+    static constexpr ChannelPanning x5_1_rear_panning[5] =
+    {
+        {
+            ChannelId::back_left,
+            {3.33001372E-1F, 1.89085671E-1F, 0.0F, -2.00041334E-1F, -2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
+        },
 
-    using Sends = std::vector<Send>;
+        {
+            ChannelId::front_left,
+            {1.47751298E-1F, 1.28994110E-1F, 0.0F, 1.15190495E-1F, 7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
+        },
 
+        {
+            ChannelId::front_center,
+            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
+        },
 
-    Send direct_;
-    Sends auxes_;
-    bool are_props_changed_;
+        {
+            ChannelId::front_right,
+            {1.47751298E-1F, -1.28994110E-1F, 0.0F, 1.15190495E-1F, -7.44949143E-2F, 0.0F, 0.0F, 0.0F, -6.47739980E-3F,},
+        },
 
+        {
+            ChannelId::back_right,
+            {3.33001372E-1F, -1.89085671E-1F, 0.0F, -2.00041334E-1F, 2.12309737E-2F, 0.0F, 0.0F, 0.0F, -1.14573483E-2F,},
+        },
+    };
 
-    void initialize(
-        const int effect_count)
+    static constexpr ChannelPanning x6_1_panning[6] =
     {
-        direct_.props_.set_defaults();
-        direct_.deferred_props_.set_defaults();
-
-        auxes_.clear();
-        auxes_.resize(effect_count);
+        {
+            ChannelId::side_left,
+            {2.04462744E-1F, 2.17178497E-1F, 0.0F, -4.39990188E-2F, -2.60787329E-2F, 0.0F, 0.0F, 0.0F, -6.87238843E-2F,},
+        },
 
-        for (auto& aux : auxes_)
         {
-            aux.props_.set_defaults();
-            aux.deferred_props_.set_defaults();
-        }
+            ChannelId::front_left,
+            {1.18130342E-1F, 9.34633906E-2F, 0.0F, 1.08553749E-1F, 6.80658795E-2F, 0.0F, 0.0F, 0.0F, 1.08999485E-2F,},
+        },
 
-        are_props_changed_ = true;
-    }
-}; // Source
+        {
+            ChannelId::front_center,
+            {7.73595729E-2F, 0.0F, 0.0F, 9.71390298E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 5.18625335E-2F,},
+        },
 
+        {
+            ChannelId::front_right,
+            {1.18130342E-1F, -9.34633906E-2F, 0.0F, 1.08553749E-1F, -6.80658795E-2F, 0.0F, 0.0F, 0.0F, 1.08999485E-2F,},
+        },
 
-// ==========================================================================
-// EffectProps
+        {
+            ChannelId::side_right,
+            {2.04462744E-1F, -2.17178497E-1F, 0.0F, -4.39990188E-2F, 2.60787329E-2F, 0.0F, 0.0F, 0.0F, -6.87238843E-2F,},
+        },
+
+        {
+            ChannelId::back_center,
+            {2.50001688E-1F, 0.0F, 0.0F, -2.50000094E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 6.05133395E-2F,},
+        },
+    };
+
+    static constexpr ChannelPanning x7_1_panning[6] =
+    {
+        {
+            ChannelId::back_left,
+            {
+                2.04124145E-1F, 1.08880247E-1F, 0.0F, -1.88586120E-1F, -1.29099444E-1F, 0.0F, 0.0F, 0.0F,
+                7.45355993E-2F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+
+        {
+            ChannelId::side_left,
+            {
+                2.04124145E-1F, 2.17760495E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+                -1.49071198E-1F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+
+        {
+            ChannelId::front_left,
+            {
+                2.04124145E-1F, 1.08880247E-1F, 0.0F, 1.88586120E-1F, 1.29099444E-1F, 0.0F, 0.0F, 0.0F,
+                7.45355993E-2F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+
+        {
+            ChannelId::front_right,
+            {
+                2.04124145E-1F, -1.08880247E-1F, 0.0F, 1.88586120E-1F, -1.29099444E-1F, 0.0F, 0.0F, 0.0F,
+                7.45355993E-2F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+
+        {
+            ChannelId::side_right,
+            {
+                2.04124145E-1F, -2.17760495E-1F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+                -1.49071198E-1F, 3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+
+        {
+            ChannelId::back_right,
+            {
+                2.04124145E-1F, -1.08880247E-1F, 0.0F, -1.88586120E-1F, 1.29099444E-1F, 0.0F, 0.0F, 0.0F,
+                7.45355993E-2F, -3.73460789E-2F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+            },
+        },
+    };
+
+
+    // Calculates ambisonic coefficients based on a direction vector. The vector
+    // must be normalized (unit length), and the spread is the angular width of the
+    // sound (0...tau).
+    static void calc_direction_coeffs(
+        const float dir[3],
+        const float spread,
+        AmbiCoeffs& coeffs)
+    {
+        // Convert from OpenAL coords to Ambisonics.
+        const auto x = -dir[2];
+        const auto y = -dir[0];
+        const auto z = dir[1];
+
+        // Zeroth-order
+        coeffs[0] = 1.0F; // ACN 0 = 1
+
+        // First-order
+        coeffs[1] = 1.732050808F * y; // ACN 1 = sqrt(3) * Y
+        coeffs[2] = 1.732050808F * z; // ACN 2 = sqrt(3) * Z
+        coeffs[3] = 1.732050808F * x; // ACN 3 = sqrt(3) * X
+
+        // Second-order
+        coeffs[4] = 3.872983346F * x * y; // ACN 4 = sqrt(15) * X * Y
+        coeffs[5] = 3.872983346F * y * z; // ACN 5 = sqrt(15) * Y * Z
+        coeffs[6] = 1.118033989F * ((3.0F * z * z) - 1.0F); // ACN 6 = sqrt(5)/2 * (3*Z*Z - 1)
+        coeffs[7] = 3.872983346F * x * z; // ACN 7 = sqrt(15) * X * Z
+        coeffs[8] = 1.936491673F * ((x * x) - (y * y)); // ACN 8 = sqrt(15)/2 * (X*X - Y*Y)
+
+        // Third-order
+        coeffs[9] = 2.091650066F * y * ((3.0F * x * x) - (y * y)); // ACN  9 = sqrt(35/8) * Y * (3*X*X - Y*Y)
+        coeffs[10] = 10.246950766F * z * x * y; // ACN 10 = sqrt(105) * Z * X * Y
+        coeffs[11] = 1.620185175F * y * ((5.0F * z * z) - 1.0F); // ACN 11 = sqrt(21/8) * Y * (5*Z*Z - 1)
+        coeffs[12] = 1.322875656F * z * ((5.0F * z * z) - 3.0F); // ACN 12 = sqrt(7)/2 * Z * (5*Z*Z - 3)
+        coeffs[13] = 1.620185175F * x * ((5.0F * z * z) - 1.0F); // ACN 13 = sqrt(21/8) * X * (5*Z*Z - 1)
+        coeffs[14] = 5.123475383F * z * ((x * x) - (y * y)); // ACN 14 = sqrt(105)/2 * Z * (X*X - Y*Y)
+        coeffs[15] = 2.091650066F * x * ((x * x) - (3.0F * y * y)); // ACN 15 = sqrt(35/8) * X * (X*X - 3*Y*Y)
+
+        if (spread > 0.0F)
+        {
+            // Implement the spread by using a spherical source that subtends the
+            // angle spread. See:
+            // http://www.ppsloan.org/publications/StupidSH36.pdf - Appendix A3
+            //
+            // When adjusted for N3D normalization instead of SN3D, these
+            // calculations are:
+            //
+            // ZH0 = -sqrt(pi) * (-1+ca);
+            // ZH1 =  0.5*sqrt(pi) * sa*sa;
+            // ZH2 = -0.5*sqrt(pi) * ca*(-1+ca)*(ca+1);
+            // ZH3 = -0.125*sqrt(pi) * (-1+ca)*(ca+1)*(5*ca*ca - 1);
+            // ZH4 = -0.125*sqrt(pi) * ca*(-1+ca)*(ca+1)*(7*ca*ca - 3);
+            // ZH5 = -0.0625*sqrt(pi) * (-1+ca)*(ca+1)*(21*ca*ca*ca*ca - 14*ca*ca + 1);
+            //
+            // The gain of the source is compensated for size, so that the
+            // loundness doesn't depend on the spread. Thus:
+            //
+            // ZH0 = 1.0f;
+            // ZH1 = 0.5f * (ca+1.0f);
+            // ZH2 = 0.5f * (ca+1.0f)*ca;
+            // ZH3 = 0.125f * (ca+1.0f)*(5.0f*ca*ca - 1.0f);
+            // ZH4 = 0.125f * (ca+1.0f)*(7.0f*ca*ca - 3.0f)*ca;
+            // ZH5 = 0.0625f * (ca+1.0f)*(21.0f*ca*ca*ca*ca - 14.0f*ca*ca + 1.0f);
+
+            const auto ca = std::cos(spread * 0.5F);
+
+            // Increase the source volume by up to +3dB for a full spread.
+            const auto scale = std::sqrt(1.0F + (spread / Math::tau));
+
+            const auto zh0_norm = scale;
+            const auto zh1_norm = 0.5F * (ca + 1.0F) * scale;
+            const auto zh2_norm = 0.5F * (ca + 1.0F) * ca * scale;
+            const auto zh3_norm = 0.125F * (ca + 1.0F) * ((5.0F * ca * ca) - 1.0F) * scale;
+
+            // Zeroth-order
+            coeffs[0] *= zh0_norm;
+
+            // First-order
+            coeffs[1] *= zh1_norm;
+            coeffs[2] *= zh1_norm;
+            coeffs[3] *= zh1_norm;
+
+            // Second-order
+            coeffs[4] *= zh2_norm;
+            coeffs[5] *= zh2_norm;
+            coeffs[6] *= zh2_norm;
+            coeffs[7] *= zh2_norm;
+            coeffs[8] *= zh2_norm;
+
+            // Third-order
+            coeffs[9] *= zh3_norm;
+            coeffs[10] *= zh3_norm;
+            coeffs[11] *= zh3_norm;
+            coeffs[12] *= zh3_norm;
+            coeffs[13] *= zh3_norm;
+            coeffs[14] *= zh3_norm;
+            coeffs[15] *= zh3_norm;
+        }
+    }
+
+
+    // Calculates ambisonic coefficients based on azimuth and elevation. The
+    // azimuth and elevation parameters are in radians, going right and up
+    // respectively.
+    static void calc_angle_coeffs(
+        const float azimuth,
+        const float elevation,
+        const float spread,
+        AmbiCoeffs& coeffs)
+    {
+        const float dir[3] =
+        {
+            std::sin(azimuth) * std::cos(elevation),
+            std::sin(elevation),
+            -std::cos(azimuth) * std::cos(elevation),
+        };
+
+        calc_direction_coeffs(dir, spread, coeffs);
+    }
+
+    // Computes channel gains for ambient, omni-directional sounds.
+    static void compute_ambient_gains(
+        const int channel_count,
+        const AmbiOutput& amb_output,
+        const float in_gain,
+        Gains& out_gains)
+    {
+        if (amb_output.coeff_count_ > 0)
+        {
+            compute_ambient_gains_mc(amb_output.ambi_.coeffs_.data(), channel_count, in_gain, out_gains);
+        }
+        else
+        {
+            compute_ambient_gains_bf(channel_count, in_gain, out_gains);
+        }
+    }
+
+    static void compute_ambient_gains_mc(
+        const ChannelConfig* channel_coeffs,
+        const int channel_count,
+        const float src_gain,
+        Gains& dst_gains)
+    {
+        for (int i = 0; i < max_channels; ++i)
+        {
+            dst_gains[i] = (i < channel_count ? channel_coeffs[i][0] * 1.414213562F * src_gain : 0.0F);
+        }
+    }
+
+    static void compute_ambient_gains_bf(
+        const int channel_count,
+        const float src_gain,
+        Gains& dst_gains)
+    {
+        static_cast<void>(channel_count);
+
+        for (int i = 0; i < max_channels; ++i)
+        {
+            dst_gains[i] = (i == 0 ? 1.414213562F * src_gain : 0.0F);
+        }
+    }
+
+    // Computes panning gains using the given channel decoder coefficients and the
+    // pre-calculated direction or angle coefficients.
+    static void compute_panning_gains(
+        const int channel_count,
+        const AmbiOutput& amb_output,
+        const AmbiCoeffs& coeffs,
+        const float in_gain,
+        Gains& out_gains)
+    {
+        if (amb_output.coeff_count_ > 0)
+        {
+            compute_panning_gains_mc(
+                amb_output.ambi_.coeffs_.data(),
+                channel_count,
+                amb_output.coeff_count_,
+                coeffs,
+                in_gain,
+                out_gains);
+        }
+        else
+        {
+            compute_panning_gains_bf(
+                channel_count,
+                coeffs,
+                in_gain,
+                out_gains);
+        }
+    }
+
+    static void compute_panning_gains_mc(
+        const ChannelConfig* channel_coeffs,
+        const int channel_count,
+        const int coeff_count,
+        const AmbiCoeffs& coeffs,
+        const float src_gain,
+        Gains& dst_gains)
+    {
+        for (int i = 0; i < max_channels; ++i)
+        {
+            if (i < channel_count)
+            {
+                auto gain = 0.0F;
+
+                for (int j = 0; j < coeff_count; ++j)
+                {
+                    gain += channel_coeffs[i][j] * coeffs[j];
+                }
+
+                dst_gains[i] = Math::clamp(gain, 0.0F, 1.0F) * src_gain;
+            }
+            else
+            {
+                dst_gains[i] = 0.0F;
+            }
+        }
+    }
+
+    static void compute_panning_gains_bf(
+        const int channel_count,
+        const AmbiCoeffs& coeffs,
+        const float src_gain,
+        Gains& dst_gains)
+    {
+        for (int i = 0; i < max_channels; ++i)
+        {
+            dst_gains[i] = (i < channel_count ? coeffs[i] * src_gain : 0.0F);
+        }
+    }
+
+    // Sets channel gains for a first-order ambisonics input channel. The matrix is
+    // a 1x4 'slice' of a transform matrix for the input channel, used to scale and
+    // orient the sound samples.
+    static void compute_first_order_gains(
+        const int channel_count,
+        const AmbiOutput& amb_output,
+        const float* const matrix,
+        const float in_gain,
+        Gains& out_gains)
+    {
+        if (amb_output.coeff_count_ > 0)
+        {
+            compute_first_order_gains_mc(amb_output.ambi_.coeffs_.data(), channel_count, matrix, in_gain, out_gains);
+        }
+        else
+        {
+            compute_first_order_gains_bf(channel_count, matrix, in_gain, out_gains);
+        }
+    }
+
+    static void compute_first_order_gains_mc(
+        const ChannelConfig* channel_coeffs,
+        int channel_count,
+        const float matrix[4],
+        float src_gain,
+        Gains& dst_gains)
+    {
+        for (int i = 0; i < max_channels; ++i)
+        {
+            if (i < channel_count)
+            {
+                auto gain = 0.0F;
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    gain += channel_coeffs[i][j] * matrix[j];
+                }
+
+                dst_gains[i] = Math::clamp(gain, 0.0F, 1.0F) * src_gain;
+            }
+            else
+            {
+                dst_gains[i] = 0.0F;
+            }
+        }
+    }
+
+    static void compute_first_order_gains_bf(
+        const int channel_count,
+        const float matrix[4],
+        const float src_gain,
+        Gains& dst_gains)
+    {
+        for (int i = 0; i < max_channels; ++i)
+        {
+            dst_gains[i] = (i < channel_count ? matrix[i] * src_gain : 0.0F);
+        }
+    }
+
+    static void set_channel_map(
+        const ChannelId* device_channels,
+        ChannelConfig* ambi_coeffs,
+        const ChannelPanning* channel_panning,
+        const int count,
+        int* out_count)
+    {
+        int i;
+
+        for (i = 0; i < max_channels && device_channels[i] != ChannelId::none; ++i)
+        {
+            if (device_channels[i] == ChannelId::lfe)
+            {
+                for (int j = 0; j < max_ambi_coeffs; ++j)
+                {
+                    ambi_coeffs[i][j] = 0.0F;
+                }
+
+                continue;
+            }
+
+            for (int j = 0; j < count; ++j)
+            {
+                if (device_channels[i] != channel_panning[j].name_)
+                {
+                    continue;
+                }
+
+                for (int k = 0; k < max_ambi_coeffs; ++k)
+                {
+                    ambi_coeffs[i][k] = channel_panning[j].config_[k];
+                }
+
+                break;
+            }
+        }
+
+        *out_count = i;
+    }
+}; // Panning
+
+constexpr ChannelPanning Panning::mono_panning[1];
+constexpr ChannelPanning Panning::stereo_panning[2];
+constexpr ChannelPanning Panning::quad_panning[4];
+constexpr ChannelPanning Panning::x5_1_side_panning[5];
+constexpr ChannelPanning Panning::x5_1_rear_panning[5];
+constexpr ChannelPanning Panning::x6_1_panning[6];
+constexpr ChannelPanning Panning::x7_1_panning[6];
+
+// Filters implementation is based on the "Cookbook formulae for audio
+// EQ biquad filter coefficients" by Robert Bristow-Johnson
+// http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt
+//
+// Implementation note: For the shelf filters, the specified gain is for the
+// reference frequency, which is the centerpoint of the transition band. This
+// better matches EFX filter design. To set the gain for the shelf itself, use
+// the square root of the desired linear gain (or halve the dB gain).
+struct FilterState
+{
+    // The minimum block size to evaluate in parallel sub-blocks.
+    static constexpr auto min_block_samples = 128;
+
+    // The maximum block size evaluated at once in parallel sub-blocks.
+    static constexpr auto max_block_samples = 1024;
+
+    // The maximum pole radius to evaluate in parallel sub-blocks.
+    //
+    // The correction applied to a sub-block grows with the pole radius, and so
+    // does the rounding error; past this radius the serial evaluation is used.
+    static constexpr auto max_block_pole_radius = 0.9F;
+
+    // The magnitude below which the homogeneous response is treated as zero.
+    static constexpr auto min_response = 1.0E-9F;
+
+
+    float x_[2]; // History of two last input samples
+    float y_[2]; // History of two last output samples
+
+    // Transfer function coefficients "b"
+    float b0_;
+    float b1_;
+    float b2_;
+
+    // Transfer function coefficients "a" (a0 is pre-applied)
+    float a1_;
+    float a2_;
+
+
+    void reset()
+    {
+        x_[0] = 0.0F;
+        x_[1] = 0.0F;
+
+        y_[0] = 0.0F;
+        y_[1] = 0.0F;
+
+        b0_ = 0.0F;
+        b1_ = 0.0F;
+        b2_ = 0.0F;
+
+        a1_ = 0.0F;
+        a2_ = 0.0F;
+    }
+
+    void clear()
+    {
+        x_[0] = 0.0F;
+        x_[1] = 0.0F;
+        y_[0] = 0.0F;
+        y_[1] = 0.0F;
+    }
+
+    // Saves the history. The coefficients follow from the properties.
+    void save_state(
+        StateWriter& writer) const
+    {
+        writer.write(x_);
+        writer.write(y_);
+    }
+
+    void load_state(
+        StateReader& reader)
+    {
+        reader.read(x_);
+        reader.read(y_);
+    }
+
+    void set_params(
+        const FilterType type,
+        const float gain,
+        const float freq_mult,
+        const float rcp_q)
+    {
+        // Limit gain to -100dB
+        assert(gain > 0.00001F);
+
+
+        const auto w0 = Math::tau * freq_mult;
+        const auto sin_w0 = std::sin(w0);
+        const auto cos_w0 = std::cos(w0);
+        const auto alpha = sin_w0 / 2.0F * rcp_q;
+
+        auto sqrt_gain_alpha_2 = 0.0F;
+
+        float a[3];
+        float b[3];
+
+
+        // Calculate filter coefficients depending on filter type
+        switch (type)
+        {
+        case FilterType::high_shelf:
+            sqrt_gain_alpha_2 = 2.0F * std::sqrt(gain) * alpha;
+
+            b[0] = gain * ((gain + 1.0F) + ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2);
+            b[1] = -2.0F * gain * ((gain - 1.0F) + ((gain + 1.0F) * cos_w0));
+            b[2] = gain * ((gain + 1.0F) + ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2);
+
+            a[0] = (gain + 1.0F) - ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2;
+            a[1] = 2.0F * ((gain - 1.0F) - ((gain + 1.0F) * cos_w0));
+            a[2] = (gain + 1.0F) - ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2;
+
+            break;
+
+        case FilterType::low_shelf:
+            sqrt_gain_alpha_2 = 2.0F * std::sqrt(gain) * alpha;
+
+            b[0] = gain * ((gain + 1.0F) - ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2);
+            b[1] = 2.0F * gain * ((gain - 1.0F) - ((gain + 1.0F) * cos_w0));
+            b[2] = gain * ((gain + 1.0F) - ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2);
+
+            a[0] = (gain + 1.0F) + ((gain - 1.0F) * cos_w0) + sqrt_gain_alpha_2;
+            a[1] = -2.0F * ((gain - 1.0F) + ((gain + 1.0F) * cos_w0));
+            a[2] = (gain + 1.0F) + ((gain - 1.0F) * cos_w0) - sqrt_gain_alpha_2;
+
+            break;
+
+        case FilterType::peaking:
+        {
+            const auto sqrt_gain = std::sqrt(gain);
+
+            b[0] = 1.0F + (alpha * sqrt_gain);
+            b[1] = -2.0F * cos_w0;
+            b[2] = 1.0F - (alpha * sqrt_gain);
+
+            a[0] = 1.0F + (alpha / sqrt_gain);
+            a[1] = -2.0F * cos_w0;
+            a[2] = 1.0F - (alpha / sqrt_gain);
+
+            break;
+        }
+
+        case FilterType::low_pass:
+            b[0] = (1.0F - cos_w0) / 2.0F;
+            b[1] = 1.0F - cos_w0;
+            b[2] = (1.0F - cos_w0) / 2.0F;
+
+            a[0] = 1.0F + alpha;
+            a[1] = -2.0F * cos_w0;
+            a[2] = 1.0F - alpha;
+
+            break;
+
+        case FilterType::high_pass:
+            b[0] = (1.0F + cos_w0) / 2.0F;
+            b[1] = -(1.0F + cos_w0);
+            b[2] = (1.0F + cos_w0) / 2.0F;
+
+            a[0] = 1.0F + alpha;
+            a[1] = -2.0F * cos_w0;
+            a[2] = 1.0F - alpha;
+
+            break;
+
+        case FilterType::band_pass:
+            b[0] = alpha;
+            b[1] = 0;
+            b[2] = -alpha;
+
+            a[0] = 1.0F + alpha;
+            a[1] = -2.0F * cos_w0;
+            a[2] = 1.0F - alpha;
+
+            break;
+
+        default:
+            b[0] = 1.0F;
+            b[1] = 0.0F;
+            b[2] = 0.0F;
+
+            a[0] = 1.0F;
+            a[1] = 0.0F;
+            a[2] = 0.0F;
+
+            break;
+        }
+
+        a1_ = a[1] / a[0];
+        a2_ = a[2] / a[0];
+        b0_ = b[0] / a[0];
+        b1_ = b[1] / a[0];
+        b2_ = b[2] / a[0];
+    }
+
+    void process(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        const auto block_func = Kernels::current.filter_block_;
+
+        const auto use_block = (
+            block_func &&
+            sample_count >= min_block_samples &&
+            get_pole_radius() <= max_block_pole_radius);
+
+        for (int base = 0; base < sample_count; )
+        {
+            const auto todo = std::min(sample_count - base, max_block_samples);
+
+            if (use_block && todo >= min_block_samples)
+            {
+                block_func(*this, todo, src_samples + base, dst_samples + base);
+            }
+            else
+            {
+                process_serial(todo, src_samples + base, dst_samples + base);
+            }
+
+            base += todo;
+        }
+    }
+
+    void process_serial(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        if (sample_count > 1)
+        {
+            dst_samples[0] =
+                (b0_ * src_samples[0]) +
+                (b1_ * x_[0]) +
+                (b2_ * x_[1]) -
+                (a1_ * y_[0]) -
+                (a2_ * y_[1]);
+
+            dst_samples[1] =
+                (b0_ * src_samples[1]) +
+                (b1_ * src_samples[0]) +
+                (b2_ * x_[0]) -
+                (a1_ * dst_samples[0]) -
+                (a2_ * y_[0]);
+
+            auto i = 0;
+
+            for (i = 2; i < sample_count; ++i)
+            {
+                dst_samples[i] =
+                    (b0_ * src_samples[i]) +
+                    (b1_ * src_samples[i - 1]) +
+                    (b2_ * src_samples[i - 2]) -
+                    (a1_ * dst_samples[i - 1]) -
+                    (a2_ * dst_samples[i - 2]);
+            }
+
+            x_[0] = src_samples[i - 1];
+            x_[1] = src_samples[i - 2];
+            y_[0] = dst_samples[i - 1];
+            y_[1] = dst_samples[i - 2];
+        }
+        else if (sample_count == 1)
+        {
+            dst_samples[0] =
+                (b0_ * src_samples[0]) +
+                (b1_ * x_[0]) +
+                (b2_ * x_[1]) -
+                (a1_ * y_[0]) -
+                (a2_ * y_[1]);
+
+            x_[1] = x_[0];
+            x_[0] = src_samples[0];
+            y_[1] = y_[0];
+            y_[0] = dst_samples[0];
+        }
+    }
+
+    float get_pole_radius() const
+    {
+        const auto discriminant = (a1_ * a1_) - (4.0F * a2_);
+
+        if (discriminant < 0.0F)
+        {
+            return std::sqrt(a2_);
+        }
+        else
+        {
+            return 0.5F * (std::abs(a1_) + std::sqrt(discriminant));
+        }
+    }
+
+    // Block-parallel evaluation of the filter.
+    //
+    // The feed-forward part is computed for the whole block first. The block is
+    // then split into four sub-blocks of equal length, and the all-pole
+    // recurrence of each is run from a zero state, one sub-block per vector
+    // lane. Every sub-block is finally fixed up with the response to its true
+    // initial state. That state is propagated from one sub-block to the next
+    // through the homogeneous response (g) of the recurrence:
+    //
+    //     y[m] = u[m] + (g[m] * y[-1]) - (a2 * g[m-1] * y[-2]), g[-1] = 1
+    //
+    // Where u is the zero-state response of the sub-block.
+    //
+    // The serial dependency chain becomes a quarter of the block length, while
+    // the remaining passes are independent along time.
+    void process_block_sse2(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        constexpr auto lane_count = 4;
+
+        // Sub-block length; a multiple of four, so sub-blocks can be
+        // transposed in 4x4 tiles.
+        const auto length = (sample_count / (lane_count * 4)) * 4;
+        const auto block_size = length * lane_count;
+
+        // Feed-forward part.
+        dst_samples[0] = (b0_ * src_samples[0]) + (b1_ * x_[0]) + (b2_ * x_[1]);
+        dst_samples[1] = (b0_ * src_samples[1]) + (b1_ * src_samples[0]) + (b2_ * x_[0]);
+        dst_samples[2] = (b0_ * src_samples[2]) + (b1_ * src_samples[1]) + (b2_ * src_samples[0]);
+        dst_samples[3] = (b0_ * src_samples[3]) + (b1_ * src_samples[2]) + (b2_ * src_samples[1]);
+
+        const auto b0 = Float4::set1(b0_);
+        const auto b1 = Float4::set1(b1_);
+        const auto b2 = Float4::set1(b2_);
+
+        for (int i = 4; i < block_size; i += 4)
+        {
+            const auto w = (b0 * Float4::load(&src_samples[i])) +
+                (b1 * Float4::load(&src_samples[i - 1])) +
+                (b2 * Float4::load(&src_samples[i - 2]));
+
+            w.store(&dst_samples[i]);
+        }
+
+        // Homogeneous response (stored shifted by one, so g[-1] is at index zero).
+        //
+        // It decays exponentially, so it's cut to zero once below the precision
+        // of the result.
+        float g[(max_block_samples / lane_count) + 4];
+
+        g[0] = 1.0F;
+        g[1] = -a1_;
+
+        auto i = 0;
+
+        for (i = 2; i <= length; ++i)
+        {
+            g[i] = -(a1_ * g[i - 1]) - (a2_ * g[i - 2]);
+
+            if (std::abs(g[i]) < min_response && std::abs(g[i - 1]) < min_response)
+            {
+                break;
+            }
+        }
+
+        std::fill(&g[std::min(i, length + 1)], &g[length + 1], 0.0F);
+
+        // Zero-state all-pole responses of the sub-blocks.
+        const auto a1 = Float4::set1(a1_);
+        const auto a2 = Float4::set1(a2_);
+
+        auto y1 = Float4::zero();
+        auto y2 = Float4::zero();
+
+        for (int m = 0; m < length; m += 4)
+        {
+            Float4 v[lane_count];
+
+            for (int k = 0; k < lane_count; ++k)
+            {
+                v[k] = Float4::load(&dst_samples[(k * length) + m]);
+            }
+
+            Float4::transpose(v[0], v[1], v[2], v[3]);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                const auto y = (v[j] - (a2 * y2)) - (a1 * y1);
+
+                y2 = y1;
+                y1 = y;
+                v[j] = y;
+            }
+
+            Float4::transpose(v[0], v[1], v[2], v[3]);
+
+            for (int k = 0; k < lane_count; ++k)
+            {
+                v[k].store(&dst_samples[(k * length) + m]);
+            }
+        }
+
+        // Propagate the true initial state through the sub-blocks.
+        float init1[lane_count];
+        float init2[lane_count];
+
+        init1[0] = y_[0];
+        init2[0] = y_[1];
+
+        for (int k = 1; k < lane_count; ++k)
+        {
+            const auto last = (k * length) - 1;
+
+            const auto p1 = init1[k - 1];
+            const auto p2 = init2[k - 1];
+
+            init1[k] = dst_samples[last] + (g[length] * p1) - (a2_ * g[length - 1] * p2);
+            init2[k] = dst_samples[last - 1] + (g[length - 1] * p1) - (a2_ * g[length - 2] * p2);
+        }
+
+        // Fix up the sub-blocks.
+        for (int k = 0; k < lane_count; ++k)
+        {
+            const auto c1 = Float4::set1(init1[k]);
+            const auto c2 = Float4::set1(-a2_ * init2[k]);
+            auto dst = &dst_samples[k * length];
+
+            for (int m = 0; m < length; m += 4)
+            {
+                const auto fixed = Float4::load(&dst[m]) +
+                    (c1 * Float4::load(&g[m + 1])) +
+                    (c2 * Float4::load(&g[m]));
+
+                fixed.store(&dst[m]);
+            }
+        }
+
+        x_[0] = src_samples[block_size - 1];
+        x_[1] = src_samples[block_size - 2];
+        y_[0] = dst_samples[block_size - 1];
+        y_[1] = dst_samples[block_size - 2];
+
+        process_serial(sample_count - block_size, src_samples + block_size, dst_samples + block_size);
+    }
+
+#ifdef OALSFXPP_AVX
+    // Same as "process_block_sse2" but with eight sub-blocks.
+    OALSFXPP_TARGET_AVX2
+    void process_block_avx2(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        constexpr auto lane_count = 8;
+
+        const auto length = (sample_count / (lane_count * 8)) * 8;
+        const auto block_size = length * lane_count;
+
+        // Feed-forward part.
+        dst_samples[0] = (b0_ * src_samples[0]) + (b1_ * x_[0]) + (b2_ * x_[1]);
+        dst_samples[1] = (b0_ * src_samples[1]) + (b1_ * src_samples[0]) + (b2_ * x_[0]);
+
+        for (int i = 2; i < 8; ++i)
+        {
+            dst_samples[i] = (b0_ * src_samples[i]) + (b1_ * src_samples[i - 1]) + (b2_ * src_samples[i - 2]);
+        }
+
+        const auto b0 = _mm256_set1_ps(b0_);
+        const auto b1 = _mm256_set1_ps(b1_);
+        const auto b2 = _mm256_set1_ps(b2_);
+
+        for (int i = 8; i < block_size; i += 8)
+        {
+            auto w = _mm256_mul_ps(b2, _mm256_loadu_ps(&src_samples[i - 2]));
+            w = _mm256_fmadd_ps(b1, _mm256_loadu_ps(&src_samples[i - 1]), w);
+            w = _mm256_fmadd_ps(b0, _mm256_loadu_ps(&src_samples[i]), w);
+
+            _mm256_storeu_ps(&dst_samples[i], w);
+        }
+
+        // Homogeneous response (stored shifted by one, so g[-1] is at index zero).
+        float g[(max_block_samples / lane_count) + 8];
+
+        g[0] = 1.0F;
+        g[1] = -a1_;
+
+        auto i = 0;
+
+        for (i = 2; i <= length; ++i)
+        {
+            g[i] = -(a1_ * g[i - 1]) - (a2_ * g[i - 2]);
+
+            if (std::abs(g[i]) < min_response && std::abs(g[i - 1]) < min_response)
+            {
+                break;
+            }
+        }
+
+        std::fill(&g[std::min(i, length + 1)], &g[length + 1], 0.0F);
+
+        // Zero-state all-pole responses of the sub-blocks.
+        const auto a1 = _mm256_set1_ps(a1_);
+        const auto a2 = _mm256_set1_ps(a2_);
+
+        auto y1 = _mm256_setzero_ps();
+        auto y2 = _mm256_setzero_ps();
+
+        for (int m = 0; m < length; m += 8)
+        {
+            __m256 v[lane_count];
+
+            for (int k = 0; k < lane_count; ++k)
+            {
+                v[k] = _mm256_loadu_ps(&dst_samples[(k * length) + m]);
+            }
+
+            Avx::transpose(v);
+
+            for (int j = 0; j < 8; ++j)
+            {
+                const auto y = _mm256_fnmadd_ps(a1, y1, _mm256_fnmadd_ps(a2, y2, v[j]));
+
+                y2 = y1;
+                y1 = y;
+                v[j] = y;
+            }
+
+            Avx::transpose(v);
+
+            for (int k = 0; k < lane_count; ++k)
+            {
+                _mm256_storeu_ps(&dst_samples[(k * length) + m], v[k]);
+            }
+        }
+
+        // Propagate the true initial state through the sub-blocks.
+        float init1[lane_count];
+        float init2[lane_count];
+
+        init1[0] = y_[0];
+        init2[0] = y_[1];
+
+        for (int k = 1; k < lane_count; ++k)
+        {
+            const auto last = (k * length) - 1;
+
+            const auto p1 = init1[k - 1];
+            const auto p2 = init2[k - 1];
+
+            init1[k] = dst_samples[last] + (g[length] * p1) - (a2_ * g[length - 1] * p2);
+            init2[k] = dst_samples[last - 1] + (g[length - 1] * p1) - (a2_ * g[length - 2] * p2);
+        }
+
+        // Fix up the sub-blocks.
+        for (int k = 0; k < lane_count; ++k)
+        {
+            const auto c1 = _mm256_set1_ps(init1[k]);
+            const auto c2 = _mm256_set1_ps(-a2_ * init2[k]);
+            auto dst = &dst_samples[k * length];
+
+            for (int m = 0; m < length; m += 8)
+            {
+                auto fixed = _mm256_fmadd_ps(c1, _mm256_loadu_ps(&g[m + 1]), _mm256_loadu_ps(&dst[m]));
+                fixed = _mm256_fmadd_ps(c2, _mm256_loadu_ps(&g[m]), fixed);
+
+                _mm256_storeu_ps(&dst[m], fixed);
+            }
+        }
+
+        x_[0] = src_samples[block_size - 1];
+        x_[1] = src_samples[block_size - 2];
+        y_[0] = dst_samples[block_size - 1];
+        y_[1] = dst_samples[block_size - 2];
+
+        process_serial(sample_count - block_size, src_samples + block_size, dst_samples + block_size);
+    }
+
+    // Same as "process_block_sse2" but with sixteen sub-blocks. The sub-blocks
+    // are gathered and scattered along the recurrence instead of transposed.
+    OALSFXPP_TARGET_AVX512
+    void process_block_avx512(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        constexpr auto lane_count = 16;
+
+        const auto length = (sample_count / (lane_count * 16)) * 16;
+        const auto block_size = length * lane_count;
+
+        if (length == 0)
+        {
+            process_block_avx2(sample_count, src_samples, dst_samples);
+            return;
+        }
+
+        // Feed-forward part.
+        dst_samples[0] = (b0_ * src_samples[0]) + (b1_ * x_[0]) + (b2_ * x_[1]);
+        dst_samples[1] = (b0_ * src_samples[1]) + (b1_ * src_samples[0]) + (b2_ * x_[0]);
+
+        for (int i = 2; i < 16; ++i)
+        {
+            dst_samples[i] = (b0_ * src_samples[i]) + (b1_ * src_samples[i - 1]) + (b2_ * src_samples[i - 2]);
+        }
+
+        const auto b0 = _mm512_set1_ps(b0_);
+        const auto b1 = _mm512_set1_ps(b1_);
+        const auto b2 = _mm512_set1_ps(b2_);
+
+        for (int i = 16; i < block_size; i += 16)
+        {
+            auto w = _mm512_mul_ps(b2, _mm512_loadu_ps(&src_samples[i - 2]));
+            w = _mm512_fmadd_ps(b1, _mm512_loadu_ps(&src_samples[i - 1]), w);
+            w = _mm512_fmadd_ps(b0, _mm512_loadu_ps(&src_samples[i]), w);
+
+            _mm512_storeu_ps(&dst_samples[i], w);
+        }
+
+        // Homogeneous response (stored shifted by one, so g[-1] is at index zero).
+        float g[(max_block_samples / lane_count) + 16];
+
+        g[0] = 1.0F;
+        g[1] = -a1_;
+
+        auto i = 0;
+
+        for (i = 2; i <= length; ++i)
+        {
+            g[i] = -(a1_ * g[i - 1]) - (a2_ * g[i - 2]);
+
+            if (std::abs(g[i]) < min_response && std::abs(g[i - 1]) < min_response)
+            {
+                break;
+            }
+        }
+
+        std::fill(&g[std::min(i, length + 1)], &g[length + 1], 0.0F);
+
+        // Zero-state all-pole responses of the sub-blocks.
+        const auto a1 = _mm512_set1_ps(a1_);
+        const auto a2 = _mm512_set1_ps(a2_);
+
+        const auto indices = _mm512_mullo_epi32(
+            _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0),
+            _mm512_set1_epi32(length));
+
+        auto y1 = _mm512_setzero_ps();
+        auto y2 = _mm512_setzero_ps();
+
+        for (int m = 0; m < length; ++m)
+        {
+            const auto v = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, indices, &dst_samples[m], 4);
+            const auto y = _mm512_fnmadd_ps(a1, y1, _mm512_fnmadd_ps(a2, y2, v));
+
+            _mm512_i32scatter_ps(&dst_samples[m], indices, y, 4);
+
+            y2 = y1;
+            y1 = y;
+        }
+
+        // Propagate the true initial state through the sub-blocks.
+        float init1[lane_count];
+        float init2[lane_count];
+
+        init1[0] = y_[0];
+        init2[0] = y_[1];
+
+        for (int k = 1; k < lane_count; ++k)
+        {
+            const auto last = (k * length) - 1;
+
+            const auto p1 = init1[k - 1];
+            const auto p2 = init2[k - 1];
+
+            init1[k] = dst_samples[last] + (g[length] * p1) - (a2_ * g[length - 1] * p2);
+            init2[k] = dst_samples[last - 1] + (g[length - 1] * p1) - (a2_ * g[length - 2] * p2);
+        }
+
+        // Fix up the sub-blocks.
+        for (int k = 0; k < lane_count; ++k)
+        {
+            const auto c1 = _mm512_set1_ps(init1[k]);
+            const auto c2 = _mm512_set1_ps(-a2_ * init2[k]);
+            auto dst = &dst_samples[k * length];
+
+            for (int m = 0; m < length; m += 16)
+            {
+                auto fixed = _mm512_fmadd_ps(c1, _mm512_loadu_ps(&g[m + 1]), _mm512_loadu_ps(&dst[m]));
+                fixed = _mm512_fmadd_ps(c2, _mm512_loadu_ps(&g[m]), fixed);
+
+                _mm512_storeu_ps(&dst[m], fixed);
+            }
+        }
+
+        x_[0] = src_samples[block_size - 1];
+        x_[1] = src_samples[block_size - 2];
+        y_[0] = dst_samples[block_size - 1];
+        y_[1] = dst_samples[block_size - 2];
+
+        process_serial(sample_count - block_size, src_samples + block_size, dst_samples + block_size);
+    }
+#endif // OALSFXPP_AVX
+
+    void process_pass_through(
+        const int sample_count,
+        const float* src_samples)
+    {
+        if (sample_count >= 2)
+        {
+            x_[1] = src_samples[sample_count - 2];
+            x_[0] = src_samples[sample_count - 1];
+            y_[1] = src_samples[sample_count - 2];
+            y_[0] = src_samples[sample_count - 1];
+        }
+        else if (sample_count == 1)
+        {
+            x_[1] = x_[0];
+            x_[0] = src_samples[0];
+            y_[1] = y_[0];
+            y_[0] = src_samples[0];
+        }
+    }
+
+
+    static void copy_params(
+        const FilterState& src_state,
+        FilterState& dst_state)
+    {
+        dst_state.b0_ = src_state.b0_;
+        dst_state.b1_ = src_state.b1_;
+        dst_state.b2_ = src_state.b2_;
+        dst_state.a1_ = src_state.a1_;
+        dst_state.a2_ = src_state.a2_;
+    }
+
+    // Calculates the rcpQ (i.e. 1/Q) coefficient for shelving filters, using the
+    // reference gain and shelf slope parameter.
+    // 0 < gain
+    // 0 < slope <= 1
+    static float calc_rcp_q_from_slope(
+        const float gain,
+        const float slope)
+    {
+        return std::sqrt((gain + (1.0F / gain)) * ((1.0F / slope) - 1.0F) + 2.0F);
+    }
+
+    // Calculates the rcpQ (i.e. 1/Q) coefficient for filters, using the frequency
+    // multiple (i.e. ref_freq / sampling_freq) and bandwidth.
+    // 0 < freq_mult < 0.5.
+    static float calc_rcp_q_from_bandwidth(
+        const float freq_mult,
+        const float bandwidth)
+    {
+        const auto w0 = Math::tau * freq_mult;
+        return 2.0F * std::sinh(std::log(2.0F) / 2.0F * bandwidth * w0 / std::sin(w0));
+    }
+}; // FilterState
+
+constexpr int FilterState::max_block_samples;
+
+
+// Waveform generator for the LFOs and the carriers of the effects.
+//
+// The phase is an unsigned 32-bit fraction of the period, so it wraps on its
+// own. The sinusoid is read from a table with linear interpolation; the other
+// waveforms are computed from the phase directly.
+struct Oscillator
+{
+    enum class Waveform
+    {
+        // sin(2 * pi * phase), in [-1, 1].
+        sinusoid,
+
+        // Rises from -1 at the start to 1 at the half of the period, in [-1, 1].
+        triangle,
+
+        // The phase itself, in [0, 1).
+        sawtooth,
+
+        // 0 for the first half of the period and 1 for the second one.
+        square,
+    }; // Waveform
+
+    using Phase = std::uint32_t;
+
+
+    static constexpr auto sine_table_bits = 12;
+    static constexpr auto sine_table_size = 1 << sine_table_bits;
+
+    static constexpr auto sine_frac_bits = 32 - sine_table_bits;
+    static constexpr auto sine_frac_mask = (Phase{1} << sine_frac_bits) - 1;
+
+    using SineTable = std::array<float, sine_table_size + 1>;
+
+
+    // Converts a fraction of the period into the phase.
+    //
+    // For a step, the fraction is the frequency over the sampling rate.
+    static Phase to_phase(
+        const double fraction)
+    {
+        constexpr auto phase_one = 4'294'967'296.0;
+
+        const auto wrapped = fraction - std::floor(fraction);
+
+        return static_cast<Phase>(std::min(wrapped * phase_one, phase_one - 1.0));
+    }
+
+    // Gets a value of the waveform at the phase.
+    template<Waveform TWaveform>
+    static float get_value(
+        const float* sine_table,
+        const Phase phase)
+    {
+        // The phase as a float in [0, 1), at full float precision.
+        const auto fraction = static_cast<float>(static_cast<std::int32_t>(phase >> 8)) * (1.0F / (1 << 24));
+
+        switch (TWaveform)
+        {
+        case Waveform::sinusoid:
+            {
+                const auto index = phase >> sine_frac_bits;
+                const auto mu = static_cast<float>(static_cast<std::int32_t>(phase & sine_frac_mask)) * (1.0F / (1 << sine_frac_bits));
+
+                return Math::lerp(sine_table[index], sine_table[index + 1], mu);
+            }
+
+        case Waveform::triangle:
+            return 1.0F - std::abs(2.0F - (4.0F * fraction));
+
+        case Waveform::sawtooth:
+            return fraction;
+
+        case Waveform::square:
+        default:
+            return static_cast<float>(phase >> 31);
+        }
+    }
+
+    // Generates a block of the waveform.
+    //
+    // Returns the phase past the block.
+    template<Waveform TWaveform>
+    static Phase generate(
+        float* dst_values,
+        Phase phase,
+        const Phase step,
+        const int count)
+    {
+        auto i = 0;
+
+#ifdef OALSFXPP_SSE2
+        i = count & (~3);
+
+        if (i > 0)
+        {
+            phase = generate_vectors<TWaveform>(dst_values, phase, step, i);
+        }
+#endif // OALSFXPP_SSE2
+
+        const auto sine_table = get_sine_table();
+
+        for ( ; i < count; ++i)
+        {
+            dst_values[i] = get_value<TWaveform>(sine_table, phase);
+            phase += step;
+        }
+
+        return phase;
+    }
+
+    static Phase generate(
+        const Waveform waveform,
+        float* dst_values,
+        const Phase phase,
+        const Phase step,
+        const int count)
+    {
+        switch (waveform)
+        {
+        case Waveform::sinusoid:
+            return generate<Waveform::sinusoid>(dst_values, phase, step, count);
+
+        case Waveform::triangle:
+            return generate<Waveform::triangle>(dst_values, phase, step, count);
+
+        case Waveform::sawtooth:
+            return generate<Waveform::sawtooth>(dst_values, phase, step, count);
+
+        case Waveform::square:
+        default:
+            return generate<Waveform::square>(dst_values, phase, step, count);
+        }
+    }
+
+    static const float* get_sine_table()
+    {
+        static const auto sine_table = make_sine_table();
+
+        return sine_table.data();
+    }
+
+
+private:
+#ifdef OALSFXPP_SSE2
+    // Generates the values four phases at a time, the same as "get_value"
+    // does one at a time. The count is a multiple of four.
+    //
+    // The sinusoid is done a chunk at a time: the indices and the fractions
+    // first, then the table values on both sides gathered by the vector
+    // kernel, and the interpolation last.
+    template<Waveform TWaveform>
+    static Phase generate_vectors(
+        float* dst_values,
+        const Phase phase,
+        const Phase step,
+        const int count)
+    {
+        constexpr auto max_chunk_values = 256;
+
+        const auto sine_table = get_sine_table();
+
+        const auto phase_step = _mm_set1_epi32(static_cast<int>(4 * step));
+        const auto frac_mask = _mm_set1_epi32(static_cast<int>(sine_frac_mask));
+        const auto frac_scale = _mm_set1_ps(1.0F / (1 << sine_frac_bits));
+        const auto fraction_scale = _mm_set1_ps(1.0F / (1 << 24));
+
+        auto phases = _mm_setr_epi32(
+            static_cast<int>(phase),
+            static_cast<int>(phase + step),
+            static_cast<int>(phase + (2 * step)),
+            static_cast<int>(phase + (3 * step)));
+
+        int indices[max_chunk_values];
+        float lower_values[max_chunk_values];
+        float upper_values[max_chunk_values];
+
+        for (int base = 0; base < count; base += max_chunk_values)
+        {
+            const auto todo = std::min(count - base, max_chunk_values);
+            const auto dst = &dst_values[base];
+
+            for (int i = 0; i < todo; i += 4)
+            {
+                const auto fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(phases, 8)), fraction_scale);
+
+                switch (TWaveform)
+                {
+                case Waveform::sinusoid:
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(&indices[i]), _mm_srli_epi32(phases, sine_frac_bits));
+                    _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phases, frac_mask)), frac_scale));
+                    break;
+
+                case Waveform::triangle:
+                    (Float4::set1(1.0F) - Float4::abs(Float4::set1(2.0F) - (Float4::set1(4.0F) * Float4{fraction}))).store(&dst[i]);
+                    break;
+
+                case Waveform::sawtooth:
+                    _mm_storeu_ps(&dst[i], fraction);
+                    break;
+
+                case Waveform::square:
+                default:
+                    _mm_storeu_ps(&dst[i], _mm_cvtepi32_ps(_mm_srli_epi32(phases, 31)));
+                    break;
+                }
+
+                phases = _mm_add_epi32(phases, phase_step);
+            }
+
+            if (TWaveform == Waveform::sinusoid)
+            {
+                Kernels::current.gather_(sine_table, indices, lower_values, 1.0F, todo);
+                Kernels::current.gather_(sine_table + 1, indices, upper_values, 1.0F, todo);
+
+                for (int i = 0; i < todo; i += 4)
+                {
+                    const auto lower = Float4::load(&lower_values[i]);
+                    const auto upper = Float4::load(&upper_values[i]);
+
+                    (lower + ((upper - lower) * Float4::load(&dst[i]))).store(&dst[i]);
+                }
+            }
+        }
+
+        return phase + (step * static_cast<Phase>(count));
+    }
+#endif // OALSFXPP_SSE2
+
+    static SineTable make_sine_table()
+    {
+        SineTable table;
+
+        for (int i = 0; i <= sine_table_size; ++i)
+        {
+            table[i] = static_cast<float>(std::sin((2.0 * 3.14159265358979323846 * i) / sine_table_size));
+        }
+
+        return table;
+    }
+}; // Oscillator
+
+// Polyphase FIR resampler for running a nonlinear stage at a multiple of the
+// sampling rate.
+//
+// Both directions use the same linear-phase Kaiser-windowed sinc, cut at the
+// Nyquist frequency of the base rate. The interpolator evaluates all phases of
+// an input sample as vectors; the decimator only evaluates the retained samples.
+//
+// The round trip delays the signal by (phase_taps - 1) samples of the base rate.
+template<int TFactor, int TPhaseTaps>
+class Oversampler
+{
+public:
+    static constexpr auto factor = TFactor;
+    static constexpr auto phase_taps = TPhaseTaps;
+    static constexpr auto filter_taps = factor * phase_taps;
+
+    static_assert((factor % 4) == 0, "The factor should be a multiple of four.");
+
+
+    Oversampler()
+        :
+        up_history_{},
+        down_history_{}
+    {
+    }
+
+
+    void clear()
+    {
+        up_history_.fill(0.0F);
+        down_history_.fill(0.0F);
+    }
+
+    void save_state(
+        StateWriter& writer) const
+    {
+        writer.write(up_history_);
+        writer.write(down_history_);
+    }
+
+    void load_state(
+        StateReader& reader)
+    {
+        reader.read(up_history_);
+        reader.read(down_history_);
+    }
+
+    // Upsamples the samples into (factor * sample_count) samples.
+    void upsample(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        for (int base = 0; base < sample_count; )
+        {
+            const auto todo = std::min(sample_count - base, max_block_samples);
+
+            upsample_block(todo, &src_samples[base], &dst_samples[base * factor]);
+
+            base += todo;
+        }
+    }
+
+    // Downsamples (factor * sample_count) samples into the samples.
+    void downsample(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        for (int base = 0; base < sample_count; )
+        {
+            const auto todo = std::min(sample_count - base, max_block_samples);
+
+            downsample_block(todo, &src_samples[base * factor], &dst_samples[base]);
+
+            base += todo;
+        }
+    }
+
+
+private:
+    static constexpr auto max_block_samples = 64;
+
+    static constexpr auto up_history_size = phase_taps - 1;
+    static constexpr auto down_history_size = filter_taps - factor;
+
+    // The filter split into phase_taps frames of factor taps each.
+    //
+    // The interpolator frames are scaled by the factor to make up for the
+    // zero stuffing. The decimator frames are reversed to match the order of
+    // the samples in a frame.
+    struct Coeffs
+    {
+        float up_[phase_taps][factor];
+        float down_[phase_taps][factor];
+    }; // Coeffs
+
+    using UpHistory = std::array<float, up_history_size>;
+    using DownHistory = std::array<float, down_history_size>;
+
+
+    UpHistory up_history_;
+    DownHistory down_history_;
+
+
+    void upsample_block(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        const auto& coeffs = get_coeffs();
+
+        float window[up_history_size + max_block_samples];
+
+        std::copy(up_history_.cbegin(), up_history_.cend(), window);
+        std::copy_n(src_samples, sample_count, &window[up_history_size]);
+
+        // Four samples at a time, for independent accumulators.
+        auto i = 0;
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            // The current samples are the last ones of the window.
+            const auto samples = &window[i + up_history_size];
+
+            for (int q = 0; q < factor; q += 4)
+            {
+                auto sum0 = Float4::zero();
+                auto sum1 = Float4::zero();
+                auto sum2 = Float4::zero();
+                auto sum3 = Float4::zero();
+
+                for (int k = 0; k < phase_taps; ++k)
+                {
+                    const auto phases = Float4::load(&coeffs.up_[k][q]);
+
+                    sum0 = sum0 + (phases * Float4::set1(samples[0 - k]));
+                    sum1 = sum1 + (phases * Float4::set1(samples[1 - k]));
+                    sum2 = sum2 + (phases * Float4::set1(samples[2 - k]));
+                    sum3 = sum3 + (phases * Float4::set1(samples[3 - k]));
+                }
+
+                sum0.store(&dst_samples[((i + 0) * factor) + q]);
+                sum1.store(&dst_samples[((i + 1) * factor) + q]);
+                sum2.store(&dst_samples[((i + 2) * factor) + q]);
+                sum3.store(&dst_samples[((i + 3) * factor) + q]);
+            }
+        }
+
+        for ( ; i < sample_count; ++i)
+        {
+            const auto samples = &window[i + up_history_size];
+
+            for (int q = 0; q < factor; q += 4)
+            {
+                auto sum = Float4::zero();
+
+                for (int k = 0; k < phase_taps; ++k)
+                {
+                    sum = sum + (Float4::load(&coeffs.up_[k][q]) * Float4::set1(samples[-k]));
+                }
+
+                sum.store(&dst_samples[(i * factor) + q]);
+            }
+        }
+
+        std::copy_n(&window[sample_count], up_history_size, up_history_.begin());
+    }
+
+    void downsample_block(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples)
+    {
+        const auto& coeffs = get_coeffs();
+
+        float window[down_history_size + (factor * max_block_samples)];
+
+        std::copy(down_history_.cbegin(), down_history_.cend(), window);
+        std::copy_n(src_samples, factor * sample_count, &window[down_history_size]);
+
+        // Four samples at a time, for independent accumulators and a single
+        // horizontal reduction.
+        auto i = 0;
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            // The current frames; their last samples are the retained ones.
+            const auto frames = &window[(i * factor) + down_history_size];
+
+            auto sum0 = Float4::zero();
+            auto sum1 = Float4::zero();
+            auto sum2 = Float4::zero();
+            auto sum3 = Float4::zero();
+
+            for (int k = 0; k < phase_taps; ++k)
+            {
+                for (int q = 0; q < factor; q += 4)
+                {
+                    const auto taps = Float4::load(&coeffs.down_[k][q]);
+                    const auto frame = &frames[(-k * factor) + q];
+
+                    sum0 = sum0 + (Float4::load(&frame[0 * factor]) * taps);
+                    sum1 = sum1 + (Float4::load(&frame[1 * factor]) * taps);
+                    sum2 = sum2 + (Float4::load(&frame[2 * factor]) * taps);
+                    sum3 = sum3 + (Float4::load(&frame[3 * factor]) * taps);
+                }
+            }
+
+            Float4::transpose(sum0, sum1, sum2, sum3);
+
+            ((sum0 + sum1) + (sum2 + sum3)).store(&dst_samples[i]);
+        }
+
+        for ( ; i < sample_count; ++i)
+        {
+            const auto frames = &window[(i * factor) + down_history_size];
+
+            auto sum = Float4::zero();
+
+            for (int k = 0; k < phase_taps; ++k)
+            {
+                for (int q = 0; q < factor; q += 4)
+                {
+                    sum = sum + (Float4::load(&frames[(-k * factor) + q]) * Float4::load(&coeffs.down_[k][q]));
+                }
+            }
+
+            float lanes[4];
+
+            sum.store(lanes);
+
+            dst_samples[i] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+
+        std::copy_n(&window[factor * sample_count], down_history_size, down_history_.begin());
+    }
+
+    static const Coeffs& get_coeffs()
+    {
+        static const auto coeffs = make_coeffs();
+
+        return coeffs;
+    }
+
+    static Coeffs make_coeffs()
+    {
+        // Kaiser window shape; about 50 dB of rejection past 0.6 of the base
+        // rate with 16 taps per phase.
+        constexpr auto beta = 5.0;
+
+        const auto center = (filter_taps - 1) / 2.0;
+        const auto cutoff = 0.5 / factor;
+
+        double taps[filter_taps];
+        auto taps_sum = 0.0;
+
+        for (int i = 0; i < filter_taps; ++i)
+        {
+            const auto t = i - center;
+            const auto sinc = (t == 0.0) ?
+                2.0 * cutoff :
+                std::sin(2.0 * 3.14159265358979323846 * cutoff * t) / (3.14159265358979323846 * t);
+            const auto ratio = t / center;
+            const auto window = Math::bessel_i0(beta * std::sqrt(1.0 - (ratio * ratio))) / Math::bessel_i0(beta);
+
+            taps[i] = sinc * window;
+            taps_sum += taps[i];
+        }
+
+        Coeffs coeffs;
+
+        for (int k = 0; k < phase_taps; ++k)
+        {
+            for (int p = 0; p < factor; ++p)
+            {
+                const auto tap = taps[(k * factor) + p] / taps_sum;
+
+                coeffs.up_[k][p] = static_cast<float>(tap * factor);
+                coeffs.down_[k][factor - 1 - p] = static_cast<float>(tap);
+            }
+        }
+
+        return coeffs;
+    }
+}; // Oversampler
+
+template<int TFactor, int TPhaseTaps>
+constexpr int Oversampler<TFactor, TPhaseTaps>::max_block_samples;
+
+// Band-limited resampler filter between two arbitrary sampling rates.
+//
+// The filter is a Kaiser-windowed sinc cut below the Nyquist frequency of the
+// lower rate. When the ratio of the rates is simple, every phase the output
+// takes between two source samples is tabulated. Otherwise the filter is
+// tabulated at fixed phases, and the coefficients are interpolated linearly
+// between them.
+//
+// The output advances by the exact ratio of the rates, so the resamplers of
+// the reciprocal ratios stay in step however long they run.
+class ResamplerFilter
+{
+public:
+    ResamplerFilter()
+        :
+        src_step_{},
+        dst_step_{},
+        tap_count_{},
+        phase_count_{},
+        is_interpolated_{},
+        coeffs_{},
+        deltas_{}
+    {
+    }
+
+
+    void initialize(
+        const int src_sampling_rate,
+        const int dst_sampling_rate)
+    {
+        auto divisor = src_sampling_rate;
+
+        for (auto remainder = dst_sampling_rate; remainder != 0; )
+        {
+            const auto next_remainder = divisor % remainder;
+
+            divisor = remainder;
+            remainder = next_remainder;
+        }
+
+        src_step_ = src_sampling_rate / divisor;
+        dst_step_ = dst_sampling_rate / divisor;
+
+        // The cutoff relative to the Nyquist frequency of the source.
+        const auto ratio = static_cast<double>(dst_sampling_rate) / src_sampling_rate;
+        const auto cutoff = passband * std::min(ratio, 1.0);
+        const auto half_width = zero_crossings / cutoff;
+
+        // Two vectors of taps per step.
+        tap_count_ = (static_cast<int>(std::ceil(2.0 * half_width)) + 7) & (~7);
+
+        is_interpolated_ = (dst_step_ > max_exact_phase_count);
+        phase_count_ = is_interpolated_ ? interpolated_phase_count : dst_step_;
+
+        // The interpolated table has the end phase too.
+        const auto table_phase_count = phase_count_ + (is_interpolated_ ? 1 : 0);
+
+        coeffs_.resize(table_phase_count * tap_count_);
+
+        auto taps = std::vector<double>{};
+        taps.resize(tap_count_);
+
+        for (int phase = 0; phase < table_phase_count; ++phase)
+        {
+            // The tap (tap_count / 2 - 1) is the nearest source sample before
+            // the output one.
+            const auto fraction = static_cast<double>(phase) / phase_count_;
+
+            auto taps_sum = 0.0;
+
+            for (int i = 0; i < tap_count_; ++i)
+            {
+                const auto t = fraction + ((tap_count_ / 2) - 1 - i);
+                const auto x = t / half_width;
+
+                if (std::abs(x) >= 1.0)
+                {
+                    taps[i] = 0.0;
+                    continue;
+                }
+
+                const auto sinc = (t == 0.0) ?
+                    cutoff :
+                    std::sin(3.14159265358979323846 * cutoff * t) / (3.14159265358979323846 * t);
+
+                const auto window = Math::bessel_i0(beta * std::sqrt(1.0 - (x * x))) / Math::bessel_i0(beta);
+
+                taps[i] = sinc * window;
+                taps_sum += taps[i];
+            }
+
+            // Unity gain at DC for every phase.
+            for (int i = 0; i < tap_count_; ++i)
+            {
+                coeffs_[(phase * tap_count_) + i] = static_cast<float>(taps[i] / taps_sum);
+            }
+        }
+
+        if (!is_interpolated_)
+        {
+            EffectSampleBuffer{}.swap(deltas_);
+            return;
+        }
+
+        deltas_.resize(phase_count_ * tap_count_);
+
+        for (int i = 0; i < (phase_count_ * tap_count_); ++i)
+        {
+            deltas_[i] = coeffs_[i + tap_count_] - coeffs_[i];
+        }
+    }
+
+    int get_src_step() const
+    {
+        return src_step_;
+    }
+
+    int get_dst_step() const
+    {
+        return dst_step_;
+    }
+
+    int get_tap_count() const
+    {
+        return tap_count_;
+    }
+
+    // Filters the samples at the position of (src_remainder / dst_step) past
+    // the sample (tap_count / 2 - 1).
+    float apply(
+        const float* src_samples,
+        const int src_remainder) const
+    {
+        if (!is_interpolated_)
+        {
+            return apply_exact(src_samples, src_remainder);
+        }
+
+        const auto phase = (static_cast<float>(src_remainder) / dst_step_) * phase_count_;
+        const auto phase_index = std::min(static_cast<int>(phase), phase_count_ - 1);
+
+        const auto coeffs = &coeffs_[phase_index * tap_count_];
+        const auto deltas = &deltas_[phase_index * tap_count_];
+
+        const auto mu = Float4::set1(phase - phase_index);
+
+        auto sum_a = Float4::zero();
+        auto sum_b = Float4::zero();
+
+        for (int i = 0; i < tap_count_; i += 8)
+        {
+            const auto coeff_a = Float4::load(&coeffs[i]) + (Float4::load(&deltas[i]) * mu);
+            const auto coeff_b = Float4::load(&coeffs[i + 4]) + (Float4::load(&deltas[i + 4]) * mu);
+
+            sum_a = sum_a + (Float4::load(&src_samples[i]) * coeff_a);
+            sum_b = sum_b + (Float4::load(&src_samples[i + 4]) * coeff_b);
+        }
+
+        return Float4::get_sum(sum_a + sum_b);
+    }
+
+
+private:
+    // The half width of the filter in zero crossings.
+    static constexpr auto zero_crossings = 16;
+
+    // The passband relative to the Nyquist frequency of the lower rate.
+    static constexpr auto passband = 0.9;
+
+    // About 90 dB of stopband rejection.
+    static constexpr auto beta = 9.0;
+
+    static constexpr auto max_exact_phase_count = 512;
+    static constexpr auto interpolated_phase_count = 128;
+
+
+    int src_step_;
+    int dst_step_;
+    int tap_count_;
+    int phase_count_;
+    bool is_interpolated_;
+    EffectSampleBuffer coeffs_;
+    EffectSampleBuffer deltas_;
+
+
+    float apply_exact(
+        const float* src_samples,
+        const int src_remainder) const
+    {
+        const auto coeffs = &coeffs_[src_remainder * tap_count_];
+
+        // Two sums shorten the dependency chain.
+        auto sum_a = Float4::zero();
+        auto sum_b = Float4::zero();
+
+        for (int i = 0; i < tap_count_; i += 8)
+        {
+            sum_a = sum_a + (Float4::load(&src_samples[i]) * Float4::load(&coeffs[i]));
+            sum_b = sum_b + (Float4::load(&src_samples[i + 4]) * Float4::load(&coeffs[i + 4]));
+        }
+
+        return Float4::get_sum(sum_a + sum_b);
+    }
+}; // ResamplerFilter
+
+// A channel of a stream resampled by the shared filter.
+class Resampler
+{
+public:
+    // Where the resampler is among the kept samples.
+    struct Position
+    {
+        int sample_count_;
+        int src_index_;
+        int src_remainder_;
+
+
+        bool is_in_step_with(
+            const Position& that) const
+        {
+            return
+                sample_count_ == that.sample_count_ &&
+                src_index_ == that.src_index_ &&
+                src_remainder_ == that.src_remainder_;
+        }
+    }; // Position
+
+
+    Resampler()
+        :
+        filter_{},
+        samples_{},
+        sample_count_{},
+        silent_count_{},
+        src_index_{},
+        src_remainder_{}
+    {
+    }
+
+
+    // Prepares the resampler for chunks of up to (max_src_count) samples.
+    //
+    // The output is delayed by (delay) source samples of silence.
+    void initialize(
+        const ResamplerFilter& filter,
+        const int max_src_count,
+        const int delay)
+    {
+        filter_ = &filter;
+
+        const auto tap_count = filter.get_tap_count();
+
+        // The samples before the first output one, the samples waiting for the
+        // output, and a chunk.
+        samples_.assign(tap_count + delay + (2 * max_src_count), 0.0F);
+        sample_count_ = (tap_count / 2) - 1 + delay;
+        silent_count_ = sample_count_;
+        src_index_ = 0;
+        src_remainder_ = 0;
+    }
+
+    // Resamples the samples, and returns the number of the resampled ones.
+    //
+    // The resampled samples past (max_dst_count) are left for the next call.
+    int process(
+        const float* src_samples,
+        const int src_count,
+        float* dst_samples,
+        const int max_dst_count)
+    {
+        assert((sample_count_ + src_count) <= static_cast<int>(samples_.size()));
+
+        std::copy_n(src_samples, src_count, &samples_[sample_count_]);
+        sample_count_ += src_count;
+
+        // Track the trailing silence, where the output is silent too. The
+        // input of an effect is often silent on some of the channels.
+        auto sound_count = src_count;
+
+        while (sound_count > 0 && src_samples[sound_count - 1] == 0.0F)
+        {
+            sound_count -= 1;
+        }
+
+        silent_count_ = (sound_count == 0) ? silent_count_ + src_count : src_count - sound_count;
+
+        const auto silence_index = sample_count_ - silent_count_;
+
+        const auto tap_count = filter_->get_tap_count();
+        const auto dst_step = filter_->get_dst_step();
+
+        // The step split into the whole source samples and the remainder.
+        const auto index_step = filter_->get_src_step() / dst_step;
+        const auto remainder_step = filter_->get_src_step() % dst_step;
+
+        auto dst_count = 0;
+
+        while (dst_count < max_dst_count && (src_index_ + tap_count) <= sample_count_)
+        {
+            dst_samples[dst_count] = (src_index_ < silence_index) ?
+                filter_->apply(&samples_[src_index_], src_remainder_) :
+                0.0F;
+
+            dst_count += 1;
+
+            src_index_ += index_step;
+            src_remainder_ += remainder_step;
+
+            if (src_remainder_ >= dst_step)
+            {
+                src_index_ += 1;
+                src_remainder_ -= dst_step;
+            }
+        }
+
+        // Drop the samples behind the filter.
+        const auto keep_count = sample_count_ - src_index_;
+
+        std::copy_n(&samples_[src_index_], keep_count, samples_.begin());
+
+        sample_count_ = keep_count;
+        silent_count_ = std::min(silent_count_, keep_count);
+        src_index_ = 0;
+
+        return dst_count;
+    }
+
+    // Saves the samples kept for the filter, and the position among them.
+    void save_state(
+        StateWriter& writer) const
+    {
+        writer.write(sample_count_);
+        writer.write(silent_count_);
+        writer.write(src_index_);
+        writer.write(src_remainder_);
+        writer.write_samples(samples_.data(), sample_count_);
+    }
+
+    // Loads the state, and gets the loaded position, which a validating
+    // reader gets as well.
+    void load_state(
+        StateReader& reader,
+        Position& position)
+    {
+        position.sample_count_ = reader.read_index(static_cast<int>(samples_.size()));
+
+        reader.read_index(silent_count_, position.sample_count_ + 1);
+
+        position.src_index_ = reader.read_index(position.sample_count_ + 1);
+        position.src_remainder_ = reader.read_index(filter_ ? filter_->get_dst_step() : 0);
+
+        reader.read_samples(samples_.data(), position.sample_count_);
+
+        if (!reader.is_failed() && !reader.is_validating())
+        {
+            sample_count_ = position.sample_count_;
+            src_index_ = position.src_index_;
+            src_remainder_ = position.src_remainder_;
+        }
+    }
+
+    Position get_position() const
+    {
+        return Position{sample_count_, src_index_, src_remainder_};
+    }
+
+    // Gets the source samples waiting for the output at the position, in
+    // steps of (1 / dst_step) of a sample.
+    long long get_lag(
+        const Position& position) const
+    {
+        const auto dst_step = filter_->get_dst_step();
+
+        return (static_cast<long long>(position.sample_count_ - position.src_index_) * dst_step) -
+            position.src_remainder_;
+    }
+
+    // Whether the position is where a chunk leaves the resampler, with the
+    // filter short of the samples for the next output.
+    bool is_drained(
+        const Position& position) const
+    {
+        return position.src_index_ == 0 && position.sample_count_ < filter_->get_tap_count();
+    }
+
+
+private:
+    const ResamplerFilter* filter_;
+    EffectSampleBuffer samples_;
+    int sample_count_;
+    int silent_count_;
+    int src_index_;
+    int src_remainder_;
+}; // Resampler
+
+// Soft-clipping waveshaper, (gain * x) / (1 + (knee * |x|)).
+//
+// Nested stages of this shape fold into a single one, so a chain of them costs
+// one reciprocal per sample.
+struct Waveshaper
+{
+    float gain_;
+    float knee_;
+
+
+    // Sets up the shaper as (stage_count) nested stages of
+    // ((1 + edge) * x) / (1 + (edge * |x|)), scaled by the output gain.
+    void set_stages(
+        const float edge,
+        const int stage_count,
+        const float output_gain)
+    {
+        // With a = (1 + edge), two stages fold into
+        // (a^2 * x) / (1 + (edge * (1 + a) * |x|)), and so on.
+        const auto a = 1.0F + edge;
+
+        auto gain = 1.0F;
+        auto knee_sum = 0.0F;
+
+        for (int i = 0; i < stage_count; ++i)
+        {
+            knee_sum += gain;
+            gain *= a;
+        }
+
+        gain_ = output_gain * gain;
+        knee_ = edge * knee_sum;
+    }
+
+    void process(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples) const
+    {
+        Kernels::current.waveshape_(src_samples, dst_samples, gain_, knee_, sample_count);
+    }
+
+
+    static void shape_c(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float knee,
+        const int sample_count)
+    {
+        for (int i = 0; i < sample_count; ++i)
+        {
+            const auto sample = src_samples[i];
+
+            dst_samples[i] = (gain * sample) / (1.0F + (knee * std::abs(sample)));
+        }
+    }
+
+    static void shape_sse2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float knee,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = Float4::set1(gain);
+        const auto knees = Float4::set1(knee);
+        const auto ones = Float4::set1(1.0F);
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            const auto samples = Float4::load(&src_samples[i]);
+            const auto denominators = ones + (knees * Float4::abs(samples));
+
+            ((gains * samples) * Float4::rcp(denominators)).store(&dst_samples[i]);
+        }
+
+        shape_c(&src_samples[i], &dst_samples[i], gain, knee, sample_count - i);
+    }
+
+#ifdef OALSFXPP_AVX
+    OALSFXPP_TARGET_AVX2
+    static void shape_avx2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float knee,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = _mm256_set1_ps(gain);
+        const auto knees = _mm256_set1_ps(knee);
+        const auto ones = _mm256_set1_ps(1.0F);
+        const auto twos = _mm256_set1_ps(2.0F);
+        const auto sign_mask = _mm256_set1_ps(-0.0F);
+
+        for ( ; (i + 8) <= sample_count; i += 8)
+        {
+            const auto samples = _mm256_loadu_ps(&src_samples[i]);
+            const auto denominators = _mm256_fmadd_ps(knees, _mm256_andnot_ps(sign_mask, samples), ones);
+
+            // Reciprocal estimate with a Newton-Raphson step.
+            const auto estimate = _mm256_rcp_ps(denominators);
+            const auto reciprocal = _mm256_mul_ps(estimate, _mm256_fnmadd_ps(denominators, estimate, twos));
+
+            _mm256_storeu_ps(&dst_samples[i], _mm256_mul_ps(_mm256_mul_ps(gains, samples), reciprocal));
+        }
+
+        shape_c(&src_samples[i], &dst_samples[i], gain, knee, sample_count - i);
+    }
+#endif // OALSFXPP_AVX
+}; // Waveshaper
+
+// A buffer of trivially copyable items, which starts zeroed.
+//
+// A big buffer is mapped from anonymous memory, whose pages read as zeros
+// until they are written, so the allocation touches none of them. A small
+// buffer comes cleared from the heap.
+template<typename T>
+class ZeroedBuffer
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "Expected a trivially copyable type.");
+
+
+    ZeroedBuffer()
+        :
+        items_{},
+        size_{},
+        is_mapped_{}
+    {
+    }
+
+    ZeroedBuffer(
+        const ZeroedBuffer& that) = delete;
+
+    ZeroedBuffer& operator=(
+        const ZeroedBuffer& that) = delete;
+
+    ~ZeroedBuffer()
+    {
+        release();
+    }
+
+
+    // Allocates the zeroed items anew.
+    void reset(
+        const int size)
+    {
+        release();
+
+        if (size <= 0)
+        {
+            return;
+        }
+
+        const auto byte_count = static_cast<std::size_t>(size) * sizeof(T);
+
+        if (byte_count >= min_mapped_size)
+        {
+            items_ = static_cast<T*>(map(byte_count));
+            is_mapped_ = (items_ != nullptr);
+        }
+
+        if (!items_)
+        {
+            items_ = static_cast<T*>(std::calloc(size, sizeof(T)));
+        }
+
+        if (!items_)
+        {
+            throw std::bad_alloc{};
+        }
+
+        size_ = size;
+    }
+
+    void release()
+    {
+        if (!items_)
+        {
+            return;
+        }
+
+        if (is_mapped_)
+        {
+            unmap(items_, static_cast<std::size_t>(size_) * sizeof(T));
+        }
+        else
+        {
+            std::free(items_);
+        }
+
+        items_ = nullptr;
+        size_ = 0;
+        is_mapped_ = false;
+    }
+
+    // Zeroes the (count) items before the end index, wrapping around the start
+    // of the buffer.
+    void clear_before(
+        const int end,
+        const int count)
+    {
+        const auto clear_count = std::min(count, size_);
+        const auto begin = end - clear_count;
+
+        if (begin >= 0)
+        {
+            std::fill_n(&items_[begin], clear_count, T{});
+        }
+        else
+        {
+            std::fill_n(items_, end, T{});
+            std::fill_n(&items_[size_ + begin], -begin, T{});
+        }
+    }
+
+    bool is_empty() const
+    {
+        return size_ == 0;
+    }
+
+    int get_size() const
+    {
+        return size_;
+    }
+
+    T* get_data()
+    {
+        return items_;
+    }
+
+    const T* get_data() const
+    {
+        return items_;
+    }
+
+    T& operator[](
+        const int index)
+    {
+        return items_[index];
+    }
+
+    const T& operator[](
+        const int index) const
+    {
+        return items_[index];
+    }
+
+
+private:
+    // Smaller buffers are not worth a mapping of their own.
+    static constexpr auto min_mapped_size = std::size_t{64 * 1024};
+
+
+    T* items_;
+    int size_;
+    bool is_mapped_;
+
+
+    static void* map(
+        const std::size_t byte_count)
+    {
+#ifdef _WIN32
+        return ::VirtualAlloc(nullptr, byte_count, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+        const auto data = ::mmap(nullptr, byte_count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        return (data != MAP_FAILED) ? data : nullptr;
+#endif // _WIN32
+    }
+
+    static void unmap(
+        void* data,
+        const std::size_t byte_count)
+    {
+#ifdef _WIN32
+        static_cast<void>(byte_count);
+        ::VirtualFree(data, 0, MEM_RELEASE);
+#else
+        ::munmap(data, byte_count);
+#endif // _WIN32
+    }
+}; // ZeroedBuffer
+
+// A delay line with block access.
+//
+// The length is a power of two, so the positions wrap with a mask. A block is
+// read or written as at most two contiguous spans around the wrap point.
+//
+// The line keeps the span written since it was silenced, so silencing it
+// again clears just that span.
+class DelayLine
+{
+public:
+    DelayLine()
+        :
+        samples_{},
+        offset_{},
+        written_end_{},
+        written_count_{}
+    {
+    }
+
+
+    // Releases the storage.
+    void release()
+    {
+        samples_.release();
+        offset_ = 0;
+        written_end_ = 0;
+        written_count_ = 0;
+    }
+
+    // Makes the line hold at least the sample count, and silences it.
+    void reset(
+        const int min_sample_count)
+    {
+        const auto length = Math::next_power_of_2(min_sample_count);
+
+        if (length != get_length())
+        {
+            samples_.reset(length);
+            offset_ = 0;
+        }
+        else
+        {
+            samples_.clear_before(written_end_, written_count_);
+        }
+
+        written_end_ = 0;
+        written_count_ = 0;
+    }
+
+    int get_length() const
+    {
+        return samples_.get_size();
+    }
+
+    // Reads the samples, starting from the delay before the offset.
+    void read(
+        const int delay,
+        const int sample_count,
+        float* dst_samples) const
+    {
+        const auto position = get_position(delay);
+        const auto head_count = std::min(sample_count, get_length() - position);
+
+        std::copy_n(&samples_[position], head_count, dst_samples);
+        std::copy_n(samples_.get_data(), sample_count - head_count, &dst_samples[head_count]);
+    }
+
+    // Accumulates the samples scaled by a constant gain, starting from the delay
+    // before the offset.
+    void mix(
+        const int delay,
+        const int sample_count,
+        float* dst_samples,
+        const float gain) const
+    {
+        const auto position = get_position(delay);
+        const auto head_count = std::min(sample_count, get_length() - position);
+
+        Kernels::current.mix_(&samples_[position], dst_samples, gain, head_count);
+
+        if (head_count < sample_count)
+        {
+            Kernels::current.mix_(samples_.get_data(), &dst_samples[head_count], gain, sample_count - head_count);
+        }
+    }
+
+    // Writes the samples at the offset.
+    void write(
+        const int sample_count,
+        const float* src_samples)
+    {
+        const auto head_count = std::min(sample_count, get_length() - offset_);
+
+        std::copy_n(src_samples, head_count, &samples_[offset_]);
+        std::copy_n(&src_samples[head_count], sample_count - head_count, samples_.get_data());
+
+        // The writes go on from the offset, so the span ends at the last one.
+        written_end_ = ((offset_ + sample_count - 1) & (get_length() - 1)) + 1;
+        written_count_ = std::min(written_count_ + sample_count, get_length());
+    }
+
+    void advance(
+        const int sample_count)
+    {
+        offset_ = (offset_ + sample_count) & (get_length() - 1);
+    }
+
+    void save_state(
+        StateWriter& writer) const
+    {
+        writer.write(offset_);
+        writer.write_samples(samples_.get_data(), get_length());
+    }
+
+    void load_state(
+        StateReader& reader)
+    {
+        reader.read_index(offset_, get_length());
+        reader.read_samples(samples_.get_data(), get_length());
+
+        if (!reader.is_validating())
+        {
+            written_end_ = get_length();
+            written_count_ = get_length();
+        }
+    }
+
+
+private:
+    ZeroedBuffer<float> samples_;
+    int offset_;
+
+    // The span written since the line was silenced.
+    int written_end_;
+    int written_count_;
+
+
+    int get_position(
+        const int delay) const
+    {
+        return (offset_ - delay) & (get_length() - 1);
+    }
+}; // DelayLine
+
+// A real FFT of a power of two size.
+//
+// The spectra are split into the real and the imaginary parts of the bins from
+// zero up to the Nyquist frequency. The transforms are not normalized, so a
+// round trip scales the samples by twice the size.
+//
+// The samples are transformed as a complex sequence of half the size (even
+// samples as the real parts, odd ones as the imaginary parts). It runs through
+// a radix-2 Stockham FFT, which sorts its output without a bit reversal pass.
+class RealFft
+{
+public:
+    RealFft()
+        :
+        size_{},
+        twiddles_re_{},
+        twiddles_im_{},
+        pair_twiddles_re_{},
+        pair_twiddles_im_{},
+        split_twiddles_re_{},
+        split_twiddles_im_{},
+        work_re_{},
+        work_im_{}
+    {
+    }
+
+
+    // The size must be a power of two, from 16.
+    void initialize(
+        const int size)
+    {
+        assert(size >= 16 && Math::next_power_of_2(size) == size);
+
+        size_ = size;
+
+        const auto half_size = size / 2;
+        const auto quarter_size = size / 4;
+
+        // W(M)^j = exp(-2 pi i j / M) for the complex FFT of size M.
+        twiddles_re_.resize(quarter_size);
+        twiddles_im_.resize(quarter_size);
+
+        for (int j = 0; j < quarter_size; ++j)
+        {
+            const auto angle = -tau * j / half_size;
+
+            twiddles_re_[j] = static_cast<float>(std::cos(angle));
+            twiddles_im_[j] = static_cast<float>(std::sin(angle));
+        }
+
+        // W(M)^(2p) for both lanes of each pair in the second stage.
+        pair_twiddles_re_.resize(quarter_size);
+        pair_twiddles_im_.resize(quarter_size);
+
+        for (int j = 0; j < quarter_size; ++j)
+        {
+            pair_twiddles_re_[j] = twiddles_re_[j & ~1];
+            pair_twiddles_im_[j] = twiddles_im_[j & ~1];
+        }
+
+        // W(N)^k to split the spectrum of the half size sequence.
+        split_twiddles_re_.resize(quarter_size);
+        split_twiddles_im_.resize(quarter_size);
+
+        for (int k = 0; k < quarter_size; ++k)
+        {
+            const auto angle = -tau * k / size;
+
+            split_twiddles_re_[k] = static_cast<float>(std::cos(angle));
+            split_twiddles_im_[k] = static_cast<float>(std::sin(angle));
+        }
+
+        for (int i = 0; i < 2; ++i)
+        {
+            work_re_[i].resize(half_size);
+            work_im_[i].resize(half_size);
+        }
+    }
+
+    int get_size() const
+    {
+        return size_;
+    }
+
+    int get_bin_count() const
+    {
+        return (size_ / 2) + 1;
+    }
+
+    // Transforms the samples into the spectrum.
+    void forward(
+        const float* src_samples,
+        float* dst_re,
+        float* dst_im)
+    {
+        const auto half_size = size_ / 2;
+
+        auto z_re = work_re_[0].data();
+        auto z_im = work_im_[0].data();
+
+        for (int i = 0; i < half_size; i += 4)
+        {
+            Float4 re;
+            Float4 im;
+
+            Float4::deinterleave(Float4::load(&src_samples[2 * i]), Float4::load(&src_samples[(2 * i) + 4]), re, im);
+
+            re.store(&z_re[i]);
+            im.store(&z_im[i]);
+        }
+
+        transform(z_re, z_im);
+
+        // X(k) = E(k) + W(N)^k O(k), and X(M-k) = conj(E(k) - W(N)^k O(k)),
+        // where E(k) = Z(k) + conj(Z(M-k)), and O(k) = -i (Z(k) - conj(Z(M-k))).
+        dst_re[0] = 2.0F * (z_re[0] + z_im[0]);
+        dst_im[0] = 0.0F;
+        dst_re[half_size] = 2.0F * (z_re[0] - z_im[0]);
+        dst_im[half_size] = 0.0F;
+
+        const auto quarter_size = size_ / 4;
+
+        dst_re[quarter_size] = 2.0F * z_re[quarter_size];
+        dst_im[quarter_size] = -2.0F * z_im[quarter_size];
+
+        auto k = 1;
+
+        for ( ; (k + 4) <= quarter_size; k += 4)
+        {
+            const auto m = half_size - k - 3;
+
+            const auto a_re = Float4::load(&z_re[k]);
+            const auto a_im = Float4::load(&z_im[k]);
+            const auto b_re = Float4::shuffle<3, 2, 1, 0>(Float4::load(&z_re[m]));
+            const auto b_im = Float4::shuffle<3, 2, 1, 0>(Float4::load(&z_im[m]));
+
+            const auto w_re = Float4::load(&split_twiddles_re_[k]);
+            const auto w_im = Float4::load(&split_twiddles_im_[k]);
+
+            const auto e_re = a_re + b_re;
+            const auto e_im = a_im - b_im;
+            const auto d_re = a_re - b_re;
+            const auto d_im = a_im + b_im;
+
+            const auto t_re = (w_re * d_im) + (w_im * d_re);
+            const auto t_im = (w_im * d_im) - (w_re * d_re);
+
+            (e_re + t_re).store(&dst_re[k]);
+            (e_im + t_im).store(&dst_im[k]);
+            Float4::shuffle<3, 2, 1, 0>(e_re - t_re).store(&dst_re[m]);
+            Float4::shuffle<3, 2, 1, 0>(t_im - e_im).store(&dst_im[m]);
+        }
+
+        for ( ; k < quarter_size; ++k)
+        {
+            const auto m = half_size - k;
+
+            const auto w_re = split_twiddles_re_[k];
+            const auto w_im = split_twiddles_im_[k];
+
+            const auto e_re = z_re[k] + z_re[m];
+            const auto e_im = z_im[k] - z_im[m];
+            const auto d_re = z_re[k] - z_re[m];
+            const auto d_im = z_im[k] + z_im[m];
+
+            const auto t_re = (w_re * d_im) + (w_im * d_re);
+            const auto t_im = (w_im * d_im) - (w_re * d_re);
+
+            dst_re[k] = e_re + t_re;
+            dst_im[k] = e_im + t_im;
+            dst_re[m] = e_re - t_re;
+            dst_im[m] = t_im - e_im;
+        }
+    }
+
+    // Transforms the spectrum into the second half of the samples, which is
+    // all the overlap-save convolution keeps.
+    void inverse_second_half(
+        const float* src_re,
+        const float* src_im,
+        float* dst_samples)
+    {
+        const auto half_size = size_ / 2;
+        const auto quarter_size = size_ / 4;
+
+        // The inverse transform is the forward one of the spectrum with the
+        // real and the imaginary parts swapped, and swapped back.
+        auto z_re = work_im_[0].data();
+        auto z_im = work_re_[0].data();
+
+        // Z(k) = F(k) + i G(k) conj(W(N)^k), and Z(M-k) = conj(F(k)) + i conj(G(k) conj(W(N)^k)),
+        // where F(k) = X(k) + conj(X(M-k)), and G(k) = X(k) - conj(X(M-k)).
+        z_re[0] = src_re[0] + src_re[half_size];
+        z_im[0] = src_re[0] - src_re[half_size];
+
+        z_re[quarter_size] = 2.0F * src_re[quarter_size];
+        z_im[quarter_size] = -2.0F * src_im[quarter_size];
+
+        auto k = 1;
+
+        for ( ; (k + 4) <= quarter_size; k += 4)
+        {
+            const auto m = half_size - k - 3;
+
+            const auto a_re = Float4::load(&src_re[k]);
+            const auto a_im = Float4::load(&src_im[k]);
+            const auto b_re = Float4::shuffle<3, 2, 1, 0>(Float4::load(&src_re[m]));
+            const auto b_im = Float4::shuffle<3, 2, 1, 0>(Float4::load(&src_im[m]));
+
+            const auto w_re = Float4::load(&split_twiddles_re_[k]);
+            const auto w_im = Float4::load(&split_twiddles_im_[k]);
+
+            const auto f_re = a_re + b_re;
+            const auto f_im = a_im - b_im;
+            const auto g_re = a_re - b_re;
+            const auto g_im = a_im + b_im;
+
+            const auto o_re = (g_re * w_re) + (g_im * w_im);
+            const auto o_im = (g_im * w_re) - (g_re * w_im);
+
+            (f_re - o_im).store(&z_re[k]);
+            (f_im + o_re).store(&z_im[k]);
+            Float4::shuffle<3, 2, 1, 0>(f_re + o_im).store(&z_re[m]);
+            Float4::shuffle<3, 2, 1, 0>(o_re - f_im).store(&z_im[m]);
+        }
+
+        for ( ; k < quarter_size; ++k)
+        {
+            const auto m = half_size - k;
+
+            const auto w_re = split_twiddles_re_[k];
+            const auto w_im = split_twiddles_im_[k];
+
+            const auto f_re = src_re[k] + src_re[m];
+            const auto f_im = src_im[k] - src_im[m];
+            const auto g_re = src_re[k] - src_re[m];
+            const auto g_im = src_im[k] + src_im[m];
+
+            const auto o_re = (g_re * w_re) + (g_im * w_im);
+            const auto o_im = (g_im * w_re) - (g_re * w_im);
+
+            z_re[k] = f_re - o_im;
+            z_im[k] = f_im + o_re;
+            z_re[m] = f_re + o_im;
+            z_im[m] = o_re - f_im;
+        }
+
+        auto x_re = work_re_[0].data();
+        auto x_im = work_im_[0].data();
+
+        transform(x_re, x_im);
+
+        for (int i = quarter_size; i < half_size; i += 4)
+        {
+            Float4 lo;
+            Float4 hi;
+
+            Float4::interleave(Float4::load(&x_im[i]), Float4::load(&x_re[i]), lo, hi);
+
+            lo.store(&dst_samples[(2 * i) - half_size]);
+            hi.store(&dst_samples[(2 * i) - half_size + 4]);
+        }
+    }
+
+
+private:
+    using Buffers = std::array<EffectSampleBuffer, 2>;
+
+
+    // The twiddles are calculated at double precision.
+    static constexpr auto tau = 6.28318530717958647692;
+
+
+    int size_;
+    EffectSampleBuffer twiddles_re_;
+    EffectSampleBuffer twiddles_im_;
+    EffectSampleBuffer pair_twiddles_re_;
+    EffectSampleBuffer pair_twiddles_im_;
+    EffectSampleBuffer split_twiddles_re_;
+    EffectSampleBuffer split_twiddles_im_;
+    Buffers work_re_;
+    Buffers work_im_;
+
+
+    static void multiply(
+        const Float4& a_re,
+        const Float4& a_im,
+        const Float4& b_re,
+        const Float4& b_im,
+        Float4& re,
+        Float4& im)
+    {
+        re = (a_re * b_re) - (a_im * b_im);
+        im = (a_re * b_im) + (a_im * b_re);
+    }
+
+    // Transforms the complex sequence in the first work buffers, and points at
+    // the result.
+    //
+    // Each stage maps the n-point transforms of stride s into n/2-point ones of
+    // stride 2s:
+    //
+    //     y(q + s 2p) = x(q + s p) + x(q + s (p + n/2))
+    //     y(q + s (2p + 1)) = (x(q + s p) - x(q + s (p + n/2))) W(n)^p
+    //
+    // The first two stages run along p, and the rest along q.
+    void transform(
+        float*& re,
+        float*& im)
+    {
+        const auto size = size_ / 2;
+
+        auto x_re = work_re_[0].data();
+        auto x_im = work_im_[0].data();
+        auto y_re = work_re_[1].data();
+        auto y_im = work_im_[1].data();
+
+        auto n = size;
+        auto s = 1;
+
+        while (n > 1)
+        {
+            const auto m = n / 2;
+
+            if (s == 1)
+            {
+                for (int p = 0; p < m; p += 4)
+                {
+                    const auto a_re = Float4::load(&x_re[p]);
+                    const auto a_im = Float4::load(&x_im[p]);
+                    const auto b_re = Float4::load(&x_re[p + m]);
+                    const auto b_im = Float4::load(&x_im[p + m]);
+
+                    Float4 d_re;
+                    Float4 d_im;
+
+                    multiply(
+                        a_re - b_re,
+                        a_im - b_im,
+                        Float4::load(&twiddles_re_[p]),
+                        Float4::load(&twiddles_im_[p]),
+                        d_re,
+                        d_im);
+
+                    Float4 lo;
+                    Float4 hi;
+
+                    Float4::interleave(a_re + b_re, d_re, lo, hi);
+                    lo.store(&y_re[2 * p]);
+                    hi.store(&y_re[(2 * p) + 4]);
+
+                    Float4::interleave(a_im + b_im, d_im, lo, hi);
+                    lo.store(&y_im[2 * p]);
+                    hi.store(&y_im[(2 * p) + 4]);
+                }
+            }
+            else if (s == 2)
+            {
+                // Two values of p with both values of q at a time.
+                for (int j = 0; j < (2 * m); j += 4)
+                {
+                    const auto a_re = Float4::load(&x_re[j]);
+                    const auto a_im = Float4::load(&x_im[j]);
+                    const auto b_re = Float4::load(&x_re[j + (2 * m)]);
+                    const auto b_im = Float4::load(&x_im[j + (2 * m)]);
+
+                    Float4 d_re;
+                    Float4 d_im;
+
+                    multiply(
+                        a_re - b_re,
+                        a_im - b_im,
+                        Float4::load(&pair_twiddles_re_[j]),
+                        Float4::load(&pair_twiddles_im_[j]),
+                        d_re,
+                        d_im);
+
+                    Float4 lo;
+                    Float4 hi;
+
+                    Float4::interleave_pairs(a_re + b_re, d_re, lo, hi);
+                    lo.store(&y_re[2 * j]);
+                    hi.store(&y_re[(2 * j) + 4]);
+
+                    Float4::interleave_pairs(a_im + b_im, d_im, lo, hi);
+                    lo.store(&y_im[2 * j]);
+                    hi.store(&y_im[(2 * j) + 4]);
+                }
+            }
+            else
+            {
+                for (int p = 0; p < m; ++p)
+                {
+                    const auto w_re = Float4::set1(twiddles_re_[p * s]);
+                    const auto w_im = Float4::set1(twiddles_im_[p * s]);
+
+                    const auto a_offset = s * p;
+                    const auto b_offset = s * (p + m);
+                    const auto y0_offset = s * 2 * p;
+                    const auto y1_offset = y0_offset + s;
+
+                    for (int q = 0; q < s; q += 4)
+                    {
+                        const auto a_re = Float4::load(&x_re[a_offset + q]);
+                        const auto a_im = Float4::load(&x_im[a_offset + q]);
+                        const auto b_re = Float4::load(&x_re[b_offset + q]);
+                        const auto b_im = Float4::load(&x_im[b_offset + q]);
+
+                        (a_re + b_re).store(&y_re[y0_offset + q]);
+                        (a_im + b_im).store(&y_im[y0_offset + q]);
+
+                        Float4 d_re;
+                        Float4 d_im;
+
+                        multiply(a_re - b_re, a_im - b_im, w_re, w_im, d_re, d_im);
+
+                        d_re.store(&y_re[y1_offset + q]);
+                        d_im.store(&y_im[y1_offset + q]);
+                    }
+                }
+            }
+
+            n = m;
+            s *= 2;
+
+            std::swap(x_re, y_re);
+            std::swap(x_im, y_im);
+        }
+
+        re = x_re;
+        im = x_im;
+    }
+}; // RealFft
+
+struct Source
+{
+    struct Send
+    {
+        struct Channel
+        {
+            FilterState low_pass_;
+            FilterState high_pass_;
+            Gains current_gains_;
+            Gains target_gains_;
+
+
+            void reset()
+            {
+                low_pass_.reset();
+                high_pass_.reset();
+
+                current_gains_.fill(0.0F);
+                target_gains_.fill(0.0F);
+            }
+        }; // Channel
+
+        using Channels = std::array<Channel, max_channels>;
+
+
+        SendProps props_;
+        SendProps deferred_props_;
+
+        ActiveFilters filter_type_;
+        Channels channels_;
+        SampleBuffers* buffers_;
+        int channel_count_;
+    }; // Send
+
+    using Sends = std::vector<Send>;
+
+
+    Send direct_;
+    Sends auxes_;
+    bool are_props_changed_;
+
+
+    void initialize(
+        const int effect_count)
+    {
+        direct_.props_.set_defaults();
+        direct_.deferred_props_.set_defaults();
+
+        auxes_.clear();
+        auxes_.resize(effect_count);
+
+        for (auto& aux : auxes_)
+        {
+            aux.props_.set_defaults();
+            aux.deferred_props_.set_defaults();
+        }
+
+        are_props_changed_ = true;
+    }
+}; // Source
+
+
+// ==========================================================================
+// EffectProps
+
+constexpr float EffectProps::Reverb::default_reflections_pan_xyz;
+constexpr float EffectProps::Reverb::default_late_reverb_pan_xyz;
+constexpr float EffectProps::Reverb::max_echo_time;
+
+
+void EffectProps::Chorus::set_defaults()
+{
+    waveform_ = default_waveform;
+    phase_ = default_phase;
+    rate_ = default_rate;
+    depth_ = default_depth;
+    feedback_ = default_feedback;
+    delay_ = default_delay;
+}
+
+void EffectProps::Chorus::normalize()
+{
+    Math::clamp_i(waveform_, min_waveform, max_waveform);
+    Math::clamp_i(phase_, min_phase, max_phase);
+    Math::clamp_i(rate_, min_rate, max_rate);
+    Math::clamp_i(depth_, min_depth, max_depth);
+    Math::clamp_i(feedback_, min_feedback, max_feedback);
+    Math::clamp_i(delay_, min_delay, max_delay);
+}
+
+bool EffectProps::Chorus::are_equal(
+    const Chorus& a,
+    const Chorus& b)
+{
+    return
+        a.waveform_ == b.waveform_ &&
+        a.phase_ == b.phase_ &&
+        a.rate_ == b.rate_ &&
+        a.depth_ == b.depth_ &&
+        a.feedback_ == b.feedback_ &&
+        a.delay_ == b.delay_;
+}
+
+void EffectProps::Compressor::set_defaults()
+{
+    on_off_ = default_on_off;
+}
+
+void EffectProps::Compressor::normalize()
+{
+}
+
+bool EffectProps::Compressor::are_equal(
+    const Compressor& a,
+    const Compressor& b)
+{
+    return
+        a.on_off_ == b.on_off_;
+}
+
+void EffectProps::Convolution::set_defaults()
+{
+    impulse_response_ = nullptr;
+    partitioning_ = default_partitioning;
+    gain_ = default_gain;
+}
+
+void EffectProps::Convolution::normalize()
+{
+    Math::clamp_i(partitioning_, min_partitioning, max_partitioning);
+    Math::clamp_i(gain_, min_gain, max_gain);
+}
+
+bool EffectProps::Convolution::are_equal(
+    const Convolution& a,
+    const Convolution& b)
+{
+    return
+        a.impulse_response_ == b.impulse_response_ &&
+        a.partitioning_ == b.partitioning_ &&
+        a.gain_ == b.gain_;
+}
+
+void EffectProps::Dedicated::set_defaults()
+{
+    gain_ = default_gain;
+}
+
+void EffectProps::Dedicated::normalize()
+{
+    Math::clamp_i(gain_, min_gain, max_gain);
+}
+
+bool EffectProps::Dedicated::are_equal(
+    const Dedicated& a,
+    const Dedicated& b)
+{
+    return
+        a.gain_ == b.gain_;
+}
+
+void EffectProps::Distortion::set_defaults()
+{
+    edge_ = default_edge;
+    gain_ = default_gain;
+    low_pass_cutoff_ = default_low_pass_cutoff;
+    eq_center_ = default_eq_center;
+    eq_bandwidth_ = default_eq_bandwidth;
+}
+
+void EffectProps::Distortion::normalize()
+{
+    Math::clamp_i(edge_, min_edge, max_edge);
+    Math::clamp_i(gain_, min_gain, max_gain);
+    Math::clamp_i(low_pass_cutoff_, min_low_pass_cutoff, max_low_pass_cutoff);
+    Math::clamp_i(eq_center_, min_eq_center, max_eq_center);
+    Math::clamp_i(eq_bandwidth_, min_eq_bandwidth, max_eq_bandwidth);
+}
+
+bool EffectProps::Distortion::are_equal(
+    const Distortion& a,
+    const Distortion& b)
+{
+    return
+        a.edge_ == b.edge_ &&
+        a.gain_ == b.gain_ &&
+        a.low_pass_cutoff_ == b.low_pass_cutoff_ &&
+        a.eq_center_ == b.eq_center_ &&
+        a.eq_bandwidth_ == b.eq_bandwidth_;
+}
+
+void EffectProps::Dynamics::set_defaults()
+{
+    detector_ = default_detector;
+    threshold_ = default_threshold;
+    ratio_ = default_ratio;
+    knee_ = default_knee;
+    attack_time_ = default_attack_time;
+    release_time_ = default_release_time;
+    makeup_gain_ = default_makeup_gain;
+}
+
+void EffectProps::Dynamics::normalize()
+{
+    Math::clamp_i(detector_, min_detector, max_detector);
+    Math::clamp_i(threshold_, min_threshold, max_threshold);
+    Math::clamp_i(ratio_, min_ratio, max_ratio);
+    Math::clamp_i(knee_, min_knee, max_knee);
+    Math::clamp_i(attack_time_, min_attack_time, max_attack_time);
+    Math::clamp_i(release_time_, min_release_time, max_release_time);
+    Math::clamp_i(makeup_gain_, min_makeup_gain, max_makeup_gain);
+}
+
+bool EffectProps::Dynamics::are_equal(
+    const Dynamics& a,
+    const Dynamics& b)
+{
+    return
+        a.detector_ == b.detector_ &&
+        a.threshold_ == b.threshold_ &&
+        a.ratio_ == b.ratio_ &&
+        a.knee_ == b.knee_ &&
+        a.attack_time_ == b.attack_time_ &&
+        a.release_time_ == b.release_time_ &&
+        a.makeup_gain_ == b.makeup_gain_;
+}
+
+void EffectProps::Echo::set_defaults()
+{
+    delay_ = default_delay;
+    lr_delay_ = default_lr_delay;
+    damping_ = default_damping;
+    feedback_ = default_feedback;
+    spread_ = default_spread;
+}
+
+void EffectProps::Echo::normalize()
+{
+    Math::clamp_i(delay_, min_delay, max_delay);
+    Math::clamp_i(lr_delay_, min_lr_delay, max_lr_delay);
+    Math::clamp_i(damping_, min_damping, max_damping);
+    Math::clamp_i(feedback_, min_feedback, max_feedback);
+    Math::clamp_i(spread_, min_spread, max_spread);
+}
+
+bool EffectProps::Echo::are_equal(
+    const Echo& a,
+    const Echo& b)
+{
+    return
+        a.delay_ == b.delay_ &&
+        a.lr_delay_ == b.lr_delay_ &&
+        a.damping_ == b.damping_ &&
+        a.feedback_ == b.feedback_ &&
+        a.spread_ == b.spread_;
+}
+
+void EffectProps::Equalizer::set_defaults()
+{
+    low_cutoff_ = default_low_cutoff;
+    low_gain_ = default_high_gain;
+    mid1_center_ = default_mid1_center;
+    mid1_gain_ = default_mid1_gain;
+    mid1_width_ = default_mid1_width;
+    mid2_center_ = default_mid2_center;
+    mid2_gain_ = default_mid2_gain;
+    mid2_width_ = default_mid2_width;
+    high_cutoff_ = default_high_cutoff;
+    high_gain_ = default_high_gain;
+}
+
+void EffectProps::Equalizer::normalize()
+{
+    Math::clamp_i(low_cutoff_, min_low_cutoff, max_low_cutoff);
+    Math::clamp_i(low_gain_, min_low_gain, max_low_gain);
+    Math::clamp_i(mid1_center_, min_mid1_center, max_mid1_center);
+    Math::clamp_i(mid1_gain_, min_mid1_gain, max_mid1_gain);
+    Math::clamp_i(mid1_width_, min_mid1_width, max_mid1_width);
+    Math::clamp_i(mid2_center_, min_mid2_center, max_mid2_center);
+    Math::clamp_i(mid2_gain_, min_mid2_gain, max_mid2_gain);
+    Math::clamp_i(mid2_width_, min_mid2_width, max_mid2_width);
+    Math::clamp_i(high_cutoff_, min_high_cutoff, max_high_cutoff);
+    Math::clamp_i(high_gain_, min_high_gain, max_high_gain);
+}
+
+bool EffectProps::Equalizer::are_equal(
+    const Equalizer& a,
+    const Equalizer& b)
+{
+    return
+        a.low_cutoff_ == b.low_cutoff_ &&
+        a.low_gain_ == b.low_gain_ &&
+        a.mid1_center_ == b.mid1_center_ &&
+        a.mid1_gain_ == b.mid1_gain_ &&
+        a.mid1_width_ == b.mid1_width_ &&
+        a.mid2_center_ == b.mid2_center_ &&
+        a.mid2_gain_ == b.mid2_gain_ &&
+        a.mid2_width_ == b.mid2_width_ &&
+        a.high_cutoff_ == b.high_cutoff_ &&
+        a.high_gain_ == b.high_gain_;
+}
+
+void EffectProps::Flanger::set_defaults()
+{
+    waveform_ = default_waveform;
+    phase_ = default_phase;
+    rate_ = default_rate;
+    depth_ = default_depth;
+    feedback_ = default_feedback;
+    delay_ = default_delay;
+}
+
+void EffectProps::Flanger::normalize()
+{
+    Math::clamp_i(waveform_, min_waveform, max_waveform);
+    Math::clamp_i(phase_, min_phase, max_phase);
+    Math::clamp_i(rate_, min_rate, max_rate);
+    Math::clamp_i(depth_, min_depth, max_depth);
+    Math::clamp_i(feedback_, min_feedback, max_feedback);
+    Math::clamp_i(delay_, min_delay, max_delay);
+}
+
+bool EffectProps::Flanger::are_equal(
+    const Flanger& a,
+    const Flanger& b)
+{
+    return
+        a.waveform_ == b.waveform_ &&
+        a.phase_ == b.phase_ &&
+        a.rate_ == b.rate_ &&
+        a.depth_ == b.depth_ &&
+        a.feedback_ == b.feedback_ &&
+        a.delay_ == b.delay_;
+}
+
+void EffectProps::MultiTapEcho::set_defaults()
+{
+    tap_count_ = default_tap_count;
+
+    for (int i = 0; i < max_taps; ++i)
+    {
+        auto& tap = taps_[i];
+
+        tap.delay_ = default_delay * (i + 1);
+        tap.gain_ = default_gain;
+        tap.pan_ = default_pan;
+    }
+
+    damping_ = default_damping;
+    feedback_ = default_feedback;
+}
+
+void EffectProps::MultiTapEcho::normalize()
+{
+    Math::clamp_i(tap_count_, min_tap_count, max_tap_count);
+
+    for (auto& tap : taps_)
+    {
+        Math::clamp_i(tap.delay_, min_delay, max_delay);
+        Math::clamp_i(tap.gain_, min_gain, max_gain);
+        Math::clamp_i(tap.pan_, min_pan, max_pan);
+    }
+
+    Math::clamp_i(damping_, min_damping, max_damping);
+    Math::clamp_i(feedback_, min_feedback, max_feedback);
+}
+
+bool EffectProps::MultiTapEcho::are_equal(
+    const MultiTapEcho& a,
+    const MultiTapEcho& b)
+{
+    if (a.tap_count_ != b.tap_count_ ||
+        a.damping_ != b.damping_ ||
+        a.feedback_ != b.feedback_)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < a.tap_count_; ++i)
+    {
+        const auto& tap_a = a.taps_[i];
+        const auto& tap_b = b.taps_[i];
+
+        if (tap_a.delay_ != tap_b.delay_ ||
+            tap_a.gain_ != tap_b.gain_ ||
+            tap_a.pan_ != tap_b.pan_)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void EffectProps::Reverb::set_defaults()
+{
+    density_ = default_density;
+    diffusion_ = default_diffusion;
+    gain_ = default_gain;
+    gain_hf_ = default_gain_hf;
+    gain_lf_ = default_gain_lf;
+    decay_time_ = default_decay_time;
+    decay_hf_ratio_ = default_decay_hf_ratio;
+    decay_lf_ratio_ = default_decay_lf_ratio;
+    reflections_gain_ = default_reflections_gain;
+    reflections_delay_ = default_reflections_delay;
+    reflections_pan_.fill(default_reflections_pan_xyz);
+    late_reverb_gain_ = default_late_reverb_gain;
+    late_reverb_delay_ = default_late_reverb_delay;
+    late_reverb_pan_.fill(default_late_reverb_pan_xyz);
+    echo_time_ = default_echo_time;
+    echo_depth_ = default_echo_depth;
+    modulation_time_ = default_modulation_time;
+    modulation_depth_ = default_modulation_depth;
+    air_absorption_gain_hf_ = default_air_absorption_gain_hf;
+    hf_reference_ = default_hf_reference;
+    lf_reference_ = default_lf_reference;
+    room_rolloff_factor_ = default_room_rolloff_factor;
+    decay_hf_limit_ = default_decay_hf_limit;
+    quality_ = default_quality;
+}
+
+void EffectProps::Reverb::normalize()
+{
+    Math::clamp_i(density_, min_density, max_density);
+    Math::clamp_i(diffusion_, min_diffusion, max_diffusion);
+    Math::clamp_i(gain_, min_gain, max_gain);
+    Math::clamp_i(gain_hf_, min_gain_hf, max_gain_hf);
+    Math::clamp_i(gain_lf_, min_gain_lf, max_gain_lf);
+    Math::clamp_i(decay_time_, min_decay_time, max_decay_time);
+    Math::clamp_i(decay_hf_ratio_, min_decay_hf_ratio, max_decay_hf_ratio);
+    Math::clamp_i(decay_lf_ratio_, min_decay_lf_ratio, max_decay_lf_ratio);
+    Math::clamp_i(reflections_gain_, min_reflections_gain, max_reflections_gain);
+    Math::clamp_i(reflections_delay_, min_reflections_delay, max_reflections_delay);
+    Math::clamp_i(reflections_pan_[0], min_reflections_pan_xyz, max_reflections_pan_xyz);
+    Math::clamp_i(reflections_pan_[1], min_reflections_pan_xyz, max_reflections_pan_xyz);
+    Math::clamp_i(reflections_pan_[2], min_reflections_pan_xyz, max_reflections_pan_xyz);
+    Math::clamp_i(late_reverb_gain_, min_late_reverb_gain, max_late_reverb_gain);
+    Math::clamp_i(late_reverb_delay_, min_late_reverb_delay, max_late_reverb_delay);
+    Math::clamp_i(late_reverb_pan_[0], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
+    Math::clamp_i(late_reverb_pan_[1], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
+    Math::clamp_i(late_reverb_pan_[2], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
+    Math::clamp_i(echo_time_, min_echo_time, max_echo_time);
+    Math::clamp_i(echo_depth_, min_echo_depth, max_echo_depth);
+    Math::clamp_i(modulation_time_, min_modulation_time, max_modulation_time);
+    Math::clamp_i(modulation_depth_, min_modulation_depth, max_modulation_depth);
+    Math::clamp_i(air_absorption_gain_hf_, min_air_absorption_gain_hf, max_air_absorption_gain_hf);
+    Math::clamp_i(hf_reference_, min_hf_reference, max_hf_reference);
+    Math::clamp_i(lf_reference_, min_lf_reference, max_lf_reference);
+    Math::clamp_i(room_rolloff_factor_, min_room_rolloff_factor, max_room_rolloff_factor);
+    Math::clamp_i(decay_hf_limit_, min_decay_hf_limit, max_decay_hf_limit);
+    Math::clamp_i(quality_, min_quality, max_quality);
+}
+
+bool EffectProps::Reverb::are_equal(
+    const Reverb& a,
+    const Reverb& b)
+{
+    return
+        a.density_ == b.density_ &&
+        a.diffusion_ == b.diffusion_ &&
+        a.gain_ == b.gain_ &&
+        a.gain_hf_ == b.gain_hf_ &&
+        a.gain_lf_ == b.gain_lf_ &&
+        a.decay_time_ == b.decay_time_ &&
+        a.decay_hf_ratio_ == b.decay_hf_ratio_ &&
+        a.decay_lf_ratio_ == b.decay_lf_ratio_ &&
+        a.reflections_gain_ == b.reflections_gain_ &&
+        a.reflections_delay_ == b.reflections_delay_ &&
+        a.reflections_pan_ == b.reflections_pan_ &&
+        a.late_reverb_gain_ == b.late_reverb_gain_ &&
+        a.late_reverb_delay_ == b.late_reverb_delay_ &&
+        a.late_reverb_pan_ == b.late_reverb_pan_ &&
+        a.echo_time_ == b.echo_time_ &&
+        a.echo_depth_ == b.echo_depth_ &&
+        a.modulation_time_ == b.modulation_time_ &&
+        a.modulation_depth_ == b.modulation_depth_ &&
+        a.air_absorption_gain_hf_ == b.air_absorption_gain_hf_ &&
+        a.hf_reference_ == b.hf_reference_ &&
+        a.lf_reference_ == b.lf_reference_ &&
+        a.room_rolloff_factor_ == b.room_rolloff_factor_ &&
+        a.decay_hf_limit_ == b.decay_hf_limit_ &&
+        a.quality_ == b.quality_;
+}
+
+void EffectProps::RingModulator::set_defaults()
+{
+    frequency_ = default_frequency;
+    high_pass_cutoff_ = default_high_pass_cutoff;
+    waveform_ = default_waveform;
+}
+
+void EffectProps::RingModulator::normalize()
+{
+    Math::clamp_i(frequency_, min_frequency, max_frequency);
+    Math::clamp_i(high_pass_cutoff_, min_high_pass_cutoff, max_high_pass_cutoff);
+    Math::clamp_i(waveform_, min_waveform, max_waveform);
+}
+
+bool EffectProps::RingModulator::are_equal(
+    const RingModulator& a,
+    const RingModulator& b)
+{
+    return
+        a.frequency_ == b.frequency_ &&
+        a.high_pass_cutoff_ == b.high_pass_cutoff_ &&
+        a.waveform_ == b.waveform_;
+}
+
+// EffectProps
+// ==========================================================================
+
+
+// ==========================================================================
+// Effect
+
+void Effect::set_defaults()
+{
+    switch (type_)
+    {
+    case EffectType::chorus:
+        props_.chorus_.set_defaults();
+        break;
+
+    case EffectType::compressor:
+        props_.compressor_.set_defaults();
+        break;
+
+    case EffectType::convolution:
+        props_.convolution_.set_defaults();
+        break;
+
+    case EffectType::dedicated_dialog:
+    case EffectType::dedicated_low_frequency:
+        props_.dedicated_.set_defaults();
+        break;
+
+    case EffectType::distortion:
+        props_.distortion_.set_defaults();
+        break;
+
+    case EffectType::dynamics:
+        props_.dynamics_.set_defaults();
+        break;
+
+    case EffectType::echo:
+        props_.echo_.set_defaults();
+        break;
+
+    case EffectType::equalizer:
+        props_.equalizer_.set_defaults();
+        break;
+
+    case EffectType::flanger:
+        props_.flanger_.set_defaults();
+        break;
+
+    case EffectType::multi_tap_echo:
+        props_.multi_tap_echo_.set_defaults();
+        break;
+
+    case EffectType::eax_reverb:
+    case EffectType::reverb:
+        props_.reverb_.set_defaults();
+        break;
+
+    case EffectType::ring_modulator:
+        props_.ring_modulator_.set_defaults();
+        break;
+
+    case EffectType::null:
+    default:
+        break;
+    }
+}
+
+void Effect::set_type_and_defaults(
+    const EffectType effect_type)
+{
+    type_ = effect_type;
+    set_defaults();
+}
+
+void Effect::normalize()
+{
+    switch (type_)
+    {
+    case EffectType::chorus:
+        props_.chorus_.normalize();
+        break;
+
+    case EffectType::compressor:
+        props_.compressor_.normalize();
+        break;
+
+    case EffectType::convolution:
+        props_.convolution_.normalize();
+        break;
+
+    case EffectType::dedicated_dialog:
+    case EffectType::dedicated_low_frequency:
+        props_.dedicated_.normalize();
+        break;
+
+    case EffectType::distortion:
+        props_.distortion_.normalize();
+        break;
+
+    case EffectType::dynamics:
+        props_.dynamics_.normalize();
+        break;
+
+    case EffectType::echo:
+        props_.echo_.normalize();
+        break;
+
+    case EffectType::equalizer:
+        props_.equalizer_.normalize();
+        break;
+
+    case EffectType::flanger:
+        props_.flanger_.normalize();
+        break;
+
+    case EffectType::multi_tap_echo:
+        props_.multi_tap_echo_.normalize();
+        break;
+
+    case EffectType::eax_reverb:
+    case EffectType::reverb:
+        props_.reverb_.normalize();
+        break;
+
+    case EffectType::ring_modulator:
+        props_.ring_modulator_.normalize();
+        break;
+
+    case EffectType::null:
+    default:
+        break;
+    }
+}
+
+bool Effect::are_equal(
+    const Effect& a,
+    const Effect& b)
+{
+    if (a.type_ != b.type_)
+    {
+        return false;
+    }
+
+    switch (a.type_)
+    {
+    case EffectType::null:
+        return true;
+
+    case EffectType::chorus:
+        return EffectProps::Chorus::are_equal(a.props_.chorus_, b.props_.chorus_);
+
+    case EffectType::compressor:
+        return EffectProps::Compressor::are_equal(a.props_.compressor_, b.props_.compressor_);
+
+    case EffectType::convolution:
+        return EffectProps::Convolution::are_equal(a.props_.convolution_, b.props_.convolution_);
+
+    case EffectType::dedicated_dialog:
+    case EffectType::dedicated_low_frequency:
+        return EffectProps::Dedicated::are_equal(a.props_.dedicated_, b.props_.dedicated_);
+
+    case EffectType::distortion:
+        return EffectProps::Distortion::are_equal(a.props_.distortion_, b.props_.distortion_);
+
+    case EffectType::dynamics:
+        return EffectProps::Dynamics::are_equal(a.props_.dynamics_, b.props_.dynamics_);
+
+    case EffectType::echo:
+        return EffectProps::Echo::are_equal(a.props_.echo_, b.props_.echo_);
+
+    case EffectType::equalizer:
+        return EffectProps::Equalizer::are_equal(a.props_.equalizer_, b.props_.equalizer_);
+
+    case EffectType::flanger:
+        return EffectProps::Flanger::are_equal(a.props_.flanger_, b.props_.flanger_);
+
+    case EffectType::multi_tap_echo:
+        return EffectProps::MultiTapEcho::are_equal(a.props_.multi_tap_echo_, b.props_.multi_tap_echo_);
+
+    case EffectType::eax_reverb:
+    case EffectType::reverb:
+        return EffectProps::Reverb::are_equal(a.props_.reverb_, b.props_.reverb_);
+
+    case EffectType::ring_modulator:
+        return EffectProps::RingModulator::are_equal(a.props_.ring_modulator_, b.props_.ring_modulator_);
+
+    default:
+        return false;
+    }
+}
+
+// Effect
+// ==========================================================================
+
+
+// ==========================================================================
+// SendProps
+
+void SendProps::set_defaults()
+{
+    gain_ = default_gain;
+    gain_hf_ = default_gain_hf;
+    gain_lf_ = default_gain_lf;
+}
+
+void SendProps::normalize()
+{
+    Math::clamp_i(gain_, min_gain, max_gain);
+    Math::clamp_i(gain_hf_, min_gain_hf, max_gain_hf);
+    Math::clamp_i(gain_lf_, min_gain_lf, max_gain_lf);
+}
+
+bool SendProps::are_equal(
+    const SendProps& a,
+    const SendProps& b)
+{
+    return
+        a.gain_ == b.gain_ &&
+        a.gain_hf_ == b.gain_hf_ &&
+        a.gain_lf_ == b.gain_lf_;
+}
+
+// SendProps
+// ==========================================================================
+
+// ==========================================================================
+// Reverb presets
+
+// Default
+//
+const EffectProps::Reverb ReverbPresets::Default::generic = {1.0000F, 1.0000F, 0.3162F, 0.8913F, 1.0000F, 1.4900F, 0.8300F, 1.0000F, 0.0500F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::padded_cell = {0.1715F, 1.0000F, 0.3162F, 0.0010F, 1.0000F, 0.1700F, 0.1000F, 1.0000F, 0.2500F, 0.0010F, {0.0000F, 0.0000F, 0.0000F}, 1.2691F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::room = {0.4287F, 1.0000F, 0.3162F, 0.5929F, 1.0000F, 0.4000F, 0.8300F, 1.0000F, 0.1503F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 1.0629F, 0.0030F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::bathroom = {0.1715F, 1.0000F, 0.3162F, 0.2512F, 1.0000F, 1.4900F, 0.5400F, 1.0000F, 0.6531F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 3.2734F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::living_room = {0.9766F, 1.0000F, 0.3162F, 0.0010F, 1.0000F, 0.5000F, 0.1000F, 1.0000F, 0.2051F, 0.0030F, {0.0000F, 0.0000F, 0.0000F}, 0.2805F, 0.0040F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::stone_room = {1.0000F, 1.0000F, 0.3162F, 0.7079F, 1.0000F, 2.3100F, 0.6400F, 1.0000F, 0.4411F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1003F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::auditorium = {1.0000F, 1.0000F, 0.3162F, 0.5781F, 1.0000F, 4.3200F, 0.5900F, 1.0000F, 0.4032F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.7170F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::concert_hall = {1.0000F, 1.0000F, 0.3162F, 0.5623F, 1.0000F, 3.9200F, 0.7000F, 1.0000F, 0.2427F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.9977F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::cave = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 1.0000F, 2.9100F, 1.3000F, 1.0000F, 0.5000F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.7063F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::arena = {1.0000F, 1.0000F, 0.3162F, 0.4477F, 1.0000F, 7.2400F, 0.3300F, 1.0000F, 0.2612F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.0186F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::hangar = {1.0000F, 1.0000F, 0.3162F, 0.3162F, 1.0000F, 10.0500F, 0.2300F, 1.0000F, 0.5000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2560F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::carpeted_hallway = {0.4287F, 1.0000F, 0.3162F, 0.0100F, 1.0000F, 0.3000F, 0.1000F, 1.0000F, 0.1215F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 0.1531F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::hallway = {0.3645F, 1.0000F, 0.3162F, 0.7079F, 1.0000F, 1.4900F, 0.5900F, 1.0000F, 0.2458F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.6615F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::stone_corridor = {1.0000F, 1.0000F, 0.3162F, 0.7612F, 1.0000F, 2.7000F, 0.7900F, 1.0000F, 0.2472F, 0.0130F, {0.0000F, 0.0000F, 0.0000F}, 1.5758F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::alley = {1.0000F, 0.3000F, 0.3162F, 0.7328F, 1.0000F, 1.4900F, 0.8600F, 1.0000F, 0.2500F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.9954F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.9500F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::forest = {1.0000F, 0.3000F, 0.3162F, 0.0224F, 1.0000F, 1.4900F, 0.5400F, 1.0000F, 0.0525F, 0.1620F, {0.0000F, 0.0000F, 0.0000F}, 0.7682F, 0.0880F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::city = {1.0000F, 0.5000F, 0.3162F, 0.3981F, 1.0000F, 1.4900F, 0.6700F, 1.0000F, 0.0730F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.1427F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::mountains = {1.0000F, 0.2700F, 0.3162F, 0.0562F, 1.0000F, 1.4900F, 0.2100F, 1.0000F, 0.0407F, 0.3000F, {0.0000F, 0.0000F, 0.0000F}, 0.1919F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::quarry = {1.0000F, 1.0000F, 0.3162F, 0.3162F, 1.0000F, 1.4900F, 0.8300F, 1.0000F, 0.0000F, 0.0610F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0250F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.7000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::plain = {1.0000F, 0.2100F, 0.3162F, 0.1000F, 1.0000F, 1.4900F, 0.5000F, 1.0000F, 0.0585F, 0.1790F, {0.0000F, 0.0000F, 0.0000F}, 0.1089F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::parking_lot = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 1.0000F, 1.6500F, 1.5000F, 1.0000F, 0.2082F, 0.0080F, {0.0000F, 0.0000F, 0.0000F}, 0.2652F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::sewer_pipe = {0.3071F, 0.8000F, 0.3162F, 0.3162F, 1.0000F, 2.8100F, 0.1400F, 1.0000F, 1.6387F, 0.0140F, {0.0000F, 0.0000F, 0.0000F}, 3.2471F, 0.0210F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::underwater = {0.3645F, 1.0000F, 0.3162F, 0.0100F, 1.0000F, 1.4900F, 0.1000F, 1.0000F, 0.5963F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 7.0795F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 1.1800F, 0.3480F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::drugged = {0.4287F, 0.5000F, 0.3162F, 1.0000F, 1.0000F, 8.3900F, 1.3900F, 1.0000F, 0.8760F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 3.1081F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 1.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::dizzy = {0.3645F, 0.6000F, 0.3162F, 0.6310F, 1.0000F, 17.2300F, 0.5600F, 1.0000F, 0.1392F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.4937F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.8100F, 0.3100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Default::psychotic = {0.0625F, 0.5000F, 0.3162F, 0.8404F, 1.0000F, 7.5600F, 0.9100F, 1.0000F, 0.4864F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 2.4378F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 4.0000F, 1.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Castle
+//
+const EffectProps::Reverb ReverbPresets::Castle::small_room = {1.0000F, 0.8900F, 0.3162F, 0.3981F, 0.1000F, 1.2200F, 0.8300F, 0.3100F, 0.8913F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::short_passage = {1.0000F, 0.8900F, 0.3162F, 0.3162F, 0.1000F, 2.3200F, 0.8300F, 0.3100F, 0.8913F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::medium_room = {1.0000F, 0.9300F, 0.3162F, 0.2818F, 0.1000F, 2.0400F, 0.8300F, 0.4600F, 0.6310F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1550F, 0.0300F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::large_room = {1.0000F, 0.8200F, 0.3162F, 0.2818F, 0.1259F, 2.5300F, 0.8300F, 0.5000F, 0.4467F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1850F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::long_passage = {1.0000F, 0.8900F, 0.3162F, 0.3981F, 0.1000F, 3.4200F, 0.8300F, 0.3100F, 0.8913F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::hall = {1.0000F, 0.8100F, 0.3162F, 0.2818F, 0.1778F, 3.1400F, 0.7900F, 0.6200F, 0.1778F, 0.0560F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::cupboard = {1.0000F, 0.8900F, 0.3162F, 0.2818F, 0.1000F, 0.6700F, 0.8700F, 0.3100F, 1.4125F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 3.5481F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::courtyard = {1.0000F, 0.4200F, 0.3162F, 0.4467F, 0.1995F, 2.1300F, 0.6100F, 0.2300F, 0.2239F, 0.1600F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0360F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.3700F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Castle::alcove = {1.0000F, 0.8900F, 0.3162F, 0.5012F, 0.1000F, 1.6400F, 0.8700F, 0.3100F, 1.0000F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Factory
+//
+const EffectProps::Reverb ReverbPresets::Factory::small_room = {0.3645F, 0.8200F, 0.3162F, 0.7943F, 0.5012F, 1.7200F, 0.6500F, 1.3100F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.1190F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::short_passage = {0.3645F, 0.6400F, 0.2512F, 0.7943F, 0.5012F, 2.5300F, 0.6500F, 1.3100F, 1.0000F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.1350F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::medium_room = {0.4287F, 0.8200F, 0.2512F, 0.7943F, 0.5012F, 2.7600F, 0.6500F, 1.3100F, 0.2818F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1740F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::large_room = {0.4287F, 0.7500F, 0.2512F, 0.7079F, 0.6310F, 4.2400F, 0.5100F, 1.3100F, 0.1778F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.2310F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::long_passage = {0.3645F, 0.6400F, 0.2512F, 0.7943F, 0.5012F, 4.0600F, 0.6500F, 1.3100F, 1.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0370F, {0.0000F, 0.0000F, 0.0000F}, 0.1350F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::hall = {0.4287F, 0.7500F, 0.3162F, 0.7079F, 0.6310F, 7.4300F, 0.5100F, 1.3100F, 0.0631F, 0.0730F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::cupboard = {0.3071F, 0.6300F, 0.2512F, 0.7943F, 0.5012F, 0.4900F, 0.6500F, 1.3100F, 1.2589F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.1070F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::courtyard = {0.3071F, 0.5700F, 0.3162F, 0.3162F, 0.6310F, 2.3200F, 0.2900F, 0.5600F, 0.2239F, 0.1400F, {0.0000F, 0.0000F, 0.0000F}, 0.3981F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2900F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Factory::alcove = {0.3645F, 0.5900F, 0.2512F, 0.7943F, 0.5012F, 3.1400F, 0.6500F, 1.3100F, 1.4125F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.1140F, 0.1000F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Ice palace
+//
+const EffectProps::Reverb ReverbPresets::IcePalace::small_room = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 0.2818F, 1.5100F, 1.5300F, 0.2700F, 0.8913F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1640F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::short_passage = {1.0000F, 0.7500F, 0.3162F, 0.5623F, 0.2818F, 1.7900F, 1.4600F, 0.2800F, 0.5012F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.1770F, 0.0900F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::medium_room = {1.0000F, 0.8700F, 0.3162F, 0.5623F, 0.4467F, 2.2200F, 1.5300F, 0.3200F, 0.3981F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.1860F, 0.1200F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::large_room = {1.0000F, 0.8100F, 0.3162F, 0.5623F, 0.4467F, 3.1400F, 1.5300F, 0.3200F, 0.2512F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.2140F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::long_passage = {1.0000F, 0.7700F, 0.3162F, 0.5623F, 0.3981F, 3.0100F, 1.4600F, 0.2800F, 0.7943F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0250F, {0.0000F, 0.0000F, 0.0000F}, 0.1860F, 0.0400F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::hall = {1.0000F, 0.7600F, 0.3162F, 0.4467F, 0.5623F, 5.4900F, 1.5300F, 0.3800F, 0.1122F, 0.0540F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0520F, {0.0000F, 0.0000F, 0.0000F}, 0.2260F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::cupboard = {1.0000F, 0.8300F, 0.3162F, 0.5012F, 0.2239F, 0.7600F, 1.5300F, 0.2600F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1430F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::courtyard = {1.0000F, 0.5900F, 0.3162F, 0.2818F, 0.3162F, 2.0400F, 1.2000F, 0.3800F, 0.3162F, 0.1730F, {0.0000F, 0.0000F, 0.0000F}, 0.3162F, 0.0430F, {0.0000F, 0.0000F, 0.0000F}, 0.2350F, 0.4800F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::IcePalace::alcove = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 0.2818F, 2.7600F, 1.4600F, 0.2800F, 1.1220F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1610F, 0.0900F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Space station
+//
+const EffectProps::Reverb ReverbPresets::SpaceStation::small_room = {0.2109F, 0.7000F, 0.3162F, 0.7079F, 0.8913F, 1.7200F, 0.8200F, 0.5500F, 0.7943F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0130F, {0.0000F, 0.0000F, 0.0000F}, 0.1880F, 0.2600F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::short_passage = {0.2109F, 0.8700F, 0.3162F, 0.6310F, 0.8913F, 3.5700F, 0.5000F, 0.5500F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1720F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::medium_room = {0.2109F, 0.7500F, 0.3162F, 0.6310F, 0.8913F, 3.0100F, 0.5000F, 0.5500F, 0.3981F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0350F, {0.0000F, 0.0000F, 0.0000F}, 0.2090F, 0.3100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::large_room = {0.3645F, 0.8100F, 0.3162F, 0.6310F, 0.8913F, 3.8900F, 0.3800F, 0.6100F, 0.3162F, 0.0560F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0350F, {0.0000F, 0.0000F, 0.0000F}, 0.2330F, 0.2800F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::long_passage = {0.4287F, 0.8200F, 0.3162F, 0.6310F, 0.8913F, 4.6200F, 0.6200F, 0.5500F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0310F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::hall = {0.4287F, 0.8700F, 0.3162F, 0.6310F, 0.8913F, 7.1100F, 0.3800F, 0.6100F, 0.1778F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0470F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2500F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::cupboard = {0.1715F, 0.5600F, 0.3162F, 0.7079F, 0.8913F, 0.7900F, 0.8100F, 0.5500F, 1.4125F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0180F, {0.0000F, 0.0000F, 0.0000F}, 0.1810F, 0.3100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::SpaceStation::alcove = {0.2109F, 0.7800F, 0.3162F, 0.7079F, 0.8913F, 1.1600F, 0.8100F, 0.5500F, 1.4125F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0180F, {0.0000F, 0.0000F, 0.0000F}, 0.1920F, 0.2100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Wooden galeon
+//
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::small_room = {1.0000F, 1.0000F, 0.3162F, 0.1122F, 0.3162F, 0.7900F, 0.3200F, 0.8700F, 1.0000F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::short_passage = {1.0000F, 1.0000F, 0.3162F, 0.1259F, 0.3162F, 1.7500F, 0.5000F, 0.8700F, 0.8913F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::medium_room = {1.0000F, 1.0000F, 0.3162F, 0.1000F, 0.2818F, 1.4700F, 0.4200F, 0.8200F, 0.8913F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::large_room = {1.0000F, 1.0000F, 0.3162F, 0.0891F, 0.2818F, 2.6500F, 0.3300F, 0.8200F, 0.8913F, 0.0660F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::long_passage = {1.0000F, 1.0000F, 0.3162F, 0.1000F, 0.3162F, 1.9900F, 0.4000F, 0.7900F, 1.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.4467F, 0.0360F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::hall = {1.0000F, 1.0000F, 0.3162F, 0.0794F, 0.2818F, 3.4500F, 0.3000F, 0.8200F, 0.8913F, 0.0880F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0630F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::cupboard = {1.0000F, 1.0000F, 0.3162F, 0.1413F, 0.3162F, 0.5600F, 0.4600F, 0.9100F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::courtyard = {1.0000F, 0.6500F, 0.3162F, 0.0794F, 0.3162F, 1.7900F, 0.3500F, 0.7900F, 0.5623F, 0.1230F, {0.0000F, 0.0000F, 0.0000F}, 0.1000F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::WoodenGaleon::alcove = {1.0000F, 1.0000F, 0.3162F, 0.1259F, 0.3162F, 1.2200F, 0.6200F, 0.9100F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Sports
+//
+const EffectProps::Reverb ReverbPresets::Sports::empty_stadium = {1.0000F, 1.0000F, 0.3162F, 0.4467F, 0.7943F, 6.2600F, 0.5100F, 1.1000F, 0.0631F, 0.1830F, {0.0000F, 0.0000F, 0.0000F}, 0.3981F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::squash_court = {1.0000F, 0.7500F, 0.3162F, 0.3162F, 0.7943F, 2.2200F, 0.9100F, 1.1600F, 0.4467F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1260F, 0.1900F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::small_swimming_pool = {1.0000F, 0.7000F, 0.3162F, 0.7943F, 0.8913F, 2.7600F, 1.2500F, 1.1400F, 0.6310F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1790F, 0.1500F, 0.8950F, 0.1900F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::large_swimming_pool = {1.0000F, 0.8200F, 0.3162F, 0.7943F, 1.0000F, 5.4900F, 1.3100F, 1.1400F, 0.4467F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 0.5012F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2220F, 0.5500F, 1.1590F, 0.2100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::gymnasium = {1.0000F, 0.8100F, 0.3162F, 0.4467F, 0.8913F, 3.1400F, 1.0600F, 1.3500F, 0.3981F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.5623F, 0.0450F, {0.0000F, 0.0000F, 0.0000F}, 0.1460F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::full_stadium = {1.0000F, 1.0000F, 0.3162F, 0.0708F, 0.7943F, 5.2500F, 0.1700F, 0.8000F, 0.1000F, 0.1880F, {0.0000F, 0.0000F, 0.0000F}, 0.2818F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Sports::stadium_tannoy = {1.0000F, 0.7800F, 0.3162F, 0.5623F, 0.5012F, 2.5300F, 0.8800F, 0.6800F, 0.2818F, 0.2300F, {0.0000F, 0.0000F, 0.0000F}, 0.5012F, 0.0630F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Prefab
+//
+const EffectProps::Reverb ReverbPresets::Prefab::workshop = {0.4287F, 1.0000F, 0.3162F, 0.1413F, 0.3981F, 0.7600F, 1.0000F, 1.0000F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Prefab::school_room = {0.4022F, 0.6900F, 0.3162F, 0.6310F, 0.5012F, 0.9800F, 0.4500F, 0.1800F, 1.4125F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.0950F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Prefab::practise_room = {0.4022F, 0.8700F, 0.3162F, 0.3981F, 0.5012F, 1.1200F, 0.5600F, 0.1800F, 1.2589F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.0950F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Prefab::outhouse = {1.0000F, 0.8200F, 0.3162F, 0.1122F, 0.1585F, 1.3800F, 0.3800F, 0.3500F, 0.8913F, 0.0240F, {0.0000F, 0.0000F, -0.0000F}, 0.6310F, 0.0440F, {0.0000F, 0.0000F, 0.0000F}, 0.1210F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Prefab::caravan = {1.0000F, 1.0000F, 0.3162F, 0.0891F, 0.1259F, 0.4300F, 1.5000F, 1.0000F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Dome
+//
+const EffectProps::Reverb ReverbPresets::Dome::tomb = {1.0000F, 0.7900F, 0.3162F, 0.3548F, 0.2239F, 4.1800F, 0.2100F, 0.1000F, 0.3868F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 1.6788F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.1770F, 0.1900F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+const EffectProps::Reverb ReverbPresets::Dome::saint_pauls = {1.0000F, 0.8700F, 0.3162F, 0.3548F, 0.2239F, 10.4800F, 0.1900F, 0.1000F, 0.1778F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0420F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1200F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Pipe
+//
+const EffectProps::Reverb ReverbPresets::Pipe::small = {1.0000F, 1.0000F, 0.3162F, 0.3548F, 0.2239F, 5.0400F, 0.1000F, 0.1000F, 0.5012F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 2.5119F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Pipe::long_thin = {0.2560F, 0.9100F, 0.3162F, 0.4467F, 0.2818F, 9.2100F, 0.1800F, 0.1000F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Pipe::large = {1.0000F, 1.0000F, 0.3162F, 0.3548F, 0.2239F, 8.4500F, 0.1000F, 0.1000F, 0.3981F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Pipe::resonant = {0.1373F, 0.9100F, 0.3162F, 0.4467F, 0.2818F, 6.8100F, 0.1800F, 0.1000F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Outdoors
+//
+const EffectProps::Reverb ReverbPresets::Outdoors::backyard = {1.0000F, 0.4500F, 0.3162F, 0.2512F, 0.5012F, 1.1200F, 0.3400F, 0.4600F, 0.4467F, 0.0690F, {0.0000F, 0.0000F, -0.0000F}, 0.7079F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.2180F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Outdoors::rolling_plains = {1.0000F, 0.0000F, 0.3162F, 0.0112F, 0.6310F, 2.1300F, 0.2100F, 0.4600F, 0.1778F, 0.3000F, {0.0000F, 0.0000F, -0.0000F}, 0.4467F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Outdoors::deep_canyon = {1.0000F, 0.7400F, 0.3162F, 0.1778F, 0.6310F, 3.8900F, 0.2100F, 0.4600F, 0.3162F, 0.2230F, {0.0000F, 0.0000F, -0.0000F}, 0.3548F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Outdoors::creek = {1.0000F, 0.3500F, 0.3162F, 0.1778F, 0.5012F, 2.1300F, 0.2100F, 0.4600F, 0.3981F, 0.1150F, {0.0000F, 0.0000F, -0.0000F}, 0.1995F, 0.0310F, {0.0000F, 0.0000F, 0.0000F}, 0.2180F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Outdoors::valley = {1.0000F, 0.2800F, 0.3162F, 0.0282F, 0.1585F, 2.8800F, 0.2600F, 0.3500F, 0.1413F, 0.2630F, {0.0000F, 0.0000F, -0.0000F}, 0.3981F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Mood
+//
+const EffectProps::Reverb ReverbPresets::Mood::heaven = {1.0000F, 0.9400F, 0.3162F, 0.7943F, 0.4467F, 5.0400F, 1.1200F, 0.5600F, 0.2427F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0800F, 2.7420F, 0.0500F, 0.9977F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Mood::hell = {1.0000F, 0.5700F, 0.3162F, 0.3548F, 0.4467F, 3.5700F, 0.4900F, 2.0000F, 0.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1100F, 0.0400F, 2.1090F, 0.5200F, 0.9943F, 5000.0000F, 139.5000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Mood::memory = {1.0000F, 0.8500F, 0.3162F, 0.6310F, 0.3548F, 4.0600F, 0.8200F, 0.5600F, 0.0398F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.4740F, 0.4500F, 0.9886F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Driving
+//
+const EffectProps::Reverb ReverbPresets::Driving::commentator = {1.0000F, 0.0000F, 0.3162F, 0.5623F, 0.5012F, 2.4200F, 0.8800F, 0.6800F, 0.1995F, 0.0930F, {0.0000F, 0.0000F, 0.0000F}, 0.2512F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9886F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::pit_garage = {0.4287F, 0.5900F, 0.3162F, 0.7079F, 0.5623F, 1.7200F, 0.9300F, 0.8700F, 0.5623F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::incar_racer = {0.0832F, 0.8000F, 0.3162F, 1.0000F, 0.7943F, 0.1700F, 2.0000F, 0.4100F, 1.7783F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::incar_sports = {0.0832F, 0.8000F, 0.3162F, 0.6310F, 1.0000F, 0.1700F, 0.7500F, 0.4100F, 1.0000F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.5623F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::incar_luxury = {0.2560F, 1.0000F, 0.3162F, 0.1000F, 0.5012F, 0.1300F, 0.4100F, 0.4600F, 0.7943F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::full_grand_stand = {1.0000F, 1.0000F, 0.3162F, 0.2818F, 0.6310F, 3.0100F, 1.3700F, 1.2800F, 0.3548F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 0.1778F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10420.2002F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::empty_grand_stand = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 0.7943F, 4.6200F, 1.7500F, 1.4000F, 0.2082F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 0.2512F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10420.2002F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Driving::tunnel = {1.0000F, 0.8100F, 0.3162F, 0.3981F, 0.8913F, 3.4200F, 0.9400F, 1.3100F, 0.7079F, 0.0510F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0470F, {0.0000F, 0.0000F, 0.0000F}, 0.2140F, 0.0500F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 155.3000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// City
+//
+const EffectProps::Reverb ReverbPresets::City::streets = {1.0000F, 0.7800F, 0.3162F, 0.7079F, 0.8913F, 1.7900F, 1.1200F, 0.9100F, 0.2818F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 0.1995F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::City::subway = {1.0000F, 0.7400F, 0.3162F, 0.7079F, 0.8913F, 3.0100F, 1.2300F, 0.9100F, 0.7079F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.2100F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::City::museum = {1.0000F, 0.8200F, 0.3162F, 0.1778F, 0.1778F, 3.2800F, 1.4000F, 0.5700F, 0.2512F, 0.0390F, {0.0000F, 0.0000F, -0.0000F}, 0.8913F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 0.1300F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::City::library = {1.0000F, 0.8200F, 0.3162F, 0.2818F, 0.0891F, 2.7600F, 0.8900F, 0.4100F, 0.3548F, 0.0290F, {0.0000F, 0.0000F, -0.0000F}, 0.8913F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.1300F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::City::underpass = {1.0000F, 0.8200F, 0.3162F, 0.4467F, 0.8913F, 3.5700F, 1.1200F, 0.9100F, 0.3981F, 0.0590F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0370F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1400F, 0.2500F, 0.0000F, 0.9920F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::City::abandoned = {1.0000F, 0.6900F, 0.3162F, 0.7943F, 0.8913F, 3.2800F, 1.1700F, 0.9100F, 0.4467F, 0.0440F, {0.0000F, 0.0000F, 0.0000F}, 0.2818F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9966F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+// Misc
+//
+const EffectProps::Reverb ReverbPresets::Misc::dusty_room = {0.3645F, 0.5600F, 0.3162F, 0.7943F, 0.7079F, 1.7900F, 0.3800F, 0.2100F, 0.5012F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0060F, {0.0000F, 0.0000F, 0.0000F}, 0.2020F, 0.0500F, 0.2500F, 0.0000F, 0.9886F, 13046.0000F, 163.3000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Misc::chapel = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 1.0000F, 4.6200F, 0.6400F, 1.2300F, 0.4467F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.1100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true, EffectProps::Reverb::quality_full,};
+
+const EffectProps::Reverb ReverbPresets::Misc::small_water_room = {1.0000F, 0.7000F, 0.3162F, 0.4477F, 1.0000F, 1.5100F, 1.2500F, 1.1400F, 0.8913F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1790F, 0.1500F, 0.8950F, 0.1900F, 0.9920F, 5000.0000F, 250.0000F, 0.0000F, false, EffectProps::Reverb::quality_full,};
+
+// Registry
+//
+constexpr ReverbPreset reverb_preset_registry[] =
+{
+    // Default
+    {"default", "generic", &ReverbPresets::Default::generic},
+    {"default", "padded_cell", &ReverbPresets::Default::padded_cell},
+    {"default", "room", &ReverbPresets::Default::room},
+    {"default", "bathroom", &ReverbPresets::Default::bathroom},
+    {"default", "living_room", &ReverbPresets::Default::living_room},
+    {"default", "stone_room", &ReverbPresets::Default::stone_room},
+    {"default", "auditorium", &ReverbPresets::Default::auditorium},
+    {"default", "concert_hall", &ReverbPresets::Default::concert_hall},
+    {"default", "cave", &ReverbPresets::Default::cave},
+    {"default", "arena", &ReverbPresets::Default::arena},
+    {"default", "hangar", &ReverbPresets::Default::hangar},
+    {"default", "carpeted_hallway", &ReverbPresets::Default::carpeted_hallway},
+    {"default", "hallway", &ReverbPresets::Default::hallway},
+    {"default", "stone_corridor", &ReverbPresets::Default::stone_corridor},
+    {"default", "alley", &ReverbPresets::Default::alley},
+    {"default", "forest", &ReverbPresets::Default::forest},
+    {"default", "city", &ReverbPresets::Default::city},
+    {"default", "mountains", &ReverbPresets::Default::mountains},
+    {"default", "quarry", &ReverbPresets::Default::quarry},
+    {"default", "plain", &ReverbPresets::Default::plain},
+    {"default", "parking_lot", &ReverbPresets::Default::parking_lot},
+    {"default", "sewer_pipe", &ReverbPresets::Default::sewer_pipe},
+    {"default", "underwater", &ReverbPresets::Default::underwater},
+    {"default", "drugged", &ReverbPresets::Default::drugged},
+    {"default", "dizzy", &ReverbPresets::Default::dizzy},
+    {"default", "psychotic", &ReverbPresets::Default::psychotic},
+
+    // Castle
+    {"castle", "small_room", &ReverbPresets::Castle::small_room},
+    {"castle", "short_passage", &ReverbPresets::Castle::short_passage},
+    {"castle", "medium_room", &ReverbPresets::Castle::medium_room},
+    {"castle", "large_room", &ReverbPresets::Castle::large_room},
+    {"castle", "long_passage", &ReverbPresets::Castle::long_passage},
+    {"castle", "hall", &ReverbPresets::Castle::hall},
+    {"castle", "cupboard", &ReverbPresets::Castle::cupboard},
+    {"castle", "courtyard", &ReverbPresets::Castle::courtyard},
+    {"castle", "alcove", &ReverbPresets::Castle::alcove},
+
+    // Factory
+    {"factory", "small_room", &ReverbPresets::Factory::small_room},
+    {"factory", "short_passage", &ReverbPresets::Factory::short_passage},
+    {"factory", "medium_room", &ReverbPresets::Factory::medium_room},
+    {"factory", "large_room", &ReverbPresets::Factory::large_room},
+    {"factory", "long_passage", &ReverbPresets::Factory::long_passage},
+    {"factory", "hall", &ReverbPresets::Factory::hall},
+    {"factory", "cupboard", &ReverbPresets::Factory::cupboard},
+    {"factory", "courtyard", &ReverbPresets::Factory::courtyard},
+    {"factory", "alcove", &ReverbPresets::Factory::alcove},
+
+    // IcePalace
+    {"ice_palace", "small_room", &ReverbPresets::IcePalace::small_room},
+    {"ice_palace", "short_passage", &ReverbPresets::IcePalace::short_passage},
+    {"ice_palace", "medium_room", &ReverbPresets::IcePalace::medium_room},
+    {"ice_palace", "large_room", &ReverbPresets::IcePalace::large_room},
+    {"ice_palace", "long_passage", &ReverbPresets::IcePalace::long_passage},
+    {"ice_palace", "hall", &ReverbPresets::IcePalace::hall},
+    {"ice_palace", "cupboard", &ReverbPresets::IcePalace::cupboard},
+    {"ice_palace", "courtyard", &ReverbPresets::IcePalace::courtyard},
+    {"ice_palace", "alcove", &ReverbPresets::IcePalace::alcove},
+
+    // SpaceStation
+    {"space_station", "small_room", &ReverbPresets::SpaceStation::small_room},
+    {"space_station", "short_passage", &ReverbPresets::SpaceStation::short_passage},
+    {"space_station", "medium_room", &ReverbPresets::SpaceStation::medium_room},
+    {"space_station", "large_room", &ReverbPresets::SpaceStation::large_room},
+    {"space_station", "long_passage", &ReverbPresets::SpaceStation::long_passage},
+    {"space_station", "hall", &ReverbPresets::SpaceStation::hall},
+    {"space_station", "cupboard", &ReverbPresets::SpaceStation::cupboard},
+    {"space_station", "alcove", &ReverbPresets::SpaceStation::alcove},
+
+    // WoodenGaleon
+    {"wooden_galeon", "small_room", &ReverbPresets::WoodenGaleon::small_room},
+    {"wooden_galeon", "short_passage", &ReverbPresets::WoodenGaleon::short_passage},
+    {"wooden_galeon", "medium_room", &ReverbPresets::WoodenGaleon::medium_room},
+    {"wooden_galeon", "large_room", &ReverbPresets::WoodenGaleon::large_room},
+    {"wooden_galeon", "long_passage", &ReverbPresets::WoodenGaleon::long_passage},
+    {"wooden_galeon", "hall", &ReverbPresets::WoodenGaleon::hall},
+    {"wooden_galeon", "cupboard", &ReverbPresets::WoodenGaleon::cupboard},
+    {"wooden_galeon", "courtyard", &ReverbPresets::WoodenGaleon::courtyard},
+    {"wooden_galeon", "alcove", &ReverbPresets::WoodenGaleon::alcove},
+
+    // Sports
+    {"sports", "empty_stadium", &ReverbPresets::Sports::empty_stadium},
+    {"sports", "squash_court", &ReverbPresets::Sports::squash_court},
+    {"sports", "small_swimming_pool", &ReverbPresets::Sports::small_swimming_pool},
+    {"sports", "large_swimming_pool", &ReverbPresets::Sports::large_swimming_pool},
+    {"sports", "gymnasium", &ReverbPresets::Sports::gymnasium},
+    {"sports", "full_stadium", &ReverbPresets::Sports::full_stadium},
+    {"sports", "stadium_tannoy", &ReverbPresets::Sports::stadium_tannoy},
+
+    // Prefab
+    {"prefab", "workshop", &ReverbPresets::Prefab::workshop},
+    {"prefab", "school_room", &ReverbPresets::Prefab::school_room},
+    {"prefab", "practise_room", &ReverbPresets::Prefab::practise_room},
+    {"prefab", "outhouse", &ReverbPresets::Prefab::outhouse},
+    {"prefab", "caravan", &ReverbPresets::Prefab::caravan},
+
+    // Dome
+    {"dome", "tomb", &ReverbPresets::Dome::tomb},
+    {"dome", "saint_pauls", &ReverbPresets::Dome::saint_pauls},
+
+    // Pipe
+    {"pipe", "small", &ReverbPresets::Pipe::small},
+    {"pipe", "long_thin", &ReverbPresets::Pipe::long_thin},
+    {"pipe", "large", &ReverbPresets::Pipe::large},
+    {"pipe", "resonant", &ReverbPresets::Pipe::resonant},
+
+    // Outdoors
+    {"outdoors", "backyard", &ReverbPresets::Outdoors::backyard},
+    {"outdoors", "rolling_plains", &ReverbPresets::Outdoors::rolling_plains},
+    {"outdoors", "deep_canyon", &ReverbPresets::Outdoors::deep_canyon},
+    {"outdoors", "creek", &ReverbPresets::Outdoors::creek},
+    {"outdoors", "valley", &ReverbPresets::Outdoors::valley},
+
+    // Mood
+    {"mood", "heaven", &ReverbPresets::Mood::heaven},
+    {"mood", "hell", &ReverbPresets::Mood::hell},
+    {"mood", "memory", &ReverbPresets::Mood::memory},
+
+    // Driving
+    {"driving", "commentator", &ReverbPresets::Driving::commentator},
+    {"driving", "pit_garage", &ReverbPresets::Driving::pit_garage},
+    {"driving", "incar_racer", &ReverbPresets::Driving::incar_racer},
+    {"driving", "incar_sports", &ReverbPresets::Driving::incar_sports},
+    {"driving", "incar_luxury", &ReverbPresets::Driving::incar_luxury},
+    {"driving", "full_grand_stand", &ReverbPresets::Driving::full_grand_stand},
+    {"driving", "empty_grand_stand", &ReverbPresets::Driving::empty_grand_stand},
+    {"driving", "tunnel", &ReverbPresets::Driving::tunnel},
+
+    // City
+    {"city", "streets", &ReverbPresets::City::streets},
+    {"city", "subway", &ReverbPresets::City::subway},
+    {"city", "museum", &ReverbPresets::City::museum},
+    {"city", "library", &ReverbPresets::City::library},
+    {"city", "underpass", &ReverbPresets::City::underpass},
+    {"city", "abandoned", &ReverbPresets::City::abandoned},
+
+    // Misc
+    {"misc", "dusty_room", &ReverbPresets::Misc::dusty_room},
+    {"misc", "chapel", &ReverbPresets::Misc::chapel},
+    {"misc", "small_water_room", &ReverbPresets::Misc::small_water_room},
+};
+
+constexpr auto reverb_preset_count = static_cast<int>(sizeof(reverb_preset_registry) / sizeof(ReverbPreset));
+
+
+// A perfect hash of the registry, built at compile time.
+//
+// The first hash of a category and a name picks a bucket, and the bucket's
+// seed rehashes its presets into free slots. The buckets are placed from the
+// largest one, so the crowded ones find their slots while most are free
+// ("hash and displace").
+class ReverbPresetIndex
+{
+public:
+    static constexpr auto bucket_count = 64;
+    static constexpr auto slot_count = 256;
+    static constexpr auto max_seed = 65'535;
+
+
+    // Whether each bucket has got a seed.
+    bool is_perfect_;
+
+    int seeds_[bucket_count];
+
+    // The preset's index, or -1 for an empty slot.
+    int slots_[slot_count];
+
+
+    constexpr ReverbPresetIndex()
+        :
+        is_perfect_{true},
+        seeds_{},
+        slots_{}
+    {
+        int buckets[reverb_preset_count] = {};
+        int bucket_sizes[bucket_count] = {};
+        auto max_bucket_size = 0;
+
+        for (int i = 0; i < slot_count; ++i)
+        {
+            slots_[i] = -1;
+        }
+
+        for (int i = 0; i < reverb_preset_count; ++i)
+        {
+            const auto& preset = reverb_preset_registry[i];
+            const auto bucket = static_cast<int>(hash(0, preset.category_, preset.name_) % bucket_count);
+
+            buckets[i] = bucket;
+            bucket_sizes[bucket] += 1;
+            max_bucket_size = std::max(bucket_sizes[bucket], max_bucket_size);
+        }
+
+        for (auto size = max_bucket_size; size > 0; --size)
+        {
+            for (int b = 0; b < bucket_count; ++b)
+            {
+                if (bucket_sizes[b] == size && !place_bucket(b, buckets))
+                {
+                    is_perfect_ = false;
+                }
+            }
+        }
+    }
+
+    // Returns the only preset which may have the category and the name, or
+    // -1 if there is none.
+    int find(
+        const char* category,
+        const char* name) const
+    {
+        const auto bucket = hash(0, category, name) % bucket_count;
+        const auto slot = hash(static_cast<std::uint32_t>(seeds_[bucket]), category, name) % slot_count;
+
+        return slots_[slot];
+    }
+
+
+private:
+    constexpr bool place_bucket(
+        const int bucket,
+        const int (&buckets)[reverb_preset_count])
+    {
+        for (auto seed = 1; seed <= max_seed; ++seed)
+        {
+            int bucket_slots[reverb_preset_count] = {};
+            auto bucket_size = 0;
+            auto is_free = true;
+
+            for (int i = 0; i < reverb_preset_count && is_free; ++i)
+            {
+                if (buckets[i] != bucket)
+                {
+                    continue;
+                }
+
+                const auto& preset = reverb_preset_registry[i];
+                const auto slot = static_cast<int>(hash(static_cast<std::uint32_t>(seed), preset.category_, preset.name_) % slot_count);
+
+                is_free = (slots_[slot] < 0);
+
+                for (int j = 0; j < bucket_size && is_free; ++j)
+                {
+                    is_free = (bucket_slots[j] != slot);
+                }
+
+                bucket_slots[bucket_size++] = slot;
+            }
+
+            if (!is_free)
+            {
+                continue;
+            }
+
+            for (int i = 0, j = 0; i < reverb_preset_count; ++i)
+            {
+                if (buckets[i] == bucket)
+                {
+                    slots_[bucket_slots[j++]] = i;
+                }
+            }
+
+            seeds_[bucket] = seed;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    // FNV-1a of "category/name", with the seed mixed into the basis and the
+    // bits of the result mixed down into the low ones.
+    static constexpr std::uint32_t hash(
+        const std::uint32_t seed,
+        const char* category,
+        const char* name)
+    {
+        auto value = std::uint32_t{2'166'136'261} ^ (seed * std::uint32_t{0x9E37'79B9});
+
+        for (auto c = category; *c != '\0'; ++c)
+        {
+            value = (value ^ static_cast<unsigned char>(*c)) * std::uint32_t{16'777'619};
+        }
+
+        value = (value ^ static_cast<unsigned char>('/')) * std::uint32_t{16'777'619};
+
+        for (auto c = name; *c != '\0'; ++c)
+        {
+            value = (value ^ static_cast<unsigned char>(*c)) * std::uint32_t{16'777'619};
+        }
+
+        value ^= value >> 16;
+        value *= std::uint32_t{0x85EB'CA6B};
+        value ^= value >> 13;
+
+        return value;
+    }
+}; // ReverbPresetIndex
+
+constexpr int ReverbPresetIndex::bucket_count;
+constexpr int ReverbPresetIndex::slot_count;
+constexpr int ReverbPresetIndex::max_seed;
+
+constexpr auto reverb_preset_index = ReverbPresetIndex{};
+
+static_assert(reverb_preset_count <= ReverbPresetIndex::slot_count, "Too many reverb presets.");
+static_assert(reverb_preset_index.is_perfect_, "No perfect hash of the reverb presets.");
+
+
+int ReverbPresets::get_count()
+{
+    return reverb_preset_count;
+}
+
+const ReverbPreset* ReverbPresets::get(
+    const int preset_index)
+{
+    if (preset_index < 0 || preset_index >= reverb_preset_count)
+    {
+        return nullptr;
+    }
+
+    return &reverb_preset_registry[preset_index];
+}
+
+const ReverbPreset* ReverbPresets::find(
+    const char* category,
+    const char* name)
+{
+    if (!category || !name)
+    {
+        return nullptr;
+    }
+
+    const auto preset_index = reverb_preset_index.find(category, name);
+
+    if (preset_index < 0)
+    {
+        return nullptr;
+    }
+
+    const auto& preset = reverb_preset_registry[preset_index];
+
+    if (std::strcmp(preset.category_, category) != 0 || std::strcmp(preset.name_, name) != 0)
+    {
+        return nullptr;
+    }
+
+    return &preset;
+}
+
+// Reverb presets
+// ==========================================================================
+
+
+class EffectState
+{
+public:
+    EffectState(
+        const EffectState& that) = delete;
+
+    EffectState& operator=(
+        const EffectState& that) = delete;
+
+    virtual ~EffectState()
+    {
+    }
+
+
+    SampleBuffers* dst_buffers_;
+    int dst_channel_count_;
+
+
+    void construct()
+    {
+        do_construct();
+    }
+
+    void destruct()
+    {
+        do_destruct();
+    }
+
+    void update_device(
+        Device& device)
+    {
+        do_update_device(device);
+    }
+
+    void update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& props)
+    {
+        do_update(device, effect_slot, props);
+    }
+
+    void process(
+        int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count)
+    {
+        do_process(sample_count, src_samples, dst_samples, channel_count);
+    }
+
+    // Saves the state that processing builds up: the delay lines, the filter
+    // histories, the oscillator phases and the envelopes.
+    void save_state(
+        StateWriter& writer) const
+    {
+        do_save_state(writer);
+    }
+
+    // Loads the state saved for the same device and properties.
+    void load_state(
+        StateReader& reader)
+    {
+        do_load_state(reader);
+    }
+
+    static void destroy(
+        EffectState*& effect_state)
+    {
+        if (!effect_state)
+        {
+            return;
+        }
+
+        effect_state->destruct();
+        delete effect_state;
+        effect_state = nullptr;
+    }
+
+
+protected:
+    EffectState()
+        :
+        dst_buffers_{},
+        dst_channel_count_{}
+    {
+    }
+
+
+    virtual void do_construct() = 0;
+
+    virtual void do_destruct() = 0;
+
+    virtual void do_update_device(
+        Device& device) = 0;
+
+    virtual void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& props) = 0;
+
+    virtual void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) = 0;
+
+    virtual void do_save_state(
+        StateWriter& writer) const = 0;
+
+    virtual void do_load_state(
+        StateReader& reader) = 0;
+}; // EffectState
+
+class EffectStateFactory
+{
+public:
+    static EffectState* create_by_type(
+        const EffectType type)
+    {
+        switch (type)
+        {
+        case EffectType::null:
+            return create_null();
+
+        case EffectType::chorus:
+            return create_chorus();
+
+        case EffectType::compressor:
+            return create_compressor();
+
+        case EffectType::convolution:
+            return create_convolution();
+
+        case EffectType::dedicated_dialog:
+        case EffectType::dedicated_low_frequency:
+            return create_dedicated();
+
+        case EffectType::distortion:
+            return create_distortion();
+
+        case EffectType::dynamics:
+            return create_dynamics();
+
+        case EffectType::echo:
+            return create_echo();
+
+        case EffectType::equalizer:
+            return create_equalizer();
+
+        case EffectType::flanger:
+            return create_flanger();
+
+        case EffectType::multi_tap_echo:
+            return create_multi_tap_echo();
+
+        case EffectType::eax_reverb:
+        case EffectType::reverb:
+            return create_reverb();
+
+        case EffectType::ring_modulator:
+            return create_ring_modulator();
+
+        default:
+            return nullptr;
+        }
+    }
+
+
+private:
+    static EffectState* create_null();
+    static EffectState* create_chorus();
+    static EffectState* create_compressor();
+    static EffectState* create_convolution();
+    static EffectState* create_dedicated();
+    static EffectState* create_distortion();
+    static EffectState* create_dynamics();
+    static EffectState* create_echo();
+    static EffectState* create_equalizer();
+    static EffectState* create_flanger();
+    static EffectState* create_multi_tap_echo();
+    static EffectState* create_reverb();
+    static EffectState* create_ring_modulator();
+
+
+    template<typename T>
+    static EffectState* create()
+    {
+        auto result = static_cast<EffectState*>(new (std::nothrow) T{});
+
+        if (result)
+        {
+            result->construct();
+        }
+
+        return result;
+    }
+}; // EffectStateFactory
+
+struct EffectStateDeleter
+{
+    void operator()(
+        EffectState* effect_state)
+    {
+        if (!effect_state)
+        {
+            return;
+        }
+
+        effect_state->destruct();
+        delete effect_state;
+    }
+}; // EffectStateDeleter
+
+struct Device
+{
+    using ChannelIds = std::array<ChannelId, max_channels>;
+
+
+    int sampling_rate_;
+    int channel_count_;
+    ChannelFormat channel_format_;
+    ChannelIds channel_ids_;
+    SampleBuffers sample_buffers_;
+
+    // Temp storage used for each source when mixing.
+    SampleBuffer resampled_data_;
+    SampleBuffer filtered_data_;
+
+    // The "dry" path corresponds to the main output.
+    AmbiOutput dry_;
+
+    // First-order ambisonics output, to be upsampled to the dry buffer if different.
+    AmbiOutput foa_;
+
+    const float* source_samples_;
+
+
+    void initialize(
+        const ChannelFormat channel_format,
+        const int sampling_rate)
+    {
+        channel_count_ = channel_format_to_channel_count(channel_format);
+
+        // Set output format
+        channel_format_ = channel_format;
+        sampling_rate_ = sampling_rate;
+
+        alu_init_renderer();
+
+        sample_buffers_.clear();
+        sample_buffers_.resize(channel_count_);
+    }
+
+    void uninitialize()
+    {
+    }
+
+    void set_default_wfx_channel_order()
+    {
+        channel_ids_.fill(ChannelId::none);
+
+        switch (channel_format_)
+        {
+        case ChannelFormat::mono:
+            channel_ids_[0] = ChannelId::front_center;
+            break;
+
+        case ChannelFormat::stereo:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            break;
+
+        case ChannelFormat::quad:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            channel_ids_[2] = ChannelId::back_left;
+            channel_ids_[3] = ChannelId::back_right;
+            break;
+
+        case ChannelFormat::five_point_one:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            channel_ids_[2] = ChannelId::front_center;
+            channel_ids_[3] = ChannelId::lfe;
+            channel_ids_[4] = ChannelId::side_left;
+            channel_ids_[5] = ChannelId::side_right;
+            break;
+
+        case ChannelFormat::five_point_one_rear:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            channel_ids_[2] = ChannelId::front_center;
+            channel_ids_[3] = ChannelId::lfe;
+            channel_ids_[4] = ChannelId::back_left;
+            channel_ids_[5] = ChannelId::back_right;
+            break;
+
+        case ChannelFormat::six_point_one:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            channel_ids_[2] = ChannelId::front_center;
+            channel_ids_[3] = ChannelId::lfe;
+            channel_ids_[4] = ChannelId::back_center;
+            channel_ids_[5] = ChannelId::side_left;
+            channel_ids_[6] = ChannelId::side_right;
+            break;
+
+        case ChannelFormat::seven_point_one:
+            channel_ids_[0] = ChannelId::front_left;
+            channel_ids_[1] = ChannelId::front_right;
+            channel_ids_[2] = ChannelId::front_center;
+            channel_ids_[3] = ChannelId::lfe;
+            channel_ids_[4] = ChannelId::back_left;
+            channel_ids_[5] = ChannelId::back_right;
+            channel_ids_[6] = ChannelId::side_left;
+            channel_ids_[7] = ChannelId::side_right;
+            break;
+
+        case ChannelFormat::none:
+        default:
+            break;
+        }
+    }
+
+    void alu_init_renderer()
+    {
+        dry_.ambi_.reset();
+        dry_.coeff_count_ = 0;
+        set_default_wfx_channel_order();
+
+        const ChannelPanning *channel_map = nullptr;
+        auto coeff_count = 0;
+        auto count = 0;
+
+        switch (channel_format_)
+        {
+        case ChannelFormat::mono:
+            count = get_array_extents(Panning::mono_panning);
+            channel_map = Panning::mono_panning;
+            coeff_count = 1;
+            break;
+
+        case ChannelFormat::stereo:
+            count = get_array_extents(Panning::stereo_panning);
+            channel_map = Panning::stereo_panning;
+            coeff_count = 4;
+            break;
+
+        case ChannelFormat::quad:
+            count = get_array_extents(Panning::quad_panning);
+            channel_map = Panning::quad_panning;
+            coeff_count = 4;
+            break;
+
+        case ChannelFormat::five_point_one:
+            count = get_array_extents(Panning::x5_1_side_panning);
+            channel_map = Panning::x5_1_side_panning;
+            coeff_count = 9;
+            break;
+
+        case ChannelFormat::five_point_one_rear:
+            count = get_array_extents(Panning::x5_1_rear_panning);
+            channel_map = Panning::x5_1_rear_panning;
+            coeff_count = 9;
+            break;
+
+        case ChannelFormat::six_point_one:
+            count = get_array_extents(Panning::x6_1_panning);
+            channel_map = Panning::x6_1_panning;
+            coeff_count = 9;
+            break;
+
+        case ChannelFormat::seven_point_one:
+            count = get_array_extents(Panning::x7_1_panning);
+            channel_map = Panning::x7_1_panning;
+            coeff_count = 16;
+            break;
+
+        case ChannelFormat::b_format:
+            // No decoder: with zero coefficients the panning functions write
+            // the ambisonic coefficients to the output channels as is.
+            channel_count_ = max_effect_channels;
+            foa_.ambi_.reset();
+            foa_.coeff_count_ = 0;
+            return;
+
+        case ChannelFormat::none:
+        default:
+            break;
+        }
+
+        Panning::set_channel_map(
+            channel_ids_.data(),
+            dry_.ambi_.coeffs_.data(),
+            channel_map,
+            count,
+            &channel_count_);
+
+        dry_.coeff_count_ = coeff_count;
+
+        foa_.ambi_.reset();
+
+        for (int i = 0; i < channel_count_; ++i)
+        {
+            foa_.ambi_.coeffs_[i][0] = dry_.ambi_.coeffs_[i][0];
+
+            for (int j = 1; j < 4; ++j)
+            {
+                foa_.ambi_.coeffs_[i][j] = dry_.ambi_.coeffs_[i][j];
+            }
+        }
+
+        foa_.coeff_count_ = 4;
+    }
+
+    // Returns the index for the given channel name (e.g. FrontCenter), or -1 if it
+    // doesn't exist.
+    int get_channel_index(
+        const ChannelId channel_id_to_find)
+    {
+        const auto it_begin = channel_ids_.cbegin();
+        const auto it_end = channel_ids_.cbegin();
+
+        const auto it = std::find_if(
+            it_begin,
+            it_end,
+            [=](const ChannelId channel_id)
+            {
+                return channel_id == channel_id_to_find;
+            }
+        );
+
+        if (it == it_end)
+        {
+            return -1;
+        }
+
+        return static_cast<int>(it - it_begin);
+    }
+
+    static int channel_format_to_channel_count(
+        const ChannelFormat channel_format)
+    {
+        switch (channel_format)
+        {
+        case ChannelFormat::mono:
+            return 1;
+
+        case ChannelFormat::stereo:
+            return 2;
+
+        case ChannelFormat::quad:
+        case ChannelFormat::b_format:
+            return 4;
+
+        case ChannelFormat::five_point_one:
+        case ChannelFormat::five_point_one_rear:
+            return 6;
+
+        case ChannelFormat::six_point_one:
+            return 7;
+
+        case ChannelFormat::seven_point_one:
+            return 8;
+
+        default:
+            return 0;
+        }
+    }
+}; // Device
+
+struct EffectSlot
+{
+    using EffectStateUPtr = std::unique_ptr<EffectState, EffectStateDeleter>;
+
+
+    Effect effect_;
+    EffectStateUPtr effect_state_;
+    bool is_props_changed_;
+
+    // The state swapped out by the last change of the effect type. It fades
+    // out while the new state fades in, and is retired as soon as its tail is
+    // silent.
+    EffectStateUPtr swap_state_;
+
+    // The samples processed since the swap, out of the swap length. A zero
+    // length means no swap is in progress.
+    int swap_position_;
+    int swap_length_;
+
+    // The samples of silence at the end of the swapped state's output.
+    int swap_silent_count_;
+
+    // Wet buffer configuration is ACN channel order with N3D scaling:
+    // * Channel 0 is the unattenuated mono signal.
+    // * Channel 1 is OpenAL -X
+    // * Channel 2 is OpenAL Y
+    // * Channel 3 is OpenAL -Z
+    // Consequently, effects that only want to work with mono input can use
+    // channel 0 by itself. Effects that want multichannel can process the
+    // ambisonics signal and make a B-Format pan (ComputeFirstOrderGains) for
+    // first-order device output (FOAOut).
+    SampleBuffers wet_buffer_;
+
+
+    EffectSlot()
+        :
+        effect_{},
+        effect_state_{},
+        is_props_changed_{},
+        swap_state_{},
+        swap_position_{},
+        swap_length_{},
+        swap_silent_count_{},
+        wet_buffer_{SampleBuffers::size_type{max_effect_channels}}
+    {
+    }
+
+    EffectSlot(
+        const EffectSlot& that) = delete;
+
+    EffectSlot(
+        EffectSlot&& that) = default;
+
+    EffectSlot& operator=(
+        const EffectSlot& that) = delete;
+
+    EffectSlot& operator=(
+        EffectSlot&& that) = default;
+
+    ~EffectSlot()
+    {
+        uninitialize();
+    }
+
+    void initialize()
+    {
+        uninitialize();
+
+        effect_.type_ = EffectType::null;
+        effect_state_.reset(EffectStateFactory::create_by_type(EffectType::null));
+        is_props_changed_ = true;
+    }
+
+    void uninitialize()
+    {
+        effect_state_.reset(nullptr);
+        swap_state_.reset(nullptr);
+        swap_position_ = 0;
+        swap_length_ = 0;
+        swap_silent_count_ = 0;
+    }
+
+    // Sets the effect. With a nonzero swap length (in samples), a change of
+    // the type swaps the states over instead of cutting over.
+    void set_effect(
+        Device& device,
+        Effect& effect,
+        const int swap_length)
+    {
+        if (effect_.type_ != effect.type_)
+        {
+            auto effect_state = EffectStateUPtr{EffectStateFactory::create_by_type(effect.type_)};
+
+            effect_state->dst_buffers_ = &device.sample_buffers_;
+            effect_state->dst_channel_count_ = device.channel_count_;
+            effect_state->update_device(device);
+
+            // The state swapped out earlier is dropped, so no more than two
+            // states run at once. A null effect has no tail to fade out.
+            if (swap_length > 0 && effect_.type_ != EffectType::null)
+            {
+                swap_state_ = std::move(effect_state_);
+            }
+            else
+            {
+                swap_state_.reset(nullptr);
+            }
+
+            swap_position_ = 0;
+            swap_length_ = swap_length;
+            swap_silent_count_ = 0;
+
+            effect_state_ = std::move(effect_state);
+
+            effect_.type_ = effect.type_;
+            effect_.props_ = effect.props_;
+        }
+        else
+        {
+            effect_.props_ = effect.props_;
+        }
+
+        is_props_changed_ = true;
+    }
+}; // EffectSlot
+
+struct EffectContext
+{
+    using WetResamplers = std::array<Resampler, max_effect_channels>;
+
+
+    Effect deferred_effect_;
+    EffectSlot effect_slot_;
+
+    // The wet buffer at the effect sampling rate, when it differs from the
+    // device one.
+    WetResamplers wet_resamplers_;
+    SampleBuffers resampled_wet_buffer_;
+}; // EffectContext
+
+using EffectContexts = std::vector<EffectContext>;
+
+
+struct MixHelpers
+{
+    // Accumulates the samples scaled by a constant gain.
+    static void mix_samples_c(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        for (int i = 0; i < sample_count; ++i)
+        {
+            dst_samples[i] += src_samples[i] * gain;
+        }
+    }
+
+    static void mix_samples_sse2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = Float4::set1(gain);
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            const auto mixed = Float4::load(&dst_samples[i]) + (Float4::load(&src_samples[i]) * gains);
+
+            mixed.store(&dst_samples[i]);
+        }
+
+        mix_samples_c(&src_samples[i], &dst_samples[i], gain, sample_count - i);
+    }
+
+#ifdef OALSFXPP_AVX
+    OALSFXPP_TARGET_AVX2
+    static void mix_samples_avx2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = _mm256_set1_ps(gain);
+
+        for ( ; (i + 8) <= sample_count; i += 8)
+        {
+            const auto mixed = _mm256_fmadd_ps(
+                _mm256_loadu_ps(&src_samples[i]),
+                gains,
+                _mm256_loadu_ps(&dst_samples[i]));
+
+            _mm256_storeu_ps(&dst_samples[i], mixed);
+        }
+
+        mix_samples_c(&src_samples[i], &dst_samples[i], gain, sample_count - i);
+    }
+
+    OALSFXPP_TARGET_AVX512
+    static void mix_samples_avx512(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = _mm512_set1_ps(gain);
+
+        for ( ; (i + 16) <= sample_count; i += 16)
+        {
+            const auto mixed = _mm512_fmadd_ps(
+                _mm512_loadu_ps(&src_samples[i]),
+                gains,
+                _mm512_loadu_ps(&dst_samples[i]));
+
+            _mm512_storeu_ps(&dst_samples[i], mixed);
+        }
+
+        mix_samples_c(&src_samples[i], &dst_samples[i], gain, sample_count - i);
+    }
+#endif // OALSFXPP_AVX
+
+    // Accumulates the samples scaled by a linear gain ramp, (gain + (i * step)).
+    static void mix_ramp_c(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float step,
+        const int sample_count)
+    {
+        for (int i = 0; i < sample_count; ++i)
+        {
+            dst_samples[i] += src_samples[i] * (gain + (static_cast<float>(i) * step));
+        }
+    }
+
+    static void mix_ramp_sse2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float step,
+        const int sample_count)
+    {
+        static constexpr float ramp_offsets[4] = {0.0F, 1.0F, 2.0F, 3.0F};
+
+        auto i = 0;
+
+        const auto ramp = Float4::load(ramp_offsets) * Float4::set1(step);
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            const auto gains = Float4::set1(gain + (static_cast<float>(i) * step)) + ramp;
+            const auto mixed = Float4::load(&dst_samples[i]) + (Float4::load(&src_samples[i]) * gains);
+
+            mixed.store(&dst_samples[i]);
+        }
+
+        const auto tail_gain = gain + (static_cast<float>(i) * step);
+
+        mix_ramp_c(&src_samples[i], &dst_samples[i], tail_gain, step, sample_count - i);
+    }
+
+#ifdef OALSFXPP_AVX
+    OALSFXPP_TARGET_AVX2
+    static void mix_ramp_avx2(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float step,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto ramp = _mm256_mul_ps(
+            _mm256_setr_ps(0.0F, 1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F, 7.0F),
+            _mm256_set1_ps(step));
+
+        for ( ; (i + 8) <= sample_count; i += 8)
+        {
+            const auto gains = _mm256_add_ps(_mm256_set1_ps(gain + (static_cast<float>(i) * step)), ramp);
+
+            const auto mixed = _mm256_fmadd_ps(
+                _mm256_loadu_ps(&src_samples[i]),
+                gains,
+                _mm256_loadu_ps(&dst_samples[i]));
+
+            _mm256_storeu_ps(&dst_samples[i], mixed);
+        }
+
+        const auto tail_gain = gain + (static_cast<float>(i) * step);
+
+        mix_ramp_c(&src_samples[i], &dst_samples[i], tail_gain, step, sample_count - i);
+    }
+
+    OALSFXPP_TARGET_AVX512
+    static void mix_ramp_avx512(
+        const float* src_samples,
+        float* dst_samples,
+        const float gain,
+        const float step,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto ramp = _mm512_mul_ps(
+            _mm512_setr_ps(
+                0.0F, 1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F, 7.0F,
+                8.0F, 9.0F, 10.0F, 11.0F, 12.0F, 13.0F, 14.0F, 15.0F),
+            _mm512_set1_ps(step));
+
+        for ( ; (i + 16) <= sample_count; i += 16)
+        {
+            const auto gains = _mm512_add_ps(_mm512_set1_ps(gain + (static_cast<float>(i) * step)), ramp);
+
+            const auto mixed = _mm512_fmadd_ps(
+                _mm512_loadu_ps(&src_samples[i]),
+                gains,
+                _mm512_loadu_ps(&dst_samples[i]));
+
+            _mm512_storeu_ps(&dst_samples[i], mixed);
+        }
+
+        const auto tail_gain = gain + (static_cast<float>(i) * step);
+
+        mix_ramp_c(&src_samples[i], &dst_samples[i], tail_gain, step, sample_count - i);
+    }
+#endif // OALSFXPP_AVX
+
+    // Reads the samples at the indices, scaled by a constant gain.
+    static void gather_samples_c(
+        const float* src_samples,
+        const int* indices,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        for (int i = 0; i < sample_count; ++i)
+        {
+            dst_samples[i] = src_samples[indices[i]] * gain;
+        }
+    }
+
+#ifdef OALSFXPP_AVX
+    OALSFXPP_TARGET_AVX2
+    static void gather_samples_avx2(
+        const float* src_samples,
+        const int* indices,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = _mm256_set1_ps(gain);
+
+        for ( ; (i + 8) <= sample_count; i += 8)
+        {
+            const auto offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&indices[i]));
+            const auto samples = _mm256_i32gather_ps(src_samples, offsets, 4);
+
+            _mm256_storeu_ps(&dst_samples[i], _mm256_mul_ps(samples, gains));
+        }
+
+        gather_samples_c(src_samples, &indices[i], &dst_samples[i], gain, sample_count - i);
+    }
+
+    OALSFXPP_TARGET_AVX512
+    static void gather_samples_avx512(
+        const float* src_samples,
+        const int* indices,
+        float* dst_samples,
+        const float gain,
+        const int sample_count)
+    {
+        auto i = 0;
+
+        const auto gains = _mm512_set1_ps(gain);
+
+        for ( ; (i + 16) <= sample_count; i += 16)
+        {
+            const auto offsets = _mm512_loadu_si512(&indices[i]);
+            const auto samples = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, offsets, src_samples, 4);
+
+            _mm512_storeu_ps(&dst_samples[i], _mm512_mul_ps(samples, gains));
+        }
+
+        gather_samples_c(src_samples, &indices[i], &dst_samples[i], gain, sample_count - i);
+    }
+#endif // OALSFXPP_AVX
+
+    // Interleaves the channel buffers into the output.
+    static void write_interleaved_c(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count)
+    {
+        for (int j = 0; j < channel_count; ++j)
+        {
+            const auto& src_buffer = src_buffers[j];
+            auto out = &dst_buffer[(offset * channel_count) + j];
+
+            for (int i = 0; i < sample_count; ++i)
+            {
+                out[i * channel_count] = src_buffer[i];
+            }
+        }
+    }
+
+    static void write_interleaved_sse2(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count)
+    {
+        auto out = &dst_buffer[offset * channel_count];
+        auto i = 0;
+
+        if (channel_count == 1)
+        {
+            std::copy_n(src_buffers[0].cbegin(), sample_count, out);
+            return;
+        }
+        else if (channel_count == 2)
+        {
+            for ( ; (i + 4) <= sample_count; i += 4)
+            {
+                Float4 lo;
+                Float4 hi;
+
+                Float4::interleave(Float4::load(&src_buffers[0][i]), Float4::load(&src_buffers[1][i]), lo, hi);
+
+                lo.store(&out[(i * 2) + 0]);
+                hi.store(&out[(i * 2) + 4]);
+            }
+        }
+        else if (channel_count == 4)
+        {
+            for ( ; (i + 4) <= sample_count; i += 4)
+            {
+                Float4 v[4];
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    v[j] = Float4::load(&src_buffers[j][i]);
+                }
+
+                Float4::transpose(v[0], v[1], v[2], v[3]);
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    v[j].store(&out[(i + j) * 4]);
+                }
+            }
+        }
+
+        for ( ; i < sample_count; ++i)
+        {
+            for (int j = 0; j < channel_count; ++j)
+            {
+                out[(i * channel_count) + j] = src_buffers[j][i];
+            }
+        }
+    }
+
+#ifdef OALSFXPP_AVX
+    OALSFXPP_TARGET_AVX2
+    static void write_interleaved_avx2(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count)
+    {
+        if (channel_count != 2)
+        {
+            write_interleaved_sse2(src_buffers, dst_buffer, offset, sample_count, channel_count);
+            return;
+        }
+
+        auto out = &dst_buffer[offset * 2];
+        auto i = 0;
+
+        for ( ; (i + 8) <= sample_count; i += 8)
+        {
+            const auto l = _mm256_loadu_ps(&src_buffers[0][i]);
+            const auto r = _mm256_loadu_ps(&src_buffers[1][i]);
+
+            const auto lo = _mm256_unpacklo_ps(l, r);
+            const auto hi = _mm256_unpackhi_ps(l, r);
+
+            _mm256_storeu_ps(&out[(i * 2) + 0], _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(&out[(i * 2) + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+
+        for ( ; i < sample_count; ++i)
+        {
+            out[(i * 2) + 0] = src_buffers[0][i];
+            out[(i * 2) + 1] = src_buffers[1][i];
+        }
+    }
+
+    OALSFXPP_TARGET_AVX512
+    static void write_interleaved_avx512(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count)
+    {
+        if (channel_count != 2)
+        {
+            write_interleaved_avx2(src_buffers, dst_buffer, offset, sample_count, channel_count);
+            return;
+        }
+
+        // The left samples are at 0-15 of the permutation, the right ones at
+        // 16-31.
+        const auto lo_indices = _mm512_set_epi32(23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0);
+        const auto hi_indices = _mm512_set_epi32(31, 15, 30, 14, 29, 13, 28, 12, 27, 11, 26, 10, 25, 9, 24, 8);
+
+        auto out = &dst_buffer[offset * 2];
+        auto i = 0;
+
+        for ( ; (i + 16) <= sample_count; i += 16)
+        {
+            const auto l = _mm512_loadu_ps(&src_buffers[0][i]);
+            const auto r = _mm512_loadu_ps(&src_buffers[1][i]);
+
+            _mm512_storeu_ps(&out[(i * 2) + 0], _mm512_permutex2var_ps(l, lo_indices, r));
+            _mm512_storeu_ps(&out[(i * 2) + 16], _mm512_permutex2var_ps(l, hi_indices, r));
+        }
+
+        for ( ; i < sample_count; ++i)
+        {
+            out[(i * 2) + 0] = src_buffers[0][i];
+            out[(i * 2) + 1] = src_buffers[1][i];
+        }
+    }
+#endif // OALSFXPP_AVX
+
+    // Basically the inverse of the "mix". Rather than one input going to multiple
+    // outputs (each with its own gain), it's multiple inputs (each with its own
+    // gain) going to one output. This applies one row (vs one column) of a matrix
+    // transform. And as the matrices are more or less static once set up, no
+    // stepping is necessary.
+    static void mix(
+        const float* data,
+        const int channel_count,
+        SampleBuffers& dst_buffers,
+        float* current_gains,
+        const float* target_gains,
+        const int counter,
+        const int dst_position,
+        const int buffer_size)
+    {
+        const auto delta = ((counter > 0) ? 1.0F / static_cast<float>(counter) : 0.0F);
+
+        for (int c = 0; c < channel_count; ++c)
+        {
+            auto pos = 0;
+            auto gain = current_gains[c];
+            const auto step = (target_gains[c] - gain) * delta;
+
+            if (std::abs(step) > Math::get_epsilon())
+            {
+                pos = std::min(buffer_size, counter);
+
+                Kernels::current.mix_ramp_(data, &dst_buffers[c][dst_position], gain, step, pos);
+
+                if (pos == counter)
+                {
+                    gain = target_gains[c];
+                }
+                else
+                {
+                    gain += static_cast<float>(pos) * step;
+                }
+
+                current_gains[c] = gain;
+            }
+
+            if (!(std::abs(gain) > silence_threshold_gain))
+            {
+                continue;
+            }
+
+            Kernels::current.mix_(&data[pos], &dst_buffers[c][dst_position + pos], gain, buffer_size - pos);
+        }
+    }
+}; // MixHelpers
+
+
+Kernels Kernels::current = {
+    SimdLevel::scalar,
+    nullptr,
+    MixHelpers::mix_samples_c,
+    MixHelpers::mix_ramp_c,
+    MixHelpers::gather_samples_c,
+    Waveshaper::shape_c,
+    MixHelpers::write_interleaved_c,
+};
+
+std::atomic<SimdLevel> Kernels::max_simd_level{SimdLevel::avx512};
+std::atomic<bool> Kernels::is_selected{false};
+
+SimdLevel Kernels::get_cpu_simd_level()
+{
+#if !defined(OALSFXPP_SSE2)
+    return SimdLevel::scalar;
+#elif !defined(OALSFXPP_AVX)
+    return SimdLevel::sse2;
+#elif defined(_MSC_VER)
+    int regs[4];
+
+    __cpuid(regs, 0);
+
+    if (regs[0] < 7)
+    {
+        return SimdLevel::sse2;
+    }
+
+    __cpuid(regs, 1);
+
+    const auto has_fma = ((regs[2] & (1 << 12)) != 0);
+    const auto has_os_xsave = ((regs[2] & (1 << 27)) != 0);
+
+    if (!has_os_xsave)
+    {
+        return SimdLevel::sse2;
+    }
+
+    // YMM state (bits 1-2), and opmask and ZMM states (bits 5-7).
+    const auto xcr0 = _xgetbv(0);
+    const auto has_os_avx = ((xcr0 & 0x06) == 0x06);
+    const auto has_os_avx512 = ((xcr0 & 0xE6) == 0xE6);
+
+    __cpuidex(regs, 7, 0);
+
+    const auto has_avx2 = ((regs[1] & (1 << 5)) != 0);
+    const auto has_avx512f = ((regs[1] & (1 << 16)) != 0);
+
+    if (!has_os_avx || !has_avx2 || !has_fma)
+    {
+        return SimdLevel::sse2;
+    }
+
+    return (has_os_avx512 && has_avx512f) ? SimdLevel::avx512 : SimdLevel::avx2;
+#else
+    __builtin_cpu_init();
+
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma"))
+    {
+        return SimdLevel::sse2;
+    }
+
+    return __builtin_cpu_supports("avx512f") ? SimdLevel::avx512 : SimdLevel::avx2;
+#endif
+}
+
+void Kernels::select()
+{
+    // Thread-safe, and run once.
+    static const auto is_selected_once = (select_once(), true);
+
+    static_cast<void>(is_selected_once);
+}
+
+void Kernels::select_once()
+{
+    // Marked before the level is read, so a level stored after the mark is
+    // known to be ignored.
+    is_selected.store(true);
+
+    auto simd_level = max_simd_level.load();
+
+    const auto env_simd_level = std::getenv("OALSFXPP_SIMD");
+
+    if (env_simd_level)
+    {
+        if (std::strcmp(env_simd_level, "scalar") == 0)
+        {
+            simd_level = SimdLevel::scalar;
+        }
+        else if (std::strcmp(env_simd_level, "sse2") == 0)
+        {
+            simd_level = SimdLevel::sse2;
+        }
+        else if (std::strcmp(env_simd_level, "avx2") == 0)
+        {
+            simd_level = SimdLevel::avx2;
+        }
+        else if (std::strcmp(env_simd_level, "avx512") == 0)
+        {
+            simd_level = SimdLevel::avx512;
+        }
+    }
+
+    simd_level = std::min(simd_level, get_cpu_simd_level());
+
+    auto& kernels = current;
+
+    kernels.simd_level_ = simd_level;
+
+    switch (simd_level)
+    {
+#ifdef OALSFXPP_AVX
+    case SimdLevel::avx512:
+        kernels.filter_block_ = [](FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+        {
+            filter.process_block_avx512(sample_count, src_samples, dst_samples);
+        };
+
+        kernels.mix_ = MixHelpers::mix_samples_avx512;
+        kernels.mix_ramp_ = MixHelpers::mix_ramp_avx512;
+        kernels.gather_ = MixHelpers::gather_samples_avx512;
+        kernels.waveshape_ = Waveshaper::shape_avx2;
+        kernels.write_interleaved_ = MixHelpers::write_interleaved_avx512;
+        break;
+
+    case SimdLevel::avx2:
+        kernels.filter_block_ = [](FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+        {
+            filter.process_block_avx2(sample_count, src_samples, dst_samples);
+        };
+
+        kernels.mix_ = MixHelpers::mix_samples_avx2;
+        kernels.mix_ramp_ = MixHelpers::mix_ramp_avx2;
+        kernels.gather_ = MixHelpers::gather_samples_avx2;
+        kernels.waveshape_ = Waveshaper::shape_avx2;
+        kernels.write_interleaved_ = MixHelpers::write_interleaved_avx2;
+        break;
+#endif // OALSFXPP_AVX
+
+#ifdef OALSFXPP_SSE2
+    case SimdLevel::sse2:
+        kernels.filter_block_ = [](FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+        {
+            filter.process_block_sse2(sample_count, src_samples, dst_samples);
+        };
+
+        kernels.mix_ = MixHelpers::mix_samples_sse2;
+        kernels.mix_ramp_ = MixHelpers::mix_ramp_sse2;
+        kernels.gather_ = MixHelpers::gather_samples_c;
+        kernels.waveshape_ = Waveshaper::shape_sse2;
+        kernels.write_interleaved_ = MixHelpers::write_interleaved_sse2;
+        break;
+#endif // OALSFXPP_SSE2
+
+    default:
+        kernels.simd_level_ = SimdLevel::scalar;
+        kernels.filter_block_ = nullptr;
+        kernels.mix_ = MixHelpers::mix_samples_c;
+        kernels.mix_ramp_ = MixHelpers::mix_ramp_c;
+        kernels.gather_ = MixHelpers::gather_samples_c;
+        kernels.waveshape_ = Waveshaper::shape_c;
+        kernels.write_interleaved_ = MixHelpers::write_interleaved_c;
+        break;
+    }
+}
+
+
+// ==========================================================================
+// Api::Impl
+
+struct ApiImplErrorMessages
+{
+    static constexpr auto NoError = "";
+    static constexpr auto InvalidChannelFormat = "Invalid channel format.";
+    static constexpr auto SamplingRateOutOfRange = "Sampling rate is out of range.";
+    static constexpr auto EffectCountOutOfRange = "Effect count is out of range.";
+    static constexpr auto EffectSamplingRateOutOfRange = "Effect sampling rate is out of range.";
+    static constexpr auto StateMismatch = "The state was saved for another configuration or effects.";
+    static constexpr auto InvalidState = "Invalid state.";
+}; // ApiImplErrorMessages
+
+
+class Api::Impl
+{
+public:
+    using OutputResamplers = std::array<Resampler, max_channels>;
+
+
+    Device device_;
+    Source source_;
+    EffectContexts effect_contexts_;
+    int effect_count_;
+    const char* error_message_;
+
+    // The effect slots run on a device of their own when their sampling rate
+    // differs from the device one.
+    bool is_effect_resampled_;
+    Device effect_device_;
+    ResamplerFilter wet_filter_;
+    ResamplerFilter output_filter_;
+    OutputResamplers output_resamplers_;
+
+    // The samples waiting in a wet resampler and in an output one together,
+    // in the steps of their filters. It stays the same from chunk to chunk,
+    // so each chunk of the output is whole.
+    long long resampling_lag_;
+
+    // Output of one effect slot at a time, when the slots are mixed into
+    // separate outputs.
+    SampleBuffers stem_buffers_;
+
+    // The crossfade time of an effect swap, in seconds, and the output of one
+    // of the swapped states at a time.
+    float effect_swap_time_;
+    SampleBuffers swap_buffers_;
+
+    // The states retired from the swaps. They are destroyed once the mix call
+    // that retired them has written its output, rather than amid the effects.
+    std::vector<EffectSlot::EffectStateUPtr> retired_states_;
+
+    // The start of a saved state, "OSFX" in the native byte order, and the
+    // version of its layout.
+    static constexpr std::uint32_t state_signature = 0x5846534F;
+    static constexpr int state_version = 1;
+
+
+    Impl()
+        :
+        device_{},
+        source_{},
+        effect_contexts_{},
+        effect_count_{},
+        error_message_{ApiImplErrorMessages::NoError},
+        is_effect_resampled_{},
+        effect_device_{},
+        wet_filter_{},
+        output_filter_{},
+        output_resamplers_{},
+        resampling_lag_{},
+        stem_buffers_{},
+        effect_swap_time_{},
+        swap_buffers_{},
+        retired_states_{}
+    {
+    }
+
+    ~Impl()
+    {
+        uninitialize();
+    }
+
+
+    bool initialize(
+        const ChannelFormat channel_format,
+        const int sampling_rate,
+        const int effect_count,
+        const int effect_sampling_rate)
+    {
+        uninitialize();
+
+        const auto channel_count = Device::channel_format_to_channel_count(channel_format);
+
+        if (channel_count == 0)
+        {
+            error_message_ = ApiImplErrorMessages::InvalidChannelFormat;
+            return false;
+        }
+
+        if (sampling_rate < min_sampling_rate)
+        {
+            error_message_ = ApiImplErrorMessages::SamplingRateOutOfRange;
+            return false;
+        }
+
+        if (effect_count <= 0 || effect_count > max_effects)
+        {
+            error_message_ = ApiImplErrorMessages::EffectCountOutOfRange;
+            return false;
+        }
+
+        if (effect_sampling_rate < min_sampling_rate || effect_sampling_rate > sampling_rate)
+        {
+            error_message_ = ApiImplErrorMessages::EffectSamplingRateOutOfRange;
+            return false;
+        }
+
+        Kernels::select();
+
+        device_.initialize(channel_format, sampling_rate);
+
+        effect_count_ = effect_count;
+
+        effect_contexts_.clear();
+        effect_contexts_.resize(effect_count_);
+
+        initialize_effect_resampling(effect_sampling_rate);
+
+        stem_buffers_.clear();
+
+        if (!is_effect_resampled_)
+        {
+            stem_buffers_.resize(device_.channel_count_);
+        }
+
+        auto& effect_device = get_effect_device();
+
+        // A swap per slot at most, between the changes of the effects.
+        retired_states_.reserve(effect_count_);
+
+        for (auto& effect_context : effect_contexts_)
+        {
+            effect_context.deferred_effect_.set_type_and_defaults(EffectType::null);
+            effect_context.effect_slot_.initialize();
+
+            auto effect_state = effect_context.effect_slot_.effect_state_.get();
+            effect_state->dst_buffers_ = &effect_device.sample_buffers_;
+            effect_state->dst_channel_count_ = effect_device.channel_count_;
+            effect_state->update_device(effect_device);
+            effect_context.effect_slot_.is_props_changed_ = true;
+        }
+
+        source_.initialize(effect_count);
+
+        for (int i = 0; i < device_.channel_count_; ++i)
+        {
+            source_.direct_.channels_[i].reset();
+
+            for (auto& aux : source_.auxes_)
+            {
+                aux.channels_[i].reset();
+            }
+        }
+
+        return true;
+    }
+
+    void uninitialize()
+    {
+        for (auto& effect_context : effect_contexts_)
+        {
+            effect_context.effect_slot_.uninitialize();
+        }
+
+        device_.uninitialize();
+        effect_device_.uninitialize();
+    }
+
+    // Gets the device the effect slots run on.
+    Device& get_effect_device()
+    {
+        return is_effect_resampled_ ? effect_device_ : device_;
+    }
+
+    void initialize_effect_resampling(
+        const int effect_sampling_rate)
+    {
+        is_effect_resampled_ = (effect_sampling_rate != device_.sampling_rate_);
+
+        if (!is_effect_resampled_)
+        {
+            effect_device_ = Device{};
+            return;
+        }
+
+        effect_device_ = device_;
+        effect_device_.sampling_rate_ = effect_sampling_rate;
+
+        wet_filter_.initialize(device_.sampling_rate_, effect_sampling_rate);
+        output_filter_.initialize(effect_sampling_rate, device_.sampling_rate_);
+
+        // The wet resamplers output every sample as soon as its filter is
+        // full. The output resamplers are delayed by that amount, plus their
+        // own filter and a margin for the rounding, so they always have the
+        // samples for a whole chunk.
+        const auto wet_delay = static_cast<int>(std::ceil(
+            (0.5 * wet_filter_.get_tap_count() * effect_sampling_rate) / device_.sampling_rate_));
+
+        const auto output_delay = wet_delay + (output_filter_.get_tap_count() / 2) + 2;
+
+        for (auto& effect_context : effect_contexts_)
+        {
+            for (auto& resampler : effect_context.wet_resamplers_)
+            {
+                resampler.initialize(wet_filter_, max_sample_buffer_size, 0);
+            }
+
+            effect_context.resampled_wet_buffer_.resize(max_effect_channels);
+        }
+
+        for (int i = 0; i < device_.channel_count_; ++i)
+        {
+            output_resamplers_[i].initialize(output_filter_, max_sample_buffer_size, output_delay);
+        }
+
+        const auto& wet_resampler = effect_contexts_.front().wet_resamplers_.front();
+        const auto& output_resampler = output_resamplers_.front();
+
+        resampling_lag_ =
+            wet_resampler.get_lag(wet_resampler.get_position()) +
+            output_resampler.get_lag(output_resampler.get_position());
+    }
+
+    void mix_source(
+        const int sample_count)
+    {
+        const auto channel_count = device_.channel_count_;
+
+        for (int chan = 0; chan < channel_count; ++chan)
+        {
+            for (int i = 0; i < sample_count; ++i)
+            {
+                device_.resampled_data_[i] = device_.source_samples_[(i * channel_count) + chan];
+            }
+
+
+            auto parms = &source_.direct_.channels_[chan];
+
+            auto samples = apply_filters(
+                &parms->low_pass_,
+                &parms->high_pass_,
+                device_.filtered_data_.data(),
+                device_.resampled_data_.data(),
+                sample_count,
+                source_.direct_.filter_type_);
+
+            parms->current_gains_ = parms->target_gains_;
+
+            MixHelpers::mix(
+                samples,
+                source_.direct_.channel_count_,
+                *source_.direct_.buffers_,
+                parms->current_gains_.data(),
+                parms->target_gains_.data(),
+                0,
+                0,
+                sample_count);
+
+            for (auto& aux : source_.auxes_)
+            {
+                if (!aux.buffers_)
+                {
+                    continue;
+                }
+
+                parms = &aux.channels_[chan];
+
+                samples = apply_filters(
+                    &parms->low_pass_,
+                    &parms->high_pass_,
+                    device_.filtered_data_.data(),
+                    device_.resampled_data_.data(),
+                    sample_count,
+                    aux.filter_type_);
+
+                parms->current_gains_ = parms->target_gains_;
+
+                MixHelpers::mix(
+                    samples,
+                    aux.channel_count_,
+                    *aux.buffers_,
+                    parms->current_gains_.data(),
+                    parms->target_gains_.data(),
+                    0,
+                    0,
+                    sample_count);
+            }
+        }
+    }
+
+    // The caller's outputs for the dry path and the effect slots.
+    struct StemOutputs
+    {
+        float* const* dry_channels_;
+        float* const* const* effect_channels_;
+        int offset_;
+    }; // StemOutputs
+
+
+    void mix_data(
+        const int sample_count,
+        const float* src_samples,
+        float* dst_samples,
+        const StemOutputs* stem_outputs = nullptr)
+    {
+        device_.source_samples_ = src_samples;
+
+        for (int samples_done = 0; samples_done < sample_count; )
+        {
+            const auto samples_to_do = std::min(sample_count - samples_done, max_sample_buffer_size);
+
+            for (int c = 0; c < device_.channel_count_; ++c)
+            {
+                std::fill_n(device_.sample_buffers_[c].begin(), samples_to_do, 0.0F);
+            }
+
+            update_context_sources();
+
+            for (auto& effect_context : effect_contexts_)
+            {
+                for (int c = 0; c < max_effect_channels; ++c)
+                {
+                    std::fill_n(effect_context.effect_slot_.wet_buffer_[c].begin(), samples_to_do, 0.0F);
+                }
+            }
+
+            // source processing
+            mix_source(samples_to_do);
+
+            // effect slot processing
+            if (stem_outputs)
+            {
+                process_effect_stems(samples_to_do, *stem_outputs, samples_done, dst_samples != nullptr);
+            }
+            else if (is_effect_resampled_)
+            {
+                process_resampled_effects(samples_to_do);
+            }
+            else
+            {
+                for (auto& effect_context : effect_contexts_)
+                {
+                    auto state = effect_context.effect_slot_.effect_state_.get();
+
+                    process_effect_slot(
+                        effect_context.effect_slot_,
+                        samples_to_do,
+                        effect_context.effect_slot_.wet_buffer_,
+                        *state->dst_buffers_,
+                        state->dst_channel_count_);
+                }
+            }
+
+            if (dst_samples)
+            {
+                write_f32(
+                    device_.sample_buffers_,
+                    dst_samples,
+                    samples_done,
+                    samples_to_do,
+                    device_.channel_count_);
+            }
+
+            samples_done += samples_to_do;
+        }
+    }
+
+    // Saves the runtime state after the configuration it belongs to.
+    //
+    // The pending changes are applied first, as the next mix would do, so the
+    // state matches the applied properties.
+    void save_state(
+        std::vector<unsigned char>& state)
+    {
+        update_context_sources();
+
+        state.clear();
+
+        StateWriter writer{state};
+
+        writer.write(state_signature);
+        writer.write(state_version);
+        writer.write(device_.channel_format_);
+        writer.write(device_.sampling_rate_);
+        writer.write(get_effect_device().sampling_rate_);
+        writer.write(effect_count_);
+
+        for (const auto& effect_context : effect_contexts_)
+        {
+            writer.write(effect_context.effect_slot_.effect_.type_);
+        }
+
+        for (int c = 0; c < device_.channel_count_; ++c)
+        {
+            source_.direct_.channels_[c].low_pass_.save_state(writer);
+            source_.direct_.channels_[c].high_pass_.save_state(writer);
+
+            for (const auto& aux : source_.auxes_)
+            {
+                aux.channels_[c].low_pass_.save_state(writer);
+                aux.channels_[c].high_pass_.save_state(writer);
+            }
+        }
+
+        for (const auto& effect_context : effect_contexts_)
+        {
+            if (is_effect_resampled_)
+            {
+                for (const auto& resampler : effect_context.wet_resamplers_)
+                {
+                    resampler.save_state(writer);
+                }
+            }
+
+            effect_context.effect_slot_.effect_state_->save_state(writer);
+        }
+
+        if (is_effect_resampled_)
+        {
+            for (int c = 0; c < device_.channel_count_; ++c)
+            {
+                output_resamplers_[c].save_state(writer);
+            }
+        }
+    }
+
+    // Loads the runtime state saved for the same configuration and applied
+    // properties.
+    //
+    // Nothing is loaded if the configuration differs. A corrupted state is
+    // found out only while reading the whole of it, so it is read by a
+    // validating reader first, and is loaded only if that finds it intact.
+    bool load_state(
+        const unsigned char* state,
+        const int state_size)
+    {
+        update_context_sources();
+
+        StateReader reader{state, state_size};
+
+        read_state_header(reader);
+
+        if (reader.is_failed())
+        {
+            error_message_ = ApiImplErrorMessages::StateMismatch;
+            return false;
+        }
+
+        StateReader validating_reader{state, state_size, true};
+
+        if (!read_state(validating_reader))
+        {
+            error_message_ = ApiImplErrorMessages::InvalidState;
+            return false;
+        }
+
+        StateReader loading_reader{state, state_size};
+
+        read_state(loading_reader);
+
+        return true;
+    }
+
+
+private:
+    // Expects the configuration the state was saved for.
+    void read_state_header(
+        StateReader& reader)
+    {
+        reader.expect(state_signature);
+        reader.expect(state_version);
+        reader.expect(device_.channel_format_);
+        reader.expect(device_.sampling_rate_);
+        reader.expect(get_effect_device().sampling_rate_);
+        reader.expect(effect_count_);
+
+        for (const auto& effect_context : effect_contexts_)
+        {
+            reader.expect(effect_context.effect_slot_.effect_.type_);
+        }
+    }
+
+    // Reads the whole state, and returns false if it is corrupted. The
+    // runtime state is partially loaded then, unless the reader is a
+    // validating one.
+    bool read_state(
+        StateReader& reader)
+    {
+        read_state_header(reader);
+
+        for (int c = 0; c < device_.channel_count_; ++c)
+        {
+            source_.direct_.channels_[c].low_pass_.load_state(reader);
+            source_.direct_.channels_[c].high_pass_.load_state(reader);
+
+            for (auto& aux : source_.auxes_)
+            {
+                aux.channels_[c].low_pass_.load_state(reader);
+                aux.channels_[c].high_pass_.load_state(reader);
+            }
+        }
+
+        // The positions of the first resamplers, which the others have to be
+        // in step with.
+        auto wet_position = Resampler::Position{};
+        auto output_position = Resampler::Position{};
+        auto is_in_step = true;
+
+        for (int i = 0; i < effect_count_; ++i)
+        {
+            auto& effect_context = effect_contexts_[i];
+
+            if (is_effect_resampled_)
+            {
+                for (int c = 0; c < max_effect_channels; ++c)
+                {
+                    auto position = Resampler::Position{};
+
+                    effect_context.wet_resamplers_[c].load_state(reader, position);
+
+                    if (i == 0 && c == 0)
+                    {
+                        wet_position = position;
+                    }
+
+                    is_in_step = is_in_step && position.is_in_step_with(wet_position);
+                }
+            }
+
+            effect_context.effect_slot_.effect_state_->load_state(reader);
+        }
+
+        if (is_effect_resampled_)
+        {
+            for (int c = 0; c < device_.channel_count_; ++c)
+            {
+                auto position = Resampler::Position{};
+
+                output_resamplers_[c].load_state(reader, position);
+
+                if (c == 0)
+                {
+                    output_position = position;
+                }
+
+                is_in_step = is_in_step && position.is_in_step_with(output_position);
+            }
+        }
+
+        if (reader.is_failed() || !reader.is_end())
+        {
+            return false;
+        }
+
+        return !is_effect_resampled_ || (is_in_step && is_resampling_in_step(wet_position, output_position));
+    }
+
+    // Whether the resamplers at the positions are where a mix leaves them.
+    // Each of them is valid on its own after loading, but the mix relies on
+    // the wet ones being drained and in step, and on the output ones having
+    // the samples for a whole chunk.
+    bool is_resampling_in_step(
+        const Resampler::Position& wet_position,
+        const Resampler::Position& output_position) const
+    {
+        const auto& wet_resampler = effect_contexts_.front().wet_resamplers_.front();
+        const auto& output_resampler = output_resamplers_.front();
+
+        return
+            wet_resampler.is_drained(wet_position) &&
+            (wet_resampler.get_lag(wet_position) + output_resampler.get_lag(output_position)) == resampling_lag_;
+    }
+
+    // Copies the dry path and each effect slot to the caller's outputs. The
+    // slots are processed into a buffer of their own, and are added to the
+    // dry path only if the sum is wanted. A slot is processed even if neither
+    // its stem nor the sum is wanted, so its state goes on as in a plain mix.
+    void process_effect_stems(
+        const int sample_count,
+        const StemOutputs& stem_outputs,
+        const int samples_done,
+        const bool is_sum_needed)
+    {
+        const auto channel_count = device_.channel_count_;
+        const auto offset = stem_outputs.offset_ + samples_done;
+
+        if (stem_outputs.dry_channels_)
+        {
+            for (int c = 0; c < channel_count; ++c)
+            {
+                std::copy_n(device_.sample_buffers_[c].cbegin(), sample_count, &stem_outputs.dry_channels_[c][offset]);
+            }
+        }
+
+        for (int i = 0; i < effect_count_; ++i)
+        {
+            auto& effect_context = effect_contexts_[i];
+            auto& effect_slot = effect_context.effect_slot_;
+
+            const auto stem_channels = (stem_outputs.effect_channels_ ? stem_outputs.effect_channels_[i] : nullptr);
+
+            if (effect_slot.effect_.type_ == EffectType::null && !effect_slot.swap_state_)
+            {
+                if (stem_channels)
+                {
+                    for (int c = 0; c < channel_count; ++c)
+                    {
+                        std::fill_n(&stem_channels[c][offset], sample_count, 0.0F);
+                    }
+                }
+
+                continue;
+            }
+
+            for (int c = 0; c < channel_count; ++c)
+            {
+                std::fill_n(stem_buffers_[c].begin(), sample_count, 0.0F);
+            }
+
+            process_effect_slot(
+                effect_slot,
+                sample_count,
+                effect_slot.wet_buffer_,
+                stem_buffers_,
+                effect_slot.effect_state_->dst_channel_count_);
+
+            for (int c = 0; c < channel_count; ++c)
+            {
+                if (stem_channels)
+                {
+                    std::copy_n(stem_buffers_[c].cbegin(), sample_count, &stem_channels[c][offset]);
+                }
+
+                if (is_sum_needed)
+                {
+                    Kernels::current.mix_(
+                        stem_buffers_[c].data(),
+                        device_.sample_buffers_[c].data(),
+                        1.0F,
+                        sample_count);
+                }
+            }
+        }
+    }
+
+    // Processes an effect slot into the buffers.
+    //
+    // While a swap is in progress, the new state fades in and the swapped one
+    // fades out, both on the same input. The swapped state is retired at the
+    // end of the swap, or as soon as its tail is silent.
+    void process_effect_slot(
+        EffectSlot& effect_slot,
+        const int sample_count,
+        const SampleBuffers& src_buffers,
+        SampleBuffers& dst_buffers,
+        const int channel_count)
+    {
+        if (effect_slot.swap_length_ == 0)
+        {
+            effect_slot.effect_state_->process(sample_count, src_buffers, dst_buffers, channel_count);
+            return;
+        }
+
+        const auto step = 1.0F / static_cast<float>(effect_slot.swap_length_);
+        const auto gain = static_cast<float>(effect_slot.swap_position_) * step;
+        const auto fade_count = std::min(sample_count, effect_slot.swap_length_ - effect_slot.swap_position_);
+
+        process_swap_state(*effect_slot.effect_state_, sample_count, src_buffers, channel_count);
+
+        for (int c = 0; c < channel_count; ++c)
+        {
+            auto src = swap_buffers_[c].data();
+            auto dst = dst_buffers[c].data();
+
+            Kernels::current.mix_ramp_(src, dst, gain, step, fade_count);
+            Kernels::current.mix_(&src[fade_count], &dst[fade_count], 1.0F, sample_count - fade_count);
+        }
+
+        if (effect_slot.swap_state_)
+        {
+            process_swap_state(*effect_slot.swap_state_, sample_count, src_buffers, channel_count);
+
+            auto is_silent = true;
+
+            for (int c = 0; c < channel_count; ++c)
+            {
+                auto src = swap_buffers_[c].data();
+
+                Kernels::current.mix_ramp_(src, dst_buffers[c].data(), 1.0F - gain, -step, fade_count);
+
+                is_silent = is_silent && std::all_of(
+                    src,
+                    src + sample_count,
+                    [](const float sample) { return !(std::abs(sample) > silence_threshold_gain); });
+            }
+
+            effect_slot.swap_silent_count_ = is_silent ? effect_slot.swap_silent_count_ + sample_count : 0;
+        }
+
+        effect_slot.swap_position_ += fade_count;
+
+        const auto is_swapped = (effect_slot.swap_position_ == effect_slot.swap_length_);
+
+        if (effect_slot.swap_state_ &&
+            (is_swapped || effect_slot.swap_silent_count_ >= get_swap_silence_length()))
+        {
+            retired_states_.push_back(std::move(effect_slot.swap_state_));
+        }
+
+        if (is_swapped)
+        {
+            effect_slot.swap_position_ = 0;
+            effect_slot.swap_length_ = 0;
+        }
+    }
+
+    void process_swap_state(
+        EffectState& effect_state,
+        const int sample_count,
+        const SampleBuffers& src_buffers,
+        const int channel_count)
+    {
+        for (int c = 0; c < channel_count; ++c)
+        {
+            std::fill_n(swap_buffers_[c].begin(), sample_count, 0.0F);
+        }
+
+        effect_state.process(sample_count, src_buffers, swap_buffers_, channel_count);
+    }
+
+    // The silence which ends the tail of a swapped state. It outlasts the gaps
+    // between the longest echoes.
+    int get_swap_silence_length()
+    {
+        return get_effect_device().sampling_rate_;
+    }
+
+    // Runs the effect slots at the effect sampling rate, and mixes their
+    // output back at the device rate.
+    void process_resampled_effects(
+        const int sample_count)
+    {
+        const auto channel_count = device_.channel_count_;
+
+        // The wet resamplers are in step, so they output the same number of
+        // samples.
+        auto effect_sample_count = 0;
+
+        for (auto& effect_context : effect_contexts_)
+        {
+            for (int c = 0; c < max_effect_channels; ++c)
+            {
+                effect_sample_count = effect_context.wet_resamplers_[c].process(
+                    effect_context.effect_slot_.wet_buffer_[c].data(),
+                    sample_count,
+                    effect_context.resampled_wet_buffer_[c].data(),
+                    max_sample_buffer_size);
+            }
+        }
+
+        for (int c = 0; c < channel_count; ++c)
+        {
+            std::fill_n(effect_device_.sample_buffers_[c].begin(), effect_sample_count, 0.0F);
+        }
+
+        if (effect_sample_count > 0)
+        {
+            for (auto& effect_context : effect_contexts_)
+            {
+                auto state = effect_context.effect_slot_.effect_state_.get();
+
+                process_effect_slot(
+                    effect_context.effect_slot_,
+                    effect_sample_count,
+                    effect_context.resampled_wet_buffer_,
+                    *state->dst_buffers_,
+                    state->dst_channel_count_);
+            }
+        }
+
+        for (int c = 0; c < channel_count; ++c)
+        {
+            const auto output_count = output_resamplers_[c].process(
+                effect_device_.sample_buffers_[c].data(),
+                effect_sample_count,
+                device_.resampled_data_.data(),
+                sample_count);
+
+            assert(output_count == sample_count);
+
+            Kernels::current.mix_(
+                device_.resampled_data_.data(),
+                device_.sample_buffers_[c].data(),
+                1.0F,
+                output_count);
+        }
+    }
+
+    struct ChannelMap
+    {
+        ChannelId channel_id_;
+        float angle_;
+        float elevation_;
+    }; // ChannelMap
+
+    static constexpr ChannelMap mono_map[1] =
+    {
+        {ChannelId::front_center, 0.0F, 0.0F,},
+    };
+
+    static constexpr ChannelMap stereo_map[2] =
+    {
+        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
+    };
+
+    static constexpr ChannelMap quad_map[4] =
+    {
+        {ChannelId::front_left, Math::deg_to_rad(-45.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_right, Math::deg_to_rad(45.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::back_left, Math::deg_to_rad(-135.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::back_right, Math::deg_to_rad(135.0F), Math::deg_to_rad(0.0F),},
+    };
+
+    static constexpr ChannelMap x5_1_map[6] =
+    {
+        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::lfe, 0.0F, 0.0F,},
+        {ChannelId::side_left, Math::deg_to_rad(-110.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::side_right, Math::deg_to_rad(110.0F), Math::deg_to_rad(0.0F),},
+    };
+
+    static constexpr ChannelMap x6_1_map[7] =
+    {
+        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::lfe, 0.0F, 0.0F,},
+        {ChannelId::back_center, Math::deg_to_rad(180.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::side_left, Math::deg_to_rad(-90.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::side_right, Math::deg_to_rad(90.0F), Math::deg_to_rad(0.0F),},
+    };
+
+    static constexpr ChannelMap x7_1_map[8] =
+    {
+        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::lfe, 0.0F, 0.0F,},
+        {ChannelId::back_left, Math::deg_to_rad(-150.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::back_right, Math::deg_to_rad(150.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::side_left, Math::deg_to_rad(-90.0F), Math::deg_to_rad(0.0F),},
+        {ChannelId::side_right, Math::deg_to_rad(90.0F), Math::deg_to_rad(0.0F),},
+    };
+
+
+    static const float* apply_filters(
+        FilterState* lp_filter,
+        FilterState* hp_filter,
+        float* dst_samples,
+        const float* src_samples,
+        const int sample_count,
+        const ActiveFilters filter_type)
+    {
+        switch (filter_type)
+        {
+        case ActiveFilters::none:
+            lp_filter->process_pass_through(sample_count, src_samples);
+            hp_filter->process_pass_through(sample_count, src_samples);
+            break;
+
+        case ActiveFilters::low_pass:
+            lp_filter->process(sample_count, src_samples, dst_samples);
+            hp_filter->process_pass_through(sample_count, dst_samples);
+            return dst_samples;
+
+        case ActiveFilters::high_pass:
+            lp_filter->process_pass_through(sample_count, src_samples);
+            hp_filter->process(sample_count, src_samples, dst_samples);
+            return dst_samples;
+
+        case ActiveFilters::band_pass:
+            for (int i = 0; i < sample_count; )
+            {
+                float temp[256];
+
+                const auto todo = std::min(256, sample_count - i);
+
+                lp_filter->process(todo, src_samples + i, temp);
+                hp_filter->process(todo, temp, dst_samples + i);
+
+                i += todo;
+            }
+
+            return dst_samples;
+        }
+
+        return src_samples;
+    }
+
+    bool calc_effect_slot_params(
+        EffectSlot& effect_slot)
+    {
+        if (!effect_slot.is_props_changed_)
+        {
+            return false;
+        }
+
+        effect_slot.is_props_changed_ = false;
+        effect_slot.effect_state_->update(get_effect_device(), effect_slot, effect_slot.effect_.props_);
+
+        return true;
+    }
+
+    bool calc_source_params(
+        Source& source)
+    {
+        if (!source.are_props_changed_)
+        {
+            return false;
+        }
+
+        source.are_props_changed_ = false;
+
+        return true;
+    }
+
+    void calc_panning_and_filters(
+        const float distance,
+        const float* dir,
+        const float spread,
+        const float dry_gain,
+        const float dry_gain_hf,
+        const float dry_gain_lf,
+        const WetGains& wet_gain,
+        const WetGains& wet_gain_lf,
+        const WetGains& wet_gain_hf)
+    {
+        static_cast<void>(distance);
+        static_cast<void>(dir);
+
+        const auto frequency = device_.sampling_rate_;
+        const ChannelMap* channel_map = nullptr;
+        auto channel_count = 0;
+
+        switch (device_.channel_format_)
+        {
+        case ChannelFormat::mono:
+            channel_map = mono_map;
+            channel_count = 1;
+            break;
+
+        case ChannelFormat::stereo:
+            channel_map = stereo_map;
+            channel_count = 2;
+            break;
+
+        case ChannelFormat::quad:
+            channel_map = quad_map;
+            channel_count = 4;
+            break;
+
+        case ChannelFormat::five_point_one:
+            channel_map = x5_1_map;
+            channel_count = 6;
+            break;
+
+        case ChannelFormat::six_point_one:
+            channel_map = x6_1_map;
+            channel_count = 7;
+            break;
+
+        case ChannelFormat::seven_point_one:
+            channel_map = x7_1_map;
+            channel_count = 8;
+            break;
+
+        case ChannelFormat::b_format:
+            channel_count = max_effect_channels;
+            break;
+
+        case ChannelFormat::none:
+        default:
+            break;
+        }
+
+        if (device_.channel_format_ == ChannelFormat::b_format)
+        {
+            // B-format input. Each channel goes to the same ambisonic channel
+            // of the output and of the effect slots.
+            for (int c = 0; c < channel_count; ++c)
+            {
+                Panning::compute_first_order_gains(
+                    device_.channel_count_,
+                    device_.foa_,
+                    mat4f_identity.m_[c],
+                    dry_gain,
+                    source_.direct_.channels_[c].target_gains_);
+
+                for (int i = 0; i < effect_count_; ++i)
+                {
+                    Panning::compute_first_order_gains_bf(
+                        max_effect_channels,
+                        mat4f_identity.m_[c],
+                        wet_gain[i],
+                        source_.auxes_[i].channels_[c].target_gains_);
+                }
+            }
+        }
+        else
+        {
+            // Non-HRTF rendering. Use normal panning to the output.
+            for (int c = 0; c < channel_count; ++c)
+            {
+                AmbiCoeffs coeffs;
+
+                // Special-case LFE
+                if (channel_map[c].channel_id_ == ChannelId::lfe)
+                {
+                    source_.direct_.channels_[c].target_gains_.fill(0.0F);
+
+                    const auto idx = device_.get_channel_index(channel_map[c].channel_id_);
+
+                    if (idx != -1)
+                    {
+                        source_.direct_.channels_[c].target_gains_[idx] = dry_gain;
+                    }
+
+                    for (auto& aux : source_.auxes_)
+                    {
+                        aux.channels_[c].target_gains_.fill(0.0F);
+                    }
+
+                    continue;
+                }
+
+                Panning::calc_angle_coeffs(channel_map[c].angle_, channel_map[c].elevation_, spread, coeffs);
+
+                Panning::compute_panning_gains(
+                    device_.channel_count_,
+                    device_.dry_,
+                    coeffs,
+                    dry_gain,
+                    source_.direct_.channels_[c].target_gains_);
+
+                for (int i = 0; i < effect_count_; ++i)
+                {
+                    Panning::compute_panning_gains_bf(
+                        max_effect_channels,
+                        coeffs,
+                        wet_gain[i],
+                        source_.auxes_[i].channels_[c].target_gains_);
+                }
+            }
+        }
+
+        const auto hf_scale = SendProps::hp_frequency_reference / frequency;
+        const auto lf_scale = SendProps::lp_frequency_reference / frequency;
+        auto gain_hf = std::max(dry_gain_hf, 0.001F); // Limit -60dB
+        auto gain_lf = std::max(dry_gain_lf, 0.001F);
+
+        source_.direct_.filter_type_ = ActiveFilters::none;
+
+        if (gain_hf != 1.0F)
+        {
+            source_.direct_.filter_type_ = static_cast<ActiveFilters>(
+                static_cast<int>(source_.direct_.filter_type_) | static_cast<int>(ActiveFilters::low_pass));
+        }
+
+        if (gain_lf != 1.0F)
+        {
+            source_.direct_.filter_type_ = static_cast<ActiveFilters>(
+                static_cast<int>(source_.direct_.filter_type_) | static_cast<int>(ActiveFilters::high_pass));
+        }
+
+        source_.direct_.channels_[0].low_pass_.set_params(
+            FilterType::high_shelf,
+            gain_hf,
+            hf_scale,
+            FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
+
+        source_.direct_.channels_[0].high_pass_.set_params(
+            FilterType::low_shelf,
+            gain_lf,
+            lf_scale,
+            FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
+
+        for (int c = 1; c < channel_count; ++c)
+        {
+            FilterState::copy_params(source_.direct_.channels_[0].low_pass_, source_.direct_.channels_[c].low_pass_);
+            FilterState::copy_params(source_.direct_.channels_[0].high_pass_, source_.direct_.channels_[c].high_pass_);
+        }
+
+        for (int i = 0; i < effect_count_; ++i)
+        {
+            auto& aux = source_.auxes_[i];
+            gain_hf = std::max(wet_gain_hf[i], 0.001F);
+            gain_lf = std::max(wet_gain_lf[i], 0.001F);
+
+            aux.filter_type_ = ActiveFilters::none;
+
+            if (gain_hf != 1.0F)
+            {
+                aux.filter_type_ = static_cast<ActiveFilters>(
+                    static_cast<int>(aux.filter_type_) | static_cast<int>(ActiveFilters::low_pass));
+            }
+
+            if (gain_lf != 1.0F)
+            {
+                aux.filter_type_ = static_cast<ActiveFilters>(
+                    static_cast<int>(aux.filter_type_) | static_cast<int>(ActiveFilters::high_pass));
+            }
+
+            aux.channels_[0].low_pass_.set_params(
+                FilterType::high_shelf,
+                gain_hf,
+                hf_scale,
+                FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
+
+            aux.channels_[0].high_pass_.set_params(
+                FilterType::low_shelf,
+                gain_lf,
+                lf_scale,
+                FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
+
+            for (int c = 1; c < channel_count; ++c)
+            {
+                FilterState::copy_params(aux.channels_[0].low_pass_, aux.channels_[c].low_pass_);
+                FilterState::copy_params(aux.channels_[0].high_pass_, aux.channels_[c].high_pass_);
+            }
+        }
+    }
+
+    void calc_non_attn_source_params()
+    {
+        source_.direct_.buffers_ = &device_.sample_buffers_;
+        source_.direct_.channel_count_ = device_.channel_count_;
+
+        for (int i = 0; i < effect_count_; ++i)
+        {
+            if (effect_contexts_[i].effect_slot_.effect_.type_ == EffectType::null)
+            {
+                source_.auxes_[i].buffers_ = nullptr;
+                source_.auxes_[i].channel_count_ = 0;
+            }
+            else
+            {
+                source_.auxes_[i].buffers_ = &effect_contexts_[i].effect_slot_.wet_buffer_;
+                source_.auxes_[i].channel_count_ = max_effect_channels;
+            }
+        }
+
+        // Calculate gains
+        const auto dry_gain = std::min(source_.direct_.props_.gain_, max_mix_gain);
+        const auto dry_gain_hf = source_.direct_.props_.gain_hf_;
+        const auto dry_gain_lf = source_.direct_.props_.gain_lf_;
+
+        constexpr float dir[3] = {0.0F, 0.0F, -1.0F};
+
+        auto wet_gain = WetGains{};
+        auto wet_gain_hf = WetGains{};
+        auto wet_gain_lf = WetGains{};
+
+        for (int i = 0; i < effect_count_; ++i)
+        {
+            wet_gain[i] = std::min(source_.auxes_[i].props_.gain_, max_mix_gain);
+            wet_gain_hf[i] = source_.auxes_[i].props_.gain_hf_;
+            wet_gain_lf[i] = source_.auxes_[i].props_.gain_lf_;
+        }
+
+        calc_panning_and_filters(
+            0.0F,
+            dir,
+            0.0F,
+            dry_gain,
+            dry_gain_hf,
+            dry_gain_lf,
+            wet_gain,
+            wet_gain_lf,
+            wet_gain_hf);
+    }
+
+    void update_context_sources()
+    {
+        auto is_props_updated = false;
+
+        for (auto& effect_context : effect_contexts_)
+        {
+            is_props_updated |= calc_effect_slot_params(effect_context.effect_slot_);
+        }
+
+        is_props_updated |= calc_source_params(source_);
+
+        if (is_props_updated)
+        {
+            calc_non_attn_source_params();
+        }
+    }
+
+    static void write_f32(
+        const SampleBuffers& src_buffers,
+        float* dst_buffer,
+        const int offset,
+        const int sample_count,
+        const int channel_count)
+    {
+        Kernels::current.write_interleaved_(src_buffers, dst_buffer, offset, sample_count, channel_count);
+    }
+}; // Impl
+
+constexpr Api::Impl::ChannelMap Api::Impl::mono_map[1];
+constexpr Api::Impl::ChannelMap Api::Impl::stereo_map[2];
+constexpr Api::Impl::ChannelMap Api::Impl::quad_map[4];
+constexpr Api::Impl::ChannelMap Api::Impl::x5_1_map[6];
+constexpr Api::Impl::ChannelMap Api::Impl::x6_1_map[7];
+constexpr Api::Impl::ChannelMap Api::Impl::x7_1_map[8];
+
+constexpr std::uint32_t Api::Impl::state_signature;
+constexpr int Api::Impl::state_version;
+
+// Api::Impl
+// ==========================================================================
+
+
+// ==========================================================================
+// Api
+
+struct ApiErrorMessages
+{
+    static constexpr auto NoError = "";
+    static constexpr auto AllocateImpl = "Failed to allocate implementaion class.";
+    static constexpr auto NotInitialized = "Not initialized.";
+    static constexpr auto EffectIndexOutOfRange = "Effect index is out of range.";
+    static constexpr auto NoSrcSamples = "No source samples.";
+    static constexpr auto NoDstSamples = "No destination samples.";
+    static constexpr auto StemsWithResampledEffects = "Stems are not available with resampled effects.";
+    static constexpr auto NoState = "No state.";
+    static constexpr auto EffectSwapTimeOutOfRange = "Effect swap time is out of range.";
+}; // ApiErrorMessages
+
+
+Api::Api()
+    :
+    pimpl_{},
+    error_message_{ApiErrorMessages::NoError}
+{
+}
+
+Api::~Api()
+{
+    uninitialize();
+}
+
+bool Api::initialize(
+    const ChannelFormat channel_format,
+    const int sampling_rate,
+    const int effect_count)
+{
+    return initialize(channel_format, sampling_rate, effect_count, sampling_rate);
+}
+
+bool Api::initialize(
+    const ChannelFormat channel_format,
+    const int sampling_rate,
+    const int effect_count,
+    const int effect_sampling_rate)
+{
+    uninitialize();
+
+    pimpl_.reset(new (std::nothrow) Impl{});
+
+    if (!pimpl_)
+    {
+        error_message_ = ApiErrorMessages::AllocateImpl;
+        return false;
+    }
+
+    const auto initialize_result = pimpl_->initialize(channel_format, sampling_rate, effect_count, effect_sampling_rate);
+
+    if (!initialize_result)
+    {
+        error_message_ = pimpl_->error_message_;
+        uninitialize();
+    }
+
+    return initialize_result;
+}
+
+bool Api::is_initialized() const
+{
+    return pimpl_ != nullptr;
+}
+
+int Api::get_sampling_rate() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return 0;
+    }
+
+    return pimpl_->device_.sampling_rate_;
+}
+
+int Api::get_effect_sampling_rate() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return 0;
+    }
+
+    return pimpl_->get_effect_device().sampling_rate_;
+}
+
+ChannelFormat Api::get_channel_format() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return ChannelFormat::none;
+    }
+
+    return pimpl_->device_.channel_format_;
+}
+
+int Api::get_channel_count() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    return pimpl_->device_.channel_count_;
+}
+
+int Api::get_effect_count() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    return pimpl_->effect_count_;
+}
+
+bool Api::get_effect(
+    const int effect_index,
+    Effect& effect) const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    effect = pimpl_->effect_contexts_[effect_index].effect_slot_.effect_;
+
+    return true;
+}
+
+bool Api::get_deferred_effect(
+    const int effect_index,
+    Effect& effect) const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    effect = pimpl_->effect_contexts_[effect_index].deferred_effect_;
+
+    return true;
+}
+
+bool Api::set_effect_type(
+    const int effect_index,
+    const EffectType effect_type)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    pimpl_->effect_contexts_[effect_index].deferred_effect_.set_type_and_defaults(effect_type);
+
+    return true;
+}
+
+bool Api::set_effect_props(
+    const int effect_index,
+    const EffectProps& effect_props)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    pimpl_->effect_contexts_[effect_index].deferred_effect_.props_ = effect_props;
+
+    return true;
+}
+
+bool Api::set_effect(
+    const int effect_index,
+    const Effect& effect)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    pimpl_->effect_contexts_[effect_index].deferred_effect_ = effect;
+
+    return false;
+}
+
+bool Api::set_effect_swap_time(
+    const float swap_time)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (!(swap_time >= 0.0F && swap_time <= max_effect_swap_time))
+    {
+        error_message_ = ApiErrorMessages::EffectSwapTimeOutOfRange;
+        return false;
+    }
+
+    auto& swap_buffers = pimpl_->swap_buffers_;
+
+    if (swap_time > 0.0F && swap_buffers.empty())
+    {
+        swap_buffers.resize(pimpl_->get_effect_device().channel_count_);
+    }
+
+    pimpl_->effect_swap_time_ = swap_time;
+
+    return true;
+}
+
+bool Api::get_send_props(
+    const int effect_index,
+    SendProps& send_props) const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    const auto& props = (
+        effect_index < 0 ?
+        pimpl_->source_.direct_.props_ :
+        pimpl_->source_.auxes_[effect_index].props_);
+
+    send_props = props;
+
+    return true;
+}
+
+bool Api::get_deferred_send_props(
+    const int effect_index,
+    SendProps& send_props) const
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    const auto& props = (
+        effect_index < 0 ?
+        pimpl_->source_.direct_.deferred_props_ :
+        pimpl_->source_.auxes_[effect_index].deferred_props_);
+
+    send_props = props;
+
+    return true;
+}
+
+bool Api::set_send_props(
+    const int effect_index,
+    const SendProps& send_props)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (effect_index >= pimpl_->effect_count_)
+    {
+        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
+        return false;
+    }
+
+    auto& props = (
+        effect_index < 0 ?
+        pimpl_->source_.direct_.deferred_props_ :
+        pimpl_->source_.auxes_[effect_index].props_);
+
+    props = send_props;
+
+    return true;
+}
+
+bool Api::apply_changes()
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    // Effects
+    //
+    auto& effect_device = pimpl_->get_effect_device();
+
+    const auto swap_length = static_cast<int>(pimpl_->effect_swap_time_ * effect_device.sampling_rate_);
+
+    for (auto& effect_context : pimpl_->effect_contexts_)
+    {
+        effect_context.deferred_effect_.normalize();
+
+        if (!Effect::are_equal(effect_context.deferred_effect_, effect_context.effect_slot_.effect_))
+        {
+            effect_context.effect_slot_.set_effect(effect_device, effect_context.deferred_effect_, swap_length);
+        }
+    }
+
+    // Direct send
+    //
+    auto& source = pimpl_->source_;
+    auto& direct_send = source.direct_;
+    direct_send.deferred_props_.normalize();
+
+    if (!SendProps::are_equal(direct_send.deferred_props_, direct_send.props_))
+    {
+        source.are_props_changed_ = true;
+        direct_send.props_ = direct_send.deferred_props_;
+    }
+
+    // Aux sends
+    //
+    for (auto& aux_send : source.auxes_)
+    {
+        aux_send.deferred_props_.normalize();
+
+        if (!SendProps::are_equal(aux_send.props_, aux_send.deferred_props_))
+        {
+            source.are_props_changed_ = true;
+        }
+    }
+
+    return true;
+}
+
+bool Api::mix(
+    const int sample_count,
+    const float* src_samples,
+    float* dst_samples)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (sample_count == 0)
+    {
+        return true;
+    }
+
+    if (!src_samples)
+    {
+        error_message_ = ApiErrorMessages::NoSrcSamples;
+        return false;
+    }
+
+    if (!dst_samples)
+    {
+        error_message_ = ApiErrorMessages::NoDstSamples;
+        return false;
+    }
+
+    const auto channel_count = pimpl_->device_.channel_count_;
+
+    auto buffer_offset = 0;
+    auto remain_count = sample_count;
+
+    while (remain_count > 0)
+    {
+        const auto count = std::min(remain_count, max_sample_buffer_size);
+
+        pimpl_->mix_data(count, &src_samples[buffer_offset], &dst_samples[buffer_offset]);
+
+        buffer_offset += count * channel_count;
+        remain_count -= count;
+    }
+
+    pimpl_->retired_states_.clear();
+
+    return true;
+}
+
+bool Api::mix_stems(
+    const int sample_count,
+    const float* src_samples,
+    float* const* dry_channels,
+    float* const* const* effect_channels,
+    float* dst_samples)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (pimpl_->is_effect_resampled_)
+    {
+        error_message_ = ApiErrorMessages::StemsWithResampledEffects;
+        return false;
+    }
+
+    if (sample_count == 0)
+    {
+        return true;
+    }
+
+    if (!src_samples)
+    {
+        error_message_ = ApiErrorMessages::NoSrcSamples;
+        return false;
+    }
+
+    const auto channel_count = pimpl_->device_.channel_count_;
+
+    auto stem_outputs = Impl::StemOutputs{dry_channels, effect_channels, 0};
+    auto buffer_offset = 0;
+    auto remain_count = sample_count;
+
+    while (remain_count > 0)
+    {
+        const auto count = std::min(remain_count, max_sample_buffer_size);
+
+        pimpl_->mix_data(
+            count,
+            &src_samples[buffer_offset],
+            dst_samples ? &dst_samples[buffer_offset] : nullptr,
+            &stem_outputs);
+
+        buffer_offset += count * channel_count;
+        stem_outputs.offset_ += count;
+        remain_count -= count;
+    }
+
+    pimpl_->retired_states_.clear();
+
+    return true;
+}
+
+bool Api::save_state(
+    std::vector<unsigned char>& state)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    pimpl_->save_state(state);
+
+    return true;
+}
+
+bool Api::load_state(
+    const void* state,
+    const int state_size)
+{
+    if (!is_initialized())
+    {
+        error_message_ = ApiErrorMessages::NotInitialized;
+        return false;
+    }
+
+    if (!state || state_size <= 0)
+    {
+        error_message_ = ApiErrorMessages::NoState;
+        return false;
+    }
+
+    if (!pimpl_->load_state(static_cast<const unsigned char*>(state), state_size))
+    {
+        error_message_ = pimpl_->error_message_;
+        return false;
+    }
+
+    return true;
+}
+
+void Api::uninitialize()
+{
+    pimpl_ = nullptr;
+}
+
+const char* Api::get_error_message() const
+{
+    return pimpl_->error_message_;
+}
+
+int Api::get_min_channels()
+{
+    return 1;
+}
+
+int Api::get_max_channels()
+{
+    return max_channels;
+}
+
+int Api::get_min_sampling_rate()
+{
+    return min_sampling_rate;
+}
+
+int Api::get_max_sampling_rate()
+{
+    return max_sampling_rate;
+}
+
+int Api::get_min_effects()
+{
+    return min_effects;
+}
+
+int Api::get_max_effects()
+{
+    return max_effects;
+}
+
+float Api::get_max_effect_swap_time()
+{
+    return max_effect_swap_time;
+}
+
+SimdLevel Api::get_simd_level()
+{
+    Kernels::select();
+
+    return Kernels::current.simd_level_;
+}
+
+bool Api::set_max_simd_level(
+    const SimdLevel simd_level)
+{
+    Kernels::max_simd_level.store(simd_level);
+
+    return !Kernels::is_selected.load();
+}
+
+ChannelFormat Api::channel_count_to_channel_format(
+    const int channel_count)
+{
+    switch (channel_count)
+    {
+    case 1:
+        return ChannelFormat::mono;
+
+    case 2:
+        return ChannelFormat::stereo;
+
+    case 4:
+        return ChannelFormat::quad;
+
+    case 6:
+        return ChannelFormat::five_point_one;
+
+    case 7:
+        return ChannelFormat::six_point_one;
+
+    case 8:
+        return ChannelFormat::seven_point_one;
+
+    default:
+        return ChannelFormat::none;
+    }
+}
+
+int Api::channel_format_to_channel_count(
+    const ChannelFormat channel_format)
+{
+    return Device::channel_format_to_channel_count(channel_format);
+}
+
+// Api
+// ==========================================================================
+
+
+// ==========================================================================
+// ImpulseResponse
+
+struct ImpulseResponseErrorMessages
+{
+    static constexpr auto NoError = "";
+    static constexpr auto AllocateImpl = "Failed to allocate implementaion class.";
+    static constexpr auto NotLoaded = "Not loaded.";
+    static constexpr auto NoFileName = "No file name.";
+    static constexpr auto MapFile = "Failed to map the file.";
+    static constexpr auto NotWav = "Not a WAV file.";
+    static constexpr auto UnsupportedFormat = "Unsupported sample format.";
+    static constexpr auto ChannelCount = "Expected one or four channels.";
+    static constexpr auto SamplingRate = "Sampling rate out of range.";
+    static constexpr auto NoSamples = "No samples.";
+    static constexpr auto RangeOutOfBounds = "Channel or sample range out of bounds.";
+}; // ImpulseResponseErrorMessages
+
+// A read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile()
+        :
+        data_{},
+        size_{}
+    {
+    }
+
+    MappedFile(
+        const MappedFile& that) = delete;
+
+    MappedFile& operator=(
+        const MappedFile& that) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+
+    bool open(
+        const char* file_name)
+    {
+        close();
+
+#ifdef _WIN32
+        const auto file = ::CreateFileA(
+            file_name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        auto size = LARGE_INTEGER{};
+
+        if (!::GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+            static_cast<unsigned long long>(size.QuadPart) > std::numeric_limits<std::size_t>::max())
+        {
+            ::CloseHandle(file);
+            return false;
+        }
+
+        const auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        ::CloseHandle(file);
+
+        if (!mapping)
+        {
+            return false;
+        }
+
+        // The view keeps the mapping alive.
+        const auto data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        ::CloseHandle(mapping);
+
+        if (!data)
+        {
+            return false;
+        }
+
+        data_ = static_cast<const std::uint8_t*>(data);
+        size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+        const auto file = ::open(file_name, O_RDONLY);
+
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat status;
+
+        if (::fstat(file, &status) != 0 || status.st_size <= 0)
+        {
+            ::close(file);
+            return false;
+        }
+
+        const auto size = static_cast<std::size_t>(status.st_size);
+
+        // The mapping outlives the descriptor.
+        const auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        ::close(file);
+
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        data_ = static_cast<const std::uint8_t*>(data);
+        size_ = size;
+#endif // _WIN32
+
+        return true;
+    }
+
+    void close()
+    {
+        if (!data_)
+        {
+            return;
+        }
+
+#ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<std::uint8_t*>(data_), size_);
+#endif // _WIN32
+
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const std::uint8_t* get_data() const
+    {
+        return data_;
+    }
+
+    std::size_t get_size() const
+    {
+        return size_;
+    }
+
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+}; // MappedFile
+
+
+class ImpulseResponse::Impl
+{
+public:
+    enum class SampleFormat
+    {
+        s16_le,
+        s24_le,
+        s32_le,
+        f32_le,
+        f32_native,
+    }; // SampleFormat
+
+
+    MappedFile file_;
+
+    // The samples within the mapping.
+    const std::uint8_t* samples_;
+    SampleFormat sample_format_;
+    int sample_size_;
+
+    int channel_count_;
+    int sampling_rate_;
+    int sample_count_;
+
+
+    Impl()
+        :
+        file_{},
+        samples_{},
+        sample_format_{},
+        sample_size_{},
+        channel_count_{},
+        sampling_rate_{},
+        sample_count_{}
+    {
+    }
+
+    void unload()
+    {
+        file_.close();
+
+        samples_ = nullptr;
+        sample_size_ = 0;
+        channel_count_ = 0;
+        sampling_rate_ = 0;
+        sample_count_ = 0;
+    }
+
+    const char* load_wav(
+        const char* file_name)
+    {
+        if (!file_.open(file_name))
+        {
+            return ImpulseResponseErrorMessages::MapFile;
+        }
+
+        const auto data = file_.get_data();
+        const auto size = file_.get_size();
+
+        if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(&data[8], "WAVE", 4) != 0)
+        {
+            return ImpulseResponseErrorMessages::NotWav;
+        }
+
+        auto format_tag = 0;
+        auto channel_count = 0;
+        auto sampling_rate = 0;
+        auto block_align = 0;
+        auto bit_depth = 0;
+
+        const std::uint8_t* samples = nullptr;
+        auto samples_size = std::size_t{};
+
+        // Walk the chunks up to the samples.
+        for (auto offset = std::size_t{12}; (offset + 8) <= size && !samples; )
+        {
+            const auto chunk = &data[offset];
+            const auto chunk_size = std::min(static_cast<std::size_t>(read_u32_le(&chunk[4])), size - offset - 8);
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16)
+            {
+                format_tag = read_u16_le(&chunk[8]);
+                channel_count = read_u16_le(&chunk[10]);
+                sampling_rate = static_cast<int>(std::min(read_u32_le(&chunk[12]), std::uint32_t{max_sampling_rate}));
+                block_align = read_u16_le(&chunk[20]);
+                bit_depth = read_u16_le(&chunk[22]);
+
+                // WAVE_FORMAT_EXTENSIBLE keeps the actual tag in its subformat.
+                if (format_tag == 0xFFFE && chunk_size >= 40)
+                {
+                    format_tag = read_u16_le(&chunk[32]);
+                }
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                samples = &chunk[8];
+                samples_size = chunk_size;
+            }
+
+            // The chunks are word aligned.
+            offset += 8 + chunk_size + (chunk_size & 1);
+        }
+
+        if (!samples || format_tag == 0)
+        {
+            return ImpulseResponseErrorMessages::NotWav;
+        }
+
+        switch (format_tag)
+        {
+        case 1: // PCM
+            switch (bit_depth)
+            {
+            case 16:
+                sample_format_ = SampleFormat::s16_le;
+                break;
+
+            case 24:
+                sample_format_ = SampleFormat::s24_le;
+                break;
+
+            case 32:
+                sample_format_ = SampleFormat::s32_le;
+                break;
+
+            default:
+                return ImpulseResponseErrorMessages::UnsupportedFormat;
+            }
+
+            break;
+
+        case 3: // IEEE float
+            if (bit_depth != 32)
+            {
+                return ImpulseResponseErrorMessages::UnsupportedFormat;
+            }
+
+            sample_format_ = SampleFormat::f32_le;
+            break;
+
+        default:
+            return ImpulseResponseErrorMessages::UnsupportedFormat;
+        }
+
+        sample_size_ = bit_depth / 8;
+
+        if (block_align != channel_count * sample_size_)
+        {
+            return ImpulseResponseErrorMessages::UnsupportedFormat;
+        }
+
+        return set_samples(samples, samples_size, channel_count, sampling_rate);
+    }
+
+    const char* load_raw(
+        const char* file_name,
+        const int channel_count,
+        const int sampling_rate)
+    {
+        if (!file_.open(file_name))
+        {
+            return ImpulseResponseErrorMessages::MapFile;
+        }
+
+        sample_format_ = SampleFormat::f32_native;
+        sample_size_ = 4;
+
+        return set_samples(file_.get_data(), file_.get_size(), channel_count, sampling_rate);
+    }
+
+    void read(
+        const int channel,
+        const int offset,
+        const int sample_count,
+        float* dst_samples) const
+    {
+        const auto frame_size = channel_count_ * sample_size_;
+
+        auto src = &samples_[(static_cast<std::size_t>(offset) * frame_size) + (channel * sample_size_)];
+
+        for (int i = 0; i < sample_count; ++i)
+        {
+            switch (sample_format_)
+            {
+            case SampleFormat::s16_le:
+                dst_samples[i] = static_cast<std::int16_t>(read_u16_le(src)) * (1.0F / 32'768.0F);
+                break;
+
+            case SampleFormat::s24_le:
+                dst_samples[i] = static_cast<std::int32_t>(read_u24_le(src) << 8) * (1.0F / 2'147'483'648.0F);
+                break;
+
+            case SampleFormat::s32_le:
+                dst_samples[i] = static_cast<std::int32_t>(read_u32_le(src)) * (1.0F / 2'147'483'648.0F);
+                break;
+
+            case SampleFormat::f32_le:
+                {
+                    const auto bits = read_u32_le(src);
+                    std::memcpy(&dst_samples[i], &bits, 4);
+                }
+
+                break;
+
+            case SampleFormat::f32_native:
+            default:
+                std::memcpy(&dst_samples[i], src, 4);
+                break;
+            }
+
+            src += frame_size;
+        }
+    }
+
+
+private:
+    const char* set_samples(
+        const std::uint8_t* samples,
+        const std::size_t samples_size,
+        const int channel_count,
+        const int sampling_rate)
+    {
+        if (channel_count != 1 && channel_count != 4)
+        {
+            return ImpulseResponseErrorMessages::ChannelCount;
+        }
+
+        if (sampling_rate < min_sampling_rate || sampling_rate > max_sampling_rate)
+        {
+            return ImpulseResponseErrorMessages::SamplingRate;
+        }
+
+        const auto frame_count = samples_size / (channel_count * sample_size_);
+
+        if (frame_count == 0)
+        {
+            return ImpulseResponseErrorMessages::NoSamples;
+        }
+
+        samples_ = samples;
+        channel_count_ = channel_count;
+        sampling_rate_ = sampling_rate;
+        sample_count_ = static_cast<int>(std::min(frame_count, static_cast<std::size_t>(max_sample_count)));
+
+        return ImpulseResponseErrorMessages::NoError;
+    }
+
+    // The limit keeps the sample offsets within an int.
+    static constexpr auto max_sample_count = 1 << 26;
+
+
+    static std::uint32_t read_u16_le(
+        const std::uint8_t* src)
+    {
+        return src[0] | (src[1] << 8);
+    }
+
+    static std::uint32_t read_u24_le(
+        const std::uint8_t* src)
+    {
+        return src[0] | (src[1] << 8) | (src[2] << 16);
+    }
+
+    static std::uint32_t read_u32_le(
+        const std::uint8_t* src)
+    {
+        return src[0] | (src[1] << 8) | (src[2] << 16) | (static_cast<std::uint32_t>(src[3]) << 24);
+    }
+}; // ImpulseResponse::Impl
+
+
+ImpulseResponse::ImpulseResponse()
+    :
+    pimpl_{},
+    error_message_{ImpulseResponseErrorMessages::NoError}
+{
+}
+
+ImpulseResponse::~ImpulseResponse()
+{
+    unload();
+}
+
+bool ImpulseResponse::load_wav(
+    const char* file_name)
+{
+    unload();
+
+    if (!file_name)
+    {
+        error_message_ = ImpulseResponseErrorMessages::NoFileName;
+        return false;
+    }
+
+    pimpl_.reset(new (std::nothrow) Impl{});
+
+    if (!pimpl_)
+    {
+        error_message_ = ImpulseResponseErrorMessages::AllocateImpl;
+        return false;
+    }
+
+    error_message_ = pimpl_->load_wav(file_name);
+
+    if (error_message_ != ImpulseResponseErrorMessages::NoError)
+    {
+        pimpl_ = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool ImpulseResponse::load_raw(
+    const char* file_name,
+    const int channel_count,
+    const int sampling_rate)
+{
+    unload();
+
+    if (!file_name)
+    {
+        error_message_ = ImpulseResponseErrorMessages::NoFileName;
+        return false;
+    }
+
+    pimpl_.reset(new (std::nothrow) Impl{});
+
+    if (!pimpl_)
+    {
+        error_message_ = ImpulseResponseErrorMessages::AllocateImpl;
+        return false;
+    }
+
+    error_message_ = pimpl_->load_raw(file_name, channel_count, sampling_rate);
+
+    if (error_message_ != ImpulseResponseErrorMessages::NoError)
+    {
+        pimpl_ = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ImpulseResponse::unload()
+{
+    pimpl_ = nullptr;
+    error_message_ = ImpulseResponseErrorMessages::NoError;
+}
+
+bool ImpulseResponse::is_loaded() const
+{
+    return pimpl_ != nullptr;
+}
+
+int ImpulseResponse::get_channel_count() const
+{
+    if (!is_loaded())
+    {
+        error_message_ = ImpulseResponseErrorMessages::NotLoaded;
+        return 0;
+    }
+
+    return pimpl_->channel_count_;
+}
+
+int ImpulseResponse::get_sampling_rate() const
+{
+    if (!is_loaded())
+    {
+        error_message_ = ImpulseResponseErrorMessages::NotLoaded;
+        return 0;
+    }
+
+    return pimpl_->sampling_rate_;
+}
+
+int ImpulseResponse::get_sample_count() const
+{
+    if (!is_loaded())
+    {
+        error_message_ = ImpulseResponseErrorMessages::NotLoaded;
+        return 0;
+    }
+
+    return pimpl_->sample_count_;
+}
+
+bool ImpulseResponse::read(
+    const int channel,
+    const int offset,
+    const int sample_count,
+    float* dst_samples) const
+{
+    if (!is_loaded())
+    {
+        error_message_ = ImpulseResponseErrorMessages::NotLoaded;
+        return false;
+    }
+
+    if (channel < 0 || channel >= pimpl_->channel_count_ ||
+        offset < 0 || sample_count < 0 || sample_count > pimpl_->sample_count_ - offset)
+    {
+        error_message_ = ImpulseResponseErrorMessages::RangeOutOfBounds;
+        return false;
+    }
+
+    pimpl_->read(channel, offset, sample_count, dst_samples);
+
+    return true;
+}
+
+const char* ImpulseResponse::get_error_message() const
+{
+    return error_message_;
+}
+
+// ImpulseResponse
+// ==========================================================================
+
+
+// ==========================================================================
+// Effects
+
+class NullEffectState :
+    public EffectState
+{
+public:
+    NullEffectState()
+        :
+        EffectState{}
+    {
+    }
+
+    virtual ~NullEffectState()
+    {
+    }
+
+
+protected:
+    void do_construct() final
+    {
+    }
+
+    void do_destruct() final
+    {
+    }
+
+    void do_update_device(
+        Device& device) final
+    {
+        static_cast<void>(device);
+    }
+
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        static_cast<void>(device);
+        static_cast<void>(effect_slot);
+        static_cast<void>(effect_props);
+    }
+
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        static_cast<void>(sample_count);
+        static_cast<void>(src_samples);
+        static_cast<void>(dst_samples);
+        static_cast<void>(channel_count);
+    }
+
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        static_cast<void>(writer);
+    }
+
+    void do_load_state(
+        StateReader& reader) final
+    {
+        static_cast<void>(reader);
+    }
+}; // NullEffectState
+
+
+EffectState* EffectStateFactory::create_null()
+{
+    return create<NullEffectState>();
+}
+
+
+// A stereo delay line modulated by an LFO, shared by the chorus and the flanger.
+//
+// Both sides are kept in one interleaved buffer, so the taps of a frame come
+// from the same cache line. The hot loop is specialized on the waveform.
+template<typename TProps, const TProps EffectProps::* TPropsMember>
+class ModulatedDelayEffectState :
+    public EffectState
+{
+public:
+    ModulatedDelayEffectState()
+        :
+        EffectState{},
+        sample_buffer_{},
+        buffer_length_{},
+        offset_{},
+        written_count_{},
+        lfo_phase_{},
+        lfo_step_{},
+        lfo_disp_{},
+        sides_gains_{},
+        waveform_{},
+        delay_{},
+        depth_{},
+        feedback_{}
+    {
+    }
+
+    virtual ~ModulatedDelayEffectState()
+    {
+    }
+
+
+protected:
+    void do_construct() final
+    {
+        buffer_length_ = 0;
+        sample_buffer_.release();
+        offset_ = 0;
+        written_count_ = 0;
+        lfo_phase_ = 0;
+        waveform_ = Oscillator::Waveform::triangle;
+    }
+
+    void do_destruct() final
+    {
+        sample_buffer_.release();
+    }
+
+    void do_update_device(
+        Device& device) final
+    {
+        // The far tap of the longest delay reaches one frame further.
+        auto max_len = static_cast<int>(TProps::max_delay * 2.0F * device.sampling_rate_) + 2;
+
+        max_len = Math::next_power_of_2(max_len);
+
+        if (max_len != buffer_length_)
+        {
+            sample_buffer_.reset(2 * max_len);
+
+            buffer_length_ = max_len;
+        }
+        else
+        {
+            // Only the frames written since the last time are not silent.
+            sample_buffer_.clear_before(2 * offset_, 2 * written_count_);
+        }
+
+        written_count_ = 0;
+    }
+
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        static_cast<void>(effect_slot);
+
+        const auto& props = effect_props.*TPropsMember;
+        const auto frequency = static_cast<float>(device.sampling_rate_);
+
+        switch (props.waveform_)
+        {
+        case TProps::waveform_triangle:
+            waveform_ = Oscillator::Waveform::triangle;
+            break;
+
+        case TProps::waveform_sinusoid:
+            waveform_ = Oscillator::Waveform::sinusoid;
+            break;
+        }
+
+        feedback_ = props.feedback_;
+        delay_ = props.delay_ * frequency;
+
+        // The LFO depth is scaled to be relative to the sample delay.
+        depth_ = props.depth_ * delay_;
+
+        AmbiCoeffs coeffs;
+
+        // Gains for left and right sides
+        Panning::calc_angle_coeffs(-Math::pi_2, 0.0F, 0.0F, coeffs);
+        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[0]);
+        Panning::calc_angle_coeffs(Math::pi_2, 0.0F, 0.0F, coeffs);
+        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[1]);
+
+        const auto phase = props.phase_;
+        const auto rate = props.rate_;
+
+        if (!(rate > 0.0F))
+        {
+            lfo_phase_ = 0;
+            lfo_step_ = 0;
+            lfo_disp_ = 0;
+        }
+        else
+        {
+            lfo_step_ = Oscillator::to_phase(rate / frequency);
+
+            // Calculate lfo phase displacement
+            lfo_disp_ = Oscillator::to_phase(phase / 360.0);
+        }
+    }
+
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        switch (waveform_)
+        {
+        case Oscillator::Waveform::sinusoid:
+            process<Oscillator::Waveform::sinusoid>(sample_count, src_samples, dst_samples, channel_count);
+            break;
+
+        case Oscillator::Waveform::triangle:
+        default:
+            process<Oscillator::Waveform::triangle>(sample_count, src_samples, dst_samples, channel_count);
+            break;
+        }
+    }
+
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        writer.write(offset_);
+        writer.write(lfo_phase_);
+        writer.write_samples(sample_buffer_.get_data(), 2 * buffer_length_);
+    }
+
+    void do_load_state(
+        StateReader& reader) final
+    {
+        reader.read_index(offset_, buffer_length_);
+        reader.read(lfo_phase_);
+        reader.read_samples(sample_buffer_.get_data(), 2 * buffer_length_);
+
+        if (!reader.is_validating())
+        {
+            written_count_ = buffer_length_;
+        }
+    }
+
+
+private:
+    using SampleBuffer = ZeroedBuffer<float>;
+
+    using SidesGains = std::array<Gains, 2>;
+
+
+    // Interleaved left and right sides.
+    SampleBuffer sample_buffer_;
+    int buffer_length_;
+    int offset_;
+
+    // The frames written since the buffer was silenced, up to the offset.
+    int written_count_;
+    Oscillator::Phase lfo_phase_;
+    Oscillator::Phase lfo_step_;
+    Oscillator::Phase lfo_disp_;
+
+    // Gains for left and right sides
+    SidesGains sides_gains_;
+
+    // effect parameters
+    Oscillator::Waveform waveform_;
+    float delay_;
+    float depth_;
+    float feedback_;
+
+
+    template<Oscillator::Waveform TWaveform>
+    void process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count)
+    {
+        const auto buffer = sample_buffer_.get_data();
+        const auto buf_mask = buffer_length_ - 1;
+
+        for (int base = 0; base < sample_count; )
+        {
+            float lfo_values[2][128];
+            int near_taps[2][128];
+            int far_taps[2][128];
+            float temps[2][128];
+            float far_temps[2][128];
+            const auto todo = std::min(128, sample_count - base);
+            const auto src = &src_samples[0][base];
+
+            Oscillator::generate<TWaveform>(lfo_values[0], lfo_phase_, lfo_step_, todo);
+            Oscillator::generate<TWaveform>(lfo_values[1], lfo_phase_ + lfo_disp_, lfo_step_, todo);
+
+            lfo_phase_ += lfo_step_ * static_cast<Oscillator::Phase>(todo);
+
+            // Turn the delays into the indices of the taps on both sides of
+            // them in the buffer. The LFO values are replaced by the fractions
+            // between the taps.
+            auto min_delay = buffer_length_;
+
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int i = 0; i < todo; ++i)
+                {
+                    const auto delay = (lfo_values[c][i] * depth_) + delay_;
+                    const auto whole_delay = static_cast<int>(delay);
+
+                    min_delay = std::min(min_delay, whole_delay);
+                    lfo_values[c][i] = delay - static_cast<float>(whole_delay);
+                    near_taps[c][i] = (((offset_ + i - whole_delay) & buf_mask) * 2) + c;
+                    far_taps[c][i] = (((offset_ + i - whole_delay - 1) & buf_mask) * 2) + c;
+                }
+            }
+
+            const auto& fractions = lfo_values;
+
+            if (min_delay > 0)
+            {
+                // The frames are taken in spans no longer than the shortest
+                // delay, so every tap of a span reads a frame written before it.
+                for (int i = 0; i < todo; )
+                {
+                    const auto span = std::min(min_delay, todo - i);
+
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        Kernels::current.gather_(buffer, &near_taps[c][i], &temps[c][i], feedback_, span);
+                        Kernels::current.gather_(buffer, &far_taps[c][i], &far_temps[c][i], feedback_, span);
+
+                        for (int j = i; j < (i + span); ++j)
+                        {
+                            temps[c][j] += (far_temps[c][j] - temps[c][j]) * fractions[c][j];
+                        }
+                    }
+
+                    for (int j = i; j < (i + span); ++j)
+                    {
+                        const auto frame = ((offset_ + j) & buf_mask) * 2;
+
+                        buffer[frame + 0] = src[j] + temps[0][j];
+                        buffer[frame + 1] = src[j] + temps[1][j];
+                    }
+
+                    i += span;
+                }
+            }
+            else
+            {
+                // A zero delay reads the frame being written.
+                for (int i = 0; i < todo; ++i)
+                {
+                    const auto frame = ((offset_ + i) & buf_mask) * 2;
+
+                    buffer[frame + 0] = src[i];
+                    buffer[frame + 1] = src[i];
+
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        const auto near_value = buffer[near_taps[c][i]] * feedback_;
+                        const auto far_value = buffer[far_taps[c][i]] * feedback_;
+
+                        temps[c][i] = near_value + ((far_value - near_value) * fractions[c][i]);
+                    }
+
+                    buffer[frame + 0] += temps[0][i];
+                    buffer[frame + 1] += temps[1][i];
+                }
+            }
+
+            offset_ = (offset_ + todo) & buf_mask;
+            written_count_ = std::min(written_count_ + todo, buffer_length_);
+
+            for (int c = 0; c < channel_count; ++c)
+            {
+                for (int s = 0; s < 2; ++s)
+                {
+                    const auto gain = sides_gains_[s][c];
+
+                    if (std::abs(gain) > silence_threshold_gain)
+                    {
+                        Kernels::current.mix_(temps[s], &dst_samples[c][base], gain, todo);
+                    }
+                }
+            }
+
+            base += todo;
+        }
+    }
+}; // ModulatedDelayEffectState
+
+
+using ChorusEffectState = ModulatedDelayEffectState<EffectProps::Chorus, &EffectProps::chorus_>;
+
+EffectState* EffectStateFactory::create_chorus()
+{
+    return create<ChorusEffectState>();
+}
+
+
+class CompressorEffectState :
+    public EffectState
+{
+public:
+    CompressorEffectState()
+        :
+        EffectState{},
+        channels_gains_{},
+        is_enabled_{},
+        attack_rate_{},
+        release_rate_{},
+        gain_control_{}
+    {
+    }
+
+    virtual ~CompressorEffectState()
+    {
+    }
+
+
+protected:
+    void do_construct() final
+    {
+        is_enabled_ = true;
+        attack_rate_ = 0.0F;
+        release_rate_ = 0.0F;
+        gain_control_ = 1.0F;
+    }
+
+    void do_destruct() final
+    {
+    }
+
+    void do_update_device(
+        Device& device) final
+    {
+        const auto attackTime = device.sampling_rate_ * 0.2F; // 200ms Attack
+        const auto releaseTime = device.sampling_rate_ * 0.4F; // 400ms Release
+
+        attack_rate_ = 1.0F / attackTime;
+        release_rate_ = 1.0F / releaseTime;
+    }
+
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        static_cast<void>(effect_slot);
+
+        is_enabled_ = effect_props.compressor_.on_off_;
+
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                1.0F,
+                channels_gains_[i]);
+        }
+    }
+
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        for (int base = 0; base < sample_count; )
+        {
+            float temps[64][4];
+
+            const auto td = std::min(64, sample_count - base);
+
+            // Load samples into the temp buffer first.
+            for (int j = 0; j < 4; ++j)
+            {
+                for (int i = 0; i < td; ++i)
+                {
+                    temps[i][j] = src_samples[j][i + base];
+                }
+            }
+
+            if (is_enabled_)
+            {
+                for (int i = 0; i < td; ++i)
+                {
+                    // Roughly calculate the maximum amplitude from the 4-channel
+                    // signal, and attack or release the gain control to reach it.
+                    auto amplitude = std::abs(temps[i][0]);
+
+                    amplitude = std::max(amplitude + std::abs(temps[i][1]),
+                        std::max(amplitude + std::abs(temps[i][2]),
+                            amplitude + std::abs(temps[i][3])));
+
+                    if (amplitude > gain_control_)
+                    {
+                        gain_control_ = std::min(gain_control_ + attack_rate_, amplitude);
+                    }
+                    else if (amplitude < gain_control_)
+                    {
+                        gain_control_ = std::max(gain_control_ - release_rate_, amplitude);
+                    }
+
+                    // Apply the inverse of the gain control to normalize/compress
+                    // the volume.
+                    const auto output = 1.0F / Math::clamp(gain_control_, 0.5F, 2.0F);
+
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        temps[i][j] *= output;
+                    }
+                }
+            }
+            else
+            {
+                for (int i = 0; i < td; ++i)
+                {
+                    // Same as above, except the amplitude is forced to 1. This
+                    // helps ensure smooth gain changes when the compressor is
+                    // turned on and off.
+
+                    const auto amplitude = 1.0F;
+
+                    if (amplitude > gain_control_)
+                    {
+                        gain_control_ = std::min(gain_control_ + attack_rate_, amplitude);
+                    }
+                    else if (amplitude < gain_control_)
+                    {
+                        gain_control_ = std::max(gain_control_ - release_rate_, amplitude);
+                    }
+
+                    const auto output = 1.0F / Math::clamp(gain_control_, 0.5F, 2.0F);
+
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        temps[i][j] *= output;
+                    }
+                }
+            }
 
-void EffectProps::Chorus::set_defaults()
-{
-    waveform_ = default_waveform;
-    phase_ = default_phase;
-    rate_ = default_rate;
-    depth_ = default_depth;
-    feedback_ = default_feedback;
-    delay_ = default_delay;
-}
+            // Now mix to the output.
+            for (int j = 0; j < 4; ++j)
+            {
+                for (int k = 0; k < channel_count; ++k)
+                {
+                    const auto channel_gain = channels_gains_[j][k];
 
-void EffectProps::Chorus::normalize()
-{
-    Math::clamp_i(waveform_, min_waveform, max_waveform);
-    Math::clamp_i(phase_, min_phase, max_phase);
-    Math::clamp_i(rate_, min_rate, max_rate);
-    Math::clamp_i(depth_, min_depth, max_depth);
-    Math::clamp_i(feedback_, min_feedback, max_feedback);
-    Math::clamp_i(delay_, min_delay, max_delay);
-}
+                    if (!(std::abs(channel_gain) > silence_threshold_gain))
+                    {
+                        continue;
+                    }
 
-bool EffectProps::Chorus::are_equal(
-    const Chorus& a,
-    const Chorus& b)
-{
-    return
-        a.waveform_ == b.waveform_ &&
-        a.phase_ == b.phase_ &&
-        a.rate_ == b.rate_ &&
-        a.depth_ == b.depth_ &&
-        a.feedback_ == b.feedback_ &&
-        a.delay_ == b.delay_;
-}
+                    for (int i = 0; i < td; ++i)
+                    {
+                        dst_samples[k][base + i] += channel_gain * temps[i][j];
+                    }
+                }
+            }
 
-void EffectProps::Compressor::set_defaults()
-{
-    on_off_ = default_on_off;
-}
+            base += td;
+        }
+    }
 
-void EffectProps::Compressor::normalize()
-{
-}
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        writer.write(gain_control_);
+    }
 
-bool EffectProps::Compressor::are_equal(
-    const Compressor& a,
-    const Compressor& b)
-{
-    return
-        a.on_off_ == b.on_off_;
-}
+    void do_load_state(
+        StateReader& reader) final
+    {
+        reader.read(gain_control_);
+    }
 
-void EffectProps::Dedicated::set_defaults()
-{
-    gain_ = default_gain;
-}
 
-void EffectProps::Dedicated::normalize()
-{
-    Math::clamp_i(gain_, min_gain, max_gain);
-}
+private:
+    using ChannelsGains = std::array<Gains, max_effect_channels>;
 
-bool EffectProps::Dedicated::are_equal(
-    const Dedicated& a,
-    const Dedicated& b)
-{
-    return
-        a.gain_ == b.gain_;
-}
 
-void EffectProps::Distortion::set_defaults()
-{
-    edge_ = default_edge;
-    gain_ = default_gain;
-    low_pass_cutoff_ = default_low_pass_cutoff;
-    eq_center_ = default_eq_center;
-    eq_bandwidth_ = default_eq_bandwidth;
-}
+    // Effect gains for each channel
+    ChannelsGains channels_gains_;
 
-void EffectProps::Distortion::normalize()
-{
-    Math::clamp_i(edge_, min_edge, max_edge);
-    Math::clamp_i(gain_, min_gain, max_gain);
-    Math::clamp_i(low_pass_cutoff_, min_low_pass_cutoff, max_low_pass_cutoff);
-    Math::clamp_i(eq_center_, min_eq_center, max_eq_center);
-    Math::clamp_i(eq_bandwidth_, min_eq_bandwidth, max_eq_bandwidth);
-}
+    // Effect parameters
+    bool is_enabled_;
+    float attack_rate_;
+    float release_rate_;
+    float gain_control_;
+}; // CompressorEffectState
 
-bool EffectProps::Distortion::are_equal(
-    const Distortion& a,
-    const Distortion& b)
-{
-    return
-        a.edge_ == b.edge_ &&
-        a.gain_ == b.gain_ &&
-        a.low_pass_cutoff_ == b.low_pass_cutoff_ &&
-        a.eq_center_ == b.eq_center_ &&
-        a.eq_bandwidth_ == b.eq_bandwidth_;
-}
 
-void EffectProps::Echo::set_defaults()
+EffectState* EffectStateFactory::create_compressor()
 {
-    delay_ = default_delay;
-    lr_delay_ = default_lr_delay;
-    damping_ = default_damping;
-    feedback_ = default_feedback;
-    spread_ = default_spread;
+    return create<CompressorEffectState>();
 }
 
-void EffectProps::Echo::normalize()
-{
-    Math::clamp_i(delay_, min_delay, max_delay);
-    Math::clamp_i(lr_delay_, min_lr_delay, max_lr_delay);
-    Math::clamp_i(damping_, min_damping, max_damping);
-    Math::clamp_i(feedback_, min_feedback, max_feedback);
-    Math::clamp_i(spread_, min_spread, max_spread);
-}
 
-bool EffectProps::Echo::are_equal(
-    const Echo& a,
-    const Echo& b)
+// Convolves the W channel of the input with an impulse response.
+//
+// The overlap-save convolution runs on partitions of the response in the
+// frequency domain. The partitions of a level share a size, and a level
+// convolves the input in blocks of its partition size. The non-uniform
+// partitioning grows the levels along the response, so the latency is the one
+// of the smallest partition while the long tail is convolved rarely with the
+// big transforms.
+class ConvolutionEffectState :
+    public EffectState
 {
-    return
-        a.delay_ == b.delay_ &&
-        a.lr_delay_ == b.lr_delay_ &&
-        a.damping_ == b.damping_ &&
-        a.feedback_ == b.feedback_ &&
-        a.spread_ == b.spread_;
-}
+public:
+    ConvolutionEffectState()
+        :
+        EffectState{},
+        current_gains_{},
+        target_gains_{},
+        sampling_rate_{},
+        impulse_response_{},
+        partitioning_{},
+        built_sampling_rate_{},
+        channel_count_{},
+        level_count_{},
+        levels_{},
+        input_{},
+        output_{},
+        ring_mask_{},
+        position_{},
+        samples_{}
+    {
+    }
 
-void EffectProps::Equalizer::set_defaults()
-{
-    low_cutoff_ = default_low_cutoff;
-    low_gain_ = default_high_gain;
-    mid1_center_ = default_mid1_center;
-    mid1_gain_ = default_mid1_gain;
-    mid1_width_ = default_mid1_width;
-    mid2_center_ = default_mid2_center;
-    mid2_gain_ = default_mid2_gain;
-    mid2_width_ = default_mid2_width;
-    high_cutoff_ = default_high_cutoff;
-    high_gain_ = default_high_gain;
-}
+    virtual ~ConvolutionEffectState()
+    {
+    }
 
-void EffectProps::Equalizer::normalize()
-{
-    Math::clamp_i(low_cutoff_, min_low_cutoff, max_low_cutoff);
-    Math::clamp_i(low_gain_, min_low_gain, max_low_gain);
-    Math::clamp_i(mid1_center_, min_mid1_center, max_mid1_center);
-    Math::clamp_i(mid1_gain_, min_mid1_gain, max_mid1_gain);
-    Math::clamp_i(mid1_width_, min_mid1_width, max_mid1_width);
-    Math::clamp_i(mid2_center_, min_mid2_center, max_mid2_center);
-    Math::clamp_i(mid2_gain_, min_mid2_gain, max_mid2_gain);
-    Math::clamp_i(mid2_width_, min_mid2_width, max_mid2_width);
-    Math::clamp_i(high_cutoff_, min_high_cutoff, max_high_cutoff);
-    Math::clamp_i(high_gain_, min_high_gain, max_high_gain);
-}
 
-bool EffectProps::Equalizer::are_equal(
-    const Equalizer& a,
-    const Equalizer& b)
-{
-    return
-        a.low_cutoff_ == b.low_cutoff_ &&
-        a.low_gain_ == b.low_gain_ &&
-        a.mid1_center_ == b.mid1_center_ &&
-        a.mid1_gain_ == b.mid1_gain_ &&
-        a.mid1_width_ == b.mid1_width_ &&
-        a.mid2_center_ == b.mid2_center_ &&
-        a.mid2_gain_ == b.mid2_gain_ &&
-        a.mid2_width_ == b.mid2_width_ &&
-        a.high_cutoff_ == b.high_cutoff_ &&
-        a.high_gain_ == b.high_gain_;
-}
+protected:
+    void do_construct() final
+    {
+        for (auto& gains : current_gains_)
+        {
+            gains.fill(0.0F);
+        }
+
+        for (auto& gains : target_gains_)
+        {
+            gains.fill(0.0F);
+        }
+
+        impulse_response_ = nullptr;
+        partitioning_ = EffectProps::Convolution::default_partitioning;
+        built_sampling_rate_ = 0;
+
+        clear_levels();
+    }
+
+    void do_destruct() final
+    {
+        clear_levels();
+    }
+
+    void do_update_device(
+        Device& device) final
+    {
+        sampling_rate_ = device.sampling_rate_;
+    }
+
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        static_cast<void>(effect_slot);
+
+        const auto& props = effect_props.convolution_;
+
+        if (props.impulse_response_ != impulse_response_ ||
+            props.partitioning_ != partitioning_ ||
+            sampling_rate_ != built_sampling_rate_)
+        {
+            impulse_response_ = props.impulse_response_;
+            partitioning_ = props.partitioning_;
+            built_sampling_rate_ = sampling_rate_;
+
+            build_levels();
+        }
+
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
+
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            // A mono response has only the omni-directional output.
+            const auto gain = (i < channel_count_) ? props.gain_ : 0.0F;
+
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                gain,
+                target_gains_[i]);
+        }
+    }
+
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        if (level_count_ == 0)
+        {
+            return;
+        }
+
+        for (int base = 0; base < sample_count; )
+        {
+            // A tile never crosses a block boundary, so it never wraps around
+            // the rings.
+            const auto todo = std::min(block_size - (position_ & (block_size - 1)), sample_count - base);
 
-void EffectProps::Flanger::set_defaults()
-{
-    waveform_ = default_waveform;
-    phase_ = default_phase;
-    rate_ = default_rate;
-    depth_ = default_depth;
-    feedback_ = default_feedback;
-    delay_ = default_delay;
-}
+            std::copy_n(&src_samples[0][base], todo, &input_[position_ & ring_mask_]);
 
-void EffectProps::Flanger::normalize()
-{
-    Math::clamp_i(waveform_, min_waveform, max_waveform);
-    Math::clamp_i(phase_, min_phase, max_phase);
-    Math::clamp_i(rate_, min_rate, max_rate);
-    Math::clamp_i(depth_, min_depth, max_depth);
-    Math::clamp_i(feedback_, min_feedback, max_feedback);
-    Math::clamp_i(delay_, min_delay, max_delay);
-}
+            // The output is delayed by a block, which the first level
+            // computes at the end of the block.
+            const auto output_offset = (position_ - block_size) & ring_mask_;
 
-bool EffectProps::Flanger::are_equal(
-    const Flanger& a,
-    const Flanger& b)
-{
-    return
-        a.waveform_ == b.waveform_ &&
-        a.phase_ == b.phase_ &&
-        a.rate_ == b.rate_ &&
-        a.depth_ == b.depth_ &&
-        a.feedback_ == b.feedback_ &&
-        a.delay_ == b.delay_;
-}
+            for (int c = 0; c < channel_count_; ++c)
+            {
+                auto output = &output_[c][output_offset];
 
-void EffectProps::Reverb::set_defaults()
-{
-    density_ = default_density;
-    diffusion_ = default_diffusion;
-    gain_ = default_gain;
-    gain_hf_ = default_gain_hf;
-    gain_lf_ = default_gain_lf;
-    decay_time_ = default_decay_time;
-    decay_hf_ratio_ = default_decay_hf_ratio;
-    decay_lf_ratio_ = default_decay_lf_ratio;
-    reflections_gain_ = default_reflections_gain;
-    reflections_delay_ = default_reflections_delay;
-    reflections_pan_.fill(default_reflections_pan_xyz);
-    late_reverb_gain_ = default_late_reverb_gain;
-    late_reverb_delay_ = default_late_reverb_delay;
-    late_reverb_pan_.fill(default_late_reverb_pan_xyz);
-    echo_time_ = default_echo_time;
-    echo_depth_ = default_echo_depth;
-    modulation_time_ = default_modulation_time;
-    modulation_depth_ = default_modulation_depth;
-    air_absorption_gain_hf_ = default_air_absorption_gain_hf;
-    hf_reference_ = default_hf_reference;
-    lf_reference_ = default_lf_reference;
-    room_rolloff_factor_ = default_room_rolloff_factor;
-    decay_hf_limit_ = default_decay_hf_limit;
-}
+                std::copy_n(output, todo, samples_[c].begin());
+                std::fill_n(output, todo, 0.0F);
 
-void EffectProps::Reverb::normalize()
-{
-    Math::clamp_i(density_, min_density, max_density);
-    Math::clamp_i(diffusion_, min_diffusion, max_diffusion);
-    Math::clamp_i(gain_, min_gain, max_gain);
-    Math::clamp_i(gain_hf_, min_gain_hf, max_gain_hf);
-    Math::clamp_i(gain_lf_, min_gain_lf, max_gain_lf);
-    Math::clamp_i(decay_time_, min_decay_time, max_decay_time);
-    Math::clamp_i(decay_hf_ratio_, min_decay_hf_ratio, max_decay_hf_ratio);
-    Math::clamp_i(decay_lf_ratio_, min_decay_lf_ratio, max_decay_lf_ratio);
-    Math::clamp_i(reflections_gain_, min_reflections_gain, max_reflections_gain);
-    Math::clamp_i(reflections_delay_, min_reflections_delay, max_reflections_delay);
-    Math::clamp_i(reflections_pan_[0], min_reflections_pan_xyz, max_reflections_pan_xyz);
-    Math::clamp_i(reflections_pan_[1], min_reflections_pan_xyz, max_reflections_pan_xyz);
-    Math::clamp_i(reflections_pan_[2], min_reflections_pan_xyz, max_reflections_pan_xyz);
-    Math::clamp_i(late_reverb_gain_, min_late_reverb_gain, max_late_reverb_gain);
-    Math::clamp_i(late_reverb_delay_, min_late_reverb_delay, max_late_reverb_delay);
-    Math::clamp_i(late_reverb_pan_[0], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
-    Math::clamp_i(late_reverb_pan_[1], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
-    Math::clamp_i(late_reverb_pan_[2], min_late_reverb_pan_xyz, max_late_reverb_pan_xyz);
-    Math::clamp_i(echo_time_, min_echo_time, max_echo_time);
-    Math::clamp_i(echo_depth_, min_echo_depth, max_echo_depth);
-    Math::clamp_i(modulation_time_, min_modulation_time, max_modulation_time);
-    Math::clamp_i(modulation_depth_, min_modulation_depth, max_modulation_depth);
-    Math::clamp_i(air_absorption_gain_hf_, min_air_absorption_gain_hf, max_air_absorption_gain_hf);
-    Math::clamp_i(hf_reference_, min_hf_reference, max_hf_reference);
-    Math::clamp_i(lf_reference_, min_lf_reference, max_lf_reference);
-    Math::clamp_i(room_rolloff_factor_, min_room_rolloff_factor, max_room_rolloff_factor);
-    Math::clamp_i(decay_hf_limit_, min_decay_hf_limit, max_decay_hf_limit);
-}
+                MixHelpers::mix(
+                    samples_[c].data(),
+                    channel_count,
+                    dst_samples,
+                    current_gains_[c].data(),
+                    target_gains_[c].data(),
+                    sample_count - base,
+                    base,
+                    todo);
+            }
 
-bool EffectProps::Reverb::are_equal(
-    const Reverb& a,
-    const Reverb& b)
-{
-    return
-        a.density_ == b.density_ &&
-        a.diffusion_ == b.diffusion_ &&
-        a.gain_ == b.gain_ &&
-        a.gain_hf_ == b.gain_hf_ &&
-        a.gain_lf_ == b.gain_lf_ &&
-        a.decay_time_ == b.decay_time_ &&
-        a.decay_hf_ratio_ == b.decay_hf_ratio_ &&
-        a.decay_lf_ratio_ == b.decay_lf_ratio_ &&
-        a.reflections_gain_ == b.reflections_gain_ &&
-        a.reflections_delay_ == b.reflections_delay_ &&
-        a.reflections_pan_ == b.reflections_pan_ &&
-        a.late_reverb_gain_ == b.late_reverb_gain_ &&
-        a.late_reverb_delay_ == b.late_reverb_delay_ &&
-        a.late_reverb_pan_ == b.late_reverb_pan_ &&
-        a.echo_time_ == b.echo_time_ &&
-        a.echo_depth_ == b.echo_depth_ &&
-        a.modulation_time_ == b.modulation_time_ &&
-        a.modulation_depth_ == b.modulation_depth_ &&
-        a.air_absorption_gain_hf_ == b.air_absorption_gain_hf_ &&
-        a.hf_reference_ == b.hf_reference_ &&
-        a.lf_reference_ == b.lf_reference_ &&
-        a.room_rolloff_factor_ == b.room_rolloff_factor_ &&
-        a.decay_hf_limit_ == b.decay_hf_limit_;
-}
+            // The rings hold whole partitions of every level, so the
+            // position wraps around with them.
+            position_ = (position_ + todo) & ring_mask_;
 
-void EffectProps::RingModulator::set_defaults()
-{
-    frequency_ = default_frequency;
-    high_pass_cutoff_ = default_high_pass_cutoff;
-    waveform_ = default_waveform;
-}
+            if ((position_ & (block_size - 1)) == 0)
+            {
+                for (int i = 0; i < level_count_; ++i)
+                {
+                    auto& level = levels_[i];
 
-void EffectProps::RingModulator::normalize()
-{
-    Math::clamp_i(frequency_, min_frequency, max_frequency);
-    Math::clamp_i(high_pass_cutoff_, min_high_pass_cutoff, max_high_pass_cutoff);
-    Math::clamp_i(waveform_, min_waveform, max_waveform);
-}
+                    if ((position_ & (level.size_ - 1)) == 0)
+                    {
+                        convolve(level);
+                    }
+                }
+            }
 
-bool EffectProps::RingModulator::are_equal(
-    const RingModulator& a,
-    const RingModulator& b)
-{
-    return
-        a.frequency_ == b.frequency_ &&
-        a.high_pass_cutoff_ == b.high_pass_cutoff_ &&
-        a.waveform_ == b.waveform_;
-}
+            base += todo;
+        }
+    }
 
-// EffectProps
-// ==========================================================================
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        writer.write(channel_count_);
+        writer.write(level_count_);
+        writer.write(current_gains_);
 
+        if (level_count_ == 0)
+        {
+            return;
+        }
 
-// ==========================================================================
-// Effect
+        writer.write(position_);
+        writer.write_samples(input_.data(), ring_mask_ + 1);
 
-void Effect::set_defaults()
-{
-    switch (type_)
+        for (int c = 0; c < channel_count_; ++c)
+        {
+            writer.write_samples(output_[c].data(), ring_mask_ + 1);
+        }
+
+        for (int i = 0; i < level_count_; ++i)
+        {
+            const auto& level = levels_[i];
+            const auto spectra_size = static_cast<int>(level.input_re_.size());
+
+            writer.write(level.input_index_);
+            writer.write_samples(level.input_re_.data(), spectra_size);
+            writer.write_samples(level.input_im_.data(), spectra_size);
+        }
+    }
+
+    void do_load_state(
+        StateReader& reader) final
     {
-    case EffectType::chorus:
-        props_.chorus_.set_defaults();
-        break;
+        // The levels follow from the impulse response, which has to be the
+        // saved one.
+        reader.expect(channel_count_);
+        reader.expect(level_count_);
+        reader.read(current_gains_);
 
-    case EffectType::compressor:
-        props_.compressor_.set_defaults();
-        break;
+        if (level_count_ == 0)
+        {
+            return;
+        }
 
-    case EffectType::dedicated_dialog:
-    case EffectType::dedicated_low_frequency:
-        props_.dedicated_.set_defaults();
-        break;
+        reader.read_index(position_, ring_mask_ + 1);
+        reader.read_samples(input_.data(), ring_mask_ + 1);
 
-    case EffectType::distortion:
-        props_.distortion_.set_defaults();
-        break;
+        for (int c = 0; c < channel_count_; ++c)
+        {
+            reader.read_samples(output_[c].data(), ring_mask_ + 1);
+        }
 
-    case EffectType::echo:
-        props_.echo_.set_defaults();
-        break;
+        for (int i = 0; i < level_count_; ++i)
+        {
+            auto& level = levels_[i];
+            const auto spectra_size = static_cast<int>(level.input_re_.size());
 
-    case EffectType::equalizer:
-        props_.equalizer_.set_defaults();
-        break;
+            reader.read_index(level.input_index_, level.partition_count_);
+            reader.read_samples(level.input_re_.data(), spectra_size);
+            reader.read_samples(level.input_im_.data(), spectra_size);
+        }
+    }
 
-    case EffectType::flanger:
-        props_.flanger_.set_defaults();
-        break;
 
-    case EffectType::eax_reverb:
-    case EffectType::reverb:
-        props_.reverb_.set_defaults();
-        break;
+private:
+    using Spectra = std::array<EffectSampleBuffer, max_effect_channels>;
+    using Samples = std::array<EffectSampleBuffer, max_effect_channels>;
 
-    case EffectType::ring_modulator:
-        props_.ring_modulator_.set_defaults();
-        break;
 
-    case EffectType::null:
-    default:
-        break;
-    }
-}
+    // The smallest partition size, which is the latency too.
+    static constexpr auto block_size = 128;
 
-void Effect::set_type_and_defaults(
-    const EffectType effect_type)
-{
-    type_ = effect_type;
-    set_defaults();
-}
+    // The non-uniform partitions grow by this factor per level.
+    static constexpr auto level_growth = 8;
 
-void Effect::normalize()
-{
-    switch (type_)
+    static constexpr auto max_levels = 3;
+
+
+    struct Level
     {
-    case EffectType::chorus:
-        props_.chorus_.normalize();
-        break;
+        RealFft fft_;
 
-    case EffectType::compressor:
-        props_.compressor_.normalize();
-        break;
+        // The partition size.
+        int size_;
 
-    case EffectType::dedicated_dialog:
-    case EffectType::dedicated_low_frequency:
-        props_.dedicated_.normalize();
-        break;
+        // The offset of the first partition in the impulse response.
+        int offset_;
 
-    case EffectType::distortion:
-        props_.distortion_.normalize();
-        break;
+        int partition_count_;
 
-    case EffectType::echo:
-        props_.echo_.normalize();
-        break;
+        // The spectrum size rounded up to the SIMD width.
+        int stride_;
 
-    case EffectType::equalizer:
-        props_.equalizer_.normalize();
-        break;
+        // The spectra of the partitions per channel.
+        Spectra response_re_;
+        Spectra response_im_;
 
-    case EffectType::flanger:
-        props_.flanger_.normalize();
-        break;
+        // The frequency-domain delay line of the input spectra.
+        EffectSampleBuffer input_re_;
+        EffectSampleBuffer input_im_;
+        int input_index_;
+
+        EffectSampleBuffer sum_re_;
+        EffectSampleBuffer sum_im_;
+
+        // The window of the input, and the output of the transform.
+        EffectSampleBuffer window_;
+    }; // Level
+
+    using Levels = std::array<Level, max_levels>;
+
+
+    std::array<Gains, max_effect_channels> current_gains_;
+    std::array<Gains, max_effect_channels> target_gains_;
+
+    int sampling_rate_;
+
+    const ImpulseResponse* impulse_response_;
+    int partitioning_;
+    int built_sampling_rate_;
+
+    int channel_count_;
+    int level_count_;
+    Levels levels_;
 
-    case EffectType::eax_reverb:
-    case EffectType::reverb:
-        props_.reverb_.normalize();
-        break;
+    // The rings of the input and of the output to come.
+    EffectSampleBuffer input_;
+    Samples output_;
+    int ring_mask_;
 
-    case EffectType::ring_modulator:
-        props_.ring_modulator_.normalize();
-        break;
+    // The position of the next input sample in the rings.
+    int position_;
 
-    case EffectType::null:
-    default:
-        break;
-    }
-}
+    Samples samples_;
 
-bool Effect::are_equal(
-    const Effect& a,
-    const Effect& b)
-{
-    if (a.type_ != b.type_)
+
+    void clear_levels()
     {
-        return false;
+        channel_count_ = 0;
+        level_count_ = 0;
+
+        for (auto& level : levels_)
+        {
+            for (int c = 0; c < max_effect_channels; ++c)
+            {
+                EffectSampleBuffer{}.swap(level.response_re_[c]);
+                EffectSampleBuffer{}.swap(level.response_im_[c]);
+            }
+
+            EffectSampleBuffer{}.swap(level.input_re_);
+            EffectSampleBuffer{}.swap(level.input_im_);
+            EffectSampleBuffer{}.swap(level.sum_re_);
+            EffectSampleBuffer{}.swap(level.sum_im_);
+            EffectSampleBuffer{}.swap(level.window_);
+        }
+
+        EffectSampleBuffer{}.swap(input_);
+
+        for (int c = 0; c < max_effect_channels; ++c)
+        {
+            EffectSampleBuffer{}.swap(output_[c]);
+            EffectSampleBuffer{}.swap(samples_[c]);
+        }
+
+        ring_mask_ = 0;
+        position_ = 0;
     }
 
-    switch (a.type_)
+    // Reads a channel of the impulse response at the device's sampling rate.
+    static void read_response(
+        const ImpulseResponse& impulse_response,
+        const int channel,
+        const int sampling_rate,
+        EffectSampleBuffer& samples)
     {
-    case EffectType::null:
-        return true;
+        const auto src_count = impulse_response.get_sample_count();
+        const auto src_rate = impulse_response.get_sampling_rate();
 
-    case EffectType::chorus:
-        return EffectProps::Chorus::are_equal(a.props_.chorus_, b.props_.chorus_);
+        samples.resize(src_count);
+        impulse_response.read(channel, 0, src_count, samples.data());
 
-    case EffectType::compressor:
-        return EffectProps::Compressor::are_equal(a.props_.compressor_, b.props_.compressor_);
+        if (src_rate == sampling_rate)
+        {
+            return;
+        }
 
-    case EffectType::dedicated_dialog:
-    case EffectType::dedicated_low_frequency:
-        return EffectProps::Dedicated::are_equal(a.props_.dedicated_, b.props_.dedicated_);
+        // Band-limited below the lower Nyquist frequency, so a response is not
+        // aliased on the way down, and scaled to keep the gain of the response.
+        auto filter = ResamplerFilter{};
+        filter.initialize(src_rate, sampling_rate);
 
-    case EffectType::distortion:
-        return EffectProps::Distortion::are_equal(a.props_.distortion_, b.props_.distortion_);
+        const auto src_step = filter.get_src_step();
+        const auto dst_step = filter.get_dst_step();
+        const auto tap_count = filter.get_tap_count();
+        const auto scale = static_cast<float>(src_step) / static_cast<float>(dst_step);
 
-    case EffectType::echo:
-        return EffectProps::Echo::are_equal(a.props_.echo_, b.props_.echo_);
+        const auto dst_count = std::max(
+            static_cast<int>((static_cast<long long>(src_count) * dst_step + src_step - 1) / src_step), 1);
 
-    case EffectType::equalizer:
-        return EffectProps::Equalizer::are_equal(a.props_.equalizer_, b.props_.equalizer_);
+        // Silence around the response covers the taps at both ends.
+        auto padded = EffectSampleBuffer(src_count + (2 * tap_count));
+        std::copy_n(samples.cbegin(), src_count, &padded[tap_count]);
 
-    case EffectType::flanger:
-        return EffectProps::Flanger::are_equal(a.props_.flanger_, b.props_.flanger_);
+        auto resampled = EffectSampleBuffer{};
+        resampled.resize(dst_count);
 
-    case EffectType::eax_reverb:
-    case EffectType::reverb:
-        return EffectProps::Reverb::are_equal(a.props_.reverb_, b.props_.reverb_);
+        for (int i = 0; i < dst_count; ++i)
+        {
+            const auto position = static_cast<long long>(i) * src_step;
+            const auto index = static_cast<int>(position / dst_step);
+            const auto remainder = static_cast<int>(position % dst_step);
 
-    case EffectType::ring_modulator:
-        return EffectProps::RingModulator::are_equal(a.props_.ring_modulator_, b.props_.ring_modulator_);
+            resampled[i] = scale * filter.apply(&padded[tap_count + index - ((tap_count / 2) - 1)], remainder);
+        }
 
-    default:
-        return false;
+        samples.swap(resampled);
     }
-}
 
-// Effect
-// ==========================================================================
+    void build_levels()
+    {
+        clear_levels();
 
+        if (!impulse_response_ || !impulse_response_->is_loaded())
+        {
+            return;
+        }
 
-// ==========================================================================
-// SendProps
+        const auto channel_count = impulse_response_->get_channel_count();
 
-void SendProps::set_defaults()
-{
-    gain_ = default_gain;
-    gain_hf_ = default_gain_hf;
-    gain_lf_ = default_gain_lf;
-}
+        // The output is in ACN order with N3D scaling, while a B-Format
+        // response is in FuMa order (W, X, Y, Z) and scaling.
+        constexpr int b_format_channels[max_effect_channels] = {0, 2, 3, 1};
+        constexpr float b_format_gains[max_effect_channels] = {1.414'213'562F, 1.732'050'808F, 1.732'050'808F, 1.732'050'808F};
 
-void SendProps::normalize()
-{
-    Math::clamp_i(gain_, min_gain, max_gain);
-    Math::clamp_i(gain_hf_, min_gain_hf, max_gain_hf);
-    Math::clamp_i(gain_lf_, min_gain_lf, max_gain_lf);
-}
+        auto responses = Samples{};
 
-bool SendProps::are_equal(
-    const SendProps& a,
-    const SendProps& b)
-{
-    return
-        a.gain_ == b.gain_ &&
-        a.gain_hf_ == b.gain_hf_ &&
-        a.gain_lf_ == b.gain_lf_;
-}
+        for (int c = 0; c < channel_count; ++c)
+        {
+            const auto is_b_format = (channel_count == max_effect_channels);
 
-// SendProps
-// ==========================================================================
+            auto& response = responses[c];
 
-// ==========================================================================
-// Reverb presets
+            read_response(*impulse_response_, is_b_format ? b_format_channels[c] : c, built_sampling_rate_, response);
 
-// Default
-//
-const EffectProps::Reverb ReverbPresets::Default::generic = {1.0000F, 1.0000F, 0.3162F, 0.8913F, 1.0000F, 1.4900F, 0.8300F, 1.0000F, 0.0500F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            if (is_b_format)
+            {
+                for (auto& sample : response)
+                {
+                    sample *= b_format_gains[c];
+                }
+            }
+        }
+
+        const auto response_size = static_cast<int>(responses[0].size());
 
-const EffectProps::Reverb ReverbPresets::Default::padded_cell = {0.1715F, 1.0000F, 0.3162F, 0.0010F, 1.0000F, 0.1700F, 0.1000F, 1.0000F, 0.2500F, 0.0010F, {0.0000F, 0.0000F, 0.0000F}, 1.2691F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+        // Lay out the levels. Every level but the first starts at its own
+        // partition size, so its output is due no earlier than it is computed.
+        auto level_count = 0;
+        auto offset = 0;
+        auto size = block_size;
 
-const EffectProps::Reverb ReverbPresets::Default::room = {0.4287F, 1.0000F, 0.3162F, 0.5929F, 1.0000F, 0.4000F, 0.8300F, 1.0000F, 0.1503F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 1.0629F, 0.0030F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+        while (offset < response_size && level_count < max_levels)
+        {
+            const auto is_last =
+                partitioning_ == EffectProps::Convolution::partitioning_uniform ||
+                (level_count + 1) == max_levels;
 
-const EffectProps::Reverb ReverbPresets::Default::bathroom = {0.1715F, 1.0000F, 0.3162F, 0.2512F, 1.0000F, 1.4900F, 0.5400F, 1.0000F, 0.6531F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 3.2734F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            const auto end = is_last ? response_size : std::min(size * level_growth, response_size);
 
-const EffectProps::Reverb ReverbPresets::Default::living_room = {0.9766F, 1.0000F, 0.3162F, 0.0010F, 1.0000F, 0.5000F, 0.1000F, 1.0000F, 0.2051F, 0.0030F, {0.0000F, 0.0000F, 0.0000F}, 0.2805F, 0.0040F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            auto& level = levels_[level_count];
 
-const EffectProps::Reverb ReverbPresets::Default::stone_room = {1.0000F, 1.0000F, 0.3162F, 0.7079F, 1.0000F, 2.3100F, 0.6400F, 1.0000F, 0.4411F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1003F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            level.size_ = size;
+            level.offset_ = offset;
+            level.partition_count_ = (end - offset + size - 1) / size;
 
-const EffectProps::Reverb ReverbPresets::Default::auditorium = {1.0000F, 1.0000F, 0.3162F, 0.5781F, 1.0000F, 4.3200F, 0.5900F, 1.0000F, 0.4032F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.7170F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            level_count += 1;
+            offset = end;
+            size *= level_growth;
+        }
 
-const EffectProps::Reverb ReverbPresets::Default::concert_hall = {1.0000F, 1.0000F, 0.3162F, 0.5623F, 1.0000F, 3.9200F, 0.7000F, 1.0000F, 0.2427F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.9977F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+        auto max_size = 0;
+        auto scratch = EffectSampleBuffer{};
 
-const EffectProps::Reverb ReverbPresets::Default::cave = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 1.0000F, 2.9100F, 1.3000F, 1.0000F, 0.5000F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.7063F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+        for (int i = 0; i < level_count; ++i)
+        {
+            auto& level = levels_[i];
 
-const EffectProps::Reverb ReverbPresets::Default::arena = {1.0000F, 1.0000F, 0.3162F, 0.4477F, 1.0000F, 7.2400F, 0.3300F, 1.0000F, 0.2612F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.0186F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            const auto transform_size = 2 * level.size_;
 
-const EffectProps::Reverb ReverbPresets::Default::hangar = {1.0000F, 1.0000F, 0.3162F, 0.3162F, 1.0000F, 10.0500F, 0.2300F, 1.0000F, 0.5000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2560F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            level.fft_.initialize(transform_size);
+            level.stride_ = (level.fft_.get_bin_count() + 3) & (~3);
 
-const EffectProps::Reverb ReverbPresets::Default::carpeted_hallway = {0.4287F, 1.0000F, 0.3162F, 0.0100F, 1.0000F, 0.3000F, 0.1000F, 1.0000F, 0.1215F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 0.1531F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            const auto spectra_size = level.partition_count_ * level.stride_;
 
-const EffectProps::Reverb ReverbPresets::Default::hallway = {0.3645F, 1.0000F, 0.3162F, 0.7079F, 1.0000F, 1.4900F, 0.5900F, 1.0000F, 0.2458F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.6615F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            // The transforms are not normalized.
+            const auto scale = 1.0F / (4.0F * transform_size);
 
-const EffectProps::Reverb ReverbPresets::Default::stone_corridor = {1.0000F, 1.0000F, 0.3162F, 0.7612F, 1.0000F, 2.7000F, 0.7900F, 1.0000F, 0.2472F, 0.0130F, {0.0000F, 0.0000F, 0.0000F}, 1.5758F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            scratch.resize(transform_size);
 
-const EffectProps::Reverb ReverbPresets::Default::alley = {1.0000F, 0.3000F, 0.3162F, 0.7328F, 1.0000F, 1.4900F, 0.8600F, 1.0000F, 0.2500F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.9954F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.9500F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            for (int c = 0; c < channel_count; ++c)
+            {
+                level.response_re_[c].resize(spectra_size);
+                level.response_im_[c].resize(spectra_size);
 
-const EffectProps::Reverb ReverbPresets::Default::forest = {1.0000F, 0.3000F, 0.3162F, 0.0224F, 1.0000F, 1.4900F, 0.5400F, 1.0000F, 0.0525F, 0.1620F, {0.0000F, 0.0000F, 0.0000F}, 0.7682F, 0.0880F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+                for (int p = 0; p < level.partition_count_; ++p)
+                {
+                    const auto begin = level.offset_ + (p * level.size_);
+                    const auto count = std::min(level.size_, response_size - begin);
 
-const EffectProps::Reverb ReverbPresets::Default::city = {1.0000F, 0.5000F, 0.3162F, 0.3981F, 1.0000F, 1.4900F, 0.6700F, 1.0000F, 0.0730F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.1427F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+                    std::fill(scratch.begin(), scratch.end(), 0.0F);
 
-const EffectProps::Reverb ReverbPresets::Default::mountains = {1.0000F, 0.2700F, 0.3162F, 0.0562F, 1.0000F, 1.4900F, 0.2100F, 1.0000F, 0.0407F, 0.3000F, {0.0000F, 0.0000F, 0.0000F}, 0.1919F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+                    const auto response = responses[c].data() + begin;
 
-const EffectProps::Reverb ReverbPresets::Default::quarry = {1.0000F, 1.0000F, 0.3162F, 0.3162F, 1.0000F, 1.4900F, 0.8300F, 1.0000F, 0.0000F, 0.0610F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0250F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.7000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+                    std::transform(
+                        response,
+                        response + count,
+                        scratch.begin(),
+                        [=](const float sample) { return sample * scale; });
 
-const EffectProps::Reverb ReverbPresets::Default::plain = {1.0000F, 0.2100F, 0.3162F, 0.1000F, 1.0000F, 1.4900F, 0.5000F, 1.0000F, 0.0585F, 0.1790F, {0.0000F, 0.0000F, 0.0000F}, 0.1089F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+                    const auto spectrum = p * level.stride_;
 
-const EffectProps::Reverb ReverbPresets::Default::parking_lot = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 1.0000F, 1.6500F, 1.5000F, 1.0000F, 0.2082F, 0.0080F, {0.0000F, 0.0000F, 0.0000F}, 0.2652F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+                    level.fft_.forward(scratch.data(), &level.response_re_[c][spectrum], &level.response_im_[c][spectrum]);
+                }
+            }
 
-const EffectProps::Reverb ReverbPresets::Default::sewer_pipe = {0.3071F, 0.8000F, 0.3162F, 0.3162F, 1.0000F, 2.8100F, 0.1400F, 1.0000F, 1.6387F, 0.0140F, {0.0000F, 0.0000F, 0.0000F}, 3.2471F, 0.0210F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            level.input_re_.resize(spectra_size);
+            level.input_im_.resize(spectra_size);
+            level.input_index_ = 0;
 
-const EffectProps::Reverb ReverbPresets::Default::underwater = {0.3645F, 1.0000F, 0.3162F, 0.0100F, 1.0000F, 1.4900F, 0.1000F, 1.0000F, 0.5963F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 7.0795F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 1.1800F, 0.3480F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            level.sum_re_.resize(level.stride_);
+            level.sum_im_.resize(level.stride_);
+            level.window_.resize(transform_size);
 
-const EffectProps::Reverb ReverbPresets::Default::drugged = {0.4287F, 0.5000F, 0.3162F, 1.0000F, 1.0000F, 8.3900F, 1.3900F, 1.0000F, 0.8760F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 3.1081F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 1.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+            max_size = std::max(max_size, level.size_);
+        }
 
-const EffectProps::Reverb ReverbPresets::Default::dizzy = {0.3645F, 0.6000F, 0.3162F, 0.6310F, 1.0000F, 17.2300F, 0.5600F, 1.0000F, 0.1392F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.4937F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.8100F, 0.3100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+        // The input keeps the window of the biggest transform, and the output
+        // keeps the biggest partition to come plus a block.
+        const auto ring_size = 2 * max_size;
 
-const EffectProps::Reverb ReverbPresets::Default::psychotic = {0.0625F, 0.5000F, 0.3162F, 0.8404F, 1.0000F, 7.5600F, 0.9100F, 1.0000F, 0.4864F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 2.4378F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 4.0000F, 1.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+        input_.resize(ring_size);
 
-// Castle
-//
-const EffectProps::Reverb ReverbPresets::Castle::small_room = {1.0000F, 0.8900F, 0.3162F, 0.3981F, 0.1000F, 1.2200F, 0.8300F, 0.3100F, 0.8913F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        for (int c = 0; c < channel_count; ++c)
+        {
+            output_[c].resize(ring_size);
+            samples_[c].resize(block_size);
+        }
 
-const EffectProps::Reverb ReverbPresets::Castle::short_passage = {1.0000F, 0.8900F, 0.3162F, 0.3162F, 0.1000F, 2.3200F, 0.8300F, 0.3100F, 0.8913F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        ring_mask_ = ring_size - 1;
+        channel_count_ = channel_count;
+        level_count_ = level_count;
+    }
 
-const EffectProps::Reverb ReverbPresets::Castle::medium_room = {1.0000F, 0.9300F, 0.3162F, 0.2818F, 0.1000F, 2.0400F, 0.8300F, 0.4600F, 0.6310F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1550F, 0.0300F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+    void convolve(
+        Level& level)
+    {
+        const auto size = level.size_;
+        const auto ring_size = ring_mask_ + 1;
 
-const EffectProps::Reverb ReverbPresets::Castle::large_room = {1.0000F, 0.8200F, 0.3162F, 0.2818F, 0.1259F, 2.5300F, 0.8300F, 0.5000F, 0.4467F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1850F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        // Gather the window of the last two partitions of the input.
+        const auto window_begin = (position_ - (2 * size)) & ring_mask_;
+        const auto head_count = std::min(2 * size, ring_size - window_begin);
 
-const EffectProps::Reverb ReverbPresets::Castle::long_passage = {1.0000F, 0.8900F, 0.3162F, 0.3981F, 0.1000F, 3.4200F, 0.8300F, 0.3100F, 0.8913F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        std::copy_n(&input_[window_begin], head_count, level.window_.begin());
+        std::copy_n(input_.cbegin(), (2 * size) - head_count, &level.window_[head_count]);
 
-const EffectProps::Reverb ReverbPresets::Castle::hall = {1.0000F, 0.8100F, 0.3162F, 0.2818F, 0.1778F, 3.1400F, 0.7900F, 0.6200F, 0.1778F, 0.0560F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        const auto stride = level.stride_;
+        const auto partition_count = level.partition_count_;
 
-const EffectProps::Reverb ReverbPresets::Castle::cupboard = {1.0000F, 0.8900F, 0.3162F, 0.2818F, 0.1000F, 0.6700F, 0.8700F, 0.3100F, 1.4125F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 3.5481F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+        level.fft_.forward(
+            level.window_.data(),
+            &level.input_re_[level.input_index_ * stride],
+            &level.input_im_[level.input_index_ * stride]);
 
-const EffectProps::Reverb ReverbPresets::Castle::courtyard = {1.0000F, 0.4200F, 0.3162F, 0.4467F, 0.1995F, 2.1300F, 0.6100F, 0.2300F, 0.2239F, 0.1600F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0360F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.3700F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+        for (int c = 0; c < channel_count_; ++c)
+        {
+            std::fill(level.sum_re_.begin(), level.sum_re_.end(), 0.0F);
+            std::fill(level.sum_im_.begin(), level.sum_im_.end(), 0.0F);
 
-const EffectProps::Reverb ReverbPresets::Castle::alcove = {1.0000F, 0.8900F, 0.3162F, 0.5012F, 0.1000F, 1.6400F, 0.8700F, 0.3100F, 1.0000F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 0.1380F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 5168.6001F, 139.5000F, 0.0000F, true,};
+            // The newest input spectrum goes with the first partition.
+            for (int p = 0; p < partition_count; ++p)
+            {
+                const auto input_index = (level.input_index_ + partition_count - p) % partition_count;
+
+                multiply_add(
+                    stride,
+                    &level.input_re_[input_index * stride],
+                    &level.input_im_[input_index * stride],
+                    &level.response_re_[c][p * stride],
+                    &level.response_im_[c][p * stride],
+                    level.sum_re_.data(),
+                    level.sum_im_.data());
+            }
 
-// Factory
-//
-const EffectProps::Reverb ReverbPresets::Factory::small_room = {0.3645F, 0.8200F, 0.3162F, 0.7943F, 0.5012F, 1.7200F, 0.6500F, 1.3100F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.1190F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            level.fft_.inverse_second_half(level.sum_re_.data(), level.sum_im_.data(), level.window_.data());
 
-const EffectProps::Reverb ReverbPresets::Factory::short_passage = {0.3645F, 0.6400F, 0.2512F, 0.7943F, 0.5012F, 2.5300F, 0.6500F, 1.3100F, 1.0000F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.1350F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            // The samples are due from the start of the window's second half
+            // plus the offset of the level.
+            const auto output_begin = (position_ - size + level.offset_) & ring_mask_;
+            const auto output_head_count = std::min(size, ring_size - output_begin);
 
-const EffectProps::Reverb ReverbPresets::Factory::medium_room = {0.4287F, 0.8200F, 0.2512F, 0.7943F, 0.5012F, 2.7600F, 0.6500F, 1.3100F, 0.2818F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.1740F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            auto& output = output_[c];
 
-const EffectProps::Reverb ReverbPresets::Factory::large_room = {0.4287F, 0.7500F, 0.2512F, 0.7079F, 0.6310F, 4.2400F, 0.5100F, 1.3100F, 0.1778F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.2310F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            for (int i = 0; i < output_head_count; ++i)
+            {
+                output[output_begin + i] += level.window_[i];
+            }
 
-const EffectProps::Reverb ReverbPresets::Factory::long_passage = {0.3645F, 0.6400F, 0.2512F, 0.7943F, 0.5012F, 4.0600F, 0.6500F, 1.3100F, 1.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0370F, {0.0000F, 0.0000F, 0.0000F}, 0.1350F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            for (int i = output_head_count; i < size; ++i)
+            {
+                output[i - output_head_count] += level.window_[i];
+            }
+        }
 
-const EffectProps::Reverb ReverbPresets::Factory::hall = {0.4287F, 0.7500F, 0.3162F, 0.7079F, 0.6310F, 7.4300F, 0.5100F, 1.3100F, 0.0631F, 0.0730F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+        level.input_index_ = (level.input_index_ + 1) % partition_count;
+    }
 
-const EffectProps::Reverb ReverbPresets::Factory::cupboard = {0.3071F, 0.6300F, 0.2512F, 0.7943F, 0.5012F, 0.4900F, 0.6500F, 1.3100F, 1.2589F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.1070F, 0.0700F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+    // Accumulates the products of the spectra.
+    static void multiply_add(
+        const int count,
+        const float* a_re,
+        const float* a_im,
+        const float* b_re,
+        const float* b_im,
+        float* sum_re,
+        float* sum_im)
+    {
+        for (int i = 0; i < count; i += 4)
+        {
+            const auto x_re = Float4::load(&a_re[i]);
+            const auto x_im = Float4::load(&a_im[i]);
+            const auto y_re = Float4::load(&b_re[i]);
+            const auto y_im = Float4::load(&b_im[i]);
 
-const EffectProps::Reverb ReverbPresets::Factory::courtyard = {0.3071F, 0.5700F, 0.3162F, 0.3162F, 0.6310F, 2.3200F, 0.2900F, 0.5600F, 0.2239F, 0.1400F, {0.0000F, 0.0000F, 0.0000F}, 0.3981F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2900F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            const auto re = Float4::load(&sum_re[i]) + ((x_re * y_re) - (x_im * y_im));
+            const auto im = Float4::load(&sum_im[i]) + ((x_re * y_im) + (x_im * y_re));
 
-const EffectProps::Reverb ReverbPresets::Factory::alcove = {0.3645F, 0.5900F, 0.2512F, 0.7943F, 0.5012F, 3.1400F, 0.6500F, 1.3100F, 1.4125F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.1140F, 0.1000F, 0.2500F, 0.0000F, 0.9943F, 3762.6001F, 362.5000F, 0.0000F, true,};
+            re.store(&sum_re[i]);
+            im.store(&sum_im[i]);
+        }
+    }
+}; // ConvolutionEffectState
 
-// Ice palace
-//
-const EffectProps::Reverb ReverbPresets::IcePalace::small_room = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 0.2818F, 1.5100F, 1.5300F, 0.2700F, 0.8913F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1640F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::IcePalace::short_passage = {1.0000F, 0.7500F, 0.3162F, 0.5623F, 0.2818F, 1.7900F, 1.4600F, 0.2800F, 0.5012F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.1770F, 0.0900F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+EffectState* EffectStateFactory::create_convolution()
+{
+    return create<ConvolutionEffectState>();
+}
 
-const EffectProps::Reverb ReverbPresets::IcePalace::medium_room = {1.0000F, 0.8700F, 0.3162F, 0.5623F, 0.4467F, 2.2200F, 1.5300F, 0.3200F, 0.3981F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.1860F, 0.1200F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::IcePalace::large_room = {1.0000F, 0.8100F, 0.3162F, 0.5623F, 0.4467F, 3.1400F, 1.5300F, 0.3200F, 0.2512F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0270F, {0.0000F, 0.0000F, 0.0000F}, 0.2140F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+class DedicatedEffectState :
+    public EffectState
+{
+public:
+    DedicatedEffectState()
+        :
+        EffectState{},
+        gains_{}
+    {
+    }
 
-const EffectProps::Reverb ReverbPresets::IcePalace::long_passage = {1.0000F, 0.7700F, 0.3162F, 0.5623F, 0.3981F, 3.0100F, 1.4600F, 0.2800F, 0.7943F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0250F, {0.0000F, 0.0000F, 0.0000F}, 0.1860F, 0.0400F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+    virtual ~DedicatedEffectState()
+    {
+    }
 
-const EffectProps::Reverb ReverbPresets::IcePalace::hall = {1.0000F, 0.7600F, 0.3162F, 0.4467F, 0.5623F, 5.4900F, 1.5300F, 0.3800F, 0.1122F, 0.0540F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0520F, {0.0000F, 0.0000F, 0.0000F}, 0.2260F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::IcePalace::cupboard = {1.0000F, 0.8300F, 0.3162F, 0.5012F, 0.2239F, 0.7600F, 1.5300F, 0.2600F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1430F, 0.0800F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+protected:
+    void do_construct() final
+    {
+        gains_.fill(0.0F);
+    }
 
-const EffectProps::Reverb ReverbPresets::IcePalace::courtyard = {1.0000F, 0.5900F, 0.3162F, 0.2818F, 0.3162F, 2.0400F, 1.2000F, 0.3800F, 0.3162F, 0.1730F, {0.0000F, 0.0000F, 0.0000F}, 0.3162F, 0.0430F, {0.0000F, 0.0000F, 0.0000F}, 0.2350F, 0.4800F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+    void do_destruct() final
+    {
+    }
 
-const EffectProps::Reverb ReverbPresets::IcePalace::alcove = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 0.2818F, 2.7600F, 1.4600F, 0.2800F, 1.1220F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1610F, 0.0900F, 0.2500F, 0.0000F, 0.9943F, 12428.5000F, 99.6000F, 0.0000F, true,};
+    void do_update_device(
+        Device& device) final
+    {
+        static_cast<void>(device);
+    }
 
-// Space station
-//
-const EffectProps::Reverb ReverbPresets::SpaceStation::small_room = {0.2109F, 0.7000F, 0.3162F, 0.7079F, 0.8913F, 1.7200F, 0.8200F, 0.5500F, 0.7943F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0130F, {0.0000F, 0.0000F, 0.0000F}, 0.1880F, 0.2600F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props)
+    {
+        gains_.fill(0.0F);
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::short_passage = {0.2109F, 0.8700F, 0.3162F, 0.6310F, 0.8913F, 3.5700F, 0.5000F, 0.5500F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.1720F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+        const auto gain = effect_props.dedicated_.gain_;
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::medium_room = {0.2109F, 0.7500F, 0.3162F, 0.6310F, 0.8913F, 3.0100F, 0.5000F, 0.5500F, 0.3981F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0350F, {0.0000F, 0.0000F, 0.0000F}, 0.2090F, 0.3100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+        if (effect_slot.effect_.type_ == EffectType::dedicated_low_frequency)
+        {
+            const auto idx = device.get_channel_index(ChannelId::lfe);
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::large_room = {0.3645F, 0.8100F, 0.3162F, 0.6310F, 0.8913F, 3.8900F, 0.3800F, 0.6100F, 0.3162F, 0.0560F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0350F, {0.0000F, 0.0000F, 0.0000F}, 0.2330F, 0.2800F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+            if (idx != -1)
+            {
+                dst_buffers_ = &device.sample_buffers_;
+                dst_channel_count_ = device.channel_count_;
+                gains_[idx] = gain;
+            }
+        }
+        else if (effect_slot.effect_.type_ == EffectType::dedicated_dialog)
+        {
+            const auto idx = device.get_channel_index(ChannelId::front_center);
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::long_passage = {0.4287F, 0.8200F, 0.3162F, 0.6310F, 0.8913F, 4.6200F, 0.6200F, 0.5500F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0310F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2300F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+            // Dialog goes to the front-center speaker if it exists, otherwise it
+            // plays from the front-center location.
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::hall = {0.4287F, 0.8700F, 0.3162F, 0.6310F, 0.8913F, 7.1100F, 0.3800F, 0.6100F, 0.1778F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0470F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2500F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+            if (idx != -1)
+            {
+                dst_buffers_ = &device.sample_buffers_;
+                dst_channel_count_ = device.channel_count_;
+                gains_[idx] = gain;
+            }
+            else
+            {
+                AmbiCoeffs coeffs;
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::cupboard = {0.1715F, 0.5600F, 0.3162F, 0.7079F, 0.8913F, 0.7900F, 0.8100F, 0.5500F, 1.4125F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.7783F, 0.0180F, {0.0000F, 0.0000F, 0.0000F}, 0.1810F, 0.3100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+                Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
 
-const EffectProps::Reverb ReverbPresets::SpaceStation::alcove = {0.2109F, 0.7800F, 0.3162F, 0.7079F, 0.8913F, 1.1600F, 0.8100F, 0.5500F, 1.4125F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0180F, {0.0000F, 0.0000F, 0.0000F}, 0.1920F, 0.2100F, 0.2500F, 0.0000F, 0.9943F, 3316.1001F, 458.2000F, 0.0000F, true,};
+                dst_buffers_ = &device.sample_buffers_;
+                dst_channel_count_ = device.channel_count_;
 
-// Wooden galeon
-//
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::small_room = {1.0000F, 1.0000F, 0.3162F, 0.1122F, 0.3162F, 0.7900F, 0.3200F, 0.8700F, 1.0000F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+                Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, gain, gains_);
+            }
+        }
+    }
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::short_passage = {1.0000F, 1.0000F, 0.3162F, 0.1259F, 0.3162F, 1.7500F, 0.5000F, 0.8700F, 0.8913F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.6310F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        for (int c = 0; c < channel_count; ++c)
+        {
+            const auto gain = gains_[c];
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::medium_room = {1.0000F, 1.0000F, 0.3162F, 0.1000F, 0.2818F, 1.4700F, 0.4200F, 0.8200F, 0.8913F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+            if (!(std::abs(gain) > silence_threshold_gain))
+            {
+                continue;
+            }
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::large_room = {1.0000F, 1.0000F, 0.3162F, 0.0891F, 0.2818F, 2.6500F, 0.3300F, 0.8200F, 0.8913F, 0.0660F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+            for (int i = 0; i < sample_count; ++i)
+            {
+                dst_samples[c][i] += src_samples[0][i] * gain;
+            }
+        }
+    }
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::long_passage = {1.0000F, 1.0000F, 0.3162F, 0.1000F, 0.3162F, 1.9900F, 0.4000F, 0.7900F, 1.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.4467F, 0.0360F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        static_cast<void>(writer);
+    }
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::hall = {1.0000F, 1.0000F, 0.3162F, 0.0794F, 0.2818F, 3.4500F, 0.3000F, 0.8200F, 0.8913F, 0.0880F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0630F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+    void do_load_state(
+        StateReader& reader) final
+    {
+        static_cast<void>(reader);
+    }
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::cupboard = {1.0000F, 1.0000F, 0.3162F, 0.1413F, 0.3162F, 0.5600F, 0.4600F, 0.9100F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::courtyard = {1.0000F, 0.6500F, 0.3162F, 0.0794F, 0.3162F, 1.7900F, 0.3500F, 0.7900F, 0.5623F, 0.1230F, {0.0000F, 0.0000F, 0.0000F}, 0.1000F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
+private:
+    Gains gains_;
+}; // DedicatedEffectState
 
-const EffectProps::Reverb ReverbPresets::WoodenGaleon::alcove = {1.0000F, 1.0000F, 0.3162F, 0.1259F, 0.3162F, 1.2200F, 0.6200F, 0.9100F, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 4705.0000F, 99.6000F, 0.0000F, true,};
 
-// Sports
-//
-const EffectProps::Reverb ReverbPresets::Sports::empty_stadium = {1.0000F, 1.0000F, 0.3162F, 0.4467F, 0.7943F, 6.2600F, 0.5100F, 1.1000F, 0.0631F, 0.1830F, {0.0000F, 0.0000F, 0.0000F}, 0.3981F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+EffectState* EffectStateFactory::create_dedicated()
+{
+    return create<DedicatedEffectState>();
+}
 
-const EffectProps::Reverb ReverbPresets::Sports::squash_court = {1.0000F, 0.7500F, 0.3162F, 0.3162F, 0.7943F, 2.2200F, 0.9100F, 1.1600F, 0.4467F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.1260F, 0.1900F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::Sports::small_swimming_pool = {1.0000F, 0.7000F, 0.3162F, 0.7943F, 0.8913F, 2.7600F, 1.2500F, 1.1400F, 0.6310F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1790F, 0.1500F, 0.8950F, 0.1900F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+class DistortionEffectState :
+    public EffectState
+{
+public:
+    DistortionEffectState()
+        :
+        EffectState{},
+        gains_{},
+        low_pass_{},
+        band_pass_{},
+        oversampler_{},
+        waveshaper_{},
+        attenuation_{}
+    {
+    }
 
-const EffectProps::Reverb ReverbPresets::Sports::large_swimming_pool = {1.0000F, 0.8200F, 0.3162F, 0.7943F, 1.0000F, 5.4900F, 1.3100F, 1.1400F, 0.4467F, 0.0390F, {0.0000F, 0.0000F, 0.0000F}, 0.5012F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2220F, 0.5500F, 1.1590F, 0.2100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+    virtual ~DistortionEffectState()
+    {
+    }
 
-const EffectProps::Reverb ReverbPresets::Sports::gymnasium = {1.0000F, 0.8100F, 0.3162F, 0.4467F, 0.8913F, 3.1400F, 1.0600F, 1.3500F, 0.3981F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.5623F, 0.0450F, {0.0000F, 0.0000F, 0.0000F}, 0.1460F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::Sports::full_stadium = {1.0000F, 1.0000F, 0.3162F, 0.0708F, 0.7943F, 5.2500F, 0.1700F, 0.8000F, 0.1000F, 0.1880F, {0.0000F, 0.0000F, 0.0000F}, 0.2818F, 0.0380F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+protected:
+    void do_construct() final
+    {
+        low_pass_.clear();
+        band_pass_.clear();
+        oversampler_.clear();
+    }
 
-const EffectProps::Reverb ReverbPresets::Sports::stadium_tannoy = {1.0000F, 0.7800F, 0.3162F, 0.5623F, 0.5012F, 2.5300F, 0.8800F, 0.6800F, 0.2818F, 0.2300F, {0.0000F, 0.0000F, 0.0000F}, 0.5012F, 0.0630F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+    void do_destruct() final
+    {
+    }
 
-// Prefab
-//
-const EffectProps::Reverb ReverbPresets::Prefab::workshop = {0.4287F, 1.0000F, 0.3162F, 0.1413F, 0.3981F, 0.7600F, 1.0000F, 1.0000F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+    void do_update_device(
+        Device& device) final
+    {
+        static_cast<void>(device);
+    }
 
-const EffectProps::Reverb ReverbPresets::Prefab::school_room = {0.4022F, 0.6900F, 0.3162F, 0.6310F, 0.5012F, 0.9800F, 0.4500F, 0.1800F, 1.4125F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.0950F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true,};
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        static_cast<void>(effect_slot);
 
-const EffectProps::Reverb ReverbPresets::Prefab::practise_room = {0.4022F, 0.8700F, 0.3162F, 0.3981F, 0.5012F, 1.1200F, 0.5600F, 0.1800F, 1.2589F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0110F, {0.0000F, 0.0000F, 0.0000F}, 0.0950F, 0.1400F, 0.2500F, 0.0000F, 0.9943F, 7176.8999F, 211.2000F, 0.0000F, true,};
+        const auto frequency = static_cast<float>(device.sampling_rate_);
 
-const EffectProps::Reverb ReverbPresets::Prefab::outhouse = {1.0000F, 0.8200F, 0.3162F, 0.1122F, 0.1585F, 1.3800F, 0.3800F, 0.3500F, 0.8913F, 0.0240F, {0.0000F, 0.0000F, -0.0000F}, 0.6310F, 0.0440F, {0.0000F, 0.0000F, 0.0000F}, 0.1210F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false,};
+        // Store distorted signal attenuation settings.
+        attenuation_ = effect_props.distortion_.gain_;
 
-const EffectProps::Reverb ReverbPresets::Prefab::caravan = {1.0000F, 1.0000F, 0.3162F, 0.0891F, 0.1259F, 0.4300F, 1.5000F, 1.0000F, 1.0000F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 1.9953F, 0.0120F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+        // Store waveshaper edge settings.
+        auto edge = std::sin(effect_props.distortion_.edge_ * (Math::pi_2));
+        edge = std::min(edge, 0.99F);
 
-// Dome
-//
-const EffectProps::Reverb ReverbPresets::Dome::tomb = {1.0000F, 0.7900F, 0.3162F, 0.3548F, 0.2239F, 4.1800F, 0.2100F, 0.1000F, 0.3868F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 1.6788F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.1770F, 0.1900F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false,};
-const EffectProps::Reverb ReverbPresets::Dome::saint_pauls = {1.0000F, 0.8700F, 0.3162F, 0.3548F, 0.2239F, 10.4800F, 0.1900F, 0.1000F, 0.1778F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0420F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1200F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true,};
+        const auto edge_coeff = 2.0F * edge / (1.0F - edge);
 
-// Pipe
-//
-const EffectProps::Reverb ReverbPresets::Pipe::small = {1.0000F, 1.0000F, 0.3162F, 0.3548F, 0.2239F, 5.0400F, 0.1000F, 0.1000F, 0.5012F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 2.5119F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true,};
+        // Three steps of waveshaping, with the sign of the second one flipped.
+        waveshaper_.set_stages(edge_coeff, 3, -1.0F);
 
-const EffectProps::Reverb ReverbPresets::Pipe::long_thin = {0.2560F, 0.9100F, 0.3162F, 0.4467F, 0.2818F, 9.2100F, 0.1800F, 0.1000F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false,};
+        // The filters run at the base rate, outside of the oversampled stage,
+        // so the frequencies are kept below the Nyquist frequency.
+        auto cutoff = effect_props.distortion_.low_pass_cutoff_;
+        auto freq_mult = std::min(cutoff / frequency, max_freq_mult);
 
-const EffectProps::Reverb ReverbPresets::Pipe::large = {1.0000F, 1.0000F, 0.3162F, 0.3548F, 0.2239F, 8.4500F, 0.1000F, 0.1000F, 0.3981F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, true,};
+        // Bandwidth value is constant in octaves.
+        auto bandwidth = (cutoff / 2.0F) / (cutoff * 0.67F);
 
-const EffectProps::Reverb ReverbPresets::Pipe::resonant = {0.1373F, 0.9100F, 0.3162F, 0.4467F, 0.2818F, 6.8100F, 0.1800F, 0.1000F, 0.7079F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.0000F, 0.0220F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 20.0000F, 0.0000F, false,};
+        low_pass_.set_params(
+            FilterType::low_pass,
+            1.0F,
+            freq_mult,
+            FilterState::calc_rcp_q_from_bandwidth(freq_mult, bandwidth));
 
-// Outdoors
-//
-const EffectProps::Reverb ReverbPresets::Outdoors::backyard = {1.0000F, 0.4500F, 0.3162F, 0.2512F, 0.5012F, 1.1200F, 0.3400F, 0.4600F, 0.4467F, 0.0690F, {0.0000F, 0.0000F, -0.0000F}, 0.7079F, 0.0230F, {0.0000F, 0.0000F, 0.0000F}, 0.2180F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false,};
+        cutoff = effect_props.distortion_.eq_center_;
+        freq_mult = std::min(cutoff / frequency, max_freq_mult);
 
-const EffectProps::Reverb ReverbPresets::Outdoors::rolling_plains = {1.0000F, 0.0000F, 0.3162F, 0.0112F, 0.6310F, 2.1300F, 0.2100F, 0.4600F, 0.1778F, 0.3000F, {0.0000F, 0.0000F, -0.0000F}, 0.4467F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false,};
+        // Convert bandwidth in Hz to octaves.
+        bandwidth = effect_props.distortion_.eq_bandwidth_ / (cutoff * 0.67F);
 
-const EffectProps::Reverb ReverbPresets::Outdoors::deep_canyon = {1.0000F, 0.7400F, 0.3162F, 0.1778F, 0.6310F, 3.8900F, 0.2100F, 0.4600F, 0.3162F, 0.2230F, {0.0000F, 0.0000F, -0.0000F}, 0.3548F, 0.0190F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false,};
+        band_pass_.set_params(
+            FilterType::band_pass,
+            1.0F,
+            freq_mult,
+            FilterState::calc_rcp_q_from_bandwidth(freq_mult, bandwidth));
 
-const EffectProps::Reverb ReverbPresets::Outdoors::creek = {1.0000F, 0.3500F, 0.3162F, 0.1778F, 0.5012F, 2.1300F, 0.2100F, 0.4600F, 0.3981F, 0.1150F, {0.0000F, 0.0000F, -0.0000F}, 0.1995F, 0.0310F, {0.0000F, 0.0000F, 0.0000F}, 0.2180F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 4399.1001F, 242.9000F, 0.0000F, false,};
+        Panning::compute_ambient_gains(
+            device.channel_count_,
+            device.dry_,
+            1.0F,
+            gains_);
+    }
 
-const EffectProps::Reverb ReverbPresets::Outdoors::valley = {1.0000F, 0.2800F, 0.3162F, 0.0282F, 0.1585F, 2.8800F, 0.2600F, 0.3500F, 0.1413F, 0.2630F, {0.0000F, 0.0000F, -0.0000F}, 0.3981F, 0.1000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.3400F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false,};
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        for (int base = 0; base < sample_count; )
+        {
+            float buffer[2][64 * Oversampler4::factor];
 
-// Mood
-//
-const EffectProps::Reverb ReverbPresets::Mood::heaven = {1.0000F, 0.9400F, 0.3162F, 0.7943F, 0.4467F, 5.0400F, 1.1200F, 0.5600F, 0.2427F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0290F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0800F, 2.7420F, 0.0500F, 0.9977F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            const auto td = std::min(64, sample_count - base);
 
-const EffectProps::Reverb ReverbPresets::Mood::hell = {1.0000F, 0.5700F, 0.3162F, 0.3548F, 0.4467F, 3.5700F, 0.4900F, 2.0000F, 0.0000F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1100F, 0.0400F, 2.1090F, 0.5200F, 0.9943F, 5000.0000F, 139.5000F, 0.0000F, false,};
+            // First step, do lowpass filtering of original signal.
+            low_pass_.process(td, &src_samples[0][base], buffer[0]);
 
-const EffectProps::Reverb ReverbPresets::Mood::memory = {1.0000F, 0.8500F, 0.3162F, 0.6310F, 0.3548F, 4.0600F, 0.8200F, 0.5600F, 0.0398F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 1.1220F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.4740F, 0.4500F, 0.9886F, 5000.0000F, 250.0000F, 0.0000F, false,};
+            // Perform 4x oversampling to avoid aliasing. Oversampling greatly
+            // improves distortion quality.
+            oversampler_.upsample(td, buffer[0], buffer[1]);
 
-// Driving
-//
-const EffectProps::Reverb ReverbPresets::Driving::commentator = {1.0000F, 0.0000F, 0.3162F, 0.5623F, 0.5012F, 2.4200F, 0.8800F, 0.6800F, 0.1995F, 0.0930F, {0.0000F, 0.0000F, 0.0000F}, 0.2512F, 0.0170F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 1.0000F, 0.2500F, 0.0000F, 0.9886F, 5000.0000F, 250.0000F, 0.0000F, true,};
+            // Second step, do distortion using waveshaper function to emulate
+            // signal processing during tube overdriving. Three steps of
+            // waveshaping are intended to modify waveform without boost/clipping/
+            // attenuation process.
+            waveshaper_.process(td * Oversampler4::factor, buffer[1], buffer[0]);
 
-const EffectProps::Reverb ReverbPresets::Driving::pit_garage = {0.4287F, 0.5900F, 0.3162F, 0.7079F, 0.5623F, 1.7200F, 0.9300F, 0.8700F, 0.5623F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0160F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1100F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, false,};
+            // Third step, decimate back to the base rate, computing only the
+            // retained samples, and do bandpass filtering of distorted signal.
+            oversampler_.downsample(td, buffer[0], buffer[1]);
+            band_pass_.process(td, buffer[1], buffer[0]);
 
-const EffectProps::Reverb ReverbPresets::Driving::incar_racer = {0.0832F, 0.8000F, 0.3162F, 1.0000F, 0.7943F, 0.1700F, 2.0000F, 0.4100F, 1.7783F, 0.0070F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0150F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true,};
+            for (int kt = 0; kt < channel_count; ++kt)
+            {
+                // Fourth step, final, do attenuation.
+                const auto gain = gains_[kt] * attenuation_;
 
-const EffectProps::Reverb ReverbPresets::Driving::incar_sports = {0.0832F, 0.8000F, 0.3162F, 0.6310F, 1.0000F, 0.1700F, 0.7500F, 0.4100F, 1.0000F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.5623F, 0.0000F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true,};
+                if (!(std::abs(gain) > silence_threshold_gain))
+                {
+                    continue;
+                }
 
-const EffectProps::Reverb ReverbPresets::Driving::incar_luxury = {0.2560F, 1.0000F, 0.3162F, 0.1000F, 0.5012F, 0.1300F, 0.4100F, 0.4600F, 0.7943F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 1.5849F, 0.0100F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10268.2002F, 251.0000F, 0.0000F, true,};
+                Kernels::current.mix_(buffer[0], &dst_samples[kt][base], gain, td);
+            }
 
-const EffectProps::Reverb ReverbPresets::Driving::full_grand_stand = {1.0000F, 1.0000F, 0.3162F, 0.2818F, 0.6310F, 3.0100F, 1.3700F, 1.2800F, 0.3548F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 0.1778F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10420.2002F, 250.0000F, 0.0000F, false,};
+            base += td;
+        }
+    }
 
-const EffectProps::Reverb ReverbPresets::Driving::empty_grand_stand = {1.0000F, 1.0000F, 0.3162F, 1.0000F, 0.7943F, 4.6200F, 1.7500F, 1.4000F, 0.2082F, 0.0900F, {0.0000F, 0.0000F, 0.0000F}, 0.2512F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.0000F, 0.9943F, 10420.2002F, 250.0000F, 0.0000F, false,};
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        low_pass_.save_state(writer);
+        band_pass_.save_state(writer);
+        oversampler_.save_state(writer);
+    }
 
-const EffectProps::Reverb ReverbPresets::Driving::tunnel = {1.0000F, 0.8100F, 0.3162F, 0.3981F, 0.8913F, 3.4200F, 0.9400F, 1.3100F, 0.7079F, 0.0510F, {0.0000F, 0.0000F, 0.0000F}, 0.7079F, 0.0470F, {0.0000F, 0.0000F, 0.0000F}, 0.2140F, 0.0500F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 155.3000F, 0.0000F, true,};
+    void do_load_state(
+        StateReader& reader) final
+    {
+        low_pass_.load_state(reader);
+        band_pass_.load_state(reader);
+        oversampler_.load_state(reader);
+    }
 
-// City
-//
-const EffectProps::Reverb ReverbPresets::City::streets = {1.0000F, 0.7800F, 0.3162F, 0.7079F, 0.8913F, 1.7900F, 1.1200F, 0.9100F, 0.2818F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 0.1995F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::City::subway = {1.0000F, 0.7400F, 0.3162F, 0.7079F, 0.8913F, 3.0100F, 1.2300F, 0.9100F, 0.7079F, 0.0460F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0280F, {0.0000F, 0.0000F, 0.0000F}, 0.1250F, 0.2100F, 0.2500F, 0.0000F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+private:
+    using Oversampler4 = Oversampler<4, 16>;
 
-const EffectProps::Reverb ReverbPresets::City::museum = {1.0000F, 0.8200F, 0.3162F, 0.1778F, 0.1778F, 3.2800F, 1.4000F, 0.5700F, 0.2512F, 0.0390F, {0.0000F, 0.0000F, -0.0000F}, 0.8913F, 0.0340F, {0.0000F, 0.0000F, 0.0000F}, 0.1300F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false,};
 
-const EffectProps::Reverb ReverbPresets::City::library = {1.0000F, 0.8200F, 0.3162F, 0.2818F, 0.0891F, 2.7600F, 0.8900F, 0.4100F, 0.3548F, 0.0290F, {0.0000F, 0.0000F, -0.0000F}, 0.8913F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 0.1300F, 0.1700F, 0.2500F, 0.0000F, 0.9943F, 2854.3999F, 107.5000F, 0.0000F, false,};
+    static constexpr auto max_freq_mult = 0.45F;
 
-const EffectProps::Reverb ReverbPresets::City::underpass = {1.0000F, 0.8200F, 0.3162F, 0.4467F, 0.8913F, 3.5700F, 1.1200F, 0.9100F, 0.3981F, 0.0590F, {0.0000F, 0.0000F, 0.0000F}, 0.8913F, 0.0370F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.1400F, 0.2500F, 0.0000F, 0.9920F, 5000.0000F, 250.0000F, 0.0000F, true,};
 
-const EffectProps::Reverb ReverbPresets::City::abandoned = {1.0000F, 0.6900F, 0.3162F, 0.7943F, 0.8913F, 3.2800F, 1.1700F, 0.9100F, 0.4467F, 0.0440F, {0.0000F, 0.0000F, 0.0000F}, 0.2818F, 0.0240F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.2000F, 0.2500F, 0.0000F, 0.9966F, 5000.0000F, 250.0000F, 0.0000F, true,};
+    // Effect gains for each channel
+    Gains gains_;
 
-// Misc
-//
-const EffectProps::Reverb ReverbPresets::Misc::dusty_room = {0.3645F, 0.5600F, 0.3162F, 0.7943F, 0.7079F, 1.7900F, 0.3800F, 0.2100F, 0.5012F, 0.0020F, {0.0000F, 0.0000F, 0.0000F}, 1.2589F, 0.0060F, {0.0000F, 0.0000F, 0.0000F}, 0.2020F, 0.0500F, 0.2500F, 0.0000F, 0.9886F, 13046.0000F, 163.3000F, 0.0000F, true,};
+    // Effect parameters
+    FilterState low_pass_;
+    FilterState band_pass_;
+    Oversampler4 oversampler_;
+    Waveshaper waveshaper_;
+    float attenuation_;
+}; // DistortionEffectState
 
-const EffectProps::Reverb ReverbPresets::Misc::chapel = {1.0000F, 0.8400F, 0.3162F, 0.5623F, 1.0000F, 4.6200F, 0.6400F, 1.2300F, 0.4467F, 0.0320F, {0.0000F, 0.0000F, 0.0000F}, 0.7943F, 0.0490F, {0.0000F, 0.0000F, 0.0000F}, 0.2500F, 0.0000F, 0.2500F, 0.1100F, 0.9943F, 5000.0000F, 250.0000F, 0.0000F, true,};
+constexpr float DistortionEffectState::max_freq_mult;
 
-const EffectProps::Reverb ReverbPresets::Misc::small_water_room = {1.0000F, 0.7000F, 0.3162F, 0.4477F, 1.0000F, 1.5100F, 1.2500F, 1.1400F, 0.8913F, 0.0200F, {0.0000F, 0.0000F, 0.0000F}, 1.4125F, 0.0300F, {0.0000F, 0.0000F, 0.0000F}, 0.1790F, 0.1500F, 0.8950F, 0.1900F, 0.9920F, 5000.0000F, 250.0000F, 0.0000F, false,};
 
-// Reverb presets
-// ==========================================================================
+EffectState* EffectStateFactory::create_distortion()
+{
+    return create<DistortionEffectState>();
+}
 
 
-class EffectState
+class DynamicsEffectState :
+    public EffectState
 {
 public:
-    EffectState(
-        const EffectState& that) = delete;
-
-    EffectState& operator=(
-        const EffectState& that) = delete;
+    DynamicsEffectState()
+        :
+        EffectState{},
+        channels_gains_{},
+        detector_{},
+        threshold_{},
+        slope_{},
+        knee_{},
+        makeup_gain_{},
+        attack_coeff_{},
+        release_coeff_{},
+        reduction_{},
+        tile_gains_{},
+        gain_{},
+        target_gain_{},
+        lookahead_{},
+        lookahead_offset_{}
+    {
+    }
 
-    virtual ~EffectState()
+    virtual ~DynamicsEffectState()
     {
     }
 
 
-    SampleBuffers* dst_buffers_;
-    int dst_channel_count_;
+protected:
+    void do_construct() final
+    {
+        reduction_ = 0.0F;
+        tile_gains_.fill(1.0F);
+        gain_ = 1.0F;
+        target_gain_ = 1.0F;
 
+        for (auto& samples : lookahead_)
+        {
+            samples.fill(0.0F);
+        }
 
-    void construct()
-    {
-        do_construct();
+        lookahead_offset_ = 0;
     }
 
-    void destruct()
+    void do_destruct() final
     {
-        do_destruct();
     }
 
-    void update_device(
-        Device& device)
+    void do_update_device(
+        Device& device) final
     {
-        do_update_device(device);
+        static_cast<void>(device);
     }
 
-    void update(
+    void do_update(
         Device& device,
         const EffectSlot& effect_slot,
-        const EffectProps& props)
+        const EffectProps& effect_props) final
     {
-        do_update(device, effect_slot, props);
+        static_cast<void>(effect_slot);
+
+        const auto& props = effect_props.dynamics_;
+
+        detector_ = props.detector_;
+        threshold_ = props.threshold_;
+        knee_ = props.knee_;
+        makeup_gain_ = props.makeup_gain_;
+
+        // The maximum ratio limits.
+        slope_ = (props.ratio_ < EffectProps::Dynamics::max_ratio) ? 1.0F - (1.0F / props.ratio_) : 1.0F;
+
+        attack_coeff_ = get_tile_coeff(props.attack_time_ * device.sampling_rate_);
+        release_coeff_ = get_tile_coeff(props.release_time_ * device.sampling_rate_);
+
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                1.0F,
+                channels_gains_[i]);
+        }
     }
 
-    void process(
-        int sample_count,
+    void do_process(
+        const int sample_count,
         const SampleBuffers& src_samples,
         SampleBuffers& dst_samples,
-        const int channel_count)
-    {
-        do_process(sample_count, src_samples, dst_samples, channel_count);
-    }
-
-    static void destroy(
-        EffectState*& effect_state)
+        const int channel_count) final
     {
-        if (!effect_state)
+        for (int base = 0; base < sample_count; )
         {
-            return;
-        }
+            // A span never crosses a tile, so the tiles do not depend on the
+            // sizes of the mixes.
+            const auto tile_offset = lookahead_offset_ & (tile_length - 1);
+            const auto td = std::min(tile_length - tile_offset, sample_count - base);
 
-        effect_state->destruct();
-        delete effect_state;
-        effect_state = nullptr;
+            // The delayed tile goes out with the gain ramped across it, and
+            // the input takes its place.
+            const auto step = (target_gain_ - gain_) / static_cast<float>(tile_length);
+            const auto start_gain = gain_ + (step * static_cast<float>(tile_offset + 1));
+
+            for (int j = 0; j < 4; ++j)
+            {
+                auto lookahead = &lookahead_[j][lookahead_offset_];
+
+                for (int k = 0; k < channel_count; ++k)
+                {
+                    const auto channel_gain = channels_gains_[j][k];
+
+                    if (!(std::abs(channel_gain) > silence_threshold_gain))
+                    {
+                        continue;
+                    }
+
+                    Kernels::current.mix_ramp_(
+                        lookahead,
+                        &dst_samples[k][base],
+                        channel_gain * start_gain,
+                        channel_gain * step,
+                        td);
+                }
+
+                std::copy_n(&src_samples[j][base], td, lookahead);
+            }
+
+            lookahead_offset_ = (lookahead_offset_ + td) & (lookahead_length - 1);
+
+            if ((tile_offset + td) == tile_length)
+            {
+                process_tile((lookahead_offset_ - tile_length) & (lookahead_length - 1));
+            }
+
+            base += td;
+        }
     }
 
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        writer.write(reduction_);
+        writer.write(tile_gains_);
+        writer.write(gain_);
+        writer.write(target_gain_);
+        writer.write(lookahead_);
+        writer.write(lookahead_offset_);
+    }
 
-protected:
-    EffectState()
-        :
-        dst_buffers_{},
-        dst_channel_count_{}
+    void do_load_state(
+        StateReader& reader) final
     {
+        reader.read(reduction_);
+        reader.read(tile_gains_);
+        reader.read(gain_);
+        reader.read(target_gain_);
+        reader.read(lookahead_);
+        reader.read_index(lookahead_offset_, lookahead_length);
     }
 
 
-    virtual void do_construct() = 0;
+private:
+    // The level is detected, and the gain is computed, once per tile of the
+    // input. The output is delayed by a few tiles, so the gain of a tile is
+    // reached before its samples go out.
+    static constexpr auto tile_length = 16;
+    static constexpr auto lookahead_length = 64;
+    static constexpr auto lookahead_tiles = lookahead_length / tile_length;
 
-    virtual void do_destruct() = 0;
+    static constexpr auto min_amplitude = 0.000'001F; // -120dB
+    static constexpr auto min_mean_square = min_amplitude * min_amplitude;
 
-    virtual void do_update_device(
-        Device& device) = 0;
 
-    virtual void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& props) = 0;
+    using ChannelsGains = std::array<Gains, max_effect_channels>;
+    using Lookahead = std::array<std::array<float, lookahead_length>, 4>;
+    using TileGains = std::array<float, lookahead_tiles>;
 
-    virtual void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) = 0;
-}; // EffectState
 
-class EffectStateFactory
-{
-public:
-    static EffectState* create_by_type(
-        const EffectType type)
-    {
-        switch (type)
-        {
-        case EffectType::null:
-            return create_null();
+    // Effect gains for each channel
+    ChannelsGains channels_gains_;
 
-        case EffectType::chorus:
-            return create_chorus();
+    // Effect parameters
+    int detector_;
+    float threshold_;
+    float slope_;
+    float knee_;
+    float makeup_gain_;
+    float attack_coeff_;
+    float release_coeff_;
 
-        case EffectType::compressor:
-            return create_compressor();
+    // The gain reduction in decibels.
+    float reduction_;
 
-        case EffectType::dedicated_dialog:
-        case EffectType::dedicated_low_frequency:
-            return create_dedicated();
+    // The gains of the tiles in the look-ahead, by the tile's position in it.
+    TileGains tile_gains_;
 
-        case EffectType::distortion:
-            return create_distortion();
+    // The delayed tile's gain ramps from the first gain to the second one.
+    // Both are the least gain of the tiles in the look-ahead at the time, so
+    // neither exceeds the delayed tile's own gain, and the gain falls ahead of
+    // a peak rather than on it.
+    float gain_;
+    float target_gain_;
 
-        case EffectType::echo:
-            return create_echo();
+    Lookahead lookahead_;
+    int lookahead_offset_;
+
+
+    // The coefficient of the envelope over a tile.
+    static float get_tile_coeff(
+        const float time_samples)
+    {
+        return (time_samples > 0.0F) ? std::exp(-static_cast<float>(tile_length) / time_samples) : 0.0F;
+    }
+
+    // Computes the gain of the tile which has just been read into the
+    // look-ahead.
+    void process_tile(
+        const int tile_offset)
+    {
+        const auto level = (detector_ == EffectProps::Dynamics::detector_rms) ?
+            10.0F * std::log10(std::max(detect_mean_square(tile_offset), min_mean_square)) :
+            20.0F * std::log10(std::max(detect_peak(tile_offset), min_amplitude));
+
+        // Attack or release towards the gain reduction of the tile.
+        const auto target = compute_reduction(level);
+        const auto coeff = (target < reduction_) ? attack_coeff_ : release_coeff_;
 
-        case EffectType::equalizer:
-            return create_equalizer();
+        reduction_ = target + (coeff * (reduction_ - target));
 
-        case EffectType::flanger:
-            return create_flanger();
+        tile_gains_[tile_offset / tile_length] = std::pow(10.0F, (reduction_ + makeup_gain_) / 20.0F);
 
-        case EffectType::eax_reverb:
-        case EffectType::reverb:
-            return create_reverb();
+        gain_ = target_gain_;
+        target_gain_ = *std::min_element(tile_gains_.cbegin(), tile_gains_.cend());
+    }
 
-        case EffectType::ring_modulator:
-            return create_ring_modulator();
+    // Roughly calculates the maximum amplitude of a 4-channel frame, the same
+    // way the compressor does.
+    Float4 get_amplitudes(
+        const int index) const
+    {
+        const auto w = Float4::abs(Float4::load(&lookahead_[0][index]));
+        const auto x = Float4::abs(Float4::load(&lookahead_[1][index]));
+        const auto y = Float4::abs(Float4::load(&lookahead_[2][index]));
+        const auto z = Float4::abs(Float4::load(&lookahead_[3][index]));
 
-        default:
-            return nullptr;
-        }
+        return w + Float4::max(x, Float4::max(y, z));
     }
 
+    float detect_peak(
+        const int tile_offset) const
+    {
+        auto peaks = Float4::zero();
 
-private:
-    static EffectState* create_null();
-    static EffectState* create_chorus();
-    static EffectState* create_compressor();
-    static EffectState* create_dedicated();
-    static EffectState* create_distortion();
-    static EffectState* create_echo();
-    static EffectState* create_equalizer();
-    static EffectState* create_flanger();
-    static EffectState* create_reverb();
-    static EffectState* create_ring_modulator();
+        for (int i = 0; i < tile_length; i += 4)
+        {
+            peaks = Float4::max(peaks, get_amplitudes(tile_offset + i));
+        }
 
+        return Float4::get_max(peaks);
+    }
 
-    template<typename T>
-    static EffectState* create()
+    float detect_mean_square(
+        const int tile_offset) const
     {
-        auto result = static_cast<EffectState*>(new (std::nothrow) T{});
+        auto sums = Float4::zero();
 
-        if (result)
+        for (int i = 0; i < tile_length; i += 4)
         {
-            result->construct();
+            const auto amplitudes = get_amplitudes(tile_offset + i);
+
+            sums = sums + (amplitudes * amplitudes);
         }
 
-        return result;
+        return Float4::get_sum(sums) / static_cast<float>(tile_length);
     }
-}; // EffectStateFactory
 
-struct EffectStateDeleter
-{
-    void operator()(
-        EffectState* effect_state)
+    // Gain reduction of a level, both in decibels, with a quadratic soft knee
+    // centered on the threshold.
+    float compute_reduction(
+        const float level) const
     {
-        if (!effect_state)
+        const auto overshoot = level - threshold_;
+
+        if ((2.0F * overshoot) <= -knee_)
         {
-            return;
+            return 0.0F;
         }
 
-        effect_state->destruct();
-        delete effect_state;
+        if ((2.0F * overshoot) < knee_)
+        {
+            const auto x = overshoot + (0.5F * knee_);
+
+            return -slope_ * x * x / (2.0F * knee_);
+        }
+
+        return -slope_ * overshoot;
     }
-}; // EffectStateDeleter
+}; // DynamicsEffectState
 
-struct Device
-{
-    using ChannelIds = std::array<ChannelId, max_channels>;
+constexpr int DynamicsEffectState::tile_length;
+constexpr float DynamicsEffectState::min_amplitude;
+constexpr float DynamicsEffectState::min_mean_square;
 
 
-    int sampling_rate_;
-    int channel_count_;
-    ChannelFormat channel_format_;
-    ChannelIds channel_ids_;
-    SampleBuffers sample_buffers_;
+EffectState* EffectStateFactory::create_dynamics()
+{
+    return create<DynamicsEffectState>();
+}
 
-    // Temp storage used for each source when mixing.
-    SampleBuffer resampled_data_;
-    SampleBuffer filtered_data_;
 
-    // The "dry" path corresponds to the main output.
-    AmbiOutput dry_;
+class EchoEffectState :
+    public EffectState
+{
+public:
+    struct Tap
+    {
+        int delay;
+    };
 
-    // First-order ambisonics output, to be upsampled to the dry buffer if different.
-    AmbiOutput foa_;
 
-    const float* source_samples_;
+    EchoEffectState()
+        :
+        EffectState{},
+        delay_line_{},
+        taps_{},
+        taps_gains_{},
+        feed_gain_{},
+        filter_{}
+    {
+    }
+
+    virtual ~EchoEffectState()
+    {
+    }
 
 
-    void initialize(
-        const ChannelFormat channel_format,
-        const int sampling_rate)
+protected:
+    void do_construct() final
     {
-        channel_count_ = channel_format_to_channel_count(channel_format);
+        delay_line_.release();
 
-        // Set output format
-        channel_format_ = channel_format;
-        sampling_rate_ = sampling_rate;
+        taps_[0].delay = 0;
+        taps_[1].delay = 0;
 
-        alu_init_renderer();
+        filter_.clear();
+    }
 
-        sample_buffers_.clear();
-        sample_buffers_.resize(channel_count_);
+    void do_destruct() final
+    {
+        delay_line_.release();
     }
 
-    void uninitialize()
+    void do_update_device(
+        Device& device) final
     {
+        auto maxlen = static_cast<int>(EffectProps::Echo::max_delay * device.sampling_rate_) + 1;
+        maxlen += static_cast<int>(EffectProps::Echo::max_lr_delay * device.sampling_rate_) + 1;
+
+        // The first tap is read after the tile is written, so the line holds a
+        // tile past the longest delay.
+        delay_line_.reset(maxlen + max_tile_samples);
     }
 
-    void set_default_wfx_channel_order()
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
     {
-        channel_ids_.fill(ChannelId::none);
+        static_cast<void>(effect_slot);
 
-        switch (channel_format_)
+        AmbiCoeffs coeffs;
+        float effect_gain, lrpan, spread;
+
+        const auto frequency = device.sampling_rate_;
+
+        taps_[0].delay = static_cast<int>(effect_props.echo_.delay_ * frequency) + 1;
+        taps_[1].delay = static_cast<int>(effect_props.echo_.lr_delay_ * frequency);
+        taps_[1].delay += taps_[0].delay;
+
+        spread = effect_props.echo_.spread_;
+
+        if (spread < 0.0F)
         {
-        case ChannelFormat::mono:
-            channel_ids_[0] = ChannelId::front_center;
-            break;
+            lrpan = -1.0F;
+        }
+        else
+        {
+            lrpan = 1.0F;
+        }
 
-        case ChannelFormat::stereo:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            break;
+        // Convert echo spread (where 0 = omni, +/-1 = directional) to coverage
+        // spread (where 0 = point, tau = omni).
+        spread = std::asin(1.0F - std::abs(spread)) * 4.0F;
 
-        case ChannelFormat::quad:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            channel_ids_[2] = ChannelId::back_left;
-            channel_ids_[3] = ChannelId::back_right;
-            break;
+        feed_gain_ = effect_props.echo_.feedback_;
 
-        case ChannelFormat::five_point_one:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            channel_ids_[2] = ChannelId::front_center;
-            channel_ids_[3] = ChannelId::lfe;
-            channel_ids_[4] = ChannelId::side_left;
-            channel_ids_[5] = ChannelId::side_right;
-            break;
+        effect_gain = std::max(1.0F - effect_props.echo_.damping_, 0.0625F); // Limit -24dB
 
-        case ChannelFormat::five_point_one_rear:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            channel_ids_[2] = ChannelId::front_center;
-            channel_ids_[3] = ChannelId::lfe;
-            channel_ids_[4] = ChannelId::back_left;
-            channel_ids_[5] = ChannelId::back_right;
-            break;
+        filter_.set_params(
+            FilterType::high_shelf,
+            effect_gain,
+            SendProps::lp_frequency_reference / frequency,
+            FilterState::calc_rcp_q_from_slope(effect_gain, 1.0F));
 
-        case ChannelFormat::six_point_one:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            channel_ids_[2] = ChannelId::front_center;
-            channel_ids_[3] = ChannelId::lfe;
-            channel_ids_[4] = ChannelId::back_center;
-            channel_ids_[5] = ChannelId::side_left;
-            channel_ids_[6] = ChannelId::side_right;
-            break;
+        effect_gain = 1.0F;
 
-        case ChannelFormat::seven_point_one:
-            channel_ids_[0] = ChannelId::front_left;
-            channel_ids_[1] = ChannelId::front_right;
-            channel_ids_[2] = ChannelId::front_center;
-            channel_ids_[3] = ChannelId::lfe;
-            channel_ids_[4] = ChannelId::back_left;
-            channel_ids_[5] = ChannelId::back_right;
-            channel_ids_[6] = ChannelId::side_left;
-            channel_ids_[7] = ChannelId::side_right;
-            break;
+        // First tap panning
+        Panning::calc_angle_coeffs(-Math::pi_2 * lrpan, 0.0F, spread, coeffs);
+        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, effect_gain, taps_gains_[0]);
 
-        case ChannelFormat::none:
-        default:
-            break;
+        // Second tap panning
+        Panning::calc_angle_coeffs(Math::pi_2 * lrpan, 0.0F, spread, coeffs);
+        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, effect_gain, taps_gains_[1]);
+    }
+
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
+    {
+        const auto tap1 = taps_[0].delay;
+        const auto tap2 = taps_[1].delay;
+
+        for (int base = 0; base < sample_count; )
+        {
+            float temps[2][max_tile_samples];
+            float feedback[2][max_tile_samples];
+            const auto td = std::min(max_tile_samples, sample_count - base);
+            const auto src = &src_samples[0][base];
+
+            // Apply damping and feedback gain to the second tap, and mix in the
+            // new sample.
+            if (tap2 >= min_span_samples)
+            {
+                // The second tap is fed back in spans no longer than it, so a
+                // span only reads samples written before it.
+                for (int i = 0; i < td; )
+                {
+                    const auto span = std::min(td - i, tap2);
+
+                    delay_line_.read(tap2, span, &temps[1][i]);
+
+                    for (int j = i; j < (i + span); ++j)
+                    {
+                        feedback[0][j] = temps[1][j] + src[j];
+                    }
+
+                    filter_.process(span, &feedback[0][i], &feedback[1][i]);
+
+                    for (int j = i; j < (i + span); ++j)
+                    {
+                        feedback[1][j] *= feed_gain_;
+                    }
+
+                    delay_line_.write(span, &feedback[1][i]);
+                    delay_line_.advance(span);
+
+                    i += span;
+                }
+            }
+            else
+            {
+                // The spans would be too short to pay off, so the tile is fed
+                // back sample by sample.
+                for (int i = 0; i < td; ++i)
+                {
+                    delay_line_.read(tap2, 1, &temps[1][i]);
+
+                    feedback[0][i] = temps[1][i] + src[i];
+                    filter_.process_serial(1, &feedback[0][i], &feedback[1][i]);
+                    feedback[1][i] *= feed_gain_;
+
+                    delay_line_.write(1, &feedback[1][i]);
+                    delay_line_.advance(1);
+                }
+            }
+
+            // The first tap does not feed back, so it is read for the whole tile
+            // once the tile is written.
+            delay_line_.read(tap1 + td, td, temps[0]);
+
+            for (int k = 0; k < channel_count; ++k)
+            {
+                for (int t = 0; t < 2; ++t)
+                {
+                    const auto channel_gain = taps_gains_[t][k];
+
+                    if (std::abs(channel_gain) > silence_threshold_gain)
+                    {
+                        Kernels::current.mix_(temps[t], &dst_samples[k][base], channel_gain, td);
+                    }
+                }
+            }
+
+            base += td;
         }
     }
 
-    void alu_init_renderer()
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        delay_line_.save_state(writer);
+        filter_.save_state(writer);
+    }
+
+    void do_load_state(
+        StateReader& reader) final
     {
-        dry_.ambi_.reset();
-        dry_.coeff_count_ = 0;
-        set_default_wfx_channel_order();
+        delay_line_.load_state(reader);
+        filter_.load_state(reader);
+    }
 
-        const ChannelPanning *channel_map = nullptr;
-        auto coeff_count = 0;
-        auto count = 0;
 
-        switch (channel_format_)
-        {
-        case ChannelFormat::mono:
-            count = get_array_extents(Panning::mono_panning);
-            channel_map = Panning::mono_panning;
-            coeff_count = 1;
-            break;
+private:
+    static constexpr auto max_tile_samples = 128;
 
-        case ChannelFormat::stereo:
-            count = get_array_extents(Panning::stereo_panning);
-            channel_map = Panning::stereo_panning;
-            coeff_count = 4;
-            break;
+    // The shortest feedback delay fed back in spans rather than per sample.
+    static constexpr auto min_span_samples = 8;
 
-        case ChannelFormat::quad:
-            count = get_array_extents(Panning::quad_panning);
-            channel_map = Panning::quad_panning;
-            coeff_count = 4;
-            break;
 
-        case ChannelFormat::five_point_one:
-            count = get_array_extents(Panning::x5_1_side_panning);
-            channel_map = Panning::x5_1_side_panning;
-            coeff_count = 9;
-            break;
+    using Taps = std::array<Tap, 2>;
+    using TapsGains = std::array<Gains, 2>;
 
-        case ChannelFormat::five_point_one_rear:
-            count = get_array_extents(Panning::x5_1_rear_panning);
-            channel_map = Panning::x5_1_rear_panning;
-            coeff_count = 9;
-            break;
 
-        case ChannelFormat::six_point_one:
-            count = get_array_extents(Panning::x6_1_panning);
-            channel_map = Panning::x6_1_panning;
-            coeff_count = 9;
-            break;
+    DelayLine delay_line_;
 
-        case ChannelFormat::seven_point_one:
-            count = get_array_extents(Panning::x7_1_panning);
-            channel_map = Panning::x7_1_panning;
-            coeff_count = 16;
-            break;
+    // The echo is two tap. The delay is the number of samples from before the
+    // current offset
+    Taps taps_;
 
-        case ChannelFormat::none:
-        default:
-            break;
-        }
+    // The panning gains for the two taps
+    TapsGains taps_gains_;
 
-        Panning::set_channel_map(
-            channel_ids_.data(),
-            dry_.ambi_.coeffs_.data(),
-            channel_map,
-            count,
-            &channel_count_);
+    float feed_gain_;
 
-        dry_.coeff_count_ = coeff_count;
+    FilterState filter_;
+}; // EchoEffectState
 
-        foa_.ambi_.reset();
+constexpr int EchoEffectState::max_tile_samples;
+constexpr int EchoEffectState::min_span_samples;
 
-        for (int i = 0; i < channel_count_; ++i)
-        {
-            foa_.ambi_.coeffs_[i][0] = dry_.ambi_.coeffs_[i][0];
 
-            for (int j = 1; j < 4; ++j)
-            {
-                foa_.ambi_.coeffs_[i][j] = dry_.ambi_.coeffs_[i][j];
-            }
-        }
+EffectState* EffectStateFactory::create_echo()
+{
+    return create<EchoEffectState>();
+}
 
-        foa_.coeff_count_ = 4;
+
+//  The document  "Effects Extension Guide.pdf"  says that low and high
+//  frequencies are cutoff frequencies. This is not fully correct, they
+//  are corner frequencies for low and high shelf filters. If they were
+//  just cutoff frequencies, there would be no need in cutoff frequency
+//  gains, which are present.  Documentation for  "Creative Proteus X2"
+//  software describes  4-band equalizer functionality in a much better
+//  way.  This equalizer seems  to be a predecessor  of  OpenAL  4-band
+//  equalizer.  With low and high  shelf filters  we are able to cutoff
+//  frequencies below and/or above corner frequencies using attenuation
+//  gains (below 1.0) and amplify all low and/or high frequencies using
+//  gains above 1.0.
+//
+//     Low-shelf       Low Mid Band      High Mid Band     High-shelf
+//      corner            center             center          corner
+//     frequency        frequency          frequency       frequency
+//    50Hz..800Hz     200Hz..3000Hz      1000Hz..8000Hz  4000Hz..16000Hz
+//
+//          |               |                  |               |
+//          |               |                  |               |
+//   B -----+            /--+--\            /--+--\            +-----
+//   O      |\          |   |   |          |   |   |          /|
+//   O      | \        -    |    -        -    |    -        / |
+//   S +    |  \      |     |     |      |     |     |      /  |
+//   T      |   |    |      |      |    |      |      |    |   |
+// ---------+---------------+------------------+---------------+--------
+//   C      |   |    |      |      |    |      |      |    |   |
+//   U -    |  /      |     |     |      |     |     |      \  |
+//   T      | /        -    |    -        -    |    -        \ |
+//   O      |/          |   |   |          |   |   |          \|
+//   F -----+            \--+--/            \--+--/            +-----
+//   F      |               |                  |               |
+//          |               |                  |               |
+//
+// Gains vary from 0.126 up to 7.943, which means from -18dB attenuation
+// up to +18dB amplification. Band width varies from 0.01 up to 1.0 in
+// octaves for two mid bands.
+//
+// Implementation is based on the "Cookbook formulae for audio EQ biquad
+// filter coefficients" by Robert Bristow-Johnson
+// http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt/
+class EqualizerEffectState :
+    public EffectState
+{
+public:
+    EqualizerEffectState()
+        :
+        EffectState{},
+        channels_gains_{},
+        stages_{}
+    {
     }
 
-    // Returns the index for the given channel name (e.g. FrontCenter), or -1 if it
-    // doesn't exist.
-    int get_channel_index(
-        const ChannelId channel_id_to_find)
+    virtual ~EqualizerEffectState()
     {
-        const auto it_begin = channel_ids_.cbegin();
-        const auto it_end = channel_ids_.cbegin();
+    }
 
-        const auto it = std::find_if(
-            it_begin,
-            it_end,
-            [=](const ChannelId channel_id)
-            {
-                return channel_id == channel_id_to_find;
-            }
-        );
 
-        if (it == it_end)
+protected:
+    void do_construct()
+    {
+        // Initialize sample history only on filter creation to avoid
+        // sound clicks if filter settings were changed in runtime.
+        for (auto& stage : stages_)
         {
-            return -1;
+            stage.clear();
         }
-
-        return static_cast<int>(it - it_begin);
     }
 
-    static int channel_format_to_channel_count(
-        const ChannelFormat channel_format)
+    void do_destruct()
     {
-        switch (channel_format)
-        {
-        case ChannelFormat::mono:
-            return 1;
-
-        case ChannelFormat::stereo:
-            return 2;
+    }
 
-        case ChannelFormat::quad:
-            return 4;
+    void do_update_device(
+        Device& device)
+    {
+        static_cast<void>(device);
+    }
 
-        case ChannelFormat::five_point_one:
-        case ChannelFormat::five_point_one_rear:
-            return 6;
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props)
+    {
+        static_cast<void>(effect_slot);
 
-        case ChannelFormat::six_point_one:
-            return 7;
+        const auto frequency = static_cast<float>(device.sampling_rate_);
+        float gain;
+        float freq_mult;
+        FilterState filter;
 
-        case ChannelFormat::seven_point_one:
-            return 8;
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
 
-        default:
-            return 0;
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                1.0F,
+                channels_gains_[i]);
         }
-    }
-}; // Device
-
-struct EffectSlot
-{
-    using EffectStateUPtr = std::unique_ptr<EffectState, EffectStateDeleter>;
 
+        // Calculate coefficients for the each type of filter. Note that the shelf
+        // filters' gain is for the reference frequency, which is the centerpoint
+        // of the transition band.
+        gain = std::max(std::sqrt(effect_props.equalizer_.low_gain_), 0.0625F); // Limit -24dB
+        freq_mult = effect_props.equalizer_.low_cutoff_ / frequency;
 
-    Effect effect_;
-    EffectStateUPtr effect_state_;
-    bool is_props_changed_;
+        filter.set_params(
+            FilterType::low_shelf,
+            gain,
+            freq_mult,
+            FilterState::calc_rcp_q_from_slope(gain, 0.75F));
 
-    // Wet buffer configuration is ACN channel order with N3D scaling:
-    // * Channel 0 is the unattenuated mono signal.
-    // * Channel 1 is OpenAL -X
-    // * Channel 2 is OpenAL Y
-    // * Channel 3 is OpenAL -Z
-    // Consequently, effects that only want to work with mono input can use
-    // channel 0 by itself. Effects that want multichannel can process the
-    // ambisonics signal and make a B-Format pan (ComputeFirstOrderGains) for
-    // first-order device output (FOAOut).
-    SampleBuffers wet_buffer_;
+        stages_[0].set_params(filter);
 
+        gain = std::max(effect_props.equalizer_.mid1_gain_, 0.0625F);
+        freq_mult = effect_props.equalizer_.mid1_center_ / frequency;
 
-    EffectSlot()
-        :
-        effect_{},
-        effect_state_{},
-        is_props_changed_{},
-        wet_buffer_{SampleBuffers::size_type{max_effect_channels}}
-    {
-    }
+        filter.set_params(
+            FilterType::peaking,
+            gain,
+            freq_mult,
+            FilterState::calc_rcp_q_from_bandwidth(freq_mult, effect_props.equalizer_.mid1_width_));
 
-    EffectSlot(
-        const EffectSlot& that) = delete;
+        stages_[1].set_params(filter);
 
-    EffectSlot(
-        EffectSlot&& that) = default;
+        gain = std::max(effect_props.equalizer_.mid2_gain_, 0.0625F);
+        freq_mult = effect_props.equalizer_.mid2_center_ / frequency;
 
-    EffectSlot& operator=(
-        const EffectSlot& that) = delete;
+        filter.set_params(
+            FilterType::peaking,
+            gain,
+            freq_mult,
+            FilterState::calc_rcp_q_from_bandwidth(freq_mult, effect_props.equalizer_.mid2_width_));
 
-    EffectSlot& operator=(
-        EffectSlot&& that) = default;
+        stages_[2].set_params(filter);
 
-    ~EffectSlot()
-    {
-        uninitialize();
-    }
+        gain = std::max(std::sqrt(effect_props.equalizer_.high_gain_), 0.0625F);
+        freq_mult = effect_props.equalizer_.high_cutoff_ / frequency;
 
-    void initialize()
-    {
-        uninitialize();
+        filter.set_params(
+            FilterType::high_shelf,
+            gain,
+            freq_mult,
+            FilterState::calc_rcp_q_from_slope(gain, 0.75F));
 
-        effect_.type_ = EffectType::null;
-        effect_state_.reset(EffectStateFactory::create_by_type(EffectType::null));
-        is_props_changed_ = true;
+        stages_[3].set_params(filter);
     }
 
-    void uninitialize()
+    // Pushes every frame through all four stages while it stays in registers.
+    // The lanes of a vector are the four B-format channels, so the cascade runs
+    // on a whole frame at once. Frames are loaded and stored four at a time with
+    // a transpose between the planar buffers and the per-frame vectors.
+    void do_process(
+        const int sample_count,
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count)
     {
-        effect_state_.reset(nullptr);
-    }
+        Float4 b0[stage_count];
+        Float4 b1[stage_count];
+        Float4 b2[stage_count];
+        Float4 a1[stage_count];
+        Float4 a2[stage_count];
+        Float4 z1[stage_count];
+        Float4 z2[stage_count];
 
-    void set_effect(
-        Device& device,
-        Effect& effect)
-    {
-        if (effect_.type_ != effect.type_)
+        for (int s = 0; s < stage_count; ++s)
         {
-            effect_state_.reset(EffectStateFactory::create_by_type(effect.type_));
-
-            effect_state_->dst_buffers_ = &device.sample_buffers_;
-            effect_state_->dst_channel_count_ = device.channel_count_;
-            effect_state_->update_device(device);
-
-            effect_.type_ = effect.type_;
-            effect_.props_ = effect.props_;
+            b0[s] = Float4::set1(stages_[s].b0_);
+            b1[s] = Float4::set1(stages_[s].b1_);
+            b2[s] = Float4::set1(stages_[s].b2_);
+            a1[s] = Float4::set1(stages_[s].a1_);
+            a2[s] = Float4::set1(stages_[s].a2_);
+            z1[s] = Float4::load(stages_[s].z1_);
+            z2[s] = Float4::load(stages_[s].z2_);
         }
-        else
+
+        for (int base = 0; base < sample_count; base += 4)
         {
-            effect_.props_ = effect.props_;
-        }
+            const auto td = std::min(4, sample_count - base);
 
-        is_props_changed_ = true;
-    }
-}; // EffectSlot
+            Float4 frames[4];
 
-struct EffectContext
-{
-    Effect deferred_effect_;
-    EffectSlot effect_slot_;
-}; // EffectContext
+            if (td == 4)
+            {
+                for (int ft = 0; ft < max_effect_channels; ++ft)
+                {
+                    frames[ft] = Float4::load(&src_samples[ft][base]);
+                }
+            }
+            else
+            {
+                float tail[max_effect_channels][4] = {};
 
-using EffectContexts = std::vector<EffectContext>;
+                for (int ft = 0; ft < max_effect_channels; ++ft)
+                {
+                    for (int it = 0; it < td; ++it)
+                    {
+                        tail[ft][it] = src_samples[ft][base + it];
+                    }
 
+                    frames[ft] = Float4::load(tail[ft]);
+                }
+            }
 
-struct MixHelpers
-{
-    // Basically the inverse of the "mix". Rather than one input going to multiple
-    // outputs (each with its own gain), it's multiple inputs (each with its own
-    // gain) going to one output. This applies one row (vs one column) of a matrix
-    // transform. And as the matrices are more or less static once set up, no
-    // stepping is necessary.
-    static void mix_row(
-        float* dst_buffer,
-        const float* gains,
-        const SampleBuffers& src_buffers,
-        const int channel_count,
-        const int src_position,
-        const int buffer_size)
-    {
-        for (int c = 0; c < channel_count; ++c)
-        {
-            const auto gain = gains[c];
+            Float4::transpose(frames[0], frames[1], frames[2], frames[3]);
 
-            if (!(std::abs(gain) > silence_threshold_gain))
+            for (int it = 0; it < td; ++it)
             {
-                continue;
+                auto x = frames[it];
+
+                for (int s = 0; s < stage_count; ++s)
+                {
+                    const auto y = (b0[s] * x) + z1[s];
+
+                    z1[s] = (b1[s] * x) - (a1[s] * y) + z2[s];
+                    z2[s] = (b2[s] * x) - (a2[s] * y);
+
+                    x = y;
+                }
+
+                frames[it] = x;
             }
 
-            for (int i = 0; i < buffer_size; ++i)
+            Float4::transpose(frames[0], frames[1], frames[2], frames[3]);
+
+            for (int kt = 0; kt < channel_count; ++kt)
             {
-                dst_buffer[i] += src_buffers[c][src_position + i] * gain;
-            }
-        }
-    }
+                auto sum = Float4::zero();
+                auto is_silent = true;
 
-    static void mix(
-        const float* data,
-        const int channel_count,
-        SampleBuffers& dst_buffers,
-        float* current_gains,
-        const float* target_gains,
-        const int counter,
-        const int dst_position,
-        const int buffer_size)
-    {
-        const auto delta = ((counter > 0) ? 1.0F / static_cast<float>(counter) : 0.0F);
+                for (int ft = 0; ft < max_effect_channels; ++ft)
+                {
+                    const auto gain = channels_gains_[ft][kt];
 
-        for (int c = 0; c < channel_count; ++c)
-        {
-            auto pos = 0;
-            auto gain = current_gains[c];
-            const auto step = (target_gains[c] - gain) * delta;
+                    if (!(std::abs(gain) > silence_threshold_gain))
+                    {
+                        continue;
+                    }
 
-            if (std::abs(step) > Math::get_epsilon())
-            {
-                const auto size = std::min(buffer_size, counter);
+                    sum = sum + (Float4::set1(gain) * frames[ft]);
+                    is_silent = false;
+                }
 
-                for ( ; pos < size; ++pos)
+                if (is_silent)
                 {
-                    dst_buffers[c][dst_position + pos] += data[pos] * gain;
-                    gain += step;
+                    continue;
                 }
 
-                if (pos == counter)
+                auto dst = &dst_samples[kt][base];
+
+                if (td == 4)
                 {
-                    gain = target_gains[c];
+                    (Float4::load(dst) + sum).store(dst);
                 }
+                else
+                {
+                    float mixed[4];
 
-                current_gains[c] = gain;
-            }
+                    sum.store(mixed);
 
-            if (!(std::abs(gain) > silence_threshold_gain))
-            {
-                continue;
+                    for (int it = 0; it < td; ++it)
+                    {
+                        dst[it] += mixed[it];
+                    }
+                }
             }
+        }
 
-            for ( ; pos < buffer_size; ++pos)
-            {
-                dst_buffers[c][dst_position + pos] += data[pos] * gain;
-            }
+        for (int s = 0; s < stage_count; ++s)
+        {
+            z1[s].store(stages_[s].z1_);
+            z2[s].store(stages_[s].z2_);
         }
     }
-}; // MixHelpers
-
-
-// ==========================================================================
-// Api::Impl
-
-struct ApiImplErrorMessages
-{
-    static constexpr auto NoError = "";
-    static constexpr auto InvalidChannelFormat = "Invalid channel format.";
-    static constexpr auto SamplingRateOutOfRange = "Sampling rate is out of range.";
-    static constexpr auto EffectCountOutOfRange = "Effect count is out of range.";
-}; // ApiImplErrorMessages
-
-
-class Api::Impl
-{
-public:
-    Device device_;
-    Source source_;
-    EffectContexts effect_contexts_;
-    int effect_count_;
-    const char* error_message_;
-
 
-    Impl()
-        :
-        device_{},
-        source_{},
-        effect_contexts_{},
-        effect_count_{},
-        error_message_{ApiImplErrorMessages::NoError}
+    void do_save_state(
+        StateWriter& writer) const final
     {
+        for (const auto& stage : stages_)
+        {
+            writer.write(stage.z1_);
+            writer.write(stage.z2_);
+        }
     }
 
-    ~Impl()
+    void do_load_state(
+        StateReader& reader) final
     {
-        uninitialize();
+        for (auto& stage : stages_)
+        {
+            reader.read(stage.z1_);
+            reader.read(stage.z2_);
+        }
     }
 
 
-    bool initialize(
-        const ChannelFormat channel_format,
-        const int sampling_rate,
-        const int effect_count)
+private:
+    // Low shelf, two peaking mid bands and high shelf.
+    static constexpr auto stage_count = 4;
+
+
+    // A biquad section in transposed direct form II. The coefficients are
+    // shared by all input channels, the state is kept per channel.
+    struct Stage
     {
-        uninitialize();
+        float b0_;
+        float b1_;
+        float b2_;
+        float a1_;
+        float a2_;
 
-        const auto channel_count = Device::channel_format_to_channel_count(channel_format);
+        float z1_[max_effect_channels];
+        float z2_[max_effect_channels];
 
-        if (channel_count == 0)
-        {
-            error_message_ = ApiImplErrorMessages::InvalidChannelFormat;
-            return false;
-        }
 
-        if (sampling_rate < min_sampling_rate)
+        void clear()
         {
-            error_message_ = ApiImplErrorMessages::SamplingRateOutOfRange;
-            return false;
+            std::fill_n(z1_, max_effect_channels, 0.0F);
+            std::fill_n(z2_, max_effect_channels, 0.0F);
         }
 
-        if (effect_count <= 0 || effect_count > max_effects)
+        void set_params(
+            const FilterState& filter)
         {
-            error_message_ = ApiImplErrorMessages::EffectCountOutOfRange;
-            return false;
+            b0_ = filter.b0_;
+            b1_ = filter.b1_;
+            b2_ = filter.b2_;
+            a1_ = filter.a1_;
+            a2_ = filter.a2_;
         }
+    }; // Stage
 
-        device_.initialize(channel_format, sampling_rate);
+    using ChannelsGains = std::array<Gains, max_effect_channels>;
+    using Stages = std::array<Stage, stage_count>;
 
-        effect_count_ = effect_count;
 
-        effect_contexts_.clear();
-        effect_contexts_.resize(effect_count_);
+    // Effect gains for each channel
+    ChannelsGains channels_gains_;
 
-        for (auto& effect_context : effect_contexts_)
-        {
-            effect_context.deferred_effect_.set_type_and_defaults(EffectType::null);
-            effect_context.effect_slot_.initialize();
+    // Effect parameters
+    Stages stages_;
+}; // EqualizerEffectState
 
-            auto effect_state = effect_context.effect_slot_.effect_state_.get();
-            effect_state->dst_buffers_ = &device_.sample_buffers_;
-            effect_state->dst_channel_count_ = device_.channel_count_;
-            effect_state->update_device(device_);
-            effect_context.effect_slot_.is_props_changed_ = true;
-        }
 
-        source_.initialize(effect_count);
+EffectState* EffectStateFactory::create_equalizer()
+{
+    return create<EqualizerEffectState>();
+}
 
-        for (int i = 0; i < device_.channel_count_; ++i)
-        {
-            source_.direct_.channels_[i].reset();
 
-            for (auto& aux : source_.auxes_)
-            {
-                aux.channels_[i].reset();
-            }
-        }
+using FlangerEffectState = ModulatedDelayEffectState<EffectProps::Flanger, &EffectProps::flanger_>;
 
-        return true;
+EffectState* EffectStateFactory::create_flanger()
+{
+    return create<FlangerEffectState>();
+}
+
+
+class MultiTapEchoEffectState :
+    public EffectState
+{
+public:
+    struct Tap
+    {
+        int delay;
+    };
+
+
+    MultiTapEchoEffectState()
+        :
+        EffectState{},
+        delay_line_{},
+        tap_count_{},
+        taps_{},
+        taps_gains_{},
+        feedback_delay_{},
+        feed_gain_{},
+        filter_{}
+    {
+    }
+
+    virtual ~MultiTapEchoEffectState()
+    {
+    }
+
+
+protected:
+    void do_construct() final
+    {
+        delay_line_.release();
+
+        tap_count_ = 0;
+        feedback_delay_ = 1;
+
+        filter_.clear();
+    }
+
+    void do_destruct() final
+    {
+        delay_line_.release();
     }
 
-    void uninitialize()
+    void do_update_device(
+        Device& device) final
     {
-        for (auto& effect_context : effect_contexts_)
-        {
-            effect_context.effect_slot_.uninitialize();
-        }
+        // The taps are read after the tile is written, so the line holds a tile
+        // past the longest delay.
+        const auto maxlen = static_cast<int>(EffectProps::MultiTapEcho::max_delay * device.sampling_rate_) + 1;
 
-        device_.uninitialize();
+        delay_line_.reset(maxlen + max_tile_samples);
     }
 
-    void mix_source(
-        const int sample_count)
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
     {
-        const auto channel_count = device_.channel_count_;
+        static_cast<void>(effect_slot);
 
-        for (int chan = 0; chan < channel_count; ++chan)
-        {
-            for (int i = 0; i < sample_count; ++i)
-            {
-                device_.resampled_data_[i] = device_.source_samples_[(i * channel_count) + chan];
-            }
+        const auto& props = effect_props.multi_tap_echo_;
+        const auto frequency = device.sampling_rate_;
 
+        AmbiCoeffs coeffs;
 
-            auto parms = &source_.direct_.channels_[chan];
+        tap_count_ = props.tap_count_;
 
-            auto samples = apply_filters(
-                &parms->low_pass_,
-                &parms->high_pass_,
-                device_.filtered_data_.data(),
-                device_.resampled_data_.data(),
-                sample_count,
-                source_.direct_.filter_type_);
+        auto longest_delay = 0;
 
-            parms->current_gains_ = parms->target_gains_;
+        for (int i = 0; i < tap_count_; ++i)
+        {
+            const auto& tap_props = props.taps_[i];
 
-            MixHelpers::mix(
-                samples,
-                source_.direct_.channel_count_,
-                *source_.direct_.buffers_,
-                parms->current_gains_.data(),
-                parms->target_gains_.data(),
-                0,
-                0,
-                sample_count);
+            taps_[i].delay = static_cast<int>(tap_props.delay_ * frequency);
 
-            for (auto& aux : source_.auxes_)
-            {
-                if (!aux.buffers_)
-                {
-                    continue;
-                }
+            longest_delay = std::max(longest_delay, taps_[i].delay);
 
-                parms = &aux.channels_[chan];
+            // The tap gain is folded into the panning gains.
+            Panning::calc_angle_coeffs(Math::pi_2 * tap_props.pan_, 0.0F, 0.0F, coeffs);
+            Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, tap_props.gain_, taps_gains_[i]);
+        }
 
-                samples = apply_filters(
-                    &parms->low_pass_,
-                    &parms->high_pass_,
-                    device_.filtered_data_.data(),
-                    device_.resampled_data_.data(),
-                    sample_count,
-                    aux.filter_type_);
+        // The feedback tap should be at least one sample back.
+        feedback_delay_ = std::max(longest_delay, 1);
 
-                parms->current_gains_ = parms->target_gains_;
+        feed_gain_ = props.feedback_;
 
-                MixHelpers::mix(
-                    samples,
-                    aux.channel_count_,
-                    *aux.buffers_,
-                    parms->current_gains_.data(),
-                    parms->target_gains_.data(),
-                    0,
-                    0,
-                    sample_count);
-            }
-        }
+        const auto damping_gain = std::max(1.0F - props.damping_, 0.0625F); // Limit -24dB
+
+        filter_.set_params(
+            FilterType::high_shelf,
+            damping_gain,
+            SendProps::lp_frequency_reference / frequency,
+            FilterState::calc_rcp_q_from_slope(damping_gain, 1.0F));
     }
 
-    void mix_data(
+    void do_process(
         const int sample_count,
-        const float* src_samples,
-        float* dst_samples)
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
     {
-        device_.source_samples_ = src_samples;
-
-        for (int samples_done = 0; samples_done < sample_count; )
+        for (int base = 0; base < sample_count; )
         {
-            const auto samples_to_do = std::min(sample_count - samples_done, max_sample_buffer_size);
+            float feedback[2][max_tile_samples];
+            const auto td = std::min(max_tile_samples, sample_count - base);
+            const auto src = &src_samples[0][base];
 
-            for (int c = 0; c < device_.channel_count_; ++c)
+            // Apply damping and feedback gain to the feedback tap, and mix in
+            // the new sample.
+            if (feedback_delay_ >= min_span_samples)
             {
-                std::fill_n(device_.sample_buffers_[c].begin(), samples_to_do, 0.0F);
-            }
+                // The feedback tap is fed back in spans no longer than it, so a
+                // span only reads samples written before it.
+                for (int i = 0; i < td; )
+                {
+                    const auto span = std::min(td - i, feedback_delay_);
 
-            update_context_sources();
+                    delay_line_.read(feedback_delay_, span, &feedback[0][i]);
+                    filter_.process(span, &feedback[0][i], &feedback[1][i]);
 
-            for (auto& effect_context : effect_contexts_)
+                    for (int j = i; j < (i + span); ++j)
+                    {
+                        feedback[1][j] = src[j] + (feedback[1][j] * feed_gain_);
+                    }
+
+                    delay_line_.write(span, &feedback[1][i]);
+                    delay_line_.advance(span);
+
+                    i += span;
+                }
+            }
+            else
             {
-                for (int c = 0; c < max_effect_channels; ++c)
+                // The spans would be too short to pay off, so the tile is fed
+                // back sample by sample.
+                for (int i = 0; i < td; ++i)
                 {
-                    std::fill_n(effect_context.effect_slot_.wet_buffer_[c].begin(), samples_to_do, 0.0F);
+                    delay_line_.read(feedback_delay_, 1, &feedback[0][i]);
+                    filter_.process_serial(1, &feedback[0][i], &feedback[1][i]);
+                    feedback[1][i] = src[i] + (feedback[1][i] * feed_gain_);
+
+                    delay_line_.write(1, &feedback[1][i]);
+                    delay_line_.advance(1);
                 }
             }
 
-            // source processing
-            mix_source(samples_to_do);
-
-            // effect slot processing
-            for (auto& effect_context : effect_contexts_)
+            // Every tap is mixed straight from the line for the whole tile once
+            // the tile is written.
+            for (int t = 0; t < tap_count_; ++t)
             {
-                auto state = effect_context.effect_slot_.effect_state_.get();
+                const auto delay = taps_[t].delay + td;
+                const auto& tap_gains = taps_gains_[t];
 
-                state->process(
-                    samples_to_do,
-                    effect_context.effect_slot_.wet_buffer_,
-                    *state->dst_buffers_,
-                    state->dst_channel_count_);
-            }
+                for (int k = 0; k < channel_count; ++k)
+                {
+                    const auto channel_gain = tap_gains[k];
 
-            if (dst_samples)
-            {
-                write_f32(
-                    device_.sample_buffers_,
-                    dst_samples,
-                    samples_done,
-                    samples_to_do,
-                    device_.channel_count_);
+                    if (std::abs(channel_gain) > silence_threshold_gain)
+                    {
+                        delay_line_.mix(delay, td, &dst_samples[k][base], channel_gain);
+                    }
+                }
             }
 
-            samples_done += samples_to_do;
+            base += td;
         }
     }
 
+    void do_save_state(
+        StateWriter& writer) const final
+    {
+        delay_line_.save_state(writer);
+        filter_.save_state(writer);
+    }
 
-private:
-    struct ChannelMap
+    void do_load_state(
+        StateReader& reader) final
     {
-        ChannelId channel_id_;
-        float angle_;
-        float elevation_;
-    }; // ChannelMap
+        delay_line_.load_state(reader);
+        filter_.load_state(reader);
+    }
 
-    static constexpr ChannelMap mono_map[1] =
+
+private:
+    static constexpr auto max_tile_samples = 128;
+
+    // The shortest feedback delay fed back in spans rather than per sample.
+    static constexpr auto min_span_samples = 8;
+
+
+    using Taps = std::array<Tap, EffectProps::MultiTapEcho::max_taps>;
+    using TapsGains = std::array<Gains, EffectProps::MultiTapEcho::max_taps>;
+
+
+    DelayLine delay_line_;
+
+    // The delay is the number of samples from before the current offset.
+    int tap_count_;
+    Taps taps_;
+
+    // The panning gains for the taps, scaled by the tap gains.
+    TapsGains taps_gains_;
+
+    int feedback_delay_;
+    float feed_gain_;
+
+    FilterState filter_;
+}; // MultiTapEchoEffectState
+
+constexpr int MultiTapEchoEffectState::max_tile_samples;
+constexpr int MultiTapEchoEffectState::min_span_samples;
+
+
+EffectState* EffectStateFactory::create_multi_tap_echo()
+{
+    return create<MultiTapEchoEffectState>();
+}
+
+
+class RingModulatorEffectState :
+    public EffectState
+{
+public:
+    RingModulatorEffectState()
+        :
+        EffectState{},
+        waveform_{},
+        phase_{},
+        step_{},
+        channels_gains_{},
+        filters_{},
+        oversamplers_{}
     {
-        {ChannelId::front_center, 0.0F, 0.0F,},
-    };
+    }
 
-    static constexpr ChannelMap stereo_map[2] =
+    virtual ~RingModulatorEffectState()
     {
-        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
-    };
+    }
 
-    static constexpr ChannelMap quad_map[4] =
+
+protected:
+    void do_construct() final
     {
-        {ChannelId::front_left, Math::deg_to_rad(-45.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_right, Math::deg_to_rad(45.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::back_left, Math::deg_to_rad(-135.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::back_right, Math::deg_to_rad(135.0F), Math::deg_to_rad(0.0F),},
-    };
+        phase_ = 0;
+        step_ = 1;
 
-    static constexpr ChannelMap x5_1_map[6] =
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            filters_[i].clear();
+            oversamplers_[i].clear();
+        }
+    }
+
+    void do_destruct() final
     {
-        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::lfe, 0.0F, 0.0F,},
-        {ChannelId::side_left, Math::deg_to_rad(-110.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::side_right, Math::deg_to_rad(110.0F), Math::deg_to_rad(0.0F),},
-    };
+    }
 
-    static constexpr ChannelMap x6_1_map[7] =
+    void do_update_device(
+        Device& device) final
     {
-        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::lfe, 0.0F, 0.0F,},
-        {ChannelId::back_center, Math::deg_to_rad(180.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::side_left, Math::deg_to_rad(-90.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::side_right, Math::deg_to_rad(90.0F), Math::deg_to_rad(0.0F),},
-    };
+        static_cast<void>(device);
+    }
 
-    static constexpr ChannelMap x7_1_map[8] =
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
     {
-        {ChannelId::front_left, Math::deg_to_rad(-30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_right, Math::deg_to_rad(30.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::front_center, Math::deg_to_rad(0.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::lfe, 0.0F, 0.0F,},
-        {ChannelId::back_left, Math::deg_to_rad(-150.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::back_right, Math::deg_to_rad(150.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::side_left, Math::deg_to_rad(-90.0F), Math::deg_to_rad(0.0F),},
-        {ChannelId::side_right, Math::deg_to_rad(90.0F), Math::deg_to_rad(0.0F),},
-    };
+        static_cast<void>(effect_slot);
+
+        if (effect_props.ring_modulator_.waveform_ == EffectProps::RingModulator::waveform_sinusoid)
+        {
+            waveform_ = Oscillator::Waveform::sinusoid;
+        }
+        else if (effect_props.ring_modulator_.waveform_ == EffectProps::RingModulator::waveform_sawtooth)
+        {
+            waveform_ = Oscillator::Waveform::sawtooth;
+        }
+        else
+        {
+            waveform_ = Oscillator::Waveform::square;
+        }
+
+        // The sawtooth and square carriers have harmonics past the Nyquist
+        // frequency, so they are applied at the oversampled rate. So is the
+        // sinusoid, so switching between the carriers keeps the latency and
+        // the history of the oversamplers.
+        const auto carrier_rate = device.sampling_rate_ * Oversampler4::factor;
+
+        step_ = Oscillator::to_phase(static_cast<double>(effect_props.ring_modulator_.frequency_) / carrier_rate);
+
+        if (step_ == 0)
+        {
+            step_ = 1;
+        }
+
+        // Custom filter coeffs, which match the old version instead of a low-shelf.
+        const auto cw = std::cos(Math::tau * effect_props.ring_modulator_.high_pass_cutoff_ / device.sampling_rate_);
+        const auto a = (2.0F - cw) - std::sqrt(std::pow(2.0F - cw, 2.0F) - 1.0F);
+
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            filters_[i].b0_ = a;
+            filters_[i].b1_ = -a;
+            filters_[i].b2_ = 0.0F;
+            filters_[i].a1_ = -a;
+            filters_[i].a2_ = 0.0F;
+        }
 
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
 
-    static const float* apply_filters(
-        FilterState* lp_filter,
-        FilterState* hp_filter,
-        float* dst_samples,
-        const float* src_samples,
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                1.0F,
+                channels_gains_[i]);
+        }
+    }
+
+    void do_process(
         const int sample_count,
-        const ActiveFilters filter_type)
+        const SampleBuffers& src_samples,
+        SampleBuffers& dst_samples,
+        const int channel_count) final
     {
-        switch (filter_type)
+        for (int base = 0; base < sample_count; )
         {
-        case ActiveFilters::none:
-            lp_filter->process_pass_through(sample_count, src_samples);
-            hp_filter->process_pass_through(sample_count, src_samples);
-            break;
+            float carrier[64 * Oversampler4::factor];
+            float temps[2][64 * Oversampler4::factor];
+            const auto td = std::min(64, sample_count - base);
+            const auto carrier_count = td * Oversampler4::factor;
 
-        case ActiveFilters::low_pass:
-            lp_filter->process(sample_count, src_samples, dst_samples);
-            hp_filter->process_pass_through(sample_count, dst_samples);
-            return dst_samples;
+            phase_ = Oscillator::generate(waveform_, carrier, phase_, step_, carrier_count);
 
-        case ActiveFilters::high_pass:
-            lp_filter->process_pass_through(sample_count, src_samples);
-            hp_filter->process(sample_count, src_samples, dst_samples);
-            return dst_samples;
+            if (waveform_ == Oscillator::Waveform::sinusoid)
+            {
+                // Map onto [0, 1], starting from the trough.
+                for (int i = 0; i < carrier_count; ++i)
+                {
+                    carrier[i] = 0.5F - (0.5F * carrier[i]);
+                }
+            }
 
-        case ActiveFilters::band_pass:
-            for (int i = 0; i < sample_count; )
+            for (int j = 0; j < max_effect_channels; ++j)
             {
-                float temp[256];
+                filters_[j].process(td, &src_samples[j][base], temps[0]);
+                oversamplers_[j].upsample(td, temps[0], temps[1]);
 
-                const auto todo = std::min(256, sample_count - i);
+                for (int i = 0; i < carrier_count; ++i)
+                {
+                    temps[1][i] *= carrier[i];
+                }
 
-                lp_filter->process(todo, src_samples + i, temp);
-                hp_filter->process(todo, temp, dst_samples + i);
+                oversamplers_[j].downsample(td, temps[1], temps[0]);
 
-                i += todo;
-            }
+                for (int k = 0; k < channel_count; ++k)
+                {
+                    const auto gain = channels_gains_[j][k];
 
-            return dst_samples;
-        }
+                    if (!(std::abs(gain) > silence_threshold_gain))
+                    {
+                        continue;
+                    }
 
-        return src_samples;
-    }
+                    Kernels::current.mix_(temps[0], &dst_samples[k][base], gain, td);
+                }
+            }
 
-    bool calc_effect_slot_params(
-        EffectSlot& effect_slot)
-    {
-        if (!effect_slot.is_props_changed_)
-        {
-            return false;
+            base += td;
         }
-
-        effect_slot.is_props_changed_ = false;
-        effect_slot.effect_state_->update(device_, effect_slot, effect_slot.effect_.props_);
-
-        return true;
     }
 
-    bool calc_source_params(
-        Source& source)
+    void do_save_state(
+        StateWriter& writer) const final
     {
-        if (!source.are_props_changed_)
+        writer.write(phase_);
+
+        for (int i = 0; i < max_effect_channels; ++i)
         {
-            return false;
+            filters_[i].save_state(writer);
+            oversamplers_[i].save_state(writer);
         }
-
-        source.are_props_changed_ = false;
-
-        return true;
     }
 
-    void calc_panning_and_filters(
-        const float distance,
-        const float* dir,
-        const float spread,
-        const float dry_gain,
-        const float dry_gain_hf,
-        const float dry_gain_lf,
-        const WetGains& wet_gain,
-        const WetGains& wet_gain_lf,
-        const WetGains& wet_gain_hf)
+    void do_load_state(
+        StateReader& reader) final
     {
-        static_cast<void>(distance);
-        static_cast<void>(dir);
-
-        const auto frequency = device_.sampling_rate_;
-        const ChannelMap* channel_map = nullptr;
-        auto channel_count = 0;
+        reader.read(phase_);
 
-        switch (device_.channel_format_)
+        for (int i = 0; i < max_effect_channels; ++i)
         {
-        case ChannelFormat::mono:
-            channel_map = mono_map;
-            channel_count = 1;
-            break;
-
-        case ChannelFormat::stereo:
-            channel_map = stereo_map;
-            channel_count = 2;
-            break;
-
-        case ChannelFormat::quad:
-            channel_map = quad_map;
-            channel_count = 4;
-            break;
+            filters_[i].load_state(reader);
+            oversamplers_[i].load_state(reader);
+        }
+    }
 
-        case ChannelFormat::five_point_one:
-            channel_map = x5_1_map;
-            channel_count = 6;
-            break;
 
-        case ChannelFormat::six_point_one:
-            channel_map = x6_1_map;
-            channel_count = 7;
-            break;
+private:
+    using ChannelsGains = std::array<Gains, max_effect_channels>;
+    using Filters = std::array<FilterState, max_effect_channels>;
+    using Oversampler4 = Oversampler<4, 16>;
+    using Oversamplers = std::array<Oversampler4, max_effect_channels>;
 
-        case ChannelFormat::seven_point_one:
-            channel_map = x7_1_map;
-            channel_count = 8;
-            break;
 
-        case ChannelFormat::none:
-        default:
-            break;
-        }
+    Oscillator::Waveform waveform_;
+    Oscillator::Phase phase_;
+    Oscillator::Phase step_;
+    ChannelsGains channels_gains_;
+    Filters filters_;
+    Oversamplers oversamplers_;
+}; // ModulatorEffectState
 
-        // Non-HRTF rendering. Use normal panning to the output.
-        for (int c = 0; c < channel_count; ++c)
-        {
-            AmbiCoeffs coeffs;
 
-            // Special-case LFE
-            if (channel_map[c].channel_id_ == ChannelId::lfe)
-            {
-                source_.direct_.channels_[c].target_gains_.fill(0.0F);
+EffectState* EffectStateFactory::create_ring_modulator()
+{
+    return create<RingModulatorEffectState>();
+}
 
-                const auto idx = device_.get_channel_index(channel_map[c].channel_id_);
 
-                if (idx != -1)
-                {
-                    source_.direct_.channels_[c].target_gains_[idx] = dry_gain;
-                }
+class ReverbEffectState :
+    public EffectState
+{
+public:
+    ReverbEffectState()
+        :
+        EffectState{},
+        is_eax_{},
+        filters_{},
+        delay_{},
+        early_delay_taps_{},
+        early_delay_coeffs_{},
+        late_feed_tap_{},
+        late_delay_taps_{},
+        ap_feed_coeff_{},
+        mix_x_{},
+        mix_y_{},
+        early_{},
+        mod_{},
+        late_{},
+        is_panned_{},
+        unpanned_gains_{},
+        quality_{},
+        fade_count_{},
+        offset_{},
+        late_offset_{},
+        filtered_samples_{},
+        reverb_samples_{},
+        early_samples_{},
+        late_frames_{},
+        half_rate_frames_{},
+        late_count_{},
+        late_mod_delays_{}
+    {
+    }
 
-                for (auto& aux : source_.auxes_)
-                {
-                    aux.channels_[c].target_gains_.fill(0.0F);
-                }
+    virtual ~ReverbEffectState()
+    {
+    }
 
-                continue;
-            }
 
-            Panning::calc_angle_coeffs(channel_map[c].angle_, channel_map[c].elevation_, spread, coeffs);
+    // The samples are processed in blocks, each in three steps:
+    // "begin_block", "late_block" and "end_block". ReverbLanes runs the late
+    // lines of many instances together in place of "late_block".
 
-            Panning::compute_panning_gains(
-                device_.channel_count_,
-                device_.dry_,
-                coeffs,
-                dry_gain,
-                source_.direct_.channels_[c].target_gains_);
+    // Gets the size of the next block out of the samples left.
+    int get_block_size(
+        const int sample_count) const
+    {
+        auto todo = std::min(sample_count, max_update_samples);
 
-            for (int i = 0; i < effect_count_; ++i)
-            {
-                Panning::compute_panning_gains_bf(
-                    max_effect_channels,
-                    coeffs,
-                    wet_gain[i],
-                    source_.auxes_[i].channels_[c].target_gains_);
-            }
+        // If cross-fading, don't do more samples than there are to fade.
+        if (fade_samples - fade_count_ > 0)
+        {
+            todo = std::min(todo, fade_samples - fade_count_);
         }
 
-        const auto hf_scale = SendProps::hp_frequency_reference / frequency;
-        const auto lf_scale = SendProps::lp_frequency_reference / frequency;
-        auto gain_hf = std::max(dry_gain_hf, 0.001F); // Limit -60dB
-        auto gain_lf = std::max(dry_gain_lf, 0.001F);
-
-        source_.direct_.filter_type_ = ActiveFilters::none;
+        return todo;
+    }
 
-        if (gain_hf != 1.0F)
+    // Feeds the block into the delay lines, generates the early reflections
+    // and reads the input of the late lines.
+    //
+    // The input is converted from B-Format to A-Format as it is fed into the
+    // delay line.
+    void begin_block(
+        const int todo,
+        const SampleBuffers& src_samples,
+        const int base)
+    {
+        // Feed the initial delay line. Use the early output lines for temp
+        // storage.
+        if (is_eax_)
         {
-            source_.direct_.filter_type_ = static_cast<ActiveFilters>(
-                static_cast<int>(source_.direct_.filter_type_) | static_cast<int>(ActiveFilters::low_pass));
+            feed_delay_line<true>(todo, src_samples, base, early_samples_);
         }
-
-        if (gain_lf != 1.0F)
+        else
         {
-            source_.direct_.filter_type_ = static_cast<ActiveFilters>(
-                static_cast<int>(source_.direct_.filter_type_) | static_cast<int>(ActiveFilters::high_pass));
+            feed_delay_line<false>(todo, src_samples, base, early_samples_);
         }
 
-        source_.direct_.channels_[0].low_pass_.set_params(
-            FilterType::high_shelf,
-            gain_hf,
-            hf_scale,
-            FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
-
-        source_.direct_.channels_[0].high_pass_.set_params(
-            FilterType::low_shelf,
-            gain_lf,
-            lf_scale,
-            FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
-
-        for (int c = 1; c < channel_count; ++c)
+        if (is_fading())
         {
-            FilterState::copy_params(source_.direct_.channels_[0].low_pass_, source_.direct_.channels_[c].low_pass_);
-            FilterState::copy_params(source_.direct_.channels_[0].high_pass_, source_.direct_.channels_[c].high_pass_);
+            early_pass<true>(todo, get_fade(), early_samples_);
+            begin_late_pass<true>(todo, get_fade());
         }
-
-        for (int i = 0; i < effect_count_; ++i)
+        else
         {
-            auto& aux = source_.auxes_[i];
-            gain_hf = std::max(wet_gain_hf[i], 0.001F);
-            gain_lf = std::max(wet_gain_lf[i], 0.001F);
+            early_pass<false>(todo, get_fade(), early_samples_);
+            begin_late_pass<false>(todo, get_fade());
+        }
+    }
 
-            aux.filter_type_ = ActiveFilters::none;
+    // Runs the late lines of the block.
+    void late_block()
+    {
+        if (late_count_ == 0)
+        {
+            return;
+        }
 
-            if (gain_hf != 1.0F)
-            {
-                aux.filter_type_ = static_cast<ActiveFilters>(
-                    static_cast<int>(aux.filter_type_) | static_cast<int>(ActiveFilters::low_pass));
-            }
+        if (is_fading())
+        {
+            run_late_lines<true>();
+        }
+        else
+        {
+            run_late_lines<false>();
+        }
+    }
 
-            if (gain_lf != 1.0F)
-            {
-                aux.filter_type_ = static_cast<ActiveFilters>(
-                    static_cast<int>(aux.filter_type_) | static_cast<int>(ActiveFilters::high_pass));
-            }
+    // Completes the late response, steps the delays forward and mixes the
+    // block to the output.
+    //
+    // The panning gains reach their targets at the end of "sample_count"
+    // samples from the start of the block.
+    void end_block(
+        const int todo,
+        const int sample_count,
+        SampleBuffers& dst_samples,
+        const int base,
+        const int channel_count)
+    {
+        end_late_pass(todo);
 
-            aux.channels_[0].low_pass_.set_params(
-                FilterType::high_shelf,
-                gain_hf,
-                hf_scale,
-                FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
+        // Step all delays forward.
+        offset_ = (offset_ + todo) & offset_mask;
 
-            aux.channels_[0].high_pass_.set_params(
-                FilterType::low_shelf,
-                gain_lf,
-                lf_scale,
-                FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
+        if (fade_count_ < fade_samples)
+        {
+            fade_count_ += todo;
 
-            for (int c = 1; c < channel_count; ++c)
+            if (fade_count_ >= fade_samples)
             {
-                FilterState::copy_params(aux.channels_[0].low_pass_, aux.channels_[c].low_pass_);
-                FilterState::copy_params(aux.channels_[0].high_pass_, aux.channels_[c].high_pass_);
+                // Update the cross-fading delay line taps.
+                fade_count_ = fade_samples;
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    early_delay_taps_[c][0] = early_delay_taps_[c][1];
+                    early_.vec_ap_.offsets_[c][0] = early_.vec_ap_.offsets_[c][1];
+                    early_.offsets_[c][0] = early_.offsets_[c][1];
+                    late_delay_taps_[c][0] = late_delay_taps_[c][1];
+                    late_.vec_ap_.offsets_[c][0] = late_.vec_ap_.offsets_[c][1];
+                    late_.offsets_[c][0] = late_.offsets_[c][1];
+                }
             }
         }
-    }
 
-    void calc_non_attn_source_params()
-    {
-        source_.direct_.buffers_ = &device_.sample_buffers_;
-        source_.direct_.channel_count_ = device_.channel_count_;
+        // Mix the A-Format results to output, implicitly converting back to
+        // B-Format.
+        const auto has_early = (quality_ != EffectProps::Reverb::quality_late_only);
+        const auto has_late = (quality_ != EffectProps::Reverb::quality_early_only);
 
-        for (int i = 0; i < effect_count_; ++i)
+        if (has_early && has_late && !is_panned_ &&
+            are_gains_reached(early_.current_gains_, early_.pan_gains_, channel_count) &&
+            are_gains_reached(late_.current_gains_, late_.pan_gains_, channel_count))
         {
-            if (effect_contexts_[i].effect_slot_.effect_.type_ == EffectType::null)
+            mix_unpanned(todo, dst_samples, base, channel_count);
+        }
+        else
+        {
+            if (has_early)
             {
-                source_.auxes_[i].buffers_ = nullptr;
-                source_.auxes_[i].channel_count_ = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    MixHelpers::mix(
+                        early_samples_[c].data(),
+                        channel_count,
+                        dst_samples,
+                        early_.current_gains_[c].data(),
+                        early_.pan_gains_[c].data(),
+                        sample_count,
+                        base,
+                        todo);
+                }
             }
-            else
+
+            if (has_late)
             {
-                source_.auxes_[i].buffers_ = &effect_contexts_[i].effect_slot_.wet_buffer_;
-                source_.auxes_[i].channel_count_ = max_effect_channels;
+                for (int c = 0; c < 4; c++)
+                {
+                    MixHelpers::mix(
+                        reverb_samples_[c].data(),
+                        channel_count,
+                        dst_samples,
+                        late_.current_gains_[c].data(),
+                        late_.pan_gains_[c].data(),
+                        sample_count,
+                        base,
+                        todo);
+                }
             }
         }
+    }
 
-        // Calculate gains
-        const auto dry_gain = std::min(source_.direct_.props_.gain_, max_mix_gain);
-        const auto dry_gain_hf = source_.direct_.props_.gain_hf_;
-        const auto dry_gain_lf = source_.direct_.props_.gain_lf_;
-
-        constexpr float dir[3] = {0.0F, 0.0F, -1.0F};
+    // Gets the number of the late frames of the block.
+    int get_late_count() const
+    {
+        return late_count_;
+    }
 
-        auto wet_gain = WetGains{};
-        auto wet_gain_hf = WetGains{};
-        auto wet_gain_lf = WetGains{};
+    bool is_fading() const
+    {
+        return fade_count_ < fade_samples;
+    }
 
-        for (int i = 0; i < effect_count_; ++i)
+    // Calculates the modulation delays of the late lines for the block, or
+    // steps the modulation over it when the reads are not modulated.
+    void calc_late_mod_delays()
+    {
+        if (is_late_modulated())
         {
-            wet_gain[i] = std::min(source_.auxes_[i].props_.gain_, max_mix_gain);
-            wet_gain_hf[i] = source_.auxes_[i].props_.gain_hf_;
-            wet_gain_lf[i] = source_.auxes_[i].props_.gain_lf_;
+            calc_modulation_delays(late_mod_delays_.data(), late_count_);
         }
+        else
+        {
+            std::fill_n(late_mod_delays_.begin(), late_count_, 0);
 
-        calc_panning_and_filters(
-            0.0F,
-            dir,
-            0.0F,
-            dry_gain,
-            dry_gain_hf,
-            dry_gain_lf,
-            wet_gain,
-            wet_gain_lf,
-            wet_gain_hf);
+            mod_.phase_ += mod_.step_ * static_cast<Oscillator::Phase>(late_count_);
+        }
     }
 
-    void update_context_sources()
+    // The late lines of the instances of ReverbLanes, which run together.
+    //
+    // The samples of the lanes are interleaved: a row holds the first line of
+    // each lane, then the second one and so on. The lanes write the same row,
+    // so a line of them is stored as a whole vector.
+    struct LateLanesLines
     {
-        auto is_props_updated = false;
+        float* late_samples_;
+        float* ap_samples_;
+        int late_mask_;
+        int ap_mask_;
+        int offset_;
+    }; // LateLanesLines
 
-        for (auto& effect_context : effect_contexts_)
-        {
-            is_props_updated |= calc_effect_slot_params(effect_context.effect_slot_);
-        }
 
-        is_props_updated |= calc_source_params(source_);
+    // Gets the quality in use.
+    int get_quality() const
+    {
+        return quality_;
+    }
 
-        if (is_props_updated)
-        {
-            calc_non_attn_source_params();
-        }
+    // Whether the late lines run at the sample rate of the device, as the
+    // ones of ReverbLanes do.
+    bool has_full_rate_late() const
+    {
+        return
+            quality_ != EffectProps::Reverb::quality_half_rate_late &&
+            quality_ != EffectProps::Reverb::quality_early_only;
     }
 
-    static void write_f32(
-        const SampleBuffers& src_buffers,
-        float* dst_buffer,
-        const int offset,
-        const int sample_count,
-        const int channel_count)
+    // Gets the masks of the late delay line and of the late all-pass line.
+    void get_late_masks(
+        int& late_mask,
+        int& ap_mask) const
     {
-        for (int j = 0; j < channel_count; ++j)
-        {
-            const auto& src_buffer = src_buffers[j];
-            auto out = &dst_buffer[(offset * channel_count) + j];
+        late_mask = late_.delay_.mask_;
+        ap_mask = late_.vec_ap_.delay_.mask_;
+    }
 
-            for (int i = 0; i < sample_count; ++i)
+#ifdef OALSFXPP_WIDE_LANES
+    // Runs the late lines of the instances together on the lines of
+    // ReverbLanes, as "late_block" does for each on its own, with the
+    // modulation delays calculated beforehand.
+    //
+    // The vectors hold one line each, with an instance in each lane, so the
+    // filters and the scattering matrices combine whole vectors. The samples
+    // of the lines are read through the gather kernel, and the frames one lane
+    // at a time. The lanes without an instance (null) run on zero
+    // coefficients.
+    template<int TLaneCount, bool TIsFaded>
+    OALSFXPP_FORCE_INLINE static void late_reverb_lanes(
+        ReverbEffectState* const* states,
+        const int count,
+        LateLanesLines& lines)
+    {
+        using Vector = FloatN<TLaneCount>;
+        using Indices = typename Vector::IntValue;
+
+        constexpr auto row_size = 4 * TLaneCount;
+        constexpr auto read_count = (TIsFaded ? 2 : 1) * row_size;
+
+        // The lanes with an instance, and where the instances keep the frames
+        // and the modulation delays.
+        int lanes[TLaneCount];
+        auto lane_count = 0;
+
+        DelayLineI::Line* lane_frames[TLaneCount];
+        const int* lane_mod_delays[TLaneCount];
+
+        auto feed_coeff = Vector::zero();
+        auto x_coeff = Vector::zero();
+        auto y_coeff = Vector::zero();
+        auto fade = Vector::zero();
+        auto fade_step = Vector::zero();
+
+        // The taps of the lines, and the indices of the lines within a row.
+        Indices late_taps[2][4];
+        Indices ap_taps[2][4];
+        Indices line_indices[4];
+
+        // The T60 damping filters of each line.
+        Vector coeffs[4][7];
+        Vector filters[4][2][2];
+
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int s = 0; s < 2; ++s)
             {
-                out[i * channel_count] = src_buffer[i];
+                late_taps[s][c] = Indices{};
+                ap_taps[s][c] = Indices{};
             }
-        }
-    }
-}; // Impl
 
-// Api::Impl
-// ==========================================================================
+            for (int lane = 0; lane < TLaneCount; ++lane)
+            {
+                line_indices[c][lane] = (c * TLaneCount) + lane;
+            }
 
+            for (int k = 0; k < 7; ++k)
+            {
+                coeffs[c][k] = Vector::zero();
+            }
 
-// ==========================================================================
-// Api
+            for (int s = 0; s < 2; ++s)
+            {
+                filters[c][s][0] = Vector::zero();
+                filters[c][s][1] = Vector::zero();
+            }
+        }
 
-struct ApiErrorMessages
-{
-    static constexpr auto NoError = "";
-    static constexpr auto AllocateImpl = "Failed to allocate implementaion class.";
-    static constexpr auto NotInitialized = "Not initialized.";
-    static constexpr auto EffectIndexOutOfRange = "Effect index is out of range.";
-    static constexpr auto NoSrcSamples = "No source samples.";
-    static constexpr auto NoDstSamples = "No destination samples.";
-}; // ApiErrorMessages
+        for (int lane = 0; lane < TLaneCount; ++lane)
+        {
+            if (!states[lane])
+            {
+                continue;
+            }
 
+            auto& state = *states[lane];
 
-Api::Api()
-    :
-    pimpl_{},
-    error_message_{ApiErrorMessages::NoError}
-{
-}
+            lanes[lane_count++] = lane;
+            lane_frames[lane] = state.get_late_frames().data();
+            lane_mod_delays[lane] = state.late_mod_delays_.data();
 
-Api::~Api()
-{
-    uninitialize();
-}
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int s = 0; s < 2; ++s)
+                {
+                    late_taps[s][c][lane] = state.late_.offsets_[c][s];
+                    ap_taps[s][c][lane] = state.late_.vec_ap_.offsets_[c][s];
+                }
+            }
 
-bool Api::initialize(
-    const ChannelFormat channel_format,
-    const int sampling_rate,
-    const int effect_count)
-{
-    uninitialize();
+            feed_coeff.v_[lane] = state.ap_feed_coeff_;
+            x_coeff.v_[lane] = state.mix_x_;
+            y_coeff.v_[lane] = state.mix_y_;
+            fade.v_[lane] = state.get_fade();
+            fade_step.v_[lane] = state.get_late_fade_step();
 
-    pimpl_.reset(new (std::nothrow) Impl{});
+            for (int c = 0; c < 4; ++c)
+            {
+                const auto& filter = state.late_.filters_[c];
 
-    if (!pimpl_)
-    {
-        error_message_ = ApiErrorMessages::AllocateImpl;
-        return false;
-    }
+                for (int k = 0; k < 3; ++k)
+                {
+                    coeffs[c][k].v_[lane] = filter.lf_coeffs_[k];
+                    coeffs[c][3 + k].v_[lane] = filter.hf_coeffs_[k];
+                }
 
-    const auto initialize_result = pimpl_->initialize(channel_format, sampling_rate, effect_count);
+                coeffs[c][6].v_[lane] = filter.mid_coeff_;
 
-    if (!initialize_result)
-    {
-        error_message_ = pimpl_->error_message_;
-        uninitialize();
-    }
+                for (int s = 0; s < 2; ++s)
+                {
+                    filters[c][s][0].v_[lane] = filter.states_[s][0];
+                    filters[c][s][1].v_[lane] = filter.states_[s][1];
+                }
+            }
+        }
 
-    return initialize_result;
-}
+        // The lanes without an instance read the ones of the first instance.
+        for (int lane = 0; lane < TLaneCount; ++lane)
+        {
+            if (!states[lane])
+            {
+                lane_frames[lane] = lane_frames[lanes[0]];
+                lane_mod_delays[lane] = lane_mod_delays[lanes[0]];
+            }
+        }
 
-bool Api::is_initialized() const
-{
-    return pimpl_ != nullptr;
-}
+        const auto one = Vector::set1(1.0F);
+        const auto late_samples = lines.late_samples_;
+        const auto ap_samples = lines.ap_samples_;
+        const auto late_mask = lines.late_mask_;
+        const auto ap_mask = lines.ap_mask_;
 
-int Api::get_sampling_rate() const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return 0;
-    }
+        auto offset = lines.offset_;
 
-    return pimpl_->device_.sampling_rate_;
-}
+        int late_indices[2][4][TLaneCount];
+        int ap_indices[2][4][TLaneCount];
+        float late_outs[2][4][TLaneCount];
+        float ap_outs[2][4][TLaneCount];
 
-ChannelFormat Api::get_channel_format() const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return ChannelFormat::none;
-    }
+        for (int i = 0; i < count; ++i)
+        {
+            // Read the lines. The reads of the samples go before their writes
+            // below, as in "late_reverb".
+            Indices mod_delays;
 
-    return pimpl_->device_.channel_format_;
-}
+            Vector::make_indices(
+                [&](const int lane)
+                {
+                    return lane_mod_delays[lane][i];
+                },
+                mod_delays);
 
-int Api::get_channel_count() const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+            const auto ap_offsets = Indices{} + offset;
+            const auto read_offsets = ap_offsets - mod_delays;
 
-    return pimpl_->device_.channel_count_;
-}
+            for (int s = 0; s < (TIsFaded ? 2 : 1); ++s)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    const Indices late_index = ((((read_offsets - late_taps[s][c]) & late_mask) * row_size) +
+                        line_indices[c]);
 
-int Api::get_effect_count() const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+                    const Indices ap_index = ((((ap_offsets - ap_taps[s][c]) & ap_mask) * row_size) +
+                        line_indices[c]);
 
-    return pimpl_->effect_count_;
-}
+                    std::memcpy(late_indices[s][c], &late_index, sizeof(Indices));
+                    std::memcpy(ap_indices[s][c], &ap_index, sizeof(Indices));
+                }
+            }
 
-bool Api::get_effect(
-    const int effect_index,
-    Effect& effect) const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+            Kernels::current.gather_(late_samples, late_indices[0][0], late_outs[0][0], 1.0F, read_count);
+            Kernels::current.gather_(ap_samples, ap_indices[0][0], ap_outs[0][0], 1.0F, read_count);
 
-    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+            const auto mu = Vector::min(fade, one);
 
-    effect = pimpl_->effect_contexts_[effect_index].effect_slot_.effect_;
+            Vector f[4];
 
-    return true;
-}
+            // Mix the input with the output from the late lines.
+            for (int c = 0; c < 4; ++c)
+            {
+                auto out = Vector::load(late_outs[0][c]);
 
-bool Api::get_deferred_effect(
-    const int effect_index,
-    Effect& effect) const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+                if (TIsFaded)
+                {
+                    out = out + ((Vector::load(late_outs[1][c]) - out) * mu);
+                }
 
-    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+                const auto frame = Vector::make(
+                    [&](const int lane)
+                    {
+                        return lane_frames[lane][i][c];
+                    });
 
-    effect = pimpl_->effect_contexts_[effect_index].deferred_effect_;
+                f[c] = frame + out;
+            }
 
-    return true;
-}
+            // Apply the T60 damping filters.
+            for (int c = 0; c < 4; ++c)
+            {
+                const auto lf = (coeffs[c][0] * f[c]) + (coeffs[c][1] * filters[c][0][0]) +
+                    (coeffs[c][2] * filters[c][0][1]);
 
-bool Api::set_effect_type(
-    const int effect_index,
-    const EffectType effect_type)
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+                filters[c][0][0] = f[c];
+                filters[c][0][1] = lf;
 
-    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+                const auto hf = (coeffs[c][3] * lf) + (coeffs[c][4] * filters[c][1][0]) +
+                    (coeffs[c][5] * filters[c][1][1]);
 
-    pimpl_->effect_contexts_[effect_index].deferred_effect_.set_type_and_defaults(effect_type);
+                filters[c][1][0] = lf;
+                filters[c][1][1] = hf;
 
-    return true;
-}
+                f[c] = coeffs[c][6] * hf;
+            }
 
-bool Api::set_effect_props(
-    const int effect_index,
-    const EffectProps& effect_props)
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+            // Apply the vector all-pass filter.
+            Vector ap_out[4];
+            Vector ap_in[4];
 
-    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+            for (int c = 0; c < 4; ++c)
+            {
+                auto out = Vector::load(ap_outs[0][c]);
 
-    pimpl_->effect_contexts_[effect_index].deferred_effect_.props_ = effect_props;
+                if (TIsFaded)
+                {
+                    out = out + ((Vector::load(ap_outs[1][c]) - out) * mu);
+                }
 
-    return true;
-}
+                ap_out[c] = out - (feed_coeff * f[c]);
+                ap_in[c] = f[c] + (feed_coeff * ap_out[c]);
+            }
 
-bool Api::set_effect(
-    const int effect_index,
-    const Effect& effect)
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+            Vector ap_scattered[4];
+            Vector late_scattered[4];
 
-    if (effect_index < 0 || effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+            scatter_lines(ap_in[0], ap_in[1], ap_in[2], ap_in[3], x_coeff, y_coeff, ap_scattered);
 
-    pimpl_->effect_contexts_[effect_index].deferred_effect_ = effect;
+            // Reverse the lines, so they feed their opposite directions, and
+            // scatter them back into the late lines.
+            scatter_lines(ap_out[3], ap_out[2], ap_out[1], ap_out[0], x_coeff, y_coeff, late_scattered);
 
-    return false;
-}
+            const auto ap_row = &ap_samples[(offset & ap_mask) * row_size];
+            const auto late_row = &late_samples[(offset & late_mask) * row_size];
 
-bool Api::get_send_props(
-    const int effect_index,
-    SendProps& send_props) const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+            for (int c = 0; c < 4; ++c)
+            {
+                ap_scattered[c].store(&ap_row[c * TLaneCount]);
+                late_scattered[c].store(&late_row[c * TLaneCount]);
+            }
 
-    if (effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+            for (int k = 0; k < lane_count; ++k)
+            {
+                const auto lane = lanes[k];
+                auto& frame = lane_frames[lane][i];
 
-    const auto& props = (
-        effect_index < 0 ?
-        pimpl_->source_.direct_.props_ :
-        pimpl_->source_.auxes_[effect_index].props_);
+                for (int c = 0; c < 4; ++c)
+                {
+                    frame[c] = ap_out[c].v_[lane];
+                }
+            }
 
-    send_props = props;
+            offset += 1;
+            fade = fade + fade_step;
+        }
 
-    return true;
-}
+        for (int k = 0; k < lane_count; ++k)
+        {
+            const auto lane = lanes[k];
+            auto& state = *states[lane];
 
-bool Api::get_deferred_send_props(
-    const int effect_index,
-    SendProps& send_props) const
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int s = 0; s < 2; ++s)
+                {
+                    state.late_.filters_[c].states_[s][0] = filters[c][s][0].v_[lane];
+                    state.late_.filters_[c].states_[s][1] = filters[c][s][1].v_[lane];
+                }
+            }
+        }
+
+        lines.offset_ = offset & offset_mask;
     }
+#endif // OALSFXPP_WIDE_LANES
 
-    if (effect_index >= pimpl_->effect_count_)
+protected:
+    void do_construct() final
     {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+        is_eax_ = false;
 
-    const auto& props = (
-        effect_index < 0 ?
-        pimpl_->source_.direct_.deferred_props_ :
-        pimpl_->source_.auxes_[effect_index].deferred_props_);
+        for (int i = 0; i < 4; ++i)
+        {
+            filters_[i].lp_.clear();
+            filters_[i].hp_.clear();
+        }
 
-    send_props = props;
+        delay_.reset();
 
-    return true;
-}
+        for (int i = 0; i < 4; ++i)
+        {
+            early_delay_taps_[i][0] = 0;
+            early_delay_taps_[i][1] = 0;
+            early_delay_coeffs_[i] = 0.0F;
+        }
 
-bool Api::set_send_props(
-    const int effect_index,
-    const SendProps& send_props)
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+        late_feed_tap_ = 0;
 
-    if (effect_index >= pimpl_->effect_count_)
-    {
-        error_message_ = ApiErrorMessages::EffectIndexOutOfRange;
-        return false;
-    }
+        for (int i = 0; i < 4; ++i)
+        {
+            late_delay_taps_[i][0] = 0;
+            late_delay_taps_[i][1] = 0;
+        }
 
-    auto& props = (
-        effect_index < 0 ?
-        pimpl_->source_.direct_.deferred_props_ :
-        pimpl_->source_.auxes_[effect_index].props_);
+        ap_feed_coeff_ = 0.0F;
+        mix_x_ = 0.0F;
+        mix_y_ = 0.0F;
 
-    props = send_props;
+        early_.vec_ap_.delay_.reset();
+        early_.delay_.reset();
 
-    return true;
-}
+        for (int i = 0; i < 4; ++i)
+        {
+            early_.vec_ap_.offsets_[i][0] = 0;
+            early_.vec_ap_.offsets_[i][1] = 0;
+            early_.offsets_[i][0] = 0;
+            early_.offsets_[i][1] = 0;
+            early_.coeffs_[i] = 0.0F;
+        }
 
-bool Api::apply_changes()
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+        mod_.phase_ = 0;
+        mod_.step_ = 0;
+        mod_.depth_ = 0.0F;
+        mod_.coeff_ = 0.0F;
+        mod_.filter_ = 0.0F;
 
-    // Effects
-    //
-    for (auto& effect_context : pimpl_->effect_contexts_)
-    {
-        effect_context.deferred_effect_.normalize();
+        late_.density_gain_ = 0.0F;
 
-        if (!Effect::are_equal(effect_context.deferred_effect_, effect_context.effect_slot_.effect_))
+        late_.delay_.reset();
+        late_.vec_ap_.delay_.reset();
+
+        for (int i = 0; i < 4; ++i)
         {
-            effect_context.effect_slot_.set_effect(pimpl_->device_, effect_context.deferred_effect_);
-        }
-    }
+            late_.offsets_[i][0] = 0;
+            late_.offsets_[i][1] = 0;
 
-    // Direct send
-    //
-    auto& source = pimpl_->source_;
-    auto& direct_send = source.direct_;
-    direct_send.deferred_props_.normalize();
+            late_.vec_ap_.offsets_[i][0] = 0;
+            late_.vec_ap_.offsets_[i][1] = 0;
 
-    if (!SendProps::are_equal(direct_send.deferred_props_, direct_send.props_))
-    {
-        source.are_props_changed_ = true;
-        direct_send.props_ = direct_send.deferred_props_;
-    }
+            for (int j = 0; j < 3; ++j)
+            {
+                late_.filters_[i].lf_coeffs_[j] = 0.0F;
+                late_.filters_[i].hf_coeffs_[j] = 0.0F;
+            }
 
-    // Aux sends
-    //
-    for (auto& aux_send : source.auxes_)
-    {
-        aux_send.deferred_props_.normalize();
+            late_.filters_[i].mid_coeff_ = 0.0F;
 
-        if (!SendProps::are_equal(aux_send.props_, aux_send.deferred_props_))
+            late_.filters_[i].states_[0][0] = 0.0F;
+            late_.filters_[i].states_[0][1] = 0.0F;
+            late_.filters_[i].states_[1][0] = 0.0F;
+            late_.filters_[i].states_[1][1] = 0.0F;
+        }
+
+        reset_late_resampler();
+
+        for (int i = 0; i < 4; ++i)
         {
-            source.are_props_changed_ = true;
+            for (int j = 0; j < max_channels; ++j)
+            {
+                early_.current_gains_[i][j] = 0.0F;
+                early_.pan_gains_[i][j] = 0.0F;
+                late_.current_gains_[i][j] = 0.0F;
+                late_.pan_gains_[i][j] = 0.0F;
+            }
         }
-    }
 
-    return true;
-}
+        is_panned_ = false;
+        clear_gains(unpanned_gains_);
+        early_.gain_ = 0.0F;
+        late_.gain_ = 0.0F;
 
-bool Api::mix(
-    const int sample_count,
-    const float* src_samples,
-    float* dst_samples)
-{
-    if (!is_initialized())
-    {
-        error_message_ = ApiErrorMessages::NotInitialized;
-        return false;
-    }
+        quality_ = EffectProps::Reverb::quality_full;
 
-    if (sample_count == 0)
-    {
-        return true;
+        fade_count_ = 0;
+        offset_ = 0;
+        late_offset_ = 0;
     }
 
-    if (!src_samples)
+    void do_destruct() final
     {
-        error_message_ = ApiErrorMessages::NoSrcSamples;
-        return false;
     }
 
-    if (!dst_samples)
+    void do_update_device(
+        Device& device) final
     {
-        error_message_ = ApiErrorMessages::NoDstSamples;
-        return false;
-    }
-
-    const auto channel_count = pimpl_->device_.channel_count_;
-
-    auto buffer_offset = 0;
-    auto remain_count = sample_count;
+        const auto frequency = device.sampling_rate_;
 
-    while (remain_count > 0)
-    {
-        const auto count = std::min(remain_count, max_sample_buffer_size);
+        // Allocate the delay lines.
+        alloc_lines(frequency);
 
-        pimpl_->mix_data(count, &src_samples[buffer_offset], &dst_samples[buffer_offset]);
+        const auto multiplier = 1.0F + line_multiplier;
 
-        buffer_offset += count * channel_count;
-        remain_count -= count;
+        // The late feed taps are set a fixed position past the latest delay tap.
+        for (int i = 0; i < 4; ++i)
+        {
+            late_feed_tap_ = static_cast<int>(
+                (EffectProps::Reverb::max_reflections_delay + (early_tap_lengths[3] * multiplier)) * frequency);
+        }
     }
 
-    return true;
-}
-
-void Api::uninitialize()
-{
-    pimpl_ = nullptr;
-}
+    void do_update(
+        Device& device,
+        const EffectSlot& effect_slot,
+        const EffectProps& effect_props) final
+    {
+        if (effect_slot.effect_.type_ == EffectType::eax_reverb)
+        {
+            is_eax_ = true;
+        }
+        else if (effect_slot.effect_.type_ == EffectType::reverb)
+        {
+            is_eax_ = false;
+        }
 
-const char* Api::get_error_message() const
-{
-    return pimpl_->error_message_;
-}
+        const auto frequency = device.sampling_rate_;
 
-int Api::get_min_channels()
-{
-    return 1;
-}
+        // Reallocate the delay lines when the quality changes the set in use.
+        if (effect_props.reverb_.quality_ != quality_)
+        {
+            quality_ = effect_props.reverb_.quality_;
 
-int Api::get_max_channels()
-{
-    return max_channels;
-}
+            alloc_lines(frequency);
+        }
 
-int Api::get_min_sampling_rate()
-{
-    return min_sampling_rate;
-}
+        const auto late_frequency = get_late_frequency(frequency);
 
-int Api::get_max_sampling_rate()
-{
-    return max_sampling_rate;
-}
+        // Calculate the modulation filter coefficient.  Notice that the exponent
+        // is calculated given the current sample rate.  This ensures that the
+        // resulting filter response over time is consistent across all sample
+        // rates.
+        mod_.coeff_ = std::pow(modulation_filter_coeff, modulation_filter_const / late_frequency);
 
-int Api::get_min_effects()
-{
-    return min_effects;
-}
+        // Calculate the master filters
+        const auto hf_scale = effect_props.reverb_.hf_reference_ / frequency;
 
-int Api::get_max_effects()
-{
-    return max_effects;
-}
+        // Restrict the filter gains from going below -60dB to keep the filter from
+        // killing most of the signal.
+        const auto gain_hf = std::max(effect_props.reverb_.gain_hf_, 0.001F);
 
-ChannelFormat Api::channel_count_to_channel_format(
-    const int channel_count)
-{
-    switch (channel_count)
-    {
-    case 1:
-        return ChannelFormat::mono;
+        filters_[0].lp_.set_params(
+            FilterType::high_shelf,
+            gain_hf,
+            hf_scale,
+            FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
 
-    case 2:
-        return ChannelFormat::stereo;
+        const auto lf_scale = effect_props.reverb_.lf_reference_ / frequency;
 
-    case 4:
-        return ChannelFormat::quad;
+        const auto gain_lf = std::max(effect_props.reverb_.gain_lf_, 0.001F);
 
-    case 6:
-        return ChannelFormat::five_point_one;
+        filters_[0].hp_.set_params(
+            FilterType::low_shelf,
+            gain_lf,
+            lf_scale,
+            FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
 
-    case 7:
-        return ChannelFormat::six_point_one;
+        for (int i = 1; i < 4; ++i)
+        {
+            FilterState::copy_params(filters_[0].lp_, filters_[i].lp_);
+            FilterState::copy_params(filters_[0].hp_, filters_[i].hp_);
+        }
 
-    case 8:
-        return ChannelFormat::seven_point_one;
+        // Update the main effect delay and associated taps.
+        update_delay_line(
+            effect_props.reverb_.reflections_delay_,
+            effect_props.reverb_.late_reverb_delay_,
+            effect_props.reverb_.density_,
+            effect_props.reverb_.decay_time_,
+            frequency);
 
-    default:
-        return ChannelFormat::none;
-    }
-}
+        // Calculate the all-pass feed-back/forward coefficient.
+        ap_feed_coeff_ = std::sqrt(0.5F) * std::pow(effect_props.reverb_.diffusion_, 2.0F);
 
-int Api::channel_format_to_channel_count(
-    const ChannelFormat channel_format)
-{
-    return Device::channel_format_to_channel_count(channel_format);
-}
+        // Update the early lines.
+        update_early_lines(effect_props.reverb_.density_, effect_props.reverb_.decay_time_, frequency);
 
-// Api
-// ==========================================================================
+        // Get the mixing matrix coefficients.
+        calc_matrix_coeffs(effect_props.reverb_.diffusion_, &mix_x_, &mix_y_);
 
+        // If the HF limit parameter is flagged, calculate an appropriate limit
+        // based on the air absorption parameter.
+        auto hf_ratio = effect_props.reverb_.decay_hf_ratio_;
 
-// ==========================================================================
-// Effects
+        if (effect_props.reverb_.decay_hf_limit_ && effect_props.reverb_.air_absorption_gain_hf_ < 1.0F)
+        {
+            hf_ratio = calc_limited_hf_ratio(
+                hf_ratio,
+                effect_props.reverb_.air_absorption_gain_hf_,
+                effect_props.reverb_.decay_time_);
+        }
 
-class NullEffectState :
-    public EffectState
-{
-public:
-    NullEffectState()
-        :
-        EffectState{}
-    {
-    }
+        // Calculate the LF/HF decay times.
+        const auto lf_decay_time = Math::clamp(
+            effect_props.reverb_.decay_time_ * effect_props.reverb_.decay_lf_ratio_,
+            EffectProps::Reverb::min_decay_time,
+            EffectProps::Reverb::max_decay_time);
 
-    virtual ~NullEffectState()
-    {
-    }
+        const auto hf_decay_time = Math::clamp(
+            effect_props.reverb_.decay_time_ * hf_ratio,
+            EffectProps::Reverb::min_decay_time,
+            EffectProps::Reverb::max_decay_time);
 
+        // Update the modulator line.
+        update_modulator(effect_props.reverb_.modulation_time_, effect_props.reverb_.modulation_depth_, late_frequency);
 
-protected:
-    void do_construct() final
-    {
-    }
+        // The T60 filters run at the rate of the late lines.  Keep their
+        // reference below the Nyquist frequency of the reduced rate.
+        const auto late_lf_scale = effect_props.reverb_.lf_reference_ / late_frequency;
+        const auto late_hf_scale = std::min(effect_props.reverb_.hf_reference_ / late_frequency, max_late_hf_scale);
 
-    void do_destruct() final
-    {
-    }
+        // Update the late lines.
+        update_late_lines(
+            effect_props.reverb_.density_,
+            effect_props.reverb_.diffusion_,
+            lf_decay_time,
+            effect_props.reverb_.decay_time_,
+            hf_decay_time,
+            Math::tau * late_lf_scale,
+            Math::tau * late_hf_scale,
+            effect_props.reverb_.echo_time_,
+            effect_props.reverb_.echo_depth_,
+            late_frequency);
 
-    void do_update_device(
-        Device& device) final
-    {
-        static_cast<void>(device);
-    }
+        // Update early and late 3D panning.
+        update_3d_panning(
+            device,
+            effect_props.reverb_.reflections_pan_.data(),
+            effect_props.reverb_.late_reverb_pan_.data(),
+            effect_props.reverb_.gain_,
+            effect_props.reverb_.reflections_gain_,
+            effect_props.reverb_.late_reverb_gain_);
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
-    {
-        static_cast<void>(device);
-        static_cast<void>(effect_slot);
-        static_cast<void>(effect_props);
+        // Determine if delay-line cross-fading is required.
+        for (int i = 0; i < 4; ++i)
+        {
+            if (early_delay_taps_[i][1] != early_delay_taps_[i][0] ||
+                early_.vec_ap_.offsets_[i][1] != early_.vec_ap_.offsets_[i][0] ||
+                early_.offsets_[i][1] != early_.offsets_[i][0] ||
+                late_delay_taps_[i][1] != late_delay_taps_[i][0] ||
+                late_.vec_ap_.offsets_[i][1] != late_.vec_ap_.offsets_[i][0] ||
+                late_.offsets_[i][1] != late_.offsets_[i][0])
+            {
+                fade_count_ = 0;
+                break;
+            }
+        }
     }
 
     void do_process(
@@ -3650,3951 +13034,4357 @@ protected:
         SampleBuffers& dst_samples,
         const int channel_count) final
     {
-        static_cast<void>(sample_count);
-        static_cast<void>(src_samples);
-        static_cast<void>(dst_samples);
-        static_cast<void>(channel_count);
-    }
-}; // NullEffectState
-
-
-EffectState* EffectStateFactory::create_null()
-{
-    return create<NullEffectState>();
-}
+        for (int base = 0; base < sample_count; )
+        {
+            const auto todo = get_block_size(sample_count - base);
 
+            begin_block(todo, src_samples, base);
+            late_block();
+            end_block(todo, sample_count - base, dst_samples, base, channel_count);
 
-class ChorusEffectState :
-    public EffectState
-{
-public:
-    ChorusEffectState()
-        :
-        EffectState{},
-        sample_buffers_{},
-        buffer_length_{},
-        offset_{},
-        lfo_range_{},
-        lfo_scale_{},
-        lfo_disp_{},
-        sides_gains_{},
-        waveform_{},
-        delay_{},
-        depth_{},
-        feedback_{}
-    {
+            base += todo;
+        }
     }
 
-    virtual ~ChorusEffectState()
+    void do_save_state(
+        StateWriter& writer) const final
     {
-    }
+        writer.write(fade_count_);
+        writer.write(offset_);
+        writer.write(late_offset_);
 
+        for (const auto& filter : filters_)
+        {
+            filter.lp_.save_state(writer);
+            filter.hp_.save_state(writer);
+        }
 
-protected:
-    void do_construct() final
-    {
-        buffer_length_ = 0;
+        // The taps being faded from, along with the ones being faded to.
+        writer.write(early_delay_taps_);
+        writer.write(late_delay_taps_);
+        writer.write(early_.vec_ap_.offsets_);
+        writer.write(early_.offsets_);
+        writer.write(late_.vec_ap_.offsets_);
+        writer.write(late_.offsets_);
 
-        for (auto& buffer : sample_buffers_)
+        writer.write(mod_.phase_);
+        writer.write(mod_.filter_);
+
+        for (const auto& filter : late_.filters_)
         {
-            buffer = SampleBuffer{};
+            writer.write(filter.states_);
         }
 
-        offset_ = 0;
-        lfo_range_ = 1;
-        waveform_ = Waveform::triangle;
+        writer.write(early_.current_gains_);
+        writer.write(late_.current_gains_);
+
+        writer.write(late_.input_carry_);
+        writer.write(late_.output_last_);
+        writer.write(late_.output_pending_);
+        writer.write(late_.has_input_carry_);
+        writer.write(late_.has_output_pending_);
+
+        delay_.save_state(writer);
+        early_.vec_ap_.delay_.save_state(writer);
+        early_.delay_.save_state(writer);
+        late_.vec_ap_.delay_.save_state(writer);
+        late_.delay_.save_state(writer);
     }
 
-    void do_destruct() final
+    void do_load_state(
+        StateReader& reader) final
     {
-        for (auto& buffer : sample_buffers_)
+        reader.read_index(fade_count_, fade_samples + 1);
+        reader.read_index(offset_, offset_mask + 1);
+        reader.read_index(late_offset_, offset_mask + 1);
+
+        for (auto& filter : filters_)
         {
-            buffer = SampleBuffer{};
+            filter.lp_.load_state(reader);
+            filter.hp_.load_state(reader);
         }
-    }
 
-    void do_update_device(
-        Device& device) final
-    {
-        auto max_len = static_cast<int>(EffectProps::Chorus::max_delay * 2.0F * device.sampling_rate_) + 1;
+        reader.read(early_delay_taps_);
+        reader.read(late_delay_taps_);
+        reader.read(early_.vec_ap_.offsets_);
+        reader.read(early_.offsets_);
+        reader.read(late_.vec_ap_.offsets_);
+        reader.read(late_.offsets_);
 
-        max_len = Math::next_power_of_2(max_len);
+        reader.read(mod_.phase_);
+        reader.read(mod_.filter_);
 
-        if (max_len != buffer_length_)
+        for (auto& filter : late_.filters_)
         {
-            sample_buffers_[0].resize(max_len);
-            sample_buffers_[1].resize(max_len);
-
-            buffer_length_ = max_len;
+            reader.read(filter.states_);
         }
 
-        for (auto& buffer : sample_buffers_)
-        {
-            std::fill(buffer.begin(), buffer.end(), 0.0F);
-        }
+        reader.read(early_.current_gains_);
+        reader.read(late_.current_gains_);
+
+        reader.read(late_.input_carry_);
+        reader.read(late_.output_last_);
+        reader.read(late_.output_pending_);
+        reader.read(late_.has_input_carry_);
+        reader.read(late_.has_output_pending_);
+
+        // The line lengths follow from the sampling rate and the quality.
+        delay_.load_state(reader);
+        early_.vec_ap_.delay_.load_state(reader);
+        early_.delay_.load_state(reader);
+        late_.vec_ap_.delay_.load_state(reader);
+        late_.delay_.load_state(reader);
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
-    {
-        static_cast<void>(effect_slot);
 
-        const auto frequency = static_cast<float>(device.sampling_rate_);
+private:
+    static constexpr auto speed_of_sound_mps = 343.3F;
 
-        switch (effect_props.chorus_.waveform_)
-        {
-        case EffectProps::Chorus::waveform_triangle:
-            waveform_ = Waveform::triangle;
-            break;
+    // Target gain for the reverb decay feedback reaching the decay time.
+    static constexpr auto reverb_decay_gain = 0.001F; // -60 dB
 
-        case EffectProps::Chorus::waveform_sinusoid:
-            waveform_ = Waveform::sinusoid;
-            break;
-        }
+    // This is the maximum number of samples processed for each inner loop
+    // iteration.
+    static constexpr auto max_update_samples = 256;
 
-        feedback_ = effect_props.chorus_.feedback_;
-        delay_ = static_cast<int>(effect_props.chorus_.delay_ * frequency);
+    // The number of samples used for cross-faded delay lines.  This can be used
+    // to balance the compensation for abrupt line changes and attenuation due to
+    // minimally lengthed recursive lines.  Try to keep this below the device
+    // update size.
+    static constexpr auto fade_samples = 128;
 
-        // The LFO depth is scaled to be relative to the sample delay.
-        depth_ = effect_props.chorus_.depth_ * delay_;
+    // The write offsets wrap at a multiple of every line length, well before
+    // they would overflow.
+    static constexpr auto offset_mask = (1 << 30) - 1;
 
-        AmbiCoeffs coeffs;
 
-        // Gains for left and right sides
-        Panning::calc_angle_coeffs(-Math::pi_2, 0.0F, 0.0F, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[0]);
-        Panning::calc_angle_coeffs(Math::pi_2, 0.0F, 0.0F, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[1]);
+    using ChannelsGains = std::array<Gains, 4>;
 
-        const auto phase = effect_props.chorus_.phase_;
-        const auto rate = effect_props.chorus_.rate_;
 
-        if (!(rate > 0.0F))
+    struct DelayLineI
+    {
+        using Line = std::array<float, 4>;
+        using Lines = ZeroedBuffer<Line>;
+
+        // The delay lines use interleaved samples, with the lengths being powers
+        // of 2 to allow the use of bit-masking instead of a modulus for wrapping.
+        int mask_;
+        Lines lines_;
+
+        // The span of the offsets written since the lines were silenced, so
+        // that silencing them again clears just that span.
+        bool is_written_;
+        int written_begin_;
+        int written_end_;
+
+
+        int get_sample_count() const
         {
-            lfo_scale_ = 0.0F;
-            lfo_range_ = 1;
-            lfo_disp_ = 0;
+            return (mask_ > 0 ? mask_ + 1 : 0);
         }
-        else
+
+        void reset()
         {
-            // Calculate LFO coefficient
-            lfo_range_ = static_cast<int>(frequency / rate + 0.5F);
+            mask_ = 0;
+            lines_.release();
+            is_written_ = false;
+        }
 
-            switch (waveform_)
+        void initialize(
+            const int sample_count)
+        {
+            if (sample_count == get_sample_count())
             {
-            case Waveform::triangle:
-                lfo_scale_ = 4.0F / lfo_range_;
-                break;
+                clear();
+                return;
+            }
 
-            case Waveform::sinusoid:
-                lfo_scale_ = Math::tau / lfo_range_;
-                break;
+            reset();
+
+            mask_ = sample_count - 1;
+            lines_.reset(sample_count);
+        }
+
+        void clear()
+        {
+            if (!is_written_)
+            {
+                return;
             }
 
-            // Calculate lfo phase displacement
-            if (phase >= 0)
+            lines_.clear_before(written_end_ & mask_, written_end_ - written_begin_);
+            is_written_ = false;
+        }
+
+        // Marks the block of the offsets written by a pass.
+        void mark_written(
+            const int offset,
+            const int count)
+        {
+            if (count <= 0)
+            {
+                return;
+            }
+
+            if (!is_written_)
             {
-                lfo_disp_ = static_cast<int>(lfo_range_ * (phase / 360.0F));
+                is_written_ = true;
+                written_begin_ = offset;
+                written_end_ = offset + count;
             }
             else
             {
-                lfo_disp_ = static_cast<int>(lfo_range_ * ((360 + phase) / 360.0F));
+                written_begin_ = std::min(written_begin_, offset);
+                written_end_ = std::max(written_end_, offset + count);
             }
         }
-    }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
-    {
-        auto& left_buf = sample_buffers_[0];
-        auto& right_buf = sample_buffers_[1];
-        const auto buf_mask = buffer_length_ - 1;
+        // The lines are saved as one run of interleaved samples.
+        void save_state(
+            StateWriter& writer) const
+        {
+            static_assert(sizeof(Line) == (4 * sizeof(float)), "Expected packed frames.");
 
-        for (int base = 0; base < sample_count; )
+            writer.write_samples(lines_.is_empty() ? nullptr : lines_.get_data()->data(), 4 * get_sample_count());
+        }
+
+        void load_state(
+            StateReader& reader)
         {
-            float temps[128][2];
-            int mod_delays[2][128];
-            const auto todo = std::min(128, sample_count - base);
+            reader.read_samples(lines_.is_empty() ? nullptr : lines_.get_data()->data(), 4 * get_sample_count());
 
-            switch (waveform_)
+            if (!reader.is_validating())
             {
-            case Waveform::triangle:
-                get_triangle_delays(
-                    mod_delays[0],
-                    offset_ % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+                is_written_ = true;
+                written_begin_ = 0;
+                written_end_ = get_sample_count();
+            }
+        }
+    }; // DelayLineI
 
-                get_triangle_delays(
-                    mod_delays[1],
-                    (offset_ + lfo_disp_) % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+    struct VecAllpass
+    {
+        using Offsets = MdArray<int, 4, 2>;
 
-                break;
+        DelayLineI delay_;
+        Offsets offsets_;
+    }; // VecAllpass
 
-            case Waveform::sinusoid:
-                get_sinusoid_delays(
-                    mod_delays[0],
-                    offset_ % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+    struct Filter
+    {
+        FilterState lp_;
+        FilterState hp_; // EAX only
+    }; // FilterProps
 
-                get_sinusoid_delays(
-                    mod_delays[1],
-                    (offset_ + lfo_disp_) % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+    using Filters = std::array<Filter, 4>;
 
-                break;
-            }
+    struct Early
+    {
+        using Offsets = MdArray<int, 4, 2>;
+        using Coeffs = std::array<float, 4>;
 
-            for (int i = 0; i < todo; ++i)
-            {
-                left_buf[offset_ & buf_mask] = src_samples[0][base + i];
-                temps[i][0] = left_buf[(offset_ - mod_delays[0][i]) & buf_mask] * feedback_;
-                left_buf[offset_ & buf_mask] += temps[i][0];
+        // A Gerzon vector all-pass filter is used to simulate initial
+        // diffusion.  The spread from this filter also helps smooth out the
+        // reverb tail.
+        //
+        VecAllpass vec_ap_;
 
-                right_buf[offset_ & buf_mask] = src_samples[0][base + i];
-                temps[i][1] = right_buf[(offset_ - mod_delays[1][i]) & buf_mask] * feedback_;
-                right_buf[offset_ & buf_mask] += temps[i][1];
+        // An echo line is used to complete the second half of the early
+        // reflections.
+        //
+        DelayLineI delay_;
+        Offsets offsets_;
+        Coeffs coeffs_;
 
-                offset_ += 1;
-            }
+        // The gain for each output channel based on 3D panning.
+        ChannelsGains current_gains_;
+        ChannelsGains pan_gains_;
 
-            for (int c = 0; c < channel_count; ++c)
-            {
-                auto channel_gain = sides_gains_[0][c];
+        // The gain relative to the unpanned gains.
+        float gain_;
+    }; // Early
 
-                if (std::abs(channel_gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < todo; ++i)
-                    {
-                        dst_samples[c][i + base] += temps[i][0] * channel_gain;
-                    }
-                }
+    struct Mod
+    {
+        // The vibrato time is tracked with a wrapping phase accumulator.
+        //
+        Oscillator::Phase phase_;
+        Oscillator::Phase step_;
 
-                channel_gain = sides_gains_[1][c];
+        // The depth of frequency change (also in samples) and its filter.
+        float depth_;
+        float coeff_;
+        float filter_;
+    }; // Mod
 
-                if (std::abs(channel_gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < todo; ++i)
-                    {
-                        dst_samples[c][i + base] += temps[i][1] * channel_gain;
-                    }
-                }
-            }
+    struct Late
+    {
+        struct Filter
+        {
+            using Coeffs = std::array<float, 3>;
+            using States = MdArray<float, 2, 2>;
 
-            base += todo;
-        }
-    }
+            Coeffs lf_coeffs_;
+            Coeffs hf_coeffs_;
+            float mid_coeff_;
+
+            // The LF and HF filters keep a state of the last input and last
+            // output sample.
+            States states_;
+        }; // FilterProps
+
+        using Filters = std::array<Filter, 4>;
+        using Offsets = MdArray<int, 4, 2>;
+
+
+        // Attenuation to compensate for the modal density and decay rate of
+        // the late lines.
+        //
+        float density_gain_;
+
+        // A recursive delay line is used fill in the reverb tail.
+        DelayLineI delay_;
+        Offsets offsets_;
+
+        // T60 decay filters are used to simulate absorption.
+        Filters filters_;
+
+        // A Gerzon vector all-pass filter is used to simulate diffusion.
+        VecAllpass vec_ap_;
+
+        // The gain for each output channel based on 3D panning.
+        ChannelsGains current_gains_;
+        ChannelsGains pan_gains_;
+
+        // The gain relative to the unpanned gains.
+        float gain_;
+
+        // With the half rate quality, the input is decimated by averaging
+        // pairs of frames, and the output is linearly interpolated back.  An
+        // odd frame of input is carried to the next update, and so is the
+        // second half of the last output frame otherwise.
+        DelayLineI::Line input_carry_;
+        DelayLineI::Line output_last_;
+        DelayLineI::Line output_pending_;
+        bool has_input_carry_;
+        bool has_output_pending_;
+    }; // Late
+
+    using Taps = MdArray<int, 4, 2>;
+
+    using SamplesPerChannel = std::array<float, max_update_samples>;
+    using Samples = std::array<SamplesPerChannel, 4>;
+    using Coeffs = std::array<float, 4>;
+
+    // Interleaved samples of the four lines.
+    using Frames = std::array<DelayLineI::Line, max_update_samples>;
+
+    using ModDelays = std::array<int, max_update_samples>;
 
 
-private:
-    enum class Waveform
-    {
-        triangle = EffectProps::Chorus::waveform_triangle,
-        sinusoid = EffectProps::Chorus::waveform_sinusoid
-    }; // Waveform
+    bool is_eax_;
 
+    // Master effect filters
+    Filters filters_;
 
-    using SampleBuffer = EffectSampleBuffer;
-    using SampleBuffers = std::array<SampleBuffer, 2>;
+    // Core delay line (early reflections and late reverb tap from this).
+    DelayLineI delay_;
 
-    using SidesGains = std::array<Gains, 2>;
+    // Tap points for early reflection delay.
+    Taps early_delay_taps_;
+    Coeffs early_delay_coeffs_;
 
+    // Tap points for late reverb feed and delay.
+    int late_feed_tap_;
+    Taps late_delay_taps_;
 
-    SampleBuffers sample_buffers_;
-    int buffer_length_;
-    int offset_;
-    int lfo_range_;
-    float lfo_scale_;
-    int lfo_disp_;
+    // The feed-back and feed-forward all-pass coefficient.
+    float ap_feed_coeff_;
 
-    // Gains for left and right sides
-    SidesGains sides_gains_;
+    // Coefficients for the all-pass and line scattering matrices.
+    float mix_x_;
+    float mix_y_;
 
-    // effect parameters
-    Waveform waveform_;
-    int delay_;
-    float depth_;
-    float feedback_;
+    Early early_;
+    Mod mod_; // EAX only
+    Late late_;
 
+    // With neither the early nor the late response panned, both share the
+    // gains of the A-Format to B-Format conversion.
+    bool is_panned_;
+    ChannelsGains unpanned_gains_;
 
-    static void get_triangle_delays(
-        int* delays,
-        int offset,
-        const int lfo_range,
-        const float lfo_scale,
-        const float depth,
-        const int delay,
-        const int todo)
-    {
-        for (int i = 0; i < todo; ++i)
-        {
-            delays[i] = static_cast<int>((1.0F - std::abs(2.0F - (lfo_scale * offset))) * depth) + delay;
-            offset = (offset + 1) % lfo_range;
-        }
-    }
+    // The processing quality (EffectProps::Reverb::quality_*).
+    int quality_;
 
-    static void get_sinusoid_delays(
-        int* delays,
-        int offset,
-        const int lfo_range,
-        const float lfo_scale,
-        const float depth,
-        const int delay,
-        const int todo)
-    {
-        for (int i = 0; i < todo; ++i)
-        {
-            delays[i] = static_cast<int>(std::sin(lfo_scale * offset) * depth) + delay;
-            offset = (offset + 1) % lfo_range;
-        }
-    }
-}; // ChorusEffectState
+    // Indicates the cross-fade point for delay line reads [0,FADE_SAMPLES].
+    int fade_count_;
 
+    // The current write offset for the main and the early delay lines.
+    int offset_;
 
-EffectState* EffectStateFactory::create_chorus()
-{
-    return create<ChorusEffectState>();
-}
+    // The current write offset for the late delay lines.
+    int late_offset_;
 
+    // Temporary storage used when processing.
+    Samples filtered_samples_;
+    Samples reverb_samples_;
+    Samples early_samples_;
 
-class CompressorEffectState :
-    public EffectState
-{
-public:
-    CompressorEffectState()
-        :
-        EffectState{},
-        channels_gains_{},
-        is_enabled_{},
-        attack_rate_{},
-        release_rate_{},
-        gain_control_{}
-    {
-    }
+    // The input and the output of the late lines for the block, and their
+    // frames at the half rate.
+    Frames late_frames_;
+    Frames half_rate_frames_;
+    int late_count_;
 
-    virtual ~CompressorEffectState()
-    {
-    }
+    // The modulation delays of the late lines, for ReverbLanes.
+    ModDelays late_mod_delays_;
 
 
-protected:
-    void do_construct() final
-    {
-        is_enabled_ = true;
-        attack_rate_ = 0.0F;
-        release_rate_ = 0.0F;
-        gain_control_ = 1.0F;
-    }
+    // The B-Format to A-Format conversion matrix. The arrangement of rows is
+    // deliberately chosen to align the resulting lines to their spatial opposites
+    // (0:above front left <-> 3:above back right, 1:below front right <-> 2:below
+    // back left). It's not quite opposite, since the A-Format results in a
+    // tetrahedron, but it's close enough. Should the model be extended to 8-lines
+    // in the future, true opposites can be used.
+    static constexpr Mat4F b2a =
+    {{
+        {0.288675134595F,  0.288675134595F,  0.288675134595F,  0.288675134595F,},
+        {0.288675134595F, -0.288675134595F, -0.288675134595F,  0.288675134595F,},
+        {0.288675134595F,  0.288675134595F, -0.288675134595F, -0.288675134595F,},
+        {0.288675134595F, -0.288675134595F,  0.288675134595F, -0.288675134595F,},
+    }};
 
-    void do_destruct() final
-    {
-    }
+    // Converts A-Format to B-Format.
+    static constexpr Mat4F a2b =
+    {{
+        {0.866025403785F,  0.866025403785F,  0.866025403785F,  0.866025403785F,},
+        {0.866025403785F, -0.866025403785F,  0.866025403785F, -0.866025403785F,},
+        {0.866025403785F, -0.866025403785F, -0.866025403785F,  0.866025403785F,},
+        {0.866025403785F,  0.866025403785F, -0.866025403785F, -0.866025403785F,},
+    }};
 
-    void do_update_device(
-        Device& device) final
-    {
-        const auto attackTime = device.sampling_rate_ * 0.2F; // 200ms Attack
-        const auto releaseTime = device.sampling_rate_ * 0.4F; // 400ms Release
+    static constexpr auto fade_step = 1.0F / fade_samples;
 
-        attack_rate_ = 1.0F / attackTime;
-        release_rate_ = 1.0F / releaseTime;
-    }
+    // The all-pass and delay lines have a variable length dependent on the
+    // effect's density parameter.  The resulting density multiplier is:
+    //
+    //     multiplier = 1 + (density * LINE_MULTIPLIER)
+    //
+    // Thus the line multiplier below will result in a maximum density multiplier
+    // of 10.
+    static constexpr auto line_multiplier = 9.0F;
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+    // All delay line lengths are specified in seconds.
+    //
+    // To approximate early reflections, we break them up into primary (those
+    // arriving from the same direction as the source) and secondary (those
+    // arriving from the opposite direction).
+    //
+    // The early taps decorrelate the 4-channel signal to approximate an average
+    // room response for the primary reflections after the initial early delay.
+    //
+    // Given an average room dimension (d_a) and the speed of sound (c) we can
+    // calculate the average reflection delay (r_a) regardless of listener and
+    // source positions as:
+    //
+    //     r_a = d_a / c
+    //     c   = 343.3
+    //
+    // This can extended to finding the average difference (r_d) between the
+    // maximum (r_1) and minimum (r_0) reflection delays:
+    //
+    //     r_0 = 2 / 3 r_a
+    //         = r_a - r_d / 2
+    //         = r_d
+    //     r_1 = 4 / 3 r_a
+    //         = r_a + r_d / 2
+    //         = 2 r_d
+    //     r_d = 2 / 3 r_a
+    //         = r_1 - r_0
+    //
+    // As can be determined by integrating the 1D model with a source (s) and
+    // listener (l) positioned across the dimension of length (d_a):
+    //
+    //     r_d = int_(l=0)^d_a (int_(s=0)^d_a |2 d_a - 2 (l + s)| ds) dl / c
+    //
+    // The initial taps (T_(i=0)^N) are then specified by taking a power series
+    // that ranges between r_0 and half of r_1 less r_0:
+    //
+    //     R_i = 2^(i / (2 N - 1)) r_d
+    //         = r_0 + (2^(i / (2 N - 1)) - 1) r_d
+    //         = r_0 + T_i
+    //     T_i = R_i - r_0
+    //         = (2^(i / (2 N - 1)) - 1) r_d
+    //
+    // Assuming an average of 5m (up to 50m with the density multiplier), we get
+    // the following taps:
+    static constexpr float early_tap_lengths[4] =
     {
-        static_cast<void>(effect_slot);
-
-        is_enabled_ = effect_props.compressor_.on_off_;
+        0.000000E+0F, 1.010676E-3F, 2.126553E-3F, 3.358580E-3F,
+    };
 
-        dst_buffers_ = &device.sample_buffers_;
-        dst_channel_count_ = device.channel_count_;
+    // The early all-pass filter lengths are based on the early tap lengths:
+    //
+    //     A_i = R_i / a
+    //
+    // Where a is the approximate maximum all-pass cycle limit (20).
+    //
+    static constexpr float early_allpass_lengths[4] =
+    {
+        4.854840E-4F, 5.360178E-4F, 5.918117E-4F, 6.534130E-4F,
+    };
 
-        for (int i = 0; i < 4; ++i)
-        {
-            Panning::compute_first_order_gains(
-                device.channel_count_,
-                device.foa_,
-                mat4f_identity.m_[i],
-                1.0F,
-                channels_gains_[i]);
-        }
-    }
+    // The early delay lines are used to transform the primary reflections into
+    // the secondary reflections.  The A-format is arranged in such a way that
+    // the channels/lines are spatially opposite:
+    //
+    //     C_i is opposite C_(N-i-1)
+    //
+    // The delays of the two opposing reflections (R_i and O_i) from a source
+    // anywhere along a particular dimension always sum to twice its full delay:
+    //
+    //     2 r_a = R_i + O_i
+    //
+    // With that in mind we can determine the delay between the two reflections
+    // and thus specify our early line lengths (L_(i=0)^N) using:
+    //
+    //     O_i = 2 r_a - R_(N-i-1)
+    //     L_i = O_i - R_(N-i-1)
+    //         = 2 (r_a - R_(N-i-1))
+    //         = 2 (r_a - T_(N-i-1) - r_0)
+    //         = 2 r_a (1 - (2 / 3) 2^((N - i - 1) / (2 N - 1)))
+    //
+    // Using an average dimension of 5m, we get:
+    static constexpr float early_line_lengths[4] =
+    {
+        2.992520E-3F, 5.456575E-3F, 7.688329E-3F, 9.709681E-3F,
+    };
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+    // The late all-pass filter lengths are based on the late line lengths:
+    //
+    //     A_i = (5 / 3) L_i / r_1
+    //
+    static constexpr float late_allpass_lengths[4] =
     {
-        for (int base = 0; base < sample_count; )
-        {
-            float temps[64][4];
+        8.091400E-4F, 1.019453E-3F, 1.407968E-3F, 1.618280E-3F,
+    };
 
-            const auto td = std::min(64, sample_count - base);
+    // The late lines are used to approximate the decaying cycle of recursive
+    // late reflections.
+    //
+    // Splitting the lines in half, we start with the shortest reflection paths
+    // (L_(i=0)^(N/2)):
+    //
+    //     L_i = 2^(i / (N - 1)) r_d
+    //
+    // Then for the opposite (longest) reflection paths (L_(i=N/2)^N):
+    //
+    //     L_i = 2 r_a - L_(i-N/2)
+    //         = 2 r_a - 2^((i - N / 2) / (N - 1)) r_d
+    //
+    // For our 5m average room, we get:
+    static constexpr float late_line_lengths[4] =
+    {
+        9.709681E-3F, 1.223343E-2F, 1.689561E-2F, 1.941936E-2F,
+    };
 
-            // Load samples into the temp buffer first.
-            for (int j = 0; j < 4; ++j)
-            {
-                for (int i = 0; i < td; ++i)
-                {
-                    temps[i][j] = src_samples[j][i + base];
-                }
-            }
+    // This coefficient is used to define the sinus depth according to the
+    // modulation depth property. This value must be below half the shortest late
+    // line length (0.0097/2 = ~0.0048), otherwise with certain parameters (high
+    // mod time, low density) the downswing can sample before the input.
+    static constexpr float modulation_depth_coeff = 1.0F / 4096.0F;
 
-            if (is_enabled_)
-            {
-                for (int i = 0; i < td; ++i)
-                {
-                    // Roughly calculate the maximum amplitude from the 4-channel
-                    // signal, and attack or release the gain control to reach it.
-                    auto amplitude = std::abs(temps[i][0]);
+    // A filter is used to avoid the terrible distortion caused by changing
+    // modulation time and/or depth.  To be consistent across different sample
+    // rates, the coefficient must be raised to a constant divided by the sample
+    // rate:  coeff^(constant / rate).
+    static constexpr float modulation_filter_coeff = 0.048F;
+    static constexpr float modulation_filter_const = 100000.0F;
 
-                    amplitude = std::max(amplitude + std::abs(temps[i][1]),
-                        std::max(amplitude + std::abs(temps[i][2]),
-                            amplitude + std::abs(temps[i][3])));
+    // The upper bound of the T60 filters' HF reference relative to the rate of
+    // the late lines.
+    static constexpr float max_late_hf_scale = 0.49F;
 
-                    if (amplitude > gain_control_)
-                    {
-                        gain_control_ = std::min(gain_control_ + attack_rate_, amplitude);
-                    }
-                    else if (amplitude < gain_control_)
-                    {
-                        gain_control_ = std::max(gain_control_ - release_rate_, amplitude);
-                    }
 
-                    // Apply the inverse of the gain control to normalize/compress
-                    // the volume.
-                    const auto output = 1.0F / Math::clamp(gain_control_, 0.5F, 2.0F);
+    //
+    // Device Update
+    //
 
-                    for (int j = 0; j < 4; ++j)
-                    {
-                        temps[i][j] *= output;
-                    }
-                }
-            }
-            else
-            {
-                for (int i = 0; i < td; ++i)
-                {
-                    // Same as above, except the amplitude is forced to 1. This
-                    // helps ensure smooth gain changes when the compressor is
-                    // turned on and off.
+    // Calculate the length of a delay line and store its mask and offset.
+    static void initialize_delay_line(
+        const float length,
+        const int frequency,
+        const int extra,
+        DelayLineI& delay)
+    {
+        auto sample_count = int{};
 
-                    const auto amplitude = 1.0F;
+        // All line lengths are powers of 2, calculated from their lengths in
+        // seconds, rounded up.
+        sample_count = static_cast<int>(std::ceil(length * frequency));
+        sample_count = Math::next_power_of_2(sample_count + extra);
 
-                    if (amplitude > gain_control_)
-                    {
-                        gain_control_ = std::min(gain_control_ + attack_rate_, amplitude);
-                    }
-                    else if (amplitude < gain_control_)
-                    {
-                        gain_control_ = std::max(gain_control_ - release_rate_, amplitude);
-                    }
+        delay.initialize(sample_count);
+    }
 
-                    const auto output = 1.0F / Math::clamp(gain_control_, 0.5F, 2.0F);
+    // Returns the sample rate of the late lines for the current quality.
+    int get_late_frequency(
+        const int frequency) const
+    {
+        if (quality_ == EffectProps::Reverb::quality_half_rate_late)
+        {
+            return frequency / 2;
+        }
 
-                    for (int j = 0; j < 4; ++j)
-                    {
-                        temps[i][j] *= output;
-                    }
-                }
-            }
+        return frequency;
+    }
 
-            // Now mix to the output.
-            for (int j = 0; j < 4; ++j)
-            {
-                for (int k = 0; k < channel_count; ++k)
-                {
-                    const auto channel_gain = channels_gains_[j][k];
+    // Calculates the delay line metrics and allocates the lines for given
+    // the sample rate (frequency).
+    //
+    // Only the lines used by the current quality are allocated, the others
+    // are released.
+    void alloc_lines(
+        const int frequency)
+    {
+        const auto has_early = (quality_ != EffectProps::Reverb::quality_late_only);
+        const auto has_late = (quality_ != EffectProps::Reverb::quality_early_only);
 
-                    if (!(std::abs(channel_gain) > silence_threshold_gain))
-                    {
-                        continue;
-                    }
+        // Multiplier for the maximum density value, i.e. density=1, which is
+        // actually the least density...
+        //
+        const auto multiplier = 1.0F + line_multiplier;
 
-                    for (int i = 0; i < td; ++i)
-                    {
-                        dst_samples[k][base + i] += channel_gain * temps[i][j];
-                    }
-                }
-            }
+        // The main delay length includes the maximum early reflection delay, the
+        // largest early tap width, the maximum late reverb delay, and the
+        // largest late tap width.  Finally, it must also be extended by the
+        // update size (MAX_UPDATE_SAMPLES) for block processing.
+        auto length = EffectProps::Reverb::max_reflections_delay +
+                 (early_tap_lengths[3] * multiplier);
 
-            base += td;
+        if (has_late)
+        {
+            length += EffectProps::Reverb::max_late_reverb_delay +
+                ((late_line_lengths[3] - late_line_lengths[0]) * 0.25F * multiplier);
         }
-    }
 
+        initialize_delay_line(length, frequency, max_update_samples, delay_);
+
+        if (has_early)
+        {
+            // The early vector all-pass line.
+            length = early_allpass_lengths[3] * multiplier;
+            initialize_delay_line(length, frequency, 0, early_.vec_ap_.delay_);
 
-private:
-    using ChannelsGains = std::array<Gains, max_effect_channels>;
+            // The early reflection line.
+            length = early_line_lengths[3] * multiplier;
+            initialize_delay_line(length, frequency, 0, early_.delay_);
+        }
+        else
+        {
+            early_.vec_ap_.delay_.reset();
+            early_.delay_.reset();
+        }
 
+        reset_late_resampler();
 
-    // Effect gains for each channel
-    ChannelsGains channels_gains_;
+        if (!has_late)
+        {
+            late_.vec_ap_.delay_.reset();
+            late_.delay_.reset();
 
-    // Effect parameters
-    bool is_enabled_;
-    float attack_rate_;
-    float release_rate_;
-    float gain_control_;
-}; // CompressorEffectState
+            return;
+        }
 
+        const auto late_frequency = get_late_frequency(frequency);
 
-EffectState* EffectStateFactory::create_compressor()
-{
-    return create<CompressorEffectState>();
-}
+        // The late vector all-pass line.
+        length = late_allpass_lengths[3] * multiplier;
+        initialize_delay_line(length, late_frequency, 0, late_.vec_ap_.delay_);
 
+        // The late delay lines are calculated from the larger of the maximum
+        // density line length or the maximum echo time, and includes the maximum
+        // modulation-related delay. The modulator's delay is calculated from the
+        // maximum modulation time and depth coefficient, and halved for the low-
+        // to-high frequency swing.
+        length = std::max(
+            EffectProps::Reverb::max_echo_time,
+            late_line_lengths[3] * multiplier) +
+                (EffectProps::Reverb::max_modulation_time * modulation_depth_coeff / 2.0F);
 
-class DedicatedEffectState :
-    public EffectState
-{
-public:
-    DedicatedEffectState()
-        :
-        EffectState{},
-        gains_{}
-    {
+        initialize_delay_line(length, late_frequency, 0, late_.delay_);
     }
 
-    virtual ~DedicatedEffectState()
+    void reset_late_resampler()
     {
+        late_.input_carry_.fill(0.0F);
+        late_.output_last_.fill(0.0F);
+        late_.output_pending_.fill(0.0F);
+        late_.has_input_carry_ = false;
+
+        // The zero pending frame accounts for the one frame of latency.
+        late_.has_output_pending_ = true;
     }
 
 
-protected:
-    void do_construct() final
-    {
-        gains_.fill(0.0F);
-    }
+    //
+    // Effect Update
+    //
 
-    void do_destruct() final
+    // Calculate a decay coefficient given the length of each cycle and the time
+    // until the decay reaches -60 dB.
+    static float calc_decay_coeff(
+        const float length,
+        const float decayTime)
     {
+        return std::pow(reverb_decay_gain, length / decayTime);
     }
 
-    void do_update_device(
-        Device& device) final
+    // Calculate a decay length from a coefficient and the time until the decay
+    // reaches -60 dB.
+    static float calc_decay_length(
+        const float coeff,
+        const float decay_time)
     {
-        static_cast<void>(device);
+        return std::log10(coeff) * decay_time / std::log10(reverb_decay_gain);
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props)
+    // Calculate an attenuation to be applied to the input of any echo models to
+    // compensate for modal density and decay time.
+    static float calc_density_gain(
+        const float a)
     {
-        gains_.fill(0.0F);
-
-        const auto gain = effect_props.dedicated_.gain_;
-
-        if (effect_slot.effect_.type_ == EffectType::dedicated_low_frequency)
-        {
-            const auto idx = device.get_channel_index(ChannelId::lfe);
-
-            if (idx != -1)
-            {
-                dst_buffers_ = &device.sample_buffers_;
-                dst_channel_count_ = device.channel_count_;
-                gains_[idx] = gain;
-            }
-        }
-        else if (effect_slot.effect_.type_ == EffectType::dedicated_dialog)
-        {
-            const auto idx = device.get_channel_index(ChannelId::front_center);
-
-            // Dialog goes to the front-center speaker if it exists, otherwise it
-            // plays from the front-center location.
-
-            if (idx != -1)
-            {
-                dst_buffers_ = &device.sample_buffers_;
-                dst_channel_count_ = device.channel_count_;
-                gains_[idx] = gain;
-            }
-            else
-            {
-                AmbiCoeffs coeffs;
-
-                Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
-
-                dst_buffers_ = &device.sample_buffers_;
-                dst_channel_count_ = device.channel_count_;
-
-                Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, gain, gains_);
-            }
-        }
+        // The energy of a signal can be obtained by finding the area under the
+        // squared signal.  This takes the form of Sum(x_n^2), where x is the
+        // amplitude for the sample n.
+        //
+        // Decaying feedback matches exponential decay of the form Sum(a^n),
+        // where a is the attenuation coefficient, and n is the sample.  The area
+        // under this decay curve can be calculated as:  1 / (1 - a).
+        //
+        // Modifying the above equation to find the area under the squared curve
+        // (for energy) yields:  1 / (1 - a^2).  Input attenuation can then be
+        // calculated by inverting the square root of this approximation,
+        // yielding:  1 / sqrt(1 / (1 - a^2)), simplified to: sqrt(1 - a^2).
+        //
+        return std::sqrt(1.0F - (a * a));
     }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+    // Calculate the scattering matrix coefficients given a diffusion factor.
+    static void calc_matrix_coeffs(
+        const float diffusion,
+        float* x,
+        float* y)
     {
-        for (int c = 0; c < channel_count; ++c)
-        {
-            const auto gain = gains_[c];
+        // The matrix is of order 4, so n is sqrt(4 - 1).
+        const auto n = std::sqrt(3.0F);
+        const auto t = diffusion * std::atan(n);
 
-            if (!(std::abs(gain) > silence_threshold_gain))
-            {
-                continue;
-            }
+        // Calculate the first mixing matrix coefficient.
+        *x = std::cos(t);
 
-            for (int i = 0; i < sample_count; ++i)
-            {
-                dst_samples[c][i] += src_samples[0][i] * gain;
-            }
-        }
+        // Calculate the second mixing matrix coefficient.
+        *y = std::sin(t) / n;
     }
 
+    // Calculate the limited HF ratio for use with the late reverb low-pass
+    // filters.
+    static float calc_limited_hf_ratio(
+        const float hf_ratio,
+        const float air_absorption_gain_hf,
+        const float decay_time)
+    {
+        // Find the attenuation due to air absorption in dB (converting delay
+        // time to meters using the speed of sound).  Then reversing the decay
+        // equation, solve for HF ratio.  The delay length is cancelled out of
+        // the equation, so it can be calculated once for all lines.
+        const auto limit_ratio = 1.0F / (calc_decay_length(air_absorption_gain_hf, decay_time) *
+            speed_of_sound_mps);
 
-private:
-    Gains gains_;
-}; // DedicatedEffectState
+        // Using the limit calculated above, apply the upper bound to the HF
+        // ratio. Also need to limit the result to a minimum of 0.1, just like
+        // the HF ratio parameter.
+        return Math::clamp(limit_ratio, 0.1F, hf_ratio);
+    }
 
+    // Calculates the first-order high-pass coefficients following the I3DL2
+    // reference model.  This is the transfer function:
+    //
+    //                1 - z^-1
+    //     H(z) = p ------------
+    //               1 - p z^-1
+    //
+    // And this is the I3DL2 coefficient calculation given gain (g) and reference
+    // angular frequency (w):
+    //
+    //                                    g
+    //      p = ------------------------------------------------------
+    //          g cos(w) + sqrt((cos(w) - 1) (g^2 cos(w) + g^2 - 2))
+    //
+    // The coefficient is applied to the partial differential filter equation as:
+    //
+    //     c_0 = p
+    //     c_1 = -p
+    //     c_2 = p
+    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
+    //
+    static void calc_highpass_coeffs(
+        const float gain,
+        const float w,
+        float coeffs[3])
+    {
+        if (gain >= 1.0F)
+        {
+            coeffs[0] = 1.0F;
+            coeffs[1] = 0.0F;
+            coeffs[2] = 0.0F;
 
-EffectState* EffectStateFactory::create_dedicated()
-{
-    return create<DedicatedEffectState>();
-}
+            return;
+        }
 
+        const auto g = std::max(0.001F, gain);
+        const auto g2 = g * g;
+        const auto cw = std::cos(w);
+        const auto p = g / ((g * cw) + std::sqrt((cw - 1.0F) * ((g2 * cw) + g2 - 2.0F)));
 
-class DistortionEffectState :
-    public EffectState
-{
-public:
-    DistortionEffectState()
-        :
-        EffectState{},
-        gains_{},
-        low_pass_{},
-        band_pass_{},
-        attenuation_{},
-        edge_coeff_{}
-    {
+        coeffs[0] = p;
+        coeffs[1] = -p;
+        coeffs[2] = p;
     }
 
-    virtual ~DistortionEffectState()
+    // Calculates the first-order low-pass coefficients following the I3DL2
+    // reference model.  This is the transfer function:
+    //
+    //              (1 - a) z^0
+    //     H(z) = ----------------
+    //             1 z^0 - a z^-1
+    //
+    // And this is the I3DL2 coefficient calculation given gain (g) and reference
+    // angular frequency (w):
+    //
+    //          1 - g^2 cos(w) - sqrt(2 g^2 (1 - cos(w)) - g^4 (1 - cos(w)^2))
+    //     a = ----------------------------------------------------------------
+    //                                    1 - g^2
+    //
+    // The coefficient is applied to the partial differential filter equation as:
+    //
+    //     c_0 = 1 - a
+    //     c_1 = 0
+    //     c_2 = a
+    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
+    //
+    static void calc_lowpass_coeffs(
+        const float gain,
+        const float w,
+        float coeffs[3])
     {
-    }
+        if (gain >= 1.0F)
+        {
+            coeffs[0] = 1.0F;
+            coeffs[1] = 0.0F;
+            coeffs[2] = 0.0F;
 
+            return;
+        }
 
-protected:
-    void do_construct() final
-    {
-        low_pass_.clear();
-        band_pass_.clear();
-    }
+        // Be careful with gains < 0.001, as that causes the coefficient
+        // to head towards 1, which will flatten the signal.
+        const auto g = std::max(0.001F, gain);
+        const auto g2 = g * g;
+        const auto cw = std::cos(w);
 
-    void do_destruct() final
-    {
+        const auto a = (1.0F - (g2 * cw) - std::sqrt((2.0F * g2 * (1.0F - cw)) - (g2 * g2 * (1.0F - (cw * cw))))) /
+            (1.0F - g2);
+
+        coeffs[0] = 1.0F - a;
+        coeffs[1] = 0.0F;
+        coeffs[2] = a;
     }
 
-    void do_update_device(
-        Device& device) final
+    // Calculates the first-order low-shelf coefficients.  The shelf filters are
+    // used in place of low/high-pass filters to preserve the mid-band.  This is
+    // the transfer function:
+    //
+    //             a_0 + a_1 z^-1
+    //     H(z) = ----------------
+    //              1 + b_1 z^-1
+    //
+    // And these are the coefficient calculations given cut gain (g) and a center
+    // angular frequency (w):
+    //
+    //          sin(0.5 (pi - w) - 0.25 pi)
+    //     p = -----------------------------
+    //          sin(0.5 (pi - w) + 0.25 pi)
+    //
+    //          g + 1           g + 1
+    //     a = ------- + sqrt((-------)^2 - 1)
+    //          g - 1           g - 1
+    //
+    //            1 + g + (1 - g) a
+    //     b_0 = -------------------
+    //                    2
+    //
+    //            1 - g + (1 + g) a
+    //     b_1 = -------------------
+    //                    2
+    //
+    // The coefficients are applied to the partial differential filter equation
+    // as:
+    //
+    //            b_0 + p b_1
+    //     c_0 = -------------
+    //              1 + p a
+    //
+    //            -(b_1 + p b_0)
+    //     c_1 = ----------------
+    //               1 + p a
+    //
+    //             p + a
+    //     c_2 = ---------
+    //            1 + p a
+    //
+    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
+    //
+    static void calc_low_shelf_coeffs(
+        const float gain,
+        const float w,
+        float coeffs[3])
     {
-        static_cast<void>(device);
+        if (gain >= 1.0F)
+        {
+            coeffs[0] = 1.0F;
+            coeffs[1] = 0.0F;
+            coeffs[2] = 0.0F;
+
+            return;
+        }
+
+        const auto g = std::max(0.001F, gain);
+        const auto rw = Math::pi - w;
+        const auto p = std::sin((0.5F * rw) - (0.25F * Math::pi)) / std::sin((0.5F * rw) + (0.25F * Math::pi));
+        const auto n = (g + 1.0F) / (g - 1.0F);
+        const auto alpha = n + std::sqrt((n * n) - 1.0F);
+        const auto beta0 = (1.0F + g + (1.0F - g) * alpha) / 2.0F;
+        const auto beta1 = (1.0F - g + (1.0F + g) * alpha) / 2.0F;
+
+        coeffs[0] = (beta0 + (p * beta1)) / (1.0F + (p * alpha));
+        coeffs[1] = -(beta1 + (p * beta0)) / (1.0F + (p * alpha));
+        coeffs[2] = (p + alpha) / (1.0F + (p * alpha));
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+    // Calculates the first-order high-shelf coefficients.  The shelf filters are
+    // used in place of low/high-pass filters to preserve the mid-band.  This is
+    // the transfer function:
+    //
+    //             a_0 + a_1 z^-1
+    //     H(z) = ----------------
+    //              1 + b_1 z^-1
+    //
+    // And these are the coefficient calculations given cut gain (g) and a center
+    // angular frequency (w):
+    //
+    //          sin(0.5 w - 0.25 pi)
+    //     p = ----------------------
+    //          sin(0.5 w + 0.25 pi)
+    //
+    //          g + 1           g + 1
+    //     a = ------- + sqrt((-------)^2 - 1)
+    //          g - 1           g - 1
+    //
+    //            1 + g + (1 - g) a
+    //     b_0 = -------------------
+    //                    2
+    //
+    //            1 - g + (1 + g) a
+    //     b_1 = -------------------
+    //                    2
+    //
+    // The coefficients are applied to the partial differential filter equation
+    // as:
+    //
+    //            b_0 + p b_1
+    //     c_0 = -------------
+    //              1 + p a
+    //
+    //            b_1 + p b_0
+    //     c_1 = -------------
+    //              1 + p a
+    //
+    //            -(p + a)
+    //     c_2 = ----------
+    //            1 + p a
+    //
+    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
+    //
+    //
+    static void calc_high_shelf_coeffs(
+        const float gain,
+        const float w,
+        float coeffs[3])
     {
-        static_cast<void>(effect_slot);
-
-        const auto frequency = static_cast<float>(device.sampling_rate_);
-
-        // Store distorted signal attenuation settings.
-        attenuation_ = effect_props.distortion_.gain_;
-
-        // Store waveshaper edge settings.
-        auto edge = std::sin(effect_props.distortion_.edge_ * (Math::pi_2));
-        edge = std::min(edge, 0.99F);
-        edge_coeff_ = 2.0F * edge / (1.0F - edge);
-
-        auto cutoff = effect_props.distortion_.low_pass_cutoff_;
-
-        // Bandwidth value is constant in octaves.
-        auto bandwidth = (cutoff / 2.0F) / (cutoff * 0.67F);
-
-        // Multiply sampling frequency by the amount of oversampling done during
-        // processing.
-        low_pass_.set_params(
-            FilterType::low_pass,
-            1.0F,
-            cutoff / (frequency * 4.0F),
-            FilterState::calc_rcp_q_from_bandwidth(cutoff / (frequency * 4.0F), bandwidth));
-
-        cutoff = effect_props.distortion_.eq_center_;
+        if (gain >= 1.0F)
+        {
+            coeffs[0] = 1.0F;
+            coeffs[1] = 0.0F;
+            coeffs[2] = 0.0F;
 
-        // Convert bandwidth in Hz to octaves.
-        bandwidth = effect_props.distortion_.eq_bandwidth_ / (cutoff * 0.67F);
+            return;
+        }
 
-        band_pass_.set_params(
-            FilterType::band_pass,
-            1.0F,
-            cutoff / (frequency * 4.0F),
-            FilterState::calc_rcp_q_from_bandwidth(cutoff / (frequency * 4.0F), bandwidth));
+        const auto g = std::max(0.001F, gain);
+        const auto p = std::sin((0.5F * w) - (0.25F * Math::pi)) / std::sin((0.5F * w) + (0.25F * Math::pi));
+        const auto n = (g + 1.0F) / (g - 1.0F);
+        const auto alpha = n + std::sqrt((n * n) - 1.0F);
+        const auto beta0 = (1.0F + g + (1.0F - g) * alpha) / 2.0F;
+        const auto beta1 = (1.0F - g + (1.0F + g) * alpha) / 2.0F;
 
-        Panning::compute_ambient_gains(
-            device.channel_count_,
-            device.dry_,
-            1.0F,
-            gains_);
+        coeffs[0] = (beta0 + (p * beta1)) / (1.0F + (p * alpha));
+        coeffs[1] = (beta1 + (p * beta0)) / (1.0F + (p * alpha));
+        coeffs[2] = -(p + alpha) / (1.0F + (p * alpha));
     }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+    // Calculates the 3-band T60 damping coefficients for a particular delay line
+    // of specified length using a combination of two low/high-pass/shelf or
+    // pass-through filter sections (producing 3 coefficients each) and a general
+    // gain (7th coefficient) given decay times for each band split at two (LF/
+    // HF) reference frequencies (w).
+    static void calc_t60_damping_coeffs(
+        const float length,
+        const float lf_decay_time,
+        const float mf_decay_time,
+        const float hf_decay_time,
+        const float lf_w,
+        const float hf_w,
+        float lfcoeffs[3],
+        float hfcoeffs[3],
+        float *midcoeff)
     {
-        const auto fc = edge_coeff_;
+        const auto lf_gain = calc_decay_coeff(length, lf_decay_time);
+        const auto mf_gain = calc_decay_coeff(length, mf_decay_time);
+        const auto hf_gain = calc_decay_coeff(length, hf_decay_time);
 
-        for (int base = 0; base < sample_count; )
+        if (lf_gain < mf_gain)
         {
-            float buffer[2][64 * 4];
-
-            const auto td = std::min(64, sample_count - base);
-
-            // Perform 4x oversampling to avoid aliasing. Oversampling greatly
-            // improves distortion quality and allows to implement lowpass and
-            // bandpass filters using high frequencies, at which classic IIR
-            // filters became unstable.
-
-            // Fill oversample buffer using zero stuffing.
-            for (int it = 0; it < td; ++it)
+            if (mf_gain < hf_gain)
             {
-                // Multiply the sample by the amount of oversampling to maintain
-                // the signal's power.
-
-                buffer[0][(it * 4) + 0] = src_samples[0][it + base] * 4.0F;
-                buffer[0][(it * 4) + 1] = 0.0F;
-                buffer[0][(it * 4) + 2] = 0.0F;
-                buffer[0][(it * 4) + 3] = 0.0F;
+                calc_low_shelf_coeffs(mf_gain / hf_gain, hf_w, lfcoeffs);
+                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, hfcoeffs);
+                *midcoeff = hf_gain;
             }
-
-            // First step, do lowpass filtering of original signal. Additionally
-            // perform buffer interpolation and lowpass cutoff for oversampling
-            // (which is fortunately first step of distortion). So combine three
-            // operations into the one.
-            low_pass_.process(td * 4, buffer[0], buffer[1]);
-
-            // Second step, do distortion using waveshaper function to emulate
-            // signal processing during tube overdriving. Three steps of
-            // waveshaping are intended to modify waveform without boost/clipping/
-            // attenuation process.
-            for (int it = 0; it < td * 4; it++)
+            else if (mf_gain > hf_gain)
             {
-                auto smp = buffer[1][it];
-
-                smp = (1.0F + fc) * smp / (1.0F + (fc * std::abs(smp)));
-                smp = (1.0F + fc) * smp / (1.0F + (fc * std::abs(smp))) * -1.0F;
-                smp = (1.0F + fc) * smp / (1.0F + (fc * std::abs(smp)));
-
-                buffer[0][it] = smp;
+                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, lfcoeffs);
+                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
+                *midcoeff = mf_gain;
             }
-
-            // Third step, do bandpass filtering of distorted signal.
-            band_pass_.process(td * 4, buffer[0], buffer[1]);
-
-            for (int kt = 0; kt < channel_count; ++kt)
+            else
             {
-                // Fourth step, final, do attenuation and perform decimation,
-                // store only one sample out of 4.
-
-                const auto gain = gains_[kt] * attenuation_;
-
-                if (!(std::abs(gain) > silence_threshold_gain))
-                {
-                    continue;
-                }
-
-                for (int it = 0; it < td; ++it)
-                {
-                    dst_samples[kt][base + it] += gain * buffer[1][it * 4];
-                }
+                lfcoeffs[0] = 1.0F;
+                lfcoeffs[1] = 0.0F;
+                lfcoeffs[2] = 0.0F;
+                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, hfcoeffs);
+                *midcoeff = mf_gain;
             }
-
-            base += td;
         }
-    }
-
-
-private:
-    // Effect gains for each channel
-    Gains gains_;
-
-    // Effect parameters
-    FilterState low_pass_;
-    FilterState band_pass_;
-    float attenuation_;
-    float edge_coeff_;
-}; // DistortionEffectState
-
-
-EffectState* EffectStateFactory::create_distortion()
-{
-    return create<DistortionEffectState>();
-}
-
-
-class EchoEffectState :
-    public EffectState
-{
-public:
-    struct Tap
-    {
-        int delay;
-    };
-
-
-    EchoEffectState()
-        :
-        EffectState{},
-        sample_buffer_{},
-        buffer_length_{},
-        taps_{},
-        offset_{},
-        taps_gains_{},
-        feed_gain_{},
-        filter_{}
-    {
-    }
-
-    virtual ~EchoEffectState()
-    {
-    }
-
-
-protected:
-    void do_construct() final
-    {
-        buffer_length_ = 0;
-        sample_buffer_ = EffectSampleBuffer{};
-
-        taps_[0].delay = 0;
-        taps_[1].delay = 0;
-        offset_ = 0;
-
-        filter_.clear();
-    }
-
-    void do_destruct() final
-    {
-        sample_buffer_ = EffectSampleBuffer{};
-    }
-
-    void do_update_device(
-        Device& device) final
-    {
-        // Use the next power of 2 for the buffer length, so the tap offsets can be
-        // wrapped using a mask instead of a modulo
-        auto maxlen = static_cast<int>(EffectProps::Echo::max_delay * device.sampling_rate_) + 1;
-        maxlen += static_cast<int>(EffectProps::Echo::max_lr_delay * device.sampling_rate_) + 1;
-        maxlen = Math::next_power_of_2(maxlen);
+        else if (lf_gain > mf_gain)
+        {
+            if (mf_gain < hf_gain)
+            {
+                const auto hg = mf_gain / lf_gain;
+                const auto lg = mf_gain / hf_gain;
 
-        if (maxlen != buffer_length_)
+                calc_high_shelf_coeffs(hg, lf_w, lfcoeffs);
+                calc_low_shelf_coeffs(lg, hf_w, hfcoeffs);
+                *midcoeff = std::max(lf_gain, hf_gain) / std::max(hg, lg);
+            }
+            else if (mf_gain > hf_gain)
+            {
+                calc_high_shelf_coeffs(mf_gain / lf_gain, lf_w, lfcoeffs);
+                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
+                *midcoeff = lf_gain;
+            }
+            else
+            {
+                lfcoeffs[0] = 1.0F;
+                lfcoeffs[1] = 0.0F;
+                lfcoeffs[2] = 0.0F;
+                calc_high_shelf_coeffs(mf_gain / lf_gain, lf_w, hfcoeffs);
+                *midcoeff = lf_gain;
+            }
+        }
+        else
         {
-            sample_buffer_.resize(maxlen);
-            buffer_length_ = maxlen;
+            lfcoeffs[0] = 1.0F;
+            lfcoeffs[1] = 0.0F;
+            lfcoeffs[2] = 0.0F;
+
+            if (mf_gain < hf_gain)
+            {
+                calc_low_shelf_coeffs(mf_gain / hf_gain, hf_w, hfcoeffs);
+                *midcoeff = hf_gain;
+            }
+            else if (mf_gain > hf_gain)
+            {
+                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
+                *midcoeff = mf_gain;
+            }
+            else
+            {
+                hfcoeffs[0] = 1.0F;
+                hfcoeffs[1] = 0.0F;
+                hfcoeffs[2] = 0.0F;
+                *midcoeff = mf_gain;
+            }
         }
-
-        std::fill(sample_buffer_.begin(), sample_buffer_.end(), 0.0F);
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+    // Update the EAX modulation index, range, and depth.  Keep in mind that this
+    // kind of vibrato is additive and not multiplicative as one may expect.  The
+    // downswing will sound stronger than the upswing.
+    void update_modulator(
+        const float mod_time,
+        const float mod_depth,
+        const int frequency)
     {
-        static_cast<void>(effect_slot);
+        // Modulation is calculated in two parts.
+        //
+        // The modulation time effects the speed of the sinus. The phase is
+        // advanced by one period over the modulation time, bound to a reasonable
+        // minimum (1 sample). The phase itself is left untouched when the timing
+        // changes, so the sinus stays continuous.
+        //
+        const auto range = std::max(static_cast<double>(mod_time) * frequency, 1.0);
 
-        AmbiCoeffs coeffs;
-        float effect_gain, lrpan, spread;
+        mod_.step_ = Oscillator::to_phase(1.0 / range);
 
-        const auto frequency = device.sampling_rate_;
+        // The modulation depth effects the scale of the sinus, which changes how
+        // much extra delay is added to the delay line. This delay changing over
+        // time changes the pitch, creating the modulation effect. The scale needs
+        // to be multiplied by the modulation time so that a given depth produces a
+        // consistent shift in frequency over all ranges of time. Since the depth
+        // is applied to a sinus value, it needs to be halved for the sinus swing
+        // in time (half of it is spent decreasing the frequency, half is spent
+        // increasing it).
+        mod_.depth_ = mod_depth * modulation_depth_coeff * mod_time / 2.0F * frequency;
+    }
 
-        taps_[0].delay = static_cast<int>(effect_props.echo_.delay_ * frequency) + 1;
-        taps_[1].delay = static_cast<int>(effect_props.echo_.lr_delay_ * frequency);
-        taps_[1].delay += taps_[0].delay;
+    // Update the offsets for the main effect delay line.
+    void update_delay_line(
+        const float early_delay,
+        const float late_delay,
+        const float density,
+        const float decay_time,
+        const int frequency)
+    {
+        const auto multiplier = 1.0F + (density * line_multiplier);
 
-        spread = effect_props.echo_.spread_;
+        // Early reflection taps are decorrelated by means of an average room
+        // reflection approximation described above the definition of the taps.
+        // This approximation is linear and so the above density multiplier can
+        // be applied to adjust the width of the taps.  A single-band decay
+        // coefficient is applied to simulate initial attenuation and absorption.
+        //
+        // Late reverb taps are based on the late line lengths to allow a zero-
+        // delay path and offsets that would continue the propagation naturally
+        // into the late lines.
 
-        if (spread < 0.0F)
-        {
-            lrpan = -1.0F;
-        }
-        else
+        for (int i = 0; i < 4; ++i)
         {
-            lrpan = 1.0F;
-        }
-
-        // Convert echo spread (where 0 = omni, +/-1 = directional) to coverage
-        // spread (where 0 = point, tau = omni).
-        spread = std::asin(1.0F - std::abs(spread)) * 4.0F;
-
-        feed_gain_ = effect_props.echo_.feedback_;
-
-        effect_gain = std::max(1.0F - effect_props.echo_.damping_, 0.0625F); // Limit -24dB
-
-        filter_.set_params(
-            FilterType::high_shelf,
-            effect_gain,
-            SendProps::lp_frequency_reference / frequency,
-            FilterState::calc_rcp_q_from_slope(effect_gain, 1.0F));
+            auto length = float{};
 
-        effect_gain = 1.0F;
+            length = early_delay + (early_tap_lengths[i] * multiplier);
+            early_delay_taps_[i][1] = static_cast<int>(length * frequency);
 
-        // First tap panning
-        Panning::calc_angle_coeffs(-Math::pi_2 * lrpan, 0.0F, spread, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, effect_gain, taps_gains_[0]);
+            length = early_tap_lengths[i] * multiplier;
+            early_delay_coeffs_[i] = calc_decay_coeff(length, decay_time);
 
-        // Second tap panning
-        Panning::calc_angle_coeffs(Math::pi_2 * lrpan, 0.0F, spread, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, effect_gain, taps_gains_[1]);
+            length = late_delay + (late_line_lengths[i] - late_line_lengths[0]) * 0.25F * multiplier;
+            late_delay_taps_[i][1] = late_feed_tap_ + static_cast<int>(length * frequency);
+        }
     }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+    // Update the early reflection line lengths and gain coefficients.
+    void update_early_lines(
+        const float density,
+        const float decay_time,
+        const int frequency)
     {
-        const auto mask = buffer_length_ - 1;
-        const auto tap1 = taps_[0].delay;
-        const auto tap2 = taps_[1].delay;
-        float x[2] = {filter_.x_[0], filter_.x_[1],};
-        float y[2] = {filter_.y_[0], filter_.y_[1],};
+        const auto multiplier = 1.0F + density*line_multiplier;
 
-        for (int base = 0; base < sample_count; )
+        for(int i = 0; i < 4; ++i)
         {
-            float temps[128][2];
-
-            const auto td = std::min(128, sample_count - base);
-
-            for (int i = 0; i < td; ++i)
-            {
-                // First tap
-                temps[i][0] = sample_buffer_[(offset_ - tap1) & mask];
-
-                // Second tap
-                temps[i][1] = sample_buffer_[(offset_ - tap2) & mask];
-
-                // Apply damping and feedback gain to the second tap, and mix in the
-                // new sample
-                auto in = temps[i][1] + src_samples[0][i + base];
-
-                auto out = (in * filter_.b0_) +
-                    (x[0] * filter_.b1_) + (x[1] * filter_.b2_) -
-                    (y[0] * filter_.a1_) - (y[1] * filter_.a2_);
-
-                x[1] = x[0];
-                x[0] = in;
-
-                y[1] = y[0];
-                y[0] = out;
-
-                sample_buffer_[offset_&mask] = out * feed_gain_;
-
-                offset_ += 1;
-            }
+            auto length = float{};
 
-            for (int k = 0; k < channel_count; ++k)
-            {
-                auto channel_gain = taps_gains_[0][k];
+            // Calculate the length (in seconds) of each all-pass line.
+            length = early_allpass_lengths[i] * multiplier;
 
-                if (std::abs(channel_gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < td; ++i)
-                    {
-                        dst_samples[k][i + base] += temps[i][0] * channel_gain;
-                    }
-                }
+            // Calculate the delay offset for each all-pass line.
+            early_.vec_ap_.offsets_[i][1] = static_cast<int>(length * frequency);
 
-                channel_gain = taps_gains_[1][k];
+            // Calculate the length (in seconds) of each delay line.
+            length = early_line_lengths[i] * multiplier;
 
-                if (std::abs(channel_gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < td; ++i)
-                    {
-                        dst_samples[k][i + base] += temps[i][1] * channel_gain;
-                    }
-                }
-            }
+            // Calculate the delay offset for each delay line.
+            early_.offsets_[i][1] = static_cast<int>(length * frequency);
 
-            base += td;
+            /* Calculate the gain (coefficient) for each line. */
+            early_.coeffs_[i] = calc_decay_coeff(length, decay_time);
         }
-
-        filter_.x_[0] = x[0];
-        filter_.x_[1] = x[1];
-        filter_.y_[0] = y[0];
-        filter_.y_[1] = y[1];
     }
 
+    // Update the late reverb line lengths and T60 coefficients.
+    void update_late_lines(
+        const float density,
+        const float diffusion,
+        const float lf_decay_time,
+        const float mf_decay_time,
+        const float hf_decay_time,
+        const float lf_w,
+        const float hf_w,
+        const float echo_time,
+        const float echo_depth,
+        const int frequency)
+    {
+        float band_weights[3];
 
-private:
-    using Taps = std::array<Tap, 2>;
-    using TapsGains = std::array<Gains, 2>;
-
-
-    EffectSampleBuffer sample_buffer_;
-    int buffer_length_;
-
-    // The echo is two tap. The delay is the number of samples from before the
-    // current offset
-    Taps taps_;
-
-    int offset_;
+        // To compensate for changes in modal density and decay time of the late
+        // reverb signal, the input is attenuated based on the maximal energy of
+        // the outgoing signal.  This approximation is used to keep the apparent
+        // energy of the signal equal for all ranges of density and decay time.
+        //
+        // The average length of the delay lines is used to calculate the
+        // attenuation coefficient.
 
-    // The panning gains for the two taps
-    TapsGains taps_gains_;
+        const auto multiplier = 1.0F + (density * line_multiplier);
 
-    float feed_gain_;
+        auto length = (late_line_lengths[0] + late_line_lengths[1] +
+                  late_line_lengths[2] + late_line_lengths[3]) / 4.0F * multiplier;
 
-    FilterState filter_;
-}; // EchoEffectState
+        // Include the echo transformation (see below).
+        length = Math::lerp(length, echo_time, echo_depth);
 
+        length += (late_allpass_lengths[0] + late_allpass_lengths[1] +
+                   late_allpass_lengths[2] + late_allpass_lengths[3]) / 4.0F * multiplier;
 
-EffectState* EffectStateFactory::create_echo()
-{
-    return create<EchoEffectState>();
-}
+        // The density gain calculation uses an average decay time weighted by
+        // approximate bandwidth.  This attempts to compensate for losses of
+        // energy that reduce decay time due to scattering into highly attenuated
+        // bands.
 
+        band_weights[0] = lf_w;
+        band_weights[1] = hf_w - lf_w;
+        band_weights[2] = Math::tau - hf_w;
 
-//  The document  "Effects Extension Guide.pdf"  says that low and high
-//  frequencies are cutoff frequencies. This is not fully correct, they
-//  are corner frequencies for low and high shelf filters. If they were
-//  just cutoff frequencies, there would be no need in cutoff frequency
-//  gains, which are present.  Documentation for  "Creative Proteus X2"
-//  software describes  4-band equalizer functionality in a much better
-//  way.  This equalizer seems  to be a predecessor  of  OpenAL  4-band
-//  equalizer.  With low and high  shelf filters  we are able to cutoff
-//  frequencies below and/or above corner frequencies using attenuation
-//  gains (below 1.0) and amplify all low and/or high frequencies using
-//  gains above 1.0.
-//
-//     Low-shelf       Low Mid Band      High Mid Band     High-shelf
-//      corner            center             center          corner
-//     frequency        frequency          frequency       frequency
-//    50Hz..800Hz     200Hz..3000Hz      1000Hz..8000Hz  4000Hz..16000Hz
-//
-//          |               |                  |               |
-//          |               |                  |               |
-//   B -----+            /--+--\            /--+--\            +-----
-//   O      |\          |   |   |          |   |   |          /|
-//   O      | \        -    |    -        -    |    -        / |
-//   S +    |  \      |     |     |      |     |     |      /  |
-//   T      |   |    |      |      |    |      |      |    |   |
-// ---------+---------------+------------------+---------------+--------
-//   C      |   |    |      |      |    |      |      |    |   |
-//   U -    |  /      |     |     |      |     |     |      \  |
-//   T      | /        -    |    -        -    |    -        \ |
-//   O      |/          |   |   |          |   |   |          \|
-//   F -----+            \--+--/            \--+--/            +-----
-//   F      |               |                  |               |
-//          |               |                  |               |
-//
-// Gains vary from 0.126 up to 7.943, which means from -18dB attenuation
-// up to +18dB amplification. Band width varies from 0.01 up to 1.0 in
-// octaves for two mid bands.
-//
-// Implementation is based on the "Cookbook formulae for audio EQ biquad
-// filter coefficients" by Robert Bristow-Johnson
-// http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt/
-class EqualizerEffectState :
-    public EffectState
-{
-public:
-    EqualizerEffectState()
-        :
-        EffectState{},
-        channels_gains_{},
-        filter_{},
-        sample_buffer_{}
-    {
-    }
+        late_.density_gain_ = calc_density_gain(
+            calc_decay_coeff(
+                length,
+                ((band_weights[0] * lf_decay_time) +
+                    (band_weights[1] * mf_decay_time) +
+                    (band_weights[2] * hf_decay_time)) / Math::tau)
+        );
 
-    virtual ~EqualizerEffectState()
-    {
-    }
+        for (int i = 0; i < 4; ++i)
+        {
+            // Calculate the length (in seconds) of each all-pass line.
+            length = late_allpass_lengths[i] * multiplier;
 
+            // Calculate the delay offset for each all-pass line.
+            late_.vec_ap_.offsets_[i][1] = static_cast<int>(length * frequency);
 
-protected:
-    void do_construct()
+            // Calculate the length (in seconds) of each delay line.  This also
+            // applies the echo transformation.  As the EAX echo depth approaches
+            // 1, the line lengths approach a length equal to the echoTime.  This
+            // helps to produce distinct echoes along the tail.
+            length = Math::lerp(late_line_lengths[i] * multiplier, echo_time, echo_depth);
+
+            // Calculate the delay offset for each delay line.
+            late_.offsets_[i][1] = static_cast<int>(length * frequency);
+
+            // Approximate the absorption that the vector all-pass would exhibit
+            // given the current diffusion so we don't have to process a full T60
+            // filter for each of its four lines.
+            length += Math::lerp(late_allpass_lengths[i],
+                (late_allpass_lengths[0] + late_allpass_lengths[1] +
+                    late_allpass_lengths[2] + late_allpass_lengths[3]) / 4.0F,
+                diffusion) * multiplier;
+
+            // Calculate the T60 damping coefficients for each line.
+            calc_t60_damping_coeffs(
+                length,
+                lf_decay_time,
+                mf_decay_time,
+                hf_decay_time,
+                lf_w,
+                hf_w,
+                late_.filters_[i].lf_coeffs_.data(),
+                late_.filters_[i].hf_coeffs_.data(),
+                &late_.filters_[i].mid_coeff_);
+        }
+    }
+
+    static Mat4F matrix_mult(
+        const Mat4F& a,
+        const Mat4F& b)
     {
-        // Initialize sample history only on filter creation to avoid
-        // sound clicks if filter settings were changed in runtime.
-        for (int it = 0; it < 4; ++it)
+        Mat4F result;
+
+        for (int col = 0; col < 4; ++col)
         {
-            for (int ft = 0; ft < max_effect_channels; ++ft)
+            for (int row = 0;row < 4; ++row)
             {
-                filter_[it][ft].clear();
+                result(row, col) =
+                    (a(row, 0) * b(0, col)) +
+                    (a(row, 1) * b(1, col)) +
+                    (a(row, 2) * b(2, col)) +
+                    (a(row, 3) * b(3, col));
             }
         }
-    }
 
-    void do_destruct()
-    {
+        return result;
     }
 
-    void do_update_device(
-        Device& device)
+    static void clear_gains(
+        ChannelsGains& gains)
     {
-        static_cast<void>(device);
+        for (auto& gain : gains)
+        {
+            gain.fill(0.0F);
+        }
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props)
+    // Creates a transform matrix given a reverb vector. This works by creating a
+    // Z-focus transform, then a rotate transform around X, then Y, to place the
+    // focal point in the direction of the vector, using the vector length as a
+    // focus strength.
+    //
+    // This isn't technically correct since the vector is supposed to define the
+    // aperture and not rotate the perceived soundfield, but in practice it's
+    // probably good enough.
+    static Mat4F get_transform_from_vector(
+        const float* vec)
     {
-        static_cast<void>(effect_slot);
-
-        const auto frequency = static_cast<float>(device.sampling_rate_);
-        float gain;
-        float freq_mult;
-
-        dst_buffers_ = &device.sample_buffers_;
-        dst_channel_count_ = device.channel_count_;
+        const auto length = std::sqrt((vec[0] * vec[0]) + (vec[1] * vec[1]) + (vec[2] * vec[2]));
 
-        for (int i = 0; i < max_effect_channels; ++i)
-        {
-            Panning::compute_first_order_gains(
-                device.channel_count_,
-                device.foa_,
-                mat4f_identity.m_[i],
-                1.0F,
-                channels_gains_[i]);
-        }
+        // Define a Z-focus (X in Ambisonics) transform, given the panning vector
+        // length.
+        const auto sa = std::sin(std::min(length, 1.0F) * (Math::pi / 4.0F));
 
-        // Calculate coefficients for the each type of filter. Note that the shelf
-        // filters' gain is for the reference frequency, which is the centerpoint
-        // of the transition band.
-        gain = std::max(std::sqrt(effect_props.equalizer_.low_gain_), 0.0625F); // Limit -24dB
-        freq_mult = effect_props.equalizer_.low_cutoff_ / frequency;
+        const auto zfocus = Mat4F{{
+            {1.0F / (1.0F + sa), 0.0F, 0.0F, (sa / (1.0F + sa)) / 1.732050808F,},
+            {0.0F, std::sqrt((1.0F - sa) / (1.0F + sa)), 0.0F, 0.0F,},
+            {0.0F, 0.0F, std::sqrt((1.0F - sa) / (1.0F + sa)), 0.0F,},
+            {(sa / (1.0F + sa)) * 1.732050808F, 0.0F, 0.0F, 1.0F / (1.0F + sa),}
+        }};
 
-        filter_[0][0].set_params(
-            FilterType::low_shelf,
-            gain,
-            freq_mult,
-            FilterState::calc_rcp_q_from_slope(gain, 0.75F));
+        // Define rotation around X (Y in Ambisonics)
+        auto a = std::atan2(vec[1], std::sqrt((vec[0] * vec[0]) + (vec[2] * vec[2])));
 
-        // Copy the filter coefficients for the other input channels.
-        for (int i = 1; i < max_effect_channels; ++i)
-        {
-            FilterState::copy_params(filter_[0][0], filter_[0][i]);
-        }
+        const auto xrot = Mat4F{{
+            {1.0F, 0.0F, 0.0F, 0.0F,},
+            {0.0F, 1.0F, 0.0F, 0.0F,},
+            {0.0F, 0.0F,  std::cos(a), std::sin(a),},
+            {0.0F, 0.0F, -std::sin(a), std::cos(a),},
+        }};
 
-        gain = std::max(effect_props.equalizer_.mid1_gain_, 0.0625F);
-        freq_mult = effect_props.equalizer_.mid1_center_ / frequency;
+        // Define rotation around Y (Z in Ambisonics). NOTE: EFX's reverb vectors
+        // use a right-handled coordinate system, compared to the rest of OpenAL
+        // which uses left-handed. This is fixed by negating Z, however it would
+        // need to also be negated to get a proper Ambisonics angle, thus
+        // cancelling it out.
+        a = std::atan2(-vec[0], vec[2]);
 
-        filter_[1][0].set_params(
-            FilterType::peaking,
-            gain,
-            freq_mult,
-            FilterState::calc_rcp_q_from_bandwidth(freq_mult, effect_props.equalizer_.mid1_width_));
+        const auto yrot = Mat4F{{
+            {1.0F, 0.0F, 0.0F, 0.0F,},
+            {0.0F, std::cos(a), 0.0F, std::sin(a),},
+            {0.0F, 0.0F, 1.0F, 0.0F,},
+            {0.0F, -std::sin(a), 0.0F, std::cos(a),},
+        }};
 
-        for (int i = 1; i < max_effect_channels; ++i)
-        {
-            FilterState::copy_params(filter_[1][0], filter_[1][i]);
-        }
+        // Define a matrix that first focuses on Z, then rotates around X then Y to
+        // focus the output in the direction of the vector.
+        return matrix_mult(yrot, matrix_mult(xrot, zfocus));
+    }
 
-        gain = std::max(effect_props.equalizer_.mid2_gain_, 0.0625F);
-        freq_mult = effect_props.equalizer_.mid2_center_ / frequency;
+    static bool is_zero_vector(
+        const float* vec)
+    {
+        return vec[0] == 0.0F && vec[1] == 0.0F && vec[2] == 0.0F;
+    }
 
-        filter_[2][0].set_params(
-            FilterType::peaking,
-            gain,
-            freq_mult,
-            FilterState::calc_rcp_q_from_bandwidth(freq_mult, effect_props.equalizer_.mid2_width_));
+    // Note: res is transposed.
+    static Mat4F matrix_mult_t(
+        const Mat4F& a,
+        const Mat4F& b)
+    {
+        Mat4F result;
 
-        for (int i = 1; i < max_effect_channels; ++i)
+        for (int col = 0; col < 4; ++col)
         {
-            FilterState::copy_params(filter_[2][0], filter_[2][i]);
+            for (int row = 0; row < 4; ++row)
+            {
+                result(col, row) =
+                    (a(row, 0) * b(0, col)) +
+                    (a(row, 1) * b(1, col)) +
+                    (a(row, 2) * b(2, col)) +
+                    (a(row, 3) * b(3, col));
+            }
         }
 
-        gain = std::max(std::sqrt(effect_props.equalizer_.high_gain_), 0.0625F);
-        freq_mult = effect_props.equalizer_.high_cutoff_ / frequency;
-
-        filter_[3][0].set_params(
-            FilterType::high_shelf,
-            gain,
-            freq_mult,
-            FilterState::calc_rcp_q_from_slope(gain, 0.75F));
-
-        for (int i = 1; i < max_effect_channels; ++i)
-        {
-            FilterState::copy_params(filter_[3][0], filter_[3][i]);
-        }
+        return result;
     }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count)
+    // Update the early and late 3D panning gains.
+    void update_3d_panning(
+        Device& device,
+        const float* reflections_pan,
+        const float* late_reverb_pan,
+        const float gain,
+        const float early_gain,
+        const float late_gain)
     {
-        auto& samples = sample_buffer_;
+        Mat4F transform;
+        Mat4F rot;
 
-        for (int base = 0; base < sample_count; )
-        {
-            const auto td = std::min(max_update_samples, sample_count - base);
+        dst_buffers_ = &device.sample_buffers_;
+        dst_channel_count_ = device.channel_count_;
 
-            for (int ft = 0; ft < max_effect_channels; ++ft)
-            {
-                filter_[0][ft].process(td, &src_samples[ft][base], samples[0][ft].data());
-            }
+        is_panned_ = !is_zero_vector(reflections_pan) || !is_zero_vector(late_reverb_pan);
 
-            for (int ft = 0; ft < max_effect_channels; ++ft)
-            {
-                filter_[1][ft].process(td, samples[0][ft].data(), samples[1][ft].data());
-            }
+        early_.gain_ = early_gain;
+        late_.gain_ = late_gain;
 
-            for (int ft = 0; ft < max_effect_channels; ++ft)
-            {
-                filter_[2][ft].process(td, samples[1][ft].data(), samples[2][ft].data());
-            }
+        // A zero panning vector leaves the soundfield as it is, so only the
+        // A-Format to B-Format conversion remains.
+        transform = matrix_mult_t(mat4f_identity, a2b);
+        clear_gains(unpanned_gains_);
 
-            for (int ft = 0; ft < max_effect_channels; ++ft)
-            {
-                filter_[3][ft].process(td, samples[2][ft].data(), samples[3][ft].data());
-            }
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                transform.m_[i],
+                gain,
+                unpanned_gains_[i]);
+        }
 
-            for (int ft = 0; ft < max_effect_channels; ++ft)
-            {
-                for (int kt = 0; kt < channel_count; ++kt)
-                {
-                    const auto gain = channels_gains_[ft][kt];
+        // Create a matrix that first converts A-Format to B-Format, then rotates
+        // the B-Format soundfield according to the panning vector.
+        rot = (is_zero_vector(reflections_pan) ? mat4f_identity : get_transform_from_vector(reflections_pan));
+        transform = matrix_mult_t(rot, a2b);
+        clear_gains(early_.pan_gains_);
 
-                    if (!(std::abs(gain) > silence_threshold_gain))
-                    {
-                        continue;
-                    }
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                transform.m_[i],
+                gain * early_gain,
+                early_.pan_gains_[i]);
+        }
 
-                    for (int it = 0; it < td; ++it)
-                    {
-                        dst_samples[kt][base + it] += gain * samples[3][ft][it];
-                    }
-                }
-            }
+        rot = (is_zero_vector(late_reverb_pan) ? mat4f_identity : get_transform_from_vector(late_reverb_pan));
+        transform = matrix_mult_t(rot, a2b);
+        clear_gains(late_.pan_gains_);
 
-            base += td;
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                transform.m_[i],
+                gain * late_gain,
+                late_.pan_gains_[i]);
         }
     }
 
 
-private:
-    // The maximum number of sample frames per update.
-    static constexpr auto max_update_samples = 256;
-
-    using ChannelsGains = std::array<Gains, max_effect_channels>;
-    using Filters = MdArray<FilterState, 4, max_effect_channels>;
-    using SampleBuffers = MdArray<float, 4, max_effect_channels, max_update_samples>;
-
+    //
+    // Effect Processing
+    //
 
-    // Effect gains for each channel
-    ChannelsGains channels_gains_;
+    // Basic delay line input/output routines.
+    //
+    // Each of the four lines is read at its own tap, so a read gathers one sample
+    // from each of four frames, while a write stores a whole frame.
+    static Float4 delay_line_out(
+        const DelayLineI& delay,
+        const int offset,
+        const Taps& taps,
+        const int index)
+    {
+        const auto& lines = delay.lines_;
+        const auto mask = delay.mask_;
 
-    // Effect parameters
-    Filters filter_;
+        return Float4::set(
+            lines[(offset - taps[0][index]) & mask][0],
+            lines[(offset - taps[1][index]) & mask][1],
+            lines[(offset - taps[2][index]) & mask][2],
+            lines[(offset - taps[3][index]) & mask][3]);
+    }
 
-    SampleBuffers sample_buffer_;
-}; // EqualizerEffectState
+    // Delay line output routine.
+    //
+    // When cross-fading, instead of interpolating the offsets, this interpolates
+    // (cross-fades) the outputs at each offset.
+    template<bool TIsFaded>
+    static Float4 delay_out(
+        const DelayLineI& delay,
+        const int offset,
+        const Taps& taps,
+        const Float4& mu)
+    {
+        const auto out0 = delay_line_out(delay, offset, taps, 0);
 
+        if (!TIsFaded)
+        {
+            return out0;
+        }
 
-EffectState* EffectStateFactory::create_equalizer()
-{
-    return create<EqualizerEffectState>();
-}
+        const auto out1 = delay_line_out(delay, offset, taps, 1);
 
+        return out0 + ((out1 - out0) * mu);
+    }
 
-class FlangerEffectState :
-    public EffectState
-{
-public:
-    FlangerEffectState()
-        :
-        EffectState{},
-        sample_buffers_{},
-        buffer_length_{},
-        offset_{},
-        lfo_range_{},
-        lfo_scale_{},
-        lfo_disp_{},
-        sides_gains_{},
-        waveform_{},
-        delay_{},
-        depth_{},
-        feedback_{}
+    static void delay_line_in4(
+        DelayLineI& delay,
+        const int offset,
+        const Float4& in)
     {
+        in.store(delay.lines_[offset & delay.mask_].data());
     }
 
-    virtual ~FlangerEffectState()
+    // Low-pass (and band-pass for EAX) filters the B-Format input, converts it
+    // to A-Format and feeds the initial delay line.
+    //
+    // The filters are linear and share their parameters across the channels, so
+    // filtering before the conversion is the same as filtering after it.
+    template<bool TIsEax>
+    void feed_delay_line(
+        const int todo,
+        const SampleBuffers& src_samples,
+        const int base,
+        Samples& temp)
     {
-    }
+        for (int c = 0; c < 4; ++c)
+        {
+            if (TIsEax)
+            {
+                filters_[c].lp_.process(todo, &src_samples[c][base], temp[c].data());
+                filters_[c].hp_.process(todo, temp[c].data(), filtered_samples_[c].data());
+            }
+            else
+            {
+                filters_[c].lp_.process(todo, &src_samples[c][base], filtered_samples_[c].data());
+            }
+        }
 
+        const auto& in = filtered_samples_;
 
-protected:
-    void do_construct() final
-    {
-        buffer_length_ = 0;
+        auto i = 0;
 
-        for (auto& buffer : sample_buffers_)
+        // Convert four frames at once, then transpose them into the lines.
+        for ( ; (i + 4) <= todo; i += 4)
         {
-            buffer = SampleBuffer{};
+            Float4 b[4];
+            Float4 a[4];
+
+            for (int k = 0; k < 4; ++k)
+            {
+                b[k] = Float4::load(&in[k][i]);
+            }
+
+            for (int c = 0; c < 4; ++c)
+            {
+                const auto& row = b2a.m_[c];
+
+                a[c] = (Float4::set1(row[0]) * b[0]) + (Float4::set1(row[1]) * b[1]) +
+                    (Float4::set1(row[2]) * b[2]) + (Float4::set1(row[3]) * b[3]);
+            }
+
+            Float4::transpose(a[0], a[1], a[2], a[3]);
+
+            for (int k = 0; k < 4; ++k)
+            {
+                delay_line_in4(delay_, offset_ + i + k, a[k]);
+            }
         }
 
-        offset_ = 0;
-        lfo_range_ = 1;
-        waveform_ = Waveform::triangle;
-    }
+        // The columns of the conversion matrix.
+        const auto w = Float4::set(b2a.m_[0][0], b2a.m_[1][0], b2a.m_[2][0], b2a.m_[3][0]);
+        const auto x = Float4::set(b2a.m_[0][1], b2a.m_[1][1], b2a.m_[2][1], b2a.m_[3][1]);
+        const auto y = Float4::set(b2a.m_[0][2], b2a.m_[1][2], b2a.m_[2][2], b2a.m_[3][2]);
+        const auto z = Float4::set(b2a.m_[0][3], b2a.m_[1][3], b2a.m_[2][3], b2a.m_[3][3]);
 
-    void do_destruct() final
-    {
-        for (auto& buffer : sample_buffers_)
+        for ( ; i < todo; ++i)
         {
-            buffer = SampleBuffer{};
+            const auto a = (w * Float4::set1(in[0][i])) + (x * Float4::set1(in[1][i])) +
+                (y * Float4::set1(in[2][i])) + (z * Float4::set1(in[3][i]));
+
+            delay_line_in4(delay_, offset_ + i, a);
         }
+
+        delay_.mark_written(offset_, todo);
     }
 
-    void do_update_device(
-        Device& device) final
+    // Splits the interleaved frames into the four lines.
+    static void deinterleave(
+        const int todo,
+        const Frames& frames,
+        Samples& out)
     {
-        auto maxlen = static_cast<int>(EffectProps::Flanger::max_delay * 2.0F * device.sampling_rate_) + 1;
-        maxlen = Math::next_power_of_2(maxlen);
+        auto i = 0;
 
-        if (maxlen != buffer_length_)
+        for ( ; (i + 4) <= todo; i += 4)
         {
-            for (auto& buffer : sample_buffers_)
-            {
-                buffer.resize(maxlen);
-            }
+            auto v0 = Float4::load(frames[i + 0].data());
+            auto v1 = Float4::load(frames[i + 1].data());
+            auto v2 = Float4::load(frames[i + 2].data());
+            auto v3 = Float4::load(frames[i + 3].data());
 
-            buffer_length_ = maxlen;
+            Float4::transpose(v0, v1, v2, v3);
+
+            v0.store(&out[0][i]);
+            v1.store(&out[1][i]);
+            v2.store(&out[2][i]);
+            v3.store(&out[3][i]);
         }
 
-        for (auto& buffer : sample_buffers_)
+        for ( ; i < todo; ++i)
         {
-            std::fill(buffer.begin(), buffer.end(), 0.0F);
+            for (int j = 0; j < 4; ++j)
+            {
+                out[j][i] = frames[i][j];
+            }
         }
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+    void calc_modulation_delays(
+        int* delays,
+        const int todo)
     {
-        static_cast<void>(effect_slot);
+        // Calculate the sinus rhythm (dependent on modulation time and the
+        // sampling rate).
+        float sinus[max_update_samples];
 
-        const auto frequency = static_cast<float>(device.sampling_rate_);
-        AmbiCoeffs coeffs;
+        mod_.phase_ = Oscillator::generate<Oscillator::Waveform::sinusoid>(sinus, mod_.phase_, mod_.step_, todo);
+
+        auto range = mod_.filter_;
 
-        switch (effect_props.flanger_.waveform_)
+        for (int i = 0; i < todo; ++i)
         {
-        case EffectProps::Flanger::waveform_triangle:
-            waveform_ = Waveform::triangle;
-            break;
+            // The depth determines the range over which to read the input samples
+            // from, so it must be filtered to reduce the distortion caused by even
+            // small parameter changes.
+            range = Math::lerp(range, mod_.depth_, mod_.coeff_);
 
-        case EffectProps::Flanger::waveform_sinusoid:
-            waveform_ = Waveform::sinusoid;
-            break;
+            // Calculate the read offset.
+            delays[i] = Math::round_to_int(range * sinus[i]);
         }
 
-        feedback_ = effect_props.flanger_.feedback_;
-        delay_ = static_cast<int>(effect_props.flanger_.delay_ * frequency);
+        mod_.filter_ = range;
+    }
 
-        // The LFO depth is scaled to be relative to the sample delay.
-        depth_ = effect_props.flanger_.depth_ * delay_;
+    // Applies a scattering matrix to the 4-line (vector) input.  This is used
+    // for both the below vector all-pass model and to perform modal feed-back
+    // delay network (FDN) mixing.
+    //
+    // The matrix is derived from a skew-symmetric matrix to form a 4D rotation
+    // matrix with a single unitary rotational parameter:
+    //
+    //     [  d,  a,  b,  c ]          1 = a^2 + b^2 + c^2 + d^2
+    //     [ -a,  d,  c, -b ]
+    //     [ -b, -c,  d,  a ]
+    //     [ -c,  b, -a,  d ]
+    //
+    // The rotation is constructed from the effect's diffusion parameter,
+    // yielding:
+    //
+    //     1 = x^2 + 3 y^2
+    //
+    // Where a, b, and c are the coefficient y with differing signs, and d is the
+    // coefficient x.  The final matrix is thus:
+    //
+    //     [  x,  y, -y,  y ]          n = sqrt(matrix_order - 1)
+    //     [ -y,  x,  y,  y ]          t = diffusion_parameter * atan(n)
+    //     [  y, -y,  x,  y ]          x = cos(t)
+    //     [ -y, -y, -y,  x ]          y = sin(t) / n
+    //
+    // Any square orthogonal matrix with an order that is a power of two will
+    // work (where ^T is transpose, ^-1 is inverse):
+    //
+    //     M^T = M^-1
+    //
+    // Using that knowledge, finding an appropriate matrix can be accomplished
+    // naively by searching all combinations of:
+    //
+    //     M = D + S - S^T
+    //
+    // Where D is a diagonal matrix (of x), and S is a triangular matrix (of y)
+    // whose combination of signs are being iterated.
+    //
+    // The off-diagonal elements of each row are gathered by three shuffles, in
+    // column order, with their signs applied.
+    //
+    static Float4 vector_partial_scatter(
+        const Float4& vec,
+        const Float4& x_coeff,
+        const Float4& y_coeff)
+    {
+        const auto a = Float4::shuffle<1, 0, 0, 0>(vec) * Float4::set(1.0F, -1.0F, 1.0F, -1.0F);
+        const auto b = Float4::shuffle<2, 2, 1, 1>(vec) * Float4::set(-1.0F, 1.0F, -1.0F, -1.0F);
+        const auto c = Float4::shuffle<3, 3, 3, 2>(vec) * Float4::set(1.0F, 1.0F, 1.0F, -1.0F);
 
-        // Gains for left and right sides
-        Panning::calc_angle_coeffs(-Math::pi_2, 0.0F, 0.0F, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[0]);
-        Panning::calc_angle_coeffs(Math::pi_2, 0.0F, 0.0F, coeffs);
-        Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, sides_gains_[1]);
+        return (x_coeff * vec) + (y_coeff * ((a + b) + c));
+    }
 
-        const auto phase = effect_props.flanger_.phase_;
-        const auto rate = effect_props.flanger_.rate_;
+    // Applies the scattering matrix above to the lines held in four vectors,
+    // one line each, for the lanes of ReverbLanes.
+    template<typename TVector>
+    OALSFXPP_FORCE_INLINE static void scatter_lines(
+        const TVector& line0,
+        const TVector& line1,
+        const TVector& line2,
+        const TVector& line3,
+        const TVector& x_coeff,
+        const TVector& y_coeff,
+        TVector* out)
+    {
+        out[0] = (x_coeff * line0) + (y_coeff * ((line1 - line2) + line3));
+        out[1] = (x_coeff * line1) + (y_coeff * ((line2 - line0) + line3));
+        out[2] = (x_coeff * line2) + (y_coeff * ((line0 - line1) + line3));
+        out[3] = (x_coeff * line3) + (y_coeff * ((TVector::zero() - (line0 + line1)) - line2));
+    }
 
-        if (!(rate > 0.0F))
-        {
-            lfo_scale_ = 0.0F;
-            lfo_range_ = 1;
-            lfo_disp_ = 0;
-        }
-        else
-        {
-            // Calculate LFO coefficient
-            lfo_range_ = static_cast<int>(frequency / rate + 0.5F);
+    // This applies a Gerzon multiple-in/multiple-out (MIMO) vector all-pass
+    // filter to the 4-line input.
+    //
+    // It works by vectorizing a regular all-pass filter and replacing the delay
+    // element with a scattering matrix (like the one above) and a diagonal
+    // matrix of delay elements.
+    //
+    // Specializations are used for transitional (cross-faded) delay line
+    // processing and non-transitional processing.
+    //
+    template<bool TIsFaded>
+    static Float4 vector_allpass(
+        const Float4& vec,
+        const int offset,
+        const Float4& feed_coeff,
+        const Float4& x_coeff,
+        const Float4& y_coeff,
+        const Float4& mu,
+        VecAllpass& vap)
+    {
+        const auto out = delay_out<TIsFaded>(vap.delay_, offset, vap.offsets_, mu) - (feed_coeff * vec);
+        const auto f = vec + (feed_coeff * out);
 
-            switch (waveform_)
-            {
-            case Waveform::triangle:
-                lfo_scale_ = 4.0F / lfo_range_;
-                break;
+        delay_line_in4(vap.delay_, offset, vector_partial_scatter(f, x_coeff, y_coeff));
 
-            case Waveform::sinusoid:
-                lfo_scale_ = Math::tau / lfo_range_;
-                break;
-            }
+        return out;
+    }
 
-            // Calculate lfo phase displacement
-            if (phase >= 0)
-            {
-                lfo_disp_ = static_cast<int>(lfo_range_ * (phase / 360.0F));
-            }
-            else
-            {
-                lfo_disp_ = static_cast<int>(lfo_range_ * ((360 + phase) / 360.0F));
-            }
-        }
+    // A helper to reverse vector components.
+    static Float4 vector_reverse(
+        const Float4& vec)
+    {
+        return Float4::shuffle<3, 2, 1, 0>(vec);
     }
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+
+    // This generates early reflections.
+    //
+    // This is done by obtaining the primary reflections (those arriving from the
+    // same direction as the source) from the main delay line.  These are
+    // attenuated and all-pass filtered (based on the diffusion parameter).
+    //
+    // The early lines are then fed in reverse (according to the approximately
+    // opposite spatial location of the A-Format lines) to create the secondary
+    // reflections (those arriving from the opposite direction as the source).
+    //
+    // The early response is then completed by combining the primary reflections
+    // with the delayed and attenuated output from the early lines.
+    //
+    // Finally, the early response is reversed, scattered (based on diffusion),
+    // and fed into the late reverb section of the main delay line, unless
+    // there is no late reverb.
+    //
+    // The four lines are processed together, one per vector lane.
+    //
+    // Specializations are used for transitional (cross-faded) delay line
+    // processing and non-transitional processing.
+    //
+    template<bool TIsFaded, bool TIsLateFed>
+    void early_reflection(
+        const int todo,
+        float fade,
+        Samples& out)
     {
-        auto& left_buf = sample_buffers_[0];
-        auto& right_buf = sample_buffers_[1];
-        const auto buf_mask = buffer_length_ - 1;
+        const auto feed_coeff = Float4::set1(ap_feed_coeff_);
+        const auto x_coeff = Float4::set1(mix_x_);
+        const auto y_coeff = Float4::set1(mix_y_);
+        const auto delay_coeffs = Float4::load(early_delay_coeffs_.data());
+        const auto early_coeffs = Float4::load(early_.coeffs_.data());
 
-        for (int base = 0; base < sample_count; )
+        Frames frames;
+        auto current_offset = offset_;
+
+        for (int i = 0; i < todo; ++i)
         {
-            float temps[128][2];
-            int mod_delays[2][128];
+            const auto mu = Float4::set1(fade);
 
-            const auto todo = std::min(128, sample_count - base);
+            auto f = delay_out<TIsFaded>(delay_, current_offset, early_delay_taps_, mu) * delay_coeffs;
 
-            switch (waveform_)
-            {
-            case Waveform::triangle:
-                get_triangle_delays(
-                    mod_delays[0],
-                    offset_ % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+            f = vector_allpass<TIsFaded>(f, current_offset, feed_coeff, x_coeff, y_coeff, mu, early_.vec_ap_);
 
-                get_triangle_delays(
-                    mod_delays[1],
-                    (offset_ + lfo_disp_) % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+            delay_line_in4(early_.delay_, current_offset, vector_reverse(f));
 
-                break;
+            f = f + (delay_out<TIsFaded>(early_.delay_, current_offset, early_.offsets_, mu) * early_coeffs);
 
-            case Waveform::sinusoid:
-                get_sinusoid_delays(
-                    mod_delays[0],
-                    offset_ % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+            f.store(frames[i].data());
 
-                get_sinusoid_delays(
-                    mod_delays[1],
-                    (offset_ + lfo_disp_) % lfo_range_,
-                    lfo_range_,
-                    lfo_scale_,
-                    depth_,
-                    delay_,
-                    todo);
+            if (TIsLateFed)
+            {
+                f = vector_partial_scatter(vector_reverse(f), x_coeff, y_coeff);
 
-                break;
+                delay_line_in4(delay_, current_offset - late_feed_tap_, f);
             }
 
-            for (int i = 0; i < todo; ++i)
-            {
-                left_buf[offset_ & buf_mask] = src_samples[0][base + i];
-                temps[i][0] = left_buf[(offset_ - mod_delays[0][i]) & buf_mask] * feedback_;
-                left_buf[offset_ & buf_mask] += temps[i][0];
+            current_offset += 1;
+            fade += fade_step;
+        }
 
-                right_buf[offset_ & buf_mask] = src_samples[0][base + i];
-                temps[i][1] = right_buf[(offset_ - mod_delays[1][i]) & buf_mask] * feedback_;
-                right_buf[offset_ & buf_mask] += temps[i][1];
+        early_.vec_ap_.delay_.mark_written(offset_, todo);
+        early_.delay_.mark_written(offset_, todo);
 
-                offset_ += 1;
-            }
+        if (TIsLateFed)
+        {
+            delay_.mark_written(offset_ - late_feed_tap_, todo);
+        }
 
-            for (int c = 0; c < channel_count; ++c)
-            {
-                auto gain = sides_gains_[0][c];
+        deinterleave(todo, frames, out);
+    }
 
-                if (std::abs(gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < todo; i++)
-                    {
-                        dst_samples[c][i + base] += temps[i][0] * gain;
-                    }
-                }
+    // Feeds the late reverb section of the main delay line without generating
+    // the early reflections.
+    //
+    // The primary reflections are reversed, scattered and fed as is.
+    //
+    template<bool TIsFaded>
+    void feed_late_lines(
+        const int todo,
+        float fade)
+    {
+        const auto x_coeff = Float4::set1(mix_x_);
+        const auto y_coeff = Float4::set1(mix_y_);
+        const auto delay_coeffs = Float4::load(early_delay_coeffs_.data());
+
+        auto current_offset = offset_;
+
+        for (int i = 0; i < todo; ++i)
+        {
+            const auto mu = Float4::set1(fade);
 
-                gain = sides_gains_[1][c];
+            auto f = delay_out<TIsFaded>(delay_, current_offset, early_delay_taps_, mu) * delay_coeffs;
 
-                if (std::abs(gain) > silence_threshold_gain)
-                {
-                    for (int i = 0; i < todo; ++i)
-                    {
-                        dst_samples[c][i + base] += temps[i][1] * gain;
-                    }
-                }
-            }
+            f = vector_partial_scatter(vector_reverse(f), x_coeff, y_coeff);
 
-            base += todo;
+            delay_line_in4(delay_, current_offset - late_feed_tap_, f);
+
+            current_offset += 1;
+            fade += fade_step;
         }
-    }
 
+        delay_.mark_written(offset_ - late_feed_tap_, todo);
+    }
 
-private:
-    enum class Waveform
+    // The T60 damping filters of the four lines, one line per vector lane.
+    struct LateFilters
     {
-        triangle = EffectProps::Flanger::waveform_triangle,
-        sinusoid = EffectProps::Flanger::waveform_sinusoid,
-    }; // Waveform
+        Float4 lf_coeffs_[3];
+        Float4 hf_coeffs_[3];
+        Float4 mid_coeff_;
 
-    using SampleBuffer = EffectSampleBuffer;
-    using SampleBuffers = std::array<SampleBuffer, 2>;
-    using SidesGains = std::array<Gains, 2>;
+        Float4 states_[2][2];
+    }; // LateFilters
 
+    LateFilters load_late_filters() const
+    {
+        const auto& filters = late_.filters_;
 
-    SampleBuffers sample_buffers_;
-    int buffer_length_;
-    int offset_;
-    int lfo_range_;
-    float lfo_scale_;
-    int lfo_disp_;
+        auto result = LateFilters{};
 
-    // Gains for left and right sides
-    SidesGains sides_gains_;
+        for (int k = 0; k < 3; ++k)
+        {
+            result.lf_coeffs_[k] = Float4::set(
+                filters[0].lf_coeffs_[k], filters[1].lf_coeffs_[k], filters[2].lf_coeffs_[k], filters[3].lf_coeffs_[k]);
 
-    // effect parameters
-    Waveform waveform_;
-    int delay_;
-    float depth_;
-    float feedback_;
+            result.hf_coeffs_[k] = Float4::set(
+                filters[0].hf_coeffs_[k], filters[1].hf_coeffs_[k], filters[2].hf_coeffs_[k], filters[3].hf_coeffs_[k]);
+        }
 
+        result.mid_coeff_ = Float4::set(
+            filters[0].mid_coeff_, filters[1].mid_coeff_, filters[2].mid_coeff_, filters[3].mid_coeff_);
 
-    static void get_triangle_delays(
-        int* delays,
-        int offset,
-        const int lfo_range,
-        const float lfo_scale,
-        const float depth,
-        const int delay,
-        const int todo)
-    {
-        for (int i = 0; i < todo; ++i)
+        for (int s = 0; s < 2; ++s)
         {
-            delays[i] = static_cast<int>((1.0F - std::abs(2.0F - (lfo_scale * offset))) * depth) + delay;
-            offset = (offset + 1) % lfo_range;
+            for (int k = 0; k < 2; ++k)
+            {
+                result.states_[s][k] = Float4::set(
+                    filters[0].states_[s][k], filters[1].states_[s][k], filters[2].states_[s][k], filters[3].states_[s][k]);
+            }
         }
+
+        return result;
     }
 
-    static void get_sinusoid_delays(
-        int* delays,
-        int offset,
-        const int lfo_range,
-        const float lfo_scale,
-        const float depth,
-        const int delay,
-        const int todo)
+    void store_late_filter_states(
+        const LateFilters& late_filters)
     {
-        for (int i = 0; i < todo; ++i)
+        for (int s = 0; s < 2; ++s)
         {
-            delays[i] = static_cast<int>(std::sin(lfo_scale * offset) * depth) + delay;
-            offset = (offset + 1) % lfo_range;
+            for (int k = 0; k < 2; ++k)
+            {
+                float states[4];
+
+                late_filters.states_[s][k].store(states);
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    late_.filters_[i].states_[s][k] = states[i];
+                }
+            }
         }
     }
-}; // FlangerEffectState
 
+    // Applies a first order filter section.
+    static Float4 first_order_filter(
+        const Float4& in,
+        const Float4 coeffs[3],
+        Float4 state[2])
+    {
+        const auto out = (coeffs[0] * in) + (coeffs[1] * state[0]) + (coeffs[2] * state[1]);
 
-EffectState* EffectStateFactory::create_flanger()
-{
-    return create<FlangerEffectState>();
-}
-
+        state[0] = in;
+        state[1] = out;
 
-class RingModulatorEffectState :
-    public EffectState
-{
-public:
-    RingModulatorEffectState()
-        :
-        EffectState{},
-        process_func_{},
-        index_{},
-        step_{},
-        channels_gains_{},
-        filters_{}
-    {
+        return out;
     }
 
-    virtual ~RingModulatorEffectState()
+    // Applies the two T60 damping filter sections.
+    static Float4 late_t60_filter(
+        LateFilters& filters,
+        const Float4& in)
     {
-    }
+        const auto out = first_order_filter(in, filters.lf_coeffs_, filters.states_[0]);
 
+        return filters.mid_coeff_ * first_order_filter(out, filters.hf_coeffs_, filters.states_[1]);
+    }
 
-protected:
-    void do_construct() final
+    // Reads the input of the late reverb from the main delay line, attenuated
+    // by the density gain.
+    template<bool TIsFaded>
+    void read_late_input(
+        const int todo,
+        float fade,
+        Frames& frames)
     {
-        index_ = 0;
-        step_ = 1;
+        const auto density_gain = Float4::set1(late_.density_gain_);
 
-        for (int i = 0; i < max_effect_channels; ++i)
+        auto current_offset = offset_;
+
+        for (int i = 0; i < todo; ++i)
         {
-            filters_[i].clear();
-        }
-    }
+            const auto mu = Float4::set1(fade);
 
-    void do_destruct() final
-    {
-    }
+            const auto f = delay_out<TIsFaded>(delay_, current_offset, late_delay_taps_, mu) * density_gain;
 
-    void do_update_device(
-        Device& device) final
-    {
-        static_cast<void>(device);
+            f.store(frames[i].data());
+
+            current_offset += 1;
+            fade += fade_step;
+        }
     }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+    // This generates the reverb tail using a modified feed-back delay network
+    // (FDN).
+    //
+    // Results from the early reflections (already attenuated by the density
+    // gain) are mixed in place with the output from the late delay lines.
+    //
+    // The late response is then completed by T60 and all-pass filtering the mix.
+    //
+    // Finally, the lines are reversed (so they feed their opposite directions)
+    // and scattered with the FDN matrix before re-feeding the delay lines.
+    //
+    // The four lines are processed together, one per vector lane.
+    //
+    // Specializations are used for transitional (cross-faded) delay line
+    // processing and non-transitional processing, and for the late lines with
+    // and without modulation.
+    //
+    template<bool TIsFaded, bool TIsModulated>
+    void late_reverb(
+        const int todo,
+        float fade,
+        const float step,
+        Frames& frames)
     {
-        static_cast<void>(effect_slot);
+        int moddelay[max_update_samples];
 
-        if (effect_props.ring_modulator_.waveform_ == EffectProps::RingModulator::waveform_sinusoid)
-        {
-            process_func_ = modulate_sin;
-        }
-        else if (effect_props.ring_modulator_.waveform_ == EffectProps::RingModulator::waveform_sawtooth)
+        if (TIsModulated)
         {
-            process_func_ = modulate_saw;
+            calc_modulation_delays(moddelay, todo);
         }
         else
         {
-            process_func_ = modulate_square;
+            mod_.phase_ += mod_.step_ * static_cast<Oscillator::Phase>(todo);
         }
 
-        step_ = static_cast<int>(effect_props.ring_modulator_.frequency_ * waveform_frac_one / device.sampling_rate_);
+        const auto feed_coeff = Float4::set1(ap_feed_coeff_);
+        const auto x_coeff = Float4::set1(mix_x_);
+        const auto y_coeff = Float4::set1(mix_y_);
 
-        if (step_ == 0)
-        {
-            step_ = 1;
-        }
+        auto filters = load_late_filters();
 
-        // Custom filter coeffs, which match the old version instead of a low-shelf.
-        const auto cw = std::cos(Math::tau * effect_props.ring_modulator_.high_pass_cutoff_ / device.sampling_rate_);
-        const auto a = (2.0F - cw) - std::sqrt(std::pow(2.0F - cw, 2.0F) - 1.0F);
+        auto current_offset = late_offset_;
 
-        for (int i = 0; i < max_effect_channels; ++i)
+        for (int i = 0; i < todo; i++)
         {
-            filters_[i].b0_ = a;
-            filters_[i].b1_ = -a;
-            filters_[i].b2_ = 0.0F;
-            filters_[i].a1_ = -a;
-            filters_[i].a2_ = 0.0F;
-        }
+            const auto mu = Float4::set1(std::min(fade, 1.0F));
 
-        dst_buffers_ = &device.sample_buffers_;
-        dst_channel_count_ = device.channel_count_;
+            const auto read_offset = (TIsModulated ? current_offset - moddelay[i] : current_offset);
 
-        for (int i = 0; i < max_effect_channels; ++i)
-        {
-            Panning::compute_first_order_gains(
-                device.channel_count_,
-                device.foa_,
-                mat4f_identity.m_[i],
-                1.0F,
-                channels_gains_[i]);
-        }
-    }
+            auto f = Float4::load(frames[i].data());
 
-    void do_process(
-        const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
-    {
-        for (int base = 0; base < sample_count; )
-        {
-            float temps[2][128];
-            const auto td = std::min(128, sample_count - base);
+            f = f + delay_out<TIsFaded>(late_.delay_, read_offset, late_.offsets_, mu);
 
-            for (int j = 0; j < max_effect_channels; ++j)
-            {
-                filters_[j].process(td, &src_samples[j][base], temps[0]);
-                process_func_(temps[1], temps[0], index_, step_, td);
+            f = late_t60_filter(filters, f);
 
-                for (int k = 0; k < channel_count; ++k)
-                {
-                    const auto gain = channels_gains_[j][k];
+            f = vector_allpass<TIsFaded>(f, current_offset, feed_coeff, x_coeff, y_coeff, mu, late_.vec_ap_);
 
-                    if (!(std::abs(gain) > silence_threshold_gain))
-                    {
-                        continue;
-                    }
+            f.store(frames[i].data());
 
-                    for (int i = 0; i < td; ++i)
-                    {
-                        dst_samples[k][base + i] += gain * temps[1][i];
-                    }
-                }
-            }
+            f = vector_partial_scatter(vector_reverse(f), x_coeff, y_coeff);
 
-            for (int i = 0; i < td; ++i)
-            {
-                index_ += step_;
-                index_ &= waveform_frac_mask;
-            }
+            delay_line_in4(late_.delay_, current_offset, f);
 
-            base += td;
+            current_offset += 1;
+            fade += step;
         }
-    }
-
-
-private:
-    static constexpr auto waveform_frac_bits = 24;
-    static constexpr auto waveform_frac_one = 1 << waveform_frac_bits;
-    static constexpr auto waveform_frac_mask = waveform_frac_one - 1;
 
+        store_late_filter_states(filters);
 
-    using ChannelsGains = std::array<Gains, max_effect_channels>;
-    using Filters = std::array<FilterState, max_effect_channels>;
+        late_.vec_ap_.delay_.mark_written(late_offset_, todo);
+        late_.delay_.mark_written(late_offset_, todo);
 
-    using ModulateFunc = float (*)(
-        const int index);
+        late_offset_ = current_offset & offset_mask;
+    }
 
-    using ProcessFunc = void (*)(
-        float* const dst,
-        const float* const src,
-        int index,
-        const int step,
-        const int todo);
+    // Halves the rate of the late input by averaging pairs of frames.
+    //
+    // Returns the number of the resulting frames.
+    int decimate_late_input(
+        const int todo,
+        const Frames& src_frames,
+        Frames& dst_frames)
+    {
+        const auto half = Float4::set1(0.5F);
 
+        auto count = 0;
+        auto i = 0;
 
-    ProcessFunc process_func_;
-    int index_;
-    int step_;
-    ChannelsGains channels_gains_;
-    Filters filters_;
+        if (late_.has_input_carry_ && todo > 0)
+        {
+            const auto f = (Float4::load(late_.input_carry_.data()) + Float4::load(src_frames[0].data())) * half;
 
+            f.store(dst_frames[count++].data());
 
-    static float sin_func(
-        const int index)
-    {
-        return std::sin(index * (Math::tau / waveform_frac_one) - Math::pi) * 0.5F + 0.5F;
-    }
+            late_.has_input_carry_ = false;
+            i = 1;
+        }
 
-    static float saw_func(
-        const int index)
-    {
-        return static_cast<float>(index) / waveform_frac_one;
-    }
+        for ( ; (i + 2) <= todo; i += 2)
+        {
+            const auto f = (Float4::load(src_frames[i].data()) + Float4::load(src_frames[i + 1].data())) * half;
 
-    static float square_func(
-        const int index)
-    {
-        return static_cast<float>((index >> (waveform_frac_bits - 1)) & 1);
-    }
+            f.store(dst_frames[count++].data());
+        }
 
-    static void modulate(
-        const ModulateFunc func,
-        float* const dst,
-        const float* const src,
-        int index,
-        const int step,
-        const int todo)
-    {
-        for (int i = 0; i < todo; ++i)
+        if (i < todo)
         {
-            index += step;
-            index &= waveform_frac_mask;
-            dst[i] = src[i] * func(index);
+            late_.input_carry_ = src_frames[i];
+            late_.has_input_carry_ = true;
         }
-    }
 
-    static void modulate_sin(
-        float* const dst,
-        const float* const src,
-        int index,
-        const int step,
-        const int todo)
-    {
-        modulate(sin_func, dst, src, index, step, todo);
+        return count;
     }
 
-    static void modulate_saw(
-        float* const dst,
-        const float* const src,
-        int index,
-        const int step,
-        const int todo)
+    // Restores the rate of the late output by linear interpolation.
+    //
+    // Each half rate frame yields the frame midway from its predecessor and
+    // itself.
+    void interpolate_late_output(
+        const int count,
+        const Frames& src_frames,
+        const int todo,
+        Frames& dst_frames)
     {
-        modulate(saw_func, dst, src, index, step, todo);
-    }
+        const auto half = Float4::set1(0.5F);
 
-    static void modulate_square(
-        float* const dst,
-        const float* const src,
-        int index,
-        const int step,
-        const int todo)
-    {
-        modulate(square_func, dst, src, index, step, todo);
-    }
-}; // ModulatorEffectState
+        auto last = Float4::load(late_.output_last_.data());
 
+        auto i = 0;
 
-EffectState* EffectStateFactory::create_ring_modulator()
-{
-    return create<RingModulatorEffectState>();
-}
+        if (late_.has_output_pending_)
+        {
+            dst_frames[i++] = late_.output_pending_;
 
+            late_.has_output_pending_ = false;
+        }
 
-class ReverbEffectState :
-    public EffectState
-{
-public:
-    ReverbEffectState()
-        :
-        EffectState{},
-        is_eax_{},
-        filters_{},
-        delay_{},
-        early_delay_taps_{},
-        early_delay_coeffs_{},
-        late_feed_tap_{},
-        late_delay_taps_{},
-        ap_feed_coeff_{},
-        mix_x_{},
-        mix_y_{},
-        early_{},
-        mod_{},
-        late_{},
-        fade_count_{},
-        offset_{},
-        a_format_samples_{},
-        reverb_samples_{},
-        early_samples_{}
+        for (int j = 0; j < count; ++j)
+        {
+            const auto f = Float4::load(src_frames[j].data());
+
+            ((last + f) * half).store(dst_frames[i++].data());
+
+            if (i < todo)
+            {
+                f.store(dst_frames[i++].data());
+            }
+            else
+            {
+                f.store(late_.output_pending_.data());
+
+                late_.has_output_pending_ = true;
+            }
+
+            last = f;
+        }
+
+        last.store(late_.output_last_.data());
+    }
+
+    float get_fade() const
     {
+        return static_cast<float>(fade_count_) * fade_step;
     }
 
-    virtual ~ReverbEffectState()
+    // The late lines run at half the rate with the half rate quality, and so
+    // does their cross-fade.
+    float get_late_fade_step() const
     {
+        return (quality_ == EffectProps::Reverb::quality_half_rate_late ? 2.0F * fade_step : fade_step);
     }
 
+    // Modulation shorter than half a sample would not move the reads.
+    bool is_late_modulated() const
+    {
+        return
+            quality_ != EffectProps::Reverb::quality_no_modulation &&
+            (std::abs(mod_.depth_) >= 0.5F || std::abs(mod_.filter_) >= 0.5F);
+    }
 
-protected:
-    void do_construct() final
+    // The frames the late lines run on.
+    Frames& get_late_frames()
     {
-        is_eax_ = false;
+        return (quality_ == EffectProps::Reverb::quality_half_rate_late ? half_rate_frames_ : late_frames_);
+    }
 
-        for (int i = 0; i < 4; ++i)
+    // Reads the input of the late lines for the quality in use.
+    template<bool TIsFaded>
+    void begin_late_pass(
+        const int todo,
+        const float fade)
+    {
+        late_count_ = 0;
+
+        if (quality_ == EffectProps::Reverb::quality_early_only)
         {
-            filters_[i].lp_.clear();
-            filters_[i].hp_.clear();
+            return;
         }
 
-        delay_.reset();
+        read_late_input<TIsFaded>(todo, fade, late_frames_);
 
-        for (int i = 0; i < 4; ++i)
+        if (quality_ == EffectProps::Reverb::quality_half_rate_late)
         {
-            early_delay_taps_[i][0] = 0;
-            early_delay_taps_[i][1] = 0;
-            early_delay_coeffs_[i] = 0.0F;
+            late_count_ = decimate_late_input(todo, late_frames_, half_rate_frames_);
+        }
+        else
+        {
+            late_count_ = todo;
         }
+    }
 
-        late_feed_tap_ = 0;
+    template<bool TIsFaded>
+    void run_late_lines()
+    {
+        if (is_late_modulated())
+        {
+            late_reverb<TIsFaded, true>(late_count_, get_fade(), get_late_fade_step(), get_late_frames());
+        }
+        else
+        {
+            late_reverb<TIsFaded, false>(late_count_, get_fade(), get_late_fade_step(), get_late_frames());
+        }
+    }
 
-        for (int i = 0; i < 4; ++i)
+    // Completes the late response at the device rate.
+    void end_late_pass(
+        const int todo)
+    {
+        if (quality_ == EffectProps::Reverb::quality_early_only)
         {
-            late_delay_taps_[i][0] = 0;
-            late_delay_taps_[i][1] = 0;
+            return;
         }
 
-        ap_feed_coeff_ = 0.0F;
-        mix_x_ = 0.0F;
-        mix_y_ = 0.0F;
+        if (quality_ == EffectProps::Reverb::quality_half_rate_late)
+        {
+            interpolate_late_output(late_count_, half_rate_frames_, todo, late_frames_);
+        }
 
-        early_.vec_ap_.delay_.reset();
-        early_.delay_.reset();
+        deinterleave(todo, late_frames_, reverb_samples_);
+    }
 
-        for (int i = 0; i < 4; ++i)
+    static bool are_gains_reached(
+        const ChannelsGains& current_gains,
+        const ChannelsGains& target_gains,
+        const int channel_count)
+    {
+        for (int c = 0; c < 4; ++c)
         {
-            early_.vec_ap_.offsets_[i][0] = 0;
-            early_.vec_ap_.offsets_[i][1] = 0;
-            early_.offsets_[i][0] = 0;
-            early_.offsets_[i][1] = 0;
-            early_.coeffs_[i] = 0.0F;
+            for (int k = 0; k < channel_count; ++k)
+            {
+                if (std::abs(target_gains[c][k] - current_gains[c][k]) > Math::get_epsilon())
+                {
+                    return false;
+                }
+            }
         }
 
-        mod_.index_ = 0;
-        mod_.range_ = 1;
-        mod_.depth_ = 0.0F;
-        mod_.coeff_ = 0.0F;
-        mod_.filter_ = 0.0F;
-
-        late_.density_gain_ = 0.0F;
+        return true;
+    }
 
-        late_.delay_.reset();
-        late_.vec_ap_.delay_.reset();
+    // Mixes the early and the late responses when neither is panned.
+    //
+    // Both then share the panning gains up to a scale, so each line is summed
+    // with its counterpart first and mixed once.
+    void mix_unpanned(
+        const int todo,
+        SampleBuffers& dst_samples,
+        const int base,
+        const int channel_count)
+    {
+        const auto early_gain = Float4::set1(early_.gain_);
+        const auto late_gain = Float4::set1(late_.gain_);
 
-        for (int i = 0; i < 4; ++i)
+        for (int c = 0; c < 4; ++c)
         {
-            late_.offsets_[i][0] = 0;
-            late_.offsets_[i][1] = 0;
+            auto& early = early_samples_[c];
+            const auto& late = reverb_samples_[c];
 
-            late_.vec_ap_.offsets_[i][0] = 0;
-            late_.vec_ap_.offsets_[i][1] = 0;
+            auto i = 0;
 
-            for (int j = 0; j < 3; ++j)
+            for ( ; (i + 4) <= todo; i += 4)
             {
-                late_.filters_[i].lf_coeffs_[j] = 0.0F;
-                late_.filters_[i].hf_coeffs_[j] = 0.0F;
-            }
+                const auto sum = (Float4::load(&early[i]) * early_gain) + (Float4::load(&late[i]) * late_gain);
 
-            late_.filters_[i].mid_coeff_ = 0.0F;
+                sum.store(&early[i]);
+            }
 
-            late_.filters_[i].states_[0][0] = 0.0F;
-            late_.filters_[i].states_[0][1] = 0.0F;
-            late_.filters_[i].states_[1][0] = 0.0F;
-            late_.filters_[i].states_[1][1] = 0.0F;
-        }
+            for ( ; i < todo; ++i)
+            {
+                early[i] = (early[i] * early_.gain_) + (late[i] * late_.gain_);
+            }
 
-        for (int i = 0; i < 4; ++i)
-        {
-            for (int j = 0; j < max_channels; ++j)
+            for (int k = 0; k < channel_count; ++k)
             {
-                early_.current_gains_[i][j] = 0.0F;
-                early_.pan_gains_[i][j] = 0.0F;
-                late_.current_gains_[i][j] = 0.0F;
-                late_.pan_gains_[i][j] = 0.0F;
+                const auto gain = unpanned_gains_[c][k];
+
+                if (!(std::abs(gain) > silence_threshold_gain))
+                {
+                    continue;
+                }
+
+                Kernels::current.mix_(early.data(), &dst_samples[k][base], gain, todo);
             }
         }
-
-        fade_count_ = 0;
-        offset_ = 0;
     }
 
-    void do_destruct() final
+    // Generates the early reflections for the quality in use.
+    template<bool TIsFaded>
+    void early_pass(
+        const int todo,
+        const float fade,
+        Samples& out)
     {
+        switch (quality_)
+        {
+        case EffectProps::Reverb::quality_late_only:
+            feed_late_lines<TIsFaded>(todo, fade);
+            break;
+
+        case EffectProps::Reverb::quality_early_only:
+            early_reflection<TIsFaded, false>(todo, fade, out);
+            break;
+
+        default:
+            early_reflection<TIsFaded, true>(todo, fade, out);
+            break;
+        }
     }
+}; // ReverbEffectState
 
-    void do_update_device(
-        Device& device) final
-    {
-        const auto frequency = device.sampling_rate_;
+constexpr int ReverbEffectState::max_update_samples;
+constexpr float ReverbEffectState::max_late_hf_scale;
+constexpr Mat4F ReverbEffectState::b2a;
+constexpr Mat4F ReverbEffectState::a2b;
+constexpr float ReverbEffectState::early_tap_lengths[4];
+constexpr float ReverbEffectState::early_allpass_lengths[4];
+constexpr float ReverbEffectState::early_line_lengths[4];
+constexpr float ReverbEffectState::late_allpass_lengths[4];
+constexpr float ReverbEffectState::late_line_lengths[4];
 
-        // Allocate the delay lines.
-        alloc_lines(frequency);
 
-        // Calculate the modulation filter coefficient.  Notice that the exponent
-        // is calculated given the current sample rate.  This ensures that the
-        // resulting filter response over time is consistent across all sample
-        // rates.
-        mod_.coeff_ = std::pow(modulation_filter_coeff, modulation_filter_const / frequency);
+EffectState* EffectStateFactory::create_reverb()
+{
+    return create<ReverbEffectState>();
+}
 
-        const auto multiplier = 1.0F + line_multiplier;
+// Effects
+// ==========================================================================
 
-        // The late feed taps are set a fixed position past the latest delay tap.
-        for (int i = 0; i < 4; ++i)
-        {
-            late_feed_tap_ = static_cast<int>(
-                (EffectProps::Reverb::max_reflections_delay + (early_tap_lengths[3] * multiplier)) * frequency);
-        }
-    }
 
-    void do_update(
-        Device& device,
-        const EffectSlot& effect_slot,
-        const EffectProps& effect_props) final
+// ==========================================================================
+// EffectBatch
+
+// Instances of an effect, one in each lane of the vectors.
+//
+// The lanes are as wide as the vectors of the kernels in use: sixteen with
+// AVX-512, eight with AVX2 and four otherwise.
+class EffectLanes
+{
+public:
+    static constexpr auto max_lane_count = 16;
+
+    using SrcSamples = std::array<const float*, max_lane_count>;
+
+    // The left and right outputs of each lane.
+    using DstSamples = std::array<float*, 2 * max_lane_count>;
+
+
+    EffectLanes(
+        const EffectLanes& that) = delete;
+
+    EffectLanes& operator=(
+        const EffectLanes& that) = delete;
+
+    virtual ~EffectLanes()
     {
-        if (effect_slot.effect_.type_ == EffectType::eax_reverb)
-        {
-            is_eax_ = true;
-        }
-        else if (effect_slot.effect_.type_ == EffectType::reverb)
-        {
-            is_eax_ = false;
-        }
+    }
 
-        const auto frequency = device.sampling_rate_;
 
-        // Calculate the master filters
-        const auto hf_scale = effect_props.reverb_.hf_reference_ / frequency;
+    virtual int get_lane_count() const = 0;
 
-        // Restrict the filter gains from going below -60dB to keep the filter from
-        // killing most of the signal.
-        const auto gain_hf = std::max(effect_props.reverb_.gain_hf_, 0.001F);
+    // Allocates the state for the device and silences it.
+    virtual void update_device(
+        Device& device) = 0;
 
-        filters_[0].lp_.set_params(
-            FilterType::high_shelf,
-            gain_hf,
-            hf_scale,
-            FilterState::calc_rcp_q_from_slope(gain_hf, 1.0F));
+    // Updates the parameters of the lane.
+    virtual void update(
+        const int lane,
+        Device& device,
+        const EffectProps& effect_props) = 0;
 
-        const auto lf_scale = effect_props.reverb_.lf_reference_ / frequency;
+    // Processes the lanes.
+    //
+    // Only the first "used_lane_count" lanes run instances. The others are
+    // fed silence and their output is discarded, so they may be skipped.
+    virtual void process(
+        const int sample_count,
+        const int used_lane_count,
+        const SrcSamples& src_samples,
+        const DstSamples& dst_samples) = 0;
 
-        const auto gain_lf = std::max(effect_props.reverb_.gain_lf_, 0.001F);
 
-        filters_[0].hp_.set_params(
-            FilterType::low_shelf,
-            gain_lf,
-            lf_scale,
-            FilterState::calc_rcp_q_from_slope(gain_lf, 1.0F));
+protected:
+    EffectLanes()
+    {
+    }
+}; // EffectLanes
 
-        for (int i = 1; i < 4; ++i)
+// Transposes the planar samples of the lanes into frames of one sample of
+// each lane, and back.
+template<typename TVector>
+struct LanesTranspose
+{
+    // Gathers a frame of the delay line with a tap of its own for each lane.
+    template<typename TFrame>
+    OALSFXPP_FORCE_INLINE static TVector gather(
+        const TFrame* frames,
+        const int mask,
+        const int offset,
+        const int* taps)
+    {
+        TVector result;
+
+        for (int lane = 0; lane < TVector::lane_count; ++lane)
         {
-            FilterState::copy_params(filters_[0].lp_, filters_[i].lp_);
-            FilterState::copy_params(filters_[0].hp_, filters_[i].hp_);
+            result.v_[lane] = frames[(offset - taps[lane]) & mask][lane];
         }
 
-        // Update the main effect delay and associated taps.
-        update_delay_line(
-            effect_props.reverb_.reflections_delay_,
-            effect_props.reverb_.late_reverb_delay_,
-            effect_props.reverb_.density_,
-            effect_props.reverb_.decay_time_,
-            frequency);
+        return result;
+    }
 
-        // Calculate the all-pass feed-back/forward coefficient.
-        ap_feed_coeff_ = std::sqrt(0.5F) * std::pow(effect_props.reverb_.diffusion_, 2.0F);
+    OALSFXPP_FORCE_INLINE static void load(
+        const EffectLanes::SrcSamples& src_samples,
+        const int base,
+        const int sample_count,
+        TVector* frames)
+    {
+        for (int lane = 0; lane < TVector::lane_count; ++lane)
+        {
+            const auto src = &src_samples[lane][base];
 
-        // Update the early lines.
-        update_early_lines(effect_props.reverb_.density_, effect_props.reverb_.decay_time_, frequency);
+            for (int i = 0; i < sample_count; ++i)
+            {
+                frames[i].v_[lane] = src[i];
+            }
+        }
+    }
 
-        // Get the mixing matrix coefficients.
-        calc_matrix_coeffs(effect_props.reverb_.diffusion_, &mix_x_, &mix_y_);
+    OALSFXPP_FORCE_INLINE static void store(
+        const TVector* frames,
+        const int base,
+        const int sample_count,
+        const int side,
+        const EffectLanes::DstSamples& dst_samples)
+    {
+        for (int lane = 0; lane < TVector::lane_count; ++lane)
+        {
+            const auto dst = &dst_samples[side + (2 * lane)][base];
 
-        // If the HF limit parameter is flagged, calculate an appropriate limit
-        // based on the air absorption parameter.
-        auto hf_ratio = effect_props.reverb_.decay_hf_ratio_;
+            for (int i = 0; i < sample_count; ++i)
+            {
+                dst[i] = frames[i].v_[lane];
+            }
+        }
+    }
+}; // LanesTranspose
 
-        if (effect_props.reverb_.decay_hf_limit_ && effect_props.reverb_.air_absorption_gain_hf_ < 1.0F)
-        {
-            hf_ratio = calc_limited_hf_ratio(
-                hf_ratio,
-                effect_props.reverb_.air_absorption_gain_hf_,
-                effect_props.reverb_.decay_time_);
+template<>
+struct LanesTranspose<Float4>
+{
+    template<typename TFrame>
+    static Float4 gather(
+        const TFrame* frames,
+        const int mask,
+        const int offset,
+        const int* taps)
+    {
+        return Float4::set(
+            frames[(offset - taps[0]) & mask][0],
+            frames[(offset - taps[1]) & mask][1],
+            frames[(offset - taps[2]) & mask][2],
+            frames[(offset - taps[3]) & mask][3]);
+    }
+
+    static void load(
+        const EffectLanes::SrcSamples& src_samples,
+        const int base,
+        const int sample_count,
+        Float4* frames)
+    {
+        auto i = 0;
+
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            auto v0 = Float4::load(&src_samples[0][base + i]);
+            auto v1 = Float4::load(&src_samples[1][base + i]);
+            auto v2 = Float4::load(&src_samples[2][base + i]);
+            auto v3 = Float4::load(&src_samples[3][base + i]);
+
+            Float4::transpose(v0, v1, v2, v3);
+
+            frames[i + 0] = v0;
+            frames[i + 1] = v1;
+            frames[i + 2] = v2;
+            frames[i + 3] = v3;
         }
 
-        // Calculate the LF/HF decay times.
-        const auto lf_decay_time = Math::clamp(
-            effect_props.reverb_.decay_time_ * effect_props.reverb_.decay_lf_ratio_,
-            EffectProps::Reverb::min_decay_time,
-            EffectProps::Reverb::max_decay_time);
+        for ( ; i < sample_count; ++i)
+        {
+            frames[i] = Float4::set(
+                src_samples[0][base + i],
+                src_samples[1][base + i],
+                src_samples[2][base + i],
+                src_samples[3][base + i]);
+        }
+    }
 
-        const auto hf_decay_time = Math::clamp(
-            effect_props.reverb_.decay_time_ * hf_ratio,
-            EffectProps::Reverb::min_decay_time,
-            EffectProps::Reverb::max_decay_time);
+    static void store(
+        const Float4* frames,
+        const int base,
+        const int sample_count,
+        const int side,
+        const EffectLanes::DstSamples& dst_samples)
+    {
+        auto i = 0;
 
-        // Update the modulator line.
-        update_modulator(effect_props.reverb_.modulation_time_, effect_props.reverb_.modulation_depth_, frequency);
+        for ( ; (i + 4) <= sample_count; i += 4)
+        {
+            auto v0 = frames[i + 0];
+            auto v1 = frames[i + 1];
+            auto v2 = frames[i + 2];
+            auto v3 = frames[i + 3];
 
-        // Update the late lines.
-        update_late_lines(
-            effect_props.reverb_.density_,
-            effect_props.reverb_.diffusion_,
-            lf_decay_time,
-            effect_props.reverb_.decay_time_,
-            hf_decay_time,
-            Math::tau * lf_scale,
-            Math::tau * hf_scale,
-            effect_props.reverb_.echo_time_,
-            effect_props.reverb_.echo_depth_,
-            frequency);
+            Float4::transpose(v0, v1, v2, v3);
 
-        // Update early and late 3D panning.
-        update_3d_panning(
-            device,
-            effect_props.reverb_.reflections_pan_.data(),
-            effect_props.reverb_.late_reverb_pan_.data(),
-            effect_props.reverb_.gain_,
-            effect_props.reverb_.reflections_gain_,
-            effect_props.reverb_.late_reverb_gain_);
+            v0.store(&dst_samples[side + 0][base + i]);
+            v1.store(&dst_samples[side + 2][base + i]);
+            v2.store(&dst_samples[side + 4][base + i]);
+            v3.store(&dst_samples[side + 6][base + i]);
+        }
 
-        // Determine if delay-line cross-fading is required.
-        for (int i = 0; i < 4; ++i)
+        for ( ; i < sample_count; ++i)
         {
-            if (early_delay_taps_[i][1] != early_delay_taps_[i][0] ||
-                early_.vec_ap_.offsets_[i][1] != early_.vec_ap_.offsets_[i][0] ||
-                early_.offsets_[i][1] != early_.offsets_[i][0] ||
-                late_delay_taps_[i][1] != late_delay_taps_[i][0] ||
-                late_.vec_ap_.offsets_[i][1] != late_.vec_ap_.offsets_[i][0] ||
-                late_.offsets_[i][1] != late_.offsets_[i][0])
+            float lanes[4];
+
+            frames[i].store(lanes);
+
+            for (int lane = 0; lane < 4; ++lane)
             {
-                fade_count_ = 0;
-                break;
+                dst_samples[side + (2 * lane)][base + i] = lanes[lane];
             }
         }
     }
+}; // LanesTranspose
 
-    void do_process(
+// Instances of an effect in the lanes of the vectors of type TVector.
+//
+// The input of the lanes is transposed into frames of one sample of each
+// lane, so the recurrences of the instances advance together. The output
+// frames are transposed back into the planar buffers.
+//
+// The effect (TDerived) processes the frames of a tile in "process_frames".
+template<typename TDerived, typename TVector>
+class EffectLanesT :
+    public EffectLanes
+{
+public:
+    static constexpr auto lane_count = TVector::lane_count;
+
+
+    int get_lane_count() const final
+    {
+        return lane_count;
+    }
+
+    void process(
         const int sample_count,
-        const SampleBuffers& src_samples,
-        SampleBuffers& dst_samples,
-        const int channel_count) final
+        const int used_lane_count,
+        const SrcSamples& src_samples,
+        const DstSamples& dst_samples) final
     {
-        const auto reverb_func = (is_eax_ ? &ReverbEffectState::eax_verb_pass : &ReverbEffectState::verb_pass);
-        auto fade = static_cast<float>(fade_count_) / fade_samples;
+        static_cast<void>(used_lane_count);
 
-        // Process reverb for these samples.
+        LanesTarget<TVector>::run(*this, sample_count, &src_samples, &dst_samples);
+    }
+
+    // Processes the samples in tiles, for LanesTarget.
+    OALSFXPP_FORCE_INLINE void run(
+        const int sample_count,
+        const SrcSamples* src_samples,
+        const DstSamples* dst_samples)
+    {
         for (int base = 0; base < sample_count; )
         {
-            auto todo = std::min(sample_count - base, max_update_samples);
+            const auto todo = std::min(max_tile_samples, sample_count - base);
 
-            // If cross-fading, don't do more samples than there are to fade.
-            if (fade_samples - fade_count_ > 0)
-            {
-                todo = std::min(todo, fade_samples - fade_count_);
-            }
+            LanesTranspose<TVector>::load(*src_samples, base, todo, src_frames_.data());
 
-            // Convert B-Format to A-Format for processing.
-            for (auto& samples : a_format_samples_)
-            {
-                samples.fill(0.0F);
-            }
+            static_cast<TDerived*>(this)->process_frames(todo, src_frames_, dst_frames_);
 
-            for (int c = 0; c < 4; ++c)
-            {
-                MixHelpers::mix_row(
-                    a_format_samples_[c].data(),
-                    b2a.m_[c],
-                    src_samples,
-                    max_effect_channels,
-                    base,
-                    todo);
-            }
+            LanesTranspose<TVector>::store(dst_frames_[0].data(), base, todo, 0, *dst_samples);
+            LanesTranspose<TVector>::store(dst_frames_[1].data(), base, todo, 1, *dst_samples);
 
-            // Process the samples for reverb.
-            fade = (this->*reverb_func)(todo, fade, a_format_samples_, early_samples_, reverb_samples_);
+            base += todo;
+        }
+    }
 
-            if (fade_count_ < fade_samples)
-            {
-                fade_count_ += todo;
 
-                if (fade_count_ >= fade_samples)
-                {
-                    // Update the cross-fading delay line taps.
-                    fade_count_ = fade_samples;
-                    fade = 1.0F;
+protected:
+    // The samples processed for each inner loop iteration.
+    static constexpr auto max_tile_samples = 64;
 
-                    for (int c = 0; c < 4; ++c)
-                    {
-                        early_delay_taps_[c][0] = early_delay_taps_[c][1];
-                        early_.vec_ap_.offsets_[c][0] = early_.vec_ap_.offsets_[c][1];
-                        early_.offsets_[c][0] = early_.offsets_[c][1];
-                        late_delay_taps_[c][0] = late_delay_taps_[c][1];
-                        late_.vec_ap_.offsets_[c][0] = late_.vec_ap_.offsets_[c][1];
-                        late_.offsets_[c][0] = late_.offsets_[c][1];
-                    }
-                }
-            }
 
-            // Mix the A-Format results to output, implicitly converting back to
-            // B-Format.
-            for (int c = 0; c < 4; c++)
-            {
-                MixHelpers::mix(
-                    early_samples_[c].data(),
-                    channel_count,
-                    dst_samples,
-                    early_.current_gains_[c].data(),
-                    early_.pan_gains_[c].data(),
-                    sample_count - base,
-                    base,
-                    todo);
-            }
+    using Lanes = std::array<float, lane_count>;
+    using Frames = std::array<TVector, max_tile_samples>;
+    using SidesFrames = std::array<Frames, 2>;
 
-            for (int c = 0; c < 4; c++)
-            {
-                MixHelpers::mix(
-                    reverb_samples_[c].data(),
-                    channel_count,
-                    dst_samples,
-                    late_.current_gains_[c].data(),
-                    late_.pan_gains_[c].data(),
-                    sample_count - base,
-                    base,
-                    todo);
-            }
+    // A delay line of frames, with the length being a power of 2.
+    using Line = std::vector<Lanes>;
 
-            base += todo;
-        }
+
+    EffectLanesT()
+        :
+        EffectLanes{},
+        src_frames_{},
+        dst_frames_{}
+    {
+    }
+
+
+    // Reads a frame with a tap of its own for each lane.
+    OALSFXPP_FORCE_INLINE static TVector read_frame(
+        const Line& line,
+        const int mask,
+        const int offset,
+        const int* taps)
+    {
+        return LanesTranspose<TVector>::gather(line.data(), mask, offset, taps);
     }
 
 
 private:
-    static constexpr auto speed_of_sound_mps = 343.3F;
+    Frames src_frames_;
+    SidesFrames dst_frames_;
+}; // EffectLanesT
 
-    // Target gain for the reverb decay feedback reaching the decay time.
-    static constexpr auto reverb_decay_gain = 0.001F; // -60 dB
+template<typename TDerived, typename TVector>
+constexpr int EffectLanesT<TDerived, TVector>::max_tile_samples;
 
-    // This is the maximum number of samples processed for each inner loop
-    // iteration.
-    static constexpr auto max_update_samples = 256;
+// The lanes of EchoEffectState.
+template<typename TVector>
+class EchoLanes :
+    public EffectLanesT<EchoLanes<TVector>, TVector>
+{
+    using Base = EffectLanesT<EchoLanes<TVector>, TVector>;
 
-    // The number of samples used for cross-faded delay lines.  This can be used
-    // to balance the compensation for abrupt line changes and attenuation due to
-    // minimally lengthed recursive lines.  Try to keep this below the device
-    // update size.
-    static constexpr auto fade_samples = 128;
+    using typename Base::Lanes;
+    using typename Base::Frames;
+    using typename Base::SidesFrames;
+    using typename Base::Line;
+    using Base::lane_count;
 
 
-    using ChannelsGains = std::array<Gains, 4>;
+public:
+    EchoLanes()
+        :
+        Base{},
+        line_{},
+        mask_{},
+        offset_{},
+        taps_{},
+        feed_gains_{},
+        filter_{},
+        taps_gains_{}
+    {
+    }
 
 
-    struct DelayLineI
+    void update_device(
+        Device& device) final
     {
-        using Line = std::array<float, 4>;
-        using Lines = std::vector<Line>;
+        auto length = static_cast<int>(EffectProps::Echo::max_delay * device.sampling_rate_) + 1;
+        length += static_cast<int>(EffectProps::Echo::max_lr_delay * device.sampling_rate_) + 1;
+        length = Math::next_power_of_2(length);
 
-        // The delay lines use interleaved samples, with the lengths being powers
-        // of 2 to allow the use of bit-masking instead of a modulus for wrapping.
-        int mask_;
-        Lines lines_;
+        line_.assign(length, Lanes{});
+        mask_ = length - 1;
+        offset_ = 0;
 
+        filter_.x_.fill(TVector::zero());
+        filter_.y_.fill(TVector::zero());
+    }
 
-        int get_sample_count() const
-        {
-            return (mask_ > 0 ? mask_ + 1 : 0);
-        }
+    void update(
+        const int lane,
+        Device& device,
+        const EffectProps& effect_props) final
+    {
+        const auto frequency = device.sampling_rate_;
 
-        void reset()
-        {
-            mask_ = 0;
-            lines_ = Lines{};
-        }
+        taps_[0][lane] = static_cast<int>(effect_props.echo_.delay_ * frequency) + 1;
+        taps_[1][lane] = static_cast<int>(effect_props.echo_.lr_delay_ * frequency) + taps_[0][lane];
 
-        void initialize(
-            const int sample_count)
+        const auto lrpan = (effect_props.echo_.spread_ < 0.0F ? -1.0F : 1.0F);
+
+        // Convert echo spread (where 0 = omni, +/-1 = directional) to coverage
+        // spread (where 0 = point, tau = omni).
+        const auto spread = std::asin(1.0F - std::abs(effect_props.echo_.spread_)) * 4.0F;
+
+        feed_gains_[lane] = effect_props.echo_.feedback_;
+
+        const auto damping_gain = std::max(1.0F - effect_props.echo_.damping_, 0.0625F); // Limit -24dB
+
+        FilterState filter;
+
+        filter.set_params(
+            FilterType::high_shelf,
+            damping_gain,
+            SendProps::lp_frequency_reference / frequency,
+            FilterState::calc_rcp_q_from_slope(damping_gain, 1.0F));
+
+        filter_.b0_[lane] = filter.b0_;
+        filter_.b1_[lane] = filter.b1_;
+        filter_.b2_[lane] = filter.b2_;
+        filter_.a1_[lane] = filter.a1_;
+        filter_.a2_[lane] = filter.a2_;
+
+        for (int t = 0; t < 2; ++t)
         {
-            if (sample_count == get_sample_count())
-            {
-                lines_.clear();
-                lines_.resize(sample_count);
-                return;
-            }
+            AmbiCoeffs coeffs;
+            Gains gains;
 
-            reset();
+            Panning::calc_angle_coeffs((t == 0 ? -Math::pi_2 : Math::pi_2) * lrpan, 0.0F, spread, coeffs);
+            Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, gains);
 
-            mask_ = sample_count - 1;
-            lines_.resize(sample_count);
+            taps_gains_[t][0][lane] = gains[0];
+            taps_gains_[t][1][lane] = gains[1];
         }
-    }; // DelayLineI
+    }
 
-    struct VecAllpass
+    // Processes the frames of a tile.
+    OALSFXPP_FORCE_INLINE void process_frames(
+        const int sample_count,
+        const Frames& src_frames,
+        SidesFrames& dst_frames)
     {
-        using Offsets = MdArray<int, 4, 2>;
+        const auto feed_gain = TVector::load(feed_gains_.data());
 
-        DelayLineI delay_;
-        Offsets offsets_;
-    }; // VecAllpass
+        const auto b0 = TVector::load(filter_.b0_.data());
+        const auto b1 = TVector::load(filter_.b1_.data());
+        const auto b2 = TVector::load(filter_.b2_.data());
+        const auto a1 = TVector::load(filter_.a1_.data());
+        const auto a2 = TVector::load(filter_.a2_.data());
 
-    struct Filter
-    {
-        FilterState lp_;
-        FilterState hp_; // EAX only
-    }; // FilterProps
+        auto x0 = filter_.x_[0];
+        auto x1 = filter_.x_[1];
+        auto y0 = filter_.y_[0];
+        auto y1 = filter_.y_[1];
 
-    using Filters = std::array<Filter, 4>;
+        TVector gains[2][2];
 
-    struct Early
-    {
-        using Offsets = MdArray<int, 4, 2>;
-        using Coeffs = std::array<float, 4>;
+        for (int t = 0; t < 2; ++t)
+        {
+            gains[t][0] = TVector::load(taps_gains_[t][0].data());
+            gains[t][1] = TVector::load(taps_gains_[t][1].data());
+        }
 
-        // A Gerzon vector all-pass filter is used to simulate initial
-        // diffusion.  The spread from this filter also helps smooth out the
-        // reverb tail.
-        //
-        VecAllpass vec_ap_;
+        for (int i = 0; i < sample_count; ++i)
+        {
+            const auto tap1 = Base::read_frame(line_, mask_, offset_, taps_[0].data());
+            const auto tap2 = Base::read_frame(line_, mask_, offset_, taps_[1].data());
 
-        // An echo line is used to complete the second half of the early
-        // reflections.
-        //
-        DelayLineI delay_;
-        Offsets offsets_;
-        Coeffs coeffs_;
+            // Apply damping and feedback gain to the second tap, and mix in the
+            // new sample.
+            const auto x = tap2 + src_frames[i];
+            const auto y = (b0 * x) + (b1 * x0) + (b2 * x1) - (a1 * y0) - (a2 * y1);
 
-        // The gain for each output channel based on 3D panning.
-        ChannelsGains current_gains_;
-        ChannelsGains pan_gains_;
-    }; // Early
+            x1 = x0;
+            x0 = x;
+            y1 = y0;
+            y0 = y;
 
-    struct Mod
-    {
-        // The vibrato time is tracked with an index over a modulus-wrapped
-        // range (in samples).
-        //
-        int index_;
-        int range_;
+            (y * feed_gain).store(line_[offset_].data());
+            offset_ = (offset_ + 1) & mask_;
 
-        // The depth of frequency change (also in samples) and its filter.
-        float depth_;
-        float coeff_;
-        float filter_;
-    }; // Mod
+            dst_frames[0][i] = (tap1 * gains[0][0]) + (tap2 * gains[1][0]);
+            dst_frames[1][i] = (tap1 * gains[0][1]) + (tap2 * gains[1][1]);
+        }
 
-    struct Late
-    {
-        struct Filter
-        {
-            using Coeffs = std::array<float, 3>;
-            using States = MdArray<float, 2, 2>;
+        filter_.x_[0] = x0;
+        filter_.x_[1] = x1;
+        filter_.y_[0] = y0;
+        filter_.y_[1] = y1;
+    }
 
-            Coeffs lf_coeffs_;
-            Coeffs hf_coeffs_;
-            float mid_coeff_;
 
-            // The LF and HF filters keep a state of the last input and last
-            // output sample.
-            States states_;
-        }; // FilterProps
+private:
+    using Taps = std::array<std::array<int, lane_count>, 2>;
+    using SidesGains = std::array<Lanes, 2>;
+    using TapsGains = std::array<SidesGains, 2>;
 
-        using Filters = std::array<Filter, 4>;
-        using Offsets = MdArray<int, 4, 2>;
 
+    // A biquad filter in direct form I for each lane.
+    struct Filter
+    {
+        using History = std::array<TVector, 2>;
+
+        Lanes b0_;
+        Lanes b1_;
+        Lanes b2_;
+        Lanes a1_;
+        Lanes a2_;
 
-        // Attenuation to compensate for the modal density and decay rate of
-        // the late lines.
-        //
-        float density_gain_;
+        History x_;
+        History y_;
+    }; // Filter
 
-        // A recursive delay line is used fill in the reverb tail.
-        DelayLineI delay_;
-        Offsets offsets_;
 
-        // T60 decay filters are used to simulate absorption.
-        Filters filters_;
+    Line line_;
+    int mask_;
+    int offset_;
+
+    Taps taps_;
+    Lanes feed_gains_;
+    Filter filter_;
+    TapsGains taps_gains_;
+}; // EchoLanes
+
+// The lanes of ModulatedDelayEffectState.
+template<typename TVector, typename TProps, const TProps EffectProps::* TPropsMember>
+class ModulatedDelayLanes :
+    public EffectLanesT<ModulatedDelayLanes<TVector, TProps, TPropsMember>, TVector>
+{
+    using Base = EffectLanesT<ModulatedDelayLanes<TVector, TProps, TPropsMember>, TVector>;
 
-        // A Gerzon vector all-pass filter is used to simulate diffusion.
-        VecAllpass vec_ap_;
+    using typename Base::Lanes;
+    using typename Base::Frames;
+    using typename Base::SidesFrames;
+    using typename Base::Line;
+    using Base::lane_count;
+    using Base::max_tile_samples;
 
-        // The gain for each output channel based on 3D panning.
-        ChannelsGains current_gains_;
-        ChannelsGains pan_gains_;
-    }; // Late
 
-    using Taps = MdArray<int, 4, 2>;
+public:
+    ModulatedDelayLanes()
+        :
+        Base{},
+        lines_{},
+        mask_{},
+        offset_{},
+        waveforms_{},
+        lfo_phases_{},
+        lfo_steps_{},
+        lfo_disps_{},
+        delays_{},
+        depths_{},
+        feedbacks_{},
+        sides_gains_{}
+    {
+    }
 
-    using SamplesPerChannel = std::array<float, max_update_samples>;
-    using Samples = std::array<SamplesPerChannel, 4>;
-    using Coeffs = std::array<float, 4>;
 
+    void update_device(
+        Device& device) final
+    {
+        const auto length = Math::next_power_of_2(static_cast<int>(TProps::max_delay * 2.0F * device.sampling_rate_) + 2);
 
-    bool is_eax_;
+        for (auto& line : lines_)
+        {
+            line.assign(length, Lanes{});
+        }
 
-    // Master effect filters
-    Filters filters_;
+        mask_ = length - 1;
+        offset_ = 0;
+        lfo_phases_.fill(0);
+    }
 
-    // Core delay line (early reflections and late reverb tap from this).
-    DelayLineI delay_;
+    void update(
+        const int lane,
+        Device& device,
+        const EffectProps& effect_props) final
+    {
+        const auto& props = effect_props.*TPropsMember;
+        const auto frequency = static_cast<float>(device.sampling_rate_);
 
-    // Tap points for early reflection delay.
-    Taps early_delay_taps_;
-    Coeffs early_delay_coeffs_;
+        waveforms_[lane] = (props.waveform_ == TProps::waveform_sinusoid ?
+            Oscillator::Waveform::sinusoid : Oscillator::Waveform::triangle);
 
-    // Tap points for late reverb feed and delay.
-    int late_feed_tap_;
-    Taps late_delay_taps_;
+        feedbacks_[lane] = props.feedback_;
+        delays_[lane] = props.delay_ * frequency;
 
-    // The feed-back and feed-forward all-pass coefficient.
-    float ap_feed_coeff_;
+        // The LFO depth is scaled to be relative to the sample delay.
+        depths_[lane] = props.depth_ * delays_[lane];
 
-    // Coefficients for the all-pass and line scattering matrices.
-    float mix_x_;
-    float mix_y_;
+        for (int s = 0; s < 2; ++s)
+        {
+            AmbiCoeffs coeffs;
+            Gains gains;
 
-    Early early_;
-    Mod mod_; // EAX only
-    Late late_;
+            Panning::calc_angle_coeffs(s == 0 ? -Math::pi_2 : Math::pi_2, 0.0F, 0.0F, coeffs);
+            Panning::compute_panning_gains(device.channel_count_, device.dry_, coeffs, 1.0F, gains);
 
-    // Indicates the cross-fade point for delay line reads [0,FADE_SAMPLES].
-    int fade_count_;
+            sides_gains_[s][0][lane] = gains[0];
+            sides_gains_[s][1][lane] = gains[1];
+        }
 
-    // The current write offset for all delay lines.
-    int offset_;
+        if (!(props.rate_ > 0.0F))
+        {
+            lfo_phases_[lane] = 0;
+            lfo_steps_[lane] = 0;
+            lfo_disps_[lane] = 0;
+        }
+        else
+        {
+            lfo_steps_[lane] = Oscillator::to_phase(props.rate_ / frequency);
+            lfo_disps_[lane] = Oscillator::to_phase(props.phase_ / 360.0);
+        }
+    }
 
-    // Temporary storage used when processing.
-    Samples a_format_samples_;
-    Samples reverb_samples_;
-    Samples early_samples_;
+    // Processes the frames of a tile.
+    OALSFXPP_FORCE_INLINE void process_frames(
+        const int sample_count,
+        const Frames& src_frames,
+        SidesFrames& dst_frames)
+    {
+        float lfo_values[2][lane_count][max_tile_samples];
 
+        for (int lane = 0; lane < lane_count; ++lane)
+        {
+            const auto phase = lfo_phases_[lane];
+            const auto step = lfo_steps_[lane];
 
-    // The B-Format to A-Format conversion matrix. The arrangement of rows is
-    // deliberately chosen to align the resulting lines to their spatial opposites
-    // (0:above front left <-> 3:above back right, 1:below front right <-> 2:below
-    // back left). It's not quite opposite, since the A-Format results in a
-    // tetrahedron, but it's close enough. Should the model be extended to 8-lines
-    // in the future, true opposites can be used.
-    static constexpr Mat4F b2a =
-    {{
-        {0.288675134595F,  0.288675134595F,  0.288675134595F,  0.288675134595F,},
-        {0.288675134595F, -0.288675134595F, -0.288675134595F,  0.288675134595F,},
-        {0.288675134595F,  0.288675134595F, -0.288675134595F, -0.288675134595F,},
-        {0.288675134595F, -0.288675134595F,  0.288675134595F, -0.288675134595F,},
-    }};
+            Oscillator::generate(waveforms_[lane], lfo_values[0][lane], phase, step, sample_count);
+            Oscillator::generate(waveforms_[lane], lfo_values[1][lane], phase + lfo_disps_[lane], step, sample_count);
 
-    // Converts A-Format to B-Format.
-    static constexpr Mat4F a2b =
-    {{
-        {0.866025403785F,  0.866025403785F,  0.866025403785F,  0.866025403785F,},
-        {0.866025403785F, -0.866025403785F,  0.866025403785F, -0.866025403785F,},
-        {0.866025403785F, -0.866025403785F, -0.866025403785F,  0.866025403785F,},
-        {0.866025403785F,  0.866025403785F, -0.866025403785F, -0.866025403785F,},
-    }};
+            lfo_phases_[lane] += step * static_cast<Oscillator::Phase>(sample_count);
+        }
 
-    static constexpr auto fade_step = 1.0F / fade_samples;
+        const auto feedback = TVector::load(feedbacks_.data());
 
-    // The all-pass and delay lines have a variable length dependent on the
-    // effect's density parameter.  The resulting density multiplier is:
-    //
-    //     multiplier = 1 + (density * LINE_MULTIPLIER)
-    //
-    // Thus the line multiplier below will result in a maximum density multiplier
-    // of 10.
-    static constexpr auto line_multiplier = 9.0F;
+        TVector gains[2][2];
 
-    // All delay line lengths are specified in seconds.
-    //
-    // To approximate early reflections, we break them up into primary (those
-    // arriving from the same direction as the source) and secondary (those
-    // arriving from the opposite direction).
-    //
-    // The early taps decorrelate the 4-channel signal to approximate an average
-    // room response for the primary reflections after the initial early delay.
-    //
-    // Given an average room dimension (d_a) and the speed of sound (c) we can
-    // calculate the average reflection delay (r_a) regardless of listener and
-    // source positions as:
-    //
-    //     r_a = d_a / c
-    //     c   = 343.3
-    //
-    // This can extended to finding the average difference (r_d) between the
-    // maximum (r_1) and minimum (r_0) reflection delays:
-    //
-    //     r_0 = 2 / 3 r_a
-    //         = r_a - r_d / 2
-    //         = r_d
-    //     r_1 = 4 / 3 r_a
-    //         = r_a + r_d / 2
-    //         = 2 r_d
-    //     r_d = 2 / 3 r_a
-    //         = r_1 - r_0
-    //
-    // As can be determined by integrating the 1D model with a source (s) and
-    // listener (l) positioned across the dimension of length (d_a):
-    //
-    //     r_d = int_(l=0)^d_a (int_(s=0)^d_a |2 d_a - 2 (l + s)| ds) dl / c
-    //
-    // The initial taps (T_(i=0)^N) are then specified by taking a power series
-    // that ranges between r_0 and half of r_1 less r_0:
-    //
-    //     R_i = 2^(i / (2 N - 1)) r_d
-    //         = r_0 + (2^(i / (2 N - 1)) - 1) r_d
-    //         = r_0 + T_i
-    //     T_i = R_i - r_0
-    //         = (2^(i / (2 N - 1)) - 1) r_d
-    //
-    // Assuming an average of 5m (up to 50m with the density multiplier), we get
-    // the following taps:
-    static constexpr float early_tap_lengths[4] =
-    {
-        0.000000E+0F, 1.010676E-3F, 2.126553E-3F, 3.358580E-3F,
-    };
+        for (int s = 0; s < 2; ++s)
+        {
+            gains[s][0] = TVector::load(sides_gains_[s][0].data());
+            gains[s][1] = TVector::load(sides_gains_[s][1].data());
+        }
 
-    // The early all-pass filter lengths are based on the early tap lengths:
-    //
-    //     A_i = R_i / a
-    //
-    // Where a is the approximate maximum all-pass cycle limit (20).
-    //
-    static constexpr float early_allpass_lengths[4] =
-    {
-        4.854840E-4F, 5.360178E-4F, 5.918117E-4F, 6.534130E-4F,
-    };
+        for (int i = 0; i < sample_count; ++i)
+        {
+            TVector temps[2];
 
-    // The early delay lines are used to transform the primary reflections into
-    // the secondary reflections.  The A-format is arranged in such a way that
-    // the channels/lines are spatially opposite:
-    //
-    //     C_i is opposite C_(N-i-1)
-    //
-    // The delays of the two opposing reflections (R_i and O_i) from a source
-    // anywhere along a particular dimension always sum to twice its full delay:
-    //
-    //     2 r_a = R_i + O_i
-    //
-    // With that in mind we can determine the delay between the two reflections
-    // and thus specify our early line lengths (L_(i=0)^N) using:
-    //
-    //     O_i = 2 r_a - R_(N-i-1)
-    //     L_i = O_i - R_(N-i-1)
-    //         = 2 (r_a - R_(N-i-1))
-    //         = 2 (r_a - T_(N-i-1) - r_0)
-    //         = 2 r_a (1 - (2 / 3) 2^((N - i - 1) / (2 N - 1)))
-    //
-    // Using an average dimension of 5m, we get:
-    static constexpr float early_line_lengths[4] =
-    {
-        2.992520E-3F, 5.456575E-3F, 7.688329E-3F, 9.709681E-3F,
-    };
+            for (int s = 0; s < 2; ++s)
+            {
+                auto& frame = lines_[s][offset_];
 
-    // The late all-pass filter lengths are based on the late line lengths:
-    //
-    //     A_i = (5 / 3) L_i / r_1
-    //
-    static constexpr float late_allpass_lengths[4] =
-    {
-        8.091400E-4F, 1.019453E-3F, 1.407968E-3F, 1.618280E-3F,
-    };
+                // The input is written first, so a zero delay reads it back.
+                src_frames[i].store(frame.data());
 
-    // The late lines are used to approximate the decaying cycle of recursive
-    // late reflections.
-    //
-    // Splitting the lines in half, we start with the shortest reflection paths
-    // (L_(i=0)^(N/2)):
-    //
-    //     L_i = 2^(i / (N - 1)) r_d
-    //
-    // Then for the opposite (longest) reflection paths (L_(i=N/2)^N):
-    //
-    //     L_i = 2 r_a - L_(i-N/2)
-    //         = 2 r_a - 2^((i - N / 2) / (N - 1)) r_d
-    //
-    // For our 5m average room, we get:
-    static constexpr float late_line_lengths[4] =
-    {
-        9.709681E-3F, 1.223343E-2F, 1.689561E-2F, 1.941936E-2F,
-    };
+                int near_taps[lane_count];
+                int far_taps[lane_count];
+                Lanes fractions;
 
-    // This coefficient is used to define the sinus depth according to the
-    // modulation depth property. This value must be below half the shortest late
-    // line length (0.0097/2 = ~0.0048), otherwise with certain parameters (high
-    // mod time, low density) the downswing can sample before the input.
-    static constexpr float modulation_depth_coeff = 1.0F / 4096.0F;
+                for (int lane = 0; lane < lane_count; ++lane)
+                {
+                    const auto delay = (lfo_values[s][lane][i] * depths_[lane]) + delays_[lane];
 
-    // A filter is used to avoid the terrible distortion caused by changing
-    // modulation time and/or depth.  To be consistent across different sample
-    // rates, the coefficient must be raised to a constant divided by the sample
-    // rate:  coeff^(constant / rate).
-    static constexpr float modulation_filter_coeff = 0.048F;
-    static constexpr float modulation_filter_const = 100000.0F;
+                    near_taps[lane] = static_cast<int>(delay);
+                    far_taps[lane] = near_taps[lane] + 1;
+                    fractions[lane] = delay - static_cast<float>(near_taps[lane]);
+                }
 
+                const auto near_values = Base::read_frame(lines_[s], mask_, offset_, near_taps) * feedback;
+                const auto far_values = Base::read_frame(lines_[s], mask_, offset_, far_taps) * feedback;
 
-    //
-    // Device Update
-    //
+                temps[s] = near_values + ((far_values - near_values) * TVector::load(fractions.data()));
 
-    // Calculate the length of a delay line and store its mask and offset.
-    static void initialize_delay_line(
-        const float length,
-        const int frequency,
-        const int extra,
-        DelayLineI& delay)
-    {
-        auto sample_count = int{};
+                (src_frames[i] + temps[s]).store(frame.data());
+            }
 
-        // All line lengths are powers of 2, calculated from their lengths in
-        // seconds, rounded up.
-        sample_count = static_cast<int>(std::ceil(length * frequency));
-        sample_count = Math::next_power_of_2(sample_count + extra);
+            offset_ = (offset_ + 1) & mask_;
 
-        delay.initialize(sample_count);
+            dst_frames[0][i] = (temps[0] * gains[0][0]) + (temps[1] * gains[1][0]);
+            dst_frames[1][i] = (temps[0] * gains[0][1]) + (temps[1] * gains[1][1]);
+        }
     }
 
-    // Calculates the delay line metrics and allocates the lines for given
-    // the sample rate (frequency).
-    void alloc_lines(
-        const int frequency)
-    {
-        // Multiplier for the maximum density value, i.e. density=1, which is
-        // actually the least density...
-        //
-        const auto multiplier = 1.0F + line_multiplier;
 
-        // The main delay length includes the maximum early reflection delay, the
-        // largest early tap width, the maximum late reverb delay, and the
-        // largest late tap width.  Finally, it must also be extended by the
-        // update size (MAX_UPDATE_SAMPLES) for block processing.
-        auto length = EffectProps::Reverb::max_reflections_delay +
-                 (early_tap_lengths[3] * multiplier) +
-                 EffectProps::Reverb::max_late_reverb_delay +
-                 ((late_line_lengths[3] - late_line_lengths[0]) * 0.25F * multiplier);
+private:
+    using Lines = std::array<Line, 2>;
+    using Waveforms = std::array<Oscillator::Waveform, lane_count>;
+    using Phases = std::array<Oscillator::Phase, lane_count>;
+    using SidesGains = std::array<std::array<Lanes, 2>, 2>;
+
 
-        initialize_delay_line(length, frequency, max_update_samples, delay_);
+    // The left and right sides.
+    Lines lines_;
+    int mask_;
+    int offset_;
 
-        // The early vector all-pass line.
-        length = early_allpass_lengths[3] * multiplier;
-        initialize_delay_line(length, frequency, 0, early_.vec_ap_.delay_);
+    Waveforms waveforms_;
+    Phases lfo_phases_;
+    Phases lfo_steps_;
+    Phases lfo_disps_;
 
-        // The early reflection line.
-        length = early_line_lengths[3] * multiplier;
-        initialize_delay_line(length, frequency, 0, early_.delay_);
+    Lanes delays_;
+    Lanes depths_;
+    Lanes feedbacks_;
 
-        // The late vector all-pass line.
-        length = late_allpass_lengths[3] * multiplier;
-        initialize_delay_line(length, frequency, 0, late_.vec_ap_.delay_);
+    SidesGains sides_gains_;
+}; // ModulatedDelayLanes
 
-        // The late delay lines are calculated from the larger of the maximum
-        // density line length or the maximum echo time, and includes the maximum
-        // modulation-related delay. The modulator's delay is calculated from the
-        // maximum modulation time and depth coefficient, and halved for the low-
-        // to-high frequency swing.
-        length = std::max(
-            EffectProps::Reverb::max_echo_time,
-            late_line_lengths[3] * multiplier) +
-                (EffectProps::Reverb::max_modulation_time * modulation_depth_coeff / 2.0F);
+template<typename TVector>
+using ChorusLanes = ModulatedDelayLanes<TVector, EffectProps::Chorus, &EffectProps::chorus_>;
 
-        initialize_delay_line(length, frequency, 0, late_.delay_);
-    }
+template<typename TVector>
+using FlangerLanes = ModulatedDelayLanes<TVector, EffectProps::Flanger, &EffectProps::flanger_>;
 
+// The lanes of CompressorEffectState.
+template<typename TVector>
+class CompressorLanes :
+    public EffectLanesT<CompressorLanes<TVector>, TVector>
+{
+    using Base = EffectLanesT<CompressorLanes<TVector>, TVector>;
 
-    //
-    // Effect Update
-    //
+    using typename Base::Lanes;
+    using typename Base::Frames;
+    using typename Base::SidesFrames;
 
-    // Calculate a decay coefficient given the length of each cycle and the time
-    // until the decay reaches -60 dB.
-    static float calc_decay_coeff(
-        const float length,
-        const float decayTime)
-    {
-        return std::pow(reverb_decay_gain, length / decayTime);
-    }
 
-    // Calculate a decay length from a coefficient and the time until the decay
-    // reaches -60 dB.
-    static float calc_decay_length(
-        const float coeff,
-        const float decay_time)
+public:
+    CompressorLanes()
+        :
+        Base{},
+        attack_rate_{},
+        release_rate_{},
+        amplitude_scale_{},
+        gain_control_{},
+        enabled_{},
+        sides_gains_{}
     {
-        return std::log10(coeff) * decay_time / std::log10(reverb_decay_gain);
     }
 
-    // Calculate an attenuation to be applied to the input of any echo models to
-    // compensate for modal density and decay time.
-    static float calc_density_gain(
-        const float a)
-    {
-        // The energy of a signal can be obtained by finding the area under the
-        // squared signal.  This takes the form of Sum(x_n^2), where x is the
-        // amplitude for the sample n.
-        //
-        // Decaying feedback matches exponential decay of the form Sum(a^n),
-        // where a is the attenuation coefficient, and n is the sample.  The area
-        // under this decay curve can be calculated as:  1 / (1 - a).
-        //
-        // Modifying the above equation to find the area under the squared curve
-        // (for energy) yields:  1 / (1 - a^2).  Input attenuation can then be
-        // calculated by inverting the square root of this approximation,
-        // yielding:  1 / sqrt(1 / (1 - a^2)), simplified to: sqrt(1 - a^2).
-        //
-        return std::sqrt(1.0F - (a * a));
-    }
 
-    // Calculate the scattering matrix coefficients given a diffusion factor.
-    static void calc_matrix_coeffs(
-        const float diffusion,
-        float* x,
-        float* y)
+    void update_device(
+        Device& device) final
     {
-        // The matrix is of order 4, so n is sqrt(4 - 1).
-        const auto n = std::sqrt(3.0F);
-        const auto t = diffusion * std::atan(n);
+        attack_rate_ = 1.0F / (device.sampling_rate_ * 0.2F); // 200ms Attack
+        release_rate_ = 1.0F / (device.sampling_rate_ * 0.4F); // 400ms Release
 
-        // Calculate the first mixing matrix coefficient.
-        *x = std::cos(t);
+        gain_control_ = TVector::set1(1.0F);
 
-        // Calculate the second mixing matrix coefficient.
-        *y = std::sin(t) / n;
-    }
+        // The input is a source in front, so the four channels the effect slot
+        // gets are scaled copies of it. Reduce the amplitude estimation and the
+        // output mix to single gains.
+        AmbiCoeffs coeffs;
 
-    // Calculate the limited HF ratio for use with the late reverb low-pass
-    // filters.
-    static float calc_limited_hf_ratio(
-        const float hf_ratio,
-        const float air_absorption_gain_hf,
-        const float decay_time)
-    {
-        // Find the attenuation due to air absorption in dB (converting delay
-        // time to meters using the speed of sound).  Then reversing the decay
-        // equation, solve for HF ratio.  The delay length is cancelled out of
-        // the equation, so it can be calculated once for all lines.
-        const auto limit_ratio = 1.0F / (calc_decay_length(air_absorption_gain_hf, decay_time) *
-            speed_of_sound_mps);
+        Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
 
-        // Using the limit calculated above, apply the upper bound to the HF
-        // ratio. Also need to limit the result to a minimum of 0.1, just like
-        // the HF ratio parameter.
-        return Math::clamp(limit_ratio, 0.1F, hf_ratio);
-    }
+        amplitude_scale_ = std::abs(coeffs[0]) +
+            std::max(std::abs(coeffs[1]), std::max(std::abs(coeffs[2]), std::abs(coeffs[3])));
 
-    // Calculates the first-order high-pass coefficients following the I3DL2
-    // reference model.  This is the transfer function:
-    //
-    //                1 - z^-1
-    //     H(z) = p ------------
-    //               1 - p z^-1
-    //
-    // And this is the I3DL2 coefficient calculation given gain (g) and reference
-    // angular frequency (w):
-    //
-    //                                    g
-    //      p = ------------------------------------------------------
-    //          g cos(w) + sqrt((cos(w) - 1) (g^2 cos(w) + g^2 - 2))
-    //
-    // The coefficient is applied to the partial differential filter equation as:
-    //
-    //     c_0 = p
-    //     c_1 = -p
-    //     c_2 = p
-    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
-    //
-    static void calc_highpass_coeffs(
-        const float gain,
-        const float w,
-        float coeffs[3])
-    {
-        if (gain >= 1.0F)
-        {
-            coeffs[0] = 1.0F;
-            coeffs[1] = 0.0F;
-            coeffs[2] = 0.0F;
+        Gains channels_gains[max_effect_channels];
 
-            return;
+        for (int i = 0; i < max_effect_channels; ++i)
+        {
+            Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                mat4f_identity.m_[i],
+                1.0F,
+                channels_gains[i]);
         }
 
-        const auto g = std::max(0.001F, gain);
-        const auto g2 = g * g;
-        const auto cw = std::cos(w);
-        const auto p = g / ((g * cw) + std::sqrt((cw - 1.0F) * ((g2 * cw) + g2 - 2.0F)));
+        for (int s = 0; s < 2; ++s)
+        {
+            auto gain = 0.0F;
 
-        coeffs[0] = p;
-        coeffs[1] = -p;
-        coeffs[2] = p;
+            for (int i = 0; i < max_effect_channels; ++i)
+            {
+                gain += coeffs[i] * channels_gains[i][s];
+            }
+
+            sides_gains_[s] = gain;
+        }
     }
 
-    // Calculates the first-order low-pass coefficients following the I3DL2
-    // reference model.  This is the transfer function:
-    //
-    //              (1 - a) z^0
-    //     H(z) = ----------------
-    //             1 z^0 - a z^-1
-    //
-    // And this is the I3DL2 coefficient calculation given gain (g) and reference
-    // angular frequency (w):
-    //
-    //          1 - g^2 cos(w) - sqrt(2 g^2 (1 - cos(w)) - g^4 (1 - cos(w)^2))
-    //     a = ----------------------------------------------------------------
-    //                                    1 - g^2
-    //
-    // The coefficient is applied to the partial differential filter equation as:
-    //
-    //     c_0 = 1 - a
-    //     c_1 = 0
-    //     c_2 = a
-    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
-    //
-    static void calc_lowpass_coeffs(
-        const float gain,
-        const float w,
-        float coeffs[3])
+    void update(
+        const int lane,
+        Device& device,
+        const EffectProps& effect_props) final
     {
-        if (gain >= 1.0F)
-        {
-            coeffs[0] = 1.0F;
-            coeffs[1] = 0.0F;
-            coeffs[2] = 0.0F;
+        static_cast<void>(device);
 
-            return;
+        enabled_[lane] = (effect_props.compressor_.on_off_ ? 1.0F : 0.0F);
+    }
+
+    // Processes the frames of a tile.
+    OALSFXPP_FORCE_INLINE void process_frames(
+        const int sample_count,
+        const Frames& src_frames,
+        SidesFrames& dst_frames)
+    {
+        const auto enabled = TVector::load(enabled_.data());
+        const auto disabled = TVector::set1(1.0F) - enabled;
+        const auto amplitude_scale = TVector::set1(amplitude_scale_) * enabled;
+        const auto attack_rate = TVector::set1(attack_rate_);
+        const auto release_rate = TVector::set1(release_rate_);
+        const auto min_gain_control = TVector::set1(0.5F);
+        const auto max_gain_control = TVector::set1(2.0F);
+        const auto left_gain = TVector::set1(sides_gains_[0]);
+        const auto right_gain = TVector::set1(sides_gains_[1]);
+
+        auto gain_control = gain_control_;
+
+        for (int i = 0; i < sample_count; ++i)
+        {
+            // A disabled lane forces the amplitude to 1, so the gain changes
+            // smoothly when the compressor is turned on and off.
+            const auto amplitude = (TVector::abs(src_frames[i]) * amplitude_scale) + disabled;
+
+            // Attack or release the gain control to reach the amplitude.
+            gain_control = TVector::min(
+                TVector::max(amplitude, gain_control - release_rate),
+                gain_control + attack_rate);
+
+            // Apply the inverse of the gain control to normalize/compress the
+            // volume.
+            const auto output = src_frames[i] *
+                TVector::rcp(TVector::min(TVector::max(gain_control, min_gain_control), max_gain_control));
+
+            dst_frames[0][i] = output * left_gain;
+            dst_frames[1][i] = output * right_gain;
         }
 
-        // Be careful with gains < 0.001, as that causes the coefficient
-        // to head towards 1, which will flatten the signal.
-        const auto g = std::max(0.001F, gain);
-        const auto g2 = g * g;
-        const auto cw = std::cos(w);
+        gain_control_ = gain_control;
+    }
 
-        const auto a = (1.0F - (g2 * cw) - std::sqrt((2.0F * g2 * (1.0F - cw)) - (g2 * g2 * (1.0F - (cw * cw))))) /
-            (1.0F - g2);
 
-        coeffs[0] = 1.0F - a;
-        coeffs[1] = 0.0F;
-        coeffs[2] = a;
+private:
+    float attack_rate_;
+    float release_rate_;
+    float amplitude_scale_;
+    TVector gain_control_;
+    Lanes enabled_;
+    std::array<float, 2> sides_gains_;
+}; // CompressorLanes
+
+// Runs the late lines of the instances of ReverbLanes together, for
+// LanesTarget.
+//
+// Four lanes gain nothing over the four lines an instance runs in a Float4
+// already, so with them each instance runs its late lines on its own.
+template<typename TVector>
+struct ReverbLateLanes
+{
+    static constexpr auto is_batched = false;
+
+
+    void run(
+        ReverbEffectState* const* states,
+        const int count,
+        ReverbEffectState::LateLanesLines* lines,
+        const bool is_faded)
+    {
+        static_cast<void>(states);
+        static_cast<void>(count);
+        static_cast<void>(lines);
+        static_cast<void>(is_faded);
     }
+}; // ReverbLateLanes
 
-    // Calculates the first-order low-shelf coefficients.  The shelf filters are
-    // used in place of low/high-pass filters to preserve the mid-band.  This is
-    // the transfer function:
-    //
-    //             a_0 + a_1 z^-1
-    //     H(z) = ----------------
-    //              1 + b_1 z^-1
-    //
-    // And these are the coefficient calculations given cut gain (g) and a center
-    // angular frequency (w):
-    //
-    //          sin(0.5 (pi - w) - 0.25 pi)
-    //     p = -----------------------------
-    //          sin(0.5 (pi - w) + 0.25 pi)
-    //
-    //          g + 1           g + 1
-    //     a = ------- + sqrt((-------)^2 - 1)
-    //          g - 1           g - 1
-    //
-    //            1 + g + (1 - g) a
-    //     b_0 = -------------------
-    //                    2
-    //
-    //            1 - g + (1 + g) a
-    //     b_1 = -------------------
-    //                    2
-    //
-    // The coefficients are applied to the partial differential filter equation
-    // as:
-    //
-    //            b_0 + p b_1
-    //     c_0 = -------------
-    //              1 + p a
-    //
-    //            -(b_1 + p b_0)
-    //     c_1 = ----------------
-    //               1 + p a
-    //
-    //             p + a
-    //     c_2 = ---------
-    //            1 + p a
-    //
-    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
-    //
-    static void calc_low_shelf_coeffs(
-        const float gain,
-        const float w,
-        float coeffs[3])
+#ifdef OALSFXPP_WIDE_LANES
+template<int TLaneCount>
+struct ReverbLateLanes<FloatN<TLaneCount>>
+{
+    static constexpr auto is_batched = true;
+
+
+    OALSFXPP_FORCE_INLINE void run(
+        ReverbEffectState* const* states,
+        const int count,
+        ReverbEffectState::LateLanesLines* lines,
+        const bool is_faded)
     {
-        if (gain >= 1.0F)
+        if (is_faded)
+        {
+            ReverbEffectState::late_reverb_lanes<TLaneCount, true>(states, count, *lines);
+        }
+        else
         {
-            coeffs[0] = 1.0F;
-            coeffs[1] = 0.0F;
-            coeffs[2] = 0.0F;
-
-            return;
+            ReverbEffectState::late_reverb_lanes<TLaneCount, false>(states, count, *lines);
         }
+    }
+}; // ReverbLateLanes
+#endif // OALSFXPP_WIDE_LANES
 
-        const auto g = std::max(0.001F, gain);
-        const auto rw = Math::pi - w;
-        const auto p = std::sin((0.5F * rw) - (0.25F * Math::pi)) / std::sin((0.5F * rw) + (0.25F * Math::pi));
-        const auto n = (g + 1.0F) / (g - 1.0F);
-        const auto alpha = n + std::sqrt((n * n) - 1.0F);
-        const auto beta0 = (1.0F + g + (1.0F - g) * alpha) / 2.0F;
-        const auto beta1 = (1.0F - g + (1.0F + g) * alpha) / 2.0F;
+// The lanes of ReverbEffectState.
+//
+// Each lane runs an instance of the effect state. The instances feed their
+// delay lines, generate the early reflections and mix their output one at a
+// time. The late lines of the instances at the full rate run together on the
+// lines of the lanes (see ReverbLateLanes), and the others on their own.
+template<typename TVector>
+class ReverbLanes :
+    public EffectLanes
+{
+public:
+    static constexpr auto lane_count = TVector::lane_count;
 
-        coeffs[0] = (beta0 + (p * beta1)) / (1.0F + (p * alpha));
-        coeffs[1] = -(beta1 + (p * beta0)) / (1.0F + (p * alpha));
-        coeffs[2] = (p + alpha) / (1.0F + (p * alpha));
+
+    ReverbLanes()
+        :
+        EffectLanes{},
+        states_{},
+        effect_slot_{},
+        src_gains_{},
+        src_buffers_{SampleBuffers::size_type{max_effect_channels}},
+        dst_buffers_{SampleBuffers::size_type{2}},
+        late_samples_{},
+        ap_samples_{},
+        late_lines_{}
+    {
     }
 
-    // Calculates the first-order high-shelf coefficients.  The shelf filters are
-    // used in place of low/high-pass filters to preserve the mid-band.  This is
-    // the transfer function:
-    //
-    //             a_0 + a_1 z^-1
-    //     H(z) = ----------------
-    //              1 + b_1 z^-1
-    //
-    // And these are the coefficient calculations given cut gain (g) and a center
-    // angular frequency (w):
-    //
-    //          sin(0.5 w - 0.25 pi)
-    //     p = ----------------------
-    //          sin(0.5 w + 0.25 pi)
-    //
-    //          g + 1           g + 1
-    //     a = ------- + sqrt((-------)^2 - 1)
-    //          g - 1           g - 1
-    //
-    //            1 + g + (1 - g) a
-    //     b_0 = -------------------
-    //                    2
-    //
-    //            1 - g + (1 + g) a
-    //     b_1 = -------------------
-    //                    2
-    //
-    // The coefficients are applied to the partial differential filter equation
-    // as:
-    //
-    //            b_0 + p b_1
-    //     c_0 = -------------
-    //              1 + p a
-    //
-    //            b_1 + p b_0
-    //     c_1 = -------------
-    //              1 + p a
-    //
-    //            -(p + a)
-    //     c_2 = ----------
-    //            1 + p a
-    //
-    //     y_i = c_0 x_i + c_1 x_(i-1) + c_2 y_(i-1)
-    //
+
+    // Creates the lanes with their instances.
     //
-    static void calc_high_shelf_coeffs(
-        const float gain,
-        const float w,
-        float coeffs[3])
+    // Returns the lanes or null on failure.
+    static ReverbLanes* create(
+        const EffectType effect_type)
     {
-        if (gain >= 1.0F)
+        auto lanes = std::unique_ptr<ReverbLanes>{new (std::nothrow) ReverbLanes{}};
+
+        if (!lanes)
         {
-            coeffs[0] = 1.0F;
-            coeffs[1] = 0.0F;
-            coeffs[2] = 0.0F;
+            return nullptr;
+        }
 
-            return;
+        for (auto& state : lanes->states_)
+        {
+            state.reset(static_cast<ReverbEffectState*>(EffectStateFactory::create_by_type(effect_type)));
+
+            if (!state)
+            {
+                return nullptr;
+            }
         }
 
-        const auto g = std::max(0.001F, gain);
-        const auto p = std::sin((0.5F * w) - (0.25F * Math::pi)) / std::sin((0.5F * w) + (0.25F * Math::pi));
-        const auto n = (g + 1.0F) / (g - 1.0F);
-        const auto alpha = n + std::sqrt((n * n) - 1.0F);
-        const auto beta0 = (1.0F + g + (1.0F - g) * alpha) / 2.0F;
-        const auto beta1 = (1.0F - g + (1.0F + g) * alpha) / 2.0F;
+        lanes->effect_slot_.effect_.type_ = effect_type;
 
-        coeffs[0] = (beta0 + (p * beta1)) / (1.0F + (p * alpha));
-        coeffs[1] = (beta1 + (p * beta0)) / (1.0F + (p * alpha));
-        coeffs[2] = -(p + alpha) / (1.0F + (p * alpha));
+        return lanes.release();
     }
 
-    // Calculates the 3-band T60 damping coefficients for a particular delay line
-    // of specified length using a combination of two low/high-pass/shelf or
-    // pass-through filter sections (producing 3 coefficients each) and a general
-    // gain (7th coefficient) given decay times for each band split at two (LF/
-    // HF) reference frequencies (w).
-    static void calc_t60_damping_coeffs(
-        const float length,
-        const float lf_decay_time,
-        const float mf_decay_time,
-        const float hf_decay_time,
-        const float lf_w,
-        const float hf_w,
-        float lfcoeffs[3],
-        float hfcoeffs[3],
-        float *midcoeff)
+    int get_lane_count() const final
     {
-        const auto lf_gain = calc_decay_coeff(length, lf_decay_time);
-        const auto mf_gain = calc_decay_coeff(length, mf_decay_time);
-        const auto hf_gain = calc_decay_coeff(length, hf_decay_time);
+        return lane_count;
+    }
 
-        if (lf_gain < mf_gain)
+    void update_device(
+        Device& device) final
+    {
+        for (auto& state : states_)
         {
-            if (mf_gain < hf_gain)
-            {
-                calc_low_shelf_coeffs(mf_gain / hf_gain, hf_w, lfcoeffs);
-                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, hfcoeffs);
-                *midcoeff = hf_gain;
-            }
-            else if (mf_gain > hf_gain)
-            {
-                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, lfcoeffs);
-                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
-                *midcoeff = mf_gain;
-            }
-            else
-            {
-                lfcoeffs[0] = 1.0F;
-                lfcoeffs[1] = 0.0F;
-                lfcoeffs[2] = 0.0F;
-                calc_highpass_coeffs(lf_gain / mf_gain, lf_w, hfcoeffs);
-                *midcoeff = mf_gain;
-            }
+            state->update_device(device);
         }
-        else if (lf_gain > mf_gain)
+
+        late_samples_.release();
+        ap_samples_.release();
+
+        late_lines_ = ReverbEffectState::LateLanesLines{};
+
+        // The input is a source in front.
+        AmbiCoeffs coeffs;
+
+        Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
+
+        for (int i = 0; i < max_effect_channels; ++i)
         {
-            if (mf_gain < hf_gain)
-            {
-                const auto hg = mf_gain / lf_gain;
-                const auto lg = mf_gain / hf_gain;
+            src_gains_[i] = coeffs[i];
+        }
+    }
 
-                calc_high_shelf_coeffs(hg, lf_w, lfcoeffs);
-                calc_low_shelf_coeffs(lg, hf_w, hfcoeffs);
-                *midcoeff = std::max(lf_gain, hf_gain) / std::max(hg, lg);
-            }
-            else if (mf_gain > hf_gain)
-            {
-                calc_high_shelf_coeffs(mf_gain / lf_gain, lf_w, lfcoeffs);
-                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
-                *midcoeff = lf_gain;
-            }
-            else
-            {
-                lfcoeffs[0] = 1.0F;
-                lfcoeffs[1] = 0.0F;
-                lfcoeffs[2] = 0.0F;
-                calc_high_shelf_coeffs(mf_gain / lf_gain, lf_w, hfcoeffs);
-                *midcoeff = lf_gain;
-            }
+    void update(
+        const int lane,
+        Device& device,
+        const EffectProps& effect_props) final
+    {
+        auto& state = *states_[lane];
+        const auto quality = state.get_quality();
+
+        state.update(device, effect_slot_, effect_props);
+
+        if (!ReverbLateLanes<TVector>::is_batched || !state.has_full_rate_late())
+        {
+            return;
         }
-        else
+
+        if (late_samples_.is_empty())
         {
-            lfcoeffs[0] = 1.0F;
-            lfcoeffs[1] = 0.0F;
-            lfcoeffs[2] = 0.0F;
+            alloc_late_lines(state);
+        }
+        else if (state.get_quality() != quality)
+        {
+            // The instance has cleared its lines.
+            clear_late_lines(lane);
+        }
+    }
 
-            if (mf_gain < hf_gain)
+    void process(
+        const int sample_count,
+        const int used_lane_count,
+        const SrcSamples& src_samples,
+        const DstSamples& dst_samples) final
+    {
+        for (int base = 0; base < sample_count; )
+        {
+            auto todo = sample_count - base;
+
+            for (int lane = 0; lane < used_lane_count; ++lane)
             {
-                calc_low_shelf_coeffs(mf_gain / hf_gain, hf_w, hfcoeffs);
-                *midcoeff = hf_gain;
+                todo = states_[lane]->get_block_size(todo);
             }
-            else if (mf_gain > hf_gain)
+
+            for (int lane = 0; lane < used_lane_count; ++lane)
             {
-                calc_lowpass_coeffs(hf_gain / mf_gain, hf_w, hfcoeffs);
-                *midcoeff = mf_gain;
+                for (int c = 0; c < max_effect_channels; ++c)
+                {
+                    const auto src = &src_samples[lane][base];
+                    const auto gain = src_gains_[c];
+                    auto& dst = src_buffers_[c];
+
+                    for (int i = 0; i < todo; ++i)
+                    {
+                        dst[i] = src[i] * gain;
+                    }
+                }
+
+                states_[lane]->begin_block(todo, src_buffers_, 0);
             }
-            else
+
+            late_blocks(used_lane_count);
+
+            for (int lane = 0; lane < used_lane_count; ++lane)
             {
-                hfcoeffs[0] = 1.0F;
-                hfcoeffs[1] = 0.0F;
-                hfcoeffs[2] = 0.0F;
-                *midcoeff = mf_gain;
+                for (auto& buffer : dst_buffers_)
+                {
+                    std::fill_n(buffer.begin(), todo, 0.0F);
+                }
+
+                states_[lane]->end_block(todo, sample_count - base, dst_buffers_, 0, 2);
+
+                for (int s = 0; s < 2; ++s)
+                {
+                    std::copy_n(dst_buffers_[s].cbegin(), todo, &dst_samples[(2 * lane) + s][base]);
+                }
             }
+
+            base += todo;
         }
     }
 
-    // Update the EAX modulation index, range, and depth.  Keep in mind that this
-    // kind of vibrato is additive and not multiplicative as one may expect.  The
-    // downswing will sound stronger than the upswing.
-    void update_modulator(
-        const float mod_time,
-        const float mod_depth,
-        const int frequency)
-    {
-        // Modulation is calculated in two parts.
-        //
-        // The modulation time effects the speed of the sinus. An index out of the
-        // current range (both in samples) is incremented each sample, so a longer
-        // time implies a larger range. The range is bound to a reasonable minimum
-        // (1 sample) and when the timing changes, the index is rescaled to the new
-        // range to keep the sinus consistent.
-        //
-        const auto range = std::max(static_cast<int>(mod_time * frequency), 1);
 
-        mod_.index_ = static_cast<int>(mod_.index_ * static_cast<int64_t>(range) / mod_.range_);
-        mod_.range_ = range;
+private:
+    using StateUPtr = std::unique_ptr<ReverbEffectState, EffectStateDeleter>;
+    using StateUPtrs = std::array<StateUPtr, lane_count>;
 
-        // The modulation depth effects the scale of the sinus, which changes how
-        // much extra delay is added to the delay line. This delay changing over
-        // time changes the pitch, creating the modulation effect. The scale needs
-        // to be multiplied by the modulation time so that a given depth produces a
-        // consistent shift in frequency over all ranges of time. Since the depth
-        // is applied to a sinus value, it needs to be halved for the sinus swing
-        // in time (half of it is spent decreasing the frequency, half is spent
-        // increasing it).
-        mod_.depth_ = mod_depth * modulation_depth_coeff * mod_time / 2.0F * frequency;
-    }
 
-    // Update the offsets for the main effect delay line.
-    void update_delay_line(
-        const float early_delay,
-        const float late_delay,
-        const float density,
-        const float decay_time,
-        const int frequency)
-    {
-        const auto multiplier = 1.0F + (density * line_multiplier);
+    StateUPtrs states_;
+
+    // The slot the instances are updated for.
+    EffectSlot effect_slot_;
+
+    std::array<float, max_effect_channels> src_gains_;
+    SampleBuffers src_buffers_;
+    SampleBuffers dst_buffers_;
+
+    // The late lines of the instances at the full rate.
+    ZeroedBuffer<float> late_samples_;
+    ZeroedBuffer<float> ap_samples_;
+    ReverbEffectState::LateLanesLines late_lines_;
 
-        // Early reflection taps are decorrelated by means of an average room
-        // reflection approximation described above the definition of the taps.
-        // This approximation is linear and so the above density multiplier can
-        // be applied to adjust the width of the taps.  A single-band decay
-        // coefficient is applied to simulate initial attenuation and absorption.
-        //
-        // Late reverb taps are based on the late line lengths to allow a zero-
-        // delay path and offsets that would continue the propagation naturally
-        // into the late lines.
 
-        for (int i = 0; i < 4; ++i)
-        {
-            auto length = float{};
+    // Allocates the late lines of the lanes as long as the ones of the
+    // instance.
+    void alloc_late_lines(
+        const ReverbEffectState& state)
+    {
+        auto& lines = late_lines_;
 
-            length = early_delay + (early_tap_lengths[i] * multiplier);
-            early_delay_taps_[i][1] = static_cast<int>(length * frequency);
+        state.get_late_masks(lines.late_mask_, lines.ap_mask_);
 
-            length = early_tap_lengths[i] * multiplier;
-            early_delay_coeffs_[i] = calc_decay_coeff(length, decay_time);
+        late_samples_.reset((lines.late_mask_ + 1) * 4 * lane_count);
+        ap_samples_.reset((lines.ap_mask_ + 1) * 4 * lane_count);
 
-            length = late_delay + (late_line_lengths[i] - late_line_lengths[0]) * 0.25F * multiplier;
-            late_delay_taps_[i][1] = late_feed_tap_ + static_cast<int>(length * frequency);
-        }
+        lines.late_samples_ = late_samples_.get_data();
+        lines.ap_samples_ = ap_samples_.get_data();
     }
 
-    // Update the early reflection line lengths and gain coefficients.
-    void update_early_lines(
-        const float density,
-        const float decay_time,
-        const int frequency)
+    // Clears the late lines of the lane.
+    void clear_late_lines(
+        const int lane)
     {
-        const auto multiplier = 1.0F + density*line_multiplier;
+        for (int i = lane; i < late_samples_.get_size(); i += lane_count)
+        {
+            late_samples_[i] = 0.0F;
+        }
 
-        for(int i = 0; i < 4; ++i)
+        for (int i = lane; i < ap_samples_.get_size(); i += lane_count)
         {
-            auto length = float{};
+            ap_samples_[i] = 0.0F;
+        }
+    }
 
-            // Calculate the length (in seconds) of each all-pass line.
-            length = early_allpass_lengths[i] * multiplier;
+    // Runs the late lines of the block.
+    //
+    // The instances at the full rate run together, and the others on their
+    // own.
+    void late_blocks(
+        const int used_lane_count)
+    {
+        ReverbEffectState* states[lane_count] = {};
 
-            // Calculate the delay offset for each all-pass line.
-            early_.vec_ap_.offsets_[i][1] = static_cast<int>(length * frequency);
+        auto count = 0;
+        auto is_faded = false;
 
-            // Calculate the length (in seconds) of each delay line.
-            length = early_line_lengths[i] * multiplier;
+        for (int lane = 0; lane < used_lane_count; ++lane)
+        {
+            auto& state = *states_[lane];
+            const auto late_count = state.get_late_count();
 
-            // Calculate the delay offset for each delay line.
-            early_.offsets_[i][1] = static_cast<int>(length * frequency);
+            if (late_count == 0)
+            {
+                continue;
+            }
 
-            /* Calculate the gain (coefficient) for each line. */
-            early_.coeffs_[i] = calc_decay_coeff(length, decay_time);
-        }
-    }
+            if (!ReverbLateLanes<TVector>::is_batched || !state.has_full_rate_late())
+            {
+                state.late_block();
+                continue;
+            }
 
-    // Update the late reverb line lengths and T60 coefficients.
-    void update_late_lines(
-        const float density,
-        const float diffusion,
-        const float lf_decay_time,
-        const float mf_decay_time,
-        const float hf_decay_time,
-        const float lf_w,
-        const float hf_w,
-        const float echo_time,
-        const float echo_depth,
-        const int frequency)
-    {
-        float band_weights[3];
+            state.calc_late_mod_delays();
 
-        // To compensate for changes in modal density and decay time of the late
-        // reverb signal, the input is attenuated based on the maximal energy of
-        // the outgoing signal.  This approximation is used to keep the apparent
-        // energy of the signal equal for all ranges of density and decay time.
-        //
-        // The average length of the delay lines is used to calculate the
-        // attenuation coefficient.
+            states[lane] = &state;
+            count = late_count;
+            is_faded |= state.is_fading();
+        }
 
-        const auto multiplier = 1.0F + (density * line_multiplier);
+        if (count == 0)
+        {
+            return;
+        }
 
-        auto length = (late_line_lengths[0] + late_line_lengths[1] +
-                  late_line_lengths[2] + late_line_lengths[3]) / 4.0F * multiplier;
+        auto late_lanes = ReverbLateLanes<TVector>{};
 
-        // Include the echo transformation (see below).
-        length = Math::lerp(length, echo_time, echo_depth);
+        LanesTarget<TVector>::run(late_lanes, static_cast<ReverbEffectState* const*>(states), count, &late_lines_, is_faded);
+    }
+}; // ReverbLanes
 
-        length += (late_allpass_lengths[0] + late_allpass_lengths[1] +
-                   late_allpass_lengths[2] + late_allpass_lengths[3]) / 4.0F * multiplier;
+struct EffectBatchErrorMessages
+{
+    static constexpr auto NoError = "";
+    static constexpr auto AllocateImpl = "Failed to allocate implementaion class.";
+    static constexpr auto NotInitialized = "Not initialized.";
+    static constexpr auto UnsupportedEffectType = "Unsupported effect type.";
+    static constexpr auto SamplingRateOutOfRange = "Sampling rate is out of range.";
+    static constexpr auto InstanceCountOutOfRange = "Instance count is out of range.";
+    static constexpr auto InstanceIndexOutOfRange = "Instance index is out of range.";
+    static constexpr auto NoSrcSamples = "No source samples.";
+    static constexpr auto NoDstSamples = "No destination samples.";
+}; // EffectBatchErrorMessages
 
-        // The density gain calculation uses an average decay time weighted by
-        // approximate bandwidth.  This attempts to compensate for losses of
-        // energy that reduce decay time due to scattering into highly attenuated
-        // bands.
 
-        band_weights[0] = lf_w;
-        band_weights[1] = hf_w - lf_w;
-        band_weights[2] = Math::tau - hf_w;
+class EffectBatch::Impl
+{
+public:
+    using EffectLanesUPtr = std::unique_ptr<EffectLanes>;
+    using EffectLanesUPtrs = std::vector<EffectLanesUPtr>;
 
-        late_.density_gain_ = calc_density_gain(
-            calc_decay_coeff(
-                length,
-                ((band_weights[0] * lf_decay_time) +
-                    (band_weights[1] * mf_decay_time) +
-                    (band_weights[2] * hf_decay_time)) / Math::tau)
-        );
 
-        for (int i = 0; i < 4; ++i)
-        {
-            // Calculate the length (in seconds) of each all-pass line.
-            length = late_allpass_lengths[i] * multiplier;
+    EffectType effect_type_;
+    int instance_count_;
 
-            // Calculate the delay offset for each all-pass line.
-            late_.vec_ap_.offsets_[i][1] = static_cast<int>(length * frequency);
+    // A stereo device to pan the output with.
+    Device device_;
 
-            // Calculate the length (in seconds) of each delay line.  This also
-            // applies the echo transformation.  As the EAX echo depth approaches
-            // 1, the line lengths approach a length equal to the echoTime.  This
-            // helps to produce distinct echoes along the tail.
-            length = Math::lerp(late_line_lengths[i] * multiplier, echo_time, echo_depth);
+    // The instances in each lanes.
+    int lane_count_;
+    EffectLanesUPtrs lanes_;
 
-            // Calculate the delay offset for each delay line.
-            late_.offsets_[i][1] = static_cast<int>(length * frequency);
+    // The input and the output of the unused lanes of the last group.
+    SampleBuffer silence_;
+    SampleBuffer discarded_;
 
-            // Approximate the absorption that the vector all-pass would exhibit
-            // given the current diffusion so we don't have to process a full T60
-            // filter for each of its four lines.
-            length += Math::lerp(late_allpass_lengths[i],
-                (late_allpass_lengths[0] + late_allpass_lengths[1] +
-                    late_allpass_lengths[2] + late_allpass_lengths[3]) / 4.0F,
-                diffusion) * multiplier;
 
-            // Calculate the T60 damping coefficients for each line.
-            calc_t60_damping_coeffs(
-                length,
-                lf_decay_time,
-                mf_decay_time,
-                hf_decay_time,
-                lf_w,
-                hf_w,
-                late_.filters_[i].lf_coeffs_.data(),
-                late_.filters_[i].hf_coeffs_.data(),
-                &late_.filters_[i].mid_coeff_);
-        }
+    Impl()
+        :
+        effect_type_{},
+        instance_count_{},
+        device_{},
+        lane_count_{},
+        lanes_{},
+        silence_{},
+        discarded_{}
+    {
     }
 
-    static Mat4F matrix_mult(
-        const Mat4F& a,
-        const Mat4F& b)
-    {
-        Mat4F result;
 
-        for (int col = 0; col < 4; ++col)
+    const char* initialize(
+        const EffectType effect_type,
+        const int sampling_rate,
+        const int instance_count)
+    {
+        if (!EffectBatch::is_effect_type_supported(effect_type))
         {
-            for (int row = 0;row < 4; ++row)
-            {
-                result(row, col) =
-                    (a(row, 0) * b(0, col)) +
-                    (a(row, 1) * b(1, col)) +
-                    (a(row, 2) * b(2, col)) +
-                    (a(row, 3) * b(3, col));
-            }
+            return EffectBatchErrorMessages::UnsupportedEffectType;
         }
 
-        return result;
-    }
+        if (sampling_rate < min_sampling_rate || sampling_rate > max_sampling_rate)
+        {
+            return EffectBatchErrorMessages::SamplingRateOutOfRange;
+        }
 
-    static void clear_gains(
-        ChannelsGains& gains)
-    {
-        for (auto& gain : gains)
+        if (instance_count <= 0)
         {
-            gain.fill(0.0F);
+            return EffectBatchErrorMessages::InstanceCountOutOfRange;
         }
-    }
 
-    // Creates a transform matrix given a reverb vector. This works by creating a
-    // Z-focus transform, then a rotate transform around X, then Y, to place the
-    // focal point in the direction of the vector, using the vector length as a
-    // focus strength.
-    //
-    // This isn't technically correct since the vector is supposed to define the
-    // aperture and not rotate the perceived soundfield, but in practice it's
-    // probably good enough.
-    static Mat4F get_transform_from_vector(
-        const float* vec)
-    {
-        const auto length = std::sqrt((vec[0] * vec[0]) + (vec[1] * vec[1]) + (vec[2] * vec[2]));
+        effect_type_ = effect_type;
+        instance_count_ = instance_count;
 
-        // Define a Z-focus (X in Ambisonics) transform, given the panning vector
-        // length.
-        const auto sa = std::sin(std::min(length, 1.0F) * (Math::pi / 4.0F));
+        device_.initialize(ChannelFormat::stereo, sampling_rate);
 
-        const auto zfocus = Mat4F{{
-            {1.0F / (1.0F + sa), 0.0F, 0.0F, (sa / (1.0F + sa)) / 1.732050808F,},
-            {0.0F, std::sqrt((1.0F - sa) / (1.0F + sa)), 0.0F, 0.0F,},
-            {0.0F, 0.0F, std::sqrt((1.0F - sa) / (1.0F + sa)), 0.0F,},
-            {(sa / (1.0F + sa)) * 1.732050808F, 0.0F, 0.0F, 1.0F / (1.0F + sa),}
-        }};
+        auto effect = Effect{};
+        effect.set_type_and_defaults(effect_type);
 
-        // Define rotation around X (Y in Ambisonics)
-        auto a = std::atan2(vec[1], std::sqrt((vec[0] * vec[0]) + (vec[2] * vec[2])));
+        lanes_.clear();
 
-        const auto xrot = Mat4F{{
-            {1.0F, 0.0F, 0.0F, 0.0F,},
-            {0.0F, 1.0F, 0.0F, 0.0F,},
-            {0.0F, 0.0F,  std::cos(a), std::sin(a),},
-            {0.0F, 0.0F, -std::sin(a), std::cos(a),},
-        }};
+        for (int index = 0; index < instance_count; index += lane_count_)
+        {
+            auto lanes = EffectLanesUPtr{create_lanes(effect_type)};
 
-        // Define rotation around Y (Z in Ambisonics). NOTE: EFX's reverb vectors
-        // use a right-handled coordinate system, compared to the rest of OpenAL
-        // which uses left-handed. This is fixed by negating Z, however it would
-        // need to also be negated to get a proper Ambisonics angle, thus
-        // cancelling it out.
-        a = std::atan2(-vec[0], vec[2]);
+            if (!lanes)
+            {
+                return EffectBatchErrorMessages::AllocateImpl;
+            }
 
-        const auto yrot = Mat4F{{
-            {1.0F, 0.0F, 0.0F, 0.0F,},
-            {0.0F, std::cos(a), 0.0F, std::sin(a),},
-            {0.0F, 0.0F, 1.0F, 0.0F,},
-            {0.0F, -std::sin(a), 0.0F, std::cos(a),},
-        }};
+            lane_count_ = lanes->get_lane_count();
 
-        // Define a matrix that first focuses on Z, then rotates around X then Y to
-        // focus the output in the direction of the vector.
-        return matrix_mult(yrot, matrix_mult(xrot, zfocus));
+            lanes->update_device(device_);
+
+            for (int lane = 0; lane < lane_count_; ++lane)
+            {
+                lanes->update(lane, device_, effect.props_);
+            }
+
+            lanes_.push_back(std::move(lanes));
+        }
+
+        silence_.fill(0.0F);
+
+        return EffectBatchErrorMessages::NoError;
     }
 
-    // Note: res is transposed.
-    static Mat4F matrix_mult_t(
-        const Mat4F& a,
-        const Mat4F& b)
+    void set_effect_props(
+        const int instance_index,
+        const EffectProps& effect_props)
     {
-        Mat4F result;
+        auto effect = Effect{effect_type_, effect_props};
+        effect.normalize();
 
-        for (int col = 0; col < 4; ++col)
+        lanes_[instance_index / lane_count_]->update(
+            instance_index % lane_count_,
+            device_,
+            effect.props_);
+    }
+
+    void process(
+        const int sample_count,
+        const float* const* src_samples,
+        float* const* dst_samples)
+    {
+        for (int base = 0; base < sample_count; )
         {
-            for (int row = 0; row < 4; ++row)
+            const auto todo = std::min(sample_count - base, max_sample_buffer_size);
+
+            for (int g = 0; g < static_cast<int>(lanes_.size()); ++g)
             {
-                result(col, row) =
-                    (a(row, 0) * b(0, col)) +
-                    (a(row, 1) * b(1, col)) +
-                    (a(row, 2) * b(2, col)) +
-                    (a(row, 3) * b(3, col));
+                EffectLanes::SrcSamples src_lanes;
+                EffectLanes::DstSamples dst_lanes;
+
+                for (int lane = 0; lane < lane_count_; ++lane)
+                {
+                    const auto index = (g * lane_count_) + lane;
+
+                    if (index < instance_count_)
+                    {
+                        src_lanes[lane] = &src_samples[index][base];
+                        dst_lanes[(2 * lane) + 0] = &dst_samples[(2 * index) + 0][base];
+                        dst_lanes[(2 * lane) + 1] = &dst_samples[(2 * index) + 1][base];
+                    }
+                    else
+                    {
+                        src_lanes[lane] = silence_.data();
+                        dst_lanes[(2 * lane) + 0] = discarded_.data();
+                        dst_lanes[(2 * lane) + 1] = discarded_.data();
+                    }
+                }
+
+                const auto used_lane_count = std::min(lane_count_, instance_count_ - (g * lane_count_));
+
+                lanes_[g]->process(todo, used_lane_count, src_lanes, dst_lanes);
             }
-        }
 
-        return result;
+            base += todo;
+        }
     }
 
-    // Update the early and late 3D panning gains.
-    void update_3d_panning(
-        Device& device,
-        const float* reflections_pan,
-        const float* late_reverb_pan,
-        const float gain,
-        const float early_gain,
-        const float late_gain)
-    {
-        Mat4F transform;
-        Mat4F rot;
 
-        dst_buffers_ = &device.sample_buffers_;
-        dst_channel_count_ = device.channel_count_;
+private:
+    // Creates the lanes as wide as the vectors of the kernels in use.
+    static EffectLanes* create_lanes(
+        const EffectType effect_type)
+    {
+#ifdef OALSFXPP_WIDE_LANES
+        switch (Kernels::current.simd_level_)
+        {
+        case SimdLevel::avx512:
+            return create_lanes<FloatN<16>>(effect_type);
 
-        // Create a matrix that first converts A-Format to B-Format, then rotates
-        // the B-Format soundfield according to the panning vector.
-        rot = get_transform_from_vector(reflections_pan);
-        transform = matrix_mult_t(rot, a2b);
-        clear_gains(early_.pan_gains_);
+        case SimdLevel::avx2:
+            return create_lanes<FloatN<8>>(effect_type);
 
-        for (int i = 0; i < max_effect_channels; ++i)
-        {
-            Panning::compute_first_order_gains(
-                device.channel_count_,
-                device.foa_,
-                transform.m_[i],
-                gain * early_gain,
-                early_.pan_gains_[i]);
+        default:
+            break;
         }
+#endif // OALSFXPP_WIDE_LANES
 
-        rot = get_transform_from_vector(late_reverb_pan);
-        transform = matrix_mult_t(rot, a2b);
-        clear_gains(late_.pan_gains_);
+        return create_lanes<Float4>(effect_type);
+    }
 
-        for (int i = 0; i < max_effect_channels; ++i)
+    template<typename TVector>
+    static EffectLanes* create_lanes(
+        const EffectType effect_type)
+    {
+        switch (effect_type)
         {
-            Panning::compute_first_order_gains(
-                device.channel_count_,
-                device.foa_,
-                transform.m_[i],
-                gain * late_gain,
-                late_.pan_gains_[i]);
+        case EffectType::chorus:
+            return new (std::nothrow) ChorusLanes<TVector>{};
+
+        case EffectType::compressor:
+            return new (std::nothrow) CompressorLanes<TVector>{};
+
+        case EffectType::eax_reverb:
+        case EffectType::reverb:
+            return ReverbLanes<TVector>::create(effect_type);
+
+        case EffectType::echo:
+            return new (std::nothrow) EchoLanes<TVector>{};
+
+        case EffectType::flanger:
+            return new (std::nothrow) FlangerLanes<TVector>{};
+
+        default:
+            return nullptr;
         }
     }
+}; // EffectBatch::Impl
 
 
-    //
-    // Effect Processing
-    //
+EffectBatch::EffectBatch()
+    :
+    pimpl_{},
+    error_message_{EffectBatchErrorMessages::NoError}
+{
+}
 
-    // Basic delay line input/output routines.
-    static float delay_line_out(
-        const DelayLineI* delay,
-        const int offset,
-        const int c)
+EffectBatch::~EffectBatch()
+{
+    uninitialize();
+}
+
+bool EffectBatch::initialize(
+    const EffectType effect_type,
+    const int sampling_rate,
+    const int instance_count)
+{
+    uninitialize();
+
+    Kernels::select();
+
+    pimpl_.reset(new (std::nothrow) Impl{});
+
+    if (!pimpl_)
     {
-        return delay->lines_[offset & delay->mask_][c];
+        error_message_ = EffectBatchErrorMessages::AllocateImpl;
+        return false;
     }
 
-    // Cross-faded delay line output routine.  Instead of interpolating the
-    // offsets, this interpolates (cross-fades) the outputs at each offset.
-    static float faded_delay_line_out(
-        const DelayLineI* delay,
-        const int off0,
-        const int off1,
-        const int c,
-        const float mu)
+    error_message_ = pimpl_->initialize(effect_type, sampling_rate, instance_count);
+
+    if (error_message_ != EffectBatchErrorMessages::NoError)
     {
-        return Math::lerp(delay->lines_[off0 & delay->mask_][c], delay->lines_[off1 & delay->mask_][c], mu);
+        pimpl_ = nullptr;
+        return false;
     }
 
-    static float delay_out_faded(
-        const DelayLineI* delay,
-        const int off0,
-        const int off1,
-        const int c,
-        const float mu)
+    return true;
+}
+
+bool EffectBatch::is_initialized() const
+{
+    return pimpl_ != nullptr;
+}
+
+EffectType EffectBatch::get_effect_type() const
+{
+    if (!is_initialized())
     {
-        return faded_delay_line_out(delay, off0, off1, c, mu);
+        error_message_ = EffectBatchErrorMessages::NotInitialized;
+        return EffectType::null;
     }
 
-    static float delay_out_unfaded(
-        const DelayLineI* delay,
-        const int off0,
-        const int off1,
-        const int c,
-        const float mu)
-    {
-        static_cast<void>(off1);
-        static_cast<void>(mu);
+    return pimpl_->effect_type_;
+}
 
-        return delay_line_out(delay, off0, c);
+int EffectBatch::get_instance_count() const
+{
+    if (!is_initialized())
+    {
+        error_message_ = EffectBatchErrorMessages::NotInitialized;
+        return 0;
     }
 
-    using DelayOutFunc = float (*)(
-        const DelayLineI* delay,
-        const int off0,
-        const int off1,
-        const int c,
-        const float mu);
+    return pimpl_->instance_count_;
+}
 
-    static void delay_line_in(
-        DelayLineI* delay,
-        const int offset,
-        const int c,
-        const float in)
+bool EffectBatch::set_effect_props(
+    const int instance_index,
+    const EffectProps& effect_props)
+{
+    if (!is_initialized())
     {
-        delay->lines_[offset & delay->mask_][c] = in;
+        error_message_ = EffectBatchErrorMessages::NotInitialized;
+        return false;
     }
 
-    static void delay_line_in4(
-        DelayLineI* delay,
-        int offset,
-        const float in[4])
+    if (instance_index < 0 || instance_index >= pimpl_->instance_count_)
     {
-        offset &= delay->mask_;
+        error_message_ = EffectBatchErrorMessages::InstanceIndexOutOfRange;
+        return false;
+    }
 
-        for (int i = 0; i < 4; ++i)
-        {
-            delay->lines_[offset][i] = in[i];
-        }
+    pimpl_->set_effect_props(instance_index, effect_props);
+
+    return true;
+}
+
+bool EffectBatch::process(
+    const int sample_count,
+    const float* const* src_samples,
+    float* const* dst_samples)
+{
+    if (!is_initialized())
+    {
+        error_message_ = EffectBatchErrorMessages::NotInitialized;
+        return false;
     }
 
-    static void delay_line_in4_rev(
-        DelayLineI* delay,
-        int offset,
-        const float in[4])
+    if (sample_count == 0)
     {
-        offset &= delay->mask_;
+        return true;
+    }
 
-        for (int i = 0; i < 4; ++i)
-        {
-            delay->lines_[offset][i] = in[3 - i];
-        }
+    if (!src_samples)
+    {
+        error_message_ = EffectBatchErrorMessages::NoSrcSamples;
+        return false;
     }
 
-    void calc_modulation_delays(
-        int* delays,
-        const int todo)
+    if (!dst_samples)
     {
-        auto index = mod_.index_;
-        auto range = mod_.filter_;
+        error_message_ = EffectBatchErrorMessages::NoDstSamples;
+        return false;
+    }
 
-        for (int i = 0; i < todo; ++i)
-        {
-            // Calculate the sinus rhythm (dependent on modulation time and the
-            // sampling rate).
-            const auto sinus = std::sin(Math::tau * index / mod_.range_);
+    pimpl_->process(sample_count, src_samples, dst_samples);
 
-            // Step the modulation index forward, keeping it bound to its range.
-            index = (index + 1) % mod_.range_;
+    return true;
+}
 
-            // The depth determines the range over which to read the input samples
-            // from, so it must be filtered to reduce the distortion caused by even
-            // small parameter changes.
-            range = Math::lerp(range, mod_.depth_, mod_.coeff_);
+void EffectBatch::uninitialize()
+{
+    pimpl_ = nullptr;
+}
 
-            // Calculate the read offset.
-            delays[i] = std::lround(range * sinus);
-        }
+const char* EffectBatch::get_error_message() const
+{
+    return error_message_;
+}
 
-        mod_.index_ = index;
-        mod_.filter_ = range;
+bool EffectBatch::is_effect_type_supported(
+    const EffectType effect_type)
+{
+    switch (effect_type)
+    {
+    case EffectType::chorus:
+    case EffectType::compressor:
+    case EffectType::eax_reverb:
+    case EffectType::echo:
+    case EffectType::flanger:
+    case EffectType::reverb:
+        return true;
+
+    default:
+        return false;
     }
+}
 
-    // Applies a scattering matrix to the 4-line (vector) input.  This is used
-    // for both the below vector all-pass model and to perform modal feed-back
-    // delay network (FDN) mixing.
-    //
-    // The matrix is derived from a skew-symmetric matrix to form a 4D rotation
-    // matrix with a single unitary rotational parameter:
-    //
-    //     [  d,  a,  b,  c ]          1 = a^2 + b^2 + c^2 + d^2
-    //     [ -a,  d,  c, -b ]
-    //     [ -b, -c,  d,  a ]
-    //     [ -c,  b, -a,  d ]
-    //
-    // The rotation is constructed from the effect's diffusion parameter,
-    // yielding:
-    //
-    //     1 = x^2 + 3 y^2
-    //
-    // Where a, b, and c are the coefficient y with differing signs, and d is the
-    // coefficient x.  The final matrix is thus:
-    //
-    //     [  x,  y, -y,  y ]          n = sqrt(matrix_order - 1)
-    //     [ -y,  x,  y,  y ]          t = diffusion_parameter * atan(n)
-    //     [  y, -y,  x,  y ]          x = cos(t)
-    //     [ -y, -y, -y,  x ]          y = sin(t) / n
-    //
-    // Any square orthogonal matrix with an order that is a power of two will
-    // work (where ^T is transpose, ^-1 is inverse):
-    //
-    //     M^T = M^-1
-    //
-    // Using that knowledge, finding an appropriate matrix can be accomplished
-    // naively by searching all combinations of:
-    //
-    //     M = D + S - S^T
-    //
-    // Where D is a diagonal matrix (of x), and S is a triangular matrix (of y)
-    // whose combination of signs are being iterated.
-    //
-    static void vector_partial_scatter(
-        float* vec,
-        const float x_coeff,
-        const float y_coeff)
-    {
-        const float f[] = {vec[0], vec[1], vec[2], vec[3],};
+// EffectBatch
+// ==========================================================================
+
+
+// ==========================================================================
+// PresetBank
+
+struct PresetBankErrorMessages
+{
+    static constexpr auto NoError = "";
+    static constexpr auto AllocateImpl = "Failed to allocate implementaion class.";
+    static constexpr auto NotLoaded = "Not loaded.";
+    static constexpr auto NoFileName = "No file name.";
+    static constexpr auto MapFile = "Failed to map the file.";
+    static constexpr auto NotBank = "Not a preset bank.";
+    static constexpr auto BankMismatch = "The bank is of another version or platform.";
+    static constexpr auto InvalidBank = "Invalid preset bank.";
+    static constexpr auto PresetIndexOutOfRange = "Preset index is out of range.";
+    static constexpr auto InvalidPreset = "Invalid preset.";
+    static constexpr auto NoPresets = "No presets.";
+    static constexpr auto PresetCountOutOfRange = "Preset count is out of range.";
+    static constexpr auto NoName = "No preset name.";
+    static constexpr auto DuplicateName = "Duplicate preset name.";
+    static constexpr auto TooLarge = "The bank is too large.";
+}; // PresetBankErrorMessages
+
+// The layout of a bank file: the header, the records, the index and the
+// names, one after another.
+struct PresetBankHeader
+{
+    // "OSFB" in the native byte order.
+    static constexpr std::uint32_t bank_signature = 0x4246534F;
+
+    // Bumped on any change of the layout, including "Effect" and "SendProps".
+    static constexpr std::uint32_t bank_version = 1;
+
+
+    std::uint32_t signature_;
+    std::uint32_t version_;
+
+    // The size of a record, which tells the layouts of the platforms apart.
+    std::uint32_t record_size_;
+
+    std::uint32_t preset_count_;
+
+    // A power of two.
+    std::uint32_t index_size_;
+
+    std::uint32_t names_size_;
+}; // PresetBankHeader
+
+struct PresetBankRecord
+{
+    Effect effect_;
+    SendProps send_props_;
+
+    // The name within the names, not counting its terminating null.
+    std::uint32_t name_offset_;
+    std::uint32_t name_size_;
+}; // PresetBankRecord
+
+// An open-addressed slot of the name index.
+struct PresetBankSlot
+{
+    std::uint32_t hash_;
+
+    // The record's index plus one. Zero means an empty slot.
+    std::uint32_t record_;
+}; // PresetBankSlot
+
+static_assert(std::is_trivially_copyable<PresetBankRecord>::value, "Expected a trivially copyable record.");
+static_assert(sizeof(PresetBankHeader) % alignof(PresetBankRecord) == 0, "Unaligned records.");
+static_assert(sizeof(PresetBankRecord) % alignof(PresetBankSlot) == 0, "Unaligned index.");
+
+constexpr std::uint32_t PresetBankHeader::bank_signature;
+constexpr std::uint32_t PresetBankHeader::bank_version;
 
-        vec[0] = (x_coeff * f[0]) + (y_coeff * (f[1] + -f[2] + f[3]));
-        vec[1] = (x_coeff * f[1]) + (y_coeff * (-f[0] + f[2] + f[3]));
-        vec[2] = (x_coeff * f[2]) + (y_coeff * (f[0] + -f[1] + f[3]));
-        vec[3] = (x_coeff * f[3]) + (y_coeff * (-f[0] + -f[1] + -f[2]));
+
+class PresetBank::Impl
+{
+public:
+    MappedFile file_;
+
+    // Within the mapping.
+    const PresetBankRecord* records_;
+    const PresetBankSlot* index_;
+    const char* names_;
+
+    int preset_count_;
+    std::uint32_t index_mask_;
+    std::uint32_t names_size_;
+
+
+    Impl()
+        :
+        file_{},
+        records_{},
+        index_{},
+        names_{},
+        preset_count_{},
+        index_mask_{},
+        names_size_{}
+    {
     }
 
-    // This applies a Gerzon multiple-in/multiple-out (MIMO) vector all-pass
-    // filter to the 4-line input.
-    //
-    // It works by vectorizing a regular all-pass filter and replacing the delay
-    // element with a scattering matrix (like the one above) and a diagonal
-    // matrix of delay elements.
-    //
-    // Two static specializations are used for transitional (cross-faded) delay
-    // line processing and non-transitional processing.
-    //
-    static void vector_allpass_x(
-        DelayOutFunc delay_out_func,
-        float* vec,
-        const int offset,
-        const float feed_coeff,
-        const float x_coeff,
-        const float y_coeff,
-        const float mu,
-        VecAllpass *vap)
-    {
-        float f[4];
+    const char* load(
+        const char* file_name)
+    {
+        if (!file_.open(file_name))
+        {
+            return PresetBankErrorMessages::MapFile;
+        }
+
+        const auto data = file_.get_data();
+        const auto size = file_.get_size();
+
+        auto header = PresetBankHeader{};
+
+        if (size < sizeof(PresetBankHeader))
+        {
+            return PresetBankErrorMessages::NotBank;
+        }
+
+        std::memcpy(&header, data, sizeof(PresetBankHeader));
+
+        if (header.signature_ != PresetBankHeader::bank_signature)
+        {
+            return PresetBankErrorMessages::NotBank;
+        }
+
+        if (header.version_ != PresetBankHeader::bank_version ||
+            header.record_size_ != sizeof(PresetBankRecord))
+        {
+            return PresetBankErrorMessages::BankMismatch;
+        }
 
-        for (int i = 0; i < 4; i++)
+        if (header.preset_count_ > static_cast<std::uint32_t>(std::numeric_limits<int>::max()) ||
+            header.index_size_ == 0 ||
+            (header.index_size_ & (header.index_size_ - 1)) != 0 ||
+            header.index_size_ <= header.preset_count_ ||
+            header.names_size_ == 0)
         {
-            auto input = vec[i];
+            return PresetBankErrorMessages::InvalidBank;
+        }
 
-            vec[i] = delay_out_func(
-                &vap->delay_,
-                offset - vap->offsets_[i][0],
-                offset - vap->offsets_[i][1],
-                i,
-                mu) - (feed_coeff * input);
+        const auto records_size = std::size_t{header.preset_count_} * sizeof(PresetBankRecord);
+        const auto index_size = std::size_t{header.index_size_} * sizeof(PresetBankSlot);
 
-            f[i] = input + (feed_coeff * vec[i]);
+        if (size != sizeof(PresetBankHeader) + records_size + index_size + header.names_size_)
+        {
+            return PresetBankErrorMessages::InvalidBank;
         }
 
-        vector_partial_scatter(f, x_coeff, y_coeff);
+        // The records are checked on access, so a load touches the header only.
+        const auto records = &data[sizeof(PresetBankHeader)];
+        const auto index = &records[records_size];
+        const auto names = &index[index_size];
 
-        delay_line_in4(&vap->delay_, offset, f);
-    }
+        records_ = reinterpret_cast<const PresetBankRecord*>(records);
+        index_ = reinterpret_cast<const PresetBankSlot*>(index);
+        names_ = reinterpret_cast<const char*>(names);
 
-    static void vector_allpass_unfaded(
-        float* vec,
-        const int offset,
-        const float feed_coeff,
-        const float x_coeff,
-        const float y_coeff,
-        const float mu,
-        VecAllpass* vap)
-    {
-        vector_allpass_x(delay_out_unfaded, vec, offset, feed_coeff, x_coeff, y_coeff, mu, vap);
-    }
+        preset_count_ = static_cast<int>(header.preset_count_);
+        index_mask_ = header.index_size_ - 1;
+        names_size_ = header.names_size_;
 
-    static void vector_allpass_faded(
-        float* vec,
-        const int offset,
-        const float feed_coeff,
-        const float x_coeff,
-        const float y_coeff,
-        const float mu,
-        VecAllpass* vap)
-    {
-        vector_allpass_x(delay_out_faded, vec, offset, feed_coeff, x_coeff, y_coeff, mu, vap);
+        return PresetBankErrorMessages::NoError;
     }
 
-    // A helper to reverse vector components.
-    static void vector_reverse(
-        float vec[4])
+    // Returns null for a name out of the names.
+    const char* get_name(
+        const int preset_index) const
     {
-        std::swap(vec[0], vec[3]);
-        std::swap(vec[1], vec[2]);
-    }
+        const auto& record = records_[preset_index];
 
+        if (record.name_offset_ >= names_size_ ||
+            record.name_size_ >= names_size_ - record.name_offset_ ||
+            names_[record.name_offset_ + record.name_size_] != '\0')
+        {
+            return nullptr;
+        }
 
-    using VectorAllpassFunc = void (*)(
-        float* vec,
-        const int offset,
-        const float feed_coeff,
-        const float x_coeff,
-        const float y_coeff,
-        const float mu,
-        VecAllpass* vap);
+        return &names_[record.name_offset_];
+    }
 
-    // This generates early reflections.
-    //
-    // This is done by obtaining the primary reflections (those arriving from the
-    // same direction as the source) from the main delay line.  These are
-    // attenuated and all-pass filtered (based on the diffusion parameter).
-    //
-    // The early lines are then fed in reverse (according to the approximately
-    // opposite spatial location of the A-Format lines) to create the secondary
-    // reflections (those arriving from the opposite direction as the source).
-    //
-    // The early response is then completed by combining the primary reflections
-    // with the delayed and attenuated output from the early lines.
-    //
-    // Finally, the early response is reversed, scattered (based on diffusion),
-    // and fed into the late reverb section of the main delay line.
-    //
-    // Two static specializations are used for transitional (cross-faded) delay
-    // line processing and non-transitional processing.
-    //
-    void early_reflection_x(
-        VectorAllpassFunc vector_allpass_func,
-        DelayOutFunc delay_out_func,
-        const int todo,
-        float fade,
-        Samples& out)
+    int find(
+        const char* name) const
     {
-        float f[4];
-        auto current_offset = offset_;
+        const auto name_size = std::strlen(name);
+        const auto hash = hash_name(name, name_size);
 
-        for (int i = 0; i < todo; ++i)
+        for (auto i = hash & index_mask_, probe_count = index_mask_ + 1; probe_count > 0; --probe_count)
         {
-            for (int j = 0; j < 4; ++j)
+            const auto& slot = index_[i];
+
+            if (slot.record_ == 0 || slot.record_ > static_cast<std::uint32_t>(preset_count_))
             {
-                f[j] = delay_out_func(
-                    &delay_,
-                    current_offset - early_delay_taps_[j][0],
-                    current_offset - early_delay_taps_[j][1],
-                    j, fade) * early_delay_coeffs_[j];
+                return -1;
             }
 
-            vector_allpass_func(f, current_offset, ap_feed_coeff_, mix_x_, mix_y_, fade, &early_.vec_ap_);
+            const auto preset_index = static_cast<int>(slot.record_ - 1);
 
-            delay_line_in4_rev(&early_.delay_, current_offset, f);
-
-            for (int j = 0; j < 4; ++j)
+            if (slot.hash_ == hash && records_[preset_index].name_size_ == name_size)
             {
-                f[j] += delay_out_func(&early_.delay_,
-                    current_offset - early_.offsets_[j][0],
-                    current_offset - early_.offsets_[j][1], j, fade
-                ) * early_.coeffs_[j];
-            }
+                const auto preset_name = get_name(preset_index);
 
-            for (int j = 0; j < 4; ++j)
-            {
-                out[j][i] = f[j];
+                if (preset_name && std::memcmp(preset_name, name, name_size) == 0)
+                {
+                    return preset_index;
+                }
             }
 
-            vector_reverse(f);
+            i = (i + 1) & index_mask_;
+        }
+
+        return -1;
+    }
 
-            vector_partial_scatter(f, mix_x_, mix_y_);
+    const char* get_preset(
+        const int preset_index,
+        Effect& effect,
+        SendProps& send_props) const
+    {
+        const auto& record = records_[preset_index];
 
-            delay_line_in4(&delay_, current_offset - late_feed_tap_, f);
+        auto preset_effect = record.effect_;
 
-            current_offset += 1;
-            fade += fade_step;
+        if (static_cast<unsigned int>(preset_effect.type_) > static_cast<unsigned int>(EffectType::convolution))
+        {
+            return PresetBankErrorMessages::InvalidPreset;
         }
-    }
 
-    void early_reflection_unfaded(
-        const int todo,
-        float fade,
-        Samples& out)
-    {
-        early_reflection_x(vector_allpass_unfaded, delay_out_unfaded, todo, fade, out);
-    }
+        // The flags come from the file as they are, so any byte but zero is
+        // read as true.
+        switch (preset_effect.type_)
+        {
+        case EffectType::compressor:
+            sanitize_flag(preset_effect.props_.compressor_.on_off_);
+            break;
 
-    void early_reflection_faded(
-        const int todo,
-        float fade,
-        Samples& out)
-    {
-        early_reflection_x(vector_allpass_faded, delay_out_faded, todo, fade, out);
-    }
+        case EffectType::convolution:
+            preset_effect.props_.convolution_.impulse_response_ = nullptr;
+            break;
 
-    // Applies a first order filter section.
-    static float first_order_filter(
-        const float in,
-        const float coeffs[3],
-        float state[2])
-    {
-        const auto out = (coeffs[0] * in) + (coeffs[1] * state[0]) + (coeffs[2] * state[1]);
+        case EffectType::reverb:
+        case EffectType::eax_reverb:
+            sanitize_flag(preset_effect.props_.reverb_.decay_hf_limit_);
+            break;
 
-        state[0] = in;
-        state[1] = out;
+        default:
+            break;
+        }
 
-        return out;
-    }
+        preset_effect.normalize();
 
-    // Applies the two T60 damping filter sections.
-    float late_t60_filter(
-        const int index,
-        const float in)
-    {
-        const auto out = first_order_filter(
-            in,
-            late_.filters_[index].lf_coeffs_.data(),
-            late_.filters_[index].states_[0].data());
+        effect = preset_effect;
 
-        return late_.filters_[index].mid_coeff_ *
-            first_order_filter(
-                out,
-                late_.filters_[index].hf_coeffs_.data(),
-                late_.filters_[index].states_[1].data());
+        send_props = record.send_props_;
+        send_props.normalize();
+
+        return PresetBankErrorMessages::NoError;
     }
 
-    // This generates the reverb tail using a modified feed-back delay network
-    // (FDN).
-    //
-    // Results from the early reflections are attenuated by the density gain and
-    // mixed with the output from the late delay lines.
-    //
-    // The late response is then completed by T60 and all-pass filtering the mix.
-    //
-    // Finally, the lines are reversed (so they feed their opposite directions)
-    // and scattered with the FDN matrix before re-feeding the delay lines.
-    //
-    // Two static specializations are used for transitional (cross-faded) delay
-    // line processing and non-transitional processing.
-    //
-    void late_reverb_x(
-        VectorAllpassFunc vector_allpass_func,
-        DelayOutFunc delay_out_func,
-        const int todo,
-        float fade,
-        Samples& out)
+    static const char* build(
+        const Preset* presets,
+        const int preset_count,
+        std::vector<unsigned char>& bank)
     {
-        float f[4];
-        int moddelay[max_update_samples];
+        auto index_size = std::size_t{1};
 
-        calc_modulation_delays(moddelay, todo);
+        while (index_size < 2 * static_cast<std::size_t>(preset_count))
+        {
+            index_size *= 2;
+        }
 
-        auto current_offset = offset_;
+        auto names_size = std::size_t{};
 
-        for (int i = 0; i < todo; i++)
+        for (int i = 0; i < preset_count; ++i)
         {
-            for (int j = 0; j < 4; ++j)
+            if (!presets[i].name_ || presets[i].name_[0] == '\0')
             {
-                f[j] = delay_out_func(
-                    &delay_,
-                    current_offset - late_delay_taps_[j][0],
-                    current_offset - late_delay_taps_[j][1],
-                    j,
-                    fade
-                ) * late_.density_gain_;
+                return PresetBankErrorMessages::NoName;
             }
 
-            const auto current_delay = current_offset - moddelay[i];
+            names_size += std::strlen(presets[i].name_) + 1;
+        }
 
-            for (int j = 0; j < 4; ++j)
-            {
-                f[j] += delay_out_func(&late_.delay_,
-                    current_delay - late_.offsets_[j][0],
-                    current_delay - late_.offsets_[j][1],
-                    j,
-                    fade);
-            }
+        const auto records_size = static_cast<std::size_t>(preset_count) * sizeof(PresetBankRecord);
 
-            for (int j = 0; j < 4; ++j)
+        if (index_size > std::numeric_limits<std::uint32_t>::max() ||
+            names_size > std::numeric_limits<std::uint32_t>::max() ||
+            records_size > std::numeric_limits<std::uint32_t>::max())
+        {
+            return PresetBankErrorMessages::TooLarge;
+        }
+
+        auto header = PresetBankHeader{};
+        header.signature_ = PresetBankHeader::bank_signature;
+        header.version_ = PresetBankHeader::bank_version;
+        header.record_size_ = sizeof(PresetBankRecord);
+        header.preset_count_ = static_cast<std::uint32_t>(preset_count);
+        header.index_size_ = static_cast<std::uint32_t>(index_size);
+        header.names_size_ = static_cast<std::uint32_t>(names_size);
+
+        auto records = std::vector<PresetBankRecord>(preset_count);
+        auto index = std::vector<PresetBankSlot>(index_size);
+        auto names = std::vector<char>{};
+        names.reserve(names_size);
+
+        const auto index_mask = static_cast<std::uint32_t>(index_size - 1);
+
+        for (int i = 0; i < preset_count; ++i)
+        {
+            const auto& preset = presets[i];
+            const auto name_size = std::strlen(preset.name_);
+            const auto hash = hash_name(preset.name_, name_size);
+
+            auto slot_index = hash & index_mask;
+
+            while (index[slot_index].record_ != 0)
             {
-                f[j] = late_t60_filter(j, f[j]);
+                const auto& other = presets[index[slot_index].record_ - 1];
+
+                if (index[slot_index].hash_ == hash && std::strcmp(other.name_, preset.name_) == 0)
+                {
+                    return PresetBankErrorMessages::DuplicateName;
+                }
+
+                slot_index = (slot_index + 1) & index_mask;
             }
 
-            vector_allpass_func(f, current_offset, ap_feed_coeff_, mix_x_, mix_y_, fade, &late_.vec_ap_);
+            index[slot_index].hash_ = hash;
+            index[slot_index].record_ = static_cast<std::uint32_t>(i + 1);
 
-            for (int j = 0; j < 4; ++j)
+            // Zeroed first, so the padding of the record is the same on every
+            // build.
+            auto& record = records[i];
+            std::memset(&record, 0, sizeof(PresetBankRecord));
+
+            record.effect_.type_ = preset.effect_.type_;
+            record.effect_.props_ = preset.effect_.props_;
+
+            if (record.effect_.type_ == EffectType::convolution)
             {
-                out[j][i] = f[j];
+                record.effect_.props_.convolution_.impulse_response_ = nullptr;
             }
 
-            vector_reverse(f);
+            record.send_props_ = preset.send_props_;
+            record.name_offset_ = static_cast<std::uint32_t>(names.size());
+            record.name_size_ = static_cast<std::uint32_t>(name_size);
+
+            names.insert(names.end(), preset.name_, preset.name_ + name_size + 1);
+        }
 
-            vector_partial_scatter(f, mix_x_, mix_y_);
+        const auto index_bytes = index_size * sizeof(PresetBankSlot);
 
-            delay_line_in4(&late_.delay_, current_offset, f);
+        bank.resize(sizeof(PresetBankHeader) + records_size + index_bytes + names_size);
 
-            current_offset += 1;
-            fade += fade_step;
+        auto dst = bank.data();
+        std::memcpy(dst, &header, sizeof(PresetBankHeader));
+        dst += sizeof(PresetBankHeader);
+
+        std::memcpy(dst, records.data(), records_size);
+        dst += records_size;
+
+        std::memcpy(dst, index.data(), index_bytes);
+        dst += index_bytes;
+
+        std::memcpy(dst, names.data(), names_size);
+
+        return PresetBankErrorMessages::NoError;
+    }
+
+    static void sanitize_flag(
+        bool& flag)
+    {
+        auto byte = static_cast<unsigned char>(0);
+        std::memcpy(&byte, &flag, 1);
+
+        flag = (byte != 0);
+    }
+
+    // FNV-1a.
+    static std::uint32_t hash_name(
+        const char* name,
+        const std::size_t name_size)
+    {
+        auto hash = std::uint32_t{2'166'136'261};
+
+        for (std::size_t i = 0; i < name_size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16'777'619;
         }
+
+        return hash;
     }
+}; // Impl
 
-    void late_reverb_unfaded(
-        const int todo,
-        float fade,
-        Samples& out)
+
+PresetBank::PresetBank()
+    :
+    pimpl_{},
+    error_message_{PresetBankErrorMessages::NoError}
+{
+}
+
+PresetBank::~PresetBank()
+{
+}
+
+bool PresetBank::load(
+    const char* file_name)
+{
+    unload();
+
+    if (!file_name)
     {
-        late_reverb_x(vector_allpass_unfaded, delay_out_unfaded, todo, fade, out);
+        error_message_ = PresetBankErrorMessages::NoFileName;
+        return false;
     }
 
-    void late_reverb_faded(
-        const int todo,
-        float fade,
-        Samples& out)
+    pimpl_.reset(new (std::nothrow) Impl{});
+
+    if (!pimpl_)
     {
-        late_reverb_x(vector_allpass_faded, delay_out_faded, todo, fade, out);
+        error_message_ = PresetBankErrorMessages::AllocateImpl;
+        return false;
     }
 
-    // Perform the non-EAX reverb pass on a given input sample, resulting in
-    // four-channel output.
-    float verb_pass(
-        const int todo,
-        float fade,
-        const Samples& input,
-        Samples& early,
-        Samples& late)
+    error_message_ = pimpl_->load(file_name);
+
+    if (error_message_ != PresetBankErrorMessages::NoError)
     {
-        for (int c = 0; c < 4; ++c)
-        {
-            // Low-pass filter the incoming samples (use the early buffer as temp
-            // storage).
-            filters_[c].lp_.process(todo, input[c].data(), early[0].data());
+        pimpl_ = nullptr;
+        return false;
+    }
 
-            // Feed the initial delay line.
-            for (int i = 0; i < todo; ++i)
-            {
-                delay_line_in(&delay_, offset_ + i, c, early[0][i]);
-            }
-        }
+    return true;
+}
 
-        if (fade < 1.0F)
-        {
-            // Generate early reflections.
-            early_reflection_faded(todo, fade, early);
+void PresetBank::unload()
+{
+    pimpl_ = nullptr;
+    error_message_ = PresetBankErrorMessages::NoError;
+}
 
-            // Generate late reverb.
-            late_reverb_faded(todo, fade, late);
-            fade = std::min(1.0F, fade + (todo * fade_step));
-        }
-        else
-        {
-            // Generate early reflections.
-            early_reflection_unfaded(todo, fade, early);
+bool PresetBank::is_loaded() const
+{
+    return pimpl_ != nullptr;
+}
 
-            // Generate late reverb.
-            late_reverb_unfaded(todo, fade, late);
-        }
+int PresetBank::get_preset_count() const
+{
+    if (!is_loaded())
+    {
+        error_message_ = PresetBankErrorMessages::NotLoaded;
+        return 0;
+    }
 
-        // Step all delays forward one sample.
-        offset_ += todo;
+    return pimpl_->preset_count_;
+}
 
-        return fade;
+int PresetBank::find(
+    const char* name) const
+{
+    if (!is_loaded())
+    {
+        error_message_ = PresetBankErrorMessages::NotLoaded;
+        return -1;
     }
 
-    // Perform the EAX reverb pass on a given input sample, resulting in four-
-    // channel output.
-    float eax_verb_pass(
-        const int todo,
-        float fade,
-        const Samples& input,
-        Samples& early,
-        Samples& late)
+    if (!name)
     {
-        for (int c = 0; c < 4; ++c)
-        {
-            // Band-pass the incoming samples. Use the early output lines for temp
-            // storage.
-            filters_[c].lp_.process(todo, input[c].data(), early[0].data());
-            filters_[c].hp_.process(todo, early[0].data(), early[1].data());
+        error_message_ = PresetBankErrorMessages::NoName;
+        return -1;
+    }
 
-            // Feed the initial delay line.
-            for (int i = 0; i < todo; i++)
-            {
-                delay_line_in(&delay_, offset_ + i, c, early[1][i]);
-            }
-        }
+    return pimpl_->find(name);
+}
 
-        if (fade < 1.0F)
-        {
-            // Generate early reflections.
-            early_reflection_faded(todo, fade, early);
+const char* PresetBank::get_name(
+    const int preset_index) const
+{
+    if (!is_loaded())
+    {
+        error_message_ = PresetBankErrorMessages::NotLoaded;
+        return nullptr;
+    }
 
-            // Generate late reverb.
-            late_reverb_faded(todo, fade, late);
-            fade = std::min(1.0F, fade + (todo * fade_step));
-        }
-        else
-        {
-            // Generate early reflections.
-            early_reflection_unfaded(todo, fade, early);
+    if (preset_index < 0 || preset_index >= pimpl_->preset_count_)
+    {
+        error_message_ = PresetBankErrorMessages::PresetIndexOutOfRange;
+        return nullptr;
+    }
 
-            // Generate late reverb.
-            late_reverb_unfaded(todo, fade, late);
-        }
+    const auto name = pimpl_->get_name(preset_index);
 
-        // Step all delays forward.
-        offset_ += todo;
+    if (!name)
+    {
+        error_message_ = PresetBankErrorMessages::InvalidPreset;
+        return nullptr;
+    }
+
+    return name;
+}
+
+bool PresetBank::get_preset(
+    const int preset_index,
+    Effect& effect,
+    SendProps& send_props) const
+{
+    if (!is_loaded())
+    {
+        error_message_ = PresetBankErrorMessages::NotLoaded;
+        return false;
+    }
 
-        return fade;
+    if (preset_index < 0 || preset_index >= pimpl_->preset_count_)
+    {
+        error_message_ = PresetBankErrorMessages::PresetIndexOutOfRange;
+        return false;
     }
-}; // ReverbEffectState
 
+    error_message_ = pimpl_->get_preset(preset_index, effect, send_props);
 
-EffectState* EffectStateFactory::create_reverb()
+    return error_message_ == PresetBankErrorMessages::NoError;
+}
+
+bool PresetBank::build(
+    const Preset* presets,
+    const int preset_count,
+    std::vector<unsigned char>& bank)
 {
-    return create<ReverbEffectState>();
+    if (!presets)
+    {
+        error_message_ = PresetBankErrorMessages::NoPresets;
+        return false;
+    }
+
+    if (preset_count <= 0)
+    {
+        error_message_ = PresetBankErrorMessages::PresetCountOutOfRange;
+        return false;
+    }
+
+    error_message_ = Impl::build(presets, preset_count, bank);
+
+    return error_message_ == PresetBankErrorMessages::NoError;
 }
 
-// Effects
+const char* PresetBank::get_error_message() const
+{
+    return error_message_;
+}
+
+// PresetBank
 // ==========================================================================
 
 
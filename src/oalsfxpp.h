@@ -27,6 +27,7 @@ For a copy of the GNU General Public License see file COPYING.
 
 #include <array>
 #include <memory>
+#include <vector>
 
 
 namespace oalsfxpp
@@ -43,6 +44,13 @@ enum class ChannelFormat
     five_point_one_rear,
     six_point_one,
     seven_point_one,
+
+    // First-order ambisonics (B-format): W, Y, Z and X in ACN order with N3D
+    // scaling, the same as the effect slots' wet buffers.
+    //
+    // The input is treated as B-format too and passed through. Nothing is
+    // decoded to speakers; that is left to the caller.
+    b_format,
 }; // ChannelFormat
 
 enum class EffectType
@@ -59,8 +67,22 @@ enum class EffectType
     ring_modulator,
     reverb,
     eax_reverb,
+    multi_tap_echo,
+    dynamics,
+    convolution,
 }; // EffectType
 
+enum class SimdLevel
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+}; // SimdLevel
+
+
+class ImpulseResponse;
+
 
 union EffectProps
 {
@@ -138,6 +160,41 @@ union EffectProps
             const Compressor& b);
     }; // Compressor
 
+    struct Convolution
+    {
+        // The impulse response is split into partitions of one size, which
+        // costs the most for long responses.
+        static constexpr auto partitioning_uniform = 0;
+
+        // The partitions grow along the impulse response, which keeps the
+        // latency of the uniform partitioning at a fraction of its cost.
+        static constexpr auto partitioning_non_uniform = 1;
+
+        static constexpr auto min_partitioning = partitioning_uniform;
+        static constexpr auto max_partitioning = partitioning_non_uniform;
+        static constexpr auto default_partitioning = partitioning_non_uniform;
+
+        static constexpr auto min_gain = 0.0F;
+        static constexpr auto max_gain = 1.0F;
+        static constexpr auto default_gain = 1.0F;
+
+
+        // Not owned. Null means silence.
+        const ImpulseResponse* impulse_response_;
+        int partitioning_;
+        float gain_;
+
+
+        void set_defaults();
+
+        void normalize();
+
+
+        static bool are_equal(
+            const Convolution& a,
+            const Convolution& b);
+    }; // Convolution
+
     struct Dedicated
     {
         static constexpr auto min_gain = 0.0F;
@@ -198,6 +255,63 @@ union EffectProps
             const Distortion& b);
     }; // Distortion
 
+    // A feed-forward compressor; the maximum ratio makes it a limiter.
+    //
+    // The threshold, the knee and the makeup gain are in decibels; the attack
+    // and the release times are in seconds.
+    struct Dynamics
+    {
+        static constexpr auto detector_peak = 0;
+        static constexpr auto detector_rms = 1;
+
+        static constexpr auto min_detector = detector_peak;
+        static constexpr auto max_detector = detector_rms;
+        static constexpr auto default_detector = detector_peak;
+
+        static constexpr auto min_threshold = -60.0F;
+        static constexpr auto max_threshold = 0.0F;
+        static constexpr auto default_threshold = -12.0F;
+
+        static constexpr auto min_ratio = 1.0F;
+        static constexpr auto max_ratio = 100.0F;
+        static constexpr auto default_ratio = 4.0F;
+
+        static constexpr auto min_knee = 0.0F;
+        static constexpr auto max_knee = 24.0F;
+        static constexpr auto default_knee = 6.0F;
+
+        static constexpr auto min_attack_time = 0.0F;
+        static constexpr auto max_attack_time = 1.0F;
+        static constexpr auto default_attack_time = 0.005F;
+
+        static constexpr auto min_release_time = 0.001F;
+        static constexpr auto max_release_time = 5.0F;
+        static constexpr auto default_release_time = 0.1F;
+
+        static constexpr auto min_makeup_gain = 0.0F;
+        static constexpr auto max_makeup_gain = 24.0F;
+        static constexpr auto default_makeup_gain = 0.0F;
+
+
+        int detector_;
+        float threshold_;
+        float ratio_;
+        float knee_;
+        float attack_time_;
+        float release_time_;
+        float makeup_gain_;
+
+
+        void set_defaults();
+
+        void normalize();
+
+
+        static bool are_equal(
+            const Dynamics& a,
+            const Dynamics& b);
+    }; // Dynamics
+
     struct Echo
     {
         static constexpr auto min_delay = 0.0F;
@@ -353,6 +467,67 @@ union EffectProps
             const Flanger& b);
     }; // Flanger
 
+    // Up to max_taps taps over a shared delay line. The tap with the longest
+    // delay is fed back through the damping filter.
+    struct MultiTapEcho
+    {
+        static constexpr auto max_taps = 16;
+
+        static constexpr auto min_tap_count = 1;
+        static constexpr auto max_tap_count = max_taps;
+        static constexpr auto default_tap_count = 2;
+
+        static constexpr auto min_delay = 0.0F;
+        static constexpr auto max_delay = 1.0F;
+        static constexpr auto default_delay = 0.05F;
+
+        static constexpr auto min_gain = 0.0F;
+        static constexpr auto max_gain = 1.0F;
+        static constexpr auto default_gain = 1.0F;
+
+        static constexpr auto min_pan = -1.0F;
+        static constexpr auto max_pan = 1.0F;
+        static constexpr auto default_pan = 0.0F;
+
+        static constexpr auto min_damping = 0.0F;
+        static constexpr auto max_damping = 0.99F;
+        static constexpr auto default_damping = 0.5F;
+
+        static constexpr auto min_feedback = 0.0F;
+        static constexpr auto max_feedback = 1.0F;
+        static constexpr auto default_feedback = 0.5F;
+
+
+        struct Tap
+        {
+            // Delay in seconds.
+            float delay_;
+
+            float gain_;
+
+            // From -1 (left) to 1 (right).
+            float pan_;
+        }; // Tap
+
+        using Taps = std::array<Tap, max_taps>;
+
+
+        int tap_count_;
+        Taps taps_;
+        float damping_;
+        float feedback_;
+
+
+        void set_defaults();
+
+        void normalize();
+
+
+        static bool are_equal(
+            const MultiTapEcho& a,
+            const MultiTapEcho& b);
+    }; // MultiTapEcho
+
     struct Reverb
     {
         static constexpr auto min_density = 0.0F;
@@ -447,6 +622,33 @@ union EffectProps
         static constexpr auto max_decay_hf_limit = true;
         static constexpr auto default_decay_hf_limit = true;
 
+        // Processing quality.
+        //
+        // The cheaper qualities drop or simplify a part of the reverb.  The CPU
+        // cost relative to the full quality (standard / EAX reverb with
+        // modulation), and the size of the delay lines on a 48 kHz device:
+        //    full              100% / 100%    920 KiB
+        //    no modulation      98% /  92%    920 KiB  Unmodulated late lines.
+        //    half rate late     88% /  84%    784 KiB  Late reverb at half rate.
+        //    late only          75% /  80%    784 KiB  No early reflections.
+        //    early only         54% /  57%    392 KiB  No late reverb.
+        //
+        // The costs are from oalsfxpp_benchmark (stereo noise, AVX-512 kernels,
+        // one core of an Intel Xeon); they vary by a few percent between runs
+        // and more between machines.
+        //
+        // The standard reverb has no modulation, so "no modulation" does not
+        // change it.
+        static constexpr auto quality_full = 0;
+        static constexpr auto quality_no_modulation = 1;
+        static constexpr auto quality_half_rate_late = 2;
+        static constexpr auto quality_late_only = 3;
+        static constexpr auto quality_early_only = 4;
+
+        static constexpr auto min_quality = quality_full;
+        static constexpr auto max_quality = quality_early_only;
+        static constexpr auto default_quality = quality_full;
+
 
         float density_;
         float diffusion_;
@@ -471,6 +673,7 @@ union EffectProps
         float lf_reference_; // EAX
         float room_rolloff_factor_;
         bool decay_hf_limit_;
+        int quality_;
 
 
         void set_defaults();
@@ -520,11 +723,14 @@ union EffectProps
 
     Chorus chorus_;
     Compressor compressor_;
+    Convolution convolution_;
     Dedicated dedicated_;
     Distortion distortion_;
+    Dynamics dynamics_;
     Echo echo_;
     Equalizer equalizer_;
     Flanger flanger_;
+    MultiTapEcho multi_tap_echo_;
     Reverb reverb_;
     RingModulator ring_modulator_;
 }; // EffectProps
@@ -580,6 +786,17 @@ struct SendProps
         const SendProps& b);
 }; // SendProps
 
+// A built-in reverb preset, as listed by "ReverbPresets".
+struct ReverbPreset
+{
+    // The names of the declarations in lowercase, with the words of the
+    // category separated by underscores: "ice_palace", "small_room".
+    const char* category_;
+    const char* name_;
+
+    const EffectProps::Reverb* props_;
+}; // ReverbPreset
+
 struct ReverbPresets
 {
     struct Default
@@ -754,9 +971,117 @@ struct ReverbPresets
         static const EffectProps::Reverb chapel;
         static const EffectProps::Reverb small_water_room;
     }; // Misc
+
+
+    // Gets the count of the presets.
+    static int get_count();
+
+    // Gets a preset by index, in the order of the declarations above.
+    //
+    // Returns the preset or null on error.
+    static const ReverbPreset* get(
+        const int preset_index);
+
+    // Finds a preset by the category and the name.
+    //
+    // The lookup goes through a perfect hash built at compile time, and
+    // compares the names of one candidate only.
+    //
+    // Returns the preset or null if there is no such preset.
+    static const ReverbPreset* find(
+        const char* category,
+        const char* name);
 }; // ReverbPresets
 
 
+// An impulse response for the convolution effect.
+//
+// The samples are memory-mapped from the file. A response has one channel, or
+// four channels of B-Format for a spatial one, in the FuMa order (W, X, Y, Z)
+// and scaling of the usual B-Format files. The effect converts them to the
+// ACN order and the N3D scaling of its output, and resamples the response to
+// the effect's sampling rate.
+//
+// The effect converts the samples when the changes are applied, on the next
+// mix, so the instance must stay loaded until then. The effect tells responses
+// apart by the instance, so load another instance to change a response in use.
+class ImpulseResponse
+{
+public:
+    ImpulseResponse();
+
+    ImpulseResponse(
+        const ImpulseResponse& that) = delete;
+
+    ImpulseResponse& operator=(
+        const ImpulseResponse& that) = delete;
+
+    ~ImpulseResponse();
+
+
+    // Loads a WAV file.
+    //
+    // Supports 16, 24 or 32-bit integer and 32-bit float samples.
+    //
+    // Returns true on success or false otherwise.
+    bool load_wav(
+        const char* file_name);
+
+    // Loads a file of interleaved 32-bit float samples in the native byte
+    // order.
+    //
+    // Returns true on success or false otherwise.
+    bool load_raw(
+        const char* file_name,
+        const int channel_count,
+        const int sampling_rate);
+
+    // Unloads the samples.
+    void unload();
+
+    // Gets a loaded flag.
+    //
+    // Returns true if the samples are loaded or false otherwise.
+    bool is_loaded() const;
+
+    // Gets a channel count.
+    //
+    // Returns a channel count or zero on error.
+    int get_channel_count() const;
+
+    // Gets a sampling rate.
+    //
+    // Returns a sampling rate or zero on error.
+    int get_sampling_rate() const;
+
+    // Gets a length in samples per channel.
+    //
+    // Returns a sample count or zero on error.
+    int get_sample_count() const;
+
+    // Reads the samples of a channel, converted to float.
+    //
+    // Returns true on success or false otherwise.
+    bool read(
+        const int channel,
+        const int offset,
+        const int sample_count,
+        float* dst_samples) const;
+
+    // Gets a last error message.
+    const char* get_error_message() const;
+
+
+private:
+    class Impl;
+    using ImplUPtr = std::unique_ptr<Impl>;
+
+
+    ImplUPtr pimpl_;
+    mutable const char* error_message_;
+}; // ImpulseResponse
+
+
 class Api
 {
 public:
@@ -779,6 +1104,25 @@ public:
         const int sampling_rate,
         const int effect_count);
 
+    // Initializes the instance with the effects running at a lower sampling
+    // rate.
+    //
+    // The dry path runs at the device sampling rate. The effect slots run at
+    // the effect sampling rate, and their input and output are resampled with
+    // a band-limited filter, which passes up to 0.45 of the effect sampling
+    // rate and delays the wet path by about 40 samples of it.
+    //
+    // This saves the processing and the delay memory spent on the inaudible
+    // bandwidth of high device rates. The effect sampling rate should not
+    // exceed the device one.
+    //
+    // Returns true on success or false otherwise.
+    bool initialize(
+        const ChannelFormat channel_format,
+        const int sampling_rate,
+        const int effect_count,
+        const int effect_sampling_rate);
+
     // Gets instance's initialization flag.
     //
     // Returns true if the instance is initialized or false otherwise.
@@ -789,6 +1133,11 @@ public:
     // Returns a sampling rate or zero on error.
     int get_sampling_rate() const;
 
+    // Gets a sampling rate of the effects.
+    //
+    // Returns a sampling rate or zero on error.
+    int get_effect_sampling_rate() const;
+
     // Gets a channel format.
     //
     // Returns a channel format or "none" on error.
@@ -839,6 +1188,18 @@ public:
         const int effect_index,
         const Effect& effect);
 
+    // Sets the crossfade time of a change of the effect type, in seconds.
+    //
+    // On a change of the type, the new effect fades in while the old one
+    // fades out, so the old tail is not cut off. The old effect stops as soon
+    // as its tail is silent. A zero time (the default) switches at once.
+    //
+    // Takes effect on the next application of the changes.
+    //
+    // Returns true on success or false otherwise.
+    bool set_effect_swap_time(
+        const float swap_time);
+
     // Gets the active send's properties.
     //
     // Returns true on success or false otherwise.
@@ -874,6 +1235,53 @@ public:
         const float* src_samples,
         float* dst_samples);
 
+    // Mixes samples from the source buffer into separate outputs for the dry
+    // path and for each effect slot.
+    //
+    // The outputs are planar: "dry_channels" and every "effect_channels[i]"
+    // point to one buffer of "sample_count" samples per channel. The effect
+    // slot "i" goes to "effect_channels[i]". Null outputs are not written,
+    // but the effect slots are processed all the same. The interleaved sum
+    // of all of them goes to "dst_samples" as with "mix", unless it is null.
+    //
+    // Not available when the effects run at a lower sampling rate.
+    // !!!WARNING!!! Mixed samples are NOT CLIPPED.
+    //
+    // Returns true on success or false otherwise.
+    bool mix_stems(
+        const int sample_count,
+        const float* src_samples,
+        float* const* dry_channels,
+        float* const* const* effect_channels,
+        float* dst_samples);
+
+    // Saves the runtime state of the instance into the buffer: the filter
+    // histories, the delay lines, the oscillator phases and the envelopes of
+    // the source and of the effects. Silent spans of the delay lines take a
+    // few bytes.
+    //
+    // The properties are not saved. The pending changes are applied first.
+    // An effect swap in progress is not saved; only the new effect is.
+    // The state is in the native byte order.
+    //
+    // Returns true on success or false otherwise.
+    bool save_state(
+        std::vector<unsigned char>& state);
+
+    // Loads the runtime state saved by "save_state", so the instance carries
+    // on where the saved one was.
+    //
+    // The instance should be initialized with the same channel format and
+    // sampling rates, and have the same effects and properties applied
+    // (including the impulse response of a convolution). A mismatch of the
+    // configuration or of the effect types is detected before anything is
+    // loaded, and a corrupted state leaves the runtime state as it was.
+    //
+    // Returns true on success or false otherwise.
+    bool load_state(
+        const void* state,
+        const int state_size);
+
     // Uninitializes the instance.
     void uninitialize();
 
@@ -899,8 +1307,31 @@ public:
     // Gets the maximum allowed effect count.
     static int get_max_effects();
 
+    // Gets the maximum allowed crossfade time of an effect swap, in seconds.
+    static float get_max_effect_swap_time();
+
+    // Gets the instruction set used by the DSP kernels.
+    //
+    // The kernels are selected once per process, on the first initialization
+    // of an instance or of a batch, or on the first call of this function. The
+    // selection is shared by all instances and never changes afterwards.
+    static SimdLevel get_simd_level();
+
+    // Sets the widest instruction set allowed for the DSP kernels.
+    //
+    // Takes effect only before the kernels are selected. Use "scalar" to force
+    // the reference implementation. The environment variable OALSFXPP_SIMD
+    // ("scalar", "sse2", "avx2" or "avx512") takes precedence over this value.
+    //
+    // Returns true if the value takes effect, or false if the kernels are
+    // selected already.
+    static bool set_max_simd_level(
+        const SimdLevel simd_level);
+
     // Converts the channel count into the channel format.
     //
+    // Four channels map to "quad"; "b_format" has to be requested explicitly.
+    //
     // Returns a channel format or "none" on error.
     static ChannelFormat channel_count_to_channel_format(
         const int channel_count);
@@ -921,6 +1352,197 @@ private:
     mutable const char* error_message_;
 }; // Api
 
+// Runs many instances of one effect on mono voices.
+//
+// The instances are processed sixteen, eight or four at a time (with
+// AVX-512, AVX2 or else), with their states side by side in the lanes of the
+// vectors, so one loop advances that many independent recurrences. Each
+// instance has properties of its own.
+//
+// A reverb batches just its late lines, and only with the wider vectors and
+// the qualities whose late lines run at the full rate. The rest of each
+// instance runs on its own.
+//
+// Supported effects: chorus, compressor, EAX reverb, echo, flanger and
+// reverb.
+//
+// An instance takes a mono input, as a source at the front would send into an
+// effect slot, and outputs a stereo pair with the effect's own panning.
+class EffectBatch
+{
+public:
+    EffectBatch();
+
+    EffectBatch(
+        const EffectBatch& that) = delete;
+
+    EffectBatch& operator=(
+        const EffectBatch& that) = delete;
+
+    ~EffectBatch();
+
+
+    // Initializes the instances with the default properties of the effect.
+    //
+    // Returns true on success or false otherwise.
+    bool initialize(
+        const EffectType effect_type,
+        const int sampling_rate,
+        const int instance_count);
+
+    // Gets instance's initialization flag.
+    //
+    // Returns true if the instance is initialized or false otherwise.
+    bool is_initialized() const;
+
+    // Gets the effect type.
+    //
+    // Returns an effect type or "null" on error.
+    EffectType get_effect_type() const;
+
+    // Gets an instance count.
+    //
+    // Returns an instance count or zero on error.
+    int get_instance_count() const;
+
+    // Sets the instance's properties. They take effect on the next call of
+    // "process".
+    //
+    // Returns true on success or false otherwise.
+    bool set_effect_props(
+        const int instance_index,
+        const EffectProps& effect_props);
+
+    // Processes the instances.
+    //
+    // "src_samples[i]" is the mono input of the instance "i", and
+    // "dst_samples[2 * i]" and "dst_samples[(2 * i) + 1]" are its left and
+    // right outputs. The outputs are overwritten.
+    // !!!WARNING!!! Output samples are NOT CLIPPED.
+    //
+    // Returns true on success or false otherwise.
+    bool process(
+        const int sample_count,
+        const float* const* src_samples,
+        float* const* dst_samples);
+
+    // Uninitializes the instance.
+    void uninitialize();
+
+    // Gets a last error message.
+    const char* get_error_message() const;
+
+
+    // Checks whether the effect can be run in a batch.
+    static bool is_effect_type_supported(
+        const EffectType effect_type);
+
+
+private:
+    class Impl;
+    using EffectBatchImplUPtr = std::unique_ptr<Impl>;
+
+
+    EffectBatchImplUPtr pimpl_;
+    mutable const char* error_message_;
+}; // EffectBatch
+
+// A named effect with the properties of its send, as stored in a preset bank.
+struct Preset
+{
+    const char* name_;
+    Effect effect_;
+    SendProps send_props_;
+}; // Preset
+
+// A bank of presets in a binary file.
+//
+// The file is memory-mapped and used in place: a load checks the header only,
+// and a lookup by name goes through the hash index stored in the file. The
+// mapping is read-only, so the processes which load one bank share its pages.
+//
+// The records keep the native byte order and layout of "Effect" and
+// "SendProps", so a bank is built for the platform it is loaded on; a bank of
+// another layout or version fails to load. The impulse response of a
+// convolution is not stored, and comes out null.
+class PresetBank
+{
+public:
+    PresetBank();
+
+    PresetBank(
+        const PresetBank& that) = delete;
+
+    PresetBank& operator=(
+        const PresetBank& that) = delete;
+
+    ~PresetBank();
+
+
+    // Loads a bank file.
+    //
+    // Returns true on success or false otherwise.
+    bool load(
+        const char* file_name);
+
+    // Unloads the bank.
+    void unload();
+
+    // Gets a loaded flag.
+    //
+    // Returns true if the bank is loaded or false otherwise.
+    bool is_loaded() const;
+
+    // Gets a preset count.
+    //
+    // Returns a preset count or zero on error.
+    int get_preset_count() const;
+
+    // Finds a preset by name.
+    //
+    // Returns the preset's index, or -1 if there is no such preset or on
+    // error.
+    int find(
+        const char* name) const;
+
+    // Gets a preset's name.
+    //
+    // Returns the name or null on error.
+    const char* get_name(
+        const int preset_index) const;
+
+    // Gets a preset's effect and the properties of its send, normalized.
+    //
+    // Returns true on success or false otherwise.
+    bool get_preset(
+        const int preset_index,
+        Effect& effect,
+        SendProps& send_props) const;
+
+    // Builds the contents of a bank file from the presets. The names should
+    // be unique and not empty.
+    //
+    // Does not affect the loaded bank.
+    //
+    // Returns true on success or false otherwise.
+    bool build(
+        const Preset* presets,
+        const int preset_count,
+        std::vector<unsigned char>& bank);
+
+    // Gets a last error message.
+    const char* get_error_message() const;
+
+
+private:
+    class Impl;
+    using ImplUPtr = std::unique_ptr<Impl>;
+
+
+    ImplUPtr pimpl_;
+    mutable const char* error_message_;
+}; // PresetBank
+
 
 } // oalsfxpp
 
@@ -0,0 +1,230 @@
+/*
+A standalone OpenAL Soft effects for C++.
+
+Copyright (C) 2017 Boris I. Bendovsky (bibendovsky@hotmail.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+For a copy of the GNU General Public License see file COPYING.
+*/
+
+
+
+// Benchmarks of the library.
+//
+// Each benchmark mixes two seconds of stereo noise on a 48 kHz device in
+// chunks of 1024 frames, and prints the best time of 21 runs. Every run mixes
+// the noise once untimed first, so the delay lines are paged in and filled.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "oalsfxpp.h"
+
+
+namespace
+{
+
+
+using Samples = std::vector<float>;
+
+
+constexpr auto sampling_rate = 48'000;
+constexpr auto frame_count = 2 * sampling_rate;
+constexpr auto chunk_size = 1'024;
+constexpr auto run_count = 21;
+
+
+Samples make_stereo_noise()
+{
+    auto samples = Samples(2 * frame_count);
+    auto seed = 1U;
+
+    for (auto& sample : samples)
+    {
+        seed = (seed * 1'103'515'245U) + 12'345U;
+        sample = 0.3F * ((static_cast<float>((seed >> 9) & 0xFFFF) / 32'768.0F) - 1.0F);
+    }
+
+    return samples;
+}
+
+// Mixes the noise through the effect in chunks.
+bool mix_chunks(
+    oalsfxpp::Api& api,
+    const Samples& src_samples,
+    Samples& dst_samples)
+{
+    for (int i = 0; i < frame_count; i += chunk_size)
+    {
+        const auto count = std::min(chunk_size, frame_count - i);
+
+        if (!api.mix(count, &src_samples[2 * i], &dst_samples[2 * i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Mixes the noise through each effect.
+//
+// The runs go over all the effects in turn, so a slower spell of the machine
+// weighs on all of them alike.
+//
+// Returns the best times in milliseconds, and the sizes of the states after the
+// mixes, or no times on failure.
+std::vector<double> benchmark_effects(
+    const std::vector<oalsfxpp::Effect>& effects,
+    const Samples& src_samples,
+    std::vector<std::size_t>& state_sizes)
+{
+    const auto effect_count = effects.size();
+
+    auto best_times = std::vector<double>(effect_count, -1.0);
+    auto dst_samples = Samples(src_samples.size());
+
+    state_sizes.assign(effect_count, 0);
+
+    for (int run = 0; run < run_count; ++run)
+    {
+        for (std::size_t i = 0; i < effect_count; ++i)
+        {
+            oalsfxpp::Api api;
+
+            if (!api.initialize(oalsfxpp::ChannelFormat::stereo, sampling_rate, 1))
+            {
+                return {};
+            }
+
+            api.set_effect(0, effects[i]);
+
+            if (!api.apply_changes() ||
+                !mix_chunks(api, src_samples, dst_samples))
+            {
+                return {};
+            }
+
+            const auto begin_time = std::chrono::steady_clock::now();
+
+            if (!mix_chunks(api, src_samples, dst_samples))
+            {
+                return {};
+            }
+
+            const auto end_time = std::chrono::steady_clock::now();
+            const auto time = std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+
+            if (best_times[i] < 0.0 || time < best_times[i])
+            {
+                best_times[i] = time;
+            }
+
+            auto state = std::vector<unsigned char>{};
+
+            if (!api.save_state(state))
+            {
+                return {};
+            }
+
+            state_sizes[i] = state.size();
+        }
+    }
+
+    return best_times;
+}
+
+// The cost of the reverb qualities relative to the full one, with the size of
+// the state as a measure of the delay lines.
+bool benchmark_reverb_qualities(
+    const Samples& src_samples)
+{
+    struct Quality
+    {
+        const char* name_;
+        int quality_;
+    }; // Quality
+
+    const Quality qualities[] =
+    {
+        {"full", oalsfxpp::EffectProps::Reverb::quality_full},
+        {"no modulation", oalsfxpp::EffectProps::Reverb::quality_no_modulation},
+        {"half rate late", oalsfxpp::EffectProps::Reverb::quality_half_rate_late},
+        {"late only", oalsfxpp::EffectProps::Reverb::quality_late_only},
+        {"early only", oalsfxpp::EffectProps::Reverb::quality_early_only},
+    };
+
+    // The standard reverb, then the EAX one with modulation, of each quality.
+    auto effects = std::vector<oalsfxpp::Effect>{};
+
+    for (const auto& quality : qualities)
+    {
+        for (const auto is_eax : {false, true})
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(is_eax ? oalsfxpp::EffectType::eax_reverb : oalsfxpp::EffectType::reverb);
+            effect.props_.reverb_.modulation_depth_ = (is_eax ? 0.5F : 0.0F);
+            effect.props_.reverb_.quality_ = quality.quality_;
+
+            effects.push_back(effect);
+        }
+    }
+
+    auto state_sizes = std::vector<std::size_t>{};
+
+    const auto times = benchmark_effects(effects, src_samples, state_sizes);
+
+    if (times.empty())
+    {
+        return false;
+    }
+
+    std::printf("reverb quality   standard   EAX  state\n");
+
+    for (int i = 0; i < 5; ++i)
+    {
+        std::printf(
+            "  %-16s %4.0f%% %5.0f%%  %4d KiB  (%.2f / %.2f ms)\n",
+            qualities[i].name_,
+            100.0 * times[(2 * i) + 0] / times[0],
+            100.0 * times[(2 * i) + 1] / times[1],
+            static_cast<int>(state_sizes[2 * i] / 1'024),
+            times[(2 * i) + 0],
+            times[(2 * i) + 1]);
+    }
+
+    return true;
+}
+
+
+} // namespace
+
+
+int main()
+{
+    const auto src_samples = make_stereo_noise();
+
+    if (!benchmark_reverb_qualities(src_samples))
+    {
+        std::printf("FAILED reverb_qualities\n");
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,1506 @@
+/*
+A standalone OpenAL Soft effects for C++.
+
+Copyright (C) 2017 Boris I. Bendovsky (bibendovsky@hotmail.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+For a copy of the GNU General Public License see file COPYING.
+*/
+
+
+
+// Regression tests of the library.
+//
+// Each test prints its name and the outcome. The exit code is nonzero if any
+// test fails.
+//
+// The library is compiled into the tests, so the internal classes can be
+// tested along with the API.
+
+
+#include "oalsfxpp.cpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+
+namespace
+{
+
+
+using Samples = std::vector<float>;
+
+
+bool initialize_dynamics(
+    oalsfxpp::Api& api,
+    const float attack_time,
+    const float release_time)
+{
+    if (!api.initialize(oalsfxpp::ChannelFormat::mono, 48'000, 1))
+    {
+        return false;
+    }
+
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(oalsfxpp::EffectType::dynamics);
+    effect.props_.dynamics_.threshold_ = -20.0F;
+    effect.props_.dynamics_.ratio_ = oalsfxpp::EffectProps::Dynamics::max_ratio;
+    effect.props_.dynamics_.attack_time_ = attack_time;
+    effect.props_.dynamics_.release_time_ = release_time;
+
+    // The wet path only.
+    auto direct_props = oalsfxpp::SendProps{};
+    direct_props.set_defaults();
+    direct_props.gain_ = 0.0F;
+
+    api.set_effect(0, effect);
+    api.set_send_props(-1, direct_props);
+
+    return api.apply_changes();
+}
+
+// Mixes the samples through the limiter in chunks of the size.
+Samples mix_dynamics(
+    const Samples& src_samples,
+    const int chunk_size,
+    const float attack_time,
+    const float release_time)
+{
+    oalsfxpp::Api api;
+
+    if (!initialize_dynamics(api, attack_time, release_time))
+    {
+        return {};
+    }
+
+    const auto sample_count = static_cast<int>(src_samples.size());
+
+    auto dst_samples = Samples(src_samples.size());
+
+    for (int i = 0; i < sample_count; i += chunk_size)
+    {
+        const auto count = std::min(chunk_size, sample_count - i);
+
+        api.mix(count, &src_samples[i], &dst_samples[i]);
+    }
+
+    return dst_samples;
+}
+
+float get_peak(
+    const Samples& samples)
+{
+    auto peak = 0.0F;
+
+    for (const auto sample : samples)
+    {
+        peak = std::max(std::abs(sample), peak);
+    }
+
+    return peak;
+}
+
+// A burst has the same peak wherever it falls within a mix.
+bool test_dynamics_burst()
+{
+    auto min_peak = 1.0F;
+    auto max_peak = 0.0F;
+
+    for (int offset = 0; offset < 64; ++offset)
+    {
+        auto src_samples = Samples(4'096);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            src_samples[2'048 + offset + i] = ((i & 1) == 0) ? 1.0F : -1.0F;
+        }
+
+        const auto peak = get_peak(mix_dynamics(src_samples, 64, 0.0F, 0.001F));
+
+        min_peak = std::min(peak, min_peak);
+        max_peak = std::max(peak, max_peak);
+    }
+
+    return max_peak > 0.0F && max_peak < 0.1F && (max_peak - min_peak) < 0.001F;
+}
+
+// The output does not depend on the sizes of the mixes.
+bool test_dynamics_chunk_size()
+{
+    auto src_samples = Samples(20'000);
+    auto seed = 1U;
+
+    for (auto& sample : src_samples)
+    {
+        seed = (seed * 1'103'515'245U) + 12'345U;
+        sample = 0.3F * ((static_cast<float>((seed >> 9) & 0xFFFF) / 32'768.0F) - 1.0F);
+    }
+
+    const auto reference = mix_dynamics(src_samples, 64, 0.005F, 0.1F);
+
+    if (reference.empty())
+    {
+        return false;
+    }
+
+    for (const auto chunk_size : {1, 37, 2'048})
+    {
+        const auto samples = mix_dynamics(src_samples, chunk_size, 0.005F, 0.1F);
+
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            if (!(std::abs(samples[i] - reference[i]) < 0.000'01F))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// Sets up a resonant filter with the pole radius and angle, and feeds it
+// enough noise to have a history.
+oalsfxpp::FilterState make_resonant_filter(
+    const float pole_radius,
+    const float pole_angle)
+{
+    auto filter = oalsfxpp::FilterState{};
+    filter.reset();
+
+    filter.b0_ = 0.2F;
+    filter.b1_ = -0.3F;
+    filter.b2_ = 0.1F;
+    filter.a1_ = -2.0F * pole_radius * std::cos(pole_angle);
+    filter.a2_ = pole_radius * pole_radius;
+
+    float src_samples[2] = {0.7F, -0.4F};
+    float dst_samples[2];
+
+    filter.process_serial(2, src_samples, dst_samples);
+
+    return filter;
+}
+
+// Runs the block evaluation and the serial one side by side, block after
+// block, and returns the largest difference relative to the peak.
+float get_filter_block_error(
+    const oalsfxpp::Kernels::FilterBlockFunc block_func,
+    const float pole_radius,
+    const float pole_angle,
+    const int block_size)
+{
+    auto block_filter = make_resonant_filter(pole_radius, pole_angle);
+    auto serial_filter = block_filter;
+
+    auto src_samples = Samples(block_size);
+    auto block_samples = Samples(block_size);
+    auto serial_samples = Samples(block_size);
+    auto seed = static_cast<unsigned>(block_size);
+
+    auto peak = 0.0F;
+    auto max_error = 0.0F;
+
+    for (int block = 0; block < 4; ++block)
+    {
+        for (auto& sample : src_samples)
+        {
+            seed = (seed * 1'103'515'245U) + 12'345U;
+            sample = (static_cast<float>((seed >> 9) & 0xFFFF) / 32'768.0F) - 1.0F;
+        }
+
+        block_func(block_filter, block_size, src_samples.data(), block_samples.data());
+        serial_filter.process_serial(block_size, src_samples.data(), serial_samples.data());
+
+        for (int i = 0; i < block_size; ++i)
+        {
+            peak = std::max(std::abs(serial_samples[i]), peak);
+            max_error = std::max(std::abs(block_samples[i] - serial_samples[i]), max_error);
+        }
+    }
+
+    return (peak > 0.0F) ? max_error / peak : 1.0F;
+}
+
+// The sub-block evaluation of the filters follows the serial one, for whole
+// and odd block lengths, up to the largest pole radius it is used for.
+bool test_filter_block()
+{
+    auto block_funcs = std::vector<oalsfxpp::Kernels::FilterBlockFunc>{};
+
+    block_funcs.push_back(
+        [](oalsfxpp::FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+        {
+            filter.process_block_sse2(sample_count, src_samples, dst_samples);
+        });
+
+#ifdef OALSFXPP_AVX
+    if (oalsfxpp::Kernels::get_cpu_simd_level() >= oalsfxpp::SimdLevel::avx2)
+    {
+        block_funcs.push_back(
+            [](oalsfxpp::FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+            {
+                filter.process_block_avx2(sample_count, src_samples, dst_samples);
+            });
+    }
+
+    if (oalsfxpp::Kernels::get_cpu_simd_level() >= oalsfxpp::SimdLevel::avx512)
+    {
+        block_funcs.push_back(
+            [](oalsfxpp::FilterState& filter, const int sample_count, const float* src_samples, float* dst_samples)
+            {
+                filter.process_block_avx512(sample_count, src_samples, dst_samples);
+            });
+    }
+#endif // OALSFXPP_AVX
+
+    const auto max_radius = oalsfxpp::FilterState::max_block_pole_radius;
+
+    for (const auto block_func : block_funcs)
+    {
+        for (const auto pole_radius : {0.2F, 0.7F, max_radius - 0.01F, max_radius})
+        {
+            for (const auto pole_angle : {0.0F, 0.05F, 1.3F, 3.1F})
+            {
+                for (const auto block_size : {128, 131, 517, 1'000, 1'021, 1'024})
+                {
+                    if (!(get_filter_block_error(block_func, pole_radius, pole_angle, block_size) < 0.000'05F))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Past the largest pole radius for the sub-blocks, the filter is evaluated
+// serially, with the same result.
+bool test_filter_unstable_block()
+{
+    auto filter = make_resonant_filter(0.999F, 0.01F);
+    auto serial_filter = filter;
+
+    auto src_samples = Samples(1'021);
+    auto dst_samples = Samples(src_samples.size());
+    auto serial_samples = Samples(src_samples.size());
+
+    src_samples[0] = 1.0F;
+
+    oalsfxpp::Kernels::select();
+
+    filter.process(static_cast<int>(src_samples.size()), src_samples.data(), dst_samples.data());
+    serial_filter.process_serial(static_cast<int>(src_samples.size()), src_samples.data(), serial_samples.data());
+
+    return dst_samples == serial_samples;
+}
+
+// Every variant of the interleaving writes the same output as the scalar one.
+bool test_write_interleaved()
+{
+    auto write_funcs = std::vector<oalsfxpp::Kernels::WriteInterleavedFunc>{};
+
+    write_funcs.push_back(oalsfxpp::MixHelpers::write_interleaved_sse2);
+
+#ifdef OALSFXPP_AVX
+    if (oalsfxpp::Kernels::get_cpu_simd_level() >= oalsfxpp::SimdLevel::avx2)
+    {
+        write_funcs.push_back(oalsfxpp::MixHelpers::write_interleaved_avx2);
+    }
+
+    if (oalsfxpp::Kernels::get_cpu_simd_level() >= oalsfxpp::SimdLevel::avx512)
+    {
+        write_funcs.push_back(oalsfxpp::MixHelpers::write_interleaved_avx512);
+    }
+#endif // OALSFXPP_AVX
+
+    auto src_buffers = oalsfxpp::SampleBuffers(oalsfxpp::max_channels);
+
+    for (int c = 0; c < oalsfxpp::max_channels; ++c)
+    {
+        for (int i = 0; i < oalsfxpp::max_sample_buffer_size; ++i)
+        {
+            src_buffers[c][i] = static_cast<float>((c * oalsfxpp::max_sample_buffer_size) + i);
+        }
+    }
+
+    constexpr auto offset = 3;
+    constexpr auto sample_count = 1'021;
+
+    for (const auto write_func : write_funcs)
+    {
+        for (const auto channel_count : {1, 2, 4, 6, 8})
+        {
+            auto reference = Samples(channel_count * (offset + sample_count));
+            auto samples = reference;
+
+            oalsfxpp::MixHelpers::write_interleaved_c(src_buffers, reference.data(), offset, sample_count, channel_count);
+            write_func(src_buffers, samples.data(), offset, sample_count, channel_count);
+
+            if (samples != reference)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// The widest instruction set cannot be changed once the kernels are selected,
+// and the call says so.
+bool test_simd_level_after_selection()
+{
+    const auto simd_level = oalsfxpp::Api::get_simd_level();
+
+    return
+        !oalsfxpp::Api::set_max_simd_level(oalsfxpp::SimdLevel::scalar) &&
+        oalsfxpp::Api::get_simd_level() == simd_level;
+}
+
+// Generates the waveform one value at a time.
+Samples generate_serial(
+    const oalsfxpp::Oscillator::Waveform waveform,
+    oalsfxpp::Oscillator::Phase phase,
+    const oalsfxpp::Oscillator::Phase step,
+    const int count)
+{
+    using Oscillator = oalsfxpp::Oscillator;
+
+    const auto sine_table = Oscillator::get_sine_table();
+
+    auto values = Samples(count);
+
+    for (auto& value : values)
+    {
+        switch (waveform)
+        {
+        case Oscillator::Waveform::sinusoid:
+            value = Oscillator::get_value<Oscillator::Waveform::sinusoid>(sine_table, phase);
+            break;
+
+        case Oscillator::Waveform::triangle:
+            value = Oscillator::get_value<Oscillator::Waveform::triangle>(sine_table, phase);
+            break;
+
+        case Oscillator::Waveform::sawtooth:
+            value = Oscillator::get_value<Oscillator::Waveform::sawtooth>(sine_table, phase);
+            break;
+
+        case Oscillator::Waveform::square:
+            value = Oscillator::get_value<Oscillator::Waveform::square>(sine_table, phase);
+            break;
+        }
+
+        phase += step;
+    }
+
+    return values;
+}
+
+// The oscillator generates blocks, including the odd ones and those wrapping
+// the phase, with the same values and end phase as one value at a time.
+bool test_oscillator_block()
+{
+    using Oscillator = oalsfxpp::Oscillator;
+
+    oalsfxpp::Kernels::select();
+
+    const Oscillator::Waveform waveforms[] =
+    {
+        Oscillator::Waveform::sinusoid,
+        Oscillator::Waveform::triangle,
+        Oscillator::Waveform::sawtooth,
+        Oscillator::Waveform::square,
+    };
+
+    for (const auto waveform : waveforms)
+    {
+        for (const auto fraction : {0.0001, 0.013, 0.37, 0.99})
+        {
+            for (const auto count : {1, 3, 4, 7, 256, 257, 1'021})
+            {
+                const auto phase = Oscillator::to_phase(0.9);
+                const auto step = Oscillator::to_phase(fraction);
+
+                auto values = Samples(count);
+
+                const auto end_phase = Oscillator::generate(waveform, values.data(), phase, step, count);
+
+                if (values != generate_serial(waveform, phase, step, count) ||
+                    end_phase != static_cast<Oscillator::Phase>(phase + (step * static_cast<Oscillator::Phase>(count))))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// Writes a raw response of 32-bit float samples.
+bool write_raw_response(
+    const char* file_name,
+    const Samples& samples)
+{
+    auto stream = std::ofstream{file_name, std::ios_base::binary};
+
+    stream.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(float));
+
+    return stream.good();
+}
+
+// Mixes an impulse through the convolution with the response.
+Samples mix_convolution(
+    const oalsfxpp::ImpulseResponse& impulse_response,
+    const oalsfxpp::ChannelFormat channel_format,
+    const int sampling_rate,
+    const int sample_count)
+{
+    oalsfxpp::Api api;
+
+    if (!api.initialize(channel_format, sampling_rate, 1))
+    {
+        return {};
+    }
+
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(oalsfxpp::EffectType::convolution);
+    effect.props_.convolution_.impulse_response_ = &impulse_response;
+
+    auto direct_props = oalsfxpp::SendProps{};
+    direct_props.set_defaults();
+    direct_props.gain_ = 0.0F;
+
+    api.set_effect(0, effect);
+    api.set_send_props(-1, direct_props);
+    api.apply_changes();
+
+    const auto channel_count = api.get_channel_count();
+
+    auto src_samples = Samples(sample_count * channel_count);
+    auto dst_samples = Samples(sample_count * channel_count);
+
+    std::fill_n(src_samples.begin(), channel_count, 1.0F);
+
+    api.mix(sample_count, src_samples.data(), dst_samples.data());
+
+    return dst_samples;
+}
+
+// The X channel of a B-Format response comes out on the X channel of the
+// output (ACN 3), and nowhere else.
+bool test_convolution_b_format()
+{
+    constexpr auto file_name = "oalsfxpp_regression_b_format.raw";
+
+    // W, X, Y, Z.
+    auto response = Samples(4 * 256);
+    response[(4 * 10) + 1] = 0.5F;
+
+    oalsfxpp::ImpulseResponse impulse_response;
+
+    if (!write_raw_response(file_name, response) || !impulse_response.load_raw(file_name, 4, 48'000))
+    {
+        return false;
+    }
+
+    const auto samples = mix_convolution(impulse_response, oalsfxpp::ChannelFormat::b_format, 48'000, 4'096);
+
+    impulse_response.unload();
+    std::remove(file_name);
+
+    float peaks[4] = {};
+
+    for (std::size_t i = 0; i < samples.size(); ++i)
+    {
+        peaks[i % 4] = std::max(std::abs(samples[i]), peaks[i % 4]);
+    }
+
+    return peaks[3] > 0.01F && peaks[0] == 0.0F && peaks[1] == 0.0F && peaks[2] == 0.0F;
+}
+
+// A response resampled to a lower rate loses the content above the new
+// Nyquist frequency instead of folding it down.
+bool test_convolution_downsampling()
+{
+    constexpr auto file_name = "oalsfxpp_regression_tone.raw";
+
+    // 40 kHz at 96 kHz.
+    auto response = Samples(2'048);
+
+    for (std::size_t i = 0; i < response.size(); ++i)
+    {
+        response[i] = 0.1F * static_cast<float>(std::sin(2.0 * 3.14159265358979323846 * (40.0 / 96.0) * i));
+    }
+
+    oalsfxpp::ImpulseResponse impulse_response;
+
+    if (!write_raw_response(file_name, response) || !impulse_response.load_raw(file_name, 1, 96'000))
+    {
+        return false;
+    }
+
+    const auto samples = mix_convolution(impulse_response, oalsfxpp::ChannelFormat::mono, 48'000, 4'096);
+
+    impulse_response.unload();
+    std::remove(file_name);
+
+    return !samples.empty() && get_peak(samples) < 0.02F;
+}
+
+
+// Makes stereo noise.
+Samples make_stereo_noise(
+    const int frame_count)
+{
+    auto samples = Samples(2 * frame_count);
+    auto seed = 1U;
+
+    for (auto& sample : samples)
+    {
+        seed = (seed * 1'103'515'245U) + 12'345U;
+        sample = 0.3F * ((static_cast<float>((seed >> 9) & 0xFFFF) / 32'768.0F) - 1.0F);
+    }
+
+    return samples;
+}
+
+// Mixes the stereo samples through the effect in chunks of the size.
+Samples mix_stereo(
+    const oalsfxpp::Effect& effect,
+    const Samples& src_samples,
+    const int chunk_size)
+{
+    oalsfxpp::Api api;
+
+    if (!api.initialize(oalsfxpp::ChannelFormat::stereo, 48'000, 1))
+    {
+        return {};
+    }
+
+    api.set_effect(0, effect);
+
+    if (!api.apply_changes())
+    {
+        return {};
+    }
+
+    const auto frame_count = static_cast<int>(src_samples.size()) / 2;
+
+    auto dst_samples = Samples(src_samples.size());
+
+    for (int i = 0; i < frame_count; i += chunk_size)
+    {
+        const auto count = std::min(chunk_size, frame_count - i);
+
+        api.mix(count, &src_samples[2 * i], &dst_samples[2 * i]);
+    }
+
+    return dst_samples;
+}
+
+// Checks that the output of the effect does not depend on the sizes of the
+// mixes.
+bool test_chunk_size(
+    const oalsfxpp::Effect& effect)
+{
+    const auto src_samples = make_stereo_noise(20'000);
+    const auto reference = mix_stereo(effect, src_samples, 1);
+
+    if (reference.empty() || get_peak(reference) == 0.0F)
+    {
+        return false;
+    }
+
+    for (const auto chunk_size : {37, 2'048})
+    {
+        const auto samples = mix_stereo(effect, src_samples, chunk_size);
+
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            if (!(std::abs(samples[i] - reference[i]) < 0.000'01F))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// The echo output does not depend on the sizes of the mixes, whether the
+// feedback delay is fed back sample by sample, in short spans, or in whole
+// tiles.
+bool test_echo_chunk_size()
+{
+    const float delays[][2] =
+    {
+        {0.0F, 0.0F},
+        {0.0F, 0.000'2F},
+        {0.000'2F, 0.001F},
+        {0.1F, 0.1F},
+    };
+
+    for (const auto& delay : delays)
+    {
+        auto effect = oalsfxpp::Effect{};
+        effect.set_type_and_defaults(oalsfxpp::EffectType::echo);
+        effect.props_.echo_.delay_ = delay[0];
+        effect.props_.echo_.lr_delay_ = delay[1];
+
+        if (!test_chunk_size(effect))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// The multi-tap echo output does not depend on the sizes of the mixes, whether
+// the longest tap is fed back sample by sample, in short spans, or in whole
+// tiles.
+bool test_multi_tap_echo_chunk_size()
+{
+    for (const auto longest_delay : {0.0F, 0.000'1F, 0.000'5F, 0.1F})
+    {
+        auto effect = oalsfxpp::Effect{};
+        effect.set_type_and_defaults(oalsfxpp::EffectType::multi_tap_echo);
+
+        auto& props = effect.props_.multi_tap_echo_;
+        props.tap_count_ = 3;
+        props.taps_[0].delay_ = 0.0F;
+        props.taps_[0].pan_ = -1.0F;
+        props.taps_[1].delay_ = 0.5F * longest_delay;
+        props.taps_[1].pan_ = 1.0F;
+        props.taps_[2].delay_ = longest_delay;
+
+        if (!test_chunk_size(effect))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Every reverb preset is found by its names, and renders a finite and audible
+// output.
+bool test_reverb_presets()
+{
+    const auto preset_count = oalsfxpp::ReverbPresets::get_count();
+
+    if (preset_count <= 0 ||
+        oalsfxpp::ReverbPresets::get(-1) ||
+        oalsfxpp::ReverbPresets::get(preset_count) ||
+        oalsfxpp::ReverbPresets::find("default", "no_such_preset"))
+    {
+        return false;
+    }
+
+    const auto src_samples = make_stereo_noise(24'000);
+
+    for (int i = 0; i < preset_count; ++i)
+    {
+        const auto preset = oalsfxpp::ReverbPresets::get(i);
+
+        if (!preset || !preset->props_ ||
+            oalsfxpp::ReverbPresets::find(preset->category_, preset->name_) != preset)
+        {
+            return false;
+        }
+
+        auto effect = oalsfxpp::Effect{};
+        effect.set_type_and_defaults(oalsfxpp::EffectType::eax_reverb);
+        effect.props_.reverb_ = *preset->props_;
+
+        const auto samples = mix_stereo(effect, src_samples, 2'048);
+
+        if (samples.empty() ||
+            !std::all_of(samples.cbegin(), samples.cend(), [](const float sample) { return std::isfinite(sample); }) ||
+            get_peak(samples) == 0.0F)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// An effect slot goes on while none of its outputs are written, so a plain mix
+// after that matches a plain mix all along.
+bool test_stems_unwritten()
+{
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(oalsfxpp::EffectType::echo);
+
+    oalsfxpp::Api reference_api;
+    oalsfxpp::Api api;
+
+    for (auto instance : {&reference_api, &api})
+    {
+        if (!instance->initialize(oalsfxpp::ChannelFormat::stereo, 48'000, 1))
+        {
+            return false;
+        }
+
+        instance->set_effect(0, effect);
+
+        if (!instance->apply_changes())
+        {
+            return false;
+        }
+    }
+
+    const auto src_samples = make_stereo_noise(2 * 4'096);
+
+    auto reference_samples = Samples(src_samples.size());
+    auto samples = Samples(src_samples.size());
+
+    if (!reference_api.mix(4'096, src_samples.data(), reference_samples.data()) ||
+        !api.mix_stems(4'096, src_samples.data(), nullptr, nullptr, nullptr) ||
+        !reference_api.mix(4'096, &src_samples[2 * 4'096], &reference_samples[2 * 4'096]) ||
+        !api.mix(4'096, &src_samples[2 * 4'096], &samples[2 * 4'096]))
+    {
+        return false;
+    }
+
+    return std::equal(reference_samples.cbegin() + (2 * 4'096), reference_samples.cend(), samples.cbegin() + (2 * 4'096));
+}
+
+
+// Mixes an impulse through the chorus with a fixed delay in samples.
+Samples mix_chorus_impulse(
+    const float delay)
+{
+    oalsfxpp::Api api;
+
+    if (!api.initialize(oalsfxpp::ChannelFormat::stereo, 48'000, 1))
+    {
+        return {};
+    }
+
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(oalsfxpp::EffectType::chorus);
+    effect.props_.chorus_.depth_ = 0.0F;
+    effect.props_.chorus_.feedback_ = 0.5F;
+    effect.props_.chorus_.delay_ = delay / 48'000.0F;
+
+    // The wet path only.
+    auto direct_props = oalsfxpp::SendProps{};
+    direct_props.set_defaults();
+    direct_props.gain_ = 0.0F;
+
+    api.set_effect(0, effect);
+    api.set_send_props(-1, direct_props);
+
+    if (!api.apply_changes())
+    {
+        return {};
+    }
+
+    auto src_samples = Samples(2 * 256);
+    auto dst_samples = Samples(2 * 256);
+
+    src_samples[0] = 1.0F;
+    src_samples[1] = 1.0F;
+
+    if (!api.mix(256, src_samples.data(), dst_samples.data()))
+    {
+        return {};
+    }
+
+    return dst_samples;
+}
+
+// A delay between two whole samples interpolates their taps. Only the first
+// echo is compared, as the fed back ones are interpolated again.
+bool test_chorus_fractional_delay()
+{
+    const auto near_samples = mix_chorus_impulse(10.0F);
+    const auto middle_samples = mix_chorus_impulse(10.5F);
+    const auto far_samples = mix_chorus_impulse(11.0F);
+
+    if (near_samples.empty() || middle_samples.empty() || far_samples.empty() ||
+        get_peak(near_samples) == 0.0F)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < (2 * 20); ++i)
+    {
+        const auto expected = 0.5F * (near_samples[i] + far_samples[i]);
+
+        if (!(std::abs(middle_samples[i] - expected) < 0.000'1F))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Mixes an impulse through the ring modulator, and finds the frame of the
+// loudest output.
+int get_ring_modulator_peak_frame(
+    const int waveform,
+    const int impulse_frame)
+{
+    oalsfxpp::Api api;
+
+    if (!api.initialize(oalsfxpp::ChannelFormat::stereo, 48'000, 1))
+    {
+        return -1;
+    }
+
+    // A slow carrier stays nonzero around the impulse, three quarters into
+    // its period, for every waveform.
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(oalsfxpp::EffectType::ring_modulator);
+    effect.props_.ring_modulator_.frequency_ = 1.0F;
+    effect.props_.ring_modulator_.high_pass_cutoff_ = 0.0F;
+    effect.props_.ring_modulator_.waveform_ = waveform;
+
+    // The wet path only.
+    auto direct_props = oalsfxpp::SendProps{};
+    direct_props.set_defaults();
+    direct_props.gain_ = 0.0F;
+
+    api.set_effect(0, effect);
+    api.set_send_props(-1, direct_props);
+
+    const auto frame_count = impulse_frame + 256;
+
+    auto src_samples = Samples(2 * frame_count);
+    auto dst_samples = Samples(2 * frame_count);
+
+    src_samples[(2 * impulse_frame) + 0] = 1.0F;
+    src_samples[(2 * impulse_frame) + 1] = 1.0F;
+
+    if (!api.apply_changes() ||
+        !api.mix(frame_count, src_samples.data(), dst_samples.data()))
+    {
+        return -1;
+    }
+
+    auto peak_frame = -1;
+    auto peak = 0.0F;
+
+    for (int i = 0; i < frame_count; ++i)
+    {
+        const auto sample = std::abs(dst_samples[2 * i]);
+
+        if (sample > peak)
+        {
+            peak_frame = i;
+            peak = sample;
+        }
+    }
+
+    return peak_frame;
+}
+
+// Every carrier delays the signal alike, so switching between them does not
+// shift it.
+bool test_ring_modulator_latency()
+{
+    const auto impulse_frame = 36'000;
+
+    const auto sinusoid_frame = get_ring_modulator_peak_frame(
+        oalsfxpp::EffectProps::RingModulator::waveform_sinusoid, impulse_frame);
+
+    const auto sawtooth_frame = get_ring_modulator_peak_frame(
+        oalsfxpp::EffectProps::RingModulator::waveform_sawtooth, impulse_frame);
+
+    const auto square_frame = get_ring_modulator_peak_frame(
+        oalsfxpp::EffectProps::RingModulator::waveform_square, impulse_frame);
+
+    return sinusoid_frame >= impulse_frame &&
+        sawtooth_frame == sinusoid_frame &&
+        square_frame == sinusoid_frame;
+}
+
+
+// Sets up an effect running below the device rate, and mixes some noise into
+// it.
+bool initialize_resampled(
+    oalsfxpp::Api& api,
+    const oalsfxpp::EffectType effect_type,
+    const int sample_count)
+{
+    if (!api.initialize(oalsfxpp::ChannelFormat::stereo, 192'000, 1, 44'100))
+    {
+        return false;
+    }
+
+    auto effect = oalsfxpp::Effect{};
+    effect.set_type_and_defaults(effect_type);
+
+    api.set_effect(0, effect);
+
+    if (!api.apply_changes())
+    {
+        return false;
+    }
+
+    auto src_samples = Samples(2 * sample_count);
+    auto dst_samples = Samples(2 * sample_count);
+    auto seed = static_cast<unsigned>(sample_count);
+
+    for (auto& sample : src_samples)
+    {
+        seed = (seed * 1'103'515'245U) + 12'345U;
+        sample = 0.3F * ((static_cast<float>((seed >> 9) & 0xFFFF) / 32'768.0F) - 1.0F);
+    }
+
+    return api.mix(sample_count, src_samples.data(), dst_samples.data());
+}
+
+// Fails to load the state, and checks that the instance is left as it was and
+// mixes on.
+bool test_failed_load(
+    oalsfxpp::Api& api,
+    const std::vector<unsigned char>& state)
+{
+    auto previous_state = std::vector<unsigned char>{};
+    auto current_state = std::vector<unsigned char>{};
+
+    if (!api.save_state(previous_state) ||
+        api.load_state(state.data(), static_cast<int>(state.size())) ||
+        !api.save_state(current_state) ||
+        current_state != previous_state)
+    {
+        return false;
+    }
+
+    auto src_samples = Samples(2 * 4'096);
+    auto dst_samples = Samples(2 * 4'096);
+
+    return api.mix(4'096, src_samples.data(), dst_samples.data());
+}
+
+// A truncated state is not loaded.
+bool test_state_truncated()
+{
+    oalsfxpp::Api saved_api;
+    oalsfxpp::Api api;
+
+    auto state = std::vector<unsigned char>{};
+
+    if (!initialize_resampled(saved_api, oalsfxpp::EffectType::echo, 1'000) ||
+        !initialize_resampled(api, oalsfxpp::EffectType::echo, 100) ||
+        !saved_api.save_state(state))
+    {
+        return false;
+    }
+
+    state.resize(state.size() - 8);
+
+    return test_failed_load(api, state);
+}
+
+// A state with any single bit flipped is either loaded, so the instance mixes
+// on, or not loaded at all.
+bool test_state_corrupted()
+{
+    oalsfxpp::Api saved_api;
+    oalsfxpp::Api api;
+
+    auto state = std::vector<unsigned char>{};
+
+    if (!initialize_resampled(saved_api, oalsfxpp::EffectType::echo, 1'000) ||
+        !initialize_resampled(api, oalsfxpp::EffectType::echo, 100) ||
+        !saved_api.save_state(state))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < static_cast<int>(8 * state.size()); ++i)
+    {
+        auto corrupted_state = state;
+
+        corrupted_state[i / 8] ^= static_cast<unsigned char>(1U << (i % 8));
+
+        if (api.load_state(corrupted_state.data(), static_cast<int>(corrupted_state.size())))
+        {
+            auto src_samples = Samples(2 * 256);
+            auto dst_samples = Samples(2 * 256);
+
+            if (!api.mix(256, src_samples.data(), dst_samples.data()))
+            {
+                return false;
+            }
+        }
+        else if (!test_failed_load(api, corrupted_state))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+constexpr auto batch_instance_count = 19;
+constexpr auto batch_frame_count = 8'192;
+constexpr auto batch_chunk_size = 1'000;
+
+// The silence both the batch and the API mix first, so the gains of the API
+// reach their targets before the input starts.
+constexpr auto batch_silence_count = 1'024;
+
+
+// Mixes the mono samples through the effect slot of the API, for a source in
+// front, and gets its output on a stereo device.
+//
+// The source reaches the wet buffer as the first order coefficients of its
+// direction. The effects that use W alone take a stereo input on the left,
+// whose W is the same, and their stem is the output. The compressor takes a
+// B-format input, and its stem is decoded to stereo. The decode clamps the
+// gains of the channels, which is exact only while Y and Z are zero, as they
+// are for a source in front.
+Samples mix_api_reference(
+    const oalsfxpp::Effect& effect,
+    const Samples& src_samples)
+{
+    const auto is_b_format = (effect.type_ == oalsfxpp::EffectType::compressor);
+    const auto channel_count = (is_b_format ? oalsfxpp::max_effect_channels : 2);
+
+    auto src_gains = std::vector<float>{1.0F, 0.0F};
+    auto stem_gains = std::vector<oalsfxpp::Gains>(2);
+
+    stem_gains[0][0] = 1.0F;
+    stem_gains[1][1] = 1.0F;
+
+    if (is_b_format)
+    {
+        oalsfxpp::AmbiCoeffs coeffs;
+
+        oalsfxpp::Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
+
+        oalsfxpp::Device device;
+        device.initialize(oalsfxpp::ChannelFormat::stereo, 48'000);
+
+        src_gains.assign(coeffs.cbegin(), coeffs.cbegin() + channel_count);
+        stem_gains.resize(channel_count);
+
+        for (int c = 0; c < channel_count; ++c)
+        {
+            oalsfxpp::Panning::compute_first_order_gains(
+                device.channel_count_,
+                device.foa_,
+                oalsfxpp::mat4f_identity.m_[c],
+                1.0F,
+                stem_gains[c]);
+        }
+    }
+
+    oalsfxpp::Api api;
+
+    if (!api.initialize(is_b_format ? oalsfxpp::ChannelFormat::b_format : oalsfxpp::ChannelFormat::stereo, 48'000, 1))
+    {
+        return {};
+    }
+
+    api.set_effect(0, effect);
+
+    if (!api.apply_changes())
+    {
+        return {};
+    }
+
+    const auto frame_count = static_cast<int>(src_samples.size());
+
+    auto silence = Samples(channel_count * batch_silence_count);
+    auto stem = std::vector<Samples>(channel_count, Samples(batch_silence_count));
+
+    auto stem_channels = std::vector<float*>{};
+
+    for (auto& channel : stem)
+    {
+        stem_channels.push_back(channel.data());
+    }
+
+    const auto effect_channels = stem_channels.data();
+
+    if (!api.mix_stems(batch_silence_count, silence.data(), nullptr, &effect_channels, nullptr))
+    {
+        return {};
+    }
+
+    auto dst_samples = Samples(2 * frame_count);
+
+    for (int i = 0; i < frame_count; i += batch_chunk_size)
+    {
+        const auto count = std::min(batch_chunk_size, frame_count - i);
+
+        auto chunk = Samples(channel_count * count);
+
+        for (int j = 0; j < count; ++j)
+        {
+            for (int c = 0; c < channel_count; ++c)
+            {
+                chunk[(channel_count * j) + c] = src_gains[c] * src_samples[i + j];
+            }
+        }
+
+        if (!api.mix_stems(count, chunk.data(), nullptr, &effect_channels, nullptr))
+        {
+            return {};
+        }
+
+        for (int j = 0; j < count; ++j)
+        {
+            for (int c = 0; c < channel_count; ++c)
+            {
+                dst_samples[(2 * (i + j)) + 0] += stem_gains[c][0] * stem[c][j];
+                dst_samples[(2 * (i + j)) + 1] += stem_gains[c][1] * stem[c][j];
+            }
+        }
+    }
+
+    return dst_samples;
+}
+
+// Runs the effect state on its own on a stereo device, for a source in front.
+//
+// The reverb pans in all the directions, and the stereo decode of a B-format
+// output clamps its gains, so the API has no stem to compare with.
+Samples mix_state_reference(
+    const oalsfxpp::Effect& effect,
+    const Samples& src_samples)
+{
+    oalsfxpp::Device device;
+    device.initialize(oalsfxpp::ChannelFormat::stereo, 48'000);
+
+    oalsfxpp::EffectSlot effect_slot;
+    effect_slot.effect_ = effect;
+
+    auto effect_state = oalsfxpp::EffectSlot::EffectStateUPtr{
+        oalsfxpp::EffectStateFactory::create_by_type(effect.type_)};
+
+    if (!effect_state)
+    {
+        return {};
+    }
+
+    effect_state->update_device(device);
+    effect_state->update(device, effect_slot, effect.props_);
+
+    oalsfxpp::AmbiCoeffs coeffs;
+
+    oalsfxpp::Panning::calc_angle_coeffs(0.0F, 0.0F, 0.0F, coeffs);
+
+    auto src_buffers = oalsfxpp::SampleBuffers(oalsfxpp::max_effect_channels);
+    auto dst_buffers = oalsfxpp::SampleBuffers(2);
+
+    for (auto& buffer : src_buffers)
+    {
+        buffer.fill(0.0F);
+    }
+
+    for (auto& buffer : dst_buffers)
+    {
+        buffer.fill(0.0F);
+    }
+
+    effect_state->process(batch_silence_count, src_buffers, dst_buffers, 2);
+
+    const auto frame_count = static_cast<int>(src_samples.size());
+
+    auto dst_samples = Samples(2 * frame_count);
+
+    for (int i = 0; i < frame_count; i += batch_chunk_size)
+    {
+        const auto count = std::min(batch_chunk_size, frame_count - i);
+
+        for (int c = 0; c < oalsfxpp::max_effect_channels; ++c)
+        {
+            for (int j = 0; j < count; ++j)
+            {
+                src_buffers[c][j] = coeffs[c] * src_samples[i + j];
+            }
+        }
+
+        for (auto& buffer : dst_buffers)
+        {
+            buffer.fill(0.0F);
+        }
+
+        effect_state->process(count, src_buffers, dst_buffers, 2);
+
+        for (int j = 0; j < count; ++j)
+        {
+            dst_samples[(2 * (i + j)) + 0] = dst_buffers[0][j];
+            dst_samples[(2 * (i + j)) + 1] = dst_buffers[1][j];
+        }
+    }
+
+    return dst_samples;
+}
+
+// Checks that each instance of the batch matches the reference, for a source
+// in front.
+//
+// The instances are more than the lanes of any width, so the last lanes run
+// with some unused. The properties of each instance are made by
+// "make_effect".
+bool test_batch(
+    const oalsfxpp::EffectType effect_type,
+    oalsfxpp::Effect (*make_effect)(int instance_index),
+    Samples (*mix_reference)(const oalsfxpp::Effect& effect, const Samples& src_samples))
+{
+    oalsfxpp::EffectBatch batch;
+
+    if (!batch.initialize(effect_type, 48'000, batch_instance_count))
+    {
+        return false;
+    }
+
+    // The noise of both channels as mono, starting at another frame for each
+    // instance.
+    const auto noise = make_stereo_noise(batch_frame_count);
+
+    auto src_samples = std::vector<Samples>{};
+    auto dst_samples = std::vector<Samples>(2 * batch_instance_count, Samples(batch_frame_count));
+
+    for (int i = 0; i < batch_instance_count; ++i)
+    {
+        src_samples.emplace_back(noise.cbegin() + (97 * i), noise.cbegin() + (97 * i) + batch_frame_count);
+
+        if (!batch.set_effect_props(i, make_effect(i).props_))
+        {
+            return false;
+        }
+    }
+
+    auto silence = Samples(batch_silence_count);
+
+    auto src_channels = std::vector<const float*>(batch_instance_count, silence.data());
+    auto dst_channels = std::vector<float*>(2 * batch_instance_count);
+
+    for (int i = 0; i < 2 * batch_instance_count; ++i)
+    {
+        dst_channels[i] = dst_samples[i].data();
+    }
+
+    if (!batch.process(batch_silence_count, src_channels.data(), dst_channels.data()))
+    {
+        return false;
+    }
+
+    for (int base = 0; base < batch_frame_count; base += batch_chunk_size)
+    {
+        const auto count = std::min(batch_chunk_size, batch_frame_count - base);
+
+        for (int i = 0; i < batch_instance_count; ++i)
+        {
+            src_channels[i] = &src_samples[i][base];
+            dst_channels[(2 * i) + 0] = &dst_samples[(2 * i) + 0][base];
+            dst_channels[(2 * i) + 1] = &dst_samples[(2 * i) + 1][base];
+        }
+
+        if (!batch.process(count, src_channels.data(), dst_channels.data()))
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < batch_instance_count; ++i)
+    {
+        const auto reference = mix_reference(make_effect(i), src_samples[i]);
+
+        if (reference.empty() || get_peak(reference) == 0.0F)
+        {
+            return false;
+        }
+
+        for (int j = 0; j < batch_frame_count; ++j)
+        {
+            for (int s = 0; s < 2; ++s)
+            {
+                if (!(std::abs(dst_samples[(2 * i) + s][j] - reference[(2 * j) + s]) < 0.000'1F))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_batch_echo()
+{
+    return test_batch(
+        oalsfxpp::EffectType::echo,
+        [](const int instance_index)
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(oalsfxpp::EffectType::echo);
+
+            auto& props = effect.props_.echo_;
+            props.delay_ = 0.01F + (0.003F * instance_index);
+            props.lr_delay_ = 0.01F * (instance_index % 4);
+            props.damping_ = 0.1F * (instance_index % 5);
+            props.spread_ = (instance_index % 2 == 0 ? -0.5F : 0.7F);
+
+            return effect;
+        },
+        mix_api_reference);
+}
+
+bool test_batch_chorus()
+{
+    return test_batch(
+        oalsfxpp::EffectType::chorus,
+        [](const int instance_index)
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(oalsfxpp::EffectType::chorus);
+
+            auto& props = effect.props_.chorus_;
+            props.waveform_ = instance_index % 2;
+            props.phase_ = ((40 * instance_index) % 360) - 180;
+            props.rate_ = 0.5F + (0.25F * instance_index);
+            props.feedback_ = 0.5F;
+
+            return effect;
+        },
+        mix_api_reference);
+}
+
+bool test_batch_flanger()
+{
+    return test_batch(
+        oalsfxpp::EffectType::flanger,
+        [](const int instance_index)
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(oalsfxpp::EffectType::flanger);
+
+            auto& props = effect.props_.flanger_;
+            props.waveform_ = instance_index % 2;
+            props.phase_ = ((40 * instance_index) % 360) - 180;
+            props.rate_ = 0.5F + (0.25F * instance_index);
+            props.feedback_ = (instance_index % 2 == 0 ? -0.5F : 0.5F);
+
+            return effect;
+        },
+        mix_api_reference);
+}
+
+bool test_batch_compressor()
+{
+    return test_batch(
+        oalsfxpp::EffectType::compressor,
+        [](const int instance_index)
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(oalsfxpp::EffectType::compressor);
+            effect.props_.compressor_.on_off_ = (instance_index % 3 != 0);
+
+            return effect;
+        },
+        mix_api_reference);
+}
+
+// The instances of the reverb run their late lines together, except for those
+// of the qualities with fewer late frames.
+bool test_batch_reverb()
+{
+    return test_batch(
+        oalsfxpp::EffectType::eax_reverb,
+        [](const int instance_index)
+        {
+            auto effect = oalsfxpp::Effect{};
+            effect.set_type_and_defaults(oalsfxpp::EffectType::eax_reverb);
+
+            auto& props = effect.props_.reverb_;
+            props.decay_time_ = 0.5F + (0.25F * instance_index);
+            props.modulation_depth_ = 0.1F * (instance_index % 4);
+            props.quality_ = instance_index % (oalsfxpp::EffectProps::Reverb::max_quality + 1);
+
+            return effect;
+        },
+        mix_state_reference);
+}
+
+
+} // namespace
+
+
+int main()
+{
+    struct Test
+    {
+        const char* name_;
+        bool (*func_)();
+    }; // Test
+
+    const Test tests[] =
+    {
+        {"filter_block", test_filter_block},
+        {"filter_unstable_block", test_filter_unstable_block},
+        {"write_interleaved", test_write_interleaved},
+        {"simd_level_after_selection", test_simd_level_after_selection},
+        {"oscillator_block", test_oscillator_block},
+        {"dynamics_burst", test_dynamics_burst},
+        {"dynamics_chunk_size", test_dynamics_chunk_size},
+        {"echo_chunk_size", test_echo_chunk_size},
+        {"multi_tap_echo_chunk_size", test_multi_tap_echo_chunk_size},
+        {"reverb_presets", test_reverb_presets},
+        {"stems_unwritten", test_stems_unwritten},
+        {"chorus_fractional_delay", test_chorus_fractional_delay},
+        {"ring_modulator_latency", test_ring_modulator_latency},
+        {"convolution_b_format", test_convolution_b_format},
+        {"convolution_downsampling", test_convolution_downsampling},
+        {"state_truncated", test_state_truncated},
+        {"state_corrupted", test_state_corrupted},
+        {"batch_echo", test_batch_echo},
+        {"batch_chorus", test_batch_chorus},
+        {"batch_flanger", test_batch_flanger},
+        {"batch_compressor", test_batch_compressor},
+        {"batch_reverb", test_batch_reverb},
+    };
+
+    auto failed_count = 0;
+
+    for (const auto& test : tests)
+    {
+        const auto is_passed = test.func_();
+
+        std::cout << (is_passed ? "PASSED " : "FAILED ") << test.name_ << std::endl;
+
+        if (!is_passed)
+        {
+            failed_count += 1;
+        }
+    }
+
+    return (failed_count == 0 ? 0 : 1);
+}
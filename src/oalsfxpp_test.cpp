@@ -726,6 +726,8 @@ private:
     }
 }; // WavFile
 
+constexpr int WavFile::max_write_buffer_samples;
+
 
 int main(
     int argc,
@@ -782,7 +784,9 @@ int main(
             "9. Equalizer\n" <<
             "10. Flanger\n" <<
             "11. Ring modulator\n" <<
-            "12. Null\n" <<
+            "12. Multi-tap echo\n" <<
+            "13. Dynamics\n" <<
+            "14. Null\n" <<
             std::endl;
 
         auto effect_number = 0;
@@ -852,6 +856,14 @@ int main(
                 break;
 
             case 12:
+                effect_type = oalsfxpp::EffectType::multi_tap_echo;
+                break;
+
+            case 13:
+                effect_type = oalsfxpp::EffectType::dynamics;
+                break;
+
+            case 14:
                 effect_type = oalsfxpp::EffectType::null;
                 break;
 